@@ -0,0 +1,148 @@
+/**
+ * @file AsyncResampler.h
+ * @author Hamilton Kibbe
+ * @copyright 2015 Hamilton Kibbe
+ */
+
+#ifndef ASYNCRESAMPLER_H_
+#define ASYNCRESAMPLER_H_
+
+#include "Error.h"
+#include "Resampler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Time constant of the fill servo, in seconds. The fill level a read sees
+ only changes when a whole block slips between the clocks, so the servo is slow
+ enough that those steps don't audibly modulate the ratio */
+#define ASYNC_RESAMPLER_TIME_CONSTANT (10.0)
+
+/** Largest correction the servo applies to the nominal ratio */
+#define ASYNC_RESAMPLER_MAX_CORRECTION (0.002)
+
+
+/** Opaque AsyncResampler object */
+typedef struct AsyncResampler AsyncResampler;
+typedef struct AsyncResamplerD AsyncResamplerD;
+
+
+/** Create a new AsyncResampler
+ *
+ * @details Allocates memory and returns an initialized AsyncResampler, which
+ *          bridges two clock domains whose rates are only nominally known.
+ *          Input is queued as it arrives, and each read resamples exactly
+ *          the number of outputs asked for. A servo watches the fill level of
+ *          the queue and trims the ratio every read to hold it at two blocks,
+ *          so the ratio tracks the drift between the clocks. Reads return
+ *          silence until the queue first fills. The queue is a lock-free
+ *          single producer, single consumer FIFO, so Write can be called from
+ *          one thread while Read, Flush and AsyncResamplerRatio are called
+ *          from another, and neither side ever waits for the other.
+ *          Play nice and call AsyncResamplerFree on it when you're done.
+ *
+ * @param input_rate    Nominal input sample rate.
+ * @param output_rate   Nominal output sample rate.
+ * @param max_block     Largest block that will be written or read.
+ * @param quality       Quality preset.
+ * @return              An initialized AsyncResampler, or NULL on failure.
+ */
+AsyncResampler*
+AsyncResamplerInit(double               input_rate,
+                   double               output_rate,
+                   unsigned             max_block,
+                   ResamplerQuality_t   quality);
+
+AsyncResamplerD*
+AsyncResamplerInitD(double              input_rate,
+                    double              output_rate,
+                    unsigned            max_block,
+                    ResamplerQuality_t  quality);
+
+
+/** Free memory associated with an AsyncResampler
+ *
+ * @details release all memory allocated by AsyncResamplerInit for the
+ *          supplied resampler.
+ *
+ * @param resampler AsyncResampler to free.
+ * @return          Error code, 0 on success
+ */
+Error_t
+AsyncResamplerFree(AsyncResampler* resampler);
+
+Error_t
+AsyncResamplerFreeD(AsyncResamplerD* resampler);
+
+
+/** Flush resampler state
+ *
+ * @details Empties the queue and resets the servo, keeping the drift it has
+ *          learned. Call it from the thread that reads. Samples written
+ *          while it runs may be kept or dropped.
+ *
+ * @param resampler AsyncResampler to flush.
+ * @return          Error code, 0 on success
+ */
+Error_t
+AsyncResamplerFlush(AsyncResampler* resampler);
+
+Error_t
+AsyncResamplerFlushD(AsyncResamplerD* resampler);
+
+
+/** Queue input samples
+ *
+ * @param resampler The AsyncResampler to use.
+ * @param inBuffer  The samples to queue.
+ * @param n_samples The number of samples, at most max_block.
+ * @return          Error code, 0 on success. VALUE_ERROR if the queue is full,
+ *                  in which case the samples are dropped.
+ */
+Error_t
+AsyncResamplerWrite(AsyncResampler* resampler,
+                    const float*    inBuffer,
+                    unsigned        n_samples);
+
+Error_t
+AsyncResamplerWriteD(AsyncResamplerD*   resampler,
+                     const double*      inBuffer,
+                     unsigned           n_samples);
+
+
+/** Read resampled output
+ *
+ * @details Updates the ratio from the fill level, then resamples n_samples
+ *          outputs from the queue.
+ *
+ * @param resampler The AsyncResampler to use.
+ * @param outBuffer The buffer to write the output to.
+ * @param n_samples The number of samples to read, at most max_block.
+ * @return          Error code, 0 on success. VALUE_ERROR if the queue ran
+ *                  dry, in which case the output is silent until it refills.
+ */
+Error_t
+AsyncResamplerRead(AsyncResampler* resampler, float* outBuffer, unsigned n_samples);
+
+Error_t
+AsyncResamplerReadD(AsyncResamplerD* resampler, double* outBuffer, unsigned n_samples);
+
+
+/** Find the ratio the resampler is running at
+ *
+ * @param resampler The AsyncResampler to use.
+ * @return          Output samples per input sample, including the servo's
+ *                  correction.
+ */
+double
+AsyncResamplerRatio(const AsyncResampler* resampler);
+
+double
+AsyncResamplerRatioD(const AsyncResamplerD* resampler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ASYNCRESAMPLER_H_ */
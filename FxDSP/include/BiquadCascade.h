@@ -0,0 +1,129 @@
+/**
+ * @file BiquadCascade.h
+ * @author Hamilton Kibbe
+ * @copyright 2015 Hamilton Kibbe
+ * @brief Multichannel cascade of biquad filters
+ */
+
+#ifndef BIQUADCASCADE_H_
+#define BIQUADCASCADE_H_
+
+#include "Error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** BiquadCascade type */
+typedef struct BiquadCascade BiquadCascade;
+typedef struct BiquadCascadeD BiquadCascadeD;
+
+
+/** Create a new BiquadCascade
+ *
+ * @details Allocates memory and returns an initialized BiquadCascade, which
+ *          runs the same number of second-order sections in series on every
+ *          channel. Each channel has its own coefficients. Channels are
+ *          grouped to fill a SIMD register, 8 single precision or 4 double
+ *          precision channels at a time, and the coefficients and state of a
+ *          group are stored interleaved by channel, so each tick of a section
+ *          filters the whole group. Every section starts as a pass-through.
+ *          All memory is allocated here, so processing does not allocate.
+ *          Play nice and call BiquadCascadeFree when you're done with it.
+ *
+ * @param n_sections    The number of sections on each channel.
+ * @param n_channels    The number of channels to filter.
+ * @return              An initialized BiquadCascade, or NULL on failure.
+ */
+BiquadCascade*
+BiquadCascadeInit(unsigned n_sections, unsigned n_channels);
+
+BiquadCascadeD*
+BiquadCascadeInitD(unsigned n_sections, unsigned n_channels);
+
+
+/** Free memory associated with a BiquadCascade
+ *
+ * @details release all memory allocated by BiquadCascadeInit for the
+ *          supplied filter.
+ *
+ * @param cascade   BiquadCascade to free.
+ * @return          Error code, 0 on success
+ */
+Error_t
+BiquadCascadeFree(BiquadCascade* cascade);
+
+Error_t
+BiquadCascadeFreeD(BiquadCascadeD* cascade);
+
+
+/** Flush the state of every section
+ *
+ * @param cascade   BiquadCascade to flush.
+ * @return          Error code, 0 on success
+ */
+Error_t
+BiquadCascadeFlush(BiquadCascade* cascade);
+
+Error_t
+BiquadCascadeFlushD(BiquadCascadeD* cascade);
+
+
+/** Set the coefficients of one section of one channel
+ *
+ * @details The section's state is kept, as in BiquadFilterUpdateKernel.
+ *
+ * @param cascade   The BiquadCascade to update.
+ * @param channel   The channel to update.
+ * @param section   The section to update, counted from the input.
+ * @param bCoeff    Numerator coefficients [b0, b1, b2]
+ * @param aCoeff    Denominator coefficients [a1, a2]
+ * @return          Error code, 0 on success
+ */
+Error_t
+BiquadCascadeUpdateKernel(BiquadCascade*    cascade,
+                          unsigned          channel,
+                          unsigned          section,
+                          const float*      bCoeff,
+                          const float*      aCoeff);
+
+Error_t
+BiquadCascadeUpdateKernelD(BiquadCascadeD*  cascade,
+                           unsigned         channel,
+                           unsigned         section,
+                           const double*    bCoeff,
+                           const double*    aCoeff);
+
+
+/** Filter a buffer of samples for every channel
+ *
+ * @details Runs every section of every channel, in one call. The channels
+ *          are stored one after the other, each n_samples long, so channel c
+ *          starts at inBuffer + c * n_samples. Each section matches
+ *          BiquadFilterProcess. outBuffer may be inBuffer.
+ *
+ * @param cascade   The BiquadCascade to use.
+ * @param outBuffer The buffer to write the output to, in the same layout.
+ * @param inBuffer  The buffer to filter.
+ * @param n_samples The number of samples per channel to filter.
+ * @return          Error code, 0 on success
+ */
+Error_t
+BiquadCascadeProcess(BiquadCascade* cascade,
+                     float*         outBuffer,
+                     const float*   inBuffer,
+                     unsigned       n_samples);
+
+Error_t
+BiquadCascadeProcessD(BiquadCascadeD*   cascade,
+                      double*           outBuffer,
+                      const double*     inBuffer,
+                      unsigned          n_samples);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BIQUADCASCADE_H_ */
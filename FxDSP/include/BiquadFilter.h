@@ -12,6 +12,7 @@
 #define BIQUADFILTER_H_
 
 #include "Error.h"
+#include "FilterTypes.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -117,6 +118,26 @@ BiquadFilterUpdateKernelD(BiquadFilterD *filter,
                           const double  *bCoeff,
                           const double  *aCoeff);
 
+
+/** Set how BiquadFilterProcess runs the filter
+ *
+ * @details IIR_SERIAL runs the recursion one sample at a time. IIR_BLOCK
+ *          computes IIR_BLOCK_LENGTH outputs at a time as a matrix-vector
+ *          product of the block's inputs and the filter state, with SIMD,
+ *          which is faster when there is a single channel to filter. Its
+ *          output matches IIR_SERIAL to within rounding. Both modes share
+ *          the filter state, so the mode can be changed mid-stream.
+ *
+ * @param filter    The filter to update
+ * @param mode      The processing mode.
+ * @return          Error code, 0 on success
+ */
+Error_t
+BiquadFilterSetMode(BiquadFilter* filter, IIRMode_t mode);
+
+Error_t
+BiquadFilterSetModeD(BiquadFilterD* filter, IIRMode_t mode);
+
 #ifdef __cplusplus
 }
 #endif
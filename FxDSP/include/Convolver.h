@@ -0,0 +1,178 @@
+/**
+ * @file Convolver.h
+ * @author Hamilton Kibbe
+ * @copyright 2015 Hamilton Kibbe
+ */
+
+#ifndef CONVOLVER_H_
+#define CONVOLVER_H_
+
+#include "Error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The largest FFT partition a Convolver will use. Kernels long enough to need
+ more are covered by a uniformly partitioned tail of this size. */
+#define CONVOLVER_MAX_PARTITION_LENGTH (8192)
+
+
+/** Convolver type */
+typedef struct Convolver Convolver;
+typedef struct ConvolverD ConvolverD;
+
+
+/** Function a threaded Convolver's worker calls before starting each job
+ *
+ * @param context   The context given to ConvolverSetWorkerHook.
+ * @param segment   Index of the segment the job belongs to. Segments are
+ *                  numbered from the start of the kernel.
+ */
+typedef void (*ConvolverWorkerHook)(void* context, unsigned segment);
+
+
+/** Create a new Convolver
+ *
+ * @details Allocates memory and returns an initialized Convolver. The
+ *          Convolver filters with long kernels, such as reverb impulse
+ *          responses, without adding any latency. The first block_size
+ *          coefficients are applied by direct convolution. The rest of the
+ *          kernel is split into FFT partitions that double in size every two
+ *          partitions, each starting late enough in the kernel to hide its
+ *          own block delay.
+ *
+ * @param filter_kernel     The filter coefficients. These are copied to the
+ *                          convolver so there is no need to keep them around.
+ * @param length            The number of coefficients in filter_kernel.
+ * @param block_size        Length of the direct-form head and of the smallest
+ *                          FFT partition. The host block size is a good
+ *                          choice, though any call length may be processed.
+ * @return                  An initialized Convolver, or NULL on failure.
+ */
+Convolver*
+ConvolverInit(const float*  filter_kernel,
+              unsigned      length,
+              unsigned      block_size);
+
+ConvolverD*
+ConvolverInitD(const double*    filter_kernel,
+               unsigned         length,
+               unsigned         block_size);
+
+
+/** Create a new Convolver that processes late partitions on a worker thread
+ *
+ * @details Same as ConvolverInit, but the larger FFT segments, which have at
+ *          least two blocks between their input being complete and their
+ *          output falling due, are computed by a worker thread owned by the
+ *          convolver. ConvolverProcess then only runs the head and the
+ *          earliest segments itself, so the time spent in each call stays
+ *          bounded. It never computes a worker job or waits for one. Jobs and
+ *          results are handed over through lock-free queues, and each job is
+ *          posted at least two blocks before its output falls due. The worker
+ *          runs jobs a partition at a time, smallest segment first, so a long
+ *          job doesn't hold up one that is due sooner. If the worker still
+ *          misses a deadline, as when its thread is preempted, that segment's
+ *          output for the partition is left out, and if it falls further
+ *          behind, the input it missed is treated as silence. The output is
+ *          degraded for up to a kernel length, but processing never stalls.
+ *
+ * @param filter_kernel     The filter coefficients. These are copied to the
+ *                          convolver so there is no need to keep them around.
+ * @param length            The number of coefficients in filter_kernel.
+ * @param block_size        Length of the direct-form head and of the smallest
+ *                          FFT partition.
+ * @return                  An initialized Convolver, or NULL on failure.
+ */
+Convolver*
+ConvolverInitThreaded(const float*  filter_kernel,
+                      unsigned      length,
+                      unsigned      block_size);
+
+ConvolverD*
+ConvolverInitThreadedD(const double*    filter_kernel,
+                       unsigned         length,
+                       unsigned         block_size);
+
+
+/** Set a function for a threaded Convolver's worker to call before each job
+ *
+ * @details The hook runs on the worker thread, so one that blocks holds up
+ *          the worker, which makes it possible to test how a late worker is
+ *          handled. Set it before the first call to ConvolverProcess. A
+ *          Convolver without a worker thread never calls it, and
+ *          ConvolverFree waits for a running hook to return.
+ *
+ * @param convolver The Convolver to update
+ * @param hook      Function to call, or NULL for none
+ * @param context   Passed to the hook
+ * @return          Error code, 0 on success
+ */
+Error_t
+ConvolverSetWorkerHook(Convolver*           convolver,
+                       ConvolverWorkerHook  hook,
+                       void*                context);
+
+Error_t
+ConvolverSetWorkerHookD(ConvolverD*         convolver,
+                        ConvolverWorkerHook hook,
+                        void*               context);
+
+
+/** Free memory associated with a Convolver
+ *
+ * @details release all memory allocated by ConvolverInit for the
+ *          supplied convolver, and stop its worker thread if it has one.
+ *
+ * @param convolver Convolver to free
+ * @return          Error code, 0 on success
+ */
+Error_t
+ConvolverFree(Convolver* convolver);
+
+Error_t
+ConvolverFreeD(ConvolverD* convolver);
+
+
+/** Flush convolver state buffers
+ *
+ * @param convolver Convolver to flush
+ * @return          Error code, 0 on success
+ */
+Error_t
+ConvolverFlush(Convolver* convolver);
+
+Error_t
+ConvolverFlushD(ConvolverD* convolver);
+
+
+/** Filter a buffer of samples
+ *
+ * @details The output is the full convolution of the input with the kernel,
+ *          with no delay. Buffers of any length may be processed.
+ *
+ * @param convolver The Convolver to use
+ * @param outBuffer The buffer to write the output to
+ * @param inBuffer  The buffer to filter
+ * @param n_samples The number of samples to filter
+ * @return          Error code, 0 on success
+ */
+Error_t
+ConvolverProcess(Convolver*     convolver,
+                 float*         outBuffer,
+                 const float*   inBuffer,
+                 unsigned       n_samples);
+
+Error_t
+ConvolverProcessD(ConvolverD*   convolver,
+                  double*       outBuffer,
+                  const double* inBuffer,
+                  unsigned      n_samples);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONVOLVER_H_ */
@@ -26,7 +26,10 @@ typedef struct DecimatorD DecimatorD;
 /** Create a new Decimator
  *
  * @details Allocates memory and returns an initialized Decimator with
- *          a given decimation factor.
+ *          a given decimation factor. 2x, 4x and 8x use the tabulated
+ *          filters in PolyphaseCoeffs. Other factors run as a cascade of
+ *          smaller stages, each filtered with coefficients designed here (see
+ *          PolyphaseStageDesign).
  *
  * @param factor    Decimation factor
  * @return          An initialized Decimator
@@ -37,6 +40,26 @@ DecimatorInit(ResampleFactor_t factor);
 DecimatorD*
 DecimatorInitD(ResampleFactor_t factor);
 
+/** Create a new Decimator with a choice of filter
+ *
+ * @details As DecimatorInit, which uses RESAMPLE_FIR. RESAMPLE_IIR decimates
+ *          with a cascade of 2x HalfbandFilter stages instead, for a few
+ *          multiplies per sample and a delay of a few samples. It only
+ *          supports factors that are powers of 2, and returns NULL otherwise.
+ *          RESAMPLE_FIR_MINIMUM_PHASE keeps the FIR magnitude response but
+ *          cuts the delay of each stage to a few samples.
+ *          RESAMPLE_FIR_CASCADE runs the designed cascade for every factor.
+ *
+ * @param factor    Decimation factor
+ * @param mode      Resampling filter
+ * @return          An initialized Decimator
+ */
+Decimator*
+DecimatorInitMode(ResampleFactor_t factor, ResampleMode_t mode);
+
+DecimatorD*
+DecimatorInitModeD(ResampleFactor_t factor, ResampleMode_t mode);
+
 /** Free memory associated with a Upsampler
  *
  * @details release all memory allocated by DecimatorInit for the
@@ -63,12 +86,19 @@ DecimatorFlushD(DecimatorD* decimator);
 
 /** Decimate a buffer of samples
  *
- * @details Decimates given buffer using a polyphase decimator
+ * @details Decimates given buffer using a polyphase decimator. Only the
+ *          retained outputs are computed, each as one dot product with the
+ *          input history. n_samples / factor samples are written when
+ *          n_samples is a multiple of the factor. Otherwise the phase carries
+ *          over to the next call, so blocks of any size give the same output
+ *          as one long block. Decimation can't be done in place. In
+ *          RESAMPLE_IIR mode, each output is written once the last of its
+ *          factor input samples arrives.
  *
  * @param decimator The Decimator to use
  * @param outBuffer The buffer to write the output to
  * @param inBuffer  The buffer to filter
- * @param n_samples The number of samples to upsample
+ * @param n_samples The number of samples to decimate
  * @return          Error code, 0 on success
  */
 Error_t
@@ -287,6 +287,49 @@ double
 VectorSumD(const double* src, unsigned length);
 
 
+#pragma mark - Vector Dot Product
+/** Calculate the dot product of two vectors
+ *
+ * @param in1       First vector
+ * @param in2       Second vector
+ * @param length    Number of samples in each vector
+ * @return          Sum of in1[i] * in2[i]
+ */
+float
+VectorDotProduct(const float* in1, const float* in2, unsigned length);
+
+double
+VectorDotProductD(const double* in1, const double* in2, unsigned length);
+
+
+/** Calculate the dot product of a vector and a blend of two kernels
+ *
+ * @details Gives the same result as VectorDotProduct(in, k, length), where
+ *          k[i] = kernel0[i] + frac * (kernel1[i] - kernel0[i]), without
+ *          forming k. Both kernels share the input loads.
+ *
+ * @param in        Input vector
+ * @param kernel0   Kernel at frac = 0
+ * @param kernel1   Kernel at frac = 1
+ * @param frac      Position between the kernels
+ * @param length    Number of samples in each vector
+ * @return          Sum of in[i] * k[i]
+ */
+float
+VectorInterpolatedDotProduct(const float*   in,
+                             const float*   kernel0,
+                             const float*   kernel1,
+                             float          frac,
+                             unsigned       length);
+
+double
+VectorInterpolatedDotProductD(const double* in,
+                              const double* kernel0,
+                              const double* kernel1,
+                              double        frac,
+                              unsigned      length);
+
+
 #pragma mark - Vector Min/Max
 /** Find the Maximum value in a vector
  *
@@ -557,8 +600,43 @@ VectorPowerD(double* dest, const double* in, double power, unsigned length);
 
 
 #pragma mark - Convolution
+/** Kernel symmetry about its centre */
+typedef enum _Symmetry
+{
+    /** No usable symmetry */
+    ASYMMETRIC = 0,
+
+    /** h[n] == h[N - 1 - n], as in linear-phase lowpass and bandpass kernels */
+    SYMMETRIC = 1,
+
+    /** h[n] == -h[N - 1 - n], as in differentiators and Hilbert transformers */
+    ANTISYMMETRIC = 2
+} Symmetry_t;
+
+
+/** Find the symmetry of a filter kernel
+ * @details Pairs of coefficients are compared to within a few ulps of the
+ *          largest coefficient, so kernels that were designed symmetric are
+ *          still detected after rounding.
+ * @param kernel    The kernel to check.
+ * @param length    Length [samples] of kernel.
+ * @return          SYMMETRIC, ANTISYMMETRIC or ASYMMETRIC.
+ */
+Symmetry_t
+KernelSymmetry(const float* kernel, unsigned length);
+
+Symmetry_t
+KernelSymmetryD(const double* kernel, unsigned length);
+
+
 /** Perform Convolution *
- * @details convolve in1 with in2 and write results to dest
+ * @details convolve in1 with in2 and write results to dest. Uses vDSP on
+ *          OS X. Elsewhere, in1 is run through an AVX, SSE2 or NEON kernel,
+ *          with the AVX one picked at run time when the CPU supports it. The
+ *          kernel reads in1 in place, and only the edges, where in2 overlaps
+ *          the zero padding, are padded on the stack a fixed-size chunk at a
+ *          time, so stack use doesn't depend on in1_length. in2 is usually
+ *          the shorter input.
  * @param in1           First input to convolve.
  * @param in1_length    Length [samples] of in1.
  * @param in2           Second input to convolve.
@@ -582,6 +660,125 @@ ConvolveD(double    *in1,
           double    *dest);
 
 
+/** Perform Convolution with a symmetric or antisymmetric kernel
+ * @details Same result as Convolve, but the two input samples that meet each
+ *          mirrored pair of coefficients are added (or subtracted) before the
+ *          multiply, so only half the multiplies are done. in2 must have the
+ *          given symmetry, as found by KernelSymmetry. ASYMMETRIC kernels, and
+ *          builds that use vDSP, go through Convolve.
+ * @param in1           Input signal.
+ * @param in1_length    Length [samples] of in1.
+ * @param in2           Kernel.
+ * @param in2_length    Length [samples] of in2.
+ * @param symmetry      Symmetry of in2.
+ * @param dest          Output buffer. needs to be of length
+ *                      in1_length + in2_length - 1
+ * @return              Error code.
+ */
+Error_t
+ConvolveSymmetric(float*     in1,
+                  unsigned   in1_length,
+                  float*     in2,
+                  unsigned   in2_length,
+                  Symmetry_t symmetry,
+                  float*     dest);
+
+Error_t
+ConvolveSymmetricD(double*    in1,
+                   unsigned   in1_length,
+                   double*    in2,
+                   unsigned   in2_length,
+                   Symmetry_t symmetry,
+                   double*    dest);
+
+
+/** Convolve a signal with several kernels and interleave the results
+ * @details Output i of kernel p is written to dest[i * n_kernels + p], so the
+ *          kernels can be the phases of a polyphase interpolator. Only outputs
+ *          where every kernel overlaps the signal are computed, so src needs
+ *          length + kernel_length - 1 samples, with the history at the start.
+ *          Each input load is shared by two kernels.
+ * @param src           Input signal.
+ * @param length        Number of outputs per kernel.
+ * @param kernels       The kernels, one after another.
+ * @param kernel_length Length [samples] of each kernel.
+ * @param n_kernels     Number of kernels.
+ * @param dest          Output buffer. needs to be of length
+ *                      length * n_kernels
+ * @return              Error code.
+ */
+Error_t
+ConvolvePolyphase(const float*  src,
+                  unsigned      length,
+                  const float*  kernels,
+                  unsigned      kernel_length,
+                  unsigned      n_kernels,
+                  float*        dest);
+
+Error_t
+ConvolvePolyphaseD(const double*    src,
+                   unsigned         length,
+                   const double*    kernels,
+                   unsigned         kernel_length,
+                   unsigned         n_kernels,
+                   double*          dest);
+
+
+#pragma mark - Block State-Space IIR Filtering
+/** Number of outputs IIRBlockFilter computes per iteration */
+#define IIR_BLOCK_LENGTH (8)
+
+/** Length of the coefficient array written by IIRBlockDesign */
+#define IIR_BLOCK_COEFFS (5 * IIR_BLOCK_LENGTH)
+
+/** Compute the block state-space form of a biquad
+ * @details Writes the matrices IIRBlockFilter uses to compute IIR_BLOCK_LENGTH
+ *          outputs of a transposed Direct-Form II biquad at once: the response
+ *          of each output to the two state variables, and the impulse
+ *          response that maps the block's inputs onto its outputs. Call it
+ *          again whenever the coefficients change.
+ * @param block_coeffs  Destination, of length IIR_BLOCK_COEFFS.
+ * @param bCoeff        Numerator coefficients [b0, b1, b2]
+ * @param aCoeff        Denominator coefficients [a1, a2]
+ * @return              Error code.
+ */
+Error_t
+IIRBlockDesign(float* block_coeffs, const float* bCoeff, const float* aCoeff);
+
+Error_t
+IIRBlockDesignD(double* block_coeffs, const double* bCoeff, const double* aCoeff);
+
+
+/** Filter a signal with a biquad, a block of outputs at a time
+ * @details Each block of IIR_BLOCK_LENGTH outputs is a matrix-vector product
+ *          of the block's inputs and the filter state, so the outputs are
+ *          computed in parallel, and the recursion only runs once per block
+ *          to update the state. Leftover samples are filtered one at a time.
+ *          The output matches the transposed Direct-Form II recursion to
+ *          within rounding. dest may be src.
+ * @param dest          Output buffer.
+ * @param src           Input buffer.
+ * @param length        Number of samples to filter.
+ * @param block_coeffs  Coefficients from IIRBlockDesign.
+ * @param state         The two state variables [w0, w1] of the recursion,
+ *                      updated in place.
+ * @return              Error code.
+ */
+Error_t
+IIRBlockFilter(float*       dest,
+               const float* src,
+               unsigned     length,
+               const float* block_coeffs,
+               float*       state);
+
+Error_t
+IIRBlockFilterD(double*         dest,
+                const double*   src,
+                unsigned        length,
+                const double*   block_coeffs,
+                double*         state);
+
+
 #pragma mark - Vector Amplitude-dB Conversion
 /** Convert amplitude values to dB
  * @details Convert an array of amplitude values to their dB equivalent.
@@ -34,9 +34,15 @@ extern "C" {
 #undef USE_OOURA_FFT
 #endif
 
-// Fallback to OOURA
+// Use the built-in FFT if it was requested explicitly
+#if defined(USE_NATIVE_FFT) && !defined(USE_FFTW_FFT)
+#undef USE_APPLE_FFT
+#undef USE_OOURA_FFT
+#endif
+
+// Fallback to the built-in FFT unless OOURA was requested
 #if !defined(USE_FFTW_FFT) && !defined(__APPLE__) && !defined(USE_OOURA_FFT)
-#define USE_OOURA_FFT
+#define USE_NATIVE_FFT
 #undef USE_APPLE_FFT
 #endif
 
@@ -46,7 +52,7 @@ extern "C" {
     typedef struct { float* realp; float* imagp;}  FFTSplitComplex;
     typedef fftw_complex     FFTComplexD;
     typedef struct { double* realp; double* imagp;} FFTSplitComplexD;
-#elif defined(USE_OOURA_FFT)
+#elif defined(USE_OOURA_FFT) || defined(USE_NATIVE_FFT)
     typedef struct { float real; float imag;} FFTComplex;
     typedef struct { float* realp; float* imagp;} FFTSplitComplex;
     typedef struct { double real; double imag;} FFTComplexD;
@@ -64,14 +70,42 @@ typedef struct FFTConfig FFTConfig;
 typedef struct FFTConfigD FFTConfigD;
 
 
+/** Planning effort
+ *
+ * @details How much time FFTW spends searching for a fast plan when a config
+ *          is created. FFT_PLAN_WISDOM_ONLY only builds plans that can be
+ *          recovered from imported wisdom. Other backends ignore the effort.
+ */
+typedef enum _FFTPlanEffort
+{
+    /** Pick a plan heuristically, no measurement */
+    FFT_PLAN_ESTIMATE,
+
+    /** Time a few candidate plans (FFTInit default) */
+    FFT_PLAN_MEASURE,
+
+    /** Time a wider range of plans */
+    FFT_PLAN_PATIENT,
+
+    /** Use imported wisdom, fail if there is none */
+    FFT_PLAN_WISDOM_ONLY
+}FFTPlanEffort_t;
+
+
 /** Create a new FFTConfig
  *
  * @details Allocates memory and returns an initialized FFTConfig,
  *      which is used to store the FFT Configuration. Play nice and call
- *          FFTFree on it when you're done.
+ *          FFTFree on it when you're done. Configs of the same length and
+ *          precision share their twiddle tables and plans, so creating more
+ *          of them only costs their scratch buffers.
  *
- * @param length        length of the FFT. should be a power of 2.
- * @return        An initialized FFTConfig.
+ * @param length        length of the FFT. Must be even. The built-in FFT
+ *                      supports lengths of the form 2^a * 3^b * 5^c, FFTW any
+ *                      even length, and Accelerate and Ooura powers of 2 only.
+ *                      Use FFTNextGoodLength to pick a supported length.
+ * @return        An initialized FFTConfig, or NULL if the length is not
+ *                supported.
  */
 FFTConfig*
 FFTInit(unsigned length);
@@ -79,6 +113,25 @@ FFTInit(unsigned length);
 FFTConfigD*
 FFTInitD(unsigned length);
 
+
+/** Create a new FFTConfig with a given planning effort
+ *
+ * @details Same as FFTInit, but lets the caller choose how hard FFTW works
+ *          to plan the transforms. Configs of the same length share a plan
+ *          only when they were made with the same effort, so asking for more
+ *          effort always gets a plan made with it.
+ *
+ * @param length        length of the FFT. See FFTInit.
+ * @param effort        planning effort.
+ * @return        An initialized FFTConfig, or NULL if planning failed (e.g.
+ *                no wisdom for this length with FFT_PLAN_WISDOM_ONLY).
+ */
+FFTConfig*
+FFTInitWithEffort(unsigned length, FFTPlanEffort_t effort);
+
+FFTConfigD*
+FFTInitWithEffortD(unsigned length, FFTPlanEffort_t effort);
+
 /** Free memory associated with a FFTConfig
  *
  * @details release all memory allocated by FFTInit for the supplied
@@ -94,6 +147,80 @@ Error_t
 FFTFreeD(FFTConfigD* fft);
 
 
+/** Find an efficient FFT length
+ *
+ * @details Returns the smallest length of at least length that the current
+ *          backend can transform efficiently. This is a power of 2 for the
+ *          Accelerate and Ooura backends, and an even 2^a * 3^b * 5^c length
+ *          (e.g. 480 or 960) for the built-in FFT and FFTW.
+ *
+ * @param length    Minimum FFT length.
+ * @return          FFT length to pass to FFTInit.
+ */
+unsigned
+FFTNextGoodLength(unsigned length);
+
+
+/** Import FFTW wisdom from a file
+ *
+ * @details Loads planner wisdom saved by FFTExportWisdomToFile so that
+ *          subsequent FFTInit calls can skip planning. Single and double
+ *          precision wisdom are kept separately. Does nothing unless FFTW is
+ *          the FFT backend.
+ *
+ * @param filename  Path to the wisdom file.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+FFTImportWisdomFromFile(const char* filename);
+
+Error_t
+FFTImportWisdomFromFileD(const char* filename);
+
+
+/** Export FFTW wisdom to a file
+ *
+ * @details Saves the wisdom accumulated by all plans created so far. Does
+ *          nothing unless FFTW is the FFT backend.
+ *
+ * @param filename  Path to the wisdom file.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+FFTExportWisdomToFile(const char* filename);
+
+Error_t
+FFTExportWisdomToFileD(const char* filename);
+
+
+/** Import FFTW wisdom from a string
+ *
+ * @details Loads wisdom from a string returned by FFTExportWisdomToString.
+ *          Does nothing unless FFTW is the FFT backend.
+ *
+ * @param wisdom    NULL-terminated wisdom string.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+FFTImportWisdomFromString(const char* wisdom);
+
+Error_t
+FFTImportWisdomFromStringD(const char* wisdom);
+
+
+/** Export FFTW wisdom to a string
+ *
+ * @details The caller owns the returned string and must free() it.
+ *
+ * @return          Wisdom string, or NULL if FFTW is not the FFT backend.
+ */
+char*
+FFTExportWisdomToString(void);
+
+char*
+FFTExportWisdomToStringD(void);
+
+
 /** Calculate Real to Complex Forward FFT
  *
  * @details Calculates the magnitude of the real forward FFT of the data in
@@ -154,6 +281,84 @@ IFFT_C2RD(FFTConfigD*   fft,
           double*       out);
 
 
+/** Calculate the Inverse FFT of a packed spectrum
+ *
+ * @details Inverse of FFT_IR_R2C. The spectrum is in the packed format that
+ *          FFT_IR_R2C writes, with the nyquist bin in the first imaginary
+ *          element, so no information is lost in the round trip.
+ *
+ * @param fft       Pointer to the FFT configuration.
+ * @param in        Packed spectrum, fft->length/2 real and imaginary values.
+ * @param out       Allocated buffer where the signal will be written. length
+ *                  should be fft->length.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+IFFT_IR_C2R(FFTConfig*      fft,
+            FFTSplitComplex in,
+            float*          out);
+
+Error_t
+IFFT_IR_C2RD(FFTConfigD*        fft,
+             FFTSplitComplexD   in,
+             double*            out);
+
+
+/** Calculate Complex to Complex Forward FFT
+ *
+ * @details Calculates the forward FFT of fft->length complex samples in split
+ *          format, using the same configuration (and tables) as the real
+ *          transforms. The input and output buffers may be the same.
+ *
+ * @param fft       Pointer to the FFT configuration.
+ * @param inReal    Real part of the input, fft->length samples.
+ * @param inImag    Imaginary part of the input, fft->length samples.
+ * @param outReal   Real part of the output, fft->length bins.
+ * @param outImag   Imaginary part of the output, fft->length bins.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+FFT_C2C(FFTConfig*      fft,
+        const float*    inReal,
+        const float*    inImag,
+        float*          outReal,
+        float*          outImag);
+
+Error_t
+FFT_C2CD(FFTConfigD*    fft,
+         const double*  inReal,
+         const double*  inImag,
+         double*        outReal,
+         double*        outImag);
+
+
+/** Calculate Complex to Complex Inverse FFT
+ *
+ * @details Inverse of FFT_C2C, scaled by 1/fft->length so that
+ *          IFFT_C2C(FFT_C2C(x)) == x.
+ *
+ * @param fft       Pointer to the FFT configuration.
+ * @param inReal    Real part of the spectrum, fft->length bins.
+ * @param inImag    Imaginary part of the spectrum, fft->length bins.
+ * @param outReal   Real part of the output, fft->length samples.
+ * @param outImag   Imaginary part of the output, fft->length samples.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+IFFT_C2C(FFTConfig*     fft,
+         const float*   inReal,
+         const float*   inImag,
+         float*         outReal,
+         float*         outImag);
+
+Error_t
+IFFT_C2CD(FFTConfigD*   fft,
+          const double* inReal,
+          const double* inImag,
+          double*       outReal,
+          double*       outImag);
+
+
 /** Perform Convolution using FFT*
  * @details convolve in1 with in2 and write results to dest
  * @param in1           First input to convolve.
@@ -207,6 +412,197 @@ FFTFilterConvolveD(FFTConfigD*      fft,
                    FFTSplitComplexD fft_ir,
                    double*          dest);
 
+
+/** Multiply two packed spectra and add the result to a third
+ *
+ * @details Calculates accum += a * b for spectra in the packed format
+ *          written by FFT_IR_R2C, handling the DC and nyquist bins
+ *          separately. Summing products like this before a single
+ *          IFFT_IR_C2R is the core of partitioned convolution.
+ *
+ * @param fft       Pointer to the FFT configuration.
+ * @param accum     Spectrum to add the product to.
+ * @param a         First packed spectrum.
+ * @param b         Second packed spectrum.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+FFTSpectrumMultiplyAccumulate(FFTConfig*        fft,
+                              FFTSplitComplex   accum,
+                              FFTSplitComplex   a,
+                              FFTSplitComplex   b);
+
+Error_t
+FFTSpectrumMultiplyAccumulateD(FFTConfigD*      fft,
+                               FFTSplitComplexD accum,
+                               FFTSplitComplexD a,
+                               FFTSplitComplexD b);
+
+
+/** Allocate the scratch memory for batched transforms
+ *
+ * @details The batched functions never allocate, so call this once on a
+ *          config, outside the audio thread, before using it with them.
+ *          Calling it again does nothing. Backends other than the built-in
+ *          FFT don't need the scratch memory.
+ *
+ * @param fft   Pointer to the FFT configuration.
+ * @return      Error code, 0 on success.
+ */
+Error_t
+FFTPrepareBatch(FFTConfig* fft);
+
+Error_t
+FFTPrepareBatchD(FFTConfigD* fft);
+
+
+/** Calculate Real to Complex Forward FFTs of several channels
+ *
+ * @details Same as FFT_R2C for n_channels signals of fft->length samples.
+ *          The channels are stored one after the other. The built-in FFT
+ *          transforms groups of channels together, sharing twiddles and SIMD
+ *          lanes between them. Call FFTPrepareBatch on the config first.
+ *
+ * @param fft           Pointer to the FFT configuration.
+ * @param inBuffer      Input data, n_channels * fft->length samples.
+ * @param real          Real parts, n_channels * (fft->length/2) values.
+ * @param imag          Imaginary parts, n_channels * (fft->length/2) values.
+ * @param n_channels    Number of channels.
+ * @return              Error code, 0 on success.
+ */
+Error_t
+FFT_R2C_Batch(FFTConfig*    fft,
+              const float*  inBuffer,
+              float*        real,
+              float*        imag,
+              unsigned      n_channels);
+
+Error_t
+FFT_R2C_BatchD(FFTConfigD*      fft,
+               const double*    inBuffer,
+               double*          real,
+               double*          imag,
+               unsigned         n_channels);
+
+
+/** Calculate Complex to Real Inverse FFTs of several channels
+ *
+ * @details Same as IFFT_C2R for n_channels spectra stored one after the other.
+ *
+ * @param fft           Pointer to the FFT configuration.
+ * @param inReal        Real parts, n_channels * (fft->length/2) values.
+ * @param inImag        Imaginary parts, n_channels * (fft->length/2) values.
+ * @param out           Output, n_channels * fft->length samples.
+ * @param n_channels    Number of channels.
+ * @return              Error code, 0 on success.
+ */
+Error_t
+IFFT_C2R_Batch(FFTConfig*   fft,
+               const float* inReal,
+               const float* inImag,
+               float*       out,
+               unsigned     n_channels);
+
+Error_t
+IFFT_C2R_BatchD(FFTConfigD*     fft,
+                const double*   inReal,
+                const double*   inImag,
+                double*         out,
+                unsigned        n_channels);
+
+
+/** Convolve several pairs of channels using the FFT
+ *
+ * @details Convolves channel c of in1 with channel c of in2, for each of
+ *          n_channels channels.
+ *
+ * @param fft           Pointer to the FFT configuration.
+ * @param in1           First inputs, n_channels * in1_length samples.
+ * @param in1_length    Length [samples] of each channel of in1.
+ * @param in2           Second inputs, n_channels * in2_length samples.
+ * @param in2_length    Length [samples] of each channel of in2.
+ * @param dest          Output, n_channels * fft->length samples. Channel c
+ *                      starts at dest + c * fft->length.
+ * @param n_channels    Number of channels.
+ * @return              Error code, 0 on success.
+ */
+Error_t
+FFTConvolveBatch(FFTConfig*     fft,
+                 const float*   in1,
+                 unsigned       in1_length,
+                 const float*   in2,
+                 unsigned       in2_length,
+                 float*         dest,
+                 unsigned       n_channels);
+
+Error_t
+FFTConvolveBatchD(FFTConfigD*   fft,
+                  const double* in1,
+                  unsigned      in1_length,
+                  const double* in2,
+                  unsigned      in2_length,
+                  double*       dest,
+                  unsigned      n_channels);
+
+
+/** Filter several channels with one pre-transformed kernel
+ *
+ * @details Same as FFTFilterConvolve for each of n_channels inputs.
+ *
+ * @param fft           Pointer to the FFT configuration.
+ * @param in            Inputs, n_channels * in_length samples.
+ * @param in_length     Length [samples] of each channel.
+ * @param fft_ir        Kernel, already transformed with FFT_IR_R2C.
+ * @param dest          Output, n_channels * fft->length samples. Channel c
+ *                      starts at dest + c * fft->length.
+ * @param n_channels    Number of channels.
+ * @return              Error code, 0 on success.
+ */
+Error_t
+FFTFilterConvolveBatch(FFTConfig*       fft,
+                       const float*     in,
+                       unsigned         in_length,
+                       FFTSplitComplex  fft_ir,
+                       float*           dest,
+                       unsigned         n_channels);
+
+Error_t
+FFTFilterConvolveBatchD(FFTConfigD*         fft,
+                        const double*       in,
+                        unsigned            in_length,
+                        FFTSplitComplexD    fft_ir,
+                        double*             dest,
+                        unsigned            n_channels);
+
+
+/** Multiply several spectra by one kernel spectrum
+ *
+ * @details Multiplies each of n_channels spectra in the FFT_IR_R2C format by
+ *          the kernel, in place. The bins are worked through in small tiles,
+ *          and every channel is multiplied by a tile before moving on to the
+ *          next, so each kernel bin is only loaded once for all the channels.
+ *
+ * @param fft           Pointer to the FFT configuration.
+ * @param spectra       Spectra to multiply, n_channels * (fft->length/2)
+ *                      values in each of realp and imagp. Channel c starts at
+ *                      c * fft->length/2.
+ * @param kernel        Kernel spectrum, transformed with FFT_IR_R2C.
+ * @param n_channels    Number of channels.
+ * @return              Error code, 0 on success.
+ */
+Error_t
+FFTSpectrumMultiplyBatch(FFTConfig*         fft,
+                         FFTSplitComplex    spectra,
+                         FFTSplitComplex    kernel,
+                         unsigned           n_channels);
+
+Error_t
+FFTSpectrumMultiplyBatchD(FFTConfigD*       fft,
+                          FFTSplitComplexD  spectra,
+                          FFTSplitComplexD  kernel,
+                          unsigned          n_channels);
+
+
 /** Just prints the complex output
  *
  */
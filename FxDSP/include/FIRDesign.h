@@ -0,0 +1,253 @@
+/**
+ * @file FIRDesign.h
+ * @author Hamilton Kibbe
+ * @copyright 2015 Hamilton Kibbe
+ */
+
+#ifndef FIRDESIGN_H_
+#define FIRDESIGN_H_
+
+#include "Error.h"
+#include "FilterTypes.h"
+#include "WindowFunction.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Grid points per extremal used by the Parks-McClellan design */
+#define FIR_DESIGN_GRID_DENSITY (16)
+
+/** Iteration limit for the Parks-McClellan exchange */
+#define FIR_DESIGN_MAX_ITERATIONS (40)
+
+
+/** FIR design method */
+typedef enum _FIRDesignMethod
+{
+    /** Ideal response truncated by the window in FIRDesignSpec.window */
+    FIR_WINDOWED_SINC,
+
+    /** Windowed sinc with a Kaiser window sized to meet the transition width
+     and stopband attenuation */
+    FIR_KAISER,
+
+    /** Parks-McClellan equiripple design */
+    FIR_EQUIRIPPLE,
+
+    /** Number of design methods */
+    N_FIR_DESIGN_METHODS
+} FIRDesignMethod_t;
+
+
+/** Filter design specification
+ *
+ * @details All frequencies are normalized to the sample rate, so 0.5 is the
+ *          nyquist frequency. Linear-phase designs with an even length have
+ *          a zero at nyquist, so HIGHPASS and NOTCH designs must be odd.
+ */
+typedef struct _FIRDesignSpec
+{
+    /** Design method */
+    FIRDesignMethod_t   method;
+
+    /** LOWPASS, HIGHPASS, BANDPASS or NOTCH */
+    Filter_t            type;
+
+    /** Cutoff, or lower band edge for BANDPASS and NOTCH */
+    double              cutoff;
+
+    /** Upper band edge for BANDPASS and NOTCH */
+    double              cutoff_high;
+
+    /** Width of each transition band, centered on the cutoff. Used by
+     FIR_KAISER and FIR_EQUIRIPPLE */
+    double              transition;
+
+    /** Stopband attenuation in dB. Used to pick the length, and the Kaiser
+     window shape */
+    double              attenuation;
+
+    /** Window used by FIR_WINDOWED_SINC */
+    Window_t            window;
+
+    /** Number of taps. 0 estimates the length needed for the transition width
+     and attenuation, which FIR_WINDOWED_SINC can't do */
+    unsigned            length;
+
+    /** Convert the design to minimum phase */
+    int                 minimum_phase;
+} FIRDesignSpec;
+
+
+/** FIRDesignCache type */
+typedef struct FIRDesignCache FIRDesignCache;
+typedef struct FIRDesignCacheD FIRDesignCacheD;
+
+
+/** Find the length of the kernel a spec will produce
+ *
+ * @param spec      The design spec.
+ * @return          The number of taps, or 0 if the spec is invalid.
+ */
+unsigned
+FIRDesignLength(const FIRDesignSpec* spec);
+
+
+/** Design a filter kernel
+ *
+ * @details Designs a kernel from a spec. The result can be passed straight to
+ *          FIRFilterInit. This allocates working memory, so don't call it from
+ *          the audio thread.
+ *
+ * @param kernel    Buffer for the kernel, FIRDesignLength(spec) samples long.
+ * @param spec      The design spec.
+ * @return          Error code, 0 on success. VALUE_ERROR if the spec is
+ *                  invalid.
+ */
+Error_t
+FIRDesign(float* kernel, const FIRDesignSpec* spec);
+
+Error_t
+FIRDesignD(double* kernel, const FIRDesignSpec* spec);
+
+
+/** Design a linear-phase kernel from samples of its magnitude response
+ *
+ * @details The gains are spaced evenly from DC to nyquist and interpolated
+ *          linearly onto the length-point DFT grid. The kernel is found by an
+ *          inverse DFT of that linear-phase response, then windowed. Even
+ *          lengths have a zero at nyquist whatever the last gain is.
+ *
+ * @param kernel    Buffer for the kernel, length samples long.
+ * @param length    Number of taps.
+ * @param gains     Linear gains from DC to nyquist.
+ * @param n_gains   Number of gains, at least 2.
+ * @param window    Window applied to the result. BOXCAR for none.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+FIRDesignFrequencySampling(float*       kernel,
+                           unsigned     length,
+                           const float* gains,
+                           unsigned     n_gains,
+                           Window_t     window);
+
+Error_t
+FIRDesignFrequencySamplingD(double*         kernel,
+                            unsigned        length,
+                            const double*   gains,
+                            unsigned        n_gains,
+                            Window_t        window);
+
+
+/** Design an equiripple kernel with the Parks-McClellan algorithm
+ *
+ * @details Finds the linear-phase kernel that minimizes the largest weighted
+ *          error over the bands. Frequencies between bands are don't-care
+ *          regions.
+ *
+ * @param kernel    Buffer for the kernel, length samples long.
+ * @param length    Number of taps.
+ * @param bands     Band edges, 2 * n_bands increasing frequencies from 0 to
+ *                  0.5.
+ * @param gains     Desired gain in each band.
+ * @param weights   Error weight in each band.
+ * @param n_bands   Number of bands.
+ * @return          Error code, 0 on success. ERROR if the exchange did not
+ *                  converge, in which case the kernel holds the last
+ *                  iteration.
+ */
+Error_t
+FIRDesignEquiripple(float*          kernel,
+                    unsigned        length,
+                    const float*    bands,
+                    const float*    gains,
+                    const float*    weights,
+                    unsigned        n_bands);
+
+Error_t
+FIRDesignEquirippleD(double*        kernel,
+                     unsigned       length,
+                     const double*  bands,
+                     const double*  gains,
+                     const double*  weights,
+                     unsigned       n_bands);
+
+
+/** Convert a kernel to minimum phase
+ *
+ * @details Finds the minimum-phase kernel with the same magnitude response
+ *          using the real cepstrum, computed with a zero-padded FFT. Zeros in
+ *          the stopband are limited to 200 dB below the peak. The energy moves
+ *          to the start of the kernel, so a linear-phase filter's latency of
+ *          half its length drops to a few samples.
+ *
+ * @param dest      Buffer for the result, length samples long. May be kernel.
+ * @param kernel    Kernel to convert.
+ * @param length    Number of taps.
+ * @return          Error code, 0 on success.
+ */
+Error_t
+FIRDesignMinimumPhase(float* dest, const float* kernel, unsigned length);
+
+Error_t
+FIRDesignMinimumPhaseD(double* dest, const double* kernel, unsigned length);
+
+
+/** Create a new FIRDesignCache
+ *
+ * @details Allocates memory and returns an initialized FIRDesignCache, which
+ *          keeps the most recently used designs so that filters sharing a
+ *          spec only design it once. Play nice and call FIRDesignCacheFree on
+ *          it when you're done. A cache is not thread safe.
+ *
+ * @param capacity  Number of kernels to keep.
+ * @return          An initialized FIRDesignCache, or NULL on failure.
+ */
+FIRDesignCache*
+FIRDesignCacheInit(unsigned capacity);
+
+FIRDesignCacheD*
+FIRDesignCacheInitD(unsigned capacity);
+
+
+/** Free memory associated with a FIRDesignCache
+ *
+ * @details release all memory allocated by FIRDesignCacheInit, including the
+ *          cached kernels.
+ *
+ * @param cache     FIRDesignCache to free
+ * @return          Error code, 0 on success
+ */
+Error_t
+FIRDesignCacheFree(FIRDesignCache* cache);
+
+Error_t
+FIRDesignCacheFreeD(FIRDesignCacheD* cache);
+
+
+/** Look up or design a kernel
+ *
+ * @details Returns the cached kernel for the spec, designing it first if it
+ *          isn't there. When the cache is full the least recently used kernel
+ *          is dropped, so the returned kernel is only valid until the next
+ *          call. Pass it to FIRFilterInit, which copies it.
+ *
+ * @param cache     The FIRDesignCache to use.
+ * @param spec      The design spec.
+ * @param length    Set to the number of taps.
+ * @return          The kernel, or NULL if the spec is invalid.
+ */
+const float*
+FIRDesignCacheGet(FIRDesignCache* cache, const FIRDesignSpec* spec, unsigned* length);
+
+const double*
+FIRDesignCacheGetD(FIRDesignCacheD* cache, const FIRDesignSpec* spec, unsigned* length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIRDESIGN_H_ */
@@ -29,7 +29,14 @@ typedef enum _ConvolutionMode
     DIRECT  = 1,
 
     /** Use FFT Convolution (Better for longer filter kernels */
-    FFT     = 2
+    FFT     = 2,
+
+    /** Use uniformly partitioned FFT convolution. The kernel is split into
+     block-sized partitions, so the cost per block grows with the number of
+     partitions rather than the whole kernel length (Best for very long
+     kernels). The block size is set by the first call to FIRFilterProcess,
+     and the output is delayed by one block. */
+    PARTITIONED = 3
 
 } ConvolutionMode_t;
 
@@ -48,7 +55,8 @@ typedef struct FIRFilterD FIRFilterD;
  * @param filter_kernel     The filter coefficients. These are copied to the
  *                          filter so there is no need to keep them around.
  * @param length            The number of coefficients in filter_kernel.
- * @param convolution_mode  Convolution algorithm. Either BEST, FFT, or DIRECT.
+ * @param convolution_mode  Convolution algorithm. Either BEST, FFT, DIRECT
+ *                          or PARTITIONED.
  * @return                  An initialized FIRFilter
  */
 FIRFilter*
@@ -88,9 +96,52 @@ Error_t
 FIRFilterFlushD(FIRFilterD* filter);
 
 
+/** Set the length of the crossfade used when the kernel changes
+ *
+ * @details When FIRFilterUpdateKernel hands over a new kernel, the filter
+ *          runs both kernels for this many samples and fades linearly from
+ *          the old output to the new one. In PARTITIONED mode both kernels
+ *          see the full input history. In DIRECT and FFT modes the new kernel
+ *          takes over the old one's tail, so the fade should be longer than
+ *          the kernel to hide that. The default of 0 switches kernels at once.
+ *
+ * @param filter    FIRFilter to configure
+ * @param n_samples Crossfade length in samples
+ * @return          Error code, 0 on success
+ */
+Error_t
+FIRFilterSetCrossfade(FIRFilter* filter, unsigned n_samples);
+
+Error_t
+FIRFilterSetCrossfadeD(FIRFilterD* filter, unsigned n_samples);
+
+
+/** Prepare a filter for a maximum block size
+ *
+ * @details Sets up the FFT, transforms the kernel and allocates all scratch
+ *          memory ahead of time. After this, FIRFilterProcess does not
+ *          allocate and uses a bounded amount of stack. Longer calls are
+ *          split into blocks of max_block_size. In PARTITIONED mode,
+ *          max_block_size becomes the partition size. Call this before
+ *          processing starts, not from the audio thread.
+ *
+ * @param filter            FIRFilter to prepare
+ * @param max_block_size    Largest number of samples processed at once
+ * @return                  Error code, 0 on success
+ */
+Error_t
+FIRFilterPrepare(FIRFilter* filter, unsigned max_block_size);
+
+Error_t
+FIRFilterPrepareD(FIRFilterD* filter, unsigned max_block_size);
+
+
 /** Filter a buffer of samples
  *
  * @details Uses either FFT or direct-form convolution to filter the samples.
+ *          In PARTITIONED mode the first call sets the partition size, and
+ *          later calls may be any length. The output lags the input by that
+ *          many samples.
  *
  * @param filter	The FIRFilter to use
  * @param outBuffer	The buffer to write the output to
@@ -114,7 +165,15 @@ FIRFilterProcessD(FIRFilterD*   filter,
 
 /** Update the filter kernel for a given filter
  *
- * @details New kernel must be the same length as the old one!
+ * @details New kernel must be the same length as the old one! The kernel
+ *          and its spectrum are prepared in a back buffer on the calling
+ *          thread, then handed over to FIRFilterProcess, which switches to it
+ *          at the start of its next block, fading between the old and new
+ *          outputs as set by FIRFilterSetCrossfade. This may be called from
+ *          another thread while audio is processed, as long as the filter
+ *          has been through FIRFilterPrepare. Nothing is allocated. Returns
+ *          ERROR if the previous kernel is still fading in, in which case the
+ *          update can be tried again later.
  *
  * @param filter		The FIRFilter to use
  * @param filter_kernel	The new filter kernel to use
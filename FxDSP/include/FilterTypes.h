@@ -46,6 +46,20 @@ typedef enum Filter_t
 }Filter_t;
 
 
+/** IIR filter processing modes */
+typedef enum IIRMode_t
+{
+    /** Run the recursion one sample at a time */
+    IIR_SERIAL,
+
+    /** Compute IIR_BLOCK_LENGTH outputs at a time in block state-space form */
+    IIR_BLOCK,
+
+    /** Number of IIR modes */
+    N_IIR_MODES
+}IIRMode_t;
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,177 @@
+/**
+ * @file HalfbandFilter.h
+ * @author Hamilton Kibbe
+ * @copyright 2015 Hamilton Kibbe
+ */
+
+#ifndef HALFBANDFILTER_H_
+#define HALFBANDFILTER_H_
+
+#include "Error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Stopband attenuation of the stages made by HalfbandFilterInitStage, in dB */
+#define HALFBAND_ATTENUATION (100.0)
+
+/** Fraction of the base rate's nyquist frequency passed by a cascade */
+#define HALFBAND_PASSBAND (0.9)
+
+
+/** Opaque HalfbandFilter object */
+typedef struct HalfbandFilter HalfbandFilter;
+typedef struct HalfbandFilterD HalfbandFilterD;
+
+
+/** Find the number of coefficients a half-band filter needs
+ *
+ * @param attenuation   Stopband attenuation in dB.
+ * @param transition    Width of the transition band, centered on a quarter of
+ *                      the higher sample rate, as a fraction of the lower
+ *                      sample rate. Between 0 and 0.5.
+ * @return              The number of allpass coefficients.
+ */
+unsigned
+HalfbandFilterOrder(double attenuation, double transition);
+
+
+/** Design a polyphase allpass half-band filter
+ *
+ * @details Computes the coefficients of an elliptic half-band lowpass built
+ *          from two parallel chains of first-order allpass sections, one for
+ *          each polyphase branch. Even-numbered coefficients belong to the
+ *          first branch and odd-numbered ones to the second.
+ *
+ * @param coefficients      Buffer for n_coefficients coefficients.
+ * @param n_coefficients    Number of coefficients. More give a sharper
+ *                          transition or more attenuation.
+ * @param transition        Transition width, as in HalfbandFilterOrder.
+ * @return                  Error code, 0 on success.
+ */
+Error_t
+HalfbandFilterDesign(double* coefficients, unsigned n_coefficients, double transition);
+
+
+/** Create a new HalfbandFilter
+ *
+ * @details Allocates memory and returns an initialized HalfbandFilter that
+ *          resamples by 2 with the given allpass coefficients. Each sample
+ *          costs one multiply per coefficient, and the delay is only a few
+ *          samples, but the phase response is not linear. Play nice and call
+ *          HalfbandFilterFree on it when you're done with it.
+ *
+ * @param coefficients      Coefficients from HalfbandFilterDesign.
+ * @param n_coefficients    Number of coefficients.
+ * @return                  An initialized HalfbandFilter, or NULL on failure.
+ */
+HalfbandFilter*
+HalfbandFilterInit(const double* coefficients, unsigned n_coefficients);
+
+HalfbandFilterD*
+HalfbandFilterInitD(const double* coefficients, unsigned n_coefficients);
+
+
+/** Create the HalfbandFilter for one stage of a 2x cascade
+ *
+ * @details Stage 0 runs at the base rate, and passes HALFBAND_PASSBAND of its
+ *          band. Stage s runs at 2^s times the base rate, where it only has
+ *          to remove images of that band, so later stages need fewer
+ *          coefficients.
+ *
+ * @param stage     Position in the cascade, from the base rate up.
+ * @return          An initialized HalfbandFilter, or NULL on failure.
+ */
+HalfbandFilter*
+HalfbandFilterInitStage(unsigned stage);
+
+HalfbandFilterD*
+HalfbandFilterInitStageD(unsigned stage);
+
+
+/** Free memory associated with a HalfbandFilter
+ *
+ * @details release all memory allocated by HalfbandFilterInit for the
+ *          supplied filter.
+ *
+ * @param filter    HalfbandFilter to free.
+ * @return          Error code, 0 on success
+ */
+Error_t
+HalfbandFilterFree(HalfbandFilter* filter);
+
+Error_t
+HalfbandFilterFreeD(HalfbandFilterD* filter);
+
+
+/** Flush filter state
+ *
+ * @param filter    HalfbandFilter to flush.
+ * @return          Error code, 0 on success
+ */
+Error_t
+HalfbandFilterFlush(HalfbandFilter* filter);
+
+Error_t
+HalfbandFilterFlushD(HalfbandFilterD* filter);
+
+
+/** Upsample a buffer by 2
+ *
+ * @details Each input sample runs through both branches, which give the two
+ *          output samples. outBuffer may overlap inBuffer as long as inBuffer
+ *          starts at or after outBuffer + n_samples, so a cascade can run in
+ *          place from the end of its output buffer.
+ *
+ * @param filter    The HalfbandFilter to use.
+ * @param outBuffer The buffer to write 2 * n_samples samples to.
+ * @param inBuffer  The buffer to upsample.
+ * @param n_samples The number of input samples.
+ * @return          Error code, 0 on success
+ */
+Error_t
+HalfbandFilterUpsample(HalfbandFilter*  filter,
+                       float*           outBuffer,
+                       const float*     inBuffer,
+                       unsigned         n_samples);
+
+Error_t
+HalfbandFilterUpsampleD(HalfbandFilterD*    filter,
+                        double*             outBuffer,
+                        const double*       inBuffer,
+                        unsigned            n_samples);
+
+
+/** Downsample a buffer by 2
+ *
+ * @details Each output averages the two branches, fed alternate input
+ *          samples. An odd sample left at the end of a block is kept for the
+ *          next call. outBuffer may be inBuffer.
+ *
+ * @param filter    The HalfbandFilter to use.
+ * @param outBuffer The buffer to write the output to.
+ * @param n_out     Set to the number of samples written.
+ * @param inBuffer  The buffer to downsample.
+ * @param n_samples The number of input samples.
+ * @return          Error code, 0 on success
+ */
+Error_t
+HalfbandFilterDownsample(HalfbandFilter*    filter,
+                         float*             outBuffer,
+                         unsigned*          n_out,
+                         const float*       inBuffer,
+                         unsigned           n_samples);
+
+Error_t
+HalfbandFilterDownsampleD(HalfbandFilterD*  filter,
+                          double*           outBuffer,
+                          unsigned*         n_out,
+                          const double*     inBuffer,
+                          unsigned          n_samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HALFBANDFILTER_H_ */
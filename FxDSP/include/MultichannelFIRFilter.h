@@ -0,0 +1,110 @@
+/**
+ * @file MultichannelFIRFilter.h
+ * @author Hamilton Kibbe
+ * @copyright 2015 Hamilton Kibbe
+ */
+
+#ifndef MULTICHANNELFIRFILTER_H_
+#define MULTICHANNELFIRFILTER_H_
+
+#include "Error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** MultichannelFIRFilter type */
+typedef struct MultichannelFIRFilter MultichannelFIRFilter;
+typedef struct MultichannelFIRFilterD MultichannelFIRFilterD;
+
+
+/** Create a new MultichannelFIRFilter
+ *
+ * @details Allocates memory and returns an initialized MultichannelFIRFilter,
+ *          which applies the same kernel to several channels. The kernel
+ *          spectrum and FFT setup are shared by all the channels, and only
+ *          the overlap is kept per channel. Each block, the kernel spectrum
+ *          is applied to every channel at once, so it is only read from
+ *          memory once however many channels there are. All memory is
+ *          allocated here, so processing does not allocate.
+ *
+ * @param filter_kernel     The filter coefficients. These are copied to the
+ *                          filter so there is no need to keep them around.
+ * @param length            The number of coefficients in filter_kernel.
+ * @param n_channels        The number of channels to filter.
+ * @param max_block_size    Largest number of samples per channel processed at
+ *                          once. Longer calls are split into blocks of this
+ *                          size.
+ * @return                  An initialized MultichannelFIRFilter, or NULL on
+ *                          failure.
+ */
+MultichannelFIRFilter*
+MultichannelFIRFilterInit(const float*  filter_kernel,
+                          unsigned      length,
+                          unsigned      n_channels,
+                          unsigned      max_block_size);
+
+MultichannelFIRFilterD*
+MultichannelFIRFilterInitD(const double*    filter_kernel,
+                           unsigned         length,
+                           unsigned         n_channels,
+                           unsigned         max_block_size);
+
+
+/** Free memory associated with a MultichannelFIRFilter
+ *
+ * @details release all memory allocated by MultichannelFIRFilterInit for the
+ *          supplied filter.
+ *
+ * @param filter    MultichannelFIRFilter to free
+ * @return          Error code, 0 on success
+ */
+Error_t
+MultichannelFIRFilterFree(MultichannelFIRFilter* filter);
+
+Error_t
+MultichannelFIRFilterFreeD(MultichannelFIRFilterD* filter);
+
+
+/** Flush the state of every channel
+ *
+ * @param filter    MultichannelFIRFilter to flush
+ * @return          Error code, 0 on success
+ */
+Error_t
+MultichannelFIRFilterFlush(MultichannelFIRFilter* filter);
+
+Error_t
+MultichannelFIRFilterFlushD(MultichannelFIRFilterD* filter);
+
+
+/** Filter a buffer of samples for every channel
+ *
+ * @details The channels are stored one after the other, each n_samples
+ *          long, so channel c starts at inBuffer + c * n_samples.
+ *
+ * @param filter    The MultichannelFIRFilter to use
+ * @param outBuffer The buffer to write the output to, in the same layout
+ * @param inBuffer  The buffer to filter
+ * @param n_samples The number of samples per channel to filter
+ * @return          Error code, 0 on success
+ */
+Error_t
+MultichannelFIRFilterProcess(MultichannelFIRFilter* filter,
+                             float*                 outBuffer,
+                             const float*           inBuffer,
+                             unsigned               n_samples);
+
+Error_t
+MultichannelFIRFilterProcessD(MultichannelFIRFilterD*   filter,
+                              double*                   outBuffer,
+                              const double*             inBuffer,
+                              unsigned                  n_samples);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MULTICHANNELFIRFILTER_H_ */
@@ -69,6 +69,12 @@ OnePoleSetCoefficients(OnePole* filter, float* beta, float* alpha);
 
 Error_t
 OnePoleSetCoefficientsD(OnePoleD* filter, double* beta, double* alpha);
+
+Error_t
+OnePoleSetMode(OnePole* filter, IIRMode_t mode);
+
+Error_t
+OnePoleSetModeD(OnePoleD* filter, IIRMode_t mode);
   
   Error_t
 OnePoleProcess(OnePole*         filter,
@@ -0,0 +1,143 @@
+/**
+ * @file Oversampler.h
+ * @author Hamilton Kibbe
+ * @copyright 2015 Hamilton Kibbe
+ */
+
+#ifndef OVERSAMPLER_H_
+#define OVERSAMPLER_H_
+
+#include "Error.h"
+#include "PolyphaseCoeffs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Samples at the oversampled rate run through the pipeline at a time. Both
+ intermediate buffers together stay well inside the L2 cache, while the
+ resamplers' per-call overhead stays small */
+#define OVERSAMPLER_BLOCK (4096)
+
+
+/** Processor run at the oversampled rate
+ *
+ * @details Has the same form as the Process functions of the library's
+ *          processors, with the processor object passed as context. Calling a
+ *          Process function through a pointer of a different type is
+ *          undefined, so wrap it in a thunk rather than casting it:
+ * @code
+ *      static Error_t cb(void* ctx, float* out, const float* in, unsigned n)
+ *      { return DiodeSaturatorProcess(ctx, out, in, n); }
+ * @endcode
+ *          and pass the processor as the context. Processors that take a
+ *          non-const input, such as LadderFilterProcess, copy the input to
+ *          the output in the thunk and process the output in place.
+ *
+ * @param context   The context given to OversamplerInit.
+ * @param outBuffer The buffer to write the output to.
+ * @param inBuffer  The oversampled input.
+ * @param n_samples The number of samples, always a multiple of the factor.
+ * @return          Error code, 0 on success
+ */
+typedef Error_t (*OversamplerCallback)(void*            context,
+                                       float*           outBuffer,
+                                       const float*     inBuffer,
+                                       unsigned         n_samples);
+
+typedef Error_t (*OversamplerCallbackD)(void*           context,
+                                        double*         outBuffer,
+                                        const double*   inBuffer,
+                                        unsigned        n_samples);
+
+
+/** Opaque Oversampler object */
+typedef struct Oversampler Oversampler;
+typedef struct OversamplerD OversamplerD;
+
+
+/** Create a new Oversampler
+ *
+ * @details Allocates memory and returns an initialized Oversampler, which runs
+ *          a processor at factor times the sample rate, so nonlinear stages
+ *          don't alias. Each call is split into sub-blocks of
+ *          OVERSAMPLER_BLOCK oversampled samples, which are upsampled,
+ *          processed and decimated in turn through preallocated buffers, so
+ *          the oversampled signal never leaves the cache. Play nice and call
+ *          OversamplerFree on it when you're done with it.
+ *
+ * @param factor    Oversampling factor.
+ * @param mode      Resampling filter.
+ * @param process   Processor to run at the oversampled rate.
+ * @param context   Passed to process on every call.
+ * @return          An initialized Oversampler, or NULL on failure.
+ */
+Oversampler*
+OversamplerInit(ResampleFactor_t    factor,
+                ResampleMode_t      mode,
+                OversamplerCallback process,
+                void*               context);
+
+OversamplerD*
+OversamplerInitD(ResampleFactor_t       factor,
+                 ResampleMode_t         mode,
+                 OversamplerCallbackD   process,
+                 void*                  context);
+
+
+/** Free memory associated with an Oversampler
+ *
+ * @details release all memory allocated by OversamplerInit for the supplied
+ *          oversampler. The processor is not freed.
+ *
+ * @param oversampler   Oversampler to free.
+ * @return              Error code, 0 on success
+ */
+Error_t
+OversamplerFree(Oversampler* oversampler);
+
+Error_t
+OversamplerFreeD(OversamplerD* oversampler);
+
+
+/** Flush the resampling filters
+ *
+ * @details The processor's own state is left alone.
+ *
+ * @param oversampler   Oversampler to flush.
+ * @return              Error code, 0 on success
+ */
+Error_t
+OversamplerFlush(Oversampler* oversampler);
+
+Error_t
+OversamplerFlushD(OversamplerD* oversampler);
+
+
+/** Process a buffer of samples at the oversampled rate
+ *
+ * @param oversampler   The Oversampler to use.
+ * @param outBuffer     The buffer to write the output to. May be inBuffer.
+ * @param inBuffer      The buffer to process.
+ * @param n_samples     The number of samples to process.
+ * @return              Error code, 0 on success. If the processor fails, its
+ *                      error is returned and the rest of the block is left
+ *                      unprocessed.
+ */
+Error_t
+OversamplerProcess(Oversampler*     oversampler,
+                   float*           outBuffer,
+                   const float*     inBuffer,
+                   unsigned         n_samples);
+
+Error_t
+OversamplerProcessD(OversamplerD*   oversampler,
+                    double*         outBuffer,
+                    const double*   inBuffer,
+                    unsigned        n_samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OVERSAMPLER_H_ */
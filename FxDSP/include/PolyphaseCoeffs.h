@@ -7,10 +7,21 @@
 #ifndef POLYPHASECOEFFS_H
 #define POLYPHASECOEFFS_H
 
+#include "Error.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Highest frequency the FIR resamplers pass, as a fraction of the base rate */
+#define RESAMPLE_PASSBAND (0.45)
+
+/** Stopband attenuation of each FIR stage, in dB */
+#define RESAMPLE_ATTENUATION (100.0)
+
+/** Taps in each polyphase component of the tabulated filters */
+#define POLYPHASE_TAPS (64)
+
 
 /** Resampling Factor constants */
 typedef enum factor
@@ -25,15 +36,145 @@ typedef enum factor
     X8,
 
     /** 16x resampling */
-    /*X16,*/
+    X16,
+
+    /** 3x resampling */
+    X3,
+
+    /** 6x resampling */
+    X6,
 
     /** number of resampling factors */
     N_FACTORS
 } ResampleFactor_t;
 
+
+/** Resampling filter constants */
+typedef enum _ResampleMode
+{
+    /** Linear-phase polyphase FIR filters. 2x, 4x and 8x run the tabulated
+     filters in PolyphaseCoeffs in a single stage. Other factors run the
+     designed cascade of RESAMPLE_FIR_CASCADE */
+    RESAMPLE_FIR = 0,
+
+    /** Cascaded half-band allpass IIR filters. Much cheaper and with only a
+     few samples of delay, but the phase response is not linear. Only for
+     factors that are powers of 2 */
+    RESAMPLE_IIR,
+
+    /** Minimum-phase polyphase FIR filters. The same magnitude response as
+     RESAMPLE_FIR, with a few samples of delay per stage instead of half the
+     filter length, but the phase response is not linear */
+    RESAMPLE_FIR_MINIMUM_PHASE,
+
+    /** Linear-phase polyphase FIR filters designed at init, in a cascade of
+     2x stages (see PolyphaseStageDesign). Cheaper than the single-stage
+     filters at high factors, but with a little more delay */
+    RESAMPLE_FIR_CASCADE,
+
+    /** Number of resampling modes */
+    N_RESAMPLE_MODES
+} ResampleMode_t;
+
+
+/** Tabulated polyphase components of the RESAMPLE_FIR filters
+ *
+ * @details PolyphaseCoeffs[factor][p] holds the POLYPHASE_TAPS taps of
+ *          polyphase component p. Only X2, X4 and X8 have tables, the other
+ *          factors are NULL.
+ */
 extern const float** PolyphaseCoeffs[N_FACTORS];
 extern const double** PolyphaseCoeffsD[N_FACTORS];
 
+
+
+/** Find the number a resampling factor stands for
+ *
+ * @param factor    Resampling factor.
+ * @return          The factor, or 0 if it isn't valid.
+ */
+unsigned
+ResampleFactorValue(ResampleFactor_t factor);
+
+
+/** Find the number of stages the designed cascade splits a factor into
+ *
+ * @details The cascade resamples in stages of 2x, with a 3x stage first for
+ *          factors of 3. The first stage runs at the base rate and has the
+ *          sharpest filter. Later stages only have to remove the images of
+ *          the band the first one passed, so their filters are short.
+ *
+ * @param factor    Resampling factor.
+ * @return          The number of stages, or 0 if the factor isn't valid.
+ */
+unsigned
+ResampleStageCount(ResampleFactor_t factor);
+
+
+/** Find the factor of one stage
+ *
+ * @param factor    Resampling factor.
+ * @param stage     Stage, counted from the base rate up.
+ * @return          The stage's factor, or 0 if the stage doesn't exist.
+ */
+unsigned
+ResampleStageFactor(ResampleFactor_t factor, unsigned stage);
+
+
+/** Find the number of taps in each polyphase component of a stage
+ *
+ * @param factor    Resampling factor.
+ * @param stage     Stage, counted from the base rate up.
+ * @return          Taps per component, or 0 if the stage doesn't exist.
+ */
+unsigned
+PolyphaseStageTaps(ResampleFactor_t factor, unsigned stage);
+
+
+/** Design the anti-imaging filter of a stage
+ *
+ * @details Designs a Kaiser-windowed lowpass at the stage's higher rate, that
+ *          passes RESAMPLE_PASSBAND of the base rate and has
+ *          RESAMPLE_ATTENUATION dB of attenuation from the first image of
+ *          that band. Tap k * stage_factor + p belongs to polyphase component
+ *          p. The gain at DC is 1. This allocates working memory, so don't
+ *          call it from the audio thread.
+ *
+ * @param kernel        Buffer for ResampleStageFactor * PolyphaseStageTaps
+ *                      taps.
+ * @param factor        Resampling factor.
+ * @param stage         Stage, counted from the base rate up.
+ * @param minimum_phase Convert the design to minimum phase if nonzero.
+ * @return              Error code, 0 on success.
+ */
+Error_t
+PolyphaseStageDesign(float*             kernel,
+                     ResampleFactor_t   factor,
+                     unsigned           stage,
+                     int                minimum_phase);
+
+Error_t
+PolyphaseStageDesignD(double*           kernel,
+                      ResampleFactor_t  factor,
+                      unsigned          stage,
+                      int               minimum_phase);
+
+
+/** Copy a tabulated filter into a prototype
+ *
+ * @details Tap k * factor + p of the prototype is tap k of polyphase component
+ *          p, as in PolyphaseStageDesign.
+ *
+ * @param kernel    Buffer for ResampleFactorValue * POLYPHASE_TAPS taps.
+ * @param factor    Resampling factor.
+ * @return          Error code, VALUE_ERROR if the factor has no table.
+ */
+Error_t
+PolyphaseTableKernel(float* kernel, ResampleFactor_t factor);
+
+Error_t
+PolyphaseTableKernelD(double* kernel, ResampleFactor_t factor);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,209 @@
+/**
+ * @file Resampler.h
+ * @author Hamilton Kibbe
+ * @copyright 2015 Hamilton Kibbe
+ */
+
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include "Error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Input samples copied into the working buffer at a time */
+#define RESAMPLER_BLOCK_SIZE (1024)
+
+
+/** Resampler quality presets */
+typedef enum _ResamplerQuality
+{
+    /** 60 dB stopband, flat to 40% of the lower sample rate */
+    RESAMPLER_LOW,
+
+    /** 90 dB stopband, flat to 43% of the lower sample rate */
+    RESAMPLER_MEDIUM,
+
+    /** 120 dB stopband, flat to 45% of the lower sample rate */
+    RESAMPLER_HIGH,
+
+    /** Number of quality presets */
+    N_RESAMPLER_QUALITIES
+} ResamplerQuality_t;
+
+
+/** Opaque Resampler object */
+typedef struct Resampler Resampler;
+typedef struct ResamplerD ResamplerD;
+
+
+/** Create a new Resampler
+ *
+ * @details Allocates memory and returns an initialized Resampler that
+ *          converts between any two sample rates, such as 44100 and 48000.
+ *          The anti-aliasing filter is designed for the ratio, and stored as
+ *          a table of polyphase components. Outputs that fall between two
+ *          components are linearly interpolated between them. Higher quality
+ *          presets use more taps and more components. Play nice and call
+ *          ResamplerFree on it when you're done with it.
+ *
+ * @param input_rate    Input sample rate.
+ * @param output_rate   Output sample rate.
+ * @param quality       Quality preset.
+ * @return              An initialized Resampler, or NULL if the rates are
+ *                      not positive or the quality is invalid.
+ */
+Resampler*
+ResamplerInit(double input_rate, double output_rate, ResamplerQuality_t quality);
+
+ResamplerD*
+ResamplerInitD(double input_rate, double output_rate, ResamplerQuality_t quality);
+
+
+/** Free memory associated with a Resampler
+ *
+ * @details release all memory allocated by ResamplerInit for the
+ *          supplied resampler.
+ *
+ * @param resampler Resampler to free.
+ * @return          Error code, 0 on success
+ */
+Error_t
+ResamplerFree(Resampler* resampler);
+
+Error_t
+ResamplerFreeD(ResamplerD* resampler);
+
+
+/** Flush resampler state
+ *
+ * @param resampler Resampler to flush.
+ * @return          Error code, 0 on success
+ */
+Error_t
+ResamplerFlush(Resampler* resampler);
+
+Error_t
+ResamplerFlushD(ResamplerD* resampler);
+
+
+/** Find the most output samples a block of input can produce
+ *
+ * @param resampler The Resampler to use.
+ * @param n_samples Number of input samples.
+ * @return          The size of output buffer needed by ResamplerProcess at
+ *                  the current ratio.
+ */
+unsigned
+ResamplerMaxOutput(const Resampler* resampler, unsigned n_samples);
+
+unsigned
+ResamplerMaxOutputD(const ResamplerD* resampler, unsigned n_samples);
+
+
+/** Find the delay of the resampler
+ *
+ * @param resampler The Resampler to use.
+ * @return          Delay in input samples.
+ */
+double
+ResamplerLatency(const Resampler* resampler);
+
+double
+ResamplerLatencyD(const ResamplerD* resampler);
+
+
+/** Change the conversion ratio
+ *
+ * @details Takes effect from the next output sample. The position of the
+ *          outputs carries on from where it was, so the ratio can be changed
+ *          every block without a discontinuity, for example to follow clock
+ *          drift. The anti-aliasing filter is still the one designed for the
+ *          ratio given at init, so keep changes small when downsampling.
+ *
+ * @param resampler The Resampler to use.
+ * @param ratio     Output samples per input sample.
+ * @return          Error code, 0 on success. VALUE_ERROR if the ratio is not
+ *                  positive.
+ */
+Error_t
+ResamplerSetRatio(Resampler* resampler, double ratio);
+
+Error_t
+ResamplerSetRatioD(ResamplerD* resampler, double ratio);
+
+
+/** Find the number of input samples needed for a number of outputs
+ *
+ * @param resampler The Resampler to use.
+ * @param n_out     Number of output samples wanted.
+ * @return          The number of input samples ResamplerProcessOutput will
+ *                  read.
+ */
+unsigned
+ResamplerInputNeeded(const Resampler* resampler, unsigned n_out);
+
+unsigned
+ResamplerInputNeededD(const ResamplerD* resampler, unsigned n_out);
+
+
+/** Resample a buffer of samples
+ *
+ * @details Consumes all of the input and writes every output sample that is
+ *          due, so the number of outputs varies from call to call. Input
+ *          blocks can be any size.
+ *
+ * @param resampler The Resampler to use.
+ * @param outBuffer The buffer to write the output to. Must hold
+ *                  ResamplerMaxOutput(resampler, n_samples) samples.
+ * @param n_out     Set to the number of samples written.
+ * @param inBuffer  The buffer to resample.
+ * @param n_samples The number of input samples.
+ * @return          Error code, 0 on success
+ */
+Error_t
+ResamplerProcess(Resampler*     resampler,
+                 float*         outBuffer,
+                 unsigned*      n_out,
+                 const float*   inBuffer,
+                 unsigned       n_samples);
+
+Error_t
+ResamplerProcessD(ResamplerD*   resampler,
+                  double*       outBuffer,
+                  unsigned*     n_out,
+                  const double* inBuffer,
+                  unsigned      n_samples);
+
+
+/** Resample to a fixed number of output samples
+ *
+ * @details Pulls exactly n_out samples, reading as much input as they need.
+ *          Use this when the output side runs on a fixed block size.
+ *
+ * @param resampler The Resampler to use.
+ * @param outBuffer The buffer to write n_out samples to.
+ * @param n_out     The number of output samples.
+ * @param inBuffer  The input. Must hold ResamplerInputNeeded(resampler, n_out)
+ *                  samples, all of which are consumed.
+ * @return          Error code, 0 on success
+ */
+Error_t
+ResamplerProcessOutput(Resampler*   resampler,
+                       float*       outBuffer,
+                       unsigned     n_out,
+                       const float* inBuffer);
+
+Error_t
+ResamplerProcessOutputD(ResamplerD*     resampler,
+                        double*         outBuffer,
+                        unsigned        n_out,
+                        const double*   inBuffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RESAMPLER_H_ */
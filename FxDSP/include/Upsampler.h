@@ -23,7 +23,10 @@ typedef struct UpsamplerD UpsamplerD;
  *
  * @details Allocates memory and returns an initialized Upsampler with
  *          a given upsampling factor. Play nice and call UpsamplerFree
- *          on the filter whenyou're done with it.
+ *          on the filter whenyou're done with it. 2x, 4x and 8x use the
+ *          tabulated filters in PolyphaseCoeffs. Other factors run as a
+ *          cascade of smaller stages, each filtered with coefficients
+ *          designed here (see PolyphaseStageDesign).
  *
  * @param factor    Upsampling factor
  * @return          An initialized Upsampler
@@ -35,6 +38,27 @@ UpsamplerD*
 UpsamplerInitD(ResampleFactor_t factor);
 
 
+/** Create a new Upsampler with a choice of filter
+ *
+ * @details As UpsamplerInit, which uses RESAMPLE_FIR. RESAMPLE_IIR upsamples
+ *          with a cascade of 2x HalfbandFilter stages instead, for a few
+ *          multiplies per sample and a delay of a few samples. It only
+ *          supports factors that are powers of 2, and returns NULL otherwise.
+ *          RESAMPLE_FIR_MINIMUM_PHASE keeps the FIR magnitude response but
+ *          cuts the delay of each stage to a few samples.
+ *          RESAMPLE_FIR_CASCADE runs the designed cascade for every factor.
+ *
+ * @param factor    Upsampling factor
+ * @param mode      Resampling filter
+ * @return          An initialized Upsampler
+ */
+Upsampler*
+UpsamplerInitMode(ResampleFactor_t factor, ResampleMode_t mode);
+
+UpsamplerD*
+UpsamplerInitModeD(ResampleFactor_t factor, ResampleMode_t mode);
+
+
 /** Free memory associated with a Upsampler
  *
  * @details release all memory allocated by Upsampler for the
@@ -63,7 +87,11 @@ UpsamplerFlushD(UpsamplerD* upsampler);
 
 /** Upsample a buffer of samples
  *
- * @details Upsamples given buffer using sinc interpolation
+ * @details Upsamples given buffer using sinc interpolation. The polyphase
+ *          components share one input history and the outputs are written
+ *          interleaved in a single pass, with the gain of factor folded into
+ *          the coefficients. outBuffer holds n_samples * factor samples, and
+ *          can't be inBuffer.
  *
  * @param upsampler The Upsampler to use
  * @param outBuffer The buffer to write the output to
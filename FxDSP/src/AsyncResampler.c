@@ -0,0 +1,497 @@
+/*
+ * AsyncResampler.c
+ * Hamilton Kibbe
+ * Copyright 2015 Hamilton Kibbe
+ */
+
+#include "AsyncResampler.h"
+#include "Dsp.h"
+#include "Utilities.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+
+/* Queue indices count every sample written or read, and each is only stored
+ by one side. Release ordering makes the samples copied before a store visible
+ after the other side's load */
+#define FIFO_LOAD(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define FIFO_STORE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+
+/* Servo state, shared by both precisions */
+typedef struct _FillServo
+{
+    double      ratio;          // Nominal output samples per input sample
+    double      target;         // Fill level to hold, in input samples
+    double      kp;             // Proportional gain, per input sample
+    double      ki;             // Integral gain, per input sample second
+    double      output_rate;
+    double      error;          // Smoothed fill error
+    double      integral;       // Integrated fill error
+    double      correction;     // Relative change to the input step
+} FillServo;
+
+
+/* Static Function Prototypes */
+static unsigned
+queue_block(double ratio, unsigned max_block);
+
+static void
+servo_init(FillServo* servo, double input_rate, double output_rate, double target);
+
+static double
+servo_update(FillServo* servo, unsigned fill, unsigned n_samples);
+
+static void
+fifo_read(AsyncResampler* resampler, float* dest, unsigned n_samples);
+
+static void
+fifo_readD(AsyncResamplerD* resampler, double* dest, unsigned n_samples);
+
+static unsigned
+skip(AsyncResampler* resampler, unsigned n_samples);
+
+static unsigned
+skipD(AsyncResamplerD* resampler, unsigned n_samples);
+
+
+/* AsyncResampler ******************************************************/
+struct AsyncResampler
+{
+    Resampler*      resampler;
+    float*          queue;
+    unsigned        queue_mask;     // Queue length - 1, a power of two
+    unsigned        write_index;    // Samples written, only stored by Write
+    unsigned        read_index;     // Samples read, only stored by Read
+    float*          scratch;        // Input for one read
+    unsigned        block;          // Samples scratch can hold
+    unsigned        capacity;       // Samples the queue can hold
+    int             running;        // Set once the queue first reaches its target
+    FillServo       servo;
+};
+
+struct AsyncResamplerD
+{
+    ResamplerD*         resampler;
+    double*             queue;
+    unsigned            queue_mask;
+    unsigned            write_index;
+    unsigned            read_index;
+    double*             scratch;
+    unsigned            block;
+    unsigned            capacity;
+    int                 running;
+    FillServo           servo;
+};
+
+
+/* AsyncResamplerInit **************************************************/
+AsyncResampler*
+AsyncResamplerInit(double               input_rate,
+                   double               output_rate,
+                   unsigned             max_block,
+                   ResamplerQuality_t   quality)
+{
+    if (input_rate <= 0.0 || output_rate <= 0.0 || max_block == 0)
+    {
+        return NULL;
+    }
+
+    // The queue holds two blocks at its target, and room for two more
+    const unsigned block = queue_block(output_rate / input_rate, max_block);
+
+    // Allocate memory for the resampler
+    AsyncResampler* async = (AsyncResampler*)malloc(sizeof(AsyncResampler));
+
+    // Allocate the queue, and space for one read's worth of input
+    Resampler* resampler = ResamplerInit(input_rate, output_rate, quality);
+    const unsigned queue_length = next_pow2(4 * block);
+    float* queue = (float*)malloc(queue_length * sizeof(float));
+    float* scratch = (float*)malloc(block * sizeof(float));
+
+    if (async && resampler && queue && scratch)
+    {
+        async->resampler = resampler;
+        async->queue = queue;
+        async->queue_mask = queue_length - 1;
+        async->write_index = 0;
+        async->read_index = 0;
+        async->scratch = scratch;
+        async->block = block;
+        async->capacity = 4 * block;
+        servo_init(&async->servo, input_rate, output_rate, 2 * block);
+        AsyncResamplerFlush(async);
+        return async;
+    }
+    else
+    {
+        if (scratch)
+        {
+            free(scratch);
+        }
+        if (queue)
+        {
+            free(queue);
+        }
+        if (resampler)
+        {
+            ResamplerFree(resampler);
+        }
+        if (async)
+        {
+            free(async);
+        }
+        return NULL;
+    }
+}
+
+AsyncResamplerD*
+AsyncResamplerInitD(double              input_rate,
+                    double              output_rate,
+                    unsigned            max_block,
+                    ResamplerQuality_t  quality)
+{
+    if (input_rate <= 0.0 || output_rate <= 0.0 || max_block == 0)
+    {
+        return NULL;
+    }
+
+    const unsigned block = queue_block(output_rate / input_rate, max_block);
+
+    // Allocate memory for the resampler
+    AsyncResamplerD* async = (AsyncResamplerD*)malloc(sizeof(AsyncResamplerD));
+
+    // Allocate the queue, and space for one read's worth of input
+    ResamplerD* resampler = ResamplerInitD(input_rate, output_rate, quality);
+    const unsigned queue_length = next_pow2(4 * block);
+    double* queue = (double*)malloc(queue_length * sizeof(double));
+    double* scratch = (double*)malloc(block * sizeof(double));
+
+    if (async && resampler && queue && scratch)
+    {
+        async->resampler = resampler;
+        async->queue = queue;
+        async->queue_mask = queue_length - 1;
+        async->write_index = 0;
+        async->read_index = 0;
+        async->scratch = scratch;
+        async->block = block;
+        async->capacity = 4 * block;
+        servo_init(&async->servo, input_rate, output_rate, 2 * block);
+        AsyncResamplerFlushD(async);
+        return async;
+    }
+    else
+    {
+        if (scratch)
+        {
+            free(scratch);
+        }
+        if (queue)
+        {
+            free(queue);
+        }
+        if (resampler)
+        {
+            ResamplerFreeD(resampler);
+        }
+        if (async)
+        {
+            free(async);
+        }
+        return NULL;
+    }
+}
+
+
+/* AsyncResamplerFree **************************************************/
+Error_t
+AsyncResamplerFree(AsyncResampler* resampler)
+{
+    if (resampler)
+    {
+        ResamplerFree(resampler->resampler);
+        if (resampler->queue)
+        {
+            free(resampler->queue);
+        }
+        if (resampler->scratch)
+        {
+            free(resampler->scratch);
+        }
+        free(resampler);
+    }
+    return NOERR;
+}
+
+Error_t
+AsyncResamplerFreeD(AsyncResamplerD* resampler)
+{
+    if (resampler)
+    {
+        ResamplerFreeD(resampler->resampler);
+        if (resampler->queue)
+        {
+            free(resampler->queue);
+        }
+        if (resampler->scratch)
+        {
+            free(resampler->scratch);
+        }
+        free(resampler);
+    }
+    return NOERR;
+}
+
+
+/* AsyncResamplerFlush *************************************************/
+Error_t
+AsyncResamplerFlush(AsyncResampler* resampler)
+{
+    ResamplerFlush(resampler->resampler);
+    FIFO_STORE(&resampler->read_index, FIFO_LOAD(&resampler->write_index));
+    resampler->running = 0;
+    resampler->servo.error = 0.0;
+    return NOERR;
+}
+
+Error_t
+AsyncResamplerFlushD(AsyncResamplerD* resampler)
+{
+    ResamplerFlushD(resampler->resampler);
+    FIFO_STORE(&resampler->read_index, FIFO_LOAD(&resampler->write_index));
+    resampler->running = 0;
+    resampler->servo.error = 0.0;
+    return NOERR;
+}
+
+
+/* AsyncResamplerWrite *************************************************/
+Error_t
+AsyncResamplerWrite(AsyncResampler* resampler,
+                    const float*    inBuffer,
+                    unsigned        n_samples)
+{
+    const unsigned index = resampler->write_index;
+    if (index - FIFO_LOAD(&resampler->read_index) + n_samples > resampler->capacity)
+    {
+        return VALUE_ERROR;
+    }
+
+    // Copy the samples in, then publish them
+    const unsigned start = index & resampler->queue_mask;
+    unsigned first = resampler->queue_mask + 1 - start;
+    if (first > n_samples)
+    {
+        first = n_samples;
+    }
+    CopyBuffer(resampler->queue + start, inBuffer, first);
+    CopyBuffer(resampler->queue, inBuffer + first, n_samples - first);
+    FIFO_STORE(&resampler->write_index, index + n_samples);
+    return NOERR;
+}
+
+Error_t
+AsyncResamplerWriteD(AsyncResamplerD*   resampler,
+                     const double*      inBuffer,
+                     unsigned           n_samples)
+{
+    const unsigned index = resampler->write_index;
+    if (index - FIFO_LOAD(&resampler->read_index) + n_samples > resampler->capacity)
+    {
+        return VALUE_ERROR;
+    }
+
+    // Copy the samples in, then publish them
+    const unsigned start = index & resampler->queue_mask;
+    unsigned first = resampler->queue_mask + 1 - start;
+    if (first > n_samples)
+    {
+        first = n_samples;
+    }
+    CopyBufferD(resampler->queue + start, inBuffer, first);
+    CopyBufferD(resampler->queue, inBuffer + first, n_samples - first);
+    FIFO_STORE(&resampler->write_index, index + n_samples);
+    return NOERR;
+}
+
+
+/* AsyncResamplerRead **************************************************/
+Error_t
+AsyncResamplerRead(AsyncResampler* resampler, float* outBuffer, unsigned n_samples)
+{
+    unsigned fill = FIFO_LOAD(&resampler->write_index) - resampler->read_index;
+    if (!resampler->running)
+    {
+        // Wait for the queue to reach its target, and start from exactly it
+        if (fill < resampler->servo.target)
+        {
+            ClearBuffer(outBuffer, n_samples);
+            return NOERR;
+        }
+        fill = skip(resampler, fill - (unsigned)resampler->servo.target);
+        resampler->running = 1;
+    }
+
+    ResamplerSetRatio(resampler->resampler,
+                      servo_update(&resampler->servo, fill, n_samples));
+    const unsigned n_in = ResamplerInputNeeded(resampler->resampler, n_samples);
+    if (n_in > fill)
+    {
+        resampler->running = 0;
+        ClearBuffer(outBuffer, n_samples);
+        return VALUE_ERROR;
+    }
+
+    fifo_read(resampler, resampler->scratch, n_in);
+    return ResamplerProcessOutput(resampler->resampler, outBuffer, n_samples,
+                                  resampler->scratch);
+}
+
+Error_t
+AsyncResamplerReadD(AsyncResamplerD* resampler, double* outBuffer, unsigned n_samples)
+{
+    unsigned fill = FIFO_LOAD(&resampler->write_index) - resampler->read_index;
+    if (!resampler->running)
+    {
+        // Wait for the queue to reach its target, and start from exactly it
+        if (fill < resampler->servo.target)
+        {
+            ClearBufferD(outBuffer, n_samples);
+            return NOERR;
+        }
+        fill = skipD(resampler, fill - (unsigned)resampler->servo.target);
+        resampler->running = 1;
+    }
+
+    ResamplerSetRatioD(resampler->resampler,
+                       servo_update(&resampler->servo, fill, n_samples));
+    const unsigned n_in = ResamplerInputNeededD(resampler->resampler, n_samples);
+    if (n_in > fill)
+    {
+        resampler->running = 0;
+        ClearBufferD(outBuffer, n_samples);
+        return VALUE_ERROR;
+    }
+
+    fifo_readD(resampler, resampler->scratch, n_in);
+    return ResamplerProcessOutputD(resampler->resampler, outBuffer, n_samples,
+                                   resampler->scratch);
+}
+
+
+/* AsyncResamplerRatio *************************************************/
+double
+AsyncResamplerRatio(const AsyncResampler* resampler)
+{
+    return resampler->servo.ratio / (1.0 + resampler->servo.correction);
+}
+
+double
+AsyncResamplerRatioD(const AsyncResamplerD* resampler)
+{
+    return resampler->servo.ratio / (1.0 + resampler->servo.correction);
+}
+
+
+/* STATIC FUNCTION DEFINITIONS */
+
+/* Input samples in a block: enough for either side's largest block, at the
+ slowest the servo can run */
+static unsigned
+queue_block(double ratio, unsigned max_block)
+{
+    const double step = (1.0 + ASYNC_RESAMPLER_MAX_CORRECTION) / ratio;
+    const unsigned n_in = (unsigned)ceil(max_block * step) + 2;
+    return (n_in > max_block) ? n_in : max_block;
+}
+
+/* The gains give a critically damped loop with the time constant
+ ASYNC_RESAMPLER_TIME_CONSTANT. The fill level is smoothed over a quarter of
+ that, so the sawtooth from mismatched block sizes doesn't modulate the ratio */
+static void
+servo_init(FillServo* servo, double input_rate, double output_rate, double target)
+{
+    const double tc = ASYNC_RESAMPLER_TIME_CONSTANT;
+    servo->ratio = output_rate / input_rate;
+    servo->target = target;
+    servo->kp = 1.0 / (tc * input_rate);
+    servo->ki = servo->kp / (4.0 * tc);
+    servo->output_rate = output_rate;
+    servo->error = 0.0;
+    servo->integral = 0.0;
+    servo->correction = 0.0;
+}
+
+/* Update the correction from the fill level before a read of n_samples, and
+ return the ratio to use for it. A queue that is too full is drained by
+ reading the input faster */
+static double
+servo_update(FillServo* servo, unsigned fill, unsigned n_samples)
+{
+    const double dt = n_samples / servo->output_rate;
+    const double smoothing = dt / (0.25 * ASYNC_RESAMPLER_TIME_CONSTANT + dt);
+    servo->error += smoothing * ((double)fill - servo->target - servo->error);
+
+    // Only integrate while the correction isn't clamped, so it can't wind up
+    const double integral = servo->integral + servo->error * dt;
+    double correction = servo->kp * servo->error + servo->ki * integral;
+    if (fabs(correction) < ASYNC_RESAMPLER_MAX_CORRECTION)
+    {
+        servo->integral = integral;
+    }
+    else
+    {
+        correction = copysign(ASYNC_RESAMPLER_MAX_CORRECTION, correction);
+    }
+
+    servo->correction = correction;
+    return servo->ratio / (1.0 + correction);
+}
+
+/* Copy queued input out, then hand the space back to Write */
+static void
+fifo_read(AsyncResampler* resampler, float* dest, unsigned n_samples)
+{
+    const unsigned index = resampler->read_index;
+    const unsigned start = index & resampler->queue_mask;
+    unsigned first = resampler->queue_mask + 1 - start;
+    if (first > n_samples)
+    {
+        first = n_samples;
+    }
+    CopyBuffer(dest, resampler->queue + start, first);
+    CopyBuffer(dest + first, resampler->queue, n_samples - first);
+    FIFO_STORE(&resampler->read_index, index + n_samples);
+}
+
+static void
+fifo_readD(AsyncResamplerD* resampler, double* dest, unsigned n_samples)
+{
+    const unsigned index = resampler->read_index;
+    const unsigned start = index & resampler->queue_mask;
+    unsigned first = resampler->queue_mask + 1 - start;
+    if (first > n_samples)
+    {
+        first = n_samples;
+    }
+    CopyBufferD(dest, resampler->queue + start, first);
+    CopyBufferD(dest + first, resampler->queue, n_samples - first);
+    FIFO_STORE(&resampler->read_index, index + n_samples);
+}
+
+/* Drop queued input, returning the fill level left */
+static unsigned
+skip(AsyncResampler* resampler, unsigned n_samples)
+{
+    FIFO_STORE(&resampler->read_index, resampler->read_index + n_samples);
+    return FIFO_LOAD(&resampler->write_index) - resampler->read_index;
+}
+
+static unsigned
+skipD(AsyncResamplerD* resampler, unsigned n_samples)
+{
+    FIFO_STORE(&resampler->read_index, resampler->read_index + n_samples);
+    return FIFO_LOAD(&resampler->write_index) - resampler->read_index;
+}
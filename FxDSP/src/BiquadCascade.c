@@ -0,0 +1,781 @@
+/*
+ * BiquadCascade.c
+ * Hamilton Kibbe
+ * Copyright 2015 Hamilton Kibbe
+ */
+
+#include "BiquadCascade.h"
+#include "Dsp.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+/* The sections of a group of channels run with SIMD kernels that filter one
+ sample of every channel in the group at once. On x86 the AVX kernel is picked
+ at run time when the CPU supports it, with SSE2 as the baseline */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__SSE2__))
+#include <immintrin.h>
+#define CASCADE_X86
+#define CASCADE_HAS_AVX() (__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma"))
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CASCADE_NEON
+#endif
+
+/* Channels in a group */
+#define CASCADE_LANES (8)
+#define CASCADE_LANESD (4)
+
+/* Samples per channel filtered through every section at a time */
+#define CASCADE_BLOCK (64)
+
+/* Coefficients and state per section, each CASCADE_LANES wide */
+#define N_COEFFS (5)    // b0, b1, b2, a1, a2
+#define N_STATES (2)    // w0, w1
+
+
+/* Static Function Prototypes */
+static void
+gather(float* dest, const float* src, unsigned first, unsigned n_channels,
+       unsigned stride, unsigned n_samples);
+
+static void
+gatherD(double* dest, const double* src, unsigned first, unsigned n_channels,
+        unsigned stride, unsigned n_samples);
+
+static void
+scatter(float* dest, const float* src, unsigned first, unsigned n_channels,
+        unsigned stride, unsigned n_samples);
+
+static void
+scatterD(double* dest, const double* src, unsigned first, unsigned n_channels,
+         unsigned stride, unsigned n_samples);
+
+static void
+run_sections(float* buffer, unsigned n_samples, const float* coeffs,
+             float* state, unsigned n_sections);
+
+static void
+run_sectionsD(double* buffer, unsigned n_samples, const double* coeffs,
+              double* state, unsigned n_sections);
+
+#ifdef CASCADE_X86
+__attribute__((target("avx,fma"))) static void
+sections_avx(float* buffer, unsigned n_samples, const float* coeffs,
+             float* state, unsigned n_sections);
+
+__attribute__((target("avx,fma"))) static void
+sections_avxD(double* buffer, unsigned n_samples, const double* coeffs,
+              double* state, unsigned n_sections);
+
+static void
+sections_sse(float* buffer, unsigned n_samples, const float* coeffs,
+             float* state, unsigned n_sections);
+
+static void
+sections_sseD(double* buffer, unsigned n_samples, const double* coeffs,
+              double* state, unsigned n_sections);
+
+#elif defined(CASCADE_NEON)
+static void
+sections_neon(float* buffer, unsigned n_samples, const float* coeffs,
+              float* state, unsigned n_sections);
+
+static void
+sections_neonD(double* buffer, unsigned n_samples, const double* coeffs,
+               double* state, unsigned n_sections);
+#endif
+
+
+/* BiquadCascade *******************************************************/
+struct BiquadCascade
+{
+    unsigned    n_sections;
+    unsigned    n_channels;
+    unsigned    n_groups;
+    float*      coeffs;     // Per group and section, N_COEFFS x CASCADE_LANES
+    float*      state;      // Per group and section, N_STATES x CASCADE_LANES
+    float*      scratch;    // One block of a group, interleaved by channel
+};
+
+struct BiquadCascadeD
+{
+    unsigned    n_sections;
+    unsigned    n_channels;
+    unsigned    n_groups;
+    double*     coeffs;
+    double*     state;
+    double*     scratch;
+};
+
+
+/* BiquadCascadeInit ***************************************************/
+BiquadCascade*
+BiquadCascadeInit(unsigned n_sections, unsigned n_channels)
+{
+    if (n_sections == 0 || n_channels == 0)
+    {
+        return NULL;
+    }
+    const unsigned n_groups = (n_channels + CASCADE_LANES - 1) / CASCADE_LANES;
+    const unsigned n_blocks = n_groups * n_sections;
+
+    // Allocate memory for the cascade
+    BiquadCascade* cascade = (BiquadCascade*)malloc(sizeof(BiquadCascade));
+
+    // Allocate the coefficients, state and scratch buffer
+    float* coeffs = (float*)malloc(n_blocks * N_COEFFS * CASCADE_LANES * sizeof(float));
+    float* state = (float*)malloc(n_blocks * N_STATES * CASCADE_LANES * sizeof(float));
+    float* scratch = (float*)malloc(CASCADE_BLOCK * CASCADE_LANES * sizeof(float));
+
+    if (cascade && coeffs && state && scratch)
+    {
+        // Every section passes its input through
+        ClearBuffer(coeffs, n_blocks * N_COEFFS * CASCADE_LANES);
+        for (unsigned i = 0; i < n_blocks; ++i)
+        {
+            FillBuffer(coeffs + i * N_COEFFS * CASCADE_LANES, CASCADE_LANES, 1.0);
+        }
+
+        cascade->n_sections = n_sections;
+        cascade->n_channels = n_channels;
+        cascade->n_groups = n_groups;
+        cascade->coeffs = coeffs;
+        cascade->state = state;
+        cascade->scratch = scratch;
+        BiquadCascadeFlush(cascade);
+        return cascade;
+    }
+    else
+    {
+        if (scratch)
+        {
+            free(scratch);
+        }
+        if (state)
+        {
+            free(state);
+        }
+        if (coeffs)
+        {
+            free(coeffs);
+        }
+        if (cascade)
+        {
+            free(cascade);
+        }
+        return NULL;
+    }
+}
+
+BiquadCascadeD*
+BiquadCascadeInitD(unsigned n_sections, unsigned n_channels)
+{
+    if (n_sections == 0 || n_channels == 0)
+    {
+        return NULL;
+    }
+    const unsigned n_groups = (n_channels + CASCADE_LANESD - 1) / CASCADE_LANESD;
+    const unsigned n_blocks = n_groups * n_sections;
+
+    // Allocate memory for the cascade
+    BiquadCascadeD* cascade = (BiquadCascadeD*)malloc(sizeof(BiquadCascadeD));
+
+    // Allocate the coefficients, state and scratch buffer
+    double* coeffs = (double*)malloc(n_blocks * N_COEFFS * CASCADE_LANESD * sizeof(double));
+    double* state = (double*)malloc(n_blocks * N_STATES * CASCADE_LANESD * sizeof(double));
+    double* scratch = (double*)malloc(CASCADE_BLOCK * CASCADE_LANESD * sizeof(double));
+
+    if (cascade && coeffs && state && scratch)
+    {
+        // Every section passes its input through
+        ClearBufferD(coeffs, n_blocks * N_COEFFS * CASCADE_LANESD);
+        for (unsigned i = 0; i < n_blocks; ++i)
+        {
+            FillBufferD(coeffs + i * N_COEFFS * CASCADE_LANESD, CASCADE_LANESD, 1.0);
+        }
+
+        cascade->n_sections = n_sections;
+        cascade->n_channels = n_channels;
+        cascade->n_groups = n_groups;
+        cascade->coeffs = coeffs;
+        cascade->state = state;
+        cascade->scratch = scratch;
+        BiquadCascadeFlushD(cascade);
+        return cascade;
+    }
+    else
+    {
+        if (scratch)
+        {
+            free(scratch);
+        }
+        if (state)
+        {
+            free(state);
+        }
+        if (coeffs)
+        {
+            free(coeffs);
+        }
+        if (cascade)
+        {
+            free(cascade);
+        }
+        return NULL;
+    }
+}
+
+
+/* BiquadCascadeFree ***************************************************/
+Error_t
+BiquadCascadeFree(BiquadCascade* cascade)
+{
+    if (cascade)
+    {
+        free(cascade->coeffs);
+        free(cascade->state);
+        free(cascade->scratch);
+        free(cascade);
+    }
+    return NOERR;
+}
+
+Error_t
+BiquadCascadeFreeD(BiquadCascadeD* cascade)
+{
+    if (cascade)
+    {
+        free(cascade->coeffs);
+        free(cascade->state);
+        free(cascade->scratch);
+        free(cascade);
+    }
+    return NOERR;
+}
+
+
+/* BiquadCascadeFlush **************************************************/
+Error_t
+BiquadCascadeFlush(BiquadCascade* cascade)
+{
+    ClearBuffer(cascade->state, cascade->n_groups * cascade->n_sections
+                                * N_STATES * CASCADE_LANES);
+    return NOERR;
+}
+
+Error_t
+BiquadCascadeFlushD(BiquadCascadeD* cascade)
+{
+    ClearBufferD(cascade->state, cascade->n_groups * cascade->n_sections
+                                 * N_STATES * CASCADE_LANESD);
+    return NOERR;
+}
+
+
+/* BiquadCascadeUpdateKernel *******************************************/
+Error_t
+BiquadCascadeUpdateKernel(BiquadCascade*    cascade,
+                          unsigned          channel,
+                          unsigned          section,
+                          const float*      bCoeff,
+                          const float*      aCoeff)
+{
+    if (!cascade || !bCoeff || !aCoeff)
+    {
+        return NULL_PTR_ERROR;
+    }
+    if (channel >= cascade->n_channels || section >= cascade->n_sections)
+    {
+        return VALUE_ERROR;
+    }
+
+    const unsigned group = channel / CASCADE_LANES;
+    float* coeffs = cascade->coeffs + (group * cascade->n_sections + section)
+                                      * N_COEFFS * CASCADE_LANES
+                                    + channel % CASCADE_LANES;
+    coeffs[0 * CASCADE_LANES] = bCoeff[0];
+    coeffs[1 * CASCADE_LANES] = bCoeff[1];
+    coeffs[2 * CASCADE_LANES] = bCoeff[2];
+    coeffs[3 * CASCADE_LANES] = aCoeff[0];
+    coeffs[4 * CASCADE_LANES] = aCoeff[1];
+    return NOERR;
+}
+
+Error_t
+BiquadCascadeUpdateKernelD(BiquadCascadeD*  cascade,
+                           unsigned         channel,
+                           unsigned         section,
+                           const double*    bCoeff,
+                           const double*    aCoeff)
+{
+    if (!cascade || !bCoeff || !aCoeff)
+    {
+        return NULL_PTR_ERROR;
+    }
+    if (channel >= cascade->n_channels || section >= cascade->n_sections)
+    {
+        return VALUE_ERROR;
+    }
+
+    const unsigned group = channel / CASCADE_LANESD;
+    double* coeffs = cascade->coeffs + (group * cascade->n_sections + section)
+                                       * N_COEFFS * CASCADE_LANESD
+                                     + channel % CASCADE_LANESD;
+    coeffs[0 * CASCADE_LANESD] = bCoeff[0];
+    coeffs[1 * CASCADE_LANESD] = bCoeff[1];
+    coeffs[2 * CASCADE_LANESD] = bCoeff[2];
+    coeffs[3 * CASCADE_LANESD] = aCoeff[0];
+    coeffs[4 * CASCADE_LANESD] = aCoeff[1];
+    return NOERR;
+}
+
+
+/* BiquadCascadeProcess ************************************************/
+Error_t
+BiquadCascadeProcess(BiquadCascade* cascade,
+                     float*         outBuffer,
+                     const float*   inBuffer,
+                     unsigned       n_samples)
+{
+    if (cascade && outBuffer && inBuffer)
+    {
+        const unsigned n_sections = cascade->n_sections;
+        for (unsigned i = 0; i < n_samples; i += CASCADE_BLOCK)
+        {
+            const unsigned n = (n_samples - i < CASCADE_BLOCK) ? n_samples - i : CASCADE_BLOCK;
+            for (unsigned g = 0; g < cascade->n_groups; ++g)
+            {
+                const unsigned first = g * CASCADE_LANES;
+                const unsigned offset = g * n_sections;
+                gather(cascade->scratch, inBuffer + i, first, cascade->n_channels,
+                       n_samples, n);
+                run_sections(cascade->scratch, n,
+                             cascade->coeffs + offset * N_COEFFS * CASCADE_LANES,
+                             cascade->state + offset * N_STATES * CASCADE_LANES,
+                             n_sections);
+                scatter(outBuffer + i, cascade->scratch, first, cascade->n_channels,
+                        n_samples, n);
+            }
+        }
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+Error_t
+BiquadCascadeProcessD(BiquadCascadeD*   cascade,
+                      double*           outBuffer,
+                      const double*     inBuffer,
+                      unsigned          n_samples)
+{
+    if (cascade && outBuffer && inBuffer)
+    {
+        const unsigned n_sections = cascade->n_sections;
+        for (unsigned i = 0; i < n_samples; i += CASCADE_BLOCK)
+        {
+            const unsigned n = (n_samples - i < CASCADE_BLOCK) ? n_samples - i : CASCADE_BLOCK;
+            for (unsigned g = 0; g < cascade->n_groups; ++g)
+            {
+                const unsigned first = g * CASCADE_LANESD;
+                const unsigned offset = g * n_sections;
+                gatherD(cascade->scratch, inBuffer + i, first, cascade->n_channels,
+                        n_samples, n);
+                run_sectionsD(cascade->scratch, n,
+                              cascade->coeffs + offset * N_COEFFS * CASCADE_LANESD,
+                              cascade->state + offset * N_STATES * CASCADE_LANESD,
+                              n_sections);
+                scatterD(outBuffer + i, cascade->scratch, first, cascade->n_channels,
+                         n_samples, n);
+            }
+        }
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+
+/* STATIC FUNCTION DEFINITIONS */
+
+/* Interleave n_samples of the group of channels starting at first. Channels
+ past the last are filled with zeros */
+static void
+gather(float* dest, const float* src, unsigned first, unsigned n_channels,
+       unsigned stride, unsigned n_samples)
+{
+    for (unsigned lane = 0; lane < CASCADE_LANES; ++lane)
+    {
+        const float* channel = src + (first + lane) * stride;
+        const int valid = (first + lane < n_channels);
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            dest[i * CASCADE_LANES + lane] = valid ? channel[i] : 0.0;
+        }
+    }
+}
+
+static void
+gatherD(double* dest, const double* src, unsigned first, unsigned n_channels,
+        unsigned stride, unsigned n_samples)
+{
+    for (unsigned lane = 0; lane < CASCADE_LANESD; ++lane)
+    {
+        const double* channel = src + (first + lane) * stride;
+        const int valid = (first + lane < n_channels);
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            dest[i * CASCADE_LANESD + lane] = valid ? channel[i] : 0.0;
+        }
+    }
+}
+
+/* Write the group back to its channels */
+static void
+scatter(float* dest, const float* src, unsigned first, unsigned n_channels,
+        unsigned stride, unsigned n_samples)
+{
+    for (unsigned lane = 0; lane < CASCADE_LANES && first + lane < n_channels; ++lane)
+    {
+        float* channel = dest + (first + lane) * stride;
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            channel[i] = src[i * CASCADE_LANES + lane];
+        }
+    }
+}
+
+static void
+scatterD(double* dest, const double* src, unsigned first, unsigned n_channels,
+         unsigned stride, unsigned n_samples)
+{
+    for (unsigned lane = 0; lane < CASCADE_LANESD && first + lane < n_channels; ++lane)
+    {
+        double* channel = dest + (first + lane) * stride;
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            channel[i] = src[i * CASCADE_LANESD + lane];
+        }
+    }
+}
+
+/* Run every section of a group over an interleaved block, in place */
+static void
+run_sections(float* buffer, unsigned n_samples, const float* coeffs,
+             float* state, unsigned n_sections)
+{
+#if defined(CASCADE_X86)
+    if (CASCADE_HAS_AVX())
+    {
+        sections_avx(buffer, n_samples, coeffs, state, n_sections);
+    }
+    else
+    {
+        sections_sse(buffer, n_samples, coeffs, state, n_sections);
+    }
+#elif defined(CASCADE_NEON)
+    sections_neon(buffer, n_samples, coeffs, state, n_sections);
+#else
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const float* c = coeffs + k * N_COEFFS * CASCADE_LANES;
+        float* w = state + k * N_STATES * CASCADE_LANES;
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            float* x = buffer + i * CASCADE_LANES;
+            for (unsigned lane = 0; lane < CASCADE_LANES; ++lane)
+            {
+                // Same transposed DF-II as BiquadFilterProcess
+                const float in = x[lane];
+                const float out = c[lane] * in + w[lane];
+                w[lane] = c[CASCADE_LANES + lane] * in
+                        - c[3 * CASCADE_LANES + lane] * out + w[CASCADE_LANES + lane];
+                w[CASCADE_LANES + lane] = c[2 * CASCADE_LANES + lane] * in
+                                        - c[4 * CASCADE_LANES + lane] * out;
+                x[lane] = out;
+            }
+        }
+    }
+#endif
+}
+
+static void
+run_sectionsD(double* buffer, unsigned n_samples, const double* coeffs,
+              double* state, unsigned n_sections)
+{
+#if defined(CASCADE_X86)
+    if (CASCADE_HAS_AVX())
+    {
+        sections_avxD(buffer, n_samples, coeffs, state, n_sections);
+    }
+    else
+    {
+        sections_sseD(buffer, n_samples, coeffs, state, n_sections);
+    }
+#elif defined(CASCADE_NEON)
+    sections_neonD(buffer, n_samples, coeffs, state, n_sections);
+#else
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const double* c = coeffs + k * N_COEFFS * CASCADE_LANESD;
+        double* w = state + k * N_STATES * CASCADE_LANESD;
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            double* x = buffer + i * CASCADE_LANESD;
+            for (unsigned lane = 0; lane < CASCADE_LANESD; ++lane)
+            {
+                // Same transposed DF-II as BiquadFilterProcessD
+                const double in = x[lane];
+                const double out = c[lane] * in + w[lane];
+                w[lane] = c[CASCADE_LANESD + lane] * in
+                        - c[3 * CASCADE_LANESD + lane] * out + w[CASCADE_LANESD + lane];
+                w[CASCADE_LANESD + lane] = c[2 * CASCADE_LANESD + lane] * in
+                                         - c[4 * CASCADE_LANESD + lane] * out;
+                x[lane] = out;
+            }
+        }
+    }
+#endif
+}
+
+#ifdef CASCADE_X86
+/* The sections of a group with AVX. The 8 channels fill one register, and the
+ coefficients and state of a section stay in registers for the whole block */
+__attribute__((target("avx,fma"))) static void
+sections_avx(float* buffer, unsigned n_samples, const float* coeffs,
+             float* state, unsigned n_sections)
+{
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const float* c = coeffs + k * N_COEFFS * CASCADE_LANES;
+        float* s = state + k * N_STATES * CASCADE_LANES;
+        const __m256 b0 = _mm256_loadu_ps(c);
+        const __m256 b1 = _mm256_loadu_ps(c + 8);
+        const __m256 b2 = _mm256_loadu_ps(c + 16);
+        const __m256 a1 = _mm256_loadu_ps(c + 24);
+        const __m256 a2 = _mm256_loadu_ps(c + 32);
+        __m256 w0 = _mm256_loadu_ps(s);
+        __m256 w1 = _mm256_loadu_ps(s + 8);
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            float* x = buffer + i * CASCADE_LANES;
+            const __m256 in = _mm256_loadu_ps(x);
+            const __m256 out = _mm256_fmadd_ps(b0, in, w0);
+            w0 = _mm256_fnmadd_ps(a1, out, _mm256_fmadd_ps(b1, in, w1));
+            w1 = _mm256_fnmadd_ps(a2, out, _mm256_mul_ps(b2, in));
+            _mm256_storeu_ps(x, out);
+        }
+        _mm256_storeu_ps(s, w0);
+        _mm256_storeu_ps(s + 8, w1);
+    }
+}
+
+__attribute__((target("avx,fma"))) static void
+sections_avxD(double* buffer, unsigned n_samples, const double* coeffs,
+              double* state, unsigned n_sections)
+{
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const double* c = coeffs + k * N_COEFFS * CASCADE_LANESD;
+        double* s = state + k * N_STATES * CASCADE_LANESD;
+        const __m256d b0 = _mm256_loadu_pd(c);
+        const __m256d b1 = _mm256_loadu_pd(c + 4);
+        const __m256d b2 = _mm256_loadu_pd(c + 8);
+        const __m256d a1 = _mm256_loadu_pd(c + 12);
+        const __m256d a2 = _mm256_loadu_pd(c + 16);
+        __m256d w0 = _mm256_loadu_pd(s);
+        __m256d w1 = _mm256_loadu_pd(s + 4);
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            double* x = buffer + i * CASCADE_LANESD;
+            const __m256d in = _mm256_loadu_pd(x);
+            const __m256d out = _mm256_fmadd_pd(b0, in, w0);
+            w0 = _mm256_fnmadd_pd(a1, out, _mm256_fmadd_pd(b1, in, w1));
+            w1 = _mm256_fnmadd_pd(a2, out, _mm256_mul_pd(b2, in));
+            _mm256_storeu_pd(x, out);
+        }
+        _mm256_storeu_pd(s, w0);
+        _mm256_storeu_pd(s + 4, w1);
+    }
+}
+
+/* The sections of a group with SSE. The 8 channels take two registers, whose
+ recursions are independent and overlap in the pipeline */
+static void
+sections_sse(float* buffer, unsigned n_samples, const float* coeffs,
+             float* state, unsigned n_sections)
+{
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const float* c = coeffs + k * N_COEFFS * CASCADE_LANES;
+        float* s = state + k * N_STATES * CASCADE_LANES;
+        const __m128 b0l = _mm_loadu_ps(c);
+        const __m128 b0h = _mm_loadu_ps(c + 4);
+        const __m128 b1l = _mm_loadu_ps(c + 8);
+        const __m128 b1h = _mm_loadu_ps(c + 12);
+        const __m128 b2l = _mm_loadu_ps(c + 16);
+        const __m128 b2h = _mm_loadu_ps(c + 20);
+        const __m128 a1l = _mm_loadu_ps(c + 24);
+        const __m128 a1h = _mm_loadu_ps(c + 28);
+        const __m128 a2l = _mm_loadu_ps(c + 32);
+        const __m128 a2h = _mm_loadu_ps(c + 36);
+        __m128 w0l = _mm_loadu_ps(s);
+        __m128 w0h = _mm_loadu_ps(s + 4);
+        __m128 w1l = _mm_loadu_ps(s + 8);
+        __m128 w1h = _mm_loadu_ps(s + 12);
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            float* x = buffer + i * CASCADE_LANES;
+            const __m128 inl = _mm_loadu_ps(x);
+            const __m128 inh = _mm_loadu_ps(x + 4);
+            const __m128 outl = _mm_add_ps(_mm_mul_ps(b0l, inl), w0l);
+            const __m128 outh = _mm_add_ps(_mm_mul_ps(b0h, inh), w0h);
+            w0l = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1l, inl), _mm_mul_ps(a1l, outl)), w1l);
+            w0h = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1h, inh), _mm_mul_ps(a1h, outh)), w1h);
+            w1l = _mm_sub_ps(_mm_mul_ps(b2l, inl), _mm_mul_ps(a2l, outl));
+            w1h = _mm_sub_ps(_mm_mul_ps(b2h, inh), _mm_mul_ps(a2h, outh));
+            _mm_storeu_ps(x, outl);
+            _mm_storeu_ps(x + 4, outh);
+        }
+        _mm_storeu_ps(s, w0l);
+        _mm_storeu_ps(s + 4, w0h);
+        _mm_storeu_ps(s + 8, w1l);
+        _mm_storeu_ps(s + 12, w1h);
+    }
+}
+
+static void
+sections_sseD(double* buffer, unsigned n_samples, const double* coeffs,
+              double* state, unsigned n_sections)
+{
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const double* c = coeffs + k * N_COEFFS * CASCADE_LANESD;
+        double* s = state + k * N_STATES * CASCADE_LANESD;
+        const __m128d b0l = _mm_loadu_pd(c);
+        const __m128d b0h = _mm_loadu_pd(c + 2);
+        const __m128d b1l = _mm_loadu_pd(c + 4);
+        const __m128d b1h = _mm_loadu_pd(c + 6);
+        const __m128d b2l = _mm_loadu_pd(c + 8);
+        const __m128d b2h = _mm_loadu_pd(c + 10);
+        const __m128d a1l = _mm_loadu_pd(c + 12);
+        const __m128d a1h = _mm_loadu_pd(c + 14);
+        const __m128d a2l = _mm_loadu_pd(c + 16);
+        const __m128d a2h = _mm_loadu_pd(c + 18);
+        __m128d w0l = _mm_loadu_pd(s);
+        __m128d w0h = _mm_loadu_pd(s + 2);
+        __m128d w1l = _mm_loadu_pd(s + 4);
+        __m128d w1h = _mm_loadu_pd(s + 6);
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            double* x = buffer + i * CASCADE_LANESD;
+            const __m128d inl = _mm_loadu_pd(x);
+            const __m128d inh = _mm_loadu_pd(x + 2);
+            const __m128d outl = _mm_add_pd(_mm_mul_pd(b0l, inl), w0l);
+            const __m128d outh = _mm_add_pd(_mm_mul_pd(b0h, inh), w0h);
+            w0l = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1l, inl), _mm_mul_pd(a1l, outl)), w1l);
+            w0h = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b1h, inh), _mm_mul_pd(a1h, outh)), w1h);
+            w1l = _mm_sub_pd(_mm_mul_pd(b2l, inl), _mm_mul_pd(a2l, outl));
+            w1h = _mm_sub_pd(_mm_mul_pd(b2h, inh), _mm_mul_pd(a2h, outh));
+            _mm_storeu_pd(x, outl);
+            _mm_storeu_pd(x + 2, outh);
+        }
+        _mm_storeu_pd(s, w0l);
+        _mm_storeu_pd(s + 2, w0h);
+        _mm_storeu_pd(s + 4, w1l);
+        _mm_storeu_pd(s + 6, w1h);
+    }
+}
+
+#elif defined(CASCADE_NEON)
+/* The sections of a group with NEON, the 8 channels in two registers */
+static void
+sections_neon(float* buffer, unsigned n_samples, const float* coeffs,
+              float* state, unsigned n_sections)
+{
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const float* c = coeffs + k * N_COEFFS * CASCADE_LANES;
+        float* s = state + k * N_STATES * CASCADE_LANES;
+        const float32x4_t b0l = vld1q_f32(c);
+        const float32x4_t b0h = vld1q_f32(c + 4);
+        const float32x4_t b1l = vld1q_f32(c + 8);
+        const float32x4_t b1h = vld1q_f32(c + 12);
+        const float32x4_t b2l = vld1q_f32(c + 16);
+        const float32x4_t b2h = vld1q_f32(c + 20);
+        const float32x4_t a1l = vld1q_f32(c + 24);
+        const float32x4_t a1h = vld1q_f32(c + 28);
+        const float32x4_t a2l = vld1q_f32(c + 32);
+        const float32x4_t a2h = vld1q_f32(c + 36);
+        float32x4_t w0l = vld1q_f32(s);
+        float32x4_t w0h = vld1q_f32(s + 4);
+        float32x4_t w1l = vld1q_f32(s + 8);
+        float32x4_t w1h = vld1q_f32(s + 12);
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            float* x = buffer + i * CASCADE_LANES;
+            const float32x4_t inl = vld1q_f32(x);
+            const float32x4_t inh = vld1q_f32(x + 4);
+            const float32x4_t outl = vfmaq_f32(w0l, b0l, inl);
+            const float32x4_t outh = vfmaq_f32(w0h, b0h, inh);
+            w0l = vfmsq_f32(vfmaq_f32(w1l, b1l, inl), a1l, outl);
+            w0h = vfmsq_f32(vfmaq_f32(w1h, b1h, inh), a1h, outh);
+            w1l = vfmsq_f32(vmulq_f32(b2l, inl), a2l, outl);
+            w1h = vfmsq_f32(vmulq_f32(b2h, inh), a2h, outh);
+            vst1q_f32(x, outl);
+            vst1q_f32(x + 4, outh);
+        }
+        vst1q_f32(s, w0l);
+        vst1q_f32(s + 4, w0h);
+        vst1q_f32(s + 8, w1l);
+        vst1q_f32(s + 12, w1h);
+    }
+}
+
+static void
+sections_neonD(double* buffer, unsigned n_samples, const double* coeffs,
+               double* state, unsigned n_sections)
+{
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const double* c = coeffs + k * N_COEFFS * CASCADE_LANESD;
+        double* s = state + k * N_STATES * CASCADE_LANESD;
+        const float64x2_t b0l = vld1q_f64(c);
+        const float64x2_t b0h = vld1q_f64(c + 2);
+        const float64x2_t b1l = vld1q_f64(c + 4);
+        const float64x2_t b1h = vld1q_f64(c + 6);
+        const float64x2_t b2l = vld1q_f64(c + 8);
+        const float64x2_t b2h = vld1q_f64(c + 10);
+        const float64x2_t a1l = vld1q_f64(c + 12);
+        const float64x2_t a1h = vld1q_f64(c + 14);
+        const float64x2_t a2l = vld1q_f64(c + 16);
+        const float64x2_t a2h = vld1q_f64(c + 18);
+        float64x2_t w0l = vld1q_f64(s);
+        float64x2_t w0h = vld1q_f64(s + 2);
+        float64x2_t w1l = vld1q_f64(s + 4);
+        float64x2_t w1h = vld1q_f64(s + 6);
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            double* x = buffer + i * CASCADE_LANESD;
+            const float64x2_t inl = vld1q_f64(x);
+            const float64x2_t inh = vld1q_f64(x + 2);
+            const float64x2_t outl = vfmaq_f64(w0l, b0l, inl);
+            const float64x2_t outh = vfmaq_f64(w0h, b0h, inh);
+            w0l = vfmsq_f64(vfmaq_f64(w1l, b1l, inl), a1l, outl);
+            w0h = vfmsq_f64(vfmaq_f64(w1h, b1h, inh), a1h, outh);
+            w1l = vfmsq_f64(vmulq_f64(b2l, inl), a2l, outl);
+            w1h = vfmsq_f64(vmulq_f64(b2h, inh), a2h, outh);
+            vst1q_f64(x, outl);
+            vst1q_f64(x + 2, outh);
+        }
+        vst1q_f64(s, w0l);
+        vst1q_f64(s + 2, w0h);
+        vst1q_f64(s + 4, w1l);
+        vst1q_f64(s + 6, w1h);
+    }
+}
+#endif
@@ -20,18 +20,18 @@ struct BiquadFilter
 {
     float b[3];     // b0, b1, b2
     float a[2];     // a1, a2
-    float x[2];     //
-    float y[2];
-    float w[2];
+    float w[2];     // transposed direct form II state
+    IIRMode_t mode;
+    float block[IIR_BLOCK_COEFFS];  // block state-space form
 };
 
 struct BiquadFilterD
 {
     double b[3];     // b0, b1, b2
     double a[2];     // a1, a2
-    double  x[2];     //
-    double  y[2];
-    double  w[2];
+    double  w[2];     // transposed direct form II state
+    IIRMode_t mode;
+    double block[IIR_BLOCK_COEFFS];  // block state-space form
 };
 
 /*******************************************************************************
@@ -49,9 +49,8 @@ BiquadFilterInit(const float *bCoeff, const float *aCoeff)
         CopyBuffer(filter->b, bCoeff, 3);
         CopyBuffer(filter->a, aCoeff, 2);
 
-        ClearBuffer(filter->x, 2);
-        ClearBuffer(filter->y, 2);
         ClearBuffer(filter->w, 2);
+        filter->mode = IIR_SERIAL;
     }
     return filter;
 }
@@ -69,9 +68,8 @@ BiquadFilterInitD(const double  *bCoeff, const double  *aCoeff)
         CopyBufferD(filter->b, bCoeff, 3);
         CopyBufferD(filter->a, aCoeff, 2);
 
-        ClearBufferD(filter->x, 2);
-        ClearBufferD(filter->y, 2);
         ClearBufferD(filter->w, 2);
+        filter->mode = IIR_SERIAL;
     }
     return filter;
 }
@@ -106,8 +104,6 @@ BiquadFilterFreeD(BiquadFilterD* filter)
 Error_t
 BiquadFilterFlush(BiquadFilter* filter)
 {
-    FillBuffer(filter->x, 2, 0.0);
-	FillBuffer(filter->y, 2, 0.0);
     FillBuffer(filter->w, 2, 0.0);
     return NOERR;
 }
@@ -115,8 +111,6 @@ BiquadFilterFlush(BiquadFilter* filter)
 Error_t
 BiquadFilterFlushD(BiquadFilterD* filter)
 {
-    FillBufferD(filter->x, 2, 0.0);
-    FillBufferD(filter->y, 2, 0.0);
     FillBufferD(filter->w, 2, 0.0);
     return NOERR;
 }
@@ -130,31 +124,47 @@ BiquadFilterProcess(BiquadFilter    *filter,
                     const float     *inBuffer,
                     unsigned        n_samples)
 {
+    if (filter->mode == IIR_BLOCK)
+    {
+        return IIRBlockFilter(outBuffer, inBuffer, n_samples, filter->block, filter->w);
+    }
 
 #ifdef __APPLE__
-    // Use accelerate if we have it
+    // Use accelerate if we have it. The state is kept in w as on the other
+    // paths, so block mode and Tick can share it: the first two samples are
+    // run from w and give vDSP_deq22 its history, and w is recovered from
+    // the last two samples afterwards
     float coeffs[5] = {
         filter->b[0], filter->b[1], filter->b[2],
         filter->a[0], filter->a[1]
     };
-    float temp_in[n_samples + 2];
     float temp_out[n_samples + 2];
+    unsigned head = (n_samples < 2) ? n_samples : 2;
 
+    for (unsigned buffer_idx = 0; buffer_idx < head; ++buffer_idx)
+    {
+        temp_out[buffer_idx] = filter->b[0] * inBuffer[buffer_idx] + filter->w[0];
+        filter->w[0] = filter->b[1] * inBuffer[buffer_idx] - filter->a[0] * \
+        temp_out[buffer_idx] + filter->w[1];
+        filter->w[1] = filter->b[2] * inBuffer[buffer_idx] - filter->a[1] * \
+        temp_out[buffer_idx];
+    }
 
-    // Put filter overlaps into beginning of input and output vectors
-    cblas_scopy(2, filter->x, 1, temp_in, 1);
-    cblas_scopy(2, filter->y, 1, temp_out, 1);
-    cblas_scopy(n_samples, inBuffer, 1, (temp_in + 2), 1);
-
-    // Process
-    vDSP_deq22(temp_in, 1, coeffs, temp_out, 1, n_samples);
-
-    // Write overlaps to filter x and y arrays
-    cblas_scopy(2, (temp_in + n_samples), 1, filter->x, 1);
-    cblas_scopy(2, (temp_out + n_samples), 1, filter->y, 1);
+    if (n_samples > 2)
+    {
+        // Process
+        vDSP_deq22(inBuffer, 1, coeffs, temp_out, 1, n_samples - 2);
+
+        // Recover the state before the output can overwrite the input
+        const float* x = inBuffer + n_samples - 2;
+        const float* y = temp_out + n_samples - 2;
+        filter->w[0] = filter->b[1] * x[1] + filter->b[2] * x[0] - \
+        filter->a[0] * y[1] - filter->a[1] * y[0];
+        filter->w[1] = filter->b[2] * x[1] - filter->a[1] * y[1];
+    }
 
     // Write output
-    cblas_scopy(n_samples, (temp_out + 2), 1, outBuffer, 1);
+    cblas_scopy(n_samples, temp_out, 1, outBuffer, 1);
 
 
 #else
@@ -186,31 +196,47 @@ BiquadFilterProcessD(BiquadFilterD  *filter,
                      const double   *inBuffer,
                      unsigned       n_samples)
 {
+    if (filter->mode == IIR_BLOCK)
+    {
+        return IIRBlockFilterD(outBuffer, inBuffer, n_samples, filter->block, filter->w);
+    }
 
 #ifdef __APPLE__
-    // Use accelerate if we have it
+    // Use accelerate if we have it. The state is kept in w as on the other
+    // paths, so block mode and Tick can share it: the first two samples are
+    // run from w and give vDSP_deq22 its history, and w is recovered from
+    // the last two samples afterwards
     double coeffs[5] = {
         filter->b[0], filter->b[1], filter->b[2],
         filter->a[0], filter->a[1]
     };
-    double temp_in[n_samples + 2];
     double temp_out[n_samples + 2];
+    unsigned head = (n_samples < 2) ? n_samples : 2;
 
+    for (unsigned buffer_idx = 0; buffer_idx < head; ++buffer_idx)
+    {
+        temp_out[buffer_idx] = filter->b[0] * inBuffer[buffer_idx] + filter->w[0];
+        filter->w[0] = filter->b[1] * inBuffer[buffer_idx] - filter->a[0] * \
+        temp_out[buffer_idx] + filter->w[1];
+        filter->w[1] = filter->b[2] * inBuffer[buffer_idx] - filter->a[1] * \
+        temp_out[buffer_idx];
+    }
 
-    // Put filter overlaps into beginning of input and output vectors
-    cblas_dcopy(2, filter->x, 1, temp_in, 1);
-    cblas_dcopy(2, filter->y, 1, temp_out, 1);
-    cblas_dcopy(n_samples, inBuffer, 1, (temp_in + 2), 1);
-
-    // Process
-    vDSP_deq22D(temp_in, 1, coeffs, temp_out, 1, n_samples);
-
-    // Write overlaps to filter x and y arrays
-    cblas_dcopy(2, (temp_in + n_samples), 1, filter->x, 1);
-    cblas_dcopy(2, (temp_out + n_samples), 1, filter->y, 1);
+    if (n_samples > 2)
+    {
+        // Process
+        vDSP_deq22D(inBuffer, 1, coeffs, temp_out, 1, n_samples - 2);
+
+        // Recover the state before the output can overwrite the input
+        const double* x = inBuffer + n_samples - 2;
+        const double* y = temp_out + n_samples - 2;
+        filter->w[0] = filter->b[1] * x[1] + filter->b[2] * x[0] - \
+        filter->a[0] * y[1] - filter->a[1] * y[0];
+        filter->w[1] = filter->b[2] * x[1] - filter->a[1] * y[1];
+    }
 
     // Write output
-    cblas_dcopy(n_samples, (temp_out + 2), 1, outBuffer, 1);
+    cblas_dcopy(n_samples, temp_out, 1, outBuffer, 1);
 
 
 #else
@@ -269,6 +295,10 @@ BiquadFilterUpdateKernel(BiquadFilter   *filter,
 
     CopyBuffer(filter->b, bCoeff, 3);
     CopyBuffer(filter->a, aCoeff, 2);
+    if (filter->mode == IIR_BLOCK)
+    {
+        IIRBlockDesign(filter->block, filter->b, filter->a);
+    }
     return NOERR;
 }
 
@@ -280,6 +310,43 @@ BiquadFilterUpdateKernelD(BiquadFilterD *filter,
 
     CopyBufferD(filter->b, bCoeff, 3);
     CopyBufferD(filter->a, aCoeff, 2);
+    if (filter->mode == IIR_BLOCK)
+    {
+        IIRBlockDesignD(filter->block, filter->b, filter->a);
+    }
+    return NOERR;
+}
+
+
+/*******************************************************************************
+ BiquadFilterSetMode */
+Error_t
+BiquadFilterSetMode(BiquadFilter* filter, IIRMode_t mode)
+{
+    if (mode != IIR_SERIAL && mode != IIR_BLOCK)
+    {
+        return VALUE_ERROR;
+    }
+    if (mode == IIR_BLOCK)
+    {
+        IIRBlockDesign(filter->block, filter->b, filter->a);
+    }
+    filter->mode = mode;
+    return NOERR;
+}
+
+Error_t
+BiquadFilterSetModeD(BiquadFilterD* filter, IIRMode_t mode)
+{
+    if (mode != IIR_SERIAL && mode != IIR_BLOCK)
+    {
+        return VALUE_ERROR;
+    }
+    if (mode == IIR_BLOCK)
+    {
+        IIRBlockDesignD(filter->block, filter->b, filter->a);
+    }
+    filter->mode = mode;
     return NOERR;
 }
 
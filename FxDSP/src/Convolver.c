@@ -0,0 +1,1579 @@
+/*
+ * Convolver.c
+ * Hamilton Kibbe
+ * Copyright 2015 Hamilton Kibbe
+ */
+
+#include "Convolver.h"
+#include "FIRFilter.h"
+#include "FFT.h"
+#include "Dsp.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+
+/* Segments with at least this many blocks between a partition of input being
+ complete and its output being needed can be handed to the worker thread, so
+ every job has at least a block of lead time */
+#define WORKER_MIN_BLOCKS (2)
+
+/* Jobs each segment can have queued or running on the worker at once */
+#define JOB_SLOTS (2)
+
+/* Job counters are each written by one thread and read by the other. Release
+ ordering makes the buffers written before a store visible after the load */
+#define JOB_LOAD(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define JOB_STORE(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+/* Wakes the worker thread. Posting is safe from the audio thread */
+#ifdef __APPLE__
+typedef dispatch_semaphore_t WorkerSignal;
+#else
+typedef sem_t WorkerSignal;
+#endif
+
+
+/* ConvolverJob ********************************************************/
+/* A frame handed to the worker. The output goes to the tail at position. The
+ worker first clears the delay line if the convolver was flushed, and treats
+ the skipped frames the audio thread had to leave out as silence */
+typedef struct ConvolverJob
+{
+    unsigned            position;
+    unsigned            skipped;
+    unsigned            clear;
+} ConvolverJob;
+
+
+/* ConvolverSegment ****************************************************/
+/* One uniformly partitioned FFT section of the kernel, covering length
+ coefficients from offset. Its output is ready partition_length samples after
+ each partition of input is complete, which the offset has to hide. */
+typedef struct ConvolverSegment
+{
+    unsigned            offset;
+    unsigned            partition_length;
+    unsigned            partition_count;
+    unsigned            partition_index;
+    unsigned            fft_length;
+    FFTConfig*          fft_config;
+    unsigned            threaded;
+    unsigned            job_delay;
+    unsigned            job_wait;
+    unsigned            job_posted;
+    unsigned            job_computed;
+    unsigned            job_step;
+    unsigned            job_skipped;
+    unsigned            job_flushed;
+    ConvolverJob        jobs[JOB_SLOTS];
+    float*              partitions;
+    float*              fdl;
+    float*              accum;
+    float*              scratch;
+} ConvolverSegment;
+
+typedef struct ConvolverSegmentD
+{
+    unsigned            offset;
+    unsigned            partition_length;
+    unsigned            partition_count;
+    unsigned            partition_index;
+    unsigned            fft_length;
+    FFTConfigD*         fft_config;
+    unsigned            threaded;
+    unsigned            job_delay;
+    unsigned            job_wait;
+    unsigned            job_posted;
+    unsigned            job_computed;
+    unsigned            job_step;
+    unsigned            job_skipped;
+    unsigned            job_flushed;
+    ConvolverJob        jobs[JOB_SLOTS];
+    double*             partitions;
+    double*             fdl;
+    double*             accum;
+    double*             scratch;
+} ConvolverSegmentD;
+
+
+/* Convolver ***********************************************************/
+struct Convolver
+{
+    unsigned            block_size;
+    unsigned            block_fill;
+    unsigned            block_count;
+    unsigned            block_period;
+    FIRFilter*          head;
+    ConvolverSegment*   segments;
+    unsigned            n_segments;
+    float*              history;
+    unsigned            history_length;
+    unsigned            history_index;
+    float*              tail;
+    unsigned            tail_length;
+    unsigned            tail_index;
+    unsigned            threaded;
+    pthread_t           worker;
+    WorkerSignal        signal;
+    ConvolverWorkerHook worker_hook;
+    void*               worker_context;
+    int                 quit;
+};
+
+struct ConvolverD
+{
+    unsigned            block_size;
+    unsigned            block_fill;
+    unsigned            block_count;
+    unsigned            block_period;
+    FIRFilterD*         head;
+    ConvolverSegmentD*  segments;
+    unsigned            n_segments;
+    double*             history;
+    unsigned            history_length;
+    unsigned            history_index;
+    double*             tail;
+    unsigned            tail_length;
+    unsigned            tail_index;
+    unsigned            threaded;
+    pthread_t           worker;
+    WorkerSignal        signal;
+    ConvolverWorkerHook worker_hook;
+    void*               worker_context;
+    int                 quit;
+};
+
+
+/* Static Function Prototypes */
+static Convolver*
+convolver_init(const float* filter_kernel, unsigned length, unsigned block_size,
+               unsigned threaded);
+
+static ConvolverD*
+convolver_initD(const double* filter_kernel, unsigned length, unsigned block_size,
+                unsigned threaded);
+
+static unsigned
+segment_layout(unsigned length, unsigned block_size, unsigned* offsets,
+               unsigned* lengths, unsigned* partition_lengths);
+
+static Error_t
+segment_init(ConvolverSegment* segment, const float* kernel, unsigned offset,
+             unsigned length, unsigned partition_length, unsigned threaded);
+
+static Error_t
+segment_initD(ConvolverSegmentD* segment, const double* kernel, unsigned offset,
+              unsigned length, unsigned partition_length, unsigned threaded);
+
+static void
+segment_free(ConvolverSegment* segment);
+
+static void
+segment_freeD(ConvolverSegmentD* segment);
+
+static void
+segment_frame(Convolver* convolver, ConvolverSegment* segment, float* frame);
+
+static void
+segment_frameD(ConvolverD* convolver, ConvolverSegmentD* segment, double* frame);
+
+static void
+segment_begin(ConvolverSegment* segment, float* frame);
+
+static void
+segment_beginD(ConvolverSegmentD* segment, double* frame);
+
+static void
+segment_accumulate(ConvolverSegment* segment, unsigned i);
+
+static void
+segment_accumulateD(ConvolverSegmentD* segment, unsigned i);
+
+static void
+segment_end(ConvolverSegment* segment, float* frame);
+
+static void
+segment_endD(ConvolverSegmentD* segment, double* frame);
+
+static void
+segment_compute(ConvolverSegment* segment, float* frame);
+
+static void
+segment_computeD(ConvolverSegmentD* segment, double* frame);
+
+static void
+segment_skip(ConvolverSegment* segment, unsigned clear, unsigned skipped);
+
+static void
+segment_skipD(ConvolverSegmentD* segment, unsigned clear, unsigned skipped);
+
+static void
+segment_add(Convolver* convolver, ConvolverSegment* segment, const float* frame,
+            unsigned position);
+
+static void
+segment_addD(ConvolverD* convolver, ConvolverSegmentD* segment, const double* frame,
+             unsigned position);
+
+static unsigned
+segment_post(Convolver* convolver, ConvolverSegment* segment, unsigned position);
+
+static unsigned
+segment_postD(ConvolverD* convolver, ConvolverSegmentD* segment, unsigned position);
+
+static void
+segment_collect(Convolver* convolver, ConvolverSegment* segment);
+
+static void
+segment_collectD(ConvolverD* convolver, ConvolverSegmentD* segment);
+
+static unsigned
+worker_step(Convolver* convolver);
+
+static unsigned
+worker_stepD(ConvolverD* convolver);
+
+static void*
+worker_run(void* arg);
+
+static void*
+worker_runD(void* arg);
+
+static Error_t
+worker_start(pthread_t* thread, WorkerSignal* signal, void* (*run)(void*), void* arg);
+
+static void
+worker_signal_post(WorkerSignal* signal);
+
+static void
+worker_signal_wait(WorkerSignal* signal);
+
+static void
+worker_signal_destroy(WorkerSignal* signal);
+
+
+/* ConvolverInit *******************************************************/
+Convolver*
+ConvolverInit(const float*  filter_kernel,
+              unsigned      length,
+              unsigned      block_size)
+{
+    return convolver_init(filter_kernel, length, block_size, 0);
+}
+
+ConvolverD*
+ConvolverInitD(const double*    filter_kernel,
+               unsigned         length,
+               unsigned         block_size)
+{
+    return convolver_initD(filter_kernel, length, block_size, 0);
+}
+
+
+Convolver*
+ConvolverInitThreaded(const float*  filter_kernel,
+                      unsigned      length,
+                      unsigned      block_size)
+{
+    return convolver_init(filter_kernel, length, block_size, 1);
+}
+
+ConvolverD*
+ConvolverInitThreadedD(const double*    filter_kernel,
+                       unsigned         length,
+                       unsigned         block_size)
+{
+    return convolver_initD(filter_kernel, length, block_size, 1);
+}
+
+
+/* ConvolverSetWorkerHook **********************************************/
+Error_t
+ConvolverSetWorkerHook(Convolver*           convolver,
+                       ConvolverWorkerHook  hook,
+                       void*                context)
+{
+    if (convolver)
+    {
+        convolver->worker_hook = hook;
+        convolver->worker_context = context;
+        return NOERR;
+    }
+
+    else
+    {
+        return ERROR;
+    }
+}
+
+
+Error_t
+ConvolverSetWorkerHookD(ConvolverD*         convolver,
+                        ConvolverWorkerHook hook,
+                        void*               context)
+{
+    if (convolver)
+    {
+        convolver->worker_hook = hook;
+        convolver->worker_context = context;
+        return NOERR;
+    }
+
+    else
+    {
+        return ERROR;
+    }
+}
+
+/* ConvolverFree *******************************************************/
+Error_t
+ConvolverFree(Convolver* convolver)
+{
+    if (convolver)
+    {
+        // Stop the worker before freeing anything it might touch
+        if (convolver->threaded)
+        {
+            JOB_STORE(&convolver->quit, 1);
+            worker_signal_post(&convolver->signal);
+            pthread_join(convolver->worker, NULL);
+            worker_signal_destroy(&convolver->signal);
+            convolver->threaded = 0;
+        }
+
+        if (convolver->head)
+        {
+            FIRFilterFree(convolver->head);
+            convolver->head = NULL;
+        }
+
+        if (convolver->segments)
+        {
+            for (unsigned i = 0; i < convolver->n_segments; ++i)
+            {
+                segment_free(&convolver->segments[i]);
+            }
+            free(convolver->segments);
+            convolver->segments = NULL;
+        }
+
+        if (convolver->history)
+        {
+            free(convolver->history);
+            convolver->history = NULL;
+        }
+
+        if (convolver->tail)
+        {
+            free(convolver->tail);
+            convolver->tail = NULL;
+        }
+
+        free(convolver);
+        convolver = NULL;
+    }
+    return NOERR;
+}
+
+
+Error_t
+ConvolverFreeD(ConvolverD* convolver)
+{
+    if (convolver)
+    {
+        // Stop the worker before freeing anything it might touch
+        if (convolver->threaded)
+        {
+            JOB_STORE(&convolver->quit, 1);
+            worker_signal_post(&convolver->signal);
+            pthread_join(convolver->worker, NULL);
+            worker_signal_destroy(&convolver->signal);
+            convolver->threaded = 0;
+        }
+
+        if (convolver->head)
+        {
+            FIRFilterFreeD(convolver->head);
+            convolver->head = NULL;
+        }
+
+        if (convolver->segments)
+        {
+            for (unsigned i = 0; i < convolver->n_segments; ++i)
+            {
+                segment_freeD(&convolver->segments[i]);
+            }
+            free(convolver->segments);
+            convolver->segments = NULL;
+        }
+
+        if (convolver->history)
+        {
+            free(convolver->history);
+            convolver->history = NULL;
+        }
+
+        if (convolver->tail)
+        {
+            free(convolver->tail);
+            convolver->tail = NULL;
+        }
+
+        free(convolver);
+        convolver = NULL;
+    }
+    return NOERR;
+}
+
+
+/* ConvolverFlush ******************************************************/
+Error_t
+ConvolverFlush(Convolver* convolver)
+{
+    FIRFilterFlush(convolver->head);
+    ClearBuffer(convolver->history, convolver->history_length);
+    ClearBuffer(convolver->tail, convolver->tail_length);
+    for (unsigned i = 0; i < convolver->n_segments; ++i)
+    {
+        ConvolverSegment* segment = &convolver->segments[i];
+        if (segment->threaded)
+        {
+            // The worker owns the delay line. Drop the results still due and
+            // have it clear the delay line before the next job
+            segment->job_wait = 0;
+            segment->job_skipped = 0;
+            segment->job_flushed = 1;
+        }
+        else
+        {
+            ClearBuffer(segment->fdl, segment->partition_count * segment->fft_length);
+            segment->partition_index = 0;
+        }
+    }
+    convolver->block_fill = 0;
+    convolver->block_count = 0;
+    convolver->history_index = 0;
+    convolver->tail_index = 0;
+    return NOERR;
+}
+
+
+Error_t
+ConvolverFlushD(ConvolverD* convolver)
+{
+    FIRFilterFlushD(convolver->head);
+    ClearBufferD(convolver->history, convolver->history_length);
+    ClearBufferD(convolver->tail, convolver->tail_length);
+    for (unsigned i = 0; i < convolver->n_segments; ++i)
+    {
+        ConvolverSegmentD* segment = &convolver->segments[i];
+        if (segment->threaded)
+        {
+            // The worker owns the delay line. Drop the results still due and
+            // have it clear the delay line before the next job
+            segment->job_wait = 0;
+            segment->job_skipped = 0;
+            segment->job_flushed = 1;
+        }
+        else
+        {
+            ClearBufferD(segment->fdl, segment->partition_count * segment->fft_length);
+            segment->partition_index = 0;
+        }
+    }
+    convolver->block_fill = 0;
+    convolver->block_count = 0;
+    convolver->history_index = 0;
+    convolver->tail_index = 0;
+    return NOERR;
+}
+
+
+/* ConvolverProcess ****************************************************/
+Error_t
+ConvolverProcess(Convolver*     convolver,
+                 float*         outBuffer,
+                 const float*   inBuffer,
+                 unsigned       n_samples)
+{
+    if (convolver)
+    {
+        const unsigned block_size = convolver->block_size;
+        unsigned done = 0;
+
+        while (done < n_samples)
+        {
+            // Work up to the end of the current block at most
+            unsigned count = block_size - convolver->block_fill;
+            if (count > n_samples - done)
+            {
+                count = n_samples - done;
+            }
+
+            if (convolver->n_segments > 0)
+            {
+                // Store the input before the head filter can overwrite it
+                unsigned index = convolver->history_index;
+                unsigned first = convolver->history_length - index;
+                if (first > count)
+                {
+                    first = count;
+                }
+                CopyBuffer(convolver->history + index, inBuffer + done, first);
+                CopyBuffer(convolver->history, inBuffer + done + first, count - first);
+                convolver->history_index = (index + count) % convolver->history_length;
+            }
+
+            // The head of the kernel is applied directly, with no latency
+            FIRFilterProcess(convolver->head, outBuffer + done, inBuffer + done, count);
+
+            if (convolver->n_segments > 0)
+            {
+                // Add the segment output, which is ready by the start of each
+                // block, and clear it for reuse
+                unsigned index = (convolver->tail_index + convolver->block_fill) % convolver->tail_length;
+                unsigned first = convolver->tail_length - index;
+                if (first > count)
+                {
+                    first = count;
+                }
+                VectorVectorAdd(outBuffer + done, outBuffer + done, convolver->tail + index, first);
+                ClearBuffer(convolver->tail + index, first);
+                VectorVectorAdd(outBuffer + done + first, outBuffer + done + first,
+                                convolver->tail, count - first);
+                ClearBuffer(convolver->tail, count - first);
+            }
+
+            convolver->block_fill += count;
+            done += count;
+
+            // Run each segment whose partition of input is now complete
+            if (convolver->block_fill == block_size)
+            {
+                convolver->block_fill = 0;
+                convolver->tail_index = (convolver->tail_index + block_size) % convolver->tail_length;
+                convolver->block_count = (convolver->block_count + 1) % convolver->block_period;
+                unsigned posted = 0;
+                for (unsigned i = 0; i < convolver->n_segments; ++i)
+                {
+                    ConvolverSegment* segment = &convolver->segments[i];
+
+                    // Collect results from the worker as they fall due
+                    if (segment->job_wait > 0 && --segment->job_wait == 0)
+                    {
+                        segment_collect(convolver, segment);
+                    }
+
+                    if (convolver->block_count % (segment->partition_length / block_size) == 0)
+                    {
+                        // The output starts offset - partition_length
+                        // samples from now
+                        unsigned position = (convolver->tail_index + segment->offset
+                                             - segment->partition_length)
+                                            % convolver->tail_length;
+                        if (segment->threaded)
+                        {
+                            posted |= segment_post(convolver, segment, position);
+                        }
+                        else
+                        {
+                            segment_frame(convolver, segment, segment->scratch);
+                            segment_compute(segment, segment->scratch);
+                            segment_add(convolver, segment, segment->scratch, position);
+                        }
+                    }
+                }
+
+                if (posted)
+                {
+                    worker_signal_post(&convolver->signal);
+                }
+            }
+        }
+        return NOERR;
+    }
+
+    else
+    {
+        return ERROR;
+    }
+}
+
+
+Error_t
+ConvolverProcessD(ConvolverD*   convolver,
+                  double*       outBuffer,
+                  const double* inBuffer,
+                  unsigned      n_samples)
+{
+    if (convolver)
+    {
+        const unsigned block_size = convolver->block_size;
+        unsigned done = 0;
+
+        while (done < n_samples)
+        {
+            // Work up to the end of the current block at most
+            unsigned count = block_size - convolver->block_fill;
+            if (count > n_samples - done)
+            {
+                count = n_samples - done;
+            }
+
+            if (convolver->n_segments > 0)
+            {
+                // Store the input before the head filter can overwrite it
+                unsigned index = convolver->history_index;
+                unsigned first = convolver->history_length - index;
+                if (first > count)
+                {
+                    first = count;
+                }
+                CopyBufferD(convolver->history + index, inBuffer + done, first);
+                CopyBufferD(convolver->history, inBuffer + done + first, count - first);
+                convolver->history_index = (index + count) % convolver->history_length;
+            }
+
+            // The head of the kernel is applied directly, with no latency
+            FIRFilterProcessD(convolver->head, outBuffer + done, inBuffer + done, count);
+
+            if (convolver->n_segments > 0)
+            {
+                // Add the segment output, which is ready by the start of each
+                // block, and clear it for reuse
+                unsigned index = (convolver->tail_index + convolver->block_fill) % convolver->tail_length;
+                unsigned first = convolver->tail_length - index;
+                if (first > count)
+                {
+                    first = count;
+                }
+                VectorVectorAddD(outBuffer + done, outBuffer + done, convolver->tail + index, first);
+                ClearBufferD(convolver->tail + index, first);
+                VectorVectorAddD(outBuffer + done + first, outBuffer + done + first,
+                                 convolver->tail, count - first);
+                ClearBufferD(convolver->tail, count - first);
+            }
+
+            convolver->block_fill += count;
+            done += count;
+
+            // Run each segment whose partition of input is now complete
+            if (convolver->block_fill == block_size)
+            {
+                convolver->block_fill = 0;
+                convolver->tail_index = (convolver->tail_index + block_size) % convolver->tail_length;
+                convolver->block_count = (convolver->block_count + 1) % convolver->block_period;
+                unsigned posted = 0;
+                for (unsigned i = 0; i < convolver->n_segments; ++i)
+                {
+                    ConvolverSegmentD* segment = &convolver->segments[i];
+
+                    // Collect results from the worker as they fall due
+                    if (segment->job_wait > 0 && --segment->job_wait == 0)
+                    {
+                        segment_collectD(convolver, segment);
+                    }
+
+                    if (convolver->block_count % (segment->partition_length / block_size) == 0)
+                    {
+                        // The output starts offset - partition_length
+                        // samples from now
+                        unsigned position = (convolver->tail_index + segment->offset
+                                             - segment->partition_length)
+                                            % convolver->tail_length;
+                        if (segment->threaded)
+                        {
+                            posted |= segment_postD(convolver, segment, position);
+                        }
+                        else
+                        {
+                            segment_frameD(convolver, segment, segment->scratch);
+                            segment_computeD(segment, segment->scratch);
+                            segment_addD(convolver, segment, segment->scratch, position);
+                        }
+                    }
+                }
+
+                if (posted)
+                {
+                    worker_signal_post(&convolver->signal);
+                }
+            }
+        }
+        return NOERR;
+    }
+
+    else
+    {
+        return ERROR;
+    }
+}
+
+
+/* Set up a convolver, optionally handing its later segments to a worker */
+static Convolver*
+convolver_init(const float* filter_kernel, unsigned length, unsigned block_size,
+               unsigned threaded)
+{
+    if (!filter_kernel || length == 0 || block_size == 0)
+    {
+        return NULL;
+    }
+
+    // Lay out the FFT segments that follow the direct-form head
+    unsigned head_length = (length < block_size) ? length : block_size;
+    unsigned n_segments = segment_layout(length, block_size, NULL, NULL, NULL);
+    unsigned offsets[n_segments + 1];
+    unsigned lengths[n_segments + 1];
+    unsigned partition_lengths[n_segments + 1];
+    segment_layout(length, block_size, offsets, lengths, partition_lengths);
+
+    // The input history has to hold a frame for the largest FFT, and the
+    // tail has to reach as far ahead as the last segment starts
+    unsigned history_length = block_size;
+    unsigned tail_length = block_size;
+    if (n_segments > 0)
+    {
+        history_length = FFTNextGoodLength(2 * partition_lengths[n_segments - 1]);
+        tail_length = offsets[n_segments - 1] + block_size;
+    }
+
+    // Allocate Memory
+    Convolver* convolver = (Convolver*)malloc(sizeof(Convolver));
+    ConvolverSegment* segments = (ConvolverSegment*)malloc((n_segments + 1) * sizeof(ConvolverSegment));
+    float* history = (float*)malloc(history_length * sizeof(float));
+    float* tail = (float*)malloc(tail_length * sizeof(float));
+    FIRFilter* head = FIRFilterInit(filter_kernel, head_length, DIRECT);
+
+    if (convolver && segments && history && tail && head)
+    {
+        ClearBuffer(history, history_length);
+        ClearBuffer(tail, tail_length);
+
+        // Set up the struct
+        convolver->block_size = block_size;
+        convolver->block_fill = 0;
+        convolver->block_count = 0;
+        convolver->block_period = 1;
+        convolver->head = head;
+        convolver->segments = segments;
+        convolver->n_segments = 0;
+        convolver->history = history;
+        convolver->history_length = history_length;
+        convolver->history_index = 0;
+        convolver->tail = tail;
+        convolver->tail_length = tail_length;
+        convolver->tail_index = 0;
+        convolver->threaded = 0;
+        convolver->worker_hook = NULL;
+        convolver->worker_context = NULL;
+        convolver->quit = 0;
+
+        for (unsigned i = 0; i < n_segments; ++i)
+        {
+            // Segments with enough time before their output is needed can go
+            // to the worker. Results are collected within one period, so a
+            // job only stays in flight past that if the worker falls behind
+            unsigned slack = (offsets[i] - partition_lengths[i]) / block_size;
+            unsigned period = partition_lengths[i] / block_size;
+            unsigned job_delay = (slack < period) ? slack : period - 1;
+            unsigned job_threaded = threaded && (job_delay >= WORKER_MIN_BLOCKS);
+
+            if (segment_init(&segments[i], filter_kernel, offsets[i], lengths[i],
+                             partition_lengths[i], job_threaded) != NOERR)
+            {
+                ConvolverFree(convolver);
+                return NULL;
+            }
+            segments[i].job_delay = job_delay;
+            convolver->n_segments = i + 1;
+            convolver->block_period = period;
+            convolver->threaded |= job_threaded;
+        }
+
+        // Start the worker once the segments it reads are all set up
+        if (convolver->threaded)
+        {
+            if (worker_start(&convolver->worker, &convolver->signal, worker_run,
+                             convolver) != NOERR)
+            {
+                convolver->threaded = 0;
+                ConvolverFree(convolver);
+                return NULL;
+            }
+        }
+        return convolver;
+    }
+
+    else
+    {
+        if (head)
+        {
+            FIRFilterFree(head);
+        }
+        free(convolver);
+        free(segments);
+        free(history);
+        free(tail);
+        return NULL;
+    }
+}
+
+static ConvolverD*
+convolver_initD(const double* filter_kernel, unsigned length, unsigned block_size,
+                unsigned threaded)
+{
+    if (!filter_kernel || length == 0 || block_size == 0)
+    {
+        return NULL;
+    }
+
+    // Lay out the FFT segments that follow the direct-form head
+    unsigned head_length = (length < block_size) ? length : block_size;
+    unsigned n_segments = segment_layout(length, block_size, NULL, NULL, NULL);
+    unsigned offsets[n_segments + 1];
+    unsigned lengths[n_segments + 1];
+    unsigned partition_lengths[n_segments + 1];
+    segment_layout(length, block_size, offsets, lengths, partition_lengths);
+
+    // The input history has to hold a frame for the largest FFT, and the
+    // tail has to reach as far ahead as the last segment starts
+    unsigned history_length = block_size;
+    unsigned tail_length = block_size;
+    if (n_segments > 0)
+    {
+        history_length = FFTNextGoodLength(2 * partition_lengths[n_segments - 1]);
+        tail_length = offsets[n_segments - 1] + block_size;
+    }
+
+    // Allocate Memory
+    ConvolverD* convolver = (ConvolverD*)malloc(sizeof(ConvolverD));
+    ConvolverSegmentD* segments = (ConvolverSegmentD*)malloc((n_segments + 1) * sizeof(ConvolverSegmentD));
+    double* history = (double*)malloc(history_length * sizeof(double));
+    double* tail = (double*)malloc(tail_length * sizeof(double));
+    FIRFilterD* head = FIRFilterInitD(filter_kernel, head_length, DIRECT);
+
+    if (convolver && segments && history && tail && head)
+    {
+        ClearBufferD(history, history_length);
+        ClearBufferD(tail, tail_length);
+
+        // Set up the struct
+        convolver->block_size = block_size;
+        convolver->block_fill = 0;
+        convolver->block_count = 0;
+        convolver->block_period = 1;
+        convolver->head = head;
+        convolver->segments = segments;
+        convolver->n_segments = 0;
+        convolver->history = history;
+        convolver->history_length = history_length;
+        convolver->history_index = 0;
+        convolver->tail = tail;
+        convolver->tail_length = tail_length;
+        convolver->tail_index = 0;
+        convolver->threaded = 0;
+        convolver->worker_hook = NULL;
+        convolver->worker_context = NULL;
+        convolver->quit = 0;
+
+        for (unsigned i = 0; i < n_segments; ++i)
+        {
+            // Segments with enough time before their output is needed can go
+            // to the worker. Results are collected within one period, so a
+            // job only stays in flight past that if the worker falls behind
+            unsigned slack = (offsets[i] - partition_lengths[i]) / block_size;
+            unsigned period = partition_lengths[i] / block_size;
+            unsigned job_delay = (slack < period) ? slack : period - 1;
+            unsigned job_threaded = threaded && (job_delay >= WORKER_MIN_BLOCKS);
+
+            if (segment_initD(&segments[i], filter_kernel, offsets[i], lengths[i],
+                              partition_lengths[i], job_threaded) != NOERR)
+            {
+                ConvolverFreeD(convolver);
+                return NULL;
+            }
+            segments[i].job_delay = job_delay;
+            convolver->n_segments = i + 1;
+            convolver->block_period = period;
+            convolver->threaded |= job_threaded;
+        }
+
+        // Start the worker once the segments it reads are all set up
+        if (convolver->threaded)
+        {
+            if (worker_start(&convolver->worker, &convolver->signal, worker_runD,
+                             convolver) != NOERR)
+            {
+                convolver->threaded = 0;
+                ConvolverFreeD(convolver);
+                return NULL;
+            }
+        }
+        return convolver;
+    }
+
+    else
+    {
+        if (head)
+        {
+            FIRFilterFreeD(head);
+        }
+        free(convolver);
+        free(segments);
+        free(history);
+        free(tail);
+        return NULL;
+    }
+}
+
+/* Split the kernel after the direct-form head into FFT segments. Each
+ partition length is used for two partitions before doubling, so every segment
+ starts at least one partition into the kernel. Passing NULL arrays just counts
+ the segments. */
+static unsigned
+segment_layout(unsigned length, unsigned block_size, unsigned* offsets,
+               unsigned* lengths, unsigned* partition_lengths)
+{
+    unsigned count = 0;
+    unsigned offset = block_size;
+    unsigned partition_length = block_size;
+
+    while (offset < length)
+    {
+        // Once the partitions are as large as allowed, the last segment
+        // covers the rest of the kernel
+        unsigned last = (2 * partition_length > CONVOLVER_MAX_PARTITION_LENGTH);
+        unsigned segment_length = length - offset;
+        if (!last && segment_length > 2 * partition_length)
+        {
+            segment_length = 2 * partition_length;
+        }
+
+        if (offsets)
+        {
+            offsets[count] = offset;
+            lengths[count] = segment_length;
+            partition_lengths[count] = partition_length;
+        }
+
+        offset += segment_length;
+        ++count;
+        if (!last)
+        {
+            partition_length *= 2;
+        }
+    }
+    return count;
+}
+
+static Error_t
+segment_init(ConvolverSegment* segment, const float* kernel, unsigned offset,
+             unsigned length, unsigned partition_length, unsigned threaded)
+{
+    const unsigned fft_length = FFTNextGoodLength(2 * partition_length);
+    const unsigned count = (length + partition_length - 1) / partition_length;
+    const unsigned frames = threaded ? JOB_SLOTS : 1;
+    FFTSplitComplex spectrum;
+
+    // Kernel spectra, the delay line, the accumulator and a frame per job
+    const unsigned total = (2 * count + 1 + frames) * fft_length;
+    FFTConfig* fft_config = FFTInit(fft_length);
+    float* buffer = (float*)malloc(total * sizeof(float));
+
+    if (fft_config && buffer)
+    {
+        ClearBuffer(buffer, total);
+        segment->offset = offset;
+        segment->partition_length = partition_length;
+        segment->partition_count = count;
+        segment->partition_index = 0;
+        segment->fft_length = fft_length;
+        segment->fft_config = fft_config;
+        segment->threaded = threaded;
+        segment->job_wait = 0;
+        segment->job_posted = 0;
+        segment->job_computed = 0;
+        segment->job_step = 0;
+        segment->job_skipped = 0;
+        segment->job_flushed = 0;
+        segment->partitions = buffer;
+        segment->fdl = segment->partitions + count * fft_length;
+        segment->accum = segment->fdl + count * fft_length;
+        segment->scratch = segment->accum + fft_length;
+
+        // Transform each partition of the kernel
+        for (unsigned i = 0; i < count; ++i)
+        {
+            unsigned start = i * partition_length;
+            unsigned n = length - start;
+            if (n > partition_length)
+            {
+                n = partition_length;
+            }
+            ClearBuffer(segment->scratch, fft_length);
+            CopyBuffer(segment->scratch, kernel + offset + start, n);
+            spectrum.realp = segment->partitions + i * fft_length;
+            spectrum.imagp = spectrum.realp + fft_length / 2;
+            FFT_IR_R2C(fft_config, segment->scratch, spectrum);
+        }
+        return NOERR;
+    }
+
+    else
+    {
+        if (fft_config)
+        {
+            FFTFree(fft_config);
+        }
+        free(buffer);
+        return ERROR;
+    }
+}
+
+static Error_t
+segment_initD(ConvolverSegmentD* segment, const double* kernel, unsigned offset,
+              unsigned length, unsigned partition_length, unsigned threaded)
+{
+    const unsigned fft_length = FFTNextGoodLength(2 * partition_length);
+    const unsigned count = (length + partition_length - 1) / partition_length;
+    const unsigned frames = threaded ? JOB_SLOTS : 1;
+    FFTSplitComplexD spectrum;
+
+    // Kernel spectra, the delay line, the accumulator and a frame per job
+    const unsigned total = (2 * count + 1 + frames) * fft_length;
+    FFTConfigD* fft_config = FFTInitD(fft_length);
+    double* buffer = (double*)malloc(total * sizeof(double));
+
+    if (fft_config && buffer)
+    {
+        ClearBufferD(buffer, total);
+        segment->offset = offset;
+        segment->partition_length = partition_length;
+        segment->partition_count = count;
+        segment->partition_index = 0;
+        segment->fft_length = fft_length;
+        segment->fft_config = fft_config;
+        segment->threaded = threaded;
+        segment->job_wait = 0;
+        segment->job_posted = 0;
+        segment->job_computed = 0;
+        segment->job_step = 0;
+        segment->job_skipped = 0;
+        segment->job_flushed = 0;
+        segment->partitions = buffer;
+        segment->fdl = segment->partitions + count * fft_length;
+        segment->accum = segment->fdl + count * fft_length;
+        segment->scratch = segment->accum + fft_length;
+
+        // Transform each partition of the kernel
+        for (unsigned i = 0; i < count; ++i)
+        {
+            unsigned start = i * partition_length;
+            unsigned n = length - start;
+            if (n > partition_length)
+            {
+                n = partition_length;
+            }
+            ClearBufferD(segment->scratch, fft_length);
+            CopyBufferD(segment->scratch, kernel + offset + start, n);
+            spectrum.realp = segment->partitions + i * fft_length;
+            spectrum.imagp = spectrum.realp + fft_length / 2;
+            FFT_IR_R2CD(fft_config, segment->scratch, spectrum);
+        }
+        return NOERR;
+    }
+
+    else
+    {
+        if (fft_config)
+        {
+            FFTFreeD(fft_config);
+        }
+        free(buffer);
+        return ERROR;
+    }
+}
+
+static void
+segment_free(ConvolverSegment* segment)
+{
+    FFTFree(segment->fft_config);
+    free(segment->partitions);
+}
+
+static void
+segment_freeD(ConvolverSegmentD* segment)
+{
+    FFTFreeD(segment->fft_config);
+    free(segment->partitions);
+}
+
+/* Copy the newest frame of input for a segment out of the history */
+static void
+segment_frame(Convolver* convolver, ConvolverSegment* segment, float* frame)
+{
+    const unsigned fft_length = segment->fft_length;
+    unsigned start = (convolver->history_index + convolver->history_length - fft_length)
+                     % convolver->history_length;
+    unsigned first = convolver->history_length - start;
+    if (first > fft_length)
+    {
+        first = fft_length;
+    }
+    CopyBuffer(frame, convolver->history + start, first);
+    CopyBuffer(frame + first, convolver->history, fft_length - first);
+}
+
+static void
+segment_frameD(ConvolverD* convolver, ConvolverSegmentD* segment, double* frame)
+{
+    const unsigned fft_length = segment->fft_length;
+    unsigned start = (convolver->history_index + convolver->history_length - fft_length)
+                     % convolver->history_length;
+    unsigned first = convolver->history_length - start;
+    if (first > fft_length)
+    {
+        first = fft_length;
+    }
+    CopyBufferD(frame, convolver->history + start, first);
+    CopyBufferD(frame + first, convolver->history, fft_length - first);
+}
+
+/* Transform the frame into the frequency-domain delay line */
+static void
+segment_begin(ConvolverSegment* segment, float* frame)
+{
+    const unsigned fft_length = segment->fft_length;
+    FFTSplitComplex input;
+    input.realp = segment->fdl + segment->partition_index * fft_length;
+    input.imagp = input.realp + fft_length / 2;
+    FFT_IR_R2C(segment->fft_config, frame, input);
+    ClearBuffer(segment->accum, fft_length);
+}
+
+static void
+segment_beginD(ConvolverSegmentD* segment, double* frame)
+{
+    const unsigned fft_length = segment->fft_length;
+    FFTSplitComplexD input;
+    input.realp = segment->fdl + segment->partition_index * fft_length;
+    input.imagp = input.realp + fft_length / 2;
+    FFT_IR_R2CD(segment->fft_config, frame, input);
+    ClearBufferD(segment->accum, fft_length);
+}
+
+/* Apply kernel partition i to the input from i partitions ago */
+static void
+segment_accumulate(ConvolverSegment* segment, unsigned i)
+{
+    const unsigned fft_length = segment->fft_length;
+    const unsigned count = segment->partition_count;
+    unsigned index = (segment->partition_index + count - i) % count;
+    FFTSplitComplex input;
+    FFTSplitComplex kernel;
+    FFTSplitComplex accum;
+    input.realp = segment->fdl + index * fft_length;
+    input.imagp = input.realp + fft_length / 2;
+    kernel.realp = segment->partitions + i * fft_length;
+    kernel.imagp = kernel.realp + fft_length / 2;
+    accum.realp = segment->accum;
+    accum.imagp = segment->accum + fft_length / 2;
+    FFTSpectrumMultiplyAccumulate(segment->fft_config, accum, input, kernel);
+}
+
+static void
+segment_accumulateD(ConvolverSegmentD* segment, unsigned i)
+{
+    const unsigned fft_length = segment->fft_length;
+    const unsigned count = segment->partition_count;
+    unsigned index = (segment->partition_index + count - i) % count;
+    FFTSplitComplexD input;
+    FFTSplitComplexD kernel;
+    FFTSplitComplexD accum;
+    input.realp = segment->fdl + index * fft_length;
+    input.imagp = input.realp + fft_length / 2;
+    kernel.realp = segment->partitions + i * fft_length;
+    kernel.imagp = kernel.realp + fft_length / 2;
+    accum.realp = segment->accum;
+    accum.imagp = segment->accum + fft_length / 2;
+    FFTSpectrumMultiplyAccumulateD(segment->fft_config, accum, input, kernel);
+}
+
+/* Transform the accumulated spectrum back into the frame */
+static void
+segment_end(ConvolverSegment* segment, float* frame)
+{
+    const unsigned fft_length = segment->fft_length;
+    FFTSplitComplex accum;
+    accum.realp = segment->accum;
+    accum.imagp = segment->accum + fft_length / 2;
+    IFFT_IR_C2R(segment->fft_config, accum, frame);
+    segment->partition_index = (segment->partition_index + 1) % segment->partition_count;
+}
+
+static void
+segment_endD(ConvolverSegmentD* segment, double* frame)
+{
+    const unsigned fft_length = segment->fft_length;
+    FFTSplitComplexD accum;
+    accum.realp = segment->accum;
+    accum.imagp = segment->accum + fft_length / 2;
+    IFFT_IR_C2RD(segment->fft_config, accum, frame);
+    segment->partition_index = (segment->partition_index + 1) % segment->partition_count;
+}
+
+/* Filter the frame with every partition of a segment */
+static void
+segment_compute(ConvolverSegment* segment, float* frame)
+{
+    segment_begin(segment, frame);
+    for (unsigned i = 0; i < segment->partition_count; ++i)
+    {
+        segment_accumulate(segment, i);
+    }
+    segment_end(segment, frame);
+}
+
+static void
+segment_computeD(ConvolverSegmentD* segment, double* frame)
+{
+    segment_beginD(segment, frame);
+    for (unsigned i = 0; i < segment->partition_count; ++i)
+    {
+        segment_accumulateD(segment, i);
+    }
+    segment_endD(segment, frame);
+}
+
+/* Bring the delay line up to date before a worker job. A flush clears it, and
+ frames the audio thread had to skip go in as silence */
+static void
+segment_skip(ConvolverSegment* segment, unsigned clear, unsigned skipped)
+{
+    const unsigned fft_length = segment->fft_length;
+    const unsigned count = segment->partition_count;
+    if (clear || skipped >= count)
+    {
+        ClearBuffer(segment->fdl, count * fft_length);
+        segment->partition_index = 0;
+        return;
+    }
+
+    for (unsigned i = 0; i < skipped; ++i)
+    {
+        ClearBuffer(segment->fdl + segment->partition_index * fft_length, fft_length);
+        segment->partition_index = (segment->partition_index + 1) % count;
+    }
+}
+
+static void
+segment_skipD(ConvolverSegmentD* segment, unsigned clear, unsigned skipped)
+{
+    const unsigned fft_length = segment->fft_length;
+    const unsigned count = segment->partition_count;
+    if (clear || skipped >= count)
+    {
+        ClearBufferD(segment->fdl, count * fft_length);
+        segment->partition_index = 0;
+        return;
+    }
+
+    for (unsigned i = 0; i < skipped; ++i)
+    {
+        ClearBufferD(segment->fdl + segment->partition_index * fft_length, fft_length);
+        segment->partition_index = (segment->partition_index + 1) % count;
+    }
+}
+
+/* Add a segment's output to the tail, starting at position */
+static void
+segment_add(Convolver* convolver, ConvolverSegment* segment, const float* frame,
+            unsigned position)
+{
+    const unsigned partition_length = segment->partition_length;
+    const float* out = frame + (segment->fft_length - partition_length);
+    unsigned first = convolver->tail_length - position;
+    if (first > partition_length)
+    {
+        first = partition_length;
+    }
+    VectorVectorAdd(convolver->tail + position, convolver->tail + position, out, first);
+    VectorVectorAdd(convolver->tail, convolver->tail, out + first, partition_length - first);
+}
+
+static void
+segment_addD(ConvolverD* convolver, ConvolverSegmentD* segment, const double* frame,
+             unsigned position)
+{
+    const unsigned partition_length = segment->partition_length;
+    const double* out = frame + (segment->fft_length - partition_length);
+    unsigned first = convolver->tail_length - position;
+    if (first > partition_length)
+    {
+        first = partition_length;
+    }
+    VectorVectorAddD(convolver->tail + position, convolver->tail + position, out, first);
+    VectorVectorAddD(convolver->tail, convolver->tail, out + first, partition_length - first);
+}
+
+/* Queue the newest frame for the worker. If both job slots are still taken
+ the frame is skipped and the worker later treats it as silence. Returns 1 if
+ a job was queued */
+static unsigned
+segment_post(Convolver* convolver, ConvolverSegment* segment, unsigned position)
+{
+    const unsigned posted = segment->job_posted;
+    if (posted - JOB_LOAD(&segment->job_computed) >= JOB_SLOTS)
+    {
+        ++segment->job_skipped;
+        return 0;
+    }
+
+    const unsigned slot = posted % JOB_SLOTS;
+    segment_frame(convolver, segment, segment->scratch + slot * segment->fft_length);
+    segment->jobs[slot].position = position;
+    segment->jobs[slot].skipped = segment->job_skipped;
+    segment->jobs[slot].clear = segment->job_flushed;
+    segment->job_skipped = 0;
+    segment->job_flushed = 0;
+    segment->job_wait = segment->job_delay;
+    JOB_STORE(&segment->job_posted, posted + 1);
+    return 1;
+}
+
+static unsigned
+segment_postD(ConvolverD* convolver, ConvolverSegmentD* segment, unsigned position)
+{
+    const unsigned posted = segment->job_posted;
+    if (posted - JOB_LOAD(&segment->job_computed) >= JOB_SLOTS)
+    {
+        ++segment->job_skipped;
+        return 0;
+    }
+
+    const unsigned slot = posted % JOB_SLOTS;
+    segment_frameD(convolver, segment, segment->scratch + slot * segment->fft_length);
+    segment->jobs[slot].position = position;
+    segment->jobs[slot].skipped = segment->job_skipped;
+    segment->jobs[slot].clear = segment->job_flushed;
+    segment->job_skipped = 0;
+    segment->job_flushed = 0;
+    segment->job_wait = segment->job_delay;
+    JOB_STORE(&segment->job_posted, posted + 1);
+    return 1;
+}
+
+/* Add the newest worker result to the tail if it is ready. A result that
+ isn't ready by its deadline is left out of the output */
+static void
+segment_collect(Convolver* convolver, ConvolverSegment* segment)
+{
+    const unsigned posted = segment->job_posted;
+    if (JOB_LOAD(&segment->job_computed) == posted)
+    {
+        const unsigned slot = (posted - 1) % JOB_SLOTS;
+        segment_add(convolver, segment, segment->scratch + slot * segment->fft_length,
+                    segment->jobs[slot].position);
+    }
+}
+
+static void
+segment_collectD(ConvolverD* convolver, ConvolverSegmentD* segment)
+{
+    const unsigned posted = segment->job_posted;
+    if (JOB_LOAD(&segment->job_computed) == posted)
+    {
+        const unsigned slot = (posted - 1) % JOB_SLOTS;
+        segment_addD(convolver, segment, segment->scratch + slot * segment->fft_length,
+                     segment->jobs[slot].position);
+    }
+}
+
+/* Run one step of the oldest job of the smallest segment that has one: the
+ forward transform, one kernel partition, or the inverse transform. Returns 0
+ if there was nothing to do */
+static unsigned
+worker_step(Convolver* convolver)
+{
+    for (unsigned i = 0; i < convolver->n_segments; ++i)
+    {
+        ConvolverSegment* segment = &convolver->segments[i];
+        const unsigned computed = segment->job_computed;
+        if (!segment->threaded || JOB_LOAD(&segment->job_posted) == computed)
+        {
+            continue;
+        }
+
+        const unsigned slot = computed % JOB_SLOTS;
+        float* frame = segment->scratch + slot * segment->fft_length;
+        const unsigned step = segment->job_step;
+        if (step == 0)
+        {
+            if (convolver->worker_hook)
+            {
+                convolver->worker_hook(convolver->worker_context, i);
+            }
+            segment_skip(segment, segment->jobs[slot].clear, segment->jobs[slot].skipped);
+            segment_begin(segment, frame);
+            segment->job_step = 1;
+        }
+        else if (step <= segment->partition_count)
+        {
+            segment_accumulate(segment, step - 1);
+            segment->job_step = step + 1;
+        }
+        else
+        {
+            segment_end(segment, frame);
+            segment->job_step = 0;
+            JOB_STORE(&segment->job_computed, computed + 1);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static unsigned
+worker_stepD(ConvolverD* convolver)
+{
+    for (unsigned i = 0; i < convolver->n_segments; ++i)
+    {
+        ConvolverSegmentD* segment = &convolver->segments[i];
+        const unsigned computed = segment->job_computed;
+        if (!segment->threaded || JOB_LOAD(&segment->job_posted) == computed)
+        {
+            continue;
+        }
+
+        const unsigned slot = computed % JOB_SLOTS;
+        double* frame = segment->scratch + slot * segment->fft_length;
+        const unsigned step = segment->job_step;
+        if (step == 0)
+        {
+            if (convolver->worker_hook)
+            {
+                convolver->worker_hook(convolver->worker_context, i);
+            }
+            segment_skipD(segment, segment->jobs[slot].clear, segment->jobs[slot].skipped);
+            segment_beginD(segment, frame);
+            segment->job_step = 1;
+        }
+        else if (step <= segment->partition_count)
+        {
+            segment_accumulateD(segment, step - 1);
+            segment->job_step = step + 1;
+        }
+        else
+        {
+            segment_endD(segment, frame);
+            segment->job_step = 0;
+            JOB_STORE(&segment->job_computed, computed + 1);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* Worker thread. Runs queued segment jobs whenever it is signalled */
+static void*
+worker_run(void* arg)
+{
+    Convolver* convolver = (Convolver*)arg;
+
+    for (;;)
+    {
+        worker_signal_wait(&convolver->signal);
+        while (!JOB_LOAD(&convolver->quit) && worker_step(convolver))
+        {
+        }
+        if (JOB_LOAD(&convolver->quit))
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void*
+worker_runD(void* arg)
+{
+    ConvolverD* convolver = (ConvolverD*)arg;
+
+    for (;;)
+    {
+        worker_signal_wait(&convolver->signal);
+        while (!JOB_LOAD(&convolver->quit) && worker_stepD(convolver))
+        {
+        }
+        if (JOB_LOAD(&convolver->quit))
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static Error_t
+worker_start(pthread_t* thread, WorkerSignal* signal, void* (*run)(void*), void* arg)
+{
+#ifdef __APPLE__
+    *signal = dispatch_semaphore_create(0);
+    if (*signal == NULL)
+    {
+        return ERROR;
+    }
+#else
+    if (sem_init(signal, 0, 0) != 0)
+    {
+        return ERROR;
+    }
+#endif
+
+    if (pthread_create(thread, NULL, run, arg) != 0)
+    {
+        worker_signal_destroy(signal);
+        return ERROR;
+    }
+    return NOERR;
+}
+
+static void
+worker_signal_post(WorkerSignal* signal)
+{
+#ifdef __APPLE__
+    dispatch_semaphore_signal(*signal);
+#else
+    sem_post(signal);
+#endif
+}
+
+static void
+worker_signal_wait(WorkerSignal* signal)
+{
+#ifdef __APPLE__
+    dispatch_semaphore_wait(*signal, DISPATCH_TIME_FOREVER);
+#else
+    while (sem_wait(signal) != 0)
+    {
+    }
+#endif
+}
+
+static void
+worker_signal_destroy(WorkerSignal* signal)
+{
+#ifdef __APPLE__
+    dispatch_release(*signal);
+#else
+    sem_destroy(signal);
+#endif
+}
@@ -7,76 +7,162 @@
 //
 
 #include "Decimator.h"
-#include "FIRFilter.h"
 #include "Dsp.h"
+#include "HalfbandFilter.h"
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 
 
-/* Upsampler **********************************************************/
+/* Input samples run through a cascade at a time */
+#define CASCADE_BLOCK (256)
+
+
+/* One polyphase FIR stage of a cascade */
+typedef struct _DecimatorStage
+{
+    unsigned    factor;
+    unsigned    n_taps;     // Prototype filter length
+    unsigned    phase;      // Input samples to drop before the next output
+    float*      kernel;     // Prototype filter, time reversed
+    float*      history;    // Last n_taps - 1 input samples, and room for as
+                            // many more
+} DecimatorStage;
+
+typedef struct _DecimatorStageD
+{
+    unsigned    factor;
+    unsigned    n_taps;
+    unsigned    phase;
+    double*     kernel;
+    double*     history;
+} DecimatorStageD;
+
+
+/* Static Function Prototypes */
+static int
+valid_mode(ResampleFactor_t factor, ResampleMode_t mode);
+
+static int
+tabulated(ResampleFactor_t factor, ResampleMode_t mode);
+
+static unsigned
+stage_count(ResampleFactor_t factor, ResampleMode_t mode);
+
+static unsigned
+scratch_length(ResampleFactor_t factor, ResampleMode_t mode);
+
+static DecimatorStage*
+init_fir_stages(ResampleFactor_t factor, ResampleMode_t mode);
+
+static DecimatorStageD*
+init_fir_stagesD(ResampleFactor_t factor, ResampleMode_t mode);
+
+static HalfbandFilter**
+init_iir_stages(unsigned n_stages);
+
+static HalfbandFilterD**
+init_iir_stagesD(unsigned n_stages);
+
+static void
+free_fir_stages(DecimatorStage* stages, unsigned n_stages);
+
+static void
+free_fir_stagesD(DecimatorStageD* stages, unsigned n_stages);
+
+static void
+free_iir_stages(HalfbandFilter** stages, unsigned n_stages);
+
+static void
+free_iir_stagesD(HalfbandFilterD** stages, unsigned n_stages);
+
+static unsigned
+fir_decimate(DecimatorStage* stage, float* outBuffer, const float* inBuffer, unsigned n_samples);
+
+static unsigned
+fir_decimateD(DecimatorStageD* stage, double* outBuffer, const double* inBuffer, unsigned n_samples);
+
+
+/* Decimator **********************************************************/
 struct Decimator
 {
-    unsigned factor;
-    FIRFilter** polyphase;
+    unsigned            factor;
+    unsigned            n_stages;
+    DecimatorStage*     fir;        // NULL in RESAMPLE_IIR mode
+    HalfbandFilter**    iir;        // NULL in the FIR modes
+    unsigned            n_scratch;  // Length of each scratch buffer
+    float*              scratch;    // Two buffers between stages
 };
 
 struct DecimatorD
 {
-    unsigned factor;
-    FIRFilterD** polyphase;
+    unsigned            factor;
+    unsigned            n_stages;
+    DecimatorStageD*    fir;
+    HalfbandFilterD**   iir;
+    unsigned            n_scratch;
+    double*             scratch;
 };
 
 /* DecimatorInit *******************************************************/
 Decimator*
 DecimatorInit(ResampleFactor_t factor)
 {
-    unsigned n_filters = 1;
-    switch(factor)
-    {
-        case X2:
-            n_filters = 2;
-            break;
-        case X4:
-            n_filters = 4;
-            break;
-        case X8:
-            n_filters = 8;
-            break;
-      /*  case X16:
-            n_filters = 16;
-            break; */
-        default:
-            return NULL;
-    }
+    return DecimatorInitMode(factor, RESAMPLE_FIR);
+}
 
-    // Allocate memory for the upsampler
-    Decimator* decimator = (Decimator*)malloc(sizeof(Decimator));
+DecimatorD*
+DecimatorInitD(ResampleFactor_t factor)
+{
+    return DecimatorInitModeD(factor, RESAMPLE_FIR);
+}
 
-    // Allocate memory for the polyphase array
-    FIRFilter** polyphase = (FIRFilter**)malloc(n_filters * sizeof(FIRFilter*));
 
-    if (decimator && polyphase)
+/* *****************************************************************************
+ DecimatorInitMode */
+Decimator*
+DecimatorInitMode(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    if (!valid_mode(factor, mode))
     {
-        decimator->polyphase = polyphase;
+        return NULL;
+    }
+    const unsigned n_stages = stage_count(factor, mode);
+    const unsigned n_scratch = scratch_length(factor, mode);
 
-        // Create polyphase filters
-        unsigned idx;
-        for(idx = 0; idx < n_filters; ++idx)
-        {
-            decimator->polyphase[idx] = FIRFilterInit(PolyphaseCoeffs[factor][idx], 64, DIRECT);
-        }
+    // Allocate memory for the decimator
+    Decimator* decimator = (Decimator*)malloc(sizeof(Decimator));
 
-        // Add factor
-        decimator->factor = n_filters;
+    // Allocate the stages, and the buffers between them
+    DecimatorStage* fir = (mode != RESAMPLE_IIR) ? init_fir_stages(factor, mode) : NULL;
+    HalfbandFilter** iir = (mode == RESAMPLE_IIR) ? init_iir_stages(n_stages) : NULL;
+    float* scratch = (n_scratch) ? (float*)malloc(2 * n_scratch * sizeof(float)) : NULL;
 
+    if (decimator && (fir || iir) && (scratch || !n_scratch))
+    {
+        decimator->factor = ResampleFactorValue(factor);
+        decimator->n_stages = n_stages;
+        decimator->fir = fir;
+        decimator->iir = iir;
+        decimator->n_scratch = n_scratch;
+        decimator->scratch = scratch;
+        DecimatorFlush(decimator);
         return decimator;
     }
     else
     {
-        if (polyphase)
+        if (scratch)
         {
-            free(polyphase);
+            free(scratch);
+        }
+        if (iir)
+        {
+            free_iir_stages(iir, n_stages);
+        }
+        if (fir)
+        {
+            free_fir_stages(fir, n_stages);
         }
         if (decimator)
         {
@@ -87,56 +173,47 @@ DecimatorInit(ResampleFactor_t factor)
 }
 
 DecimatorD*
-DecimatorInitD(ResampleFactor_t factor)
+DecimatorInitModeD(ResampleFactor_t factor, ResampleMode_t mode)
 {
-    unsigned n_filters = 1;
-    switch(factor)
-    {
-        case X2:
-            n_filters = 2;
-            break;
-        case X4:
-            n_filters = 4;
-            break;
-        case X8:
-            n_filters = 8;
-            break;
-        /*
-        case X16:
-            n_filters = 16;
-            break;
-        */
-        default:
-            return NULL;
+    if (!valid_mode(factor, mode))
+    {
+        return NULL;
     }
+    const unsigned n_stages = stage_count(factor, mode);
+    const unsigned n_scratch = scratch_length(factor, mode);
 
-    // Allocate memory for the upsampler
+    // Allocate memory for the decimator
     DecimatorD* decimator = (DecimatorD*)malloc(sizeof(DecimatorD));
 
-    // Allocate memory for the polyphase array
-    FIRFilterD** polyphase = (FIRFilterD**)malloc(n_filters * sizeof(FIRFilterD*));
+    // Allocate the stages, and the buffers between them
+    DecimatorStageD* fir = (mode != RESAMPLE_IIR) ? init_fir_stagesD(factor, mode) : NULL;
+    HalfbandFilterD** iir = (mode == RESAMPLE_IIR) ? init_iir_stagesD(n_stages) : NULL;
+    double* scratch = (n_scratch) ? (double*)malloc(2 * n_scratch * sizeof(double)) : NULL;
 
-    if (decimator && polyphase)
+    if (decimator && (fir || iir) && (scratch || !n_scratch))
     {
-        decimator->polyphase = polyphase;
-
-        // Create polyphase filters
-        unsigned idx;
-        for(idx = 0; idx < n_filters; ++idx)
-        {
-            decimator->polyphase[idx] = FIRFilterInitD(PolyphaseCoeffsD[factor][idx], 64, DIRECT);
-        }
-
-        // Add factor
-        decimator->factor = n_filters;
-
+        decimator->factor = ResampleFactorValue(factor);
+        decimator->n_stages = n_stages;
+        decimator->fir = fir;
+        decimator->iir = iir;
+        decimator->n_scratch = n_scratch;
+        decimator->scratch = scratch;
+        DecimatorFlushD(decimator);
         return decimator;
     }
     else
     {
-        if (polyphase)
+        if (scratch)
+        {
+            free(scratch);
+        }
+        if (iir)
         {
-            free(polyphase);
+            free_iir_stagesD(iir, n_stages);
+        }
+        if (fir)
+        {
+            free_fir_stagesD(fir, n_stages);
         }
         if (decimator)
         {
@@ -154,13 +231,17 @@ DecimatorFree(Decimator* decimator)
 {
     if (decimator)
     {
-        if (decimator->polyphase)
+        if (decimator->fir)
         {
-            for (unsigned i = 0; i < decimator->factor; ++i)
-            {
-                FIRFilterFree(decimator->polyphase[i]);
-            }
-            free(decimator->polyphase);
+            free_fir_stages(decimator->fir, decimator->n_stages);
+        }
+        if (decimator->iir)
+        {
+            free_iir_stages(decimator->iir, decimator->n_stages);
+        }
+        if (decimator->scratch)
+        {
+            free(decimator->scratch);
         }
         free(decimator);
     }
@@ -172,13 +253,17 @@ DecimatorFreeD(DecimatorD* decimator)
 {
     if (decimator)
     {
-        if (decimator->polyphase)
+        if (decimator->fir)
         {
-            for (unsigned i = 0; i < decimator->factor; ++i)
-            {
-                FIRFilterFreeD(decimator->polyphase[i]);
-            }
-            free(decimator->polyphase);
+            free_fir_stagesD(decimator->fir, decimator->n_stages);
+        }
+        if (decimator->iir)
+        {
+            free_iir_stagesD(decimator->iir, decimator->n_stages);
+        }
+        if (decimator->scratch)
+        {
+            free(decimator->scratch);
         }
         free(decimator);
     }
@@ -191,10 +276,17 @@ DecimatorFreeD(DecimatorD* decimator)
 Error_t
 DecimatorFlush(Decimator* decimator)
 {
-    unsigned idx;
-    for (idx = 0; idx < decimator->factor; ++idx)
+    for (unsigned s = 0; s < decimator->n_stages; ++s)
     {
-        FIRFilterFlush(decimator->polyphase[idx]);
+        if (decimator->fir)
+        {
+            ClearBuffer(decimator->fir[s].history, decimator->fir[s].n_taps - 1);
+            decimator->fir[s].phase = 0;
+        }
+        else
+        {
+            HalfbandFilterFlush(decimator->iir[s]);
+        }
     }
     return NOERR;
 }
@@ -202,10 +294,17 @@ DecimatorFlush(Decimator* decimator)
 Error_t
 DecimatorFlushD(DecimatorD* decimator)
 {
-    unsigned idx;
-    for (idx = 0; idx < decimator->factor; ++idx)
+    for (unsigned s = 0; s < decimator->n_stages; ++s)
     {
-        FIRFilterFlushD(decimator->polyphase[idx]);
+        if (decimator->fir)
+        {
+            ClearBufferD(decimator->fir[s].history, decimator->fir[s].n_taps - 1);
+            decimator->fir[s].phase = 0;
+        }
+        else
+        {
+            HalfbandFilterFlushD(decimator->iir[s]);
+        }
     }
     return NOERR;
 }
@@ -218,17 +317,31 @@ DecimatorProcess(Decimator      *decimator,
                  const float    *inBuffer,
                  unsigned       n_samples)
 {
-    if (decimator && outBuffer)
+    if (decimator && outBuffer && inBuffer)
     {
-        unsigned declen = n_samples / decimator->factor;
-        float temp_buf[declen];
-        ClearBuffer(outBuffer, declen);
-
-        for (unsigned filt = 0; filt < decimator->factor; ++filt)
+        // A cascade runs a block at a time through the scratch buffers, with
+        // the last stage writing the output. A single stage needn't split
+        const unsigned last = decimator->n_stages - 1;
+        const unsigned block = (last > 0) ? CASCADE_BLOCK : n_samples;
+        for (unsigned i = 0; i < n_samples; i += block)
         {
-            CopyBufferStride(temp_buf, 1, inBuffer, decimator->factor, declen);
-            FIRFilterProcess(decimator->polyphase[filt], temp_buf, temp_buf, declen);
-            VectorVectorAdd(outBuffer, (const float*)outBuffer, temp_buf, declen);
+            const float* src = inBuffer + i;
+            unsigned n = (n_samples - i < block) ? n_samples - i : block;
+            for (unsigned s = 0; s <= last; ++s)
+            {
+                float* dest = (s == last) ? outBuffer :
+                              decimator->scratch + (s % 2) * decimator->n_scratch;
+                if (decimator->fir)
+                {
+                    n = fir_decimate(decimator->fir + s, dest, src, n);
+                }
+                else
+                {
+                    HalfbandFilterDownsample(decimator->iir[s], dest, &n, src, n);
+                }
+                src = dest;
+            }
+            outBuffer += n;
         }
         return NOERR;
     }
@@ -245,17 +358,31 @@ DecimatorProcessD(DecimatorD*   decimator,
                   const double* inBuffer,
                   unsigned      n_samples)
 {
-    if (decimator && outBuffer)
+    if (decimator && outBuffer && inBuffer)
     {
-        unsigned declen = n_samples / decimator->factor;
-        double temp_buf[declen];
-        ClearBufferD(outBuffer, declen);
-
-        for (unsigned filt = 0; filt < decimator->factor; ++filt)
+        // A cascade runs a block at a time through the scratch buffers, with
+        // the last stage writing the output. A single stage needn't split
+        const unsigned last = decimator->n_stages - 1;
+        const unsigned block = (last > 0) ? CASCADE_BLOCK : n_samples;
+        for (unsigned i = 0; i < n_samples; i += block)
         {
-            CopyBufferStrideD(temp_buf, 1, inBuffer, decimator->factor, declen);
-            FIRFilterProcessD(decimator->polyphase[filt], temp_buf, temp_buf, declen);
-            VectorVectorAddD(outBuffer, (const double*)outBuffer, temp_buf, declen);
+            const double* src = inBuffer + i;
+            unsigned n = (n_samples - i < block) ? n_samples - i : block;
+            for (unsigned s = 0; s <= last; ++s)
+            {
+                double* dest = (s == last) ? outBuffer :
+                               decimator->scratch + (s % 2) * decimator->n_scratch;
+                if (decimator->fir)
+                {
+                    n = fir_decimateD(decimator->fir + s, dest, src, n);
+                }
+                else
+                {
+                    HalfbandFilterDownsampleD(decimator->iir[s], dest, &n, src, n);
+                }
+                src = dest;
+            }
+            outBuffer += n;
         }
         return NOERR;
     }
@@ -264,3 +391,297 @@ DecimatorProcessD(DecimatorD*   decimator,
         return NULL_PTR_ERROR;
     }
 }
+
+
+/* STATIC FUNCTION DEFINITIONS */
+
+/* The half-band IIR filters only resample by 2 */
+static int
+valid_mode(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    const unsigned n_stages = ResampleStageCount(factor);
+    if (n_stages == 0 || mode >= N_RESAMPLE_MODES)
+    {
+        return 0;
+    }
+    for (unsigned s = 0; mode == RESAMPLE_IIR && s < n_stages; ++s)
+    {
+        if (ResampleStageFactor(factor, s) != 2)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* RESAMPLE_FIR runs the tabulated filter where there is one */
+static int
+tabulated(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    return mode == RESAMPLE_FIR && PolyphaseCoeffs[factor] != NULL;
+}
+
+/* A tabulated filter is a single stage, the rest follow the cascade */
+static unsigned
+stage_count(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    return tabulated(factor, mode) ? 1 : ResampleStageCount(factor);
+}
+
+/* Longest output of the first stage run, for one block. The stages run from
+ the highest rate down, so that is the last stage of the design */
+static unsigned
+scratch_length(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    const unsigned n_stages = stage_count(factor, mode);
+    const unsigned first = ResampleStageFactor(factor, n_stages - 1);
+    return (n_stages > 1) ? CASCADE_BLOCK / first + 1 : 0;
+}
+
+/* Set up the FIR stages, in the order they run. Each prototype, tabulated or
+ designed, is kept whole and time reversed, so kernel[n_taps - 1 - (k * factor
+ + p)] is tap k of phase p, and each output is one dot product with the input
+ history */
+static DecimatorStage*
+init_fir_stages(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    const int table = tabulated(factor, mode);
+    const int minimum_phase = (mode == RESAMPLE_FIR_MINIMUM_PHASE);
+    const unsigned n_stages = stage_count(factor, mode);
+    DecimatorStage* stages = (DecimatorStage*)calloc(n_stages, sizeof(DecimatorStage));
+    if (!stages)
+    {
+        return NULL;
+    }
+
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        DecimatorStage* stage = stages + s;
+        const unsigned design = n_stages - 1 - s;
+        stage->factor = (table) ? ResampleFactorValue(factor) : ResampleStageFactor(factor, design);
+        stage->n_taps = stage->factor * ((table) ? POLYPHASE_TAPS : PolyphaseStageTaps(factor, design));
+        stage->kernel = (float*)malloc(stage->n_taps * sizeof(float));
+        stage->history = (float*)malloc(2 * (stage->n_taps - 1) * sizeof(float));
+        const Error_t err = (!stage->kernel) ? NULL_PTR_ERROR : (table) ?
+            PolyphaseTableKernel(stage->kernel, factor) :
+            PolyphaseStageDesign(stage->kernel, factor, design, minimum_phase);
+        if (!stage->history || err != NOERR)
+        {
+            free_fir_stages(stages, n_stages);
+            return NULL;
+        }
+        for (unsigned k = 0; k < stage->n_taps / 2; ++k)
+        {
+            const float tap = stage->kernel[k];
+            stage->kernel[k] = stage->kernel[stage->n_taps - 1 - k];
+            stage->kernel[stage->n_taps - 1 - k] = tap;
+        }
+    }
+    return stages;
+}
+
+static DecimatorStageD*
+init_fir_stagesD(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    const int table = tabulated(factor, mode);
+    const int minimum_phase = (mode == RESAMPLE_FIR_MINIMUM_PHASE);
+    const unsigned n_stages = stage_count(factor, mode);
+    DecimatorStageD* stages = (DecimatorStageD*)calloc(n_stages, sizeof(DecimatorStageD));
+    if (!stages)
+    {
+        return NULL;
+    }
+
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        DecimatorStageD* stage = stages + s;
+        const unsigned design = n_stages - 1 - s;
+        stage->factor = (table) ? ResampleFactorValue(factor) : ResampleStageFactor(factor, design);
+        stage->n_taps = stage->factor * ((table) ? POLYPHASE_TAPS : PolyphaseStageTaps(factor, design));
+        stage->kernel = (double*)malloc(stage->n_taps * sizeof(double));
+        stage->history = (double*)malloc(2 * (stage->n_taps - 1) * sizeof(double));
+        const Error_t err = (!stage->kernel) ? NULL_PTR_ERROR : (table) ?
+            PolyphaseTableKernelD(stage->kernel, factor) :
+            PolyphaseStageDesignD(stage->kernel, factor, design, minimum_phase);
+        if (!stage->history || err != NOERR)
+        {
+            free_fir_stagesD(stages, n_stages);
+            return NULL;
+        }
+        for (unsigned k = 0; k < stage->n_taps / 2; ++k)
+        {
+            const double tap = stage->kernel[k];
+            stage->kernel[k] = stage->kernel[stage->n_taps - 1 - k];
+            stage->kernel[stage->n_taps - 1 - k] = tap;
+        }
+    }
+    return stages;
+}
+
+/* Create the 2x stages of a cascade. Stage s of the cascade decimates to
+ 2^(n_stages - 1 - s) times the output rate */
+static HalfbandFilter**
+init_iir_stages(unsigned n_stages)
+{
+    HalfbandFilter** stages = (HalfbandFilter**)calloc(n_stages, sizeof(HalfbandFilter*));
+    if (stages)
+    {
+        for (unsigned s = 0; s < n_stages; ++s)
+        {
+            stages[s] = HalfbandFilterInitStage(n_stages - 1 - s);
+            if (!stages[s])
+            {
+                free_iir_stages(stages, n_stages);
+                return NULL;
+            }
+        }
+    }
+    return stages;
+}
+
+static HalfbandFilterD**
+init_iir_stagesD(unsigned n_stages)
+{
+    HalfbandFilterD** stages = (HalfbandFilterD**)calloc(n_stages, sizeof(HalfbandFilterD*));
+    if (stages)
+    {
+        for (unsigned s = 0; s < n_stages; ++s)
+        {
+            stages[s] = HalfbandFilterInitStageD(n_stages - 1 - s);
+            if (!stages[s])
+            {
+                free_iir_stagesD(stages, n_stages);
+                return NULL;
+            }
+        }
+    }
+    return stages;
+}
+
+static void
+free_fir_stages(DecimatorStage* stages, unsigned n_stages)
+{
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        if (stages[s].kernel)
+        {
+            free(stages[s].kernel);
+        }
+        if (stages[s].history)
+        {
+            free(stages[s].history);
+        }
+    }
+    free(stages);
+}
+
+static void
+free_fir_stagesD(DecimatorStageD* stages, unsigned n_stages)
+{
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        if (stages[s].kernel)
+        {
+            free(stages[s].kernel);
+        }
+        if (stages[s].history)
+        {
+            free(stages[s].history);
+        }
+    }
+    free(stages);
+}
+
+static void
+free_iir_stages(HalfbandFilter** stages, unsigned n_stages)
+{
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        HalfbandFilterFree(stages[s]);
+    }
+    free(stages);
+}
+
+static void
+free_iir_stagesD(HalfbandFilterD** stages, unsigned n_stages)
+{
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        HalfbandFilterFreeD(stages[s]);
+    }
+    free(stages);
+}
+
+/* Run one FIR stage, returning the number of samples written. Only the
+ retained outputs are computed */
+static unsigned
+fir_decimate(DecimatorStage* stage, float* outBuffer, const float* inBuffer, unsigned n_samples)
+{
+    const unsigned n_taps = stage->n_taps;
+    const unsigned n_history = n_taps - 1;
+    float* history = stage->history;
+    float* out = outBuffer;
+
+    // Output m is the dot product of the kernel with the n_taps input
+    // samples ending at sample t. Windows that start before this block
+    // run from the history, followed by a copy of the start of the input
+    const unsigned n_head = (n_samples < n_history) ? n_samples : n_history;
+    CopyBuffer(history + n_history, inBuffer, n_head);
+    unsigned t = stage->phase;
+    for (; t < n_head; t += stage->factor)
+    {
+        *out++ = VectorDotProduct(stage->kernel, history + t, n_taps);
+    }
+    for (; t < n_samples; t += stage->factor)
+    {
+        *out++ = VectorDotProduct(stage->kernel, inBuffer + t - n_history, n_taps);
+    }
+    stage->phase = t - n_samples;
+
+    // Keep the last n_history input samples
+    if (n_samples < n_history)
+    {
+        memmove(history, history + n_samples, n_history * sizeof(float));
+    }
+    else
+    {
+        CopyBuffer(history, inBuffer + n_samples - n_history, n_history);
+    }
+    return out - outBuffer;
+}
+
+static unsigned
+fir_decimateD(DecimatorStageD* stage, double* outBuffer, const double* inBuffer, unsigned n_samples)
+{
+    const unsigned n_taps = stage->n_taps;
+    const unsigned n_history = n_taps - 1;
+    double* history = stage->history;
+    double* out = outBuffer;
+
+    // Output m is the dot product of the kernel with the n_taps input
+    // samples ending at sample t. Windows that start before this block
+    // run from the history, followed by a copy of the start of the input
+    const unsigned n_head = (n_samples < n_history) ? n_samples : n_history;
+    CopyBufferD(history + n_history, inBuffer, n_head);
+    unsigned t = stage->phase;
+    for (; t < n_head; t += stage->factor)
+    {
+        *out++ = VectorDotProductD(stage->kernel, history + t, n_taps);
+    }
+    for (; t < n_samples; t += stage->factor)
+    {
+        *out++ = VectorDotProductD(stage->kernel, inBuffer + t - n_history, n_taps);
+    }
+    stage->phase = t - n_samples;
+
+    // Keep the last n_history input samples
+    if (n_samples < n_history)
+    {
+        memmove(history, history + n_samples, n_history * sizeof(double));
+    }
+    else
+    {
+        CopyBufferD(history, inBuffer + n_samples - n_history, n_history);
+    }
+    return out - outBuffer;
+}
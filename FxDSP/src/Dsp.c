@@ -16,6 +16,225 @@
 #include <cblas.h>
 #endif
 
+/* Without vDSP, direct convolution uses SIMD kernels that accumulate several
+ vectors of outputs at once. On x86 the AVX kernel is picked at run time when
+ the CPU supports it, with SSE2 as the baseline */
+#if !defined(__APPLE__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__SSE2__))
+#include <immintrin.h>
+#define CONVOLVE_X86
+#define CONVOLVE_HAS_AVX() (__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma"))
+#elif !defined(__APPLE__) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define CONVOLVE_NEON
+#endif
+
+/* Samples of zero-padded input built on the stack at a time for the edges of a
+ direct convolution, so stack use doesn't grow with the input length */
+#define CONVOLVE_CHUNK (1024)
+
+
+/* Static Function Prototypes */
+#ifdef CONVOLVE_X86
+__attribute__((target("avx,fma"))) static void
+convolve_avx(const float* padded, const float* kernel, unsigned kernel_length,
+             float* dest, unsigned length);
+
+__attribute__((target("avx,fma"))) static void
+convolve_avxD(const double* padded, const double* kernel, unsigned kernel_length,
+              double* dest, unsigned length);
+
+static void
+convolve_sse(const float* padded, const float* kernel, unsigned kernel_length,
+             float* dest, unsigned length);
+
+static void
+convolve_sseD(const double* padded, const double* kernel, unsigned kernel_length,
+              double* dest, unsigned length);
+
+__attribute__((target("avx,fma"))) static void
+convolve_symmetric_avx(const float* padded, const float* kernel, unsigned kernel_length,
+                       Symmetry_t symmetry, float* dest, unsigned length);
+
+__attribute__((target("avx,fma"))) static void
+convolve_symmetric_avxD(const double* padded, const double* kernel, unsigned kernel_length,
+                        Symmetry_t symmetry, double* dest, unsigned length);
+
+static void
+convolve_symmetric_sse(const float* padded, const float* kernel, unsigned kernel_length,
+                       Symmetry_t symmetry, float* dest, unsigned length);
+
+static void
+convolve_symmetric_sseD(const double* padded, const double* kernel, unsigned kernel_length,
+                        Symmetry_t symmetry, double* dest, unsigned length);
+
+__attribute__((target("avx,fma"))) static float
+dot_avx(const float* in1, const float* in2, unsigned length);
+
+__attribute__((target("avx,fma"))) static double
+dot_avxD(const double* in1, const double* in2, unsigned length);
+
+static float
+dot_sse(const float* in1, const float* in2, unsigned length);
+
+static double
+dot_sseD(const double* in1, const double* in2, unsigned length);
+
+__attribute__((target("avx,fma"))) static float
+lerp_dot_avx(const float* in, const float* kernel0, const float* kernel1,
+             float frac, unsigned length);
+
+__attribute__((target("avx,fma"))) static double
+lerp_dot_avxD(const double* in, const double* kernel0, const double* kernel1,
+              double frac, unsigned length);
+
+static float
+lerp_dot_sse(const float* in, const float* kernel0, const float* kernel1,
+             float frac, unsigned length);
+
+static double
+lerp_dot_sseD(const double* in, const double* kernel0, const double* kernel1,
+              double frac, unsigned length);
+
+__attribute__((target("avx,fma"))) static void
+convolve_polyphase_avx(const float* src, unsigned length, const float* kernels,
+                       unsigned kernel_length, unsigned n_kernels, float* dest);
+
+__attribute__((target("avx,fma"))) static void
+convolve_polyphase_avxD(const double* src, unsigned length, const double* kernels,
+                        unsigned kernel_length, unsigned n_kernels, double* dest);
+
+static void
+convolve_polyphase_sse(const float* src, unsigned length, const float* kernels,
+                       unsigned kernel_length, unsigned n_kernels, float* dest);
+
+static void
+convolve_polyphase_sseD(const double* src, unsigned length, const double* kernels,
+                        unsigned kernel_length, unsigned n_kernels, double* dest);
+
+__attribute__((target("avx,fma"))) static void
+iir_block_avx(float* dest, const float* src, unsigned blocks,
+              const float* block_coeffs, float* state);
+
+__attribute__((target("avx,fma"))) static void
+iir_block_avxD(double* dest, const double* src, unsigned blocks,
+               const double* block_coeffs, double* state);
+
+static void
+iir_block_sse(float* dest, const float* src, unsigned blocks,
+              const float* block_coeffs, float* state);
+
+static void
+iir_block_sseD(double* dest, const double* src, unsigned blocks,
+               const double* block_coeffs, double* state);
+
+#elif defined(CONVOLVE_NEON)
+static void
+convolve_neon(const float* padded, const float* kernel, unsigned kernel_length,
+              float* dest, unsigned length);
+
+static void
+convolve_neonD(const double* padded, const double* kernel, unsigned kernel_length,
+               double* dest, unsigned length);
+
+static void
+convolve_symmetric_neon(const float* padded, const float* kernel, unsigned kernel_length,
+                        Symmetry_t symmetry, float* dest, unsigned length);
+
+static void
+convolve_symmetric_neonD(const double* padded, const double* kernel, unsigned kernel_length,
+                         Symmetry_t symmetry, double* dest, unsigned length);
+
+static float
+dot_neon(const float* in1, const float* in2, unsigned length);
+
+static double
+dot_neonD(const double* in1, const double* in2, unsigned length);
+
+static float
+lerp_dot_neon(const float* in, const float* kernel0, const float* kernel1,
+              float frac, unsigned length);
+
+static double
+lerp_dot_neonD(const double* in, const double* kernel0, const double* kernel1,
+               double frac, unsigned length);
+
+static void
+convolve_polyphase_neon(const float* src, unsigned length, const float* kernels,
+                        unsigned kernel_length, unsigned n_kernels, float* dest);
+
+static void
+convolve_polyphase_neonD(const double* src, unsigned length, const double* kernels,
+                         unsigned kernel_length, unsigned n_kernels, double* dest);
+
+static void
+iir_block_neon(float* dest, const float* src, unsigned blocks,
+               const float* block_coeffs, float* state);
+
+static void
+iir_block_neonD(double* dest, const double* src, unsigned blocks,
+                const double* block_coeffs, double* state);
+#endif
+
+#ifndef __APPLE__
+static void
+convolve_padded(const float* padded, const float* kernel, unsigned kernel_length,
+                Symmetry_t symmetry, float* dest, unsigned length);
+
+static void
+convolve_paddedD(const double* padded, const double* kernel, unsigned kernel_length,
+                 Symmetry_t symmetry, double* dest, unsigned length);
+
+static void
+convolve_chunked(const float* in1, unsigned in1_length, const float* kernel,
+                 unsigned kernel_length, Symmetry_t symmetry, float* dest);
+
+static void
+convolve_chunkedD(const double* in1, unsigned in1_length, const double* kernel,
+                  unsigned kernel_length, Symmetry_t symmetry, double* dest);
+
+static void
+convolve_edge(const float* in1, unsigned in1_length, const float* kernel,
+              unsigned kernel_length, Symmetry_t symmetry, float* dest,
+              unsigned start, unsigned end);
+
+static void
+convolve_edgeD(const double* in1, unsigned in1_length, const double* kernel,
+               unsigned kernel_length, Symmetry_t symmetry, double* dest,
+               unsigned start, unsigned end);
+
+static void
+convolve_polyphase_tail(const float* src, unsigned start, unsigned length, const float* kernels,
+                        unsigned kernel_length, unsigned n_kernels, float* dest);
+
+static void
+convolve_polyphase_tailD(const double* src, unsigned start, unsigned length, const double* kernels,
+                         unsigned kernel_length, unsigned n_kernels, double* dest);
+#endif
+
+#if !defined(CONVOLVE_X86) && !defined(CONVOLVE_NEON)
+static void
+iir_block_generic(float* dest, const float* src, unsigned blocks,
+                  const float* block_coeffs, float* state);
+
+static void
+iir_block_genericD(double* dest, const double* src, unsigned blocks,
+                   const double* block_coeffs, double* state);
+#endif
+
+static void
+iir_block_state(float* state, const float* block_coeffs, const float* x, const float* y);
+
+static void
+iir_block_stateD(double* state, const double* block_coeffs, const double* x, const double* y);
+
+static void
+iir_block_tail(float* dest, const float* src, unsigned length,
+               const float* block_coeffs, float* state);
+
+static void
+iir_block_tailD(double* dest, const double* src, unsigned length,
+                const double* block_coeffs, double* state);
+
 
 /*******************************************************************************
  FloatBufferToInt16 */
@@ -689,6 +908,113 @@ VectorSumD(const double* src, unsigned length)
 }
 
 
+/*******************************************************************************
+ VectorDotProduct */
+float
+VectorDotProduct(const float* in1, const float* in2, unsigned length)
+{
+    float res = 0.0;
+#ifdef __APPLE__
+    // Use the Accelerate framework if we have it
+    vDSP_dotpr(in1, 1, in2, 1, &res, length);
+#elif defined(CONVOLVE_X86)
+    res = CONVOLVE_HAS_AVX() ? dot_avx(in1, in2, length) : dot_sse(in1, in2, length);
+#elif defined(CONVOLVE_NEON)
+    res = dot_neon(in1, in2, length);
+#else
+    for (unsigned i = 0; i < length; ++i)
+    {
+        res += in1[i] * in2[i];
+    }
+#endif
+    return res;
+}
+
+/*******************************************************************************
+ VectorDotProductD */
+double
+VectorDotProductD(const double* in1, const double* in2, unsigned length)
+{
+    double res = 0.0;
+#ifdef __APPLE__
+    // Use the Accelerate framework if we have it
+    vDSP_dotprD(in1, 1, in2, 1, &res, length);
+#elif defined(CONVOLVE_X86)
+    res = CONVOLVE_HAS_AVX() ? dot_avxD(in1, in2, length) : dot_sseD(in1, in2, length);
+#elif defined(CONVOLVE_NEON)
+    res = dot_neonD(in1, in2, length);
+#else
+    for (unsigned i = 0; i < length; ++i)
+    {
+        res += in1[i] * in2[i];
+    }
+#endif
+    return res;
+}
+
+/*******************************************************************************
+ VectorInterpolatedDotProduct */
+float
+VectorInterpolatedDotProduct(const float*   in,
+                             const float*   kernel0,
+                             const float*   kernel1,
+                             float          frac,
+                             unsigned       length)
+{
+#ifdef __APPLE__
+    // Use the Accelerate framework if we have it
+    float y0 = 0.0;
+    float y1 = 0.0;
+    vDSP_dotpr(in, 1, kernel0, 1, &y0, length);
+    vDSP_dotpr(in, 1, kernel1, 1, &y1, length);
+    return y0 + frac * (y1 - y0);
+#elif defined(CONVOLVE_X86)
+    return CONVOLVE_HAS_AVX() ? lerp_dot_avx(in, kernel0, kernel1, frac, length)
+                              : lerp_dot_sse(in, kernel0, kernel1, frac, length);
+#elif defined(CONVOLVE_NEON)
+    return lerp_dot_neon(in, kernel0, kernel1, frac, length);
+#else
+    float res = 0.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        res += in[i] * (kernel0[i] + frac * (kernel1[i] - kernel0[i]));
+    }
+    return res;
+#endif
+}
+
+/*******************************************************************************
+ VectorInterpolatedDotProductD */
+double
+VectorInterpolatedDotProductD(const double* in,
+                              const double* kernel0,
+                              const double* kernel1,
+                              double        frac,
+                              unsigned      length)
+{
+#ifdef __APPLE__
+    // Use the Accelerate framework if we have it
+    double y0 = 0.0;
+    double y1 = 0.0;
+    vDSP_dotprD(in, 1, kernel0, 1, &y0, length);
+    vDSP_dotprD(in, 1, kernel1, 1, &y1, length);
+    return y0 + frac * (y1 - y0);
+#elif defined(CONVOLVE_X86)
+    return CONVOLVE_HAS_AVX() ? lerp_dot_avxD(in, kernel0, kernel1, frac, length)
+                              : lerp_dot_sseD(in, kernel0, kernel1, frac, length);
+#elif defined(CONVOLVE_NEON)
+    return lerp_dot_neonD(in, kernel0, kernel1, frac, length);
+#else
+    double res = 0.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        res += in[i] * (kernel0[i] + frac * (kernel1[i] - kernel0[i]));
+    }
+    return res;
+#endif
+}
+
+
 /*******************************************************************************
  VectorMax */
 float
@@ -1396,7 +1722,9 @@ Convolve(float       *in1,
          float       *dest)
 {
 
+#if !defined(CONVOLVE_X86) && !defined(CONVOLVE_NEON)
     unsigned resultLength = in1_length + (in2_length - 1);
+#endif
 #ifdef __APPLE__
     //Use Native vectorized convolution function if available
     float    *in2_end = in2 + (in2_length - 1);
@@ -1411,6 +1739,9 @@ Convolve(float       *in1,
     cblas_scopy(in1_length, in1, 1, (padded + (in2_length - 1)), 1);
     vDSP_conv(padded, 1, in2_end, -1, dest, 1, resultLength, in2_length);
 
+#elif defined(CONVOLVE_X86) || defined(CONVOLVE_NEON)
+    convolve_chunked(in1, in1_length, in2, in2_length, ASYMMETRIC, dest);
+
 #else
     // Use (boring, slow) canonical implementation
     unsigned i;
@@ -1443,7 +1774,9 @@ ConvolveD(double    *in1,
           double    *dest)
 {
 
+#if !defined(CONVOLVE_X86) && !defined(CONVOLVE_NEON)
     unsigned resultLength = in1_length + (in2_length - 1);
+#endif
 
 #ifdef __APPLE__
     //Use Native vectorized convolution function if available
@@ -1462,6 +1795,9 @@ ConvolveD(double    *in1,
     cblas_dcopy(in1_length, in1, 1, (padded + (in2_length - 1)), 1);
     vDSP_convD(padded, 1, in2_end, -1, dest, 1, resultLength, in2_length);
 
+#elif defined(CONVOLVE_X86) || defined(CONVOLVE_NEON)
+    convolve_chunkedD(in1, in1_length, in2, in2_length, ASYMMETRIC, dest);
+
 #else
     // Use (boring, slow) canonical implementation
     unsigned i;
@@ -1485,177 +1821,490 @@ ConvolveD(double    *in1,
 
 
 /*******************************************************************************
- VectorDbConvert */
+ ConvolveSymmetric */
 Error_t
-VectorDbConvert(float* dest,
-                const float* in,
-                unsigned length)
+ConvolveSymmetric(float*     in1,
+                  unsigned   in1_length,
+                  float*     in2,
+                  unsigned   in2_length,
+                  Symmetry_t symmetry,
+                  float*     dest)
 {
 #ifdef __APPLE__
-    float one = 1.0;
-    vDSP_vdbcon(in, 1, &one, dest, 1, length, 1);
+    // vDSP is used for every kernel
+    return Convolve(in1, in1_length, in2, in2_length, dest);
+
 #else
-    for (unsigned i = 0; i < length; ++i)
+    if (symmetry == ASYMMETRIC)
     {
-        dest[i] = AMP_TO_DB(in[i]);
+        return Convolve(in1, in1_length, in2, in2_length, dest);
     }
-#endif
+
+    convolve_chunked(in1, in1_length, in2, in2_length, symmetry, dest);
     return NOERR;
+#endif
 }
 
+
+
 /*******************************************************************************
- VectorDbConvertD */
+ ConvolveSymmetricD */
 Error_t
-VectorDbConvertD(double*        dest,
-                 const double*  in,
-                 unsigned       length)
+ConvolveSymmetricD(double*    in1,
+                   unsigned   in1_length,
+                   double*    in2,
+                   unsigned   in2_length,
+                   Symmetry_t symmetry,
+                   double*    dest)
 {
 #ifdef __APPLE__
-    double one = 1.0;
-    vDSP_vdbconD(in, 1, &one, dest, 1, length, 1);
-#else
-    for (unsigned i = 0; i < length; ++i)
+    // vDSP is used for every kernel
+    return ConvolveD(in1, in1_length, in2, in2_length, dest);
 
+#else
+    if (symmetry == ASYMMETRIC)
     {
-        dest[i] = AMP_TO_DBD(in[i]);
+        return ConvolveD(in1, in1_length, in2, in2_length, dest);
     }
-#endif
+
+    convolve_chunkedD(in1, in1_length, in2, in2_length, symmetry, dest);
     return NOERR;
+#endif
 }
 
+
 /*******************************************************************************
- ComplexMultiply */
+ ConvolvePolyphase */
 Error_t
-ComplexMultiply(float*          re,
-                float*          im,
-                const float*    re1,
-                const float*    im1,
-                const float*    re2,
-                const float*    im2,
-                unsigned        length)
+ConvolvePolyphase(const float*  src,
+                  unsigned      length,
+                  const float*  kernels,
+                  unsigned      kernel_length,
+                  unsigned      n_kernels,
+                  float*        dest)
 {
-#if defined(__APPLE__)
-    DSPSplitComplex in1 = {.realp = (float*)re1, .imagp = (float*)im1};
-    DSPSplitComplex in2 = {.realp = (float*)re2, .imagp = (float*)im2};
-    DSPSplitComplex out = {.realp = re, .imagp = im};
-    vDSP_zvmul(&in1, 1, &in2, 1, &out, 1, length, 1);
-#else
-
-    for (unsigned i = 0; i < length; ++i)
+#ifdef __APPLE__
+    // Convolve with each kernel, writing every n_kernels-th output
+    for (unsigned p = 0; p < n_kernels; ++p)
     {
-        float ire1 = re1[i];
-        float iim1 = im1[i];
-        float ire2 = re2[i];
-        float iim2 = im2[i];
-        re[i] = (ire1 * ire2 - iim1 * iim2);
-        im[i] = (iim1 * ire2 + iim2 * ire1);
+        const float* kernel_end = kernels + (p + 1) * kernel_length - 1;
+        vDSP_conv(src, 1, kernel_end, -1, dest + p, n_kernels, length, kernel_length);
+    }
+#elif defined(CONVOLVE_X86)
+    if (CONVOLVE_HAS_AVX())
+    {
+        convolve_polyphase_avx(src, length, kernels, kernel_length, n_kernels, dest);
+    }
+    else
+    {
+        convolve_polyphase_sse(src, length, kernels, kernel_length, n_kernels, dest);
     }
+#elif defined(CONVOLVE_NEON)
+    convolve_polyphase_neon(src, length, kernels, kernel_length, n_kernels, dest);
+#else
+    convolve_polyphase_tail(src, 0, length, kernels, kernel_length, n_kernels, dest);
 #endif
     return NOERR;
 }
 
 
 /*******************************************************************************
- ComplexMultiplyD */
+ ConvolvePolyphaseD */
 Error_t
-ComplexMultiplyD(double*        re,
-                 double*        im,
-                 const double*  re1,
-                 const double*  im1,
-                 const double*  re2,
-                 const double*  im2,
-                 unsigned       length)
+ConvolvePolyphaseD(const double*    src,
+                   unsigned         length,
+                   const double*    kernels,
+                   unsigned         kernel_length,
+                   unsigned         n_kernels,
+                   double*          dest)
 {
-#if defined(__APPLE__)
-    DSPDoubleSplitComplex in1 = {.realp = (double*)re1, .imagp = (double*)im1};
-    DSPDoubleSplitComplex in2 = {.realp = (double*)re2, .imagp = (double*)im2};
-    DSPDoubleSplitComplex out = {.realp = re, .imagp = im};
-    vDSP_zvmulD(&in1, 1, &in2, 1, &out, 1, length, 1);
-#else
-    for (unsigned i = 0; i < length; ++i)
+#ifdef __APPLE__
+    // Convolve with each kernel, writing every n_kernels-th output
+    for (unsigned p = 0; p < n_kernels; ++p)
     {
-        double ire1 = re1[i];
-        double iim1 = im1[i];
-        double ire2 = re2[i];
-        double iim2 = im2[i];
-        re[i] = (ire1 * ire2 - iim1 * iim2);
-        im[i] = (iim1 * ire2 + iim2 * ire1);
+        const double* kernel_end = kernels + (p + 1) * kernel_length - 1;
+        vDSP_convD(src, 1, kernel_end, -1, dest + p, n_kernels, length, kernel_length);
+    }
+#elif defined(CONVOLVE_X86)
+    if (CONVOLVE_HAS_AVX())
+    {
+        convolve_polyphase_avxD(src, length, kernels, kernel_length, n_kernels, dest);
+    }
+    else
+    {
+        convolve_polyphase_sseD(src, length, kernels, kernel_length, n_kernels, dest);
     }
+#elif defined(CONVOLVE_NEON)
+    convolve_polyphase_neonD(src, length, kernels, kernel_length, n_kernels, dest);
+#else
+    convolve_polyphase_tailD(src, 0, length, kernels, kernel_length, n_kernels, dest);
 #endif
     return NOERR;
 }
 
 
 /*******************************************************************************
- VectorRectToPolar */
+ IIRBlockDesign */
 Error_t
-VectorRectToPolar(float*        magnitude,
-                  float*        phase,
-                  const float*  real,
-                  const float*  imaginary,
-                  unsigned      length)
+IIRBlockDesign(float* block_coeffs, const float* bCoeff, const float* aCoeff)
 {
-#ifdef __APPLE__
-    float dest[2*length];
-    SplitToInterleaved(dest, real, imaginary, length);
-    vDSP_polar(dest, 2, dest, 2, length);
-    InterleavedToSplit(magnitude, phase, dest, length);
-#else
-    unsigned i;
-    const unsigned end = 4 * (length / 4);
-    for (i = 0; i < end; i+=4)
-    {
-        RectToPolar(real[i], imaginary[i], &magnitude[i], &phase[i]);
-        RectToPolar(real[i+1], imaginary[i+1], &magnitude[i+1], &phase[i+1]);
-        RectToPolar(real[i+2], imaginary[i+2], &magnitude[i+2], &phase[i+2]);
-        RectToPolar(real[i+3], imaginary[i+3], &magnitude[i+3], &phase[i+3]);
-    }
-    for (i = end; i < length; ++i)
+    // Design in double precision, so the powers of the state matrix don't pick
+    // up rounding error
+    double block[IIR_BLOCK_COEFFS];
+    const double b[3] = {bCoeff[0], bCoeff[1], bCoeff[2]};
+    const double a[2] = {aCoeff[0], aCoeff[1]};
+    IIRBlockDesignD(block, b, a);
+    for (unsigned i = 0; i < IIR_BLOCK_COEFFS; ++i)
     {
-        RectToPolar(real[i], imaginary[i], &magnitude[i], &phase[i]);
+        block_coeffs[i] = (float)block[i];
     }
-#endif
     return NOERR;
 }
 
 
 /*******************************************************************************
- VectorRectToPolarD */
+ IIRBlockDesignD */
 Error_t
-VectorRectToPolarD(double*          magnitude,
-                   double*          phase,
-                   const double*    real,
-                   const double*    imaginary,
-                   unsigned         length)
+IIRBlockDesignD(double* block_coeffs, const double* bCoeff, const double* aCoeff)
 {
-#ifdef __APPLE__
-    double dest[2*length];
-    SplitToInterleavedD(dest, real, imaginary, length);
-    vDSP_polarD(dest, 2, dest, 2, length);
-    InterleavedToSplitD(magnitude, phase, dest, length);
-#else
-    unsigned i;
-    const unsigned end = 4 * (length / 4);
-    for (i = 0; i < end; i+=4)
-    {
-        RectToPolarD(real[i], imaginary[i], &magnitude[i], &phase[i]);
-        RectToPolarD(real[i+1], imaginary[i+1], &magnitude[i+1], &phase[i+1]);
-        RectToPolarD(real[i+2], imaginary[i+2], &magnitude[i+2], &phase[i+2]);
-        RectToPolarD(real[i+3], imaginary[i+3], &magnitude[i+3], &phase[i+3]);
-    }
-    for (i = end; i < length; ++i)
+    // Layout: the response of each output of a block to w0, then to w1, then
+    // the impulse response after IIR_BLOCK_LENGTH zeros, so column j of the
+    // input matrix starts at impulse - j, then the coefficients themselves
+    double* obs0 = block_coeffs;
+    double* obs1 = block_coeffs + IIR_BLOCK_LENGTH;
+    double* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    ClearBufferD(block_coeffs, IIR_BLOCK_COEFFS);
+
+    // Input vector of the state update, B = [b1 - a1b0, b2 - a2b0]
+    const double in0 = bCoeff[1] - aCoeff[0] * bCoeff[0];
+    const double in1 = bCoeff[2] - aCoeff[1] * bCoeff[0];
+
+    // Row i of the observability matrix is C A^i, with state matrix
+    // A = [[-a1, 1], [-a2, 0]] and output vector C = [1, 0]. The impulse
+    // response is h[0] = b0 and h[i + 1] = C A^i B
+    double row0 = 1.0;
+    double row1 = 0.0;
+    impulse[0] = bCoeff[0];
+    for (unsigned i = 0; i < IIR_BLOCK_LENGTH; ++i)
     {
-        RectToPolarD(real[i], imaginary[i], &magnitude[i], &phase[i]);
+        obs0[i] = row0;
+        obs1[i] = row1;
+        if (i + 1 < IIR_BLOCK_LENGTH)
+        {
+            impulse[i + 1] = row0 * in0 + row1 * in1;
+        }
+        const double next = -aCoeff[0] * row0 - aCoeff[1] * row1;
+        row1 = row0;
+        row0 = next;
     }
-#endif
+    CopyBufferD(block_coeffs + 4 * IIR_BLOCK_LENGTH, bCoeff, 3);
+    CopyBufferD(block_coeffs + 4 * IIR_BLOCK_LENGTH + 3, aCoeff, 2);
     return NOERR;
 }
 
 
 /*******************************************************************************
- MeanSquare */
-float
-MeanSquare(const float* data, unsigned length)
+ IIRBlockFilter */
+Error_t
+IIRBlockFilter(float*       dest,
+               const float* src,
+               unsigned     length,
+               const float* block_coeffs,
+               float*       state)
+{
+    const unsigned blocks = length / IIR_BLOCK_LENGTH;
+    const unsigned done = blocks * IIR_BLOCK_LENGTH;
+#if defined(CONVOLVE_X86)
+    if (CONVOLVE_HAS_AVX())
+    {
+        iir_block_avx(dest, src, blocks, block_coeffs, state);
+    }
+    else
+    {
+        iir_block_sse(dest, src, blocks, block_coeffs, state);
+    }
+#elif defined(CONVOLVE_NEON)
+    iir_block_neon(dest, src, blocks, block_coeffs, state);
+#else
+    iir_block_generic(dest, src, blocks, block_coeffs, state);
+#endif
+    iir_block_tail(dest + done, src + done, length - done, block_coeffs, state);
+    return NOERR;
+}
+
+
+/*******************************************************************************
+ IIRBlockFilterD */
+Error_t
+IIRBlockFilterD(double*         dest,
+                const double*   src,
+                unsigned        length,
+                const double*   block_coeffs,
+                double*         state)
+{
+    const unsigned blocks = length / IIR_BLOCK_LENGTH;
+    const unsigned done = blocks * IIR_BLOCK_LENGTH;
+#if defined(CONVOLVE_X86)
+    if (CONVOLVE_HAS_AVX())
+    {
+        iir_block_avxD(dest, src, blocks, block_coeffs, state);
+    }
+    else
+    {
+        iir_block_sseD(dest, src, blocks, block_coeffs, state);
+    }
+#elif defined(CONVOLVE_NEON)
+    iir_block_neonD(dest, src, blocks, block_coeffs, state);
+#else
+    iir_block_genericD(dest, src, blocks, block_coeffs, state);
+#endif
+    iir_block_tailD(dest + done, src + done, length - done, block_coeffs, state);
+    return NOERR;
+}
+
+
+/*******************************************************************************
+ KernelSymmetry */
+Symmetry_t
+KernelSymmetry(const float* kernel, unsigned length)
+{
+    // Allow for rounding in kernels that were designed symmetric
+    float peak = 0.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        peak = (fabsf(kernel[i]) > peak) ? fabsf(kernel[i]) : peak;
+    }
+    const float tolerance = FLT_EPSILON * peak;
+
+    unsigned symmetric = 1;
+    unsigned antisymmetric = 1;
+    for (unsigned i = 0; i < length / 2; ++i)
+    {
+        const float a = kernel[i];
+        const float b = kernel[length - 1 - i];
+        symmetric = symmetric && (fabsf(a - b) <= tolerance);
+        antisymmetric = antisymmetric && (fabsf(a + b) <= tolerance);
+    }
+    if (length % 2)
+    {
+        antisymmetric = antisymmetric && (fabsf(kernel[length / 2]) <= tolerance);
+    }
+
+    if (length < 2 || peak == 0.0)
+    {
+        return ASYMMETRIC;
+    }
+    return symmetric ? SYMMETRIC : (antisymmetric ? ANTISYMMETRIC : ASYMMETRIC);
+}
+
+
+/*******************************************************************************
+ KernelSymmetryD */
+Symmetry_t
+KernelSymmetryD(const double* kernel, unsigned length)
+{
+    // Allow for rounding in kernels that were designed symmetric
+    double peak = 0.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        peak = (fabs(kernel[i]) > peak) ? fabs(kernel[i]) : peak;
+    }
+    const double tolerance = DBL_EPSILON * peak;
+
+    unsigned symmetric = 1;
+    unsigned antisymmetric = 1;
+    for (unsigned i = 0; i < length / 2; ++i)
+    {
+        const double a = kernel[i];
+        const double b = kernel[length - 1 - i];
+        symmetric = symmetric && (fabs(a - b) <= tolerance);
+        antisymmetric = antisymmetric && (fabs(a + b) <= tolerance);
+    }
+    if (length % 2)
+    {
+        antisymmetric = antisymmetric && (fabs(kernel[length / 2]) <= tolerance);
+    }
+
+    if (length < 2 || peak == 0.0)
+    {
+        return ASYMMETRIC;
+    }
+    return symmetric ? SYMMETRIC : (antisymmetric ? ANTISYMMETRIC : ASYMMETRIC);
+}
+
+
+/*******************************************************************************
+ VectorDbConvert */
+Error_t
+VectorDbConvert(float* dest,
+                const float* in,
+                unsigned length)
+{
+#ifdef __APPLE__
+    float one = 1.0;
+    vDSP_vdbcon(in, 1, &one, dest, 1, length, 1);
+#else
+    for (unsigned i = 0; i < length; ++i)
+    {
+        dest[i] = AMP_TO_DB(in[i]);
+    }
+#endif
+    return NOERR;
+}
+
+/*******************************************************************************
+ VectorDbConvertD */
+Error_t
+VectorDbConvertD(double*        dest,
+                 const double*  in,
+                 unsigned       length)
+{
+#ifdef __APPLE__
+    double one = 1.0;
+    vDSP_vdbconD(in, 1, &one, dest, 1, length, 1);
+#else
+    for (unsigned i = 0; i < length; ++i)
+
+    {
+        dest[i] = AMP_TO_DBD(in[i]);
+    }
+#endif
+    return NOERR;
+}
+
+/*******************************************************************************
+ ComplexMultiply */
+Error_t
+ComplexMultiply(float*          re,
+                float*          im,
+                const float*    re1,
+                const float*    im1,
+                const float*    re2,
+                const float*    im2,
+                unsigned        length)
+{
+#if defined(__APPLE__)
+    DSPSplitComplex in1 = {.realp = (float*)re1, .imagp = (float*)im1};
+    DSPSplitComplex in2 = {.realp = (float*)re2, .imagp = (float*)im2};
+    DSPSplitComplex out = {.realp = re, .imagp = im};
+    vDSP_zvmul(&in1, 1, &in2, 1, &out, 1, length, 1);
+#else
+
+    for (unsigned i = 0; i < length; ++i)
+    {
+        float ire1 = re1[i];
+        float iim1 = im1[i];
+        float ire2 = re2[i];
+        float iim2 = im2[i];
+        re[i] = (ire1 * ire2 - iim1 * iim2);
+        im[i] = (iim1 * ire2 + iim2 * ire1);
+    }
+#endif
+    return NOERR;
+}
+
+
+/*******************************************************************************
+ ComplexMultiplyD */
+Error_t
+ComplexMultiplyD(double*        re,
+                 double*        im,
+                 const double*  re1,
+                 const double*  im1,
+                 const double*  re2,
+                 const double*  im2,
+                 unsigned       length)
+{
+#if defined(__APPLE__)
+    DSPDoubleSplitComplex in1 = {.realp = (double*)re1, .imagp = (double*)im1};
+    DSPDoubleSplitComplex in2 = {.realp = (double*)re2, .imagp = (double*)im2};
+    DSPDoubleSplitComplex out = {.realp = re, .imagp = im};
+    vDSP_zvmulD(&in1, 1, &in2, 1, &out, 1, length, 1);
+#else
+    for (unsigned i = 0; i < length; ++i)
+    {
+        double ire1 = re1[i];
+        double iim1 = im1[i];
+        double ire2 = re2[i];
+        double iim2 = im2[i];
+        re[i] = (ire1 * ire2 - iim1 * iim2);
+        im[i] = (iim1 * ire2 + iim2 * ire1);
+    }
+#endif
+    return NOERR;
+}
+
+
+/*******************************************************************************
+ VectorRectToPolar */
+Error_t
+VectorRectToPolar(float*        magnitude,
+                  float*        phase,
+                  const float*  real,
+                  const float*  imaginary,
+                  unsigned      length)
+{
+#ifdef __APPLE__
+    float dest[2*length];
+    SplitToInterleaved(dest, real, imaginary, length);
+    vDSP_polar(dest, 2, dest, 2, length);
+    InterleavedToSplit(magnitude, phase, dest, length);
+#else
+    unsigned i;
+    const unsigned end = 4 * (length / 4);
+    for (i = 0; i < end; i+=4)
+    {
+        RectToPolar(real[i], imaginary[i], &magnitude[i], &phase[i]);
+        RectToPolar(real[i+1], imaginary[i+1], &magnitude[i+1], &phase[i+1]);
+        RectToPolar(real[i+2], imaginary[i+2], &magnitude[i+2], &phase[i+2]);
+        RectToPolar(real[i+3], imaginary[i+3], &magnitude[i+3], &phase[i+3]);
+    }
+    for (i = end; i < length; ++i)
+    {
+        RectToPolar(real[i], imaginary[i], &magnitude[i], &phase[i]);
+    }
+#endif
+    return NOERR;
+}
+
+
+/*******************************************************************************
+ VectorRectToPolarD */
+Error_t
+VectorRectToPolarD(double*          magnitude,
+                   double*          phase,
+                   const double*    real,
+                   const double*    imaginary,
+                   unsigned         length)
+{
+#ifdef __APPLE__
+    double dest[2*length];
+    SplitToInterleavedD(dest, real, imaginary, length);
+    vDSP_polarD(dest, 2, dest, 2, length);
+    InterleavedToSplitD(magnitude, phase, dest, length);
+#else
+    unsigned i;
+    const unsigned end = 4 * (length / 4);
+    for (i = 0; i < end; i+=4)
+    {
+        RectToPolarD(real[i], imaginary[i], &magnitude[i], &phase[i]);
+        RectToPolarD(real[i+1], imaginary[i+1], &magnitude[i+1], &phase[i+1]);
+        RectToPolarD(real[i+2], imaginary[i+2], &magnitude[i+2], &phase[i+2]);
+        RectToPolarD(real[i+3], imaginary[i+3], &magnitude[i+3], &phase[i+3]);
+    }
+    for (i = end; i < length; ++i)
+    {
+        RectToPolarD(real[i], imaginary[i], &magnitude[i], &phase[i]);
+    }
+#endif
+    return NOERR;
+}
+
+
+/*******************************************************************************
+ MeanSquare */
+float
+MeanSquare(const float* data, unsigned length)
 {
     float result = 0.;
 #ifdef __APPLE__
@@ -1684,3 +2333,2446 @@ MeanSquareD(const double* data, unsigned length)
 #endif
     return result;
 }
+
+
+/*******************************************************************************
+ STATIC FUNCTION DEFINITIONS */
+
+#ifdef CONVOLVE_X86
+/* Direct convolution with AVX. padded holds the input with kernel_length - 1
+ zeros at each end. Each pass of the tap loop updates 32 outputs */
+__attribute__((target("avx,fma"))) static void
+convolve_avx(const float* padded, const float* kernel, unsigned kernel_length,
+             float* dest, unsigned length)
+{
+    const float* end = padded + (kernel_length - 1);
+    unsigned i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            const __m256 k = _mm256_broadcast_ss(kernel + j);
+            const float* x = end + i - j;
+            acc0 = _mm256_fmadd_ps(k, _mm256_loadu_ps(x), acc0);
+            acc1 = _mm256_fmadd_ps(k, _mm256_loadu_ps(x + 8), acc1);
+            acc2 = _mm256_fmadd_ps(k, _mm256_loadu_ps(x + 16), acc2);
+            acc3 = _mm256_fmadd_ps(k, _mm256_loadu_ps(x + 24), acc3);
+        }
+        _mm256_storeu_ps(dest + i, acc0);
+        _mm256_storeu_ps(dest + i + 8, acc1);
+        _mm256_storeu_ps(dest + i + 16, acc2);
+        _mm256_storeu_ps(dest + i + 24, acc3);
+    }
+    for (; i + 8 <= length; i += 8)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            acc = _mm256_fmadd_ps(_mm256_broadcast_ss(kernel + j),
+                                  _mm256_loadu_ps(end + i - j), acc);
+        }
+        _mm256_storeu_ps(dest + i, acc);
+    }
+    for (; i < length; ++i)
+    {
+        float sum = 0.0;
+        const float* x = padded + i;
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            sum += kernel[kernel_length - 1 - j] * x[j];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with AVX. padded holds the input with kernel_length - 1
+ zeros at each end. Each pass of the tap loop updates 16 outputs */
+__attribute__((target("avx,fma"))) static void
+convolve_avxD(const double* padded, const double* kernel, unsigned kernel_length,
+              double* dest, unsigned length)
+{
+    const double* end = padded + (kernel_length - 1);
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        __m256d acc2 = _mm256_setzero_pd();
+        __m256d acc3 = _mm256_setzero_pd();
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            const __m256d k = _mm256_broadcast_sd(kernel + j);
+            const double* x = end + i - j;
+            acc0 = _mm256_fmadd_pd(k, _mm256_loadu_pd(x), acc0);
+            acc1 = _mm256_fmadd_pd(k, _mm256_loadu_pd(x + 4), acc1);
+            acc2 = _mm256_fmadd_pd(k, _mm256_loadu_pd(x + 8), acc2);
+            acc3 = _mm256_fmadd_pd(k, _mm256_loadu_pd(x + 12), acc3);
+        }
+        _mm256_storeu_pd(dest + i, acc0);
+        _mm256_storeu_pd(dest + i + 4, acc1);
+        _mm256_storeu_pd(dest + i + 8, acc2);
+        _mm256_storeu_pd(dest + i + 12, acc3);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            acc = _mm256_fmadd_pd(_mm256_broadcast_sd(kernel + j),
+                                  _mm256_loadu_pd(end + i - j), acc);
+        }
+        _mm256_storeu_pd(dest + i, acc);
+    }
+    for (; i < length; ++i)
+    {
+        double sum = 0.0;
+        const double* x = padded + i;
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            sum += kernel[kernel_length - 1 - j] * x[j];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with SSE. padded holds the input with kernel_length - 1
+ zeros at each end. Each pass of the tap loop updates 16 outputs */
+static void
+convolve_sse(const float* padded, const float* kernel, unsigned kernel_length,
+             float* dest, unsigned length)
+{
+    const float* end = padded + (kernel_length - 1);
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps();
+        __m128 acc3 = _mm_setzero_ps();
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            const __m128 k = _mm_set1_ps(kernel[j]);
+            const float* x = end + i - j;
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(k, _mm_loadu_ps(x)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(k, _mm_loadu_ps(x + 4)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(k, _mm_loadu_ps(x + 8)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(k, _mm_loadu_ps(x + 12)));
+        }
+        _mm_storeu_ps(dest + i, acc0);
+        _mm_storeu_ps(dest + i + 4, acc1);
+        _mm_storeu_ps(dest + i + 8, acc2);
+        _mm_storeu_ps(dest + i + 12, acc3);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(kernel[j]),
+                                             _mm_loadu_ps(end + i - j)));
+        }
+        _mm_storeu_ps(dest + i, acc);
+    }
+    for (; i < length; ++i)
+    {
+        float sum = 0.0;
+        const float* x = padded + i;
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            sum += kernel[kernel_length - 1 - j] * x[j];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with SSE2. padded holds the input with kernel_length - 1
+ zeros at each end. Each pass of the tap loop updates 8 outputs */
+static void
+convolve_sseD(const double* padded, const double* kernel, unsigned kernel_length,
+              double* dest, unsigned length)
+{
+    const double* end = padded + (kernel_length - 1);
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128d acc0 = _mm_setzero_pd();
+        __m128d acc1 = _mm_setzero_pd();
+        __m128d acc2 = _mm_setzero_pd();
+        __m128d acc3 = _mm_setzero_pd();
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            const __m128d k = _mm_set1_pd(kernel[j]);
+            const double* x = end + i - j;
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(k, _mm_loadu_pd(x)));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(k, _mm_loadu_pd(x + 2)));
+            acc2 = _mm_add_pd(acc2, _mm_mul_pd(k, _mm_loadu_pd(x + 4)));
+            acc3 = _mm_add_pd(acc3, _mm_mul_pd(k, _mm_loadu_pd(x + 6)));
+        }
+        _mm_storeu_pd(dest + i, acc0);
+        _mm_storeu_pd(dest + i + 2, acc1);
+        _mm_storeu_pd(dest + i + 4, acc2);
+        _mm_storeu_pd(dest + i + 6, acc3);
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        __m128d acc = _mm_setzero_pd();
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(kernel[j]),
+                                             _mm_loadu_pd(end + i - j)));
+        }
+        _mm_storeu_pd(dest + i, acc);
+    }
+    for (; i < length; ++i)
+    {
+        double sum = 0.0;
+        const double* x = padded + i;
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            sum += kernel[kernel_length - 1 - j] * x[j];
+        }
+        dest[i] = sum;
+    }
+}
+
+
+/* Direct convolution with a symmetric or antisymmetric kernel, using AVX.
+ Input samples that share a coefficient are added, or subtracted, before the
+ multiply. Each pass of the tap loop updates 32 outputs */
+__attribute__((target("avx,fma"))) static void
+convolve_symmetric_avx(const float* padded, const float* kernel, unsigned kernel_length,
+                       Symmetry_t symmetry, float* dest, unsigned length)
+{
+    const unsigned half = kernel_length / 2;
+    const float* end = padded + (kernel_length - 1);
+    const __m256 mask = _mm256_set1_ps(symmetry == ANTISYMMETRIC ? -0.0f : 0.0f);
+    unsigned i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const __m256 k = _mm256_broadcast_ss(kernel + j);
+            const float* x = end + i - j;
+            const float* y = padded + i + j;
+            const __m256 y0 = _mm256_xor_ps(_mm256_loadu_ps(y), mask);
+            acc0 = _mm256_fmadd_ps(k, _mm256_add_ps(_mm256_loadu_ps(x), y0), acc0);
+            const __m256 y1 = _mm256_xor_ps(_mm256_loadu_ps(y + 8), mask);
+            acc1 = _mm256_fmadd_ps(k, _mm256_add_ps(_mm256_loadu_ps(x + 8), y1), acc1);
+            const __m256 y2 = _mm256_xor_ps(_mm256_loadu_ps(y + 16), mask);
+            acc2 = _mm256_fmadd_ps(k, _mm256_add_ps(_mm256_loadu_ps(x + 16), y2), acc2);
+            const __m256 y3 = _mm256_xor_ps(_mm256_loadu_ps(y + 24), mask);
+            acc3 = _mm256_fmadd_ps(k, _mm256_add_ps(_mm256_loadu_ps(x + 24), y3), acc3);
+        }
+        if (kernel_length % 2)
+        {
+            const __m256 k = _mm256_broadcast_ss(kernel + half);
+            const float* x = end + i - half;
+            acc0 = _mm256_fmadd_ps(k, _mm256_loadu_ps(x), acc0);
+            acc1 = _mm256_fmadd_ps(k, _mm256_loadu_ps(x + 8), acc1);
+            acc2 = _mm256_fmadd_ps(k, _mm256_loadu_ps(x + 16), acc2);
+            acc3 = _mm256_fmadd_ps(k, _mm256_loadu_ps(x + 24), acc3);
+        }
+        _mm256_storeu_ps(dest + i, acc0);
+        _mm256_storeu_ps(dest + i + 8, acc1);
+        _mm256_storeu_ps(dest + i + 16, acc2);
+        _mm256_storeu_ps(dest + i + 24, acc3);
+    }
+    for (; i + 8 <= length; i += 8)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const __m256 k = _mm256_broadcast_ss(kernel + j);
+            const __m256 y = _mm256_xor_ps(_mm256_loadu_ps(padded + i + j), mask);
+            acc = _mm256_fmadd_ps(k, _mm256_add_ps(_mm256_loadu_ps(end + i - j), y), acc);
+        }
+        if (kernel_length % 2)
+        {
+            const __m256 k = _mm256_broadcast_ss(kernel + half);
+            acc = _mm256_fmadd_ps(k, _mm256_loadu_ps(end + i - half), acc);
+        }
+        _mm256_storeu_ps(dest + i, acc);
+    }
+    const float mirror = (symmetry == ANTISYMMETRIC) ? -1.0 : 1.0;
+    for (; i < length; ++i)
+    {
+        float sum = 0.0;
+        const float* x = padded + i;
+        for (unsigned j = 0; j < half; ++j)
+        {
+            sum += kernel[j] * (x[kernel_length - 1 - j] + mirror * x[j]);
+        }
+        if (kernel_length % 2)
+        {
+            sum += kernel[half] * x[half];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with a symmetric or antisymmetric kernel, using AVX.
+ Input samples that share a coefficient are added, or subtracted, before the
+ multiply. Each pass of the tap loop updates 16 outputs */
+__attribute__((target("avx,fma"))) static void
+convolve_symmetric_avxD(const double* padded, const double* kernel, unsigned kernel_length,
+                        Symmetry_t symmetry, double* dest, unsigned length)
+{
+    const unsigned half = kernel_length / 2;
+    const double* end = padded + (kernel_length - 1);
+    const __m256d mask = _mm256_set1_pd(symmetry == ANTISYMMETRIC ? -0.0 : 0.0);
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        __m256d acc2 = _mm256_setzero_pd();
+        __m256d acc3 = _mm256_setzero_pd();
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const __m256d k = _mm256_broadcast_sd(kernel + j);
+            const double* x = end + i - j;
+            const double* y = padded + i + j;
+            const __m256d y0 = _mm256_xor_pd(_mm256_loadu_pd(y), mask);
+            acc0 = _mm256_fmadd_pd(k, _mm256_add_pd(_mm256_loadu_pd(x), y0), acc0);
+            const __m256d y1 = _mm256_xor_pd(_mm256_loadu_pd(y + 4), mask);
+            acc1 = _mm256_fmadd_pd(k, _mm256_add_pd(_mm256_loadu_pd(x + 4), y1), acc1);
+            const __m256d y2 = _mm256_xor_pd(_mm256_loadu_pd(y + 8), mask);
+            acc2 = _mm256_fmadd_pd(k, _mm256_add_pd(_mm256_loadu_pd(x + 8), y2), acc2);
+            const __m256d y3 = _mm256_xor_pd(_mm256_loadu_pd(y + 12), mask);
+            acc3 = _mm256_fmadd_pd(k, _mm256_add_pd(_mm256_loadu_pd(x + 12), y3), acc3);
+        }
+        if (kernel_length % 2)
+        {
+            const __m256d k = _mm256_broadcast_sd(kernel + half);
+            const double* x = end + i - half;
+            acc0 = _mm256_fmadd_pd(k, _mm256_loadu_pd(x), acc0);
+            acc1 = _mm256_fmadd_pd(k, _mm256_loadu_pd(x + 4), acc1);
+            acc2 = _mm256_fmadd_pd(k, _mm256_loadu_pd(x + 8), acc2);
+            acc3 = _mm256_fmadd_pd(k, _mm256_loadu_pd(x + 12), acc3);
+        }
+        _mm256_storeu_pd(dest + i, acc0);
+        _mm256_storeu_pd(dest + i + 4, acc1);
+        _mm256_storeu_pd(dest + i + 8, acc2);
+        _mm256_storeu_pd(dest + i + 12, acc3);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        __m256d acc = _mm256_setzero_pd();
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const __m256d k = _mm256_broadcast_sd(kernel + j);
+            const __m256d y = _mm256_xor_pd(_mm256_loadu_pd(padded + i + j), mask);
+            acc = _mm256_fmadd_pd(k, _mm256_add_pd(_mm256_loadu_pd(end + i - j), y), acc);
+        }
+        if (kernel_length % 2)
+        {
+            const __m256d k = _mm256_broadcast_sd(kernel + half);
+            acc = _mm256_fmadd_pd(k, _mm256_loadu_pd(end + i - half), acc);
+        }
+        _mm256_storeu_pd(dest + i, acc);
+    }
+    const double mirror = (symmetry == ANTISYMMETRIC) ? -1.0 : 1.0;
+    for (; i < length; ++i)
+    {
+        double sum = 0.0;
+        const double* x = padded + i;
+        for (unsigned j = 0; j < half; ++j)
+        {
+            sum += kernel[j] * (x[kernel_length - 1 - j] + mirror * x[j]);
+        }
+        if (kernel_length % 2)
+        {
+            sum += kernel[half] * x[half];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with a symmetric or antisymmetric kernel, using SSE.
+ Input samples that share a coefficient are added, or subtracted, before the
+ multiply. Each pass of the tap loop updates 16 outputs */
+static void
+convolve_symmetric_sse(const float* padded, const float* kernel, unsigned kernel_length,
+                       Symmetry_t symmetry, float* dest, unsigned length)
+{
+    const unsigned half = kernel_length / 2;
+    const float* end = padded + (kernel_length - 1);
+    const __m128 mask = _mm_set1_ps(symmetry == ANTISYMMETRIC ? -0.0f : 0.0f);
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        __m128 acc2 = _mm_setzero_ps();
+        __m128 acc3 = _mm_setzero_ps();
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const __m128 k = _mm_set1_ps(kernel[j]);
+            const float* x = end + i - j;
+            const float* y = padded + i + j;
+            const __m128 y0 = _mm_xor_ps(_mm_loadu_ps(y), mask);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(k, _mm_add_ps(_mm_loadu_ps(x), y0)));
+            const __m128 y1 = _mm_xor_ps(_mm_loadu_ps(y + 4), mask);
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(k, _mm_add_ps(_mm_loadu_ps(x + 4), y1)));
+            const __m128 y2 = _mm_xor_ps(_mm_loadu_ps(y + 8), mask);
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(k, _mm_add_ps(_mm_loadu_ps(x + 8), y2)));
+            const __m128 y3 = _mm_xor_ps(_mm_loadu_ps(y + 12), mask);
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(k, _mm_add_ps(_mm_loadu_ps(x + 12), y3)));
+        }
+        if (kernel_length % 2)
+        {
+            const __m128 k = _mm_set1_ps(kernel[half]);
+            const float* x = end + i - half;
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(k, _mm_loadu_ps(x)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(k, _mm_loadu_ps(x + 4)));
+            acc2 = _mm_add_ps(acc2, _mm_mul_ps(k, _mm_loadu_ps(x + 8)));
+            acc3 = _mm_add_ps(acc3, _mm_mul_ps(k, _mm_loadu_ps(x + 12)));
+        }
+        _mm_storeu_ps(dest + i, acc0);
+        _mm_storeu_ps(dest + i + 4, acc1);
+        _mm_storeu_ps(dest + i + 8, acc2);
+        _mm_storeu_ps(dest + i + 12, acc3);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const __m128 k = _mm_set1_ps(kernel[j]);
+            const __m128 y = _mm_xor_ps(_mm_loadu_ps(padded + i + j), mask);
+            acc = _mm_add_ps(acc, _mm_mul_ps(k, _mm_add_ps(_mm_loadu_ps(end + i - j), y)));
+        }
+        if (kernel_length % 2)
+        {
+            const __m128 k = _mm_set1_ps(kernel[half]);
+            acc = _mm_add_ps(acc, _mm_mul_ps(k, _mm_loadu_ps(end + i - half)));
+        }
+        _mm_storeu_ps(dest + i, acc);
+    }
+    const float mirror = (symmetry == ANTISYMMETRIC) ? -1.0 : 1.0;
+    for (; i < length; ++i)
+    {
+        float sum = 0.0;
+        const float* x = padded + i;
+        for (unsigned j = 0; j < half; ++j)
+        {
+            sum += kernel[j] * (x[kernel_length - 1 - j] + mirror * x[j]);
+        }
+        if (kernel_length % 2)
+        {
+            sum += kernel[half] * x[half];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with a symmetric or antisymmetric kernel, using SSE2.
+ Input samples that share a coefficient are added, or subtracted, before the
+ multiply. Each pass of the tap loop updates 8 outputs */
+static void
+convolve_symmetric_sseD(const double* padded, const double* kernel, unsigned kernel_length,
+                        Symmetry_t symmetry, double* dest, unsigned length)
+{
+    const unsigned half = kernel_length / 2;
+    const double* end = padded + (kernel_length - 1);
+    const __m128d mask = _mm_set1_pd(symmetry == ANTISYMMETRIC ? -0.0 : 0.0);
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        __m128d acc0 = _mm_setzero_pd();
+        __m128d acc1 = _mm_setzero_pd();
+        __m128d acc2 = _mm_setzero_pd();
+        __m128d acc3 = _mm_setzero_pd();
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const __m128d k = _mm_set1_pd(kernel[j]);
+            const double* x = end + i - j;
+            const double* y = padded + i + j;
+            const __m128d y0 = _mm_xor_pd(_mm_loadu_pd(y), mask);
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(k, _mm_add_pd(_mm_loadu_pd(x), y0)));
+            const __m128d y1 = _mm_xor_pd(_mm_loadu_pd(y + 2), mask);
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(k, _mm_add_pd(_mm_loadu_pd(x + 2), y1)));
+            const __m128d y2 = _mm_xor_pd(_mm_loadu_pd(y + 4), mask);
+            acc2 = _mm_add_pd(acc2, _mm_mul_pd(k, _mm_add_pd(_mm_loadu_pd(x + 4), y2)));
+            const __m128d y3 = _mm_xor_pd(_mm_loadu_pd(y + 6), mask);
+            acc3 = _mm_add_pd(acc3, _mm_mul_pd(k, _mm_add_pd(_mm_loadu_pd(x + 6), y3)));
+        }
+        if (kernel_length % 2)
+        {
+            const __m128d k = _mm_set1_pd(kernel[half]);
+            const double* x = end + i - half;
+            acc0 = _mm_add_pd(acc0, _mm_mul_pd(k, _mm_loadu_pd(x)));
+            acc1 = _mm_add_pd(acc1, _mm_mul_pd(k, _mm_loadu_pd(x + 2)));
+            acc2 = _mm_add_pd(acc2, _mm_mul_pd(k, _mm_loadu_pd(x + 4)));
+            acc3 = _mm_add_pd(acc3, _mm_mul_pd(k, _mm_loadu_pd(x + 6)));
+        }
+        _mm_storeu_pd(dest + i, acc0);
+        _mm_storeu_pd(dest + i + 2, acc1);
+        _mm_storeu_pd(dest + i + 4, acc2);
+        _mm_storeu_pd(dest + i + 6, acc3);
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        __m128d acc = _mm_setzero_pd();
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const __m128d k = _mm_set1_pd(kernel[j]);
+            const __m128d y = _mm_xor_pd(_mm_loadu_pd(padded + i + j), mask);
+            acc = _mm_add_pd(acc, _mm_mul_pd(k, _mm_add_pd(_mm_loadu_pd(end + i - j), y)));
+        }
+        if (kernel_length % 2)
+        {
+            const __m128d k = _mm_set1_pd(kernel[half]);
+            acc = _mm_add_pd(acc, _mm_mul_pd(k, _mm_loadu_pd(end + i - half)));
+        }
+        _mm_storeu_pd(dest + i, acc);
+    }
+    const double mirror = (symmetry == ANTISYMMETRIC) ? -1.0 : 1.0;
+    for (; i < length; ++i)
+    {
+        double sum = 0.0;
+        const double* x = padded + i;
+        for (unsigned j = 0; j < half; ++j)
+        {
+            sum += kernel[j] * (x[kernel_length - 1 - j] + mirror * x[j]);
+        }
+        if (kernel_length % 2)
+        {
+            sum += kernel[half] * x[half];
+        }
+        dest[i] = sum;
+    }
+}
+
+
+/* Dot product with AVX, with four accumulators to hide the FMA latency */
+__attribute__((target("avx,fma"))) static float
+dot_avx(const float* in1, const float* in2, unsigned length)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    unsigned i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(in1 + i), _mm256_loadu_ps(in2 + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(in1 + i + 8), _mm256_loadu_ps(in2 + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(in1 + i + 16), _mm256_loadu_ps(in2 + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(in1 + i + 24), _mm256_loadu_ps(in2 + i + 24), acc3);
+    }
+    for (; i + 8 <= length; i += 8)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(in1 + i), _mm256_loadu_ps(in2 + i), acc0);
+    }
+    const __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    float res = _mm_cvtss_f32(sum);
+    for (; i < length; ++i)
+    {
+        res += in1[i] * in2[i];
+    }
+    return res;
+}
+
+/* Dot product with AVX, with four accumulators to hide the FMA latency */
+__attribute__((target("avx,fma"))) static double
+dot_avxD(const double* in1, const double* in2, unsigned length)
+{
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd();
+    __m256d acc3 = _mm256_setzero_pd();
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(in1 + i), _mm256_loadu_pd(in2 + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(in1 + i + 4), _mm256_loadu_pd(in2 + i + 4), acc1);
+        acc2 = _mm256_fmadd_pd(_mm256_loadu_pd(in1 + i + 8), _mm256_loadu_pd(in2 + i + 8), acc2);
+        acc3 = _mm256_fmadd_pd(_mm256_loadu_pd(in1 + i + 12), _mm256_loadu_pd(in2 + i + 12), acc3);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(in1 + i), _mm256_loadu_pd(in2 + i), acc0);
+    }
+    const __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+    __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+    double res = _mm_cvtsd_f64(sum);
+    for (; i < length; ++i)
+    {
+        res += in1[i] * in2[i];
+    }
+    return res;
+}
+
+/* Dot product with SSE, with four accumulators to hide the add latency */
+static float
+dot_sse(const float* in1, const float* in2, unsigned length)
+{
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    __m128 acc2 = _mm_setzero_ps();
+    __m128 acc3 = _mm_setzero_ps();
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(in1 + i), _mm_loadu_ps(in2 + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(in1 + i + 4), _mm_loadu_ps(in2 + i + 4)));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(in1 + i + 8), _mm_loadu_ps(in2 + i + 8)));
+        acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(in1 + i + 12), _mm_loadu_ps(in2 + i + 12)));
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(in1 + i), _mm_loadu_ps(in2 + i)));
+    }
+    __m128 sum = _mm_add_ps(_mm_add_ps(acc0, acc1), _mm_add_ps(acc2, acc3));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    float res = _mm_cvtss_f32(sum);
+    for (; i < length; ++i)
+    {
+        res += in1[i] * in2[i];
+    }
+    return res;
+}
+
+/* Dot product with SSE2, with four accumulators to hide the add latency */
+static double
+dot_sseD(const double* in1, const double* in2, unsigned length)
+{
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+    __m128d acc2 = _mm_setzero_pd();
+    __m128d acc3 = _mm_setzero_pd();
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(in1 + i), _mm_loadu_pd(in2 + i)));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(in1 + i + 2), _mm_loadu_pd(in2 + i + 2)));
+        acc2 = _mm_add_pd(acc2, _mm_mul_pd(_mm_loadu_pd(in1 + i + 4), _mm_loadu_pd(in2 + i + 4)));
+        acc3 = _mm_add_pd(acc3, _mm_mul_pd(_mm_loadu_pd(in1 + i + 6), _mm_loadu_pd(in2 + i + 6)));
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(in1 + i), _mm_loadu_pd(in2 + i)));
+    }
+    __m128d sum = _mm_add_pd(_mm_add_pd(acc0, acc1), _mm_add_pd(acc2, acc3));
+    sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+    double res = _mm_cvtsd_f64(sum);
+    for (; i < length; ++i)
+    {
+        res += in1[i] * in2[i];
+    }
+    return res;
+}
+
+/* Interpolated dot product with AVX. Both kernels share the input loads,
+ and are blended before the horizontal sum */
+__attribute__((target("avx,fma"))) static float
+lerp_dot_avx(const float* in, const float* kernel0, const float* kernel1,
+             float frac, unsigned length)
+{
+    __m256 acc00 = _mm256_setzero_ps();
+    __m256 acc01 = _mm256_setzero_ps();
+    __m256 acc10 = _mm256_setzero_ps();
+    __m256 acc11 = _mm256_setzero_ps();
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m256 x0 = _mm256_loadu_ps(in + i);
+        const __m256 x1 = _mm256_loadu_ps(in + i + 8);
+        acc00 = _mm256_fmadd_ps(_mm256_loadu_ps(kernel0 + i), x0, acc00);
+        acc01 = _mm256_fmadd_ps(_mm256_loadu_ps(kernel0 + i + 8), x1, acc01);
+        acc10 = _mm256_fmadd_ps(_mm256_loadu_ps(kernel1 + i), x0, acc10);
+        acc11 = _mm256_fmadd_ps(_mm256_loadu_ps(kernel1 + i + 8), x1, acc11);
+    }
+    for (; i + 8 <= length; i += 8)
+    {
+        const __m256 x0 = _mm256_loadu_ps(in + i);
+        acc00 = _mm256_fmadd_ps(_mm256_loadu_ps(kernel0 + i), x0, acc00);
+        acc10 = _mm256_fmadd_ps(_mm256_loadu_ps(kernel1 + i), x0, acc10);
+    }
+    const __m256 y0 = _mm256_add_ps(acc00, acc01);
+    const __m256 y1 = _mm256_add_ps(acc10, acc11);
+    const __m256 acc = _mm256_fmadd_ps(_mm256_set1_ps(frac), _mm256_sub_ps(y1, y0), y0);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    float res = _mm_cvtss_f32(sum);
+    for (; i < length; ++i)
+    {
+        res += in[i] * (kernel0[i] + frac * (kernel1[i] - kernel0[i]));
+    }
+    return res;
+}
+
+/* Interpolated dot product with AVX. Both kernels share the input loads,
+ and are blended before the horizontal sum */
+__attribute__((target("avx,fma"))) static double
+lerp_dot_avxD(const double* in, const double* kernel0, const double* kernel1,
+              double frac, unsigned length)
+{
+    __m256d acc00 = _mm256_setzero_pd();
+    __m256d acc01 = _mm256_setzero_pd();
+    __m256d acc10 = _mm256_setzero_pd();
+    __m256d acc11 = _mm256_setzero_pd();
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        const __m256d x0 = _mm256_loadu_pd(in + i);
+        const __m256d x1 = _mm256_loadu_pd(in + i + 4);
+        acc00 = _mm256_fmadd_pd(_mm256_loadu_pd(kernel0 + i), x0, acc00);
+        acc01 = _mm256_fmadd_pd(_mm256_loadu_pd(kernel0 + i + 4), x1, acc01);
+        acc10 = _mm256_fmadd_pd(_mm256_loadu_pd(kernel1 + i), x0, acc10);
+        acc11 = _mm256_fmadd_pd(_mm256_loadu_pd(kernel1 + i + 4), x1, acc11);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        const __m256d x0 = _mm256_loadu_pd(in + i);
+        acc00 = _mm256_fmadd_pd(_mm256_loadu_pd(kernel0 + i), x0, acc00);
+        acc10 = _mm256_fmadd_pd(_mm256_loadu_pd(kernel1 + i), x0, acc10);
+    }
+    const __m256d y0 = _mm256_add_pd(acc00, acc01);
+    const __m256d y1 = _mm256_add_pd(acc10, acc11);
+    const __m256d acc = _mm256_fmadd_pd(_mm256_set1_pd(frac), _mm256_sub_pd(y1, y0), y0);
+    __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+    double res = _mm_cvtsd_f64(sum);
+    for (; i < length; ++i)
+    {
+        res += in[i] * (kernel0[i] + frac * (kernel1[i] - kernel0[i]));
+    }
+    return res;
+}
+
+/* Interpolated dot product with SSE. Both kernels share the input loads,
+ and are blended before the horizontal sum */
+static float
+lerp_dot_sse(const float* in, const float* kernel0, const float* kernel1,
+             float frac, unsigned length)
+{
+    __m128 acc00 = _mm_setzero_ps();
+    __m128 acc01 = _mm_setzero_ps();
+    __m128 acc10 = _mm_setzero_ps();
+    __m128 acc11 = _mm_setzero_ps();
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        const __m128 x0 = _mm_loadu_ps(in + i);
+        const __m128 x1 = _mm_loadu_ps(in + i + 4);
+        acc00 = _mm_add_ps(acc00, _mm_mul_ps(_mm_loadu_ps(kernel0 + i), x0));
+        acc01 = _mm_add_ps(acc01, _mm_mul_ps(_mm_loadu_ps(kernel0 + i + 4), x1));
+        acc10 = _mm_add_ps(acc10, _mm_mul_ps(_mm_loadu_ps(kernel1 + i), x0));
+        acc11 = _mm_add_ps(acc11, _mm_mul_ps(_mm_loadu_ps(kernel1 + i + 4), x1));
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        const __m128 x0 = _mm_loadu_ps(in + i);
+        acc00 = _mm_add_ps(acc00, _mm_mul_ps(_mm_loadu_ps(kernel0 + i), x0));
+        acc10 = _mm_add_ps(acc10, _mm_mul_ps(_mm_loadu_ps(kernel1 + i), x0));
+    }
+    const __m128 y0 = _mm_add_ps(acc00, acc01);
+    const __m128 y1 = _mm_add_ps(acc10, acc11);
+    const __m128 acc = _mm_add_ps(y0, _mm_mul_ps(_mm_set1_ps(frac), _mm_sub_ps(y1, y0)));
+    __m128 sum = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    float res = _mm_cvtss_f32(sum);
+    for (; i < length; ++i)
+    {
+        res += in[i] * (kernel0[i] + frac * (kernel1[i] - kernel0[i]));
+    }
+    return res;
+}
+
+/* Interpolated dot product with SSE2. Both kernels share the input loads,
+ and are blended before the horizontal sum */
+static double
+lerp_dot_sseD(const double* in, const double* kernel0, const double* kernel1,
+              double frac, unsigned length)
+{
+    __m128d acc00 = _mm_setzero_pd();
+    __m128d acc01 = _mm_setzero_pd();
+    __m128d acc10 = _mm_setzero_pd();
+    __m128d acc11 = _mm_setzero_pd();
+    unsigned i = 0;
+    for (; i + 4 <= length; i += 4)
+    {
+        const __m128d x0 = _mm_loadu_pd(in + i);
+        const __m128d x1 = _mm_loadu_pd(in + i + 2);
+        acc00 = _mm_add_pd(acc00, _mm_mul_pd(_mm_loadu_pd(kernel0 + i), x0));
+        acc01 = _mm_add_pd(acc01, _mm_mul_pd(_mm_loadu_pd(kernel0 + i + 2), x1));
+        acc10 = _mm_add_pd(acc10, _mm_mul_pd(_mm_loadu_pd(kernel1 + i), x0));
+        acc11 = _mm_add_pd(acc11, _mm_mul_pd(_mm_loadu_pd(kernel1 + i + 2), x1));
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        const __m128d x0 = _mm_loadu_pd(in + i);
+        acc00 = _mm_add_pd(acc00, _mm_mul_pd(_mm_loadu_pd(kernel0 + i), x0));
+        acc10 = _mm_add_pd(acc10, _mm_mul_pd(_mm_loadu_pd(kernel1 + i), x0));
+    }
+    const __m128d y0 = _mm_add_pd(acc00, acc01);
+    const __m128d y1 = _mm_add_pd(acc10, acc11);
+    const __m128d acc = _mm_add_pd(y0, _mm_mul_pd(_mm_set1_pd(frac), _mm_sub_pd(y1, y0)));
+    const __m128d sum = _mm_add_sd(acc, _mm_unpackhi_pd(acc, acc));
+    double res = _mm_cvtsd_f64(sum);
+    for (; i < length; ++i)
+    {
+        res += in[i] * (kernel0[i] + frac * (kernel1[i] - kernel0[i]));
+    }
+    return res;
+}
+
+/* Polyphase convolution with AVX. Each pass of the tap loop updates 32
+ outputs of two kernels, which share the input loads */
+__attribute__((target("avx,fma"))) static void
+convolve_polyphase_avx(const float* src, unsigned length, const float* kernels,
+                       unsigned kernel_length, unsigned n_kernels, float* dest)
+{
+    const float* end = src + (kernel_length - 1);
+    float out0[32];
+    float out1[32];
+    unsigned i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        unsigned p = 0;
+        for (; p + 2 <= n_kernels; p += 2)
+        {
+            const float* k0 = kernels + p * kernel_length;
+            const float* k1 = k0 + kernel_length;
+            __m256 acc00 = _mm256_setzero_ps();
+            __m256 acc01 = _mm256_setzero_ps();
+            __m256 acc02 = _mm256_setzero_ps();
+            __m256 acc03 = _mm256_setzero_ps();
+            __m256 acc10 = _mm256_setzero_ps();
+            __m256 acc11 = _mm256_setzero_ps();
+            __m256 acc12 = _mm256_setzero_ps();
+            __m256 acc13 = _mm256_setzero_ps();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const float* x = end + i - j;
+                const __m256 c0 = _mm256_broadcast_ss(k0 + j);
+                const __m256 c1 = _mm256_broadcast_ss(k1 + j);
+                const __m256 x0 = _mm256_loadu_ps(x);
+                const __m256 x1 = _mm256_loadu_ps(x + 8);
+                const __m256 x2 = _mm256_loadu_ps(x + 16);
+                const __m256 x3 = _mm256_loadu_ps(x + 24);
+                acc00 = _mm256_fmadd_ps(c0, x0, acc00);
+                acc01 = _mm256_fmadd_ps(c0, x1, acc01);
+                acc02 = _mm256_fmadd_ps(c0, x2, acc02);
+                acc03 = _mm256_fmadd_ps(c0, x3, acc03);
+                acc10 = _mm256_fmadd_ps(c1, x0, acc10);
+                acc11 = _mm256_fmadd_ps(c1, x1, acc11);
+                acc12 = _mm256_fmadd_ps(c1, x2, acc12);
+                acc13 = _mm256_fmadd_ps(c1, x3, acc13);
+            }
+            _mm256_storeu_ps(out0, acc00);
+            _mm256_storeu_ps(out0 + 8, acc01);
+            _mm256_storeu_ps(out0 + 16, acc02);
+            _mm256_storeu_ps(out0 + 24, acc03);
+            _mm256_storeu_ps(out1, acc10);
+            _mm256_storeu_ps(out1 + 8, acc11);
+            _mm256_storeu_ps(out1 + 16, acc12);
+            _mm256_storeu_ps(out1 + 24, acc13);
+            for (unsigned t = 0; t < 32; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+                dest[(i + t) * n_kernels + p + 1] = out1[t];
+            }
+        }
+        if (p < n_kernels)
+        {
+            const float* k0 = kernels + p * kernel_length;
+            __m256 acc00 = _mm256_setzero_ps();
+            __m256 acc01 = _mm256_setzero_ps();
+            __m256 acc02 = _mm256_setzero_ps();
+            __m256 acc03 = _mm256_setzero_ps();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const float* x = end + i - j;
+                const __m256 c0 = _mm256_broadcast_ss(k0 + j);
+                acc00 = _mm256_fmadd_ps(c0, _mm256_loadu_ps(x), acc00);
+                acc01 = _mm256_fmadd_ps(c0, _mm256_loadu_ps(x + 8), acc01);
+                acc02 = _mm256_fmadd_ps(c0, _mm256_loadu_ps(x + 16), acc02);
+                acc03 = _mm256_fmadd_ps(c0, _mm256_loadu_ps(x + 24), acc03);
+            }
+            _mm256_storeu_ps(out0, acc00);
+            _mm256_storeu_ps(out0 + 8, acc01);
+            _mm256_storeu_ps(out0 + 16, acc02);
+            _mm256_storeu_ps(out0 + 24, acc03);
+            for (unsigned t = 0; t < 32; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    for (; i + 8 <= length; i += 8)
+    {
+        const float* kernel = kernels;
+        for (unsigned p = 0; p < n_kernels; ++p, kernel += kernel_length)
+        {
+            __m256 acc = _mm256_setzero_ps();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                acc = _mm256_fmadd_ps(_mm256_broadcast_ss(kernel + j),
+                                      _mm256_loadu_ps(end + i - j), acc);
+            }
+            _mm256_storeu_ps(out0, acc);
+            for (unsigned t = 0; t < 8; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    convolve_polyphase_tail(src, i, length, kernels, kernel_length, n_kernels, dest);
+}
+
+/* Polyphase convolution with AVX. Each pass of the tap loop updates 16
+ outputs of two kernels, which share the input loads */
+__attribute__((target("avx,fma"))) static void
+convolve_polyphase_avxD(const double* src, unsigned length, const double* kernels,
+                        unsigned kernel_length, unsigned n_kernels, double* dest)
+{
+    const double* end = src + (kernel_length - 1);
+    double out0[16];
+    double out1[16];
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        unsigned p = 0;
+        for (; p + 2 <= n_kernels; p += 2)
+        {
+            const double* k0 = kernels + p * kernel_length;
+            const double* k1 = k0 + kernel_length;
+            __m256d acc00 = _mm256_setzero_pd();
+            __m256d acc01 = _mm256_setzero_pd();
+            __m256d acc02 = _mm256_setzero_pd();
+            __m256d acc03 = _mm256_setzero_pd();
+            __m256d acc10 = _mm256_setzero_pd();
+            __m256d acc11 = _mm256_setzero_pd();
+            __m256d acc12 = _mm256_setzero_pd();
+            __m256d acc13 = _mm256_setzero_pd();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const double* x = end + i - j;
+                const __m256d c0 = _mm256_broadcast_sd(k0 + j);
+                const __m256d c1 = _mm256_broadcast_sd(k1 + j);
+                const __m256d x0 = _mm256_loadu_pd(x);
+                const __m256d x1 = _mm256_loadu_pd(x + 4);
+                const __m256d x2 = _mm256_loadu_pd(x + 8);
+                const __m256d x3 = _mm256_loadu_pd(x + 12);
+                acc00 = _mm256_fmadd_pd(c0, x0, acc00);
+                acc01 = _mm256_fmadd_pd(c0, x1, acc01);
+                acc02 = _mm256_fmadd_pd(c0, x2, acc02);
+                acc03 = _mm256_fmadd_pd(c0, x3, acc03);
+                acc10 = _mm256_fmadd_pd(c1, x0, acc10);
+                acc11 = _mm256_fmadd_pd(c1, x1, acc11);
+                acc12 = _mm256_fmadd_pd(c1, x2, acc12);
+                acc13 = _mm256_fmadd_pd(c1, x3, acc13);
+            }
+            _mm256_storeu_pd(out0, acc00);
+            _mm256_storeu_pd(out0 + 4, acc01);
+            _mm256_storeu_pd(out0 + 8, acc02);
+            _mm256_storeu_pd(out0 + 12, acc03);
+            _mm256_storeu_pd(out1, acc10);
+            _mm256_storeu_pd(out1 + 4, acc11);
+            _mm256_storeu_pd(out1 + 8, acc12);
+            _mm256_storeu_pd(out1 + 12, acc13);
+            for (unsigned t = 0; t < 16; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+                dest[(i + t) * n_kernels + p + 1] = out1[t];
+            }
+        }
+        if (p < n_kernels)
+        {
+            const double* k0 = kernels + p * kernel_length;
+            __m256d acc00 = _mm256_setzero_pd();
+            __m256d acc01 = _mm256_setzero_pd();
+            __m256d acc02 = _mm256_setzero_pd();
+            __m256d acc03 = _mm256_setzero_pd();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const double* x = end + i - j;
+                const __m256d c0 = _mm256_broadcast_sd(k0 + j);
+                acc00 = _mm256_fmadd_pd(c0, _mm256_loadu_pd(x), acc00);
+                acc01 = _mm256_fmadd_pd(c0, _mm256_loadu_pd(x + 4), acc01);
+                acc02 = _mm256_fmadd_pd(c0, _mm256_loadu_pd(x + 8), acc02);
+                acc03 = _mm256_fmadd_pd(c0, _mm256_loadu_pd(x + 12), acc03);
+            }
+            _mm256_storeu_pd(out0, acc00);
+            _mm256_storeu_pd(out0 + 4, acc01);
+            _mm256_storeu_pd(out0 + 8, acc02);
+            _mm256_storeu_pd(out0 + 12, acc03);
+            for (unsigned t = 0; t < 16; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        const double* kernel = kernels;
+        for (unsigned p = 0; p < n_kernels; ++p, kernel += kernel_length)
+        {
+            __m256d acc = _mm256_setzero_pd();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                acc = _mm256_fmadd_pd(_mm256_broadcast_sd(kernel + j),
+                                      _mm256_loadu_pd(end + i - j), acc);
+            }
+            _mm256_storeu_pd(out0, acc);
+            for (unsigned t = 0; t < 4; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    convolve_polyphase_tailD(src, i, length, kernels, kernel_length, n_kernels, dest);
+}
+
+/* Polyphase convolution with SSE. Each pass of the tap loop updates 16
+ outputs of two kernels, which share the input loads */
+static void
+convolve_polyphase_sse(const float* src, unsigned length, const float* kernels,
+                       unsigned kernel_length, unsigned n_kernels, float* dest)
+{
+    const float* end = src + (kernel_length - 1);
+    float out0[16];
+    float out1[16];
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        unsigned p = 0;
+        for (; p + 2 <= n_kernels; p += 2)
+        {
+            const float* k0 = kernels + p * kernel_length;
+            const float* k1 = k0 + kernel_length;
+            __m128 acc00 = _mm_setzero_ps();
+            __m128 acc01 = _mm_setzero_ps();
+            __m128 acc02 = _mm_setzero_ps();
+            __m128 acc03 = _mm_setzero_ps();
+            __m128 acc10 = _mm_setzero_ps();
+            __m128 acc11 = _mm_setzero_ps();
+            __m128 acc12 = _mm_setzero_ps();
+            __m128 acc13 = _mm_setzero_ps();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const float* x = end + i - j;
+                const __m128 c0 = _mm_set1_ps(k0[j]);
+                const __m128 c1 = _mm_set1_ps(k1[j]);
+                const __m128 x0 = _mm_loadu_ps(x);
+                const __m128 x1 = _mm_loadu_ps(x + 4);
+                const __m128 x2 = _mm_loadu_ps(x + 8);
+                const __m128 x3 = _mm_loadu_ps(x + 12);
+                acc00 = _mm_add_ps(acc00, _mm_mul_ps(c0, x0));
+                acc01 = _mm_add_ps(acc01, _mm_mul_ps(c0, x1));
+                acc02 = _mm_add_ps(acc02, _mm_mul_ps(c0, x2));
+                acc03 = _mm_add_ps(acc03, _mm_mul_ps(c0, x3));
+                acc10 = _mm_add_ps(acc10, _mm_mul_ps(c1, x0));
+                acc11 = _mm_add_ps(acc11, _mm_mul_ps(c1, x1));
+                acc12 = _mm_add_ps(acc12, _mm_mul_ps(c1, x2));
+                acc13 = _mm_add_ps(acc13, _mm_mul_ps(c1, x3));
+            }
+            _mm_storeu_ps(out0, acc00);
+            _mm_storeu_ps(out0 + 4, acc01);
+            _mm_storeu_ps(out0 + 8, acc02);
+            _mm_storeu_ps(out0 + 12, acc03);
+            _mm_storeu_ps(out1, acc10);
+            _mm_storeu_ps(out1 + 4, acc11);
+            _mm_storeu_ps(out1 + 8, acc12);
+            _mm_storeu_ps(out1 + 12, acc13);
+            for (unsigned t = 0; t < 16; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+                dest[(i + t) * n_kernels + p + 1] = out1[t];
+            }
+        }
+        if (p < n_kernels)
+        {
+            const float* k0 = kernels + p * kernel_length;
+            __m128 acc00 = _mm_setzero_ps();
+            __m128 acc01 = _mm_setzero_ps();
+            __m128 acc02 = _mm_setzero_ps();
+            __m128 acc03 = _mm_setzero_ps();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const float* x = end + i - j;
+                const __m128 c0 = _mm_set1_ps(k0[j]);
+                acc00 = _mm_add_ps(acc00, _mm_mul_ps(c0, _mm_loadu_ps(x)));
+                acc01 = _mm_add_ps(acc01, _mm_mul_ps(c0, _mm_loadu_ps(x + 4)));
+                acc02 = _mm_add_ps(acc02, _mm_mul_ps(c0, _mm_loadu_ps(x + 8)));
+                acc03 = _mm_add_ps(acc03, _mm_mul_ps(c0, _mm_loadu_ps(x + 12)));
+            }
+            _mm_storeu_ps(out0, acc00);
+            _mm_storeu_ps(out0 + 4, acc01);
+            _mm_storeu_ps(out0 + 8, acc02);
+            _mm_storeu_ps(out0 + 12, acc03);
+            for (unsigned t = 0; t < 16; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        const float* kernel = kernels;
+        for (unsigned p = 0; p < n_kernels; ++p, kernel += kernel_length)
+        {
+            __m128 acc = _mm_setzero_ps();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(kernel[j]),
+                                                 _mm_loadu_ps(end + i - j)));
+            }
+            _mm_storeu_ps(out0, acc);
+            for (unsigned t = 0; t < 4; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    convolve_polyphase_tail(src, i, length, kernels, kernel_length, n_kernels, dest);
+}
+
+/* Polyphase convolution with SSE2. Each pass of the tap loop updates 8
+ outputs of two kernels, which share the input loads */
+static void
+convolve_polyphase_sseD(const double* src, unsigned length, const double* kernels,
+                        unsigned kernel_length, unsigned n_kernels, double* dest)
+{
+    const double* end = src + (kernel_length - 1);
+    double out0[8];
+    double out1[8];
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        unsigned p = 0;
+        for (; p + 2 <= n_kernels; p += 2)
+        {
+            const double* k0 = kernels + p * kernel_length;
+            const double* k1 = k0 + kernel_length;
+            __m128d acc00 = _mm_setzero_pd();
+            __m128d acc01 = _mm_setzero_pd();
+            __m128d acc02 = _mm_setzero_pd();
+            __m128d acc03 = _mm_setzero_pd();
+            __m128d acc10 = _mm_setzero_pd();
+            __m128d acc11 = _mm_setzero_pd();
+            __m128d acc12 = _mm_setzero_pd();
+            __m128d acc13 = _mm_setzero_pd();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const double* x = end + i - j;
+                const __m128d c0 = _mm_set1_pd(k0[j]);
+                const __m128d c1 = _mm_set1_pd(k1[j]);
+                const __m128d x0 = _mm_loadu_pd(x);
+                const __m128d x1 = _mm_loadu_pd(x + 2);
+                const __m128d x2 = _mm_loadu_pd(x + 4);
+                const __m128d x3 = _mm_loadu_pd(x + 6);
+                acc00 = _mm_add_pd(acc00, _mm_mul_pd(c0, x0));
+                acc01 = _mm_add_pd(acc01, _mm_mul_pd(c0, x1));
+                acc02 = _mm_add_pd(acc02, _mm_mul_pd(c0, x2));
+                acc03 = _mm_add_pd(acc03, _mm_mul_pd(c0, x3));
+                acc10 = _mm_add_pd(acc10, _mm_mul_pd(c1, x0));
+                acc11 = _mm_add_pd(acc11, _mm_mul_pd(c1, x1));
+                acc12 = _mm_add_pd(acc12, _mm_mul_pd(c1, x2));
+                acc13 = _mm_add_pd(acc13, _mm_mul_pd(c1, x3));
+            }
+            _mm_storeu_pd(out0, acc00);
+            _mm_storeu_pd(out0 + 2, acc01);
+            _mm_storeu_pd(out0 + 4, acc02);
+            _mm_storeu_pd(out0 + 6, acc03);
+            _mm_storeu_pd(out1, acc10);
+            _mm_storeu_pd(out1 + 2, acc11);
+            _mm_storeu_pd(out1 + 4, acc12);
+            _mm_storeu_pd(out1 + 6, acc13);
+            for (unsigned t = 0; t < 8; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+                dest[(i + t) * n_kernels + p + 1] = out1[t];
+            }
+        }
+        if (p < n_kernels)
+        {
+            const double* k0 = kernels + p * kernel_length;
+            __m128d acc00 = _mm_setzero_pd();
+            __m128d acc01 = _mm_setzero_pd();
+            __m128d acc02 = _mm_setzero_pd();
+            __m128d acc03 = _mm_setzero_pd();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const double* x = end + i - j;
+                const __m128d c0 = _mm_set1_pd(k0[j]);
+                acc00 = _mm_add_pd(acc00, _mm_mul_pd(c0, _mm_loadu_pd(x)));
+                acc01 = _mm_add_pd(acc01, _mm_mul_pd(c0, _mm_loadu_pd(x + 2)));
+                acc02 = _mm_add_pd(acc02, _mm_mul_pd(c0, _mm_loadu_pd(x + 4)));
+                acc03 = _mm_add_pd(acc03, _mm_mul_pd(c0, _mm_loadu_pd(x + 6)));
+            }
+            _mm_storeu_pd(out0, acc00);
+            _mm_storeu_pd(out0 + 2, acc01);
+            _mm_storeu_pd(out0 + 4, acc02);
+            _mm_storeu_pd(out0 + 6, acc03);
+            for (unsigned t = 0; t < 8; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        const double* kernel = kernels;
+        for (unsigned p = 0; p < n_kernels; ++p, kernel += kernel_length)
+        {
+            __m128d acc = _mm_setzero_pd();
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                acc = _mm_add_pd(acc, _mm_mul_pd(_mm_set1_pd(kernel[j]),
+                                                 _mm_loadu_pd(end + i - j)));
+            }
+            _mm_storeu_pd(out0, acc);
+            for (unsigned t = 0; t < 2; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    convolve_polyphase_tailD(src, i, length, kernels, kernel_length, n_kernels, dest);
+}
+
+/* Block state-space biquad with AVX. The input terms of a block don't depend
+ on the state, so only the two state terms and the state update are on the
+ recursion's critical path */
+__attribute__((target("avx,fma"))) static void
+iir_block_avx(float* dest, const float* src, unsigned blocks,
+              const float* block_coeffs, float* state)
+{
+    const float* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    const __m256 obs0 = _mm256_loadu_ps(block_coeffs);
+    const __m256 obs1 = _mm256_loadu_ps(block_coeffs + IIR_BLOCK_LENGTH);
+    for (unsigned k = 0; k < blocks; ++k)
+    {
+        const float* x = src + k * IIR_BLOCK_LENGTH;
+        float* y = dest + k * IIR_BLOCK_LENGTH;
+        const float last[2] = {x[IIR_BLOCK_LENGTH - 2], x[IIR_BLOCK_LENGTH - 1]};
+        __m256 acc = _mm256_setzero_ps();
+        for (unsigned j = 0; j < IIR_BLOCK_LENGTH; ++j)
+        {
+            acc = _mm256_fmadd_ps(_mm256_loadu_ps(impulse - j), _mm256_broadcast_ss(x + j), acc);
+        }
+        acc = _mm256_fmadd_ps(obs0, _mm256_broadcast_ss(state), acc);
+        acc = _mm256_fmadd_ps(obs1, _mm256_broadcast_ss(state + 1), acc);
+        _mm256_storeu_ps(y, acc);
+        iir_block_state(state, block_coeffs, last, y + IIR_BLOCK_LENGTH - 2);
+    }
+}
+
+/* Block state-space biquad with AVX. The input terms of a block don't depend
+ on the state, so only the two state terms and the state update are on the
+ recursion's critical path */
+__attribute__((target("avx,fma"))) static void
+iir_block_avxD(double* dest, const double* src, unsigned blocks,
+               const double* block_coeffs, double* state)
+{
+    const double* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    const __m256d obs00 = _mm256_loadu_pd(block_coeffs);
+    const __m256d obs01 = _mm256_loadu_pd(block_coeffs + 4);
+    const __m256d obs10 = _mm256_loadu_pd(block_coeffs + IIR_BLOCK_LENGTH);
+    const __m256d obs11 = _mm256_loadu_pd(block_coeffs + IIR_BLOCK_LENGTH + 4);
+    for (unsigned k = 0; k < blocks; ++k)
+    {
+        const double* x = src + k * IIR_BLOCK_LENGTH;
+        double* y = dest + k * IIR_BLOCK_LENGTH;
+        const double last[2] = {x[IIR_BLOCK_LENGTH - 2], x[IIR_BLOCK_LENGTH - 1]};
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        for (unsigned j = 0; j < IIR_BLOCK_LENGTH; ++j)
+        {
+            const __m256d in = _mm256_broadcast_sd(x + j);
+            acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(impulse - j), in, acc0);
+            acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(impulse - j + 4), in, acc1);
+        }
+        const __m256d w0 = _mm256_broadcast_sd(state);
+        const __m256d w1 = _mm256_broadcast_sd(state + 1);
+        acc0 = _mm256_fmadd_pd(obs10, w1, _mm256_fmadd_pd(obs00, w0, acc0));
+        acc1 = _mm256_fmadd_pd(obs11, w1, _mm256_fmadd_pd(obs01, w0, acc1));
+        _mm256_storeu_pd(y, acc0);
+        _mm256_storeu_pd(y + 4, acc1);
+        iir_block_stateD(state, block_coeffs, last, y + IIR_BLOCK_LENGTH - 2);
+    }
+}
+
+/* Block state-space biquad with SSE. The input terms of a block don't depend
+ on the state, so only the two state terms and the state update are on the
+ recursion's critical path */
+static void
+iir_block_sse(float* dest, const float* src, unsigned blocks,
+              const float* block_coeffs, float* state)
+{
+    const float* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    const __m128 obs00 = _mm_loadu_ps(block_coeffs);
+    const __m128 obs01 = _mm_loadu_ps(block_coeffs + 4);
+    const __m128 obs10 = _mm_loadu_ps(block_coeffs + IIR_BLOCK_LENGTH);
+    const __m128 obs11 = _mm_loadu_ps(block_coeffs + IIR_BLOCK_LENGTH + 4);
+    for (unsigned k = 0; k < blocks; ++k)
+    {
+        const float* x = src + k * IIR_BLOCK_LENGTH;
+        float* y = dest + k * IIR_BLOCK_LENGTH;
+        const float last[2] = {x[IIR_BLOCK_LENGTH - 2], x[IIR_BLOCK_LENGTH - 1]};
+        __m128 acc0 = _mm_setzero_ps();
+        __m128 acc1 = _mm_setzero_ps();
+        for (unsigned j = 0; j < IIR_BLOCK_LENGTH; ++j)
+        {
+            const __m128 in = _mm_set1_ps(x[j]);
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(impulse - j), in));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(impulse - j + 4), in));
+        }
+        const __m128 w0 = _mm_set1_ps(state[0]);
+        const __m128 w1 = _mm_set1_ps(state[1]);
+        acc0 = _mm_add_ps(acc0, _mm_add_ps(_mm_mul_ps(obs00, w0), _mm_mul_ps(obs10, w1)));
+        acc1 = _mm_add_ps(acc1, _mm_add_ps(_mm_mul_ps(obs01, w0), _mm_mul_ps(obs11, w1)));
+        _mm_storeu_ps(y, acc0);
+        _mm_storeu_ps(y + 4, acc1);
+        iir_block_state(state, block_coeffs, last, y + IIR_BLOCK_LENGTH - 2);
+    }
+}
+
+/* Block state-space biquad with SSE. The input terms of a block don't depend
+ on the state, so only the two state terms and the state update are on the
+ recursion's critical path */
+static void
+iir_block_sseD(double* dest, const double* src, unsigned blocks,
+               const double* block_coeffs, double* state)
+{
+    const double* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    for (unsigned k = 0; k < blocks; ++k)
+    {
+        const double* x = src + k * IIR_BLOCK_LENGTH;
+        double* y = dest + k * IIR_BLOCK_LENGTH;
+        const double last[2] = {x[IIR_BLOCK_LENGTH - 2], x[IIR_BLOCK_LENGTH - 1]};
+        __m128d acc[4];
+        for (unsigned t = 0; t < 4; ++t)
+        {
+            acc[t] = _mm_setzero_pd();
+        }
+        for (unsigned j = 0; j < IIR_BLOCK_LENGTH; ++j)
+        {
+            const __m128d in = _mm_set1_pd(x[j]);
+            for (unsigned t = 0; t < 4; ++t)
+            {
+                acc[t] = _mm_add_pd(acc[t], _mm_mul_pd(_mm_loadu_pd(impulse - j + 2 * t), in));
+            }
+        }
+        const __m128d w0 = _mm_set1_pd(state[0]);
+        const __m128d w1 = _mm_set1_pd(state[1]);
+        for (unsigned t = 0; t < 4; ++t)
+        {
+            const __m128d obs0 = _mm_loadu_pd(block_coeffs + 2 * t);
+            const __m128d obs1 = _mm_loadu_pd(block_coeffs + IIR_BLOCK_LENGTH + 2 * t);
+            acc[t] = _mm_add_pd(acc[t], _mm_add_pd(_mm_mul_pd(obs0, w0), _mm_mul_pd(obs1, w1)));
+            _mm_storeu_pd(y + 2 * t, acc[t]);
+        }
+        iir_block_stateD(state, block_coeffs, last, y + IIR_BLOCK_LENGTH - 2);
+    }
+}
+
+#elif defined(CONVOLVE_NEON)
+/* Direct convolution with NEON. padded holds the input with kernel_length - 1
+ zeros at each end. Each pass of the tap loop updates 16 outputs */
+static void
+convolve_neon(const float* padded, const float* kernel, unsigned kernel_length,
+              float* dest, unsigned length)
+{
+    const float* end = padded + (kernel_length - 1);
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        float32x4_t acc2 = vdupq_n_f32(0.0f);
+        float32x4_t acc3 = vdupq_n_f32(0.0f);
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            const float32x4_t k = vdupq_n_f32(kernel[j]);
+            const float* x = end + i - j;
+            acc0 = vfmaq_f32(acc0, k, vld1q_f32(x));
+            acc1 = vfmaq_f32(acc1, k, vld1q_f32(x + 4));
+            acc2 = vfmaq_f32(acc2, k, vld1q_f32(x + 8));
+            acc3 = vfmaq_f32(acc3, k, vld1q_f32(x + 12));
+        }
+        vst1q_f32(dest + i, acc0);
+        vst1q_f32(dest + i + 4, acc1);
+        vst1q_f32(dest + i + 8, acc2);
+        vst1q_f32(dest + i + 12, acc3);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            acc = vfmaq_f32(acc, vdupq_n_f32(kernel[j]), vld1q_f32(end + i - j));
+        }
+        vst1q_f32(dest + i, acc);
+    }
+    for (; i < length; ++i)
+    {
+        float sum = 0.0;
+        const float* x = padded + i;
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            sum += kernel[kernel_length - 1 - j] * x[j];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with NEON. padded holds the input with kernel_length - 1
+ zeros at each end. Each pass of the tap loop updates 8 outputs */
+static void
+convolve_neonD(const double* padded, const double* kernel, unsigned kernel_length,
+               double* dest, unsigned length)
+{
+    const double* end = padded + (kernel_length - 1);
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        float64x2_t acc0 = vdupq_n_f64(0.0);
+        float64x2_t acc1 = vdupq_n_f64(0.0);
+        float64x2_t acc2 = vdupq_n_f64(0.0);
+        float64x2_t acc3 = vdupq_n_f64(0.0);
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            const float64x2_t k = vdupq_n_f64(kernel[j]);
+            const double* x = end + i - j;
+            acc0 = vfmaq_f64(acc0, k, vld1q_f64(x));
+            acc1 = vfmaq_f64(acc1, k, vld1q_f64(x + 2));
+            acc2 = vfmaq_f64(acc2, k, vld1q_f64(x + 4));
+            acc3 = vfmaq_f64(acc3, k, vld1q_f64(x + 6));
+        }
+        vst1q_f64(dest + i, acc0);
+        vst1q_f64(dest + i + 2, acc1);
+        vst1q_f64(dest + i + 4, acc2);
+        vst1q_f64(dest + i + 6, acc3);
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        float64x2_t acc = vdupq_n_f64(0.0);
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            acc = vfmaq_f64(acc, vdupq_n_f64(kernel[j]), vld1q_f64(end + i - j));
+        }
+        vst1q_f64(dest + i, acc);
+    }
+    for (; i < length; ++i)
+    {
+        double sum = 0.0;
+        const double* x = padded + i;
+        for (unsigned j = 0; j < kernel_length; ++j)
+        {
+            sum += kernel[kernel_length - 1 - j] * x[j];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with a symmetric or antisymmetric kernel, using NEON.
+ Input samples that share a coefficient are added, or subtracted, before the
+ multiply. Each pass of the tap loop updates 16 outputs */
+static void
+convolve_symmetric_neon(const float* padded, const float* kernel, unsigned kernel_length,
+                        Symmetry_t symmetry, float* dest, unsigned length)
+{
+    const unsigned half = kernel_length / 2;
+    const float* end = padded + (kernel_length - 1);
+    const float32x4_t sign = vdupq_n_f32(symmetry == ANTISYMMETRIC ? -1.0f : 1.0f);
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        float32x4_t acc2 = vdupq_n_f32(0.0f);
+        float32x4_t acc3 = vdupq_n_f32(0.0f);
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const float32x4_t k = vdupq_n_f32(kernel[j]);
+            const float* x = end + i - j;
+            const float* y = padded + i + j;
+            const float32x4_t y0 = vmulq_f32(vld1q_f32(y), sign);
+            acc0 = vfmaq_f32(acc0, k, vaddq_f32(vld1q_f32(x), y0));
+            const float32x4_t y1 = vmulq_f32(vld1q_f32(y + 4), sign);
+            acc1 = vfmaq_f32(acc1, k, vaddq_f32(vld1q_f32(x + 4), y1));
+            const float32x4_t y2 = vmulq_f32(vld1q_f32(y + 8), sign);
+            acc2 = vfmaq_f32(acc2, k, vaddq_f32(vld1q_f32(x + 8), y2));
+            const float32x4_t y3 = vmulq_f32(vld1q_f32(y + 12), sign);
+            acc3 = vfmaq_f32(acc3, k, vaddq_f32(vld1q_f32(x + 12), y3));
+        }
+        if (kernel_length % 2)
+        {
+            const float32x4_t k = vdupq_n_f32(kernel[half]);
+            const float* x = end + i - half;
+            acc0 = vfmaq_f32(acc0, k, vld1q_f32(x));
+            acc1 = vfmaq_f32(acc1, k, vld1q_f32(x + 4));
+            acc2 = vfmaq_f32(acc2, k, vld1q_f32(x + 8));
+            acc3 = vfmaq_f32(acc3, k, vld1q_f32(x + 12));
+        }
+        vst1q_f32(dest + i, acc0);
+        vst1q_f32(dest + i + 4, acc1);
+        vst1q_f32(dest + i + 8, acc2);
+        vst1q_f32(dest + i + 12, acc3);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const float32x4_t k = vdupq_n_f32(kernel[j]);
+            const float32x4_t y = vmulq_f32(vld1q_f32(padded + i + j), sign);
+            acc = vfmaq_f32(acc, k, vaddq_f32(vld1q_f32(end + i - j), y));
+        }
+        if (kernel_length % 2)
+        {
+            const float32x4_t k = vdupq_n_f32(kernel[half]);
+            acc = vfmaq_f32(acc, k, vld1q_f32(end + i - half));
+        }
+        vst1q_f32(dest + i, acc);
+    }
+    const float mirror = (symmetry == ANTISYMMETRIC) ? -1.0 : 1.0;
+    for (; i < length; ++i)
+    {
+        float sum = 0.0;
+        const float* x = padded + i;
+        for (unsigned j = 0; j < half; ++j)
+        {
+            sum += kernel[j] * (x[kernel_length - 1 - j] + mirror * x[j]);
+        }
+        if (kernel_length % 2)
+        {
+            sum += kernel[half] * x[half];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Direct convolution with a symmetric or antisymmetric kernel, using NEON.
+ Input samples that share a coefficient are added, or subtracted, before the
+ multiply. Each pass of the tap loop updates 8 outputs */
+static void
+convolve_symmetric_neonD(const double* padded, const double* kernel, unsigned kernel_length,
+                         Symmetry_t symmetry, double* dest, unsigned length)
+{
+    const unsigned half = kernel_length / 2;
+    const double* end = padded + (kernel_length - 1);
+    const float64x2_t sign = vdupq_n_f64(symmetry == ANTISYMMETRIC ? -1.0 : 1.0);
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        float64x2_t acc0 = vdupq_n_f64(0.0);
+        float64x2_t acc1 = vdupq_n_f64(0.0);
+        float64x2_t acc2 = vdupq_n_f64(0.0);
+        float64x2_t acc3 = vdupq_n_f64(0.0);
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const float64x2_t k = vdupq_n_f64(kernel[j]);
+            const double* x = end + i - j;
+            const double* y = padded + i + j;
+            const float64x2_t y0 = vmulq_f64(vld1q_f64(y), sign);
+            acc0 = vfmaq_f64(acc0, k, vaddq_f64(vld1q_f64(x), y0));
+            const float64x2_t y1 = vmulq_f64(vld1q_f64(y + 2), sign);
+            acc1 = vfmaq_f64(acc1, k, vaddq_f64(vld1q_f64(x + 2), y1));
+            const float64x2_t y2 = vmulq_f64(vld1q_f64(y + 4), sign);
+            acc2 = vfmaq_f64(acc2, k, vaddq_f64(vld1q_f64(x + 4), y2));
+            const float64x2_t y3 = vmulq_f64(vld1q_f64(y + 6), sign);
+            acc3 = vfmaq_f64(acc3, k, vaddq_f64(vld1q_f64(x + 6), y3));
+        }
+        if (kernel_length % 2)
+        {
+            const float64x2_t k = vdupq_n_f64(kernel[half]);
+            const double* x = end + i - half;
+            acc0 = vfmaq_f64(acc0, k, vld1q_f64(x));
+            acc1 = vfmaq_f64(acc1, k, vld1q_f64(x + 2));
+            acc2 = vfmaq_f64(acc2, k, vld1q_f64(x + 4));
+            acc3 = vfmaq_f64(acc3, k, vld1q_f64(x + 6));
+        }
+        vst1q_f64(dest + i, acc0);
+        vst1q_f64(dest + i + 2, acc1);
+        vst1q_f64(dest + i + 4, acc2);
+        vst1q_f64(dest + i + 6, acc3);
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        float64x2_t acc = vdupq_n_f64(0.0);
+        for (unsigned j = 0; j < half; ++j)
+        {
+            const float64x2_t k = vdupq_n_f64(kernel[j]);
+            const float64x2_t y = vmulq_f64(vld1q_f64(padded + i + j), sign);
+            acc = vfmaq_f64(acc, k, vaddq_f64(vld1q_f64(end + i - j), y));
+        }
+        if (kernel_length % 2)
+        {
+            const float64x2_t k = vdupq_n_f64(kernel[half]);
+            acc = vfmaq_f64(acc, k, vld1q_f64(end + i - half));
+        }
+        vst1q_f64(dest + i, acc);
+    }
+    const double mirror = (symmetry == ANTISYMMETRIC) ? -1.0 : 1.0;
+    for (; i < length; ++i)
+    {
+        double sum = 0.0;
+        const double* x = padded + i;
+        for (unsigned j = 0; j < half; ++j)
+        {
+            sum += kernel[j] * (x[kernel_length - 1 - j] + mirror * x[j]);
+        }
+        if (kernel_length % 2)
+        {
+            sum += kernel[half] * x[half];
+        }
+        dest[i] = sum;
+    }
+}
+
+/* Dot product with NEON, with four accumulators to hide the FMA latency */
+static float
+dot_neon(const float* in1, const float* in2, unsigned length)
+{
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(in1 + i), vld1q_f32(in2 + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(in1 + i + 4), vld1q_f32(in2 + i + 4));
+        acc2 = vfmaq_f32(acc2, vld1q_f32(in1 + i + 8), vld1q_f32(in2 + i + 8));
+        acc3 = vfmaq_f32(acc3, vld1q_f32(in1 + i + 12), vld1q_f32(in2 + i + 12));
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(in1 + i), vld1q_f32(in2 + i));
+    }
+    float res = vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+    for (; i < length; ++i)
+    {
+        res += in1[i] * in2[i];
+    }
+    return res;
+}
+
+/* Dot product with NEON, with four accumulators to hide the FMA latency */
+static double
+dot_neonD(const double* in1, const double* in2, unsigned length)
+{
+    float64x2_t acc0 = vdupq_n_f64(0.0);
+    float64x2_t acc1 = vdupq_n_f64(0.0);
+    float64x2_t acc2 = vdupq_n_f64(0.0);
+    float64x2_t acc3 = vdupq_n_f64(0.0);
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        acc0 = vfmaq_f64(acc0, vld1q_f64(in1 + i), vld1q_f64(in2 + i));
+        acc1 = vfmaq_f64(acc1, vld1q_f64(in1 + i + 2), vld1q_f64(in2 + i + 2));
+        acc2 = vfmaq_f64(acc2, vld1q_f64(in1 + i + 4), vld1q_f64(in2 + i + 4));
+        acc3 = vfmaq_f64(acc3, vld1q_f64(in1 + i + 6), vld1q_f64(in2 + i + 6));
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        acc0 = vfmaq_f64(acc0, vld1q_f64(in1 + i), vld1q_f64(in2 + i));
+    }
+    double res = vaddvq_f64(vaddq_f64(vaddq_f64(acc0, acc1), vaddq_f64(acc2, acc3)));
+    for (; i < length; ++i)
+    {
+        res += in1[i] * in2[i];
+    }
+    return res;
+}
+
+/* Interpolated dot product with NEON. Both kernels share the input loads,
+ and are blended before the horizontal sum */
+static float
+lerp_dot_neon(const float* in, const float* kernel0, const float* kernel1,
+              float frac, unsigned length)
+{
+    float32x4_t acc00 = vdupq_n_f32(0.0f);
+    float32x4_t acc01 = vdupq_n_f32(0.0f);
+    float32x4_t acc10 = vdupq_n_f32(0.0f);
+    float32x4_t acc11 = vdupq_n_f32(0.0f);
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        const float32x4_t x0 = vld1q_f32(in + i);
+        const float32x4_t x1 = vld1q_f32(in + i + 4);
+        acc00 = vfmaq_f32(acc00, vld1q_f32(kernel0 + i), x0);
+        acc01 = vfmaq_f32(acc01, vld1q_f32(kernel0 + i + 4), x1);
+        acc10 = vfmaq_f32(acc10, vld1q_f32(kernel1 + i), x0);
+        acc11 = vfmaq_f32(acc11, vld1q_f32(kernel1 + i + 4), x1);
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        const float32x4_t x0 = vld1q_f32(in + i);
+        acc00 = vfmaq_f32(acc00, vld1q_f32(kernel0 + i), x0);
+        acc10 = vfmaq_f32(acc10, vld1q_f32(kernel1 + i), x0);
+    }
+    const float32x4_t y0 = vaddq_f32(acc00, acc01);
+    const float32x4_t y1 = vaddq_f32(acc10, acc11);
+    const float32x4_t acc = vfmaq_f32(y0, vdupq_n_f32(frac), vsubq_f32(y1, y0));
+    float res = vaddvq_f32(acc);
+    for (; i < length; ++i)
+    {
+        res += in[i] * (kernel0[i] + frac * (kernel1[i] - kernel0[i]));
+    }
+    return res;
+}
+
+/* Interpolated dot product with NEON. Both kernels share the input loads,
+ and are blended before the horizontal sum */
+static double
+lerp_dot_neonD(const double* in, const double* kernel0, const double* kernel1,
+               double frac, unsigned length)
+{
+    float64x2_t acc00 = vdupq_n_f64(0.0);
+    float64x2_t acc01 = vdupq_n_f64(0.0);
+    float64x2_t acc10 = vdupq_n_f64(0.0);
+    float64x2_t acc11 = vdupq_n_f64(0.0);
+    unsigned i = 0;
+    for (; i + 4 <= length; i += 4)
+    {
+        const float64x2_t x0 = vld1q_f64(in + i);
+        const float64x2_t x1 = vld1q_f64(in + i + 2);
+        acc00 = vfmaq_f64(acc00, vld1q_f64(kernel0 + i), x0);
+        acc01 = vfmaq_f64(acc01, vld1q_f64(kernel0 + i + 2), x1);
+        acc10 = vfmaq_f64(acc10, vld1q_f64(kernel1 + i), x0);
+        acc11 = vfmaq_f64(acc11, vld1q_f64(kernel1 + i + 2), x1);
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        const float64x2_t x0 = vld1q_f64(in + i);
+        acc00 = vfmaq_f64(acc00, vld1q_f64(kernel0 + i), x0);
+        acc10 = vfmaq_f64(acc10, vld1q_f64(kernel1 + i), x0);
+    }
+    const float64x2_t y0 = vaddq_f64(acc00, acc01);
+    const float64x2_t y1 = vaddq_f64(acc10, acc11);
+    const float64x2_t acc = vfmaq_f64(y0, vdupq_n_f64(frac), vsubq_f64(y1, y0));
+    double res = vaddvq_f64(acc);
+    for (; i < length; ++i)
+    {
+        res += in[i] * (kernel0[i] + frac * (kernel1[i] - kernel0[i]));
+    }
+    return res;
+}
+
+/* Polyphase convolution with NEON. Each pass of the tap loop updates 16
+ outputs of two kernels, which share the input loads */
+static void
+convolve_polyphase_neon(const float* src, unsigned length, const float* kernels,
+                        unsigned kernel_length, unsigned n_kernels, float* dest)
+{
+    const float* end = src + (kernel_length - 1);
+    float out0[16];
+    float out1[16];
+    unsigned i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        unsigned p = 0;
+        for (; p + 2 <= n_kernels; p += 2)
+        {
+            const float* k0 = kernels + p * kernel_length;
+            const float* k1 = k0 + kernel_length;
+            float32x4_t acc00 = vdupq_n_f32(0.0f);
+            float32x4_t acc01 = vdupq_n_f32(0.0f);
+            float32x4_t acc02 = vdupq_n_f32(0.0f);
+            float32x4_t acc03 = vdupq_n_f32(0.0f);
+            float32x4_t acc10 = vdupq_n_f32(0.0f);
+            float32x4_t acc11 = vdupq_n_f32(0.0f);
+            float32x4_t acc12 = vdupq_n_f32(0.0f);
+            float32x4_t acc13 = vdupq_n_f32(0.0f);
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const float* x = end + i - j;
+                const float32x4_t c0 = vld1q_dup_f32(k0 + j);
+                const float32x4_t c1 = vld1q_dup_f32(k1 + j);
+                const float32x4_t x0 = vld1q_f32(x);
+                const float32x4_t x1 = vld1q_f32(x + 4);
+                const float32x4_t x2 = vld1q_f32(x + 8);
+                const float32x4_t x3 = vld1q_f32(x + 12);
+                acc00 = vfmaq_f32(acc00, c0, x0);
+                acc01 = vfmaq_f32(acc01, c0, x1);
+                acc02 = vfmaq_f32(acc02, c0, x2);
+                acc03 = vfmaq_f32(acc03, c0, x3);
+                acc10 = vfmaq_f32(acc10, c1, x0);
+                acc11 = vfmaq_f32(acc11, c1, x1);
+                acc12 = vfmaq_f32(acc12, c1, x2);
+                acc13 = vfmaq_f32(acc13, c1, x3);
+            }
+            vst1q_f32(out0, acc00);
+            vst1q_f32(out0 + 4, acc01);
+            vst1q_f32(out0 + 8, acc02);
+            vst1q_f32(out0 + 12, acc03);
+            vst1q_f32(out1, acc10);
+            vst1q_f32(out1 + 4, acc11);
+            vst1q_f32(out1 + 8, acc12);
+            vst1q_f32(out1 + 12, acc13);
+            for (unsigned t = 0; t < 16; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+                dest[(i + t) * n_kernels + p + 1] = out1[t];
+            }
+        }
+        if (p < n_kernels)
+        {
+            const float* k0 = kernels + p * kernel_length;
+            float32x4_t acc00 = vdupq_n_f32(0.0f);
+            float32x4_t acc01 = vdupq_n_f32(0.0f);
+            float32x4_t acc02 = vdupq_n_f32(0.0f);
+            float32x4_t acc03 = vdupq_n_f32(0.0f);
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const float* x = end + i - j;
+                const float32x4_t c0 = vld1q_dup_f32(k0 + j);
+                acc00 = vfmaq_f32(acc00, c0, vld1q_f32(x));
+                acc01 = vfmaq_f32(acc01, c0, vld1q_f32(x + 4));
+                acc02 = vfmaq_f32(acc02, c0, vld1q_f32(x + 8));
+                acc03 = vfmaq_f32(acc03, c0, vld1q_f32(x + 12));
+            }
+            vst1q_f32(out0, acc00);
+            vst1q_f32(out0 + 4, acc01);
+            vst1q_f32(out0 + 8, acc02);
+            vst1q_f32(out0 + 12, acc03);
+            for (unsigned t = 0; t < 16; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    for (; i + 4 <= length; i += 4)
+    {
+        const float* kernel = kernels;
+        for (unsigned p = 0; p < n_kernels; ++p, kernel += kernel_length)
+        {
+            float32x4_t acc = vdupq_n_f32(0.0f);
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                acc = vfmaq_f32(acc, vld1q_dup_f32(kernel + j), vld1q_f32(end + i - j));
+            }
+            vst1q_f32(out0, acc);
+            for (unsigned t = 0; t < 4; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    convolve_polyphase_tail(src, i, length, kernels, kernel_length, n_kernels, dest);
+}
+
+/* Polyphase convolution with NEON. Each pass of the tap loop updates 8
+ outputs of two kernels, which share the input loads */
+static void
+convolve_polyphase_neonD(const double* src, unsigned length, const double* kernels,
+                         unsigned kernel_length, unsigned n_kernels, double* dest)
+{
+    const double* end = src + (kernel_length - 1);
+    double out0[8];
+    double out1[8];
+    unsigned i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        unsigned p = 0;
+        for (; p + 2 <= n_kernels; p += 2)
+        {
+            const double* k0 = kernels + p * kernel_length;
+            const double* k1 = k0 + kernel_length;
+            float64x2_t acc00 = vdupq_n_f64(0.0);
+            float64x2_t acc01 = vdupq_n_f64(0.0);
+            float64x2_t acc02 = vdupq_n_f64(0.0);
+            float64x2_t acc03 = vdupq_n_f64(0.0);
+            float64x2_t acc10 = vdupq_n_f64(0.0);
+            float64x2_t acc11 = vdupq_n_f64(0.0);
+            float64x2_t acc12 = vdupq_n_f64(0.0);
+            float64x2_t acc13 = vdupq_n_f64(0.0);
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const double* x = end + i - j;
+                const float64x2_t c0 = vld1q_dup_f64(k0 + j);
+                const float64x2_t c1 = vld1q_dup_f64(k1 + j);
+                const float64x2_t x0 = vld1q_f64(x);
+                const float64x2_t x1 = vld1q_f64(x + 2);
+                const float64x2_t x2 = vld1q_f64(x + 4);
+                const float64x2_t x3 = vld1q_f64(x + 6);
+                acc00 = vfmaq_f64(acc00, c0, x0);
+                acc01 = vfmaq_f64(acc01, c0, x1);
+                acc02 = vfmaq_f64(acc02, c0, x2);
+                acc03 = vfmaq_f64(acc03, c0, x3);
+                acc10 = vfmaq_f64(acc10, c1, x0);
+                acc11 = vfmaq_f64(acc11, c1, x1);
+                acc12 = vfmaq_f64(acc12, c1, x2);
+                acc13 = vfmaq_f64(acc13, c1, x3);
+            }
+            vst1q_f64(out0, acc00);
+            vst1q_f64(out0 + 2, acc01);
+            vst1q_f64(out0 + 4, acc02);
+            vst1q_f64(out0 + 6, acc03);
+            vst1q_f64(out1, acc10);
+            vst1q_f64(out1 + 2, acc11);
+            vst1q_f64(out1 + 4, acc12);
+            vst1q_f64(out1 + 6, acc13);
+            for (unsigned t = 0; t < 8; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+                dest[(i + t) * n_kernels + p + 1] = out1[t];
+            }
+        }
+        if (p < n_kernels)
+        {
+            const double* k0 = kernels + p * kernel_length;
+            float64x2_t acc00 = vdupq_n_f64(0.0);
+            float64x2_t acc01 = vdupq_n_f64(0.0);
+            float64x2_t acc02 = vdupq_n_f64(0.0);
+            float64x2_t acc03 = vdupq_n_f64(0.0);
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                const double* x = end + i - j;
+                const float64x2_t c0 = vld1q_dup_f64(k0 + j);
+                acc00 = vfmaq_f64(acc00, c0, vld1q_f64(x));
+                acc01 = vfmaq_f64(acc01, c0, vld1q_f64(x + 2));
+                acc02 = vfmaq_f64(acc02, c0, vld1q_f64(x + 4));
+                acc03 = vfmaq_f64(acc03, c0, vld1q_f64(x + 6));
+            }
+            vst1q_f64(out0, acc00);
+            vst1q_f64(out0 + 2, acc01);
+            vst1q_f64(out0 + 4, acc02);
+            vst1q_f64(out0 + 6, acc03);
+            for (unsigned t = 0; t < 8; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        const double* kernel = kernels;
+        for (unsigned p = 0; p < n_kernels; ++p, kernel += kernel_length)
+        {
+            float64x2_t acc = vdupq_n_f64(0.0);
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                acc = vfmaq_f64(acc, vld1q_dup_f64(kernel + j), vld1q_f64(end + i - j));
+            }
+            vst1q_f64(out0, acc);
+            for (unsigned t = 0; t < 2; ++t)
+            {
+                dest[(i + t) * n_kernels + p] = out0[t];
+            }
+        }
+    }
+    convolve_polyphase_tailD(src, i, length, kernels, kernel_length, n_kernels, dest);
+}
+/* Block state-space biquad with NEON. The input terms of a block don't depend
+ on the state, so only the two state terms and the state update are on the
+ recursion's critical path */
+static void
+iir_block_neon(float* dest, const float* src, unsigned blocks,
+               const float* block_coeffs, float* state)
+{
+    const float* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    const float32x4_t obs00 = vld1q_f32(block_coeffs);
+    const float32x4_t obs01 = vld1q_f32(block_coeffs + 4);
+    const float32x4_t obs10 = vld1q_f32(block_coeffs + IIR_BLOCK_LENGTH);
+    const float32x4_t obs11 = vld1q_f32(block_coeffs + IIR_BLOCK_LENGTH + 4);
+    for (unsigned k = 0; k < blocks; ++k)
+    {
+        const float* x = src + k * IIR_BLOCK_LENGTH;
+        float* y = dest + k * IIR_BLOCK_LENGTH;
+        const float last[2] = {x[IIR_BLOCK_LENGTH - 2], x[IIR_BLOCK_LENGTH - 1]};
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        for (unsigned j = 0; j < IIR_BLOCK_LENGTH; ++j)
+        {
+            const float32x4_t in = vdupq_n_f32(x[j]);
+            acc0 = vfmaq_f32(acc0, vld1q_f32(impulse - j), in);
+            acc1 = vfmaq_f32(acc1, vld1q_f32(impulse - j + 4), in);
+        }
+        const float32x4_t w0 = vdupq_n_f32(state[0]);
+        const float32x4_t w1 = vdupq_n_f32(state[1]);
+        acc0 = vfmaq_f32(vfmaq_f32(acc0, obs00, w0), obs10, w1);
+        acc1 = vfmaq_f32(vfmaq_f32(acc1, obs01, w0), obs11, w1);
+        vst1q_f32(y, acc0);
+        vst1q_f32(y + 4, acc1);
+        iir_block_state(state, block_coeffs, last, y + IIR_BLOCK_LENGTH - 2);
+    }
+}
+
+/* Block state-space biquad with NEON. The input terms of a block don't depend
+ on the state, so only the two state terms and the state update are on the
+ recursion's critical path */
+static void
+iir_block_neonD(double* dest, const double* src, unsigned blocks,
+                const double* block_coeffs, double* state)
+{
+    const double* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    for (unsigned k = 0; k < blocks; ++k)
+    {
+        const double* x = src + k * IIR_BLOCK_LENGTH;
+        double* y = dest + k * IIR_BLOCK_LENGTH;
+        const double last[2] = {x[IIR_BLOCK_LENGTH - 2], x[IIR_BLOCK_LENGTH - 1]};
+        float64x2_t acc[4];
+        for (unsigned t = 0; t < 4; ++t)
+        {
+            acc[t] = vdupq_n_f64(0.0);
+        }
+        for (unsigned j = 0; j < IIR_BLOCK_LENGTH; ++j)
+        {
+            const float64x2_t in = vdupq_n_f64(x[j]);
+            for (unsigned t = 0; t < 4; ++t)
+            {
+                acc[t] = vfmaq_f64(acc[t], vld1q_f64(impulse - j + 2 * t), in);
+            }
+        }
+        const float64x2_t w0 = vdupq_n_f64(state[0]);
+        const float64x2_t w1 = vdupq_n_f64(state[1]);
+        for (unsigned t = 0; t < 4; ++t)
+        {
+            acc[t] = vfmaq_f64(acc[t], vld1q_f64(block_coeffs + 2 * t), w0);
+            acc[t] = vfmaq_f64(acc[t], vld1q_f64(block_coeffs + IIR_BLOCK_LENGTH + 2 * t), w1);
+            vst1q_f64(y + 2 * t, acc[t]);
+        }
+        iir_block_stateD(state, block_coeffs, last, y + IIR_BLOCK_LENGTH - 2);
+    }
+}
+#endif
+
+#ifndef __APPLE__
+/* Direct convolution of a zero-padded input, as in the SIMD kernels: padded
+ holds kernel_length - 1 samples before the first output's input. Picks the
+ kernel for the symmetry and the CPU */
+static void
+convolve_padded(const float* padded, const float* kernel, unsigned kernel_length,
+                Symmetry_t symmetry, float* dest, unsigned length)
+{
+#if defined(CONVOLVE_X86)
+    if (symmetry == ASYMMETRIC)
+    {
+        if (CONVOLVE_HAS_AVX())
+        {
+            convolve_avx(padded, kernel, kernel_length, dest, length);
+        }
+        else
+        {
+            convolve_sse(padded, kernel, kernel_length, dest, length);
+        }
+    }
+    else if (CONVOLVE_HAS_AVX())
+    {
+        convolve_symmetric_avx(padded, kernel, kernel_length, symmetry, dest, length);
+    }
+    else
+    {
+        convolve_symmetric_sse(padded, kernel, kernel_length, symmetry, dest, length);
+    }
+#elif defined(CONVOLVE_NEON)
+    if (symmetry == ASYMMETRIC)
+    {
+        convolve_neon(padded, kernel, kernel_length, dest, length);
+    }
+    else
+    {
+        convolve_symmetric_neon(padded, kernel, kernel_length, symmetry, dest, length);
+    }
+#else
+    // Add the mirrored input samples, then do one multiply per pair
+    const unsigned pad = kernel_length - 1;
+    const unsigned half = kernel_length / 2;
+    const float mirror = (symmetry == ANTISYMMETRIC) ? -1.0 : 1.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        const float* x = padded + i;
+        float sum = 0.0;
+        if (symmetry == ASYMMETRIC)
+        {
+            for (unsigned k = 0; k < kernel_length; ++k)
+            {
+                sum += kernel[k] * x[pad - k];
+            }
+        }
+        else
+        {
+            for (unsigned k = 0; k < half; ++k)
+            {
+                sum += kernel[k] * (x[pad - k] + mirror * x[k]);
+            }
+            if (kernel_length % 2)
+            {
+                sum += kernel[half] * x[half];
+            }
+        }
+        dest[i] = sum;
+    }
+#endif
+}
+
+/* Direct convolution of a zero-padded input, as in the SIMD kernels: padded
+ holds kernel_length - 1 samples before the first output's input. Picks the
+ kernel for the symmetry and the CPU */
+static void
+convolve_paddedD(const double* padded, const double* kernel, unsigned kernel_length,
+                 Symmetry_t symmetry, double* dest, unsigned length)
+{
+#if defined(CONVOLVE_X86)
+    if (symmetry == ASYMMETRIC)
+    {
+        if (CONVOLVE_HAS_AVX())
+        {
+            convolve_avxD(padded, kernel, kernel_length, dest, length);
+        }
+        else
+        {
+            convolve_sseD(padded, kernel, kernel_length, dest, length);
+        }
+    }
+    else if (CONVOLVE_HAS_AVX())
+    {
+        convolve_symmetric_avxD(padded, kernel, kernel_length, symmetry, dest, length);
+    }
+    else
+    {
+        convolve_symmetric_sseD(padded, kernel, kernel_length, symmetry, dest, length);
+    }
+#elif defined(CONVOLVE_NEON)
+    if (symmetry == ASYMMETRIC)
+    {
+        convolve_neonD(padded, kernel, kernel_length, dest, length);
+    }
+    else
+    {
+        convolve_symmetric_neonD(padded, kernel, kernel_length, symmetry, dest, length);
+    }
+#else
+    // Add the mirrored input samples, then do one multiply per pair
+    const unsigned pad = kernel_length - 1;
+    const unsigned half = kernel_length / 2;
+    const double mirror = (symmetry == ANTISYMMETRIC) ? -1.0 : 1.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        const double* x = padded + i;
+        double sum = 0.0;
+        if (symmetry == ASYMMETRIC)
+        {
+            for (unsigned k = 0; k < kernel_length; ++k)
+            {
+                sum += kernel[k] * x[pad - k];
+            }
+        }
+        else
+        {
+            for (unsigned k = 0; k < half; ++k)
+            {
+                sum += kernel[k] * (x[pad - k] + mirror * x[k]);
+            }
+            if (kernel_length % 2)
+            {
+                sum += kernel[half] * x[half];
+            }
+        }
+        dest[i] = sum;
+    }
+#endif
+}
+
+/* Full direct convolution of in1 with kernel, without copying in1 into a
+ zero-padded buffer. Outputs whose inputs all lie in in1 read it in place, and
+ only the edges, where the kernel overlaps the padding, are padded */
+static void
+convolve_chunked(const float* in1, unsigned in1_length, const float* kernel,
+                 unsigned kernel_length, Symmetry_t symmetry, float* dest)
+{
+    const unsigned pad = kernel_length - 1;
+    const unsigned length = in1_length + pad;
+    if (in1_length > pad)
+    {
+        // Output i starts at in1[i - pad]
+        convolve_padded(in1, kernel, kernel_length, symmetry, dest + pad, in1_length - pad);
+        convolve_edge(in1, in1_length, kernel, kernel_length, symmetry, dest, 0, pad);
+        convolve_edge(in1, in1_length, kernel, kernel_length, symmetry, dest, in1_length, length);
+    }
+    else
+    {
+        convolve_edge(in1, in1_length, kernel, kernel_length, symmetry, dest, 0, length);
+    }
+}
+
+/* Full direct convolution of in1 with kernel, without copying in1 into a
+ zero-padded buffer. Outputs whose inputs all lie in in1 read it in place, and
+ only the edges, where the kernel overlaps the padding, are padded */
+static void
+convolve_chunkedD(const double* in1, unsigned in1_length, const double* kernel,
+                  unsigned kernel_length, Symmetry_t symmetry, double* dest)
+{
+    const unsigned pad = kernel_length - 1;
+    const unsigned length = in1_length + pad;
+    if (in1_length > pad)
+    {
+        // Output i starts at in1[i - pad]
+        convolve_paddedD(in1, kernel, kernel_length, symmetry, dest + pad, in1_length - pad);
+        convolve_edgeD(in1, in1_length, kernel, kernel_length, symmetry, dest, 0, pad);
+        convolve_edgeD(in1, in1_length, kernel, kernel_length, symmetry, dest, in1_length, length);
+    }
+    else
+    {
+        convolve_edgeD(in1, in1_length, kernel, kernel_length, symmetry, dest, 0, length);
+    }
+}
+
+/* Convolution outputs start to end, whose inputs overlap the zero padding.
+ The padded input is built CONVOLVE_CHUNK samples at a time on the stack, or,
+ for kernels too long to leave room for outputs in a chunk, the outputs are
+ summed one at a time */
+static void
+convolve_edge(const float* in1, unsigned in1_length, const float* kernel,
+              unsigned kernel_length, Symmetry_t symmetry, float* dest,
+              unsigned start, unsigned end)
+{
+    const unsigned pad = kernel_length - 1;
+    if (pad <= CONVOLVE_CHUNK / 2)
+    {
+        float chunk[CONVOLVE_CHUNK];
+        const unsigned step = CONVOLVE_CHUNK - pad;
+        for (unsigned i = start; i < end; i += step)
+        {
+            const unsigned count = (end - i < step) ? end - i : step;
+
+            // chunk[j] is in1[i + j - pad], or zero outside in1
+            for (unsigned j = 0; j < count + pad; ++j)
+            {
+                const unsigned k = i + j;
+                chunk[j] = (k >= pad && k - pad < in1_length) ? in1[k - pad] : 0.0;
+            }
+            convolve_padded(chunk, kernel, kernel_length, symmetry, dest + i, count);
+        }
+    }
+    else
+    {
+        for (unsigned i = start; i < end; ++i)
+        {
+            float sum = 0.0;
+            for (unsigned k = (i >= pad) ? i - pad : 0; k <= i && k < in1_length; ++k)
+            {
+                sum += in1[k] * kernel[i - k];
+            }
+            dest[i] = sum;
+        }
+    }
+}
+
+/* Convolution outputs start to end, whose inputs overlap the zero padding.
+ The padded input is built CONVOLVE_CHUNK samples at a time on the stack, or,
+ for kernels too long to leave room for outputs in a chunk, the outputs are
+ summed one at a time */
+static void
+convolve_edgeD(const double* in1, unsigned in1_length, const double* kernel,
+               unsigned kernel_length, Symmetry_t symmetry, double* dest,
+               unsigned start, unsigned end)
+{
+    const unsigned pad = kernel_length - 1;
+    if (pad <= CONVOLVE_CHUNK / 2)
+    {
+        double chunk[CONVOLVE_CHUNK];
+        const unsigned step = CONVOLVE_CHUNK - pad;
+        for (unsigned i = start; i < end; i += step)
+        {
+            const unsigned count = (end - i < step) ? end - i : step;
+
+            // chunk[j] is in1[i + j - pad], or zero outside in1
+            for (unsigned j = 0; j < count + pad; ++j)
+            {
+                const unsigned k = i + j;
+                chunk[j] = (k >= pad && k - pad < in1_length) ? in1[k - pad] : 0.0;
+            }
+            convolve_paddedD(chunk, kernel, kernel_length, symmetry, dest + i, count);
+        }
+    }
+    else
+    {
+        for (unsigned i = start; i < end; ++i)
+        {
+            double sum = 0.0;
+            for (unsigned k = (i >= pad) ? i - pad : 0; k <= i && k < in1_length; ++k)
+            {
+                sum += in1[k] * kernel[i - k];
+            }
+            dest[i] = sum;
+        }
+    }
+}
+
+/* Polyphase convolution, one output at a time. Finishes the outputs from start
+ that the SIMD kernels leave over */
+static void
+convolve_polyphase_tail(const float* src, unsigned start, unsigned length, const float* kernels,
+                        unsigned kernel_length, unsigned n_kernels, float* dest)
+{
+    for (unsigned i = start; i < length; ++i)
+    {
+        const float* x = src + i;
+        const float* kernel = kernels;
+        for (unsigned p = 0; p < n_kernels; ++p, kernel += kernel_length)
+        {
+            float sum = 0.0;
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                sum += kernel[kernel_length - 1 - j] * x[j];
+            }
+            dest[i * n_kernels + p] = sum;
+        }
+    }
+}
+
+/* Polyphase convolution, one output at a time. Finishes the outputs from start
+ that the SIMD kernels leave over */
+static void
+convolve_polyphase_tailD(const double* src, unsigned start, unsigned length, const double* kernels,
+                         unsigned kernel_length, unsigned n_kernels, double* dest)
+{
+    for (unsigned i = start; i < length; ++i)
+    {
+        const double* x = src + i;
+        const double* kernel = kernels;
+        for (unsigned p = 0; p < n_kernels; ++p, kernel += kernel_length)
+        {
+            double sum = 0.0;
+            for (unsigned j = 0; j < kernel_length; ++j)
+            {
+                sum += kernel[kernel_length - 1 - j] * x[j];
+            }
+            dest[i * n_kernels + p] = sum;
+        }
+    }
+}
+#endif
+
+#if !defined(CONVOLVE_X86) && !defined(CONVOLVE_NEON)
+/* Block state-space biquad without SIMD intrinsics. Written as independent
+ multiply-adds over the block so the compiler can vectorize it */
+static void
+iir_block_generic(float* dest, const float* src, unsigned blocks,
+                  const float* block_coeffs, float* state)
+{
+    const float* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    float out[IIR_BLOCK_LENGTH];
+    for (unsigned k = 0; k < blocks; ++k)
+    {
+        const float* x = src + k * IIR_BLOCK_LENGTH;
+        for (unsigned i = 0; i < IIR_BLOCK_LENGTH; ++i)
+        {
+            out[i] = 0.0;
+        }
+        for (unsigned j = 0; j < IIR_BLOCK_LENGTH; ++j)
+        {
+            const float* column = impulse - j;
+            for (unsigned i = 0; i < IIR_BLOCK_LENGTH; ++i)
+            {
+                out[i] += column[i] * x[j];
+            }
+        }
+        for (unsigned i = 0; i < IIR_BLOCK_LENGTH; ++i)
+        {
+            out[i] += block_coeffs[i] * state[0] + block_coeffs[IIR_BLOCK_LENGTH + i] * state[1];
+        }
+        iir_block_state(state, block_coeffs, x + IIR_BLOCK_LENGTH - 2, out + IIR_BLOCK_LENGTH - 2);
+        CopyBuffer(dest + k * IIR_BLOCK_LENGTH, out, IIR_BLOCK_LENGTH);
+    }
+}
+
+/* Block state-space biquad without SIMD intrinsics. Written as independent
+ multiply-adds over the block so the compiler can vectorize it */
+static void
+iir_block_genericD(double* dest, const double* src, unsigned blocks,
+                   const double* block_coeffs, double* state)
+{
+    const double* impulse = block_coeffs + 3 * IIR_BLOCK_LENGTH;
+    double out[IIR_BLOCK_LENGTH];
+    for (unsigned k = 0; k < blocks; ++k)
+    {
+        const double* x = src + k * IIR_BLOCK_LENGTH;
+        for (unsigned i = 0; i < IIR_BLOCK_LENGTH; ++i)
+        {
+            out[i] = 0.0;
+        }
+        for (unsigned j = 0; j < IIR_BLOCK_LENGTH; ++j)
+        {
+            const double* column = impulse - j;
+            for (unsigned i = 0; i < IIR_BLOCK_LENGTH; ++i)
+            {
+                out[i] += column[i] * x[j];
+            }
+        }
+        for (unsigned i = 0; i < IIR_BLOCK_LENGTH; ++i)
+        {
+            out[i] += block_coeffs[i] * state[0] + block_coeffs[IIR_BLOCK_LENGTH + i] * state[1];
+        }
+        iir_block_stateD(state, block_coeffs, x + IIR_BLOCK_LENGTH - 2, out + IIR_BLOCK_LENGTH - 2);
+        CopyBufferD(dest + k * IIR_BLOCK_LENGTH, out, IIR_BLOCK_LENGTH);
+    }
+}
+#endif
+
+/* Recover the transposed Direct-Form II state at the end of a block from its
+ last two inputs x and outputs y, rounding as the recursion would */
+static void
+iir_block_state(float* state, const float* block_coeffs, const float* x, const float* y)
+{
+    const float* b = block_coeffs + 4 * IIR_BLOCK_LENGTH;
+    state[0] = b[1] * x[1] - b[3] * y[1] + (b[2] * x[0] - b[4] * y[0]);
+    state[1] = b[2] * x[1] - b[4] * y[1];
+}
+
+/* Recover the transposed Direct-Form II state at the end of a block from its
+ last two inputs x and outputs y, rounding as the recursion would */
+static void
+iir_block_stateD(double* state, const double* block_coeffs, const double* x, const double* y)
+{
+    const double* b = block_coeffs + 4 * IIR_BLOCK_LENGTH;
+    state[0] = b[1] * x[1] - b[3] * y[1] + (b[2] * x[0] - b[4] * y[0]);
+    state[1] = b[2] * x[1] - b[4] * y[1];
+}
+
+/* The transposed Direct-Form II recursion, one sample at a time. Filters the
+ samples left over after the last whole block */
+static void
+iir_block_tail(float* dest, const float* src, unsigned length,
+               const float* block_coeffs, float* state)
+{
+    const float* b = block_coeffs + 4 * IIR_BLOCK_LENGTH;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        const float x = src[i];
+        const float y = b[0] * x + state[0];
+        state[0] = b[1] * x - b[3] * y + state[1];
+        state[1] = b[2] * x - b[4] * y;
+        dest[i] = y;
+    }
+}
+
+/* The transposed Direct-Form II recursion, one sample at a time. Filters the
+ samples left over after the last whole block */
+static void
+iir_block_tailD(double* dest, const double* src, unsigned length,
+                const double* block_coeffs, double* state)
+{
+    const double* b = block_coeffs + 4 * IIR_BLOCK_LENGTH;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        const double x = src[i];
+        const double y = b[0] * x + state[0];
+        state[0] = b[1] * x - b[3] * y + state[1];
+        state[1] = b[2] * x - b[4] * y;
+        dest[i] = y;
+    }
+}
@@ -12,23 +12,168 @@
 #include "Utilities.h"
 
 #include <math.h>
+#include <pthread.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef USE_NATIVE_FFT
+/* The native FFT butterflies run across VF_WIDTH (float) / VD_WIDTH (double)
+ * transforms at a time when vector instructions are available */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define VF_WIDTH        (4)
+typedef __m128          vfloat;
+#define VF_LOAD(p)      _mm_loadu_ps(p)
+#define VF_STORE(p, v)  _mm_storeu_ps((p), (v))
+#define VF_SET1(x)      _mm_set1_ps(x)
+#define VF_ADD(a, b)    _mm_add_ps((a), (b))
+#define VF_SUB(a, b)    _mm_sub_ps((a), (b))
+#define VF_MUL(a, b)    _mm_mul_ps((a), (b))
+#define VF_REVERSE(v)   _mm_shuffle_ps((v), (v), _MM_SHUFFLE(0, 1, 2, 3))
+#define VD_WIDTH        (2)
+typedef __m128d         vdouble;
+#define VD_LOAD(p)      _mm_loadu_pd(p)
+#define VD_STORE(p, v)  _mm_storeu_pd((p), (v))
+#define VD_SET1(x)      _mm_set1_pd(x)
+#define VD_ADD(a, b)    _mm_add_pd((a), (b))
+#define VD_SUB(a, b)    _mm_sub_pd((a), (b))
+#define VD_MUL(a, b)    _mm_mul_pd((a), (b))
+#define VD_REVERSE(v)   _mm_shuffle_pd((v), (v), 1)
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VF_WIDTH        (4)
+typedef float32x4_t     vfloat;
+#define VF_LOAD(p)      vld1q_f32(p)
+#define VF_STORE(p, v)  vst1q_f32((p), (v))
+#define VF_SET1(x)      vdupq_n_f32(x)
+#define VF_ADD(a, b)    vaddq_f32((a), (b))
+#define VF_SUB(a, b)    vsubq_f32((a), (b))
+#define VF_MUL(a, b)    vmulq_f32((a), (b))
+#define VF_REVERSE(v)   vcombine_f32(vget_high_f32(vrev64q_f32(v)), vget_low_f32(vrev64q_f32(v)))
+#if defined(__aarch64__)
+#define VD_WIDTH        (2)
+typedef float64x2_t     vdouble;
+#define VD_LOAD(p)      vld1q_f64(p)
+#define VD_STORE(p, v)  vst1q_f64((p), (v))
+#define VD_SET1(x)      vdupq_n_f64(x)
+#define VD_ADD(a, b)    vaddq_f64((a), (b))
+#define VD_SUB(a, b)    vsubq_f64((a), (b))
+#define VD_MUL(a, b)    vmulq_f64((a), (b))
+#define VD_REVERSE(v)   vextq_f64((v), (v), 1)
+#endif
+#endif
+
+/* On x86 the butterflies and spectrum products also have AVX kernels, picked at
+ * run time when the CPU supports them */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__SSE2__))
+#include <immintrin.h>
+#define FFT_X86
+#define FFT_HAS_AVX()   (__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma"))
+#define VF8_WIDTH       (8)
+typedef __m256          vfloat8;
+#define VF8_LOAD(p)     _mm256_loadu_ps(p)
+#define VF8_STORE(p, v) _mm256_storeu_ps((p), (v))
+#define VF8_SET1(x)     _mm256_set1_ps(x)
+#define VF8_ADD(a, b)   _mm256_add_ps((a), (b))
+#define VF8_SUB(a, b)   _mm256_sub_ps((a), (b))
+#define VF8_MUL(a, b)   _mm256_mul_ps((a), (b))
+#define VD4_WIDTH       (4)
+typedef __m256d         vdouble4;
+#define VD4_LOAD(p)     _mm256_loadu_pd(p)
+#define VD4_STORE(p, v) _mm256_storeu_pd((p), (v))
+#define VD4_SET1(x)     _mm256_set1_pd(x)
+#define VD4_ADD(a, b)   _mm256_add_pd((a), (b))
+#define VD4_SUB(a, b)   _mm256_sub_pd((a), (b))
+#define VD4_MUL(a, b)   _mm256_mul_pd((a), (b))
+#endif
+
+/* Maximum number of butterfly passes in a native FFT */
+#define FFT_MAX_STAGES (32)
+
+/* Channels transformed together by the batched functions */
+#define FFT_BATCH_CHANNELS (8)
+#endif
+
+/* Spectrum bins multiplied at a time by FFTSpectrumMultiplyBatch, so the
+ kernel bins stay in cache while every channel is multiplied by them */
+#define FFT_BATCH_TILE (256)
+
+
+/* FFT plans hold the read-only tables for one transform length. Plans are
+ reference counted and shared by every FFTConfig of the same length and
+ precision, so each FFTConfig only owns its scratch buffers */
+typedef struct FFT_PLAN
+{
+    unsigned            length;
+    unsigned            refcount;
+    struct FFT_PLAN*    next;
+#ifdef USE_FFTW_FFT
+    fftwf_plan          forward_plan;
+    fftwf_plan          inverse_plan;
+    fftwf_plan          complex_plan;
+    unsigned            flags;
+#elif defined(USE_OOURA_FFT)
+    double*             w;
+#elif defined(USE_NATIVE_FFT)
+    unsigned            n;                      // Complex transform length
+    unsigned            n_stages;
+    unsigned            radix[FFT_MAX_STAGES];
+    float*              twiddle_r;              // Butterfly twiddles, all stages
+    float*              twiddle_i;
+    float*              rtwiddle_r;             // cos(2*pi*k/length)
+    float*              rtwiddle_i;             // sin(2*pi*k/length)
+#elif defined(USE_APPLE_FFT)
+    FFTSetup            setup;
+#endif
+} FFT_PLAN;
+
+typedef struct FFT_PLAN_D
+{
+    unsigned            length;
+    unsigned            refcount;
+    struct FFT_PLAN_D*  next;
+#ifdef USE_FFTW_FFT
+    fftw_plan           forward_plan;
+    fftw_plan           inverse_plan;
+    fftw_plan           complex_plan;
+    unsigned            flags;
+#elif defined(USE_OOURA_FFT)
+    double*             w;
+#elif defined(USE_NATIVE_FFT)
+    unsigned            n;
+    unsigned            n_stages;
+    unsigned            radix[FFT_MAX_STAGES];
+    double*             twiddle_r;
+    double*             twiddle_i;
+    double*             rtwiddle_r;
+    double*             rtwiddle_i;
+#elif defined(USE_APPLE_FFT)
+    FFTSetupD           setup;
+#endif
+} FFT_PLAN_D;
+
 
 #ifdef USE_FFTW_FFT
+/* buffer holds a zero padded real input, followed by the length / 2 + 1 bins
+ of its transform */
 typedef struct {
-    fftwf_plan forward_plan;
-    fftwf_plan inverse_plan;
+    fftwf_plan  forward_plan;
+    fftwf_plan  inverse_plan;
+    float*      buffer;
+    FFTComplex* bins;
 } FFT_SETUP;
 
 typedef struct {
-    fftw_plan forward_plan;
-    fftw_plan inverse_plan;
+    fftw_plan       forward_plan;
+    fftw_plan       inverse_plan;
+    double*         buffer;
+    FFTComplexD*    bins;
 } FFT_SETUP_D;
 
 #elif defined(USE_OOURA_FFT)
+/* w is borrowed from the plan. ip doubles as a work area for bitrv2 so it has
+ to stay with the instance */
 typedef struct
 {
     double* buffer;
@@ -44,6 +189,19 @@ typedef struct
     double* w;
 } FFT_SETUP_D;
 
+#elif defined(USE_NATIVE_FFT)
+typedef struct
+{
+    float*      buffer;                     // Scratch, 2 * length
+    float*      batch;                      // Batch scratch, see FFTPrepareBatch
+} FFT_SETUP;
+
+typedef struct
+{
+    double*     buffer;
+    double*     batch;
+} FFT_SETUP_D;
+
 #elif defined(USE_APPLE_FFT)
 typedef FFTSetup FFT_SETUP;
 typedef FFTSetupD FFT_SETUP_D;
@@ -115,7 +273,134 @@ rftfsub(int n, double *a, int nc, double *c);
 
 static inline void
 rftbsub(int n, double *a, int nc, double *c);
+
+static void
+ooura_c2c(FFTConfig* fft, const float* inReal, const float* inImag, float* outReal, float* outImag);
+
+static void
+ooura_c2cD(FFTConfigD* fft, const double* inReal, const double* inImag, double* outReal, double* outImag);
+#endif
+#ifdef USE_NATIVE_FFT
+
+static int
+native_factor(unsigned n, unsigned* radix);
+
+static Error_t
+native_plan_init(FFT_PLAN* plan, unsigned length);
+
+static Error_t
+native_plan_initD(FFT_PLAN_D* plan, unsigned length);
+
+static void
+native_plan_free(FFT_PLAN* plan);
+
+static void
+native_plan_freeD(FFT_PLAN_D* plan);
+
+static void
+native_cfft(const FFT_PLAN* plan, float* re, float* im, float* work_re, float* work_im, unsigned channels);
+
+static void
+native_cfftD(const FFT_PLAN_D* plan, double* re, double* im, double* work_re, double* work_im, unsigned channels);
+
+static void
+native_rfft(const FFT_PLAN* plan, float* buffer, const float* in, unsigned in_length, float* re, float* im);
+
+static void
+native_rfftD(const FFT_PLAN_D* plan, double* buffer, const double* in, unsigned in_length, double* re, double* im);
+
+static void
+native_irfft(const FFT_PLAN* plan, float* buffer, const float* re, const float* im, float nyquist, float* out, float scale);
+
+static void
+native_irfftD(const FFT_PLAN_D* plan, double* buffer, const double* re, const double* im, double nyquist, double* out, double scale);
+
+static void
+native_rfft_batch(const FFT_PLAN* plan, float* buffer, const float* in, unsigned in_stride, unsigned in_length, unsigned channels, float* re, float* im);
+
+static void
+native_rfft_batchD(const FFT_PLAN_D* plan, double* buffer, const double* in, unsigned in_stride, unsigned in_length, unsigned channels, double* re, double* im);
+
+static void
+native_irfft_batch(const FFT_PLAN* plan, float* buffer, const float* re, const float* im, unsigned channels, float* out, unsigned out_stride, float scale);
+
+static void
+native_irfft_batchD(const FFT_PLAN_D* plan, double* buffer, const double* re, const double* im, unsigned channels, double* out, unsigned out_stride, double scale);
+
+static void
+native_batch_multiply(float* re, float* im, const float* kernel_re, const float* kernel_im, unsigned n, unsigned channels);
+
+static void
+native_batch_multiplyD(double* re, double* im, const double* kernel_re, const double* kernel_im, unsigned n, unsigned channels);
+
+static void
+native_c2c(const FFT_PLAN* plan, float* buffer, const float* in_re, const float* in_im, float* out_re, float* out_im);
+
+static void
+native_c2cD(const FFT_PLAN_D* plan, double* buffer, const double* in_re, const double* in_im, double* out_re, double* out_im);
+
+#ifdef FFT_X86
+__attribute__((target("avx,fma"))) static void
+native_pass2_avx(unsigned s, unsigned m, const float* xr, const float* xi, float* yr, float* yi, const float* twr, const float* twi);
+
+__attribute__((target("avx,fma"))) static void
+native_pass2_avxD(unsigned s, unsigned m, const double* xr, const double* xi, double* yr, double* yi, const double* twr, const double* twi);
+
+__attribute__((target("avx,fma"))) static void
+native_pass4_avx(unsigned s, unsigned m, const float* xr, const float* xi, float* yr, float* yi, const float* twr, const float* twi);
+
+__attribute__((target("avx,fma"))) static void
+native_pass4_avxD(unsigned s, unsigned m, const double* xr, const double* xi, double* yr, double* yi, const double* twr, const double* twi);
+
+__attribute__((target("avx,fma"))) static void
+native_pass3_avx(unsigned s, unsigned m, const float* xr, const float* xi, float* yr, float* yi, const float* twr, const float* twi);
+
+__attribute__((target("avx,fma"))) static void
+native_pass3_avxD(unsigned s, unsigned m, const double* xr, const double* xi, double* yr, double* yi, const double* twr, const double* twi);
+
+__attribute__((target("avx,fma"))) static void
+native_pass5_avx(unsigned s, unsigned m, const float* xr, const float* xi, float* yr, float* yi, const float* twr, const float* twi);
+
+__attribute__((target("avx,fma"))) static void
+native_pass5_avxD(unsigned s, unsigned m, const double* xr, const double* xi, double* yr, double* yi, const double* twr, const double* twi);
+
+__attribute__((target("avx,fma"))) static void
+native_batch_multiply_avx(float* re, float* im, const float* kernel_re, const float* kernel_im, unsigned n, unsigned channels);
+
+__attribute__((target("avx,fma"))) static void
+native_batch_multiply_avxD(double* re, double* im, const double* kernel_re, const double* kernel_im, unsigned n, unsigned channels);
+
+__attribute__((target("avx,fma"))) static unsigned
+spectrum_mac_avx(float* acc_re, float* acc_im, const float* a_re, const float* a_im, const float* b_re, const float* b_im, unsigned bins);
+
+__attribute__((target("avx,fma"))) static unsigned
+spectrum_mac_avxD(double* acc_re, double* acc_im, const double* a_re, const double* a_im, const double* b_re, const double* b_im, unsigned bins);
+
+__attribute__((target("avx,fma"))) static unsigned
+spectrum_multiply_avx(float* re, float* im, const float* k_re, const float* k_im, unsigned start, unsigned end);
+
+__attribute__((target("avx,fma"))) static unsigned
+spectrum_multiply_avxD(double* re, double* im, const double* k_re, const double* k_im, unsigned start, unsigned end);
 #endif
+#endif
+
+static FFT_PLAN*
+fft_plan_acquire(unsigned length, FFTPlanEffort_t effort);
+
+static FFT_PLAN_D*
+fft_plan_acquireD(unsigned length, FFTPlanEffort_t effort);
+
+static FFT_PLAN*
+fft_plan_create(unsigned length, FFTPlanEffort_t effort);
+
+static FFT_PLAN_D*
+fft_plan_createD(unsigned length, FFTPlanEffort_t effort);
+
+static void
+fft_plan_release(FFT_PLAN* plan);
+
+static void
+fft_plan_releaseD(FFT_PLAN_D* plan);
 
 struct FFTConfig
 {
@@ -124,6 +409,7 @@ struct FFTConfig
     float           log2n;
     FFTSplitComplex split;
     FFTSplitComplex split2;
+    FFT_PLAN*       plan;
     FFT_SETUP        setup;
 };
 
@@ -134,6 +420,7 @@ struct FFTConfigD
     double                  log2n;
     FFTSplitComplexD        split;
     FFTSplitComplexD        split2;
+    FFT_PLAN_D*             plan;
     FFT_SETUP_D             setup;
 };
 
@@ -141,16 +428,32 @@ struct FFTConfigD
 
 FFTConfig*
 FFTInit(unsigned length)
+{
+    return FFTInitWithEffort(length, FFT_PLAN_MEASURE);
+}
+
+
+FFTConfigD*
+FFTInitD(unsigned length)
+{
+    return FFTInitWithEffortD(length, FFT_PLAN_MEASURE);
+}
+
+
+FFTConfig*
+FFTInitWithEffort(unsigned length, FFTPlanEffort_t effort)
 {
     FFTConfig* fft = (FFTConfig*)malloc(sizeof(FFTConfig));
     float* split_realp = (float*)malloc(length * sizeof(float));
     float* split2_realp = (float*)malloc(length * sizeof(float));
+    FFT_PLAN* plan = fft_plan_acquire(length, effort);
 
-    if (fft && split_realp && split2_realp)
+    if (fft && split_realp && split2_realp && plan)
     {
         fft->length = length;
         fft->scale = 1.0 / (fft->length);
         fft->log2n = log2f(fft->length);
+        fft->plan = plan;
 
         // Store these consecutively in memory
         fft->split.realp = split_realp;
@@ -159,30 +462,45 @@ FFTInit(unsigned length)
         fft->split2.imagp = fft->split2.realp + (fft->length / 2);
 
 #ifdef USE_FFTW_FFT
-        fftwf_complex* c = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * length);
-        float* r = (float*) fftwf_malloc(sizeof(float) * length);
-        fft->setup.forward_plan = fftwf_plan_dft_r2c_1d(length, r, c, FFTW_MEASURE | FFTW_UNALIGNED);
-        fft->setup.inverse_plan = fftwf_plan_dft_c2r_1d(length, c, r, FFTW_MEASURE | FFTW_UNALIGNED);
-        fftwf_free(r);
-        fftwf_free(c);
+        fft->setup.forward_plan = plan->forward_plan;
+        fft->setup.inverse_plan = plan->inverse_plan;
+        fft->setup.buffer = (float*)malloc((2 * fft->length + 2) * sizeof(float));
+        if (!fft->setup.buffer)
+        {
+            fft_plan_release(plan);
+            free(split_realp);
+            free(split2_realp);
+            free(fft);
+            return NULL;
+        }
+        ClearBuffer(fft->setup.buffer, 2 * fft->length + 2);
+        fft->setup.bins = (FFTComplex*)(fft->setup.buffer + fft->length);
 #elif defined (USE_OOURA_FFT)
         unsigned iplen = (unsigned)ceil(2 + sqrt((double)fft->length));
-        unsigned wlen = (unsigned)((fft->length * 5.0 / 8.0) - 1);
-        FFT_SETUP setup;
-        fft->setup = setup;
         fft->scale = 2.0 / (fft->length);
         fft->setup.ip = (int*) malloc(iplen * sizeof(int));
-        fft->setup.w = (double*) malloc(wlen * sizeof(double));
+        fft->setup.w = plan->w;
         fft->setup.buffer = (double*)malloc(2*fft->length * sizeof(double));
         fft->setup.fbuffer = (float*)malloc(2*fft->length * sizeof(float));
-        // Initialize Buffers
-        fft->setup.ip[0] = fft->setup.ip[1] = 0;
-        ClearBufferD(fft->setup.w, wlen);
+        // The plan has already built w, so rdft won't touch it
+        fft->setup.ip[0] = fft->setup.ip[1] = (int)(fft->length >> 2);
         ClearBufferD(fft->setup.buffer, fft->length + 1);
         ClearBuffer(fft->setup.fbuffer, fft->length + 1);
 
+#elif defined(USE_NATIVE_FFT)
+        fft->setup.buffer = (float*)malloc(2 * fft->length * sizeof(float));
+        if (!fft->setup.buffer)
+        {
+            fft_plan_release(plan);
+            free(split_realp);
+            free(split2_realp);
+            free(fft);
+            return NULL;
+        }
+        ClearBuffer(fft->setup.buffer, 2 * fft->length);
+        fft->setup.batch = NULL;
 #elif defined(USE_APPLE_FFT)
-        fft->setup = vDSP_create_fftsetup(fft->log2n, FFT_RADIX2);
+        fft->setup = plan->setup;
 #endif
         ClearBuffer(split_realp, fft->length);
         ClearBuffer(split2_realp, fft->length);
@@ -193,6 +511,7 @@ FFTInit(unsigned length)
     else
     {
         // Cleanup
+        fft_plan_release(plan);
         if (fft)
             free(fft);
         if (split_realp)
@@ -206,17 +525,19 @@ FFTInit(unsigned length)
 
 
 FFTConfigD*
-FFTInitD(unsigned length)
+FFTInitWithEffortD(unsigned length, FFTPlanEffort_t effort)
 {
     FFTConfigD* fft = (FFTConfigD*)malloc(sizeof(FFTConfigD));
     double* split_realp = (double*)malloc(length * sizeof(double));
     double* split2_realp = (double*)malloc(length * sizeof(double));
+    FFT_PLAN_D* plan = fft_plan_acquireD(length, effort);
 
-    if (fft && split_realp && split2_realp)
+    if (fft && split_realp && split2_realp && plan)
     {
         fft->length = length;
         fft->scale = 1.0 / (fft->length);
         fft->log2n = log2f(fft->length);
+        fft->plan = plan;
 
         // Store these consecutively in memory
         fft->split.realp = split_realp;
@@ -225,27 +546,43 @@ FFTInitD(unsigned length)
         fft->split2.imagp = fft->split2.realp + (fft->length / 2);
 
 #ifdef USE_FFTW_FFT
-        fftw_complex* c = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * length);
-        double* r = (double*) fftw_malloc(sizeof(double) * length);
-        fft->setup.forward_plan = fftw_plan_dft_r2c_1d(length, r, c, FFTW_MEASURE | FFTW_UNALIGNED);
-        fft->setup.inverse_plan = fftw_plan_dft_c2r_1d(length, c, r, FFTW_MEASURE | FFTW_UNALIGNED);
-        fftw_free(r);
-        fftw_free(c);
+        fft->setup.forward_plan = plan->forward_plan;
+        fft->setup.inverse_plan = plan->inverse_plan;
+        fft->setup.buffer = (double*)malloc((2 * fft->length + 2) * sizeof(double));
+        if (!fft->setup.buffer)
+        {
+            fft_plan_releaseD(plan);
+            free(split_realp);
+            free(split2_realp);
+            free(fft);
+            return NULL;
+        }
+        ClearBufferD(fft->setup.buffer, 2 * fft->length + 2);
+        fft->setup.bins = (FFTComplexD*)(fft->setup.buffer + fft->length);
 #elif defined (USE_OOURA_FFT)
         unsigned iplen = (unsigned)ceil(2 + sqrt((double)fft->length));
-        unsigned wlen = (unsigned)((fft->length * 5.0 / 8.0) - 1);
-        FFT_SETUP_D setup;
         fft->scale = 2.0 / (fft->length);
-        fft->setup = setup;
         fft->setup.ip = (int*) malloc(iplen * sizeof(int));
-        fft->setup.w = (double*) malloc(wlen * sizeof(double));
+        fft->setup.w = plan->w;
         fft->setup.buffer = (double*)malloc(2*fft->length * sizeof(double));
-        fft->setup.ip[0] = fft->setup.ip[1] = 0;
-        ClearBufferD(fft->setup.w, wlen);
+        // The plan has already built w, so rdft won't touch it
+        fft->setup.ip[0] = fft->setup.ip[1] = (int)(fft->length >> 2);
         ClearBufferD(fft->setup.buffer, fft->length);
 
+#elif defined(USE_NATIVE_FFT)
+        fft->setup.buffer = (double*)malloc(2 * fft->length * sizeof(double));
+        if (!fft->setup.buffer)
+        {
+            fft_plan_releaseD(plan);
+            free(split_realp);
+            free(split2_realp);
+            free(fft);
+            return NULL;
+        }
+        ClearBufferD(fft->setup.buffer, 2 * fft->length);
+        fft->setup.batch = NULL;
 #elif defined(USE_APPLE_FFT)
-        fft->setup = vDSP_create_fftsetupD(fft->log2n, FFT_RADIX2);
+        fft->setup = plan->setup;
 #endif
         ClearBufferD(split_realp, fft->length);
         ClearBufferD(split2_realp, fft->length);
@@ -256,6 +593,7 @@ FFTInitD(unsigned length)
     else
     {
         // Cleanup
+        fft_plan_releaseD(plan);
         if (fft)
             free(fft);
         if (split_realp)
@@ -283,22 +621,18 @@ FFTFree(FFTConfig* fft)
             fft->split2.realp = NULL;
         }
 
-#ifdef USE_FFTW_FFT
-        if (fft->setup.forward_plan)
-            fftwf_destroy_plan(fft->setup.forward_plan);
-        if (fft->setup.inverse_plan)
-            fftwf_destroy_plan(fft->setup.inverse_plan);
+#if defined(USE_FFTW_FFT)
+        free(fft->setup.buffer);
 #elif defined(USE_OOURA_FFT)
         free(fft->setup.ip);
-        free(fft->setup.w);
         free(fft->setup.buffer);
         free(fft->setup.fbuffer);
-#elif defined(USE_APPLE_FFT)
-        if (fft->setup)
-        {
-            vDSP_destroy_fftsetup(fft->setup);
-        }
+#elif defined(USE_NATIVE_FFT)
+        free(fft->setup.buffer);
+        free(fft->setup.batch);
 #endif
+        // Plans and tables are released with the last config that uses them
+        fft_plan_release(fft->plan);
         free(fft);
         fft = NULL;
     }
@@ -320,21 +654,16 @@ FFTFreeD(FFTConfigD* fft)
             free(fft->split2.realp);
             fft->split2.realp = NULL;
         }
-#ifdef USE_FFTW_FFT
-        if (fft->setup.forward_plan)
-            fftw_destroy_plan(fft->setup.forward_plan);
-        if (fft->setup.inverse_plan)
-            fftw_destroy_plan(fft->setup.inverse_plan);
+#if defined(USE_FFTW_FFT)
+        free(fft->setup.buffer);
 #elif defined(USE_OOURA_FFT)
         free(fft->setup.ip);
-        free(fft->setup.w);
         free(fft->setup.buffer);
-#elif defined(USE_APPLE_FFT)
-        if (fft->setup)
-        {
-            vDSP_destroy_fftsetupD(fft->setup);
-        }
+#elif defined(USE_NATIVE_FFT)
+        free(fft->setup.buffer);
+        free(fft->setup.batch);
 #endif
+        fft_plan_releaseD(fft->plan);
         free(fft);
         fft = NULL;
     }
@@ -342,6 +671,150 @@ FFTFreeD(FFTConfigD* fft)
 }
 
 
+#pragma mark - Length
+
+unsigned
+FFTNextGoodLength(unsigned length)
+{
+    unsigned best = (length > 2) ? (unsigned)next_pow2((int)length) : 2;
+#if defined(USE_NATIVE_FFT) || defined(USE_FFTW_FFT)
+    // Smallest even 2^a * 3^b * 5^c that is at least length
+    for (unsigned p5 = 1; p5 < best; p5 *= 5)
+    {
+        for (unsigned p35 = p5; p35 < best; p35 *= 3)
+        {
+            unsigned candidate = 2 * p35;
+            while (candidate < length)
+            {
+                candidate *= 2;
+            }
+            if (candidate < best)
+            {
+                best = candidate;
+            }
+        }
+    }
+#endif
+    return best;
+}
+
+
+#pragma mark - Wisdom
+
+/* FFTW keeps separate wisdom for each precision. The other backends have no
+ planner, so importing and exporting wisdom is a no-op for them */
+Error_t
+FFTImportWisdomFromFile(const char* filename)
+{
+    if (!filename)
+    {
+        return NULL_PTR_ERROR;
+    }
+#ifdef USE_FFTW_FFT
+    return fftwf_import_wisdom_from_filename(filename) ? NOERR : ERROR;
+#else
+    return NOERR;
+#endif
+}
+
+
+Error_t
+FFTImportWisdomFromFileD(const char* filename)
+{
+    if (!filename)
+    {
+        return NULL_PTR_ERROR;
+    }
+#ifdef USE_FFTW_FFT
+    return fftw_import_wisdom_from_filename(filename) ? NOERR : ERROR;
+#else
+    return NOERR;
+#endif
+}
+
+
+Error_t
+FFTExportWisdomToFile(const char* filename)
+{
+    if (!filename)
+    {
+        return NULL_PTR_ERROR;
+    }
+#ifdef USE_FFTW_FFT
+    return fftwf_export_wisdom_to_filename(filename) ? NOERR : ERROR;
+#else
+    return NOERR;
+#endif
+}
+
+
+Error_t
+FFTExportWisdomToFileD(const char* filename)
+{
+    if (!filename)
+    {
+        return NULL_PTR_ERROR;
+    }
+#ifdef USE_FFTW_FFT
+    return fftw_export_wisdom_to_filename(filename) ? NOERR : ERROR;
+#else
+    return NOERR;
+#endif
+}
+
+
+Error_t
+FFTImportWisdomFromString(const char* wisdom)
+{
+    if (!wisdom)
+    {
+        return NULL_PTR_ERROR;
+    }
+#ifdef USE_FFTW_FFT
+    return fftwf_import_wisdom_from_string(wisdom) ? NOERR : ERROR;
+#else
+    return NOERR;
+#endif
+}
+
+
+Error_t
+FFTImportWisdomFromStringD(const char* wisdom)
+{
+    if (!wisdom)
+    {
+        return NULL_PTR_ERROR;
+    }
+#ifdef USE_FFTW_FFT
+    return fftw_import_wisdom_from_string(wisdom) ? NOERR : ERROR;
+#else
+    return NOERR;
+#endif
+}
+
+
+char*
+FFTExportWisdomToString(void)
+{
+#ifdef USE_FFTW_FFT
+    return fftwf_export_wisdom_to_string();
+#else
+    return NULL;
+#endif
+}
+
+
+char*
+FFTExportWisdomToStringD(void)
+{
+#ifdef USE_FFTW_FFT
+    return fftw_export_wisdom_to_string();
+#else
+    return NULL;
+#endif
+}
+
+
 #pragma mark - FFT
 
 Error_t
@@ -351,7 +824,7 @@ FFT_R2C(FFTConfig*      fft,
         float*          imag)
 {
 #ifdef USE_FFTW_FFT
-    FFTComplex temp[fft->length];
+    FFTComplex* temp = fft->setup.bins;
     fftwf_execute_dft_r2c(fft->setup.forward_plan, (float*)inBuffer, temp);
     split_complex(real, imag, (const float*)temp, fft->length);
 #elif defined(USE_OOURA_FFT)
@@ -372,6 +845,10 @@ FFT_R2C(FFTConfig*      fft,
     }
     real[fft->length / 2 - 1] = -imag[0];
     imag[0] = 0.0;
+#elif defined(USE_NATIVE_FFT)
+    native_rfft(fft->plan, fft->setup.buffer, inBuffer, fft->length, real, imag);
+    real[fft->length / 2 - 1] = imag[0];
+    imag[0] = 0.0;
 #elif defined(USE_APPLE_FFT)
     FFTSplitComplex out = {.realp = real, .imagp = imag};
 
@@ -397,7 +874,7 @@ FFT_R2CD(FFTConfigD*    fft,
 {
 
 #ifdef USE_FFTW_FFT
-    FFTComplexD temp[fft->length];
+    FFTComplexD* temp = fft->setup.bins;
     fftw_execute_dft_r2c(fft->setup.forward_plan, (double*)inBuffer, temp);
     split_complexD(real, imag, (const double*)temp, fft->length);
 
@@ -415,6 +892,10 @@ FFT_R2CD(FFTConfigD*    fft,
     }
     real[fft->length / 2 - 1] = -imag[0];
     imag[0] = 0.0;
+#elif defined(USE_NATIVE_FFT)
+    native_rfftD(fft->plan, fft->setup.buffer, inBuffer, fft->length, real, imag);
+    real[fft->length / 2 - 1] = imag[0];
+    imag[0] = 0.0;
 #elif defined(USE_APPLE_FFT)
     FFTSplitComplexD out = {.realp = real, .imagp = imag};
 
@@ -439,7 +920,7 @@ FFT_IR_R2C(FFTConfig*       fft,
            FFTSplitComplex  out)
 {
 #ifdef USE_FFTW_FFT
-    FFTComplex temp[fft->length];
+    FFTComplex* temp = fft->setup.bins;
     fftwf_execute_dft_r2c(fft->setup.forward_plan, (float*)inBuffer, temp);
     split_complex(out.realp, out.imagp, (const float*)temp, fft->length);
     out.imagp[0] = ((float*)temp)[fft->length];
@@ -459,6 +940,8 @@ FFT_IR_R2C(FFTConfig*       fft,
         *re++ = *buf++;
         *im++ = -(*buf++);
     }
+#elif defined(USE_NATIVE_FFT)
+    native_rfft(fft->plan, fft->setup.buffer, inBuffer, fft->length, out.realp, out.imagp);
 #elif defined(USE_APPLE_FFT)
 
     // convert real input to split complex
@@ -481,7 +964,7 @@ FFT_IR_R2CD(FFTConfigD*         fft,
 {
 
 #ifdef USE_FFTW_FFT
-    FFTComplexD temp[fft->length];
+    FFTComplexD* temp = fft->setup.bins;
     fftw_execute_dft_r2c(fft->setup.forward_plan, (double*)inBuffer, temp);
     split_complexD(out.realp, out.imagp, (const double*)temp, fft->length);
     out.imagp[0] = ((double*)temp)[fft->length];
@@ -497,6 +980,8 @@ FFT_IR_R2CD(FFTConfigD*         fft,
         *re++ = *buf++;
         *im++ = -(*buf++);
     }
+#elif defined(USE_NATIVE_FFT)
+    native_rfftD(fft->plan, fft->setup.buffer, inBuffer, fft->length, out.realp, out.imagp);
 #elif defined(USE_APPLE_FFT)
 
     // convert real input to split complex
@@ -521,7 +1006,7 @@ IFFT_C2R(FFTConfig*    fft,
          float*        out)
 {
 #ifdef USE_FFTW_FFT
-    FFTComplex temp[fft->length/2 + 1];
+    FFTComplex* temp = fft->setup.bins;
     interleave_complex((float*)temp, inReal, inImag, fft->length);
     ((float*)temp)[fft->length] = inReal[fft->length / 2 - 1];
     fftwf_execute_dft_c2r(fft->setup.inverse_plan, temp, out);
@@ -545,6 +1030,9 @@ IFFT_C2R(FFTConfig*    fft,
     DoubleToFloat(fft->setup.fbuffer, fft->setup.buffer, fft->length);
     VectorScalarMultiply(out, fft->setup.fbuffer, fft->scale, fft->length);
 
+#elif defined(USE_NATIVE_FFT)
+    native_irfft(fft->plan, fft->setup.buffer, inReal, inImag, inReal[fft->length / 2 - 1],
+                 out, fft->scale);
 
 #elif defined(USE_APPLE_FFT)
     // Convert input to split complex format
@@ -568,7 +1056,7 @@ IFFT_C2RD(FFTConfigD*   fft,
        double*          out)
 {
 #ifdef USE_FFTW_FFT
-    FFTComplexD temp[fft->length/2 + 1];
+    FFTComplexD* temp = fft->setup.bins;
     interleave_complexD((double*)temp, inReal, inImag, fft->length);
     ((double*)temp)[fft->length] = inReal[fft->length / 2 - 1];
     fftw_execute_dft_c2r(fft->setup.inverse_plan, temp, out);
@@ -588,6 +1076,9 @@ IFFT_C2RD(FFTConfigD*   fft,
     rdft(fft->length, -1, fft->setup.buffer, fft->setup.ip, fft->setup.w);
     VectorScalarMultiplyD(out, fft->setup.buffer, fft->scale, fft->length);
 
+#elif defined(USE_NATIVE_FFT)
+    native_irfftD(fft->plan, fft->setup.buffer, inReal, inImag, inReal[fft->length / 2 - 1],
+                  out, fft->scale);
 
 #elif defined(USE_APPLE_FFT)
     // Convert input to split complex format
@@ -604,38 +1095,214 @@ IFFT_C2RD(FFTConfigD*   fft,
     return NOERR;
 }
 
-#pragma mark - FFT Convolution
-
 Error_t
-FFTConvolve(FFTConfig*  fft,
-            float       *in1,
-            unsigned    in1_length,
-            float       *in2,
-            unsigned    in2_length,
-            float       *dest)
+IFFT_IR_C2R(FFTConfig*      fft,
+            FFTSplitComplex in,
+            float*          out)
 {
+#ifdef USE_FFTW_FFT
+    FFTComplex* temp = fft->setup.bins;
+    interleave_complex((float*)temp, in.realp, in.imagp, fft->length);
+    ((float*)temp)[1] = 0.0;
+    ((float*)temp)[fft->length] = in.imagp[0];
+    ((float*)temp)[fft->length + 1] = 0.0;
+    fftwf_execute_dft_c2r(fft->setup.inverse_plan, temp, out);
+    VectorScalarMultiply(out, out, fft->scale, fft->length);
+#elif defined(USE_OOURA_FFT)
 
-#if defined(USE_FFTW_FFT)
+    float* re = in.realp;
+    float* im = in.imagp;
+    float* buf = fft->setup.fbuffer;
+    float* end = fft->setup.fbuffer + fft->length;
 
-    FFTComplex temp[fft->length];
+    while (buf != end)
+    {
+        *buf++ = *re++;
+        *buf++ = -(*im++);
+    }
+
+    FloatToDouble(fft->setup.buffer, fft->setup.fbuffer, fft->length);
+    rdft(fft->length, -1, fft->setup.buffer, fft->setup.ip, fft->setup.w);
+    DoubleToFloat(fft->setup.fbuffer, fft->setup.buffer, fft->length);
+    VectorScalarMultiply(out, fft->setup.fbuffer, fft->scale, fft->length);
+
+#elif defined(USE_NATIVE_FFT)
+    native_irfft(fft->plan, fft->setup.buffer, in.realp, in.imagp, in.imagp[0],
+                 out, fft->scale);
+
+#elif defined(USE_APPLE_FFT)
+    // Copy input so the transform doesn't overwrite it
+    CopyBuffer(fft->split.realp, in.realp, fft->length/2);
+    CopyBuffer(fft->split.imagp, in.imagp, fft->length/2);
+
+    // Inverse Real FFT
+    vDSP_fft_zrip(fft->setup, &fft->split, 1, fft->log2n, FFT_INVERSE);
+    vDSP_ztoc(&fft->split, 1, (FFTComplex*)out, 2, fft->length/2);
+    // Scale the result...
+    vDSP_vsmul(out, 1, &fft->scale, out, 1, fft->length);
+#endif
+    return NOERR;
+}
+
+Error_t
+IFFT_IR_C2RD(FFTConfigD*        fft,
+             FFTSplitComplexD   in,
+             double*            out)
+{
+#ifdef USE_FFTW_FFT
+    FFTComplexD* temp = fft->setup.bins;
+    interleave_complexD((double*)temp, in.realp, in.imagp, fft->length);
+    ((double*)temp)[1] = 0.0;
+    ((double*)temp)[fft->length] = in.imagp[0];
+    ((double*)temp)[fft->length + 1] = 0.0;
+    fftw_execute_dft_c2r(fft->setup.inverse_plan, temp, out);
+    VectorScalarMultiplyD(out, out, fft->scale, fft->length);
+#elif defined(USE_OOURA_FFT)
+    double* re = in.realp;
+    double* im = in.imagp;
+    double* buf = fft->setup.buffer;
+    double* end = fft->setup.buffer + fft->length;
+
+    while (buf != end)
+    {
+        *buf++ = *re++;
+        *buf++ = -(*im++);
+    }
+    rdft(fft->length, -1, fft->setup.buffer, fft->setup.ip, fft->setup.w);
+    VectorScalarMultiplyD(out, fft->setup.buffer, fft->scale, fft->length);
+
+#elif defined(USE_NATIVE_FFT)
+    native_irfftD(fft->plan, fft->setup.buffer, in.realp, in.imagp, in.imagp[0],
+                  out, fft->scale);
+
+#elif defined(USE_APPLE_FFT)
+    // Copy input so the transform doesn't overwrite it
+    CopyBufferD(fft->split.realp, in.realp, fft->length/2);
+    CopyBufferD(fft->split.imagp, in.imagp, fft->length/2);
+
+    // Inverse Real FFT
+    vDSP_fft_zripD(fft->setup, &fft->split, 1, fft->log2n, FFT_INVERSE);
+    vDSP_ztocD(&fft->split, 1, (FFTComplexD*)out, 2, fft->length/2);
+    // Scale the result...
+    vDSP_vsmulD(out, 1, &fft->scale, out, 1, fft->length);
+#endif
+    return NOERR;
+}
+
+#pragma mark - Complex FFT
+
+Error_t
+FFT_C2C(FFTConfig*      fft,
+        const float*    inReal,
+        const float*    inImag,
+        float*          outReal,
+        float*          outImag)
+{
+#ifdef USE_FFTW_FFT
+    CopyBuffer(outReal, inReal, fft->length);
+    CopyBuffer(outImag, inImag, fft->length);
+    fftwf_execute_split_dft(fft->plan->complex_plan, outReal, outImag, outReal, outImag);
+#elif defined(USE_OOURA_FFT)
+    ooura_c2c(fft, inReal, inImag, outReal, outImag);
+#elif defined(USE_NATIVE_FFT)
+    native_c2c(fft->plan, fft->setup.buffer, inReal, inImag, outReal, outImag);
+#elif defined(USE_APPLE_FFT)
+    FFTSplitComplex out = {outReal, outImag};
+    CopyBuffer(outReal, inReal, fft->length);
+    CopyBuffer(outImag, inImag, fft->length);
+    vDSP_fft_zip(fft->setup, &out, 1, fft->log2n, FFT_FORWARD);
+#endif
+    return NOERR;
+}
+
+
+Error_t
+IFFT_C2C(FFTConfig*     fft,
+         const float*   inReal,
+         const float*   inImag,
+         float*         outReal,
+         float*         outImag)
+{
+    // The inverse is the forward transform with real and imaginary parts
+    // swapped, scaled by 1/N
+    Error_t err = FFT_C2C(fft, inImag, inReal, outImag, outReal);
+    if (err == NOERR)
+    {
+        VectorScalarMultiply(outReal, outReal, 1.0 / fft->length, fft->length);
+        VectorScalarMultiply(outImag, outImag, 1.0 / fft->length, fft->length);
+    }
+    return err;
+}
+
+
+Error_t
+FFT_C2CD(FFTConfigD*    fft,
+         const double*  inReal,
+         const double*  inImag,
+         double*        outReal,
+         double*        outImag)
+{
+#ifdef USE_FFTW_FFT
+    CopyBufferD(outReal, inReal, fft->length);
+    CopyBufferD(outImag, inImag, fft->length);
+    fftw_execute_split_dft(fft->plan->complex_plan, outReal, outImag, outReal, outImag);
+#elif defined(USE_OOURA_FFT)
+    ooura_c2cD(fft, inReal, inImag, outReal, outImag);
+#elif defined(USE_NATIVE_FFT)
+    native_c2cD(fft->plan, fft->setup.buffer, inReal, inImag, outReal, outImag);
+#elif defined(USE_APPLE_FFT)
+    FFTSplitComplexD out = {outReal, outImag};
+    CopyBufferD(outReal, inReal, fft->length);
+    CopyBufferD(outImag, inImag, fft->length);
+    vDSP_fft_zipD(fft->setup, &out, 1, fft->log2n, FFT_FORWARD);
+#endif
+    return NOERR;
+}
+
+
+Error_t
+IFFT_C2CD(FFTConfigD*   fft,
+          const double* inReal,
+          const double* inImag,
+          double*       outReal,
+          double*       outImag)
+{
+    Error_t err = FFT_C2CD(fft, inImag, inReal, outImag, outReal);
+    if (err == NOERR)
+    {
+        VectorScalarMultiplyD(outReal, outReal, 1.0 / fft->length, fft->length);
+        VectorScalarMultiplyD(outImag, outImag, 1.0 / fft->length, fft->length);
+    }
+    return err;
+}
 
-    // Padded input buffers
-    float in1_padded[fft->length];
-    float in2_padded[fft->length];
-    ClearBuffer(in1_padded, fft->length);
-    ClearBuffer(in2_padded, fft->length);
-    ClearBuffer(fft->split.realp, fft->length);
-    ClearBuffer(fft->split2.realp, fft->length);
 
-    // Zero pad the input buffers to FFT length
-    CopyBuffer(in1_padded, in1, in1_length);
-    CopyBuffer(in2_padded, in2, in2_length);
+#pragma mark - FFT Convolution
+
+Error_t
+FFTConvolve(FFTConfig*  fft,
+            float       *in1,
+            unsigned    in1_length,
+            float       *in2,
+            unsigned    in2_length,
+            float       *dest)
+{
+
+#if defined(USE_FFTW_FFT)
 
-    fftwf_execute_dft_r2c(fft->setup.forward_plan, (float*)in1_padded, temp);
+    FFTComplex* temp = fft->setup.bins;
+    float* padded = fft->setup.buffer;
+
+    // Zero pad each input to FFT length in turn and transform it
+    ClearBuffer(padded, fft->length);
+    CopyBuffer(padded, in1, in1_length);
+    fftwf_execute_dft_r2c(fft->setup.forward_plan, padded, temp);
     float nyquist1 = ((float*)temp)[fft->length];
     split_complex(fft->split.realp, fft->split.imagp, (const float*)temp, fft->length);
 
-    fftwf_execute_dft_r2c(fft->setup.forward_plan, (float*)in2_padded, temp);
+    ClearBuffer(padded, fft->length);
+    CopyBuffer(padded, in2, in2_length);
+    fftwf_execute_dft_r2c(fft->setup.forward_plan, padded, temp);
     float nyquist2 = ((float*)temp)[fft->length];
     split_complex(fft->split2.realp, fft->split2.imagp, (const float*)temp, fft->length);
 
@@ -707,24 +1374,37 @@ FFTConvolve(FFTConfig*  fft,
     DoubleToFloat(fft->setup.fbuffer, fft->setup.buffer, fft->length);
     VectorScalarMultiply(dest, fft->setup.fbuffer, fft->scale, fft->length);
 
+#elif defined(USE_NATIVE_FFT)
+
+    // Transform both inputs, zero padded to the FFT length
+    native_rfft(fft->plan, fft->setup.buffer, in1, in1_length, fft->split.realp, fft->split.imagp);
+    native_rfft(fft->plan, fft->setup.buffer, in2, in2_length, fft->split2.realp, fft->split2.imagp);
+
+    // Unpack nyquist, multiply, and inverse transform
+    float nyquist_out = fft->split.imagp[0] * fft->split2.imagp[0];
+    fft->split.imagp[0] = 0.0;
+    fft->split2.imagp[0] = 0.0;
+    ComplexMultiply(fft->split.realp, fft->split.imagp, fft->split.realp,
+                    fft->split.imagp, fft->split2.realp, fft->split2.imagp,
+                    fft->length/2);
+    native_irfft(fft->plan, fft->setup.buffer, fft->split.realp, fft->split.imagp, nyquist_out,
+                 dest, fft->scale);
 
 #elif defined(USE_APPLE_FFT)
 
-    // Padded input buffers
-    float in1_padded[fft->length];
-    float in2_padded[fft->length];
-    ClearBuffer(in1_padded, fft->length);
-    ClearBuffer(in2_padded, fft->length);
+    // Convert real input to split complex, zero padded to FFT length
     ClearBuffer(fft->split.realp, fft->length);
     ClearBuffer(fft->split2.realp, fft->length);
-
-    // Zero pad the input buffers to FFT length
-    CopyBuffer(in1_padded, in1, in1_length);
-    CopyBuffer(in2_padded, in2, in2_length);
-
-    // convert real input to split complex
-    vDSP_ctoz((FFTComplex*)in1_padded, 2, &fft->split, 1, (fft->length/2));
-    vDSP_ctoz((FFTComplex*)in2_padded, 2, &fft->split2, 1, (fft->length/2));
+    vDSP_ctoz((const FFTComplex*)in1, 2, &fft->split, 1, in1_length / 2);
+    vDSP_ctoz((const FFTComplex*)in2, 2, &fft->split2, 1, in2_length / 2);
+    if (in1_length % 2)
+    {
+        fft->split.realp[in1_length / 2] = in1[in1_length - 1];
+    }
+    if (in2_length % 2)
+    {
+        fft->split2.realp[in2_length / 2] = in2[in2_length - 1];
+    }
 
     // Calculate FFT of the two signals
     vDSP_fft_zrip(fft->setup, &fft->split, 1, fft->log2n, FFT_FORWARD);
@@ -765,25 +1445,19 @@ FFTConvolveD(FFTConfigD*    fft,
 
 #if defined(USE_FFTW_FFT)
 
-    FFTComplexD temp[fft->length];
-
-    // Padded input buffers
-    double in1_padded[fft->length];
-    double in2_padded[fft->length];
-    ClearBufferD(in1_padded, fft->length);
-    ClearBufferD(in2_padded, fft->length);
-    ClearBufferD(fft->split.realp, fft->length);
-    ClearBufferD(fft->split2.realp, fft->length);
-
-    // Zero pad the input buffers to FFT length
-    CopyBufferD(in1_padded, in1, in1_length);
-    CopyBufferD(in2_padded, in2, in2_length);
+    FFTComplexD* temp = fft->setup.bins;
+    double* padded = fft->setup.buffer;
 
-    fftw_execute_dft_r2c(fft->setup.forward_plan, (double*)in1_padded, temp);
+    // Zero pad each input to FFT length in turn and transform it
+    ClearBufferD(padded, fft->length);
+    CopyBufferD(padded, in1, in1_length);
+    fftw_execute_dft_r2c(fft->setup.forward_plan, padded, temp);
     double nyquist1 = ((double*)temp)[fft->length];
     split_complexD(fft->split.realp, fft->split.imagp, (const double*)temp, fft->length);
 
-    fftw_execute_dft_r2c(fft->setup.forward_plan, (double*)in2_padded, temp);
+    ClearBufferD(padded, fft->length);
+    CopyBufferD(padded, in2, in2_length);
+    fftw_execute_dft_r2c(fft->setup.forward_plan, padded, temp);
     double nyquist2 = ((double*)temp)[fft->length];
     split_complexD(fft->split2.realp, fft->split2.imagp, (const double*)temp, fft->length);
 
@@ -851,23 +1525,36 @@ FFTConvolveD(FFTConfigD*    fft,
     rdft(fft->length, -1, fft->setup.buffer, fft->setup.ip, fft->setup.w);
     VectorScalarMultiplyD(dest, fft->setup.buffer, fft->scale, fft->length);
 
+#elif defined(USE_NATIVE_FFT)
+
+    // Transform both inputs, zero padded to the FFT length
+    native_rfftD(fft->plan, fft->setup.buffer, in1, in1_length, fft->split.realp, fft->split.imagp);
+    native_rfftD(fft->plan, fft->setup.buffer, in2, in2_length, fft->split2.realp, fft->split2.imagp);
+
+    // Unpack nyquist, multiply, and inverse transform
+    double nyquist_out = fft->split.imagp[0] * fft->split2.imagp[0];
+    fft->split.imagp[0] = 0.0;
+    fft->split2.imagp[0] = 0.0;
+    ComplexMultiplyD(fft->split.realp, fft->split.imagp, fft->split.realp,
+                     fft->split.imagp, fft->split2.realp, fft->split2.imagp,
+                     fft->length / 2);
+    native_irfftD(fft->plan, fft->setup.buffer, fft->split.realp, fft->split.imagp, nyquist_out,
+                  dest, fft->scale);
 
 #elif defined(USE_APPLE_FFT)
-    // Padded input buffers
-    double in1_padded[fft->length];
-    double in2_padded[fft->length];
-    ClearBufferD(in1_padded, fft->length);
-    ClearBufferD(in2_padded, fft->length);
+    // Convert real input to split complex, zero padded to FFT length
     ClearBufferD(fft->split.realp, fft->length);
     ClearBufferD(fft->split2.realp, fft->length);
-
-    // Zero pad the input buffers to FFT length
-    CopyBufferD(in1_padded, in1, in1_length);
-    CopyBufferD(in2_padded, in2, in2_length);
-
-    // convert real input to split complex
-    vDSP_ctozD((FFTComplexD*)in1_padded, 2, &fft->split, 1, (fft->length/2));
-    vDSP_ctozD((FFTComplexD*)in2_padded, 2, &fft->split2, 1, (fft->length/2));
+    vDSP_ctozD((const FFTComplexD*)in1, 2, &fft->split, 1, in1_length / 2);
+    vDSP_ctozD((const FFTComplexD*)in2, 2, &fft->split2, 1, in2_length / 2);
+    if (in1_length % 2)
+    {
+        fft->split.realp[in1_length / 2] = in1[in1_length - 1];
+    }
+    if (in2_length % 2)
+    {
+        fft->split2.realp[in2_length / 2] = in2[in2_length - 1];
+    }
 
     // Calculate FFT of the two signals
     vDSP_fft_zripD(fft->setup, &fft->split, 1, fft->log2n, FFT_FORWARD);
@@ -908,16 +1595,14 @@ FFTFilterConvolve(FFTConfig*        fft,
 
 #ifdef USE_FFTW_FFT
 
-    FFTComplex temp[fft->length];
-
-    // Padded input buffers
-    float in_padded[fft->length];
+    FFTComplex* temp = fft->setup.bins;
 
-    ClearBuffer(in_padded, fft->length);
-    ClearBuffer(fft->split.realp, fft->length);
-    CopyBuffer(in_padded, in, in_length);
+    // Zero pad the input to FFT length
+    float* padded = fft->setup.buffer;
+    ClearBuffer(padded, fft->length);
+    CopyBuffer(padded, in, in_length);
 
-    fftwf_execute_dft_r2c(fft->setup.forward_plan, (float*)in_padded, temp);
+    fftwf_execute_dft_r2c(fft->setup.forward_plan, padded, temp);
     float nyquist = ((float*)temp)[fft->length];
     split_complex(fft->split.realp, fft->split.imagp, (const float*)temp, fft->length);
 
@@ -971,17 +1656,27 @@ FFTFilterConvolve(FFTConfig*        fft,
     rdft(fft->length, -1, fft->setup.buffer, fft->setup.ip, fft->setup.w);
     DoubleToFloat(fft->setup.fbuffer, fft->setup.buffer, fft->length);
     VectorScalarMultiply(dest, fft->setup.fbuffer, fft->scale, fft->length);
-#elif defined(USE_APPLE_FFT)
+#elif defined(USE_NATIVE_FFT)
 
-    // Padded buffer
-    float in_padded[fft->length];
+    // Transform the input, zero padded to the FFT length
+    native_rfft(fft->plan, fft->setup.buffer, in, in_length, fft->split.realp, fft->split.imagp);
 
-    // Zero pad the input to FFT length
-    ClearBuffer(in_padded, fft->length);
-    CopyBuffer(in_padded, in, in_length);
+    // Unpack nyquist, multiply, and inverse transform
+    float nyquist_out = fft->split.imagp[0] * fft_ir.imagp[0];
+    fft->split.imagp[0] = 0.0;
+    ComplexMultiply(fft->split.realp, fft->split.imagp, fft->split.realp,
+                    fft->split.imagp, fft_ir.realp, fft_ir.imagp, fft->length/2);
+    native_irfft(fft->plan, fft->setup.buffer, fft->split.realp, fft->split.imagp, nyquist_out,
+                 dest, fft->scale);
+#elif defined(USE_APPLE_FFT)
 
-    // convert real input to split complex
-    vDSP_ctoz((FFTComplex*)in_padded, 2, &fft->split, 1, (fft->length/2));
+    // Convert real input to split complex, zero padded to FFT length
+    ClearBuffer(fft->split.realp, fft->length);
+    vDSP_ctoz((const FFTComplex*)in, 2, &fft->split, 1, in_length / 2);
+    if (in_length % 2)
+    {
+        fft->split.realp[in_length / 2] = in[in_length - 1];
+    }
 
     // Calculate FFT of the two signals
     vDSP_fft_zrip(fft->setup, &fft->split, 1, fft->log2n, FFT_FORWARD);
@@ -1014,15 +1709,14 @@ FFTFilterConvolveD(FFTConfigD*      fft,
 
 
 #if defined(USE_FFTW_FFT)
-    FFTComplexD temp[fft->length];
+    FFTComplexD* temp = fft->setup.bins;
 
-    // Padded input buffers
-    double in_padded[fft->length];
-    ClearBufferD(in_padded, fft->length);
-    ClearBufferD(fft->split.realp, fft->length);
-    CopyBufferD(in_padded, in, in_length);
+    // Zero pad the input to FFT length
+    double* padded = fft->setup.buffer;
+    ClearBufferD(padded, fft->length);
+    CopyBufferD(padded, in, in_length);
 
-    fftw_execute_dft_r2c(fft->setup.forward_plan, (double*)in_padded, temp);
+    fftw_execute_dft_r2c(fft->setup.forward_plan, padded, temp);
     double nyquist = ((double*)temp)[fft->length];
     split_complexD(fft->split.realp, fft->split.imagp, (const double*)temp, fft->length);
 
@@ -1077,17 +1771,28 @@ FFTFilterConvolveD(FFTConfigD*      fft,
 
     rdft(fft->length, -1, fft->setup.buffer, fft->setup.ip, fft->setup.w);
     VectorScalarMultiplyD(dest, fft->setup.buffer, fft->scale, fft->length);
-#elif defined(USE_APPLE_FFT)
+#elif defined(USE_NATIVE_FFT)
 
-    // Padded buffer
-    double in_padded[fft->length];
+    // Transform the input, zero padded to the FFT length
+    native_rfftD(fft->plan, fft->setup.buffer, in, in_length, fft->split.realp, fft->split.imagp);
 
-    // Zero pad the input to FFT length
-    ClearBufferD(in_padded, fft->length);
-    CopyBufferD(in_padded, in, in_length);
+    // Unpack nyquist, multiply, and inverse transform
+    double nyquist_out = fft->split.imagp[0] * fft_ir.imagp[0];
+    fft->split.imagp[0] = 0.0;
+    ComplexMultiplyD(fft->split.realp, fft->split.imagp, fft->split.realp,
+                     fft->split.imagp, fft_ir.realp, fft_ir.imagp,
+                     fft->length/2);
+    native_irfftD(fft->plan, fft->setup.buffer, fft->split.realp, fft->split.imagp, nyquist_out,
+                  dest, fft->scale);
+#elif defined(USE_APPLE_FFT)
 
-    // convert real input to split complex
-    vDSP_ctozD((FFTComplexD*)in_padded, 2, &fft->split, 1, (fft->length/2));
+    // Convert real input to split complex, zero padded to FFT length
+    ClearBufferD(fft->split.realp, fft->length);
+    vDSP_ctozD((const FFTComplexD*)in, 2, &fft->split, 1, in_length / 2);
+    if (in_length % 2)
+    {
+        fft->split.realp[in_length / 2] = in[in_length - 1];
+    }
 
     // Calculate FFT of the two signals
     vDSP_fft_zripD(fft->setup, &fft->split, 1, fft->log2n, FFT_FORWARD);
@@ -1110,329 +1815,1569 @@ FFTFilterConvolveD(FFTConfigD*      fft,
 }
 
 
-/******************************************************************************
- STATIC FUNCTION DEFINITIONS */
-#pragma mark - Static Function Definitions
-#ifdef USE_FFTW_FFT
-static inline void
-interleave_complex(float*dest, const float* real, const float* imag, unsigned length)
+Error_t
+FFTSpectrumMultiplyAccumulate(FFTConfig*        fft,
+                              FFTSplitComplex   accum,
+                              FFTSplitComplex   a,
+                              FFTSplitComplex   b)
 {
-#if defined(__APPLE__)
-    DSPSplitComplex split = {.realp = (float*)real, .imagp = (float*)imag};
-    vDSP_ztoc(&split, 1, (DSPComplex*)dest, 2, length/2);
-#elif defined(__HAS_BLAS__)
-    cblas_scopy(length/2, real, 1, dest, 2);
-    cblas_scopy(length/2, imag, 1, dest + 1, 2);
+    const unsigned bins = fft->length / 2;
+    float* acc_re = accum.realp;
+    float* acc_im = accum.imagp;
+    const float* a_re = a.realp;
+    const float* a_im = a.imagp;
+    const float* b_re = b.realp;
+    const float* b_im = b.imagp;
+
+    // DC and nyquist are both real, and packed together in the first bin
+    const float dc = acc_re[0] + a_re[0] * b_re[0];
+#ifdef USE_OOURA_FFT
+    // Ooura spectra carry the nyquist bin negated
+    const float nyquist = acc_im[0] - a_im[0] * b_im[0];
 #else
-    float* buf = &dest[0];
-    float* end = buf + length;
-    const float* re = real;
-    const float* im = imag;
-    while (buf != end)
+    const float nyquist = acc_im[0] + a_im[0] * b_im[0];
+#endif
+
+    unsigned k = 0;
+#ifdef FFT_X86
+    if (FFT_HAS_AVX())
     {
-        *buf++ = *re++;
-        *buf++ = *im++;
+        k = spectrum_mac_avx(acc_re, acc_im, a_re, a_im, b_re, b_im, bins);
+    }
+#endif
+#ifdef VF_WIDTH
+    for (; k + VF_WIDTH <= bins; k += VF_WIDTH)
+    {
+        vfloat ar = VF_LOAD(a_re + k);
+        vfloat ai = VF_LOAD(a_im + k);
+        vfloat br = VF_LOAD(b_re + k);
+        vfloat bi = VF_LOAD(b_im + k);
+        VF_STORE(acc_re + k, VF_ADD(VF_LOAD(acc_re + k),
+                                    VF_SUB(VF_MUL(ar, br), VF_MUL(ai, bi))));
+        VF_STORE(acc_im + k, VF_ADD(VF_LOAD(acc_im + k),
+                                    VF_ADD(VF_MUL(ar, bi), VF_MUL(ai, br))));
     }
 #endif
+    for (; k < bins; ++k)
+    {
+        const float ar = a_re[k];
+        const float ai = a_im[k];
+        acc_re[k] += ar * b_re[k] - ai * b_im[k];
+        acc_im[k] += ar * b_im[k] + ai * b_re[k];
+    }
+
+    acc_re[0] = dc;
+    acc_im[0] = nyquist;
+    return NOERR;
 }
 
-static inline void
-interleave_complexD(double* dest, const double* real, const double* imag, unsigned length)
+Error_t
+FFTSpectrumMultiplyAccumulateD(FFTConfigD*      fft,
+                               FFTSplitComplexD accum,
+                               FFTSplitComplexD a,
+                               FFTSplitComplexD b)
 {
-#if defined(__APPLE__)
-    DSPDoubleSplitComplex split = {.realp = (double*)real, .imagp = (double*)imag};
-    vDSP_ztocD(&split, 1, (DSPDoubleComplex*)dest, 2, length/2);
-#elif defined(__HAS_BLAS__)
-    cblas_dcopy(length/2, real, 1, dest, 2);
-    cblas_dcopy(length/2, imag, 1, dest + 1, 2);
+    const unsigned bins = fft->length / 2;
+    double* acc_re = accum.realp;
+    double* acc_im = accum.imagp;
+    const double* a_re = a.realp;
+    const double* a_im = a.imagp;
+    const double* b_re = b.realp;
+    const double* b_im = b.imagp;
+
+    // DC and nyquist are both real, and packed together in the first bin
+    const double dc = acc_re[0] + a_re[0] * b_re[0];
+#ifdef USE_OOURA_FFT
+    // Ooura spectra carry the nyquist bin negated
+    const double nyquist = acc_im[0] - a_im[0] * b_im[0];
 #else
-    double* buf = &dest[0];
-    double* end = buf + length;
-    const double* re = real;
-    const double* im = imag;
-    while (buf != end)
+    const double nyquist = acc_im[0] + a_im[0] * b_im[0];
+#endif
+
+    unsigned k = 0;
+#ifdef FFT_X86
+    if (FFT_HAS_AVX())
     {
-        *buf++ = *re++;
-        *buf++ = *im++;
+        k = spectrum_mac_avxD(acc_re, acc_im, a_re, a_im, b_re, b_im, bins);
+    }
+#endif
+#ifdef VD_WIDTH
+    for (; k + VD_WIDTH <= bins; k += VD_WIDTH)
+    {
+        vdouble ar = VD_LOAD(a_re + k);
+        vdouble ai = VD_LOAD(a_im + k);
+        vdouble br = VD_LOAD(b_re + k);
+        vdouble bi = VD_LOAD(b_im + k);
+        VD_STORE(acc_re + k, VD_ADD(VD_LOAD(acc_re + k),
+                                    VD_SUB(VD_MUL(ar, br), VD_MUL(ai, bi))));
+        VD_STORE(acc_im + k, VD_ADD(VD_LOAD(acc_im + k),
+                                    VD_ADD(VD_MUL(ar, bi), VD_MUL(ai, br))));
     }
 #endif
+    for (; k < bins; ++k)
+    {
+        const double ar = a_re[k];
+        const double ai = a_im[k];
+        acc_re[k] += ar * b_re[k] - ai * b_im[k];
+        acc_im[k] += ar * b_im[k] + ai * b_re[k];
+    }
+
+    acc_re[0] = dc;
+    acc_im[0] = nyquist;
+    return NOERR;
 }
 
 
-static inline void
-split_complex(float* real, float* imag, const float* data, unsigned length)
+#pragma mark - Batch
+
+Error_t
+FFTPrepareBatch(FFTConfig* fft)
 {
-#if defined(__APPLE__)
-    DSPSplitComplex split = {.realp = real, .imagp = imag};
-    vDSP_ctoz((DSPComplex*)data, 2, &split, 1, length/2);
-#elif defined(__HAS_BLAS__)
-    cblas_scopy(length/2, data, 2, real, 1);
-    cblas_scopy(length/2, data + 1, 2, imag, 1);
-#else
-    float* buf = (float*)data;
-    float* end = buf + length;
-    float* re = real;
-    float* im = imag;
-    while (buf != end)
+#ifdef USE_NATIVE_FFT
+    // Holds the complex FFT buffers and two sets of interleaved spectra for
+    // FFT_BATCH_CHANNELS channels
+    if (!fft->setup.batch)
     {
-        *re++ = *buf++;
-        *im++ = *buf++;
+        fft->setup.batch = (float*)malloc(4 * fft->length * FFT_BATCH_CHANNELS * sizeof(float));
+        if (!fft->setup.batch)
+        {
+            return NULL_PTR_ERROR;
+        }
     }
 #endif
+    return NOERR;
 }
 
 
-static inline void
-split_complexD(double* real, double* imag, const double* data, unsigned length)
+Error_t
+FFTPrepareBatchD(FFTConfigD* fft)
 {
-#if defined(__APPLE__)
-    DSPDoubleSplitComplex split = {.realp = real, .imagp = imag};
-    vDSP_ctozD((DSPDoubleComplex*)data, 2, &split, 1, length/2);
-#elif defined(__HAS_BLAS__)
-    cblas_dcopy(length/2, data, 2, real, 1);
-    cblas_dcopy(length/2, data + 1, 2, imag, 1);
-#else
-    double* buf = (double*)data;
-    double* end = buf + length;
-    double* re = real;
-    double* im = imag;
-    while (buf != end)
+#ifdef USE_NATIVE_FFT
+    if (!fft->setup.batch)
     {
-        *re++ = *buf++;
-        *im++ = *buf++;
+        fft->setup.batch = (double*)malloc(4 * fft->length * FFT_BATCH_CHANNELS * sizeof(double));
+        if (!fft->setup.batch)
+        {
+            return NULL_PTR_ERROR;
+        }
     }
 #endif
+    return NOERR;
 }
 
-#endif
 
+Error_t
+FFT_R2C_Batch(FFTConfig*    fft,
+              const float*  inBuffer,
+              float*        real,
+              float*        imag,
+              unsigned      n_channels)
+{
+    const unsigned half = fft->length / 2;
+#ifdef USE_NATIVE_FFT
+    float* buffer = fft->setup.batch;
+    if (!buffer)
+    {
+        return NULL_PTR_ERROR;
+    }
+    float* re = buffer + 2 * fft->length * FFT_BATCH_CHANNELS;
+    float* im = re + half * FFT_BATCH_CHANNELS;
 
-#ifdef USE_OOURA_FFT
-
-static void
-rdft(int n, int isgn, double *a, int *ip, double *w)
-{
-    void makewt(int nw, int *ip, double *w);
-    void makect(int nc, int *ip, double *c);
-    void bitrv2(int n, int *ip, double *a);
-    void cftfsub(int n, double *a, double *w);
-    void cftbsub(int n, double *a, double *w);
-    void rftfsub(int n, double *a, int nc, double *c);
-    void rftbsub(int n, double *a, int nc, double *c);
-    int nw, nc;
-    double xi;
+    for (unsigned ch = 0; ch < n_channels; ch += FFT_BATCH_CHANNELS)
+    {
+        unsigned group = (n_channels - ch < FFT_BATCH_CHANNELS) ? n_channels - ch : FFT_BATCH_CHANNELS;
+        native_rfft_batch(fft->plan, buffer, inBuffer + ch * fft->length,
+                          fft->length, fft->length, group, re, im);
 
-    nw = ip[0];
-    if (n > (nw << 2)) {
-        nw = n >> 2;
-        makewt(nw, ip, w);
-    }
-    nc = ip[1];
-    if (n > (nc << 2)) {
-        nc = n >> 2;
-        makect(nc, ip, w + nw);
-    }
-    if (isgn >= 0) {
-        if (n > 4) {
-            bitrv2(n, ip + 2, a);
-            cftfsub(n, a, w);
-            rftfsub(n, a, nc, w + nw);
-        } else if (n == 4) {
-            cftfsub(n, a, w);
-        }
-        xi = a[0] - a[1];
-        a[0] += a[1];
-        a[1] = xi;
-    } else {
-        a[1] = 0.5 * (a[0] - a[1]);
-        a[0] -= a[1];
-        if (n > 4) {
-            rftbsub(n, a, nc, w + nw);
-            bitrv2(n, ip + 2, a);
-            cftbsub(n, a, w);
-        } else if (n == 4) {
-            cftfsub(n, a, w);
+        // De-interleave into the same layout as FFT_R2C
+        for (unsigned c = 0; c < group; ++c)
+        {
+            float* out_re = real + (ch + c) * half;
+            float* out_im = imag + (ch + c) * half;
+            for (unsigned k = 0; k < half; ++k)
+            {
+                out_re[k] = re[k * group + c];
+                out_im[k] = im[k * group + c];
+            }
+            out_re[half - 1] = im[c];
+            out_im[0] = 0.0;
         }
     }
+#else
+    for (unsigned ch = 0; ch < n_channels; ++ch)
+    {
+        FFT_R2C(fft, inBuffer + ch * fft->length, real + ch * half, imag + ch * half);
+    }
+#endif
+    return NOERR;
 }
-static void
-makewt(int nw, int *ip, double *w)
+
+
+Error_t
+IFFT_C2R_Batch(FFTConfig*   fft,
+               const float* inReal,
+               const float* inImag,
+               float*       out,
+               unsigned     n_channels)
 {
-    void bitrv2(int n, int *ip, double *a);
-    int j, nwh;
-    double delta, x, y;
+    const unsigned half = fft->length / 2;
+#ifdef USE_NATIVE_FFT
+    float* buffer = fft->setup.batch;
+    if (!buffer)
+    {
+        return NULL_PTR_ERROR;
+    }
+    float* re = buffer + 2 * fft->length * FFT_BATCH_CHANNELS;
+    float* im = re + half * FFT_BATCH_CHANNELS;
 
-    ip[0] = nw;
-    ip[1] = 1;
-    if (nw > 2) {
-        nwh = nw >> 1;
-        delta = atan(1.0) / nwh;
-        w[0] = 1;
-        w[1] = 0;
-        w[nwh] = cos(delta * nwh);
-        w[nwh + 1] = w[nwh];
-        if (nwh > 2) {
-            for (j = 2; j < nwh; j += 2) {
-                x = cos(delta * j);
-                y = sin(delta * j);
-                w[j] = x;
-                w[j + 1] = y;
-                w[nw - j] = y;
-                w[nw - j + 1] = x;
+    for (unsigned ch = 0; ch < n_channels; ch += FFT_BATCH_CHANNELS)
+    {
+        unsigned group = (n_channels - ch < FFT_BATCH_CHANNELS) ? n_channels - ch : FFT_BATCH_CHANNELS;
+
+        // Interleave and pack the nyquist bin, as IFFT_C2R takes it
+        for (unsigned c = 0; c < group; ++c)
+        {
+            const float* in_re = inReal + (ch + c) * half;
+            const float* in_im = inImag + (ch + c) * half;
+            for (unsigned k = 0; k < half; ++k)
+            {
+                re[k * group + c] = in_re[k];
+                im[k * group + c] = in_im[k];
             }
-            bitrv2(nw, ip + 2, w);
+            im[c] = in_re[half - 1];
         }
+        native_irfft_batch(fft->plan, buffer, re, im, group,
+                           out + ch * fft->length, fft->length, fft->scale);
+    }
+#else
+    for (unsigned ch = 0; ch < n_channels; ++ch)
+    {
+        IFFT_C2R(fft, inReal + ch * half, inImag + ch * half, out + ch * fft->length);
     }
+#endif
+    return NOERR;
 }
 
 
-static void
-makect(int nc, int *ip, double *c)
+Error_t
+FFTConvolveBatch(FFTConfig*     fft,
+                 const float*   in1,
+                 unsigned       in1_length,
+                 const float*   in2,
+                 unsigned       in2_length,
+                 float*         dest,
+                 unsigned       n_channels)
 {
-    int j, nch;
-    double delta;
+#ifdef USE_NATIVE_FFT
+    const unsigned half = fft->length / 2;
+    float* buffer = fft->setup.batch;
+    if (!buffer)
+    {
+        return NULL_PTR_ERROR;
+    }
+    float* re1 = buffer + 2 * fft->length * FFT_BATCH_CHANNELS;
+    float* im1 = re1 + half * FFT_BATCH_CHANNELS;
+    float* re2 = im1 + half * FFT_BATCH_CHANNELS;
+    float* im2 = re2 + half * FFT_BATCH_CHANNELS;
 
-    ip[1] = nc;
-    if (nc > 1) {
-        nch = nc >> 1;
-        delta = atan(1.0) / nch;
-        c[0] = cos(delta * nch);
-        c[nch] = 0.5 * c[0];
-        for (j = 1; j < nch; j++) {
-            c[j] = 0.5 * cos(delta * j);
-            c[nc - j] = 0.5 * sin(delta * j);
+    for (unsigned ch = 0; ch < n_channels; ch += FFT_BATCH_CHANNELS)
+    {
+        unsigned group = (n_channels - ch < FFT_BATCH_CHANNELS) ? n_channels - ch : FFT_BATCH_CHANNELS;
+        native_rfft_batch(fft->plan, buffer, in1 + ch * in1_length, in1_length,
+                          in1_length, group, re1, im1);
+        native_rfft_batch(fft->plan, buffer, in2 + ch * in2_length, in2_length,
+                          in2_length, group, re2, im2);
+
+        // DC and nyquist are real, the other bins are multiplied as one block
+        for (unsigned c = 0; c < group; ++c)
+        {
+            re1[c] *= re2[c];
+            im1[c] *= im2[c];
         }
+        ComplexMultiply(re1 + group, im1 + group, re1 + group, im1 + group,
+                        re2 + group, im2 + group, (half - 1) * group);
+        native_irfft_batch(fft->plan, buffer, re1, im1, group,
+                           dest + ch * fft->length, fft->length, fft->scale);
+    }
+#else
+    for (unsigned ch = 0; ch < n_channels; ++ch)
+    {
+        FFTConvolve(fft, (float*)in1 + ch * in1_length, in1_length,
+                    (float*)in2 + ch * in2_length, in2_length, dest + ch * fft->length);
     }
+#endif
+    return NOERR;
 }
 
 
-/* -------- child routines -------- */
+Error_t
+FFTFilterConvolveBatch(FFTConfig*       fft,
+                       const float*     in,
+                       unsigned         in_length,
+                       FFTSplitComplex  fft_ir,
+                       float*           dest,
+                       unsigned         n_channels)
+{
+#ifdef USE_NATIVE_FFT
+    const unsigned half = fft->length / 2;
+    float* buffer = fft->setup.batch;
+    if (!buffer)
+    {
+        return NULL_PTR_ERROR;
+    }
+    float* re = buffer + 2 * fft->length * FFT_BATCH_CHANNELS;
+    float* im = re + half * FFT_BATCH_CHANNELS;
 
+    for (unsigned ch = 0; ch < n_channels; ch += FFT_BATCH_CHANNELS)
+    {
+        unsigned group = (n_channels - ch < FFT_BATCH_CHANNELS) ? n_channels - ch : FFT_BATCH_CHANNELS;
+        native_rfft_batch(fft->plan, buffer, in + ch * in_length, in_length,
+                          in_length, group, re, im);
+        native_batch_multiply(re, im, fft_ir.realp, fft_ir.imagp, half, group);
+        native_irfft_batch(fft->plan, buffer, re, im, group,
+                           dest + ch * fft->length, fft->length, fft->scale);
+    }
+#else
+    for (unsigned ch = 0; ch < n_channels; ++ch)
+    {
+        FFTFilterConvolve(fft, in + ch * in_length, in_length, fft_ir,
+                          dest + ch * fft->length);
+    }
+#endif
+    return NOERR;
+}
 
-static void
-bitrv2(int n, int *ip, double *a)
+Error_t
+FFTSpectrumMultiplyBatch(FFTConfig*      fft,
+                         FFTSplitComplex spectra,
+                         FFTSplitComplex kernel,
+                         unsigned        n_channels)
 {
-    int j, j1, k, k1, l, m, m2;
-    double xr, xi, yr, yi;
+    const unsigned bins = fft->length / 2;
+    const float* k_re = kernel.realp;
+    const float* k_im = kernel.imagp;
 
-    ip[0] = 0;
-    l = n;
-    m = 1;
-    while ((m << 3) < l) {
-        l >>= 1;
-        for (j = 0; j < m; j++) {
-            ip[m + j] = ip[j] + l;
-        }
-        m <<= 1;
-    }
-    m2 = 2 * m;
-    if ((m << 3) == l) {
-        for (k = 0; k < m; k++) {
-            for (j = 0; j < k; j++) {
-                j1 = 2 * j + ip[k];
-                k1 = 2 * k + ip[j];
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += 2 * m2;
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 -= m2;
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += 2 * m2;
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
+    for (unsigned start = 0; start < bins; start += FFT_BATCH_TILE)
+    {
+        const unsigned end = (bins - start < FFT_BATCH_TILE) ? bins : start + FFT_BATCH_TILE;
+        for (unsigned ch = 0; ch < n_channels; ++ch)
+        {
+            float* re = spectra.realp + ch * bins;
+            float* im = spectra.imagp + ch * bins;
+
+            // DC and nyquist are both real, and packed together in the first bin
+            const float dc = re[0] * k_re[0];
+#ifdef USE_OOURA_FFT
+            // Ooura spectra carry the nyquist bin negated
+            const float nyquist = -im[0] * k_im[0];
+#else
+            const float nyquist = im[0] * k_im[0];
+#endif
+
+            unsigned k = start;
+#ifdef FFT_X86
+            if (FFT_HAS_AVX())
+            {
+                k = spectrum_multiply_avx(re, im, k_re, k_im, start, end);
             }
-            j1 = 2 * k + m2 + ip[k];
-            k1 = j1 + m2;
-            xr = a[j1];
-            xi = a[j1 + 1];
-            yr = a[k1];
-            yi = a[k1 + 1];
-            a[j1] = yr;
-            a[j1 + 1] = yi;
-            a[k1] = xr;
-            a[k1 + 1] = xi;
-        }
-    } else {
-        for (k = 1; k < m; k++) {
-            for (j = 0; j < k; j++) {
-                j1 = 2 * j + ip[k];
-                k1 = 2 * k + ip[j];
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
-                j1 += m2;
-                k1 += m2;
-                xr = a[j1];
-                xi = a[j1 + 1];
-                yr = a[k1];
-                yi = a[k1 + 1];
-                a[j1] = yr;
-                a[j1 + 1] = yi;
-                a[k1] = xr;
-                a[k1 + 1] = xi;
+#endif
+#ifdef VF_WIDTH
+            for (; k + VF_WIDTH <= end; k += VF_WIDTH)
+            {
+                vfloat ar = VF_LOAD(re + k);
+                vfloat ai = VF_LOAD(im + k);
+                vfloat br = VF_LOAD(k_re + k);
+                vfloat bi = VF_LOAD(k_im + k);
+                VF_STORE(re + k, VF_SUB(VF_MUL(ar, br), VF_MUL(ai, bi)));
+                VF_STORE(im + k, VF_ADD(VF_MUL(ar, bi), VF_MUL(ai, br)));
+            }
+#endif
+            for (; k < end; ++k)
+            {
+                const float ar = re[k];
+                const float ai = im[k];
+                re[k] = ar * k_re[k] - ai * k_im[k];
+                im[k] = ar * k_im[k] + ai * k_re[k];
+            }
+
+            if (start == 0)
+            {
+                re[0] = dc;
+                im[0] = nyquist;
             }
         }
     }
+    return NOERR;
 }
 
 
-static void
-cftfsub(int n, double *a, double *w)
+Error_t
+FFT_R2C_BatchD(FFTConfigD*      fft,
+               const double*    inBuffer,
+               double*          real,
+               double*          imag,
+               unsigned         n_channels)
 {
-    void cft1st(int n, double *a, double *w);
-    void cftmdl(int n, int l, double *a, double *w);
-    int j, j1, j2, j3, l;
-    double x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+    const unsigned half = fft->length / 2;
+#ifdef USE_NATIVE_FFT
+    double* buffer = fft->setup.batch;
+    if (!buffer)
+    {
+        return NULL_PTR_ERROR;
+    }
+    double* re = buffer + 2 * fft->length * FFT_BATCH_CHANNELS;
+    double* im = re + half * FFT_BATCH_CHANNELS;
 
-    l = 2;
-    if (n > 8) {
-        cft1st(n, a, w);
-        l = 8;
-        while ((l << 2) < n) {
-            cftmdl(n, l, a, w);
-            l <<= 2;
+    for (unsigned ch = 0; ch < n_channels; ch += FFT_BATCH_CHANNELS)
+    {
+        unsigned group = (n_channels - ch < FFT_BATCH_CHANNELS) ? n_channels - ch : FFT_BATCH_CHANNELS;
+        native_rfft_batchD(fft->plan, buffer, inBuffer + ch * fft->length,
+                          fft->length, fft->length, group, re, im);
+
+        // De-interleave into the same layout as FFT_R2C
+        for (unsigned c = 0; c < group; ++c)
+        {
+            double* out_re = real + (ch + c) * half;
+            double* out_im = imag + (ch + c) * half;
+            for (unsigned k = 0; k < half; ++k)
+            {
+                out_re[k] = re[k * group + c];
+                out_im[k] = im[k * group + c];
+            }
+            out_re[half - 1] = im[c];
+            out_im[0] = 0.0;
         }
     }
-    if ((l << 2) == n) {
-        for (j = 0; j < l; j += 2) {
-            j1 = j + l;
-            j2 = j1 + l;
-            j3 = j2 + l;
-            x0r = a[j] + a[j1];
+#else
+    for (unsigned ch = 0; ch < n_channels; ++ch)
+    {
+        FFT_R2CD(fft, inBuffer + ch * fft->length, real + ch * half, imag + ch * half);
+    }
+#endif
+    return NOERR;
+}
+
+
+Error_t
+IFFT_C2R_BatchD(FFTConfigD*     fft,
+                const double*   inReal,
+                const double*   inImag,
+                double*         out,
+                unsigned        n_channels)
+{
+    const unsigned half = fft->length / 2;
+#ifdef USE_NATIVE_FFT
+    double* buffer = fft->setup.batch;
+    if (!buffer)
+    {
+        return NULL_PTR_ERROR;
+    }
+    double* re = buffer + 2 * fft->length * FFT_BATCH_CHANNELS;
+    double* im = re + half * FFT_BATCH_CHANNELS;
+
+    for (unsigned ch = 0; ch < n_channels; ch += FFT_BATCH_CHANNELS)
+    {
+        unsigned group = (n_channels - ch < FFT_BATCH_CHANNELS) ? n_channels - ch : FFT_BATCH_CHANNELS;
+
+        // Interleave and pack the nyquist bin, as IFFT_C2R takes it
+        for (unsigned c = 0; c < group; ++c)
+        {
+            const double* in_re = inReal + (ch + c) * half;
+            const double* in_im = inImag + (ch + c) * half;
+            for (unsigned k = 0; k < half; ++k)
+            {
+                re[k * group + c] = in_re[k];
+                im[k * group + c] = in_im[k];
+            }
+            im[c] = in_re[half - 1];
+        }
+        native_irfft_batchD(fft->plan, buffer, re, im, group,
+                           out + ch * fft->length, fft->length, fft->scale);
+    }
+#else
+    for (unsigned ch = 0; ch < n_channels; ++ch)
+    {
+        IFFT_C2RD(fft, inReal + ch * half, inImag + ch * half, out + ch * fft->length);
+    }
+#endif
+    return NOERR;
+}
+
+
+Error_t
+FFTConvolveBatchD(FFTConfigD*   fft,
+                  const double* in1,
+                  unsigned      in1_length,
+                  const double* in2,
+                  unsigned      in2_length,
+                  double*       dest,
+                  unsigned      n_channels)
+{
+#ifdef USE_NATIVE_FFT
+    const unsigned half = fft->length / 2;
+    double* buffer = fft->setup.batch;
+    if (!buffer)
+    {
+        return NULL_PTR_ERROR;
+    }
+    double* re1 = buffer + 2 * fft->length * FFT_BATCH_CHANNELS;
+    double* im1 = re1 + half * FFT_BATCH_CHANNELS;
+    double* re2 = im1 + half * FFT_BATCH_CHANNELS;
+    double* im2 = re2 + half * FFT_BATCH_CHANNELS;
+
+    for (unsigned ch = 0; ch < n_channels; ch += FFT_BATCH_CHANNELS)
+    {
+        unsigned group = (n_channels - ch < FFT_BATCH_CHANNELS) ? n_channels - ch : FFT_BATCH_CHANNELS;
+        native_rfft_batchD(fft->plan, buffer, in1 + ch * in1_length, in1_length,
+                          in1_length, group, re1, im1);
+        native_rfft_batchD(fft->plan, buffer, in2 + ch * in2_length, in2_length,
+                          in2_length, group, re2, im2);
+
+        // DC and nyquist are real, the other bins are multiplied as one block
+        for (unsigned c = 0; c < group; ++c)
+        {
+            re1[c] *= re2[c];
+            im1[c] *= im2[c];
+        }
+        ComplexMultiplyD(re1 + group, im1 + group, re1 + group, im1 + group,
+                        re2 + group, im2 + group, (half - 1) * group);
+        native_irfft_batchD(fft->plan, buffer, re1, im1, group,
+                           dest + ch * fft->length, fft->length, fft->scale);
+    }
+#else
+    for (unsigned ch = 0; ch < n_channels; ++ch)
+    {
+        FFTConvolveD(fft, in1 + ch * in1_length, in1_length,
+                    in2 + ch * in2_length, in2_length, dest + ch * fft->length);
+    }
+#endif
+    return NOERR;
+}
+
+
+Error_t
+FFTFilterConvolveBatchD(FFTConfigD*         fft,
+                        const double*       in,
+                        unsigned            in_length,
+                        FFTSplitComplexD    fft_ir,
+                        double*             dest,
+                        unsigned            n_channels)
+{
+#ifdef USE_NATIVE_FFT
+    const unsigned half = fft->length / 2;
+    double* buffer = fft->setup.batch;
+    if (!buffer)
+    {
+        return NULL_PTR_ERROR;
+    }
+    double* re = buffer + 2 * fft->length * FFT_BATCH_CHANNELS;
+    double* im = re + half * FFT_BATCH_CHANNELS;
+
+    for (unsigned ch = 0; ch < n_channels; ch += FFT_BATCH_CHANNELS)
+    {
+        unsigned group = (n_channels - ch < FFT_BATCH_CHANNELS) ? n_channels - ch : FFT_BATCH_CHANNELS;
+        native_rfft_batchD(fft->plan, buffer, in + ch * in_length, in_length,
+                          in_length, group, re, im);
+        native_batch_multiplyD(re, im, fft_ir.realp, fft_ir.imagp, half, group);
+        native_irfft_batchD(fft->plan, buffer, re, im, group,
+                           dest + ch * fft->length, fft->length, fft->scale);
+    }
+#else
+    for (unsigned ch = 0; ch < n_channels; ++ch)
+    {
+        FFTFilterConvolveD(fft, in + ch * in_length, in_length, fft_ir,
+                          dest + ch * fft->length);
+    }
+#endif
+    return NOERR;
+}
+
+Error_t
+FFTSpectrumMultiplyBatchD(FFTConfigD*      fft,
+                          FFTSplitComplexD spectra,
+                          FFTSplitComplexD kernel,
+                          unsigned         n_channels)
+{
+    const unsigned bins = fft->length / 2;
+    const double* k_re = kernel.realp;
+    const double* k_im = kernel.imagp;
+
+    for (unsigned start = 0; start < bins; start += FFT_BATCH_TILE)
+    {
+        const unsigned end = (bins - start < FFT_BATCH_TILE) ? bins : start + FFT_BATCH_TILE;
+        for (unsigned ch = 0; ch < n_channels; ++ch)
+        {
+            double* re = spectra.realp + ch * bins;
+            double* im = spectra.imagp + ch * bins;
+
+            // DC and nyquist are both real, and packed together in the first bin
+            const double dc = re[0] * k_re[0];
+#ifdef USE_OOURA_FFT
+            // Ooura spectra carry the nyquist bin negated
+            const double nyquist = -im[0] * k_im[0];
+#else
+            const double nyquist = im[0] * k_im[0];
+#endif
+
+            unsigned k = start;
+#ifdef FFT_X86
+            if (FFT_HAS_AVX())
+            {
+                k = spectrum_multiply_avxD(re, im, k_re, k_im, start, end);
+            }
+#endif
+#ifdef VD_WIDTH
+            for (; k + VD_WIDTH <= end; k += VD_WIDTH)
+            {
+                vdouble ar = VD_LOAD(re + k);
+                vdouble ai = VD_LOAD(im + k);
+                vdouble br = VD_LOAD(k_re + k);
+                vdouble bi = VD_LOAD(k_im + k);
+                VD_STORE(re + k, VD_SUB(VD_MUL(ar, br), VD_MUL(ai, bi)));
+                VD_STORE(im + k, VD_ADD(VD_MUL(ar, bi), VD_MUL(ai, br)));
+            }
+#endif
+            for (; k < end; ++k)
+            {
+                const double ar = re[k];
+                const double ai = im[k];
+                re[k] = ar * k_re[k] - ai * k_im[k];
+                im[k] = ar * k_im[k] + ai * k_re[k];
+            }
+
+            if (start == 0)
+            {
+                re[0] = dc;
+                im[0] = nyquist;
+            }
+        }
+    }
+    return NOERR;
+}
+
+
+/******************************************************************************
+ STATIC FUNCTION DEFINITIONS */
+#pragma mark - Static Function Definitions
+
+/* Plans in use, one list per precision. The lock guards both lists and the
+ reference counts, and serializes the FFTW planner, so configs can be created
+ and freed from any thread */
+static FFT_PLAN* plan_registry = NULL;
+static FFT_PLAN_D* plan_registryD = NULL;
+static pthread_mutex_t plan_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+#ifdef USE_FFTW_FFT
+/* FFTW planner flags for an effort level */
+static inline unsigned
+fftw_planner_flags(FFTPlanEffort_t effort)
+{
+    switch (effort)
+    {
+        case FFT_PLAN_ESTIMATE:
+            return FFTW_ESTIMATE | FFTW_UNALIGNED;
+        case FFT_PLAN_PATIENT:
+            return FFTW_PATIENT | FFTW_UNALIGNED;
+        case FFT_PLAN_WISDOM_ONLY:
+            return FFTW_WISDOM_ONLY | FFTW_MEASURE | FFTW_UNALIGNED;
+        case FFT_PLAN_MEASURE:
+        default:
+            return FFTW_MEASURE | FFTW_UNALIGNED;
+    }
+}
+#endif
+
+
+/* Return the shared plan for length, creating it if this is the first config
+ of that length */
+static FFT_PLAN*
+fft_plan_acquire(unsigned length, FFTPlanEffort_t effort)
+{
+    FFT_PLAN* plan;
+    pthread_mutex_lock(&plan_registry_lock);
+    for (plan = plan_registry; plan != NULL; plan = plan->next)
+    {
+#ifdef USE_FFTW_FFT
+        // A plan made with less effort may be slower, so only share plans
+        // made with the same planner flags
+        if (plan->length == length && plan->flags == fftw_planner_flags(effort))
+#else
+        if (plan->length == length)
+#endif
+        {
+            ++plan->refcount;
+            break;
+        }
+    }
+    if (!plan)
+    {
+        plan = fft_plan_create(length, effort);
+        if (plan)
+        {
+            plan->next = plan_registry;
+            plan_registry = plan;
+        }
+    }
+    pthread_mutex_unlock(&plan_registry_lock);
+    return plan;
+}
+
+
+/* Make an unshared plan for length, with the backend tables */
+static FFT_PLAN*
+fft_plan_create(unsigned length, FFTPlanEffort_t effort)
+{
+#ifndef USE_FFTW_FFT
+    // Only FFTW has a planner
+    (void)effort;
+#endif
+#if defined(USE_OOURA_FFT) || defined(USE_APPLE_FFT)
+    // These backends only support power of two lengths
+    if (length < 2 || (length & (length - 1)))
+    {
+        return NULL;
+    }
+#endif
+    FFT_PLAN* plan = (FFT_PLAN*)malloc(sizeof(FFT_PLAN));
+    if (!plan)
+    {
+        return NULL;
+    }
+    plan->length = length;
+    plan->refcount = 1;
+    plan->next = NULL;
+
+#ifdef USE_FFTW_FFT
+    fftwf_complex* c = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * length);
+    float* r = (float*) fftwf_malloc(sizeof(float) * length);
+    plan->forward_plan = fftwf_plan_dft_r2c_1d(length, r, c, fftw_planner_flags(effort));
+    plan->inverse_plan = fftwf_plan_dft_c2r_1d(length, c, r, fftw_planner_flags(effort));
+    // Plan the complex transform here as well, so FFT_C2C never runs the
+    // planner. c has room for a split real and imaginary buffer
+    fftwf_iodim dim = {(int)length, 1, 1};
+    float* split = (float*)c;
+    plan->complex_plan = fftwf_plan_guru_split_dft(1, &dim, 0, NULL,
+                                                  split, split + length,
+                                                  split, split + length,
+                                                  fftw_planner_flags(effort));
+    plan->flags = fftw_planner_flags(effort);
+    fftwf_free(r);
+    fftwf_free(c);
+    // Wisdom-only planning fails when there is no wisdom for this length
+    if (!plan->forward_plan || !plan->inverse_plan || !plan->complex_plan)
+    {
+        if (plan->forward_plan)
+            fftwf_destroy_plan(plan->forward_plan);
+        if (plan->inverse_plan)
+            fftwf_destroy_plan(plan->inverse_plan);
+        if (plan->complex_plan)
+            fftwf_destroy_plan(plan->complex_plan);
+        free(plan);
+        return NULL;
+    }
+#elif defined(USE_OOURA_FFT)
+    // Build the tables now, rdft would otherwise build them on its first call
+    unsigned iplen = (unsigned)ceil(2 + sqrt((double)length));
+    int* ip = (int*)malloc(iplen * sizeof(int));
+    plan->w = (double*)malloc((length / 2 + 1) * sizeof(double));
+    if (!ip || !plan->w)
+    {
+        free(ip);
+        free(plan->w);
+        free(plan);
+        return NULL;
+    }
+    ClearBufferD(plan->w, length / 2 + 1);
+    makewt(length >> 2, ip, plan->w);
+    makect(length >> 2, ip, plan->w + (length >> 2));
+    free(ip);
+#elif defined(USE_NATIVE_FFT)
+    if (native_plan_init(plan, length) != NOERR)
+    {
+        free(plan);
+        return NULL;
+    }
+#elif defined(USE_APPLE_FFT)
+    plan->setup = vDSP_create_fftsetup(log2f(length), FFT_RADIX2);
+#endif
+
+    return plan;
+}
+
+
+static FFT_PLAN_D*
+fft_plan_acquireD(unsigned length, FFTPlanEffort_t effort)
+{
+    FFT_PLAN_D* plan;
+    pthread_mutex_lock(&plan_registry_lock);
+    for (plan = plan_registryD; plan != NULL; plan = plan->next)
+    {
+#ifdef USE_FFTW_FFT
+        // A plan made with less effort may be slower, so only share plans
+        // made with the same planner flags
+        if (plan->length == length && plan->flags == fftw_planner_flags(effort))
+#else
+        if (plan->length == length)
+#endif
+        {
+            ++plan->refcount;
+            break;
+        }
+    }
+    if (!plan)
+    {
+        plan = fft_plan_createD(length, effort);
+        if (plan)
+        {
+            plan->next = plan_registryD;
+            plan_registryD = plan;
+        }
+    }
+    pthread_mutex_unlock(&plan_registry_lock);
+    return plan;
+}
+
+
+static FFT_PLAN_D*
+fft_plan_createD(unsigned length, FFTPlanEffort_t effort)
+{
+#ifndef USE_FFTW_FFT
+    // Only FFTW has a planner
+    (void)effort;
+#endif
+#if defined(USE_OOURA_FFT) || defined(USE_APPLE_FFT)
+    // These backends only support power of two lengths
+    if (length < 2 || (length & (length - 1)))
+    {
+        return NULL;
+    }
+#endif
+    FFT_PLAN_D* plan = (FFT_PLAN_D*)malloc(sizeof(FFT_PLAN_D));
+    if (!plan)
+    {
+        return NULL;
+    }
+    plan->length = length;
+    plan->refcount = 1;
+    plan->next = NULL;
+
+#ifdef USE_FFTW_FFT
+    fftw_complex* c = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * length);
+    double* r = (double*) fftw_malloc(sizeof(double) * length);
+    plan->forward_plan = fftw_plan_dft_r2c_1d(length, r, c, fftw_planner_flags(effort));
+    plan->inverse_plan = fftw_plan_dft_c2r_1d(length, c, r, fftw_planner_flags(effort));
+    // Plan the complex transform here as well, so FFT_C2C never runs the
+    // planner. c has room for a split real and imaginary buffer
+    fftw_iodim dim = {(int)length, 1, 1};
+    double* split = (double*)c;
+    plan->complex_plan = fftw_plan_guru_split_dft(1, &dim, 0, NULL,
+                                                  split, split + length,
+                                                  split, split + length,
+                                                  fftw_planner_flags(effort));
+    plan->flags = fftw_planner_flags(effort);
+    fftw_free(r);
+    fftw_free(c);
+    if (!plan->forward_plan || !plan->inverse_plan || !plan->complex_plan)
+    {
+        if (plan->forward_plan)
+            fftw_destroy_plan(plan->forward_plan);
+        if (plan->inverse_plan)
+            fftw_destroy_plan(plan->inverse_plan);
+        if (plan->complex_plan)
+            fftw_destroy_plan(plan->complex_plan);
+        free(plan);
+        return NULL;
+    }
+#elif defined(USE_OOURA_FFT)
+    unsigned iplen = (unsigned)ceil(2 + sqrt((double)length));
+    int* ip = (int*)malloc(iplen * sizeof(int));
+    plan->w = (double*)malloc((length / 2 + 1) * sizeof(double));
+    if (!ip || !plan->w)
+    {
+        free(ip);
+        free(plan->w);
+        free(plan);
+        return NULL;
+    }
+    ClearBufferD(plan->w, length / 2 + 1);
+    makewt(length >> 2, ip, plan->w);
+    makect(length >> 2, ip, plan->w + (length >> 2));
+    free(ip);
+#elif defined(USE_NATIVE_FFT)
+    if (native_plan_initD(plan, length) != NOERR)
+    {
+        free(plan);
+        return NULL;
+    }
+#elif defined(USE_APPLE_FFT)
+    plan->setup = vDSP_create_fftsetupD(log2f(length), FFT_RADIX2);
+#endif
+
+    return plan;
+}
+
+
+/* Drop a reference to plan, destroying it when the last config is freed */
+static void
+fft_plan_release(FFT_PLAN* plan)
+{
+    if (!plan)
+    {
+        return;
+    }
+    pthread_mutex_lock(&plan_registry_lock);
+    if (--plan->refcount == 0)
+    {
+        FFT_PLAN** link = &plan_registry;
+        while (*link != plan)
+        {
+            link = &(*link)->next;
+        }
+        *link = plan->next;
+
+#ifdef USE_FFTW_FFT
+        if (plan->forward_plan)
+            fftwf_destroy_plan(plan->forward_plan);
+        if (plan->inverse_plan)
+            fftwf_destroy_plan(plan->inverse_plan);
+        if (plan->complex_plan)
+            fftwf_destroy_plan(plan->complex_plan);
+#elif defined(USE_OOURA_FFT)
+        free(plan->w);
+#elif defined(USE_NATIVE_FFT)
+        native_plan_free(plan);
+#elif defined(USE_APPLE_FFT)
+        if (plan->setup)
+        {
+            vDSP_destroy_fftsetup(plan->setup);
+        }
+#endif
+        free(plan);
+    }
+    pthread_mutex_unlock(&plan_registry_lock);
+}
+
+
+static void
+fft_plan_releaseD(FFT_PLAN_D* plan)
+{
+    if (!plan)
+    {
+        return;
+    }
+    pthread_mutex_lock(&plan_registry_lock);
+    if (--plan->refcount == 0)
+    {
+        FFT_PLAN_D** link = &plan_registryD;
+        while (*link != plan)
+        {
+            link = &(*link)->next;
+        }
+        *link = plan->next;
+
+#ifdef USE_FFTW_FFT
+        if (plan->forward_plan)
+            fftw_destroy_plan(plan->forward_plan);
+        if (plan->inverse_plan)
+            fftw_destroy_plan(plan->inverse_plan);
+        if (plan->complex_plan)
+            fftw_destroy_plan(plan->complex_plan);
+#elif defined(USE_OOURA_FFT)
+        free(plan->w);
+#elif defined(USE_NATIVE_FFT)
+        native_plan_freeD(plan);
+#elif defined(USE_APPLE_FFT)
+        if (plan->setup)
+        {
+            vDSP_destroy_fftsetupD(plan->setup);
+        }
+#endif
+        free(plan);
+    }
+    pthread_mutex_unlock(&plan_registry_lock);
+}
+
+#ifdef USE_FFTW_FFT
+static inline void
+interleave_complex(float*dest, const float* real, const float* imag, unsigned length)
+{
+#if defined(__APPLE__)
+    DSPSplitComplex split = {.realp = (float*)real, .imagp = (float*)imag};
+    vDSP_ztoc(&split, 1, (DSPComplex*)dest, 2, length/2);
+#elif defined(__HAS_BLAS__)
+    cblas_scopy(length/2, real, 1, dest, 2);
+    cblas_scopy(length/2, imag, 1, dest + 1, 2);
+#else
+    float* buf = &dest[0];
+    float* end = buf + length;
+    const float* re = real;
+    const float* im = imag;
+    while (buf != end)
+    {
+        *buf++ = *re++;
+        *buf++ = *im++;
+    }
+#endif
+}
+
+static inline void
+interleave_complexD(double* dest, const double* real, const double* imag, unsigned length)
+{
+#if defined(__APPLE__)
+    DSPDoubleSplitComplex split = {.realp = (double*)real, .imagp = (double*)imag};
+    vDSP_ztocD(&split, 1, (DSPDoubleComplex*)dest, 2, length/2);
+#elif defined(__HAS_BLAS__)
+    cblas_dcopy(length/2, real, 1, dest, 2);
+    cblas_dcopy(length/2, imag, 1, dest + 1, 2);
+#else
+    double* buf = &dest[0];
+    double* end = buf + length;
+    const double* re = real;
+    const double* im = imag;
+    while (buf != end)
+    {
+        *buf++ = *re++;
+        *buf++ = *im++;
+    }
+#endif
+}
+
+
+static inline void
+split_complex(float* real, float* imag, const float* data, unsigned length)
+{
+#if defined(__APPLE__)
+    DSPSplitComplex split = {.realp = real, .imagp = imag};
+    vDSP_ctoz((DSPComplex*)data, 2, &split, 1, length/2);
+#elif defined(__HAS_BLAS__)
+    cblas_scopy(length/2, data, 2, real, 1);
+    cblas_scopy(length/2, data + 1, 2, imag, 1);
+#else
+    float* buf = (float*)data;
+    float* end = buf + length;
+    float* re = real;
+    float* im = imag;
+    while (buf != end)
+    {
+        *re++ = *buf++;
+        *im++ = *buf++;
+    }
+#endif
+}
+
+
+static inline void
+split_complexD(double* real, double* imag, const double* data, unsigned length)
+{
+#if defined(__APPLE__)
+    DSPDoubleSplitComplex split = {.realp = real, .imagp = imag};
+    vDSP_ctozD((DSPDoubleComplex*)data, 2, &split, 1, length/2);
+#elif defined(__HAS_BLAS__)
+    cblas_dcopy(length/2, data, 2, real, 1);
+    cblas_dcopy(length/2, data + 1, 2, imag, 1);
+#else
+    double* buf = (double*)data;
+    double* end = buf + length;
+    double* re = real;
+    double* im = imag;
+    while (buf != end)
+    {
+        *re++ = *buf++;
+        *im++ = *buf++;
+    }
+#endif
+}
+
+#endif
+
+
+#ifdef USE_OOURA_FFT
+
+static void
+rdft(int n, int isgn, double *a, int *ip, double *w)
+{
+    void makewt(int nw, int *ip, double *w);
+    void makect(int nc, int *ip, double *c);
+    void bitrv2(int n, int *ip, double *a);
+    void cftfsub(int n, double *a, double *w);
+    void cftbsub(int n, double *a, double *w);
+    void rftfsub(int n, double *a, int nc, double *c);
+    void rftbsub(int n, double *a, int nc, double *c);
+    int nw, nc;
+    double xi;
+
+    nw = ip[0];
+    if (n > (nw << 2)) {
+        nw = n >> 2;
+        makewt(nw, ip, w);
+    }
+    nc = ip[1];
+    if (n > (nc << 2)) {
+        nc = n >> 2;
+        makect(nc, ip, w + nw);
+    }
+    if (isgn >= 0) {
+        if (n > 4) {
+            bitrv2(n, ip + 2, a);
+            cftfsub(n, a, w);
+            rftfsub(n, a, nc, w + nw);
+        } else if (n == 4) {
+            cftfsub(n, a, w);
+        }
+        xi = a[0] - a[1];
+        a[0] += a[1];
+        a[1] = xi;
+    } else {
+        a[1] = 0.5 * (a[0] - a[1]);
+        a[0] -= a[1];
+        if (n > 4) {
+            rftbsub(n, a, nc, w + nw);
+            bitrv2(n, ip + 2, a);
+            cftbsub(n, a, w);
+        } else if (n == 4) {
+            cftfsub(n, a, w);
+        }
+    }
+}
+static void
+makewt(int nw, int *ip, double *w)
+{
+    void bitrv2(int n, int *ip, double *a);
+    int j, nwh;
+    double delta, x, y;
+
+    ip[0] = nw;
+    ip[1] = 1;
+    if (nw > 2) {
+        nwh = nw >> 1;
+        delta = atan(1.0) / nwh;
+        w[0] = 1;
+        w[1] = 0;
+        w[nwh] = cos(delta * nwh);
+        w[nwh + 1] = w[nwh];
+        if (nwh > 2) {
+            for (j = 2; j < nwh; j += 2) {
+                x = cos(delta * j);
+                y = sin(delta * j);
+                w[j] = x;
+                w[j + 1] = y;
+                w[nw - j] = y;
+                w[nw - j + 1] = x;
+            }
+            bitrv2(nw, ip + 2, w);
+        }
+    }
+}
+
+
+static void
+makect(int nc, int *ip, double *c)
+{
+    int j, nch;
+    double delta;
+
+    ip[1] = nc;
+    if (nc > 1) {
+        nch = nc >> 1;
+        delta = atan(1.0) / nch;
+        c[0] = cos(delta * nch);
+        c[nch] = 0.5 * c[0];
+        for (j = 1; j < nch; j++) {
+            c[j] = 0.5 * cos(delta * j);
+            c[nc - j] = 0.5 * sin(delta * j);
+        }
+    }
+}
+
+
+/* -------- child routines -------- */
+
+
+static void
+bitrv2(int n, int *ip, double *a)
+{
+    int j, j1, k, k1, l, m, m2;
+    double xr, xi, yr, yi;
+
+    ip[0] = 0;
+    l = n;
+    m = 1;
+    while ((m << 3) < l) {
+        l >>= 1;
+        for (j = 0; j < m; j++) {
+            ip[m + j] = ip[j] + l;
+        }
+        m <<= 1;
+    }
+    m2 = 2 * m;
+    if ((m << 3) == l) {
+        for (k = 0; k < m; k++) {
+            for (j = 0; j < k; j++) {
+                j1 = 2 * j + ip[k];
+                k1 = 2 * k + ip[j];
+                xr = a[j1];
+                xi = a[j1 + 1];
+                yr = a[k1];
+                yi = a[k1 + 1];
+                a[j1] = yr;
+                a[j1 + 1] = yi;
+                a[k1] = xr;
+                a[k1 + 1] = xi;
+                j1 += m2;
+                k1 += 2 * m2;
+                xr = a[j1];
+                xi = a[j1 + 1];
+                yr = a[k1];
+                yi = a[k1 + 1];
+                a[j1] = yr;
+                a[j1 + 1] = yi;
+                a[k1] = xr;
+                a[k1 + 1] = xi;
+                j1 += m2;
+                k1 -= m2;
+                xr = a[j1];
+                xi = a[j1 + 1];
+                yr = a[k1];
+                yi = a[k1 + 1];
+                a[j1] = yr;
+                a[j1 + 1] = yi;
+                a[k1] = xr;
+                a[k1 + 1] = xi;
+                j1 += m2;
+                k1 += 2 * m2;
+                xr = a[j1];
+                xi = a[j1 + 1];
+                yr = a[k1];
+                yi = a[k1 + 1];
+                a[j1] = yr;
+                a[j1 + 1] = yi;
+                a[k1] = xr;
+                a[k1 + 1] = xi;
+            }
+            j1 = 2 * k + m2 + ip[k];
+            k1 = j1 + m2;
+            xr = a[j1];
+            xi = a[j1 + 1];
+            yr = a[k1];
+            yi = a[k1 + 1];
+            a[j1] = yr;
+            a[j1 + 1] = yi;
+            a[k1] = xr;
+            a[k1 + 1] = xi;
+        }
+    } else {
+        for (k = 1; k < m; k++) {
+            for (j = 0; j < k; j++) {
+                j1 = 2 * j + ip[k];
+                k1 = 2 * k + ip[j];
+                xr = a[j1];
+                xi = a[j1 + 1];
+                yr = a[k1];
+                yi = a[k1 + 1];
+                a[j1] = yr;
+                a[j1 + 1] = yi;
+                a[k1] = xr;
+                a[k1 + 1] = xi;
+                j1 += m2;
+                k1 += m2;
+                xr = a[j1];
+                xi = a[j1 + 1];
+                yr = a[k1];
+                yi = a[k1 + 1];
+                a[j1] = yr;
+                a[j1 + 1] = yi;
+                a[k1] = xr;
+                a[k1 + 1] = xi;
+            }
+        }
+    }
+}
+
+
+static void
+cftfsub(int n, double *a, double *w)
+{
+    void cft1st(int n, double *a, double *w);
+    void cftmdl(int n, int l, double *a, double *w);
+    int j, j1, j2, j3, l;
+    double x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+
+    l = 2;
+    if (n > 8) {
+        cft1st(n, a, w);
+        l = 8;
+        while ((l << 2) < n) {
+            cftmdl(n, l, a, w);
+            l <<= 2;
+        }
+    }
+    if ((l << 2) == n) {
+        for (j = 0; j < l; j += 2) {
+            j1 = j + l;
+            j2 = j1 + l;
+            j3 = j2 + l;
+            x0r = a[j] + a[j1];
+            x0i = a[j + 1] + a[j1 + 1];
+            x1r = a[j] - a[j1];
+            x1i = a[j + 1] - a[j1 + 1];
+            x2r = a[j2] + a[j3];
+            x2i = a[j2 + 1] + a[j3 + 1];
+            x3r = a[j2] - a[j3];
+            x3i = a[j2 + 1] - a[j3 + 1];
+            a[j] = x0r + x2r;
+            a[j + 1] = x0i + x2i;
+            a[j2] = x0r - x2r;
+            a[j2 + 1] = x0i - x2i;
+            a[j1] = x1r - x3i;
+            a[j1 + 1] = x1i + x3r;
+            a[j3] = x1r + x3i;
+            a[j3 + 1] = x1i - x3r;
+        }
+    } else {
+        for (j = 0; j < l; j += 2) {
+            j1 = j + l;
+            x0r = a[j] - a[j1];
+            x0i = a[j + 1] - a[j1 + 1];
+            a[j] += a[j1];
+            a[j + 1] += a[j1 + 1];
+            a[j1] = x0r;
+            a[j1 + 1] = x0i;
+        }
+    }
+}
+
+
+static void
+cftbsub(int n, double *a, double *w)
+{
+    void cft1st(int n, double *a, double *w);
+    void cftmdl(int n, int l, double *a, double *w);
+    int j, j1, j2, j3, l;
+    double x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+
+    l = 2;
+    if (n > 8) {
+        cft1st(n, a, w);
+        l = 8;
+        while ((l << 2) < n) {
+            cftmdl(n, l, a, w);
+            l <<= 2;
+        }
+    }
+    if ((l << 2) == n) {
+        for (j = 0; j < l; j += 2) {
+            j1 = j + l;
+            j2 = j1 + l;
+            j3 = j2 + l;
+            x0r = a[j] + a[j1];
+            x0i = -a[j + 1] - a[j1 + 1];
+            x1r = a[j] - a[j1];
+            x1i = -a[j + 1] + a[j1 + 1];
+            x2r = a[j2] + a[j3];
+            x2i = a[j2 + 1] + a[j3 + 1];
+            x3r = a[j2] - a[j3];
+            x3i = a[j2 + 1] - a[j3 + 1];
+            a[j] = x0r + x2r;
+            a[j + 1] = x0i - x2i;
+            a[j2] = x0r - x2r;
+            a[j2 + 1] = x0i + x2i;
+            a[j1] = x1r - x3i;
+            a[j1 + 1] = x1i - x3r;
+            a[j3] = x1r + x3i;
+            a[j3 + 1] = x1i + x3r;
+        }
+    } else {
+        for (j = 0; j < l; j += 2) {
+            j1 = j + l;
+            x0r = a[j] - a[j1];
+            x0i = -a[j + 1] + a[j1 + 1];
+            a[j] += a[j1];
+            a[j + 1] = -a[j + 1] - a[j1 + 1];
+            a[j1] = x0r;
+            a[j1 + 1] = x0i;
+        }
+    }
+}
+
+
+static void
+cft1st(int n, double *a, double *w)
+{
+    int j, k1, k2;
+    double wk1r, wk1i, wk2r, wk2i, wk3r, wk3i;
+    double x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+
+    x0r = a[0] + a[2];
+    x0i = a[1] + a[3];
+    x1r = a[0] - a[2];
+    x1i = a[1] - a[3];
+    x2r = a[4] + a[6];
+    x2i = a[5] + a[7];
+    x3r = a[4] - a[6];
+    x3i = a[5] - a[7];
+    a[0] = x0r + x2r;
+    a[1] = x0i + x2i;
+    a[4] = x0r - x2r;
+    a[5] = x0i - x2i;
+    a[2] = x1r - x3i;
+    a[3] = x1i + x3r;
+    a[6] = x1r + x3i;
+    a[7] = x1i - x3r;
+    wk1r = w[2];
+    x0r = a[8] + a[10];
+    x0i = a[9] + a[11];
+    x1r = a[8] - a[10];
+    x1i = a[9] - a[11];
+    x2r = a[12] + a[14];
+    x2i = a[13] + a[15];
+    x3r = a[12] - a[14];
+    x3i = a[13] - a[15];
+    a[8] = x0r + x2r;
+    a[9] = x0i + x2i;
+    a[12] = x2i - x0i;
+    a[13] = x0r - x2r;
+    x0r = x1r - x3i;
+    x0i = x1i + x3r;
+    a[10] = wk1r * (x0r - x0i);
+    a[11] = wk1r * (x0r + x0i);
+    x0r = x3i + x1r;
+    x0i = x3r - x1i;
+    a[14] = wk1r * (x0i - x0r);
+    a[15] = wk1r * (x0i + x0r);
+    k1 = 0;
+    for (j = 16; j < n; j += 16) {
+        k1 += 2;
+        k2 = 2 * k1;
+        wk2r = w[k1];
+        wk2i = w[k1 + 1];
+        wk1r = w[k2];
+        wk1i = w[k2 + 1];
+        wk3r = wk1r - 2 * wk2i * wk1i;
+        wk3i = 2 * wk2i * wk1r - wk1i;
+        x0r = a[j] + a[j + 2];
+        x0i = a[j + 1] + a[j + 3];
+        x1r = a[j] - a[j + 2];
+        x1i = a[j + 1] - a[j + 3];
+        x2r = a[j + 4] + a[j + 6];
+        x2i = a[j + 5] + a[j + 7];
+        x3r = a[j + 4] - a[j + 6];
+        x3i = a[j + 5] - a[j + 7];
+        a[j] = x0r + x2r;
+        a[j + 1] = x0i + x2i;
+        x0r -= x2r;
+        x0i -= x2i;
+        a[j + 4] = wk2r * x0r - wk2i * x0i;
+        a[j + 5] = wk2r * x0i + wk2i * x0r;
+        x0r = x1r - x3i;
+        x0i = x1i + x3r;
+        a[j + 2] = wk1r * x0r - wk1i * x0i;
+        a[j + 3] = wk1r * x0i + wk1i * x0r;
+        x0r = x1r + x3i;
+        x0i = x1i - x3r;
+        a[j + 6] = wk3r * x0r - wk3i * x0i;
+        a[j + 7] = wk3r * x0i + wk3i * x0r;
+        wk1r = w[k2 + 2];
+        wk1i = w[k2 + 3];
+        wk3r = wk1r - 2 * wk2r * wk1i;
+        wk3i = 2 * wk2r * wk1r - wk1i;
+        x0r = a[j + 8] + a[j + 10];
+        x0i = a[j + 9] + a[j + 11];
+        x1r = a[j + 8] - a[j + 10];
+        x1i = a[j + 9] - a[j + 11];
+        x2r = a[j + 12] + a[j + 14];
+        x2i = a[j + 13] + a[j + 15];
+        x3r = a[j + 12] - a[j + 14];
+        x3i = a[j + 13] - a[j + 15];
+        a[j + 8] = x0r + x2r;
+        a[j + 9] = x0i + x2i;
+        x0r -= x2r;
+        x0i -= x2i;
+        a[j + 12] = -wk2i * x0r - wk2r * x0i;
+        a[j + 13] = -wk2i * x0i + wk2r * x0r;
+        x0r = x1r - x3i;
+        x0i = x1i + x3r;
+        a[j + 10] = wk1r * x0r - wk1i * x0i;
+        a[j + 11] = wk1r * x0i + wk1i * x0r;
+        x0r = x1r + x3i;
+        x0i = x1i - x3r;
+        a[j + 14] = wk3r * x0r - wk3i * x0i;
+        a[j + 15] = wk3r * x0i + wk3i * x0r;
+    }
+}
+
+
+static void
+cftmdl(int n, int l, double *a, double *w)
+{
+    int j, j1, j2, j3, k, k1, k2, m, m2;
+    double wk1r, wk1i, wk2r, wk2i, wk3r, wk3i;
+    double x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+
+    m = l << 2;
+    for (j = 0; j < l; j += 2) {
+        j1 = j + l;
+        j2 = j1 + l;
+        j3 = j2 + l;
+        x0r = a[j] + a[j1];
+        x0i = a[j + 1] + a[j1 + 1];
+        x1r = a[j] - a[j1];
+        x1i = a[j + 1] - a[j1 + 1];
+        x2r = a[j2] + a[j3];
+        x2i = a[j2 + 1] + a[j3 + 1];
+        x3r = a[j2] - a[j3];
+        x3i = a[j2 + 1] - a[j3 + 1];
+        a[j] = x0r + x2r;
+        a[j + 1] = x0i + x2i;
+        a[j2] = x0r - x2r;
+        a[j2 + 1] = x0i - x2i;
+        a[j1] = x1r - x3i;
+        a[j1 + 1] = x1i + x3r;
+        a[j3] = x1r + x3i;
+        a[j3 + 1] = x1i - x3r;
+    }
+    wk1r = w[2];
+    for (j = m; j < l + m; j += 2) {
+        j1 = j + l;
+        j2 = j1 + l;
+        j3 = j2 + l;
+        x0r = a[j] + a[j1];
+        x0i = a[j + 1] + a[j1 + 1];
+        x1r = a[j] - a[j1];
+        x1i = a[j + 1] - a[j1 + 1];
+        x2r = a[j2] + a[j3];
+        x2i = a[j2 + 1] + a[j3 + 1];
+        x3r = a[j2] - a[j3];
+        x3i = a[j2 + 1] - a[j3 + 1];
+        a[j] = x0r + x2r;
+        a[j + 1] = x0i + x2i;
+        a[j2] = x2i - x0i;
+        a[j2 + 1] = x0r - x2r;
+        x0r = x1r - x3i;
+        x0i = x1i + x3r;
+        a[j1] = wk1r * (x0r - x0i);
+        a[j1 + 1] = wk1r * (x0r + x0i);
+        x0r = x3i + x1r;
+        x0i = x3r - x1i;
+        a[j3] = wk1r * (x0i - x0r);
+        a[j3 + 1] = wk1r * (x0i + x0r);
+    }
+    k1 = 0;
+    m2 = 2 * m;
+    for (k = m2; k < n; k += m2) {
+        k1 += 2;
+        k2 = 2 * k1;
+        wk2r = w[k1];
+        wk2i = w[k1 + 1];
+        wk1r = w[k2];
+        wk1i = w[k2 + 1];
+        wk3r = wk1r - 2 * wk2i * wk1i;
+        wk3i = 2 * wk2i * wk1r - wk1i;
+        for (j = k; j < l + k; j += 2) {
+            j1 = j + l;
+            j2 = j1 + l;
+            j3 = j2 + l;
+            x0r = a[j] + a[j1];
             x0i = a[j + 1] + a[j1 + 1];
             x1r = a[j] - a[j1];
             x1i = a[j + 1] - a[j1 + 1];
@@ -1442,365 +3387,2919 @@ cftfsub(int n, double *a, double *w)
             x3i = a[j2 + 1] - a[j3 + 1];
             a[j] = x0r + x2r;
             a[j + 1] = x0i + x2i;
-            a[j2] = x0r - x2r;
-            a[j2 + 1] = x0i - x2i;
-            a[j1] = x1r - x3i;
-            a[j1 + 1] = x1i + x3r;
-            a[j3] = x1r + x3i;
-            a[j3 + 1] = x1i - x3r;
+            x0r -= x2r;
+            x0i -= x2i;
+            a[j2] = wk2r * x0r - wk2i * x0i;
+            a[j2 + 1] = wk2r * x0i + wk2i * x0r;
+            x0r = x1r - x3i;
+            x0i = x1i + x3r;
+            a[j1] = wk1r * x0r - wk1i * x0i;
+            a[j1 + 1] = wk1r * x0i + wk1i * x0r;
+            x0r = x1r + x3i;
+            x0i = x1i - x3r;
+            a[j3] = wk3r * x0r - wk3i * x0i;
+            a[j3 + 1] = wk3r * x0i + wk3i * x0r;
+        }
+        wk1r = w[k2 + 2];
+        wk1i = w[k2 + 3];
+        wk3r = wk1r - 2 * wk2r * wk1i;
+        wk3i = 2 * wk2r * wk1r - wk1i;
+        for (j = k + m; j < l + (k + m); j += 2) {
+            j1 = j + l;
+            j2 = j1 + l;
+            j3 = j2 + l;
+            x0r = a[j] + a[j1];
+            x0i = a[j + 1] + a[j1 + 1];
+            x1r = a[j] - a[j1];
+            x1i = a[j + 1] - a[j1 + 1];
+            x2r = a[j2] + a[j3];
+            x2i = a[j2 + 1] + a[j3 + 1];
+            x3r = a[j2] - a[j3];
+            x3i = a[j2 + 1] - a[j3 + 1];
+            a[j] = x0r + x2r;
+            a[j + 1] = x0i + x2i;
+            x0r -= x2r;
+            x0i -= x2i;
+            a[j2] = -wk2i * x0r - wk2r * x0i;
+            a[j2 + 1] = -wk2i * x0i + wk2r * x0r;
+            x0r = x1r - x3i;
+            x0i = x1i + x3r;
+            a[j1] = wk1r * x0r - wk1i * x0i;
+            a[j1 + 1] = wk1r * x0i + wk1i * x0r;
+            x0r = x1r + x3i;
+            x0i = x1i - x3r;
+            a[j3] = wk3r * x0r - wk3i * x0i;
+            a[j3 + 1] = wk3r * x0i + wk3i * x0r;
+        }
+    }
+}
+
+
+static void
+rftfsub(int n, double *a, int nc, double *c)
+{
+    int j, k, kk, ks, m;
+    double wkr, wki, xr, xi, yr, yi;
+
+    m = n >> 1;
+    ks = 2 * nc / m;
+    kk = 0;
+    for (j = 2; j < m; j += 2) {
+        k = n - j;
+        kk += ks;
+        wkr = 0.5 - c[nc - kk];
+        wki = c[kk];
+        xr = a[j] - a[k];
+        xi = a[j + 1] + a[k + 1];
+        yr = wkr * xr - wki * xi;
+        yi = wkr * xi + wki * xr;
+        a[j] -= yr;
+        a[j + 1] -= yi;
+        a[k] += yr;
+        a[k + 1] -= yi;
+    }
+}
+
+
+static void
+rftbsub(int n, double *a, int nc, double *c)
+{
+    int j, k, kk, ks, m;
+    double wkr, wki, xr, xi, yr, yi;
+
+    a[1] = -a[1];
+    m = n >> 1;
+    ks = 2 * nc / m;
+    kk = 0;
+    for (j = 2; j < m; j += 2) {
+        k = n - j;
+        kk += ks;
+        wkr = 0.5 - c[nc - kk];
+        wki = c[kk];
+        xr = a[j] - a[k];
+        xi = a[j + 1] + a[k + 1];
+        yr = wkr * xr + wki * xi;
+        yi = wkr * xi - wki * xr;
+        a[j] -= yr;
+        a[j + 1] = yi - a[j + 1];
+        a[k] += yr;
+        a[k + 1] = yi - a[k + 1];
+    }
+    a[m + 1] = -a[m + 1];
+}
+
+#endif
+
+
+#ifdef USE_OOURA_FFT
+/* Complex FFT from two real FFTs, one of the real parts and one of the
+ imaginary parts, using X[k] = A[k] + i * B[k] */
+static void
+ooura_c2c(FFTConfig* fft, const float* inReal, const float* inImag,
+          float* outReal, float* outImag)
+{
+    const unsigned length = fft->length;
+    const unsigned half = length / 2;
+    double* a = fft->setup.buffer;
+    double* b = a + length;
+
+    FloatToDouble(a, inReal, length);
+    FloatToDouble(b, inImag, length);
+    rdft(length, 1, a, fft->setup.ip, fft->setup.w);
+    rdft(length, 1, b, fft->setup.ip, fft->setup.w);
+
+    // rdft stores the nyquist bin in a[1] and negated imaginary parts
+    outReal[0] = a[0];
+    outImag[0] = b[0];
+    outReal[half] = a[1];
+    outImag[half] = b[1];
+    for (unsigned k = 1; k < half; ++k)
+    {
+        double ar = a[2 * k];
+        double ai = -a[2 * k + 1];
+        double br = b[2 * k];
+        double bi = -b[2 * k + 1];
+        outReal[k] = ar - bi;
+        outImag[k] = ai + br;
+        outReal[length - k] = ar + bi;
+        outImag[length - k] = br - ai;
+    }
+}
+#endif
+
+
+#ifdef USE_OOURA_FFT
+static void
+ooura_c2cD(FFTConfigD* fft, const double* inReal, const double* inImag,
+          double* outReal, double* outImag)
+{
+    const unsigned length = fft->length;
+    const unsigned half = length / 2;
+    double* a = fft->setup.buffer;
+    double* b = a + length;
+
+    CopyBufferD(a, inReal, length);
+    CopyBufferD(b, inImag, length);
+    rdft(length, 1, a, fft->setup.ip, fft->setup.w);
+    rdft(length, 1, b, fft->setup.ip, fft->setup.w);
+
+    // rdft stores the nyquist bin in a[1] and negated imaginary parts
+    outReal[0] = a[0];
+    outImag[0] = b[0];
+    outReal[half] = a[1];
+    outImag[half] = b[1];
+    for (unsigned k = 1; k < half; ++k)
+    {
+        double ar = a[2 * k];
+        double ai = -a[2 * k + 1];
+        double br = b[2 * k];
+        double bi = -b[2 * k + 1];
+        outReal[k] = ar - bi;
+        outImag[k] = ai + br;
+        outReal[length - k] = ar + bi;
+        outImag[length - k] = br - ai;
+    }
+}
+#endif
+
+
+#ifdef USE_NATIVE_FFT
+
+/* Split n into radix-4 passes, a radix-2 pass if needed, then radix-3 and
+ radix-5 passes. Returns the number of passes, or -1 if n has other factors */
+static int
+native_factor(unsigned n, unsigned* radix)
+{
+    int stages = 0;
+    if (n == 0)
+    {
+        return -1;
+    }
+    while ((n % 4) == 0)
+    {
+        radix[stages++] = 4;
+        n /= 4;
+    }
+    while ((n % 2) == 0)
+    {
+        radix[stages++] = 2;
+        n /= 2;
+    }
+    while ((n % 3) == 0)
+    {
+        radix[stages++] = 3;
+        n /= 3;
+    }
+    while ((n % 5) == 0)
+    {
+        radix[stages++] = 5;
+        n /= 5;
+    }
+    return (n == 1) ? stages : -1;
+}
+
+
+static Error_t
+native_plan_init(FFT_PLAN* plan, unsigned length)
+{
+    unsigned n = length / 2;
+    int stages = ((length % 2) == 0) ? native_factor(n, plan->radix) : -1;
+    if (stages < 0)
+    {
+        return VALUE_ERROR;
+    }
+
+    // Count twiddles needed by all passes
+    unsigned stride = 1;
+    unsigned n_twiddles = 0;
+    for (int stage = 0; stage < stages; ++stage)
+    {
+        n_twiddles += (plan->radix[stage] - 1) * (n / (stride * plan->radix[stage]));
+        stride *= plan->radix[stage];
+    }
+
+    plan->n = n;
+    plan->n_stages = stages;
+    plan->twiddle_r = (float*)malloc((2 * n_twiddles + 1) * sizeof(float));
+    plan->rtwiddle_r = (float*)malloc(2 * n * sizeof(float));
+    if (!plan->twiddle_r || !plan->rtwiddle_r)
+    {
+        free(plan->twiddle_r);
+        free(plan->rtwiddle_r);
+        return NULL_PTR_ERROR;
+    }
+    plan->twiddle_i = plan->twiddle_r + n_twiddles;
+    plan->rtwiddle_i = plan->rtwiddle_r + n;
+
+    // Butterfly twiddles, w^(k*p) for each butterfly p in each pass
+    float* twr = plan->twiddle_r;
+    float* twi = plan->twiddle_i;
+    unsigned n_stage = n;
+    for (int stage = 0; stage < stages; ++stage)
+    {
+        unsigned radix = plan->radix[stage];
+        unsigned m = n_stage / radix;
+        for (unsigned p = 0; p < m; ++p)
+        {
+            for (unsigned k = 1; k < radix; ++k)
+            {
+                double phase = -2.0 * M_PI * (double)(k * p) / n_stage;
+                *twr++ = (float)cos(phase);
+                *twi++ = (float)sin(phase);
+            }
+        }
+        n_stage = m;
+    }
+
+    // Twiddles for splitting the half-length complex transform
+    for (unsigned k = 0; k < n; ++k)
+    {
+        double phase = 2.0 * M_PI * (double)k / length;
+        plan->rtwiddle_r[k] = (float)cos(phase);
+        plan->rtwiddle_i[k] = (float)sin(phase);
+    }
+    return NOERR;
+}
+
+
+static void
+native_plan_free(FFT_PLAN* plan)
+{
+    free(plan->twiddle_r);
+    free(plan->rtwiddle_r);
+    plan->twiddle_r = NULL;
+    plan->rtwiddle_r = NULL;
+}
+
+
+/* Radix-2 Stockham pass. s is the stride (product of the previous radices) and
+ m the number of butterflies per stride */
+static void
+native_pass2(unsigned s, unsigned m, const float* xr, const float* xi,
+             float* yr, float* yi, const float* twr, const float* twi)
+{
+#ifdef FFT_X86
+    if (s >= VF8_WIDTH && FFT_HAS_AVX())
+    {
+        native_pass2_avx(s, m, xr, xi, yr, yi, twr, twi);
+        return;
+    }
+#endif
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const float wr = twr[p];
+        const float wi = twi[p];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned out0 = s * 2 * p;
+        const unsigned out1 = out0 + s;
+        unsigned q = 0;
+#ifdef VF_WIDTH
+        const vfloat vwr = VF_SET1(wr);
+        const vfloat vwi = VF_SET1(wi);
+        for (; q + VF_WIDTH <= s; q += VF_WIDTH)
+        {
+            vfloat a0r = VF_LOAD(xr + in0 + q);
+            vfloat a0i = VF_LOAD(xi + in0 + q);
+            vfloat a1r = VF_LOAD(xr + in1 + q);
+            vfloat a1i = VF_LOAD(xi + in1 + q);
+            vfloat dr = VF_SUB(a0r, a1r);
+            vfloat di = VF_SUB(a0i, a1i);
+            VF_STORE(yr + out0 + q, VF_ADD(a0r, a1r));
+            VF_STORE(yi + out0 + q, VF_ADD(a0i, a1i));
+            VF_STORE(yr + out1 + q, VF_SUB(VF_MUL(dr, vwr), VF_MUL(di, vwi)));
+            VF_STORE(yi + out1 + q, VF_ADD(VF_MUL(dr, vwi), VF_MUL(di, vwr)));
+        }
+#endif
+        for (; q < s; ++q)
+        {
+            float a0r = xr[in0 + q];
+            float a0i = xi[in0 + q];
+            float a1r = xr[in1 + q];
+            float a1i = xi[in1 + q];
+            float dr = a0r - a1r;
+            float di = a0i - a1i;
+            yr[out0 + q] = a0r + a1r;
+            yi[out0 + q] = a0i + a1i;
+            yr[out1 + q] = dr * wr - di * wi;
+            yi[out1 + q] = dr * wi + di * wr;
+        }
+    }
+}
+
+
+#ifdef FFT_X86
+/* Radix-2 Stockham pass with AVX */
+__attribute__((target("avx,fma"))) static void
+native_pass2_avx(unsigned s, unsigned m, const float* xr, const float* xi,
+                 float* yr, float* yi, const float* twr, const float* twi)
+{
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const float wr = twr[p];
+        const float wi = twi[p];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned out0 = s * 2 * p;
+        const unsigned out1 = out0 + s;
+        unsigned q = 0;
+        const vfloat8 vwr = VF8_SET1(wr);
+        const vfloat8 vwi = VF8_SET1(wi);
+        for (; q + VF8_WIDTH <= s; q += VF8_WIDTH)
+        {
+            vfloat8 a0r = VF8_LOAD(xr + in0 + q);
+            vfloat8 a0i = VF8_LOAD(xi + in0 + q);
+            vfloat8 a1r = VF8_LOAD(xr + in1 + q);
+            vfloat8 a1i = VF8_LOAD(xi + in1 + q);
+            vfloat8 dr = VF8_SUB(a0r, a1r);
+            vfloat8 di = VF8_SUB(a0i, a1i);
+            VF8_STORE(yr + out0 + q, VF8_ADD(a0r, a1r));
+            VF8_STORE(yi + out0 + q, VF8_ADD(a0i, a1i));
+            VF8_STORE(yr + out1 + q, VF8_SUB(VF8_MUL(dr, vwr), VF8_MUL(di, vwi)));
+            VF8_STORE(yi + out1 + q, VF8_ADD(VF8_MUL(dr, vwi), VF8_MUL(di, vwr)));
+        }
+        for (; q < s; ++q)
+        {
+            float a0r = xr[in0 + q];
+            float a0i = xi[in0 + q];
+            float a1r = xr[in1 + q];
+            float a1i = xi[in1 + q];
+            float dr = a0r - a1r;
+            float di = a0i - a1i;
+            yr[out0 + q] = a0r + a1r;
+            yi[out0 + q] = a0i + a1i;
+            yr[out1 + q] = dr * wr - di * wi;
+            yi[out1 + q] = dr * wi + di * wr;
+        }
+    }
+}
+#endif
+
+
+/* Radix-4 Stockham pass */
+static void
+native_pass4(unsigned s, unsigned m, const float* xr, const float* xi,
+             float* yr, float* yi, const float* twr, const float* twi)
+{
+#ifdef FFT_X86
+    if (s >= VF8_WIDTH && FFT_HAS_AVX())
+    {
+        native_pass4_avx(s, m, xr, xi, yr, yi, twr, twi);
+        return;
+    }
+#endif
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const float w1r = twr[3 * p];
+        const float w1i = twi[3 * p];
+        const float w2r = twr[3 * p + 1];
+        const float w2i = twi[3 * p + 1];
+        const float w3r = twr[3 * p + 2];
+        const float w3i = twi[3 * p + 2];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned in3 = s * (p + 3 * m);
+        const unsigned out0 = s * 4 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        const unsigned out3 = out2 + s;
+        unsigned q = 0;
+#ifdef VF_WIDTH
+        const vfloat vw1r = VF_SET1(w1r);
+        const vfloat vw1i = VF_SET1(w1i);
+        const vfloat vw2r = VF_SET1(w2r);
+        const vfloat vw2i = VF_SET1(w2i);
+        const vfloat vw3r = VF_SET1(w3r);
+        const vfloat vw3i = VF_SET1(w3i);
+        for (; q + VF_WIDTH <= s; q += VF_WIDTH)
+        {
+            vfloat a0r = VF_LOAD(xr + in0 + q);
+            vfloat a0i = VF_LOAD(xi + in0 + q);
+            vfloat a1r = VF_LOAD(xr + in1 + q);
+            vfloat a1i = VF_LOAD(xi + in1 + q);
+            vfloat a2r = VF_LOAD(xr + in2 + q);
+            vfloat a2i = VF_LOAD(xi + in2 + q);
+            vfloat a3r = VF_LOAD(xr + in3 + q);
+            vfloat a3i = VF_LOAD(xi + in3 + q);
+
+            vfloat t0r = VF_ADD(a0r, a2r);
+            vfloat t0i = VF_ADD(a0i, a2i);
+            vfloat t1r = VF_SUB(a0r, a2r);
+            vfloat t1i = VF_SUB(a0i, a2i);
+            vfloat t2r = VF_ADD(a1r, a3r);
+            vfloat t2i = VF_ADD(a1i, a3i);
+            vfloat t3r = VF_SUB(a1i, a3i);      // -i * (a1 - a3)
+            vfloat t3i = VF_SUB(a3r, a1r);
+
+            vfloat b1r = VF_ADD(t1r, t3r);
+            vfloat b1i = VF_ADD(t1i, t3i);
+            vfloat b2r = VF_SUB(t0r, t2r);
+            vfloat b2i = VF_SUB(t0i, t2i);
+            vfloat b3r = VF_SUB(t1r, t3r);
+            vfloat b3i = VF_SUB(t1i, t3i);
+
+            VF_STORE(yr + out0 + q, VF_ADD(t0r, t2r));
+            VF_STORE(yi + out0 + q, VF_ADD(t0i, t2i));
+            VF_STORE(yr + out1 + q, VF_SUB(VF_MUL(b1r, vw1r), VF_MUL(b1i, vw1i)));
+            VF_STORE(yi + out1 + q, VF_ADD(VF_MUL(b1r, vw1i), VF_MUL(b1i, vw1r)));
+            VF_STORE(yr + out2 + q, VF_SUB(VF_MUL(b2r, vw2r), VF_MUL(b2i, vw2i)));
+            VF_STORE(yi + out2 + q, VF_ADD(VF_MUL(b2r, vw2i), VF_MUL(b2i, vw2r)));
+            VF_STORE(yr + out3 + q, VF_SUB(VF_MUL(b3r, vw3r), VF_MUL(b3i, vw3i)));
+            VF_STORE(yi + out3 + q, VF_ADD(VF_MUL(b3r, vw3i), VF_MUL(b3i, vw3r)));
+        }
+#endif
+        for (; q < s; ++q)
+        {
+            float a0r = xr[in0 + q];
+            float a0i = xi[in0 + q];
+            float a1r = xr[in1 + q];
+            float a1i = xi[in1 + q];
+            float a2r = xr[in2 + q];
+            float a2i = xi[in2 + q];
+            float a3r = xr[in3 + q];
+            float a3i = xi[in3 + q];
+
+            float t0r = a0r + a2r;
+            float t0i = a0i + a2i;
+            float t1r = a0r - a2r;
+            float t1i = a0i - a2i;
+            float t2r = a1r + a3r;
+            float t2i = a1i + a3i;
+            float t3r = a1i - a3i;
+            float t3i = a3r - a1r;
+
+            float b1r = t1r + t3r;
+            float b1i = t1i + t3i;
+            float b2r = t0r - t2r;
+            float b2i = t0i - t2i;
+            float b3r = t1r - t3r;
+            float b3i = t1i - t3i;
+
+            yr[out0 + q] = t0r + t2r;
+            yi[out0 + q] = t0i + t2i;
+            yr[out1 + q] = b1r * w1r - b1i * w1i;
+            yi[out1 + q] = b1r * w1i + b1i * w1r;
+            yr[out2 + q] = b2r * w2r - b2i * w2i;
+            yi[out2 + q] = b2r * w2i + b2i * w2r;
+            yr[out3 + q] = b3r * w3r - b3i * w3i;
+            yi[out3 + q] = b3r * w3i + b3i * w3r;
+        }
+    }
+}
+
+
+#ifdef FFT_X86
+/* Radix-4 Stockham pass with AVX */
+__attribute__((target("avx,fma"))) static void
+native_pass4_avx(unsigned s, unsigned m, const float* xr, const float* xi,
+                 float* yr, float* yi, const float* twr, const float* twi)
+{
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const float w1r = twr[3 * p];
+        const float w1i = twi[3 * p];
+        const float w2r = twr[3 * p + 1];
+        const float w2i = twi[3 * p + 1];
+        const float w3r = twr[3 * p + 2];
+        const float w3i = twi[3 * p + 2];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned in3 = s * (p + 3 * m);
+        const unsigned out0 = s * 4 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        const unsigned out3 = out2 + s;
+        unsigned q = 0;
+        const vfloat8 vw1r = VF8_SET1(w1r);
+        const vfloat8 vw1i = VF8_SET1(w1i);
+        const vfloat8 vw2r = VF8_SET1(w2r);
+        const vfloat8 vw2i = VF8_SET1(w2i);
+        const vfloat8 vw3r = VF8_SET1(w3r);
+        const vfloat8 vw3i = VF8_SET1(w3i);
+        for (; q + VF8_WIDTH <= s; q += VF8_WIDTH)
+        {
+            vfloat8 a0r = VF8_LOAD(xr + in0 + q);
+            vfloat8 a0i = VF8_LOAD(xi + in0 + q);
+            vfloat8 a1r = VF8_LOAD(xr + in1 + q);
+            vfloat8 a1i = VF8_LOAD(xi + in1 + q);
+            vfloat8 a2r = VF8_LOAD(xr + in2 + q);
+            vfloat8 a2i = VF8_LOAD(xi + in2 + q);
+            vfloat8 a3r = VF8_LOAD(xr + in3 + q);
+            vfloat8 a3i = VF8_LOAD(xi + in3 + q);
+
+            vfloat8 t0r = VF8_ADD(a0r, a2r);
+            vfloat8 t0i = VF8_ADD(a0i, a2i);
+            vfloat8 t1r = VF8_SUB(a0r, a2r);
+            vfloat8 t1i = VF8_SUB(a0i, a2i);
+            vfloat8 t2r = VF8_ADD(a1r, a3r);
+            vfloat8 t2i = VF8_ADD(a1i, a3i);
+            vfloat8 t3r = VF8_SUB(a1i, a3i);      // -i * (a1 - a3)
+            vfloat8 t3i = VF8_SUB(a3r, a1r);
+
+            vfloat8 b1r = VF8_ADD(t1r, t3r);
+            vfloat8 b1i = VF8_ADD(t1i, t3i);
+            vfloat8 b2r = VF8_SUB(t0r, t2r);
+            vfloat8 b2i = VF8_SUB(t0i, t2i);
+            vfloat8 b3r = VF8_SUB(t1r, t3r);
+            vfloat8 b3i = VF8_SUB(t1i, t3i);
+
+            VF8_STORE(yr + out0 + q, VF8_ADD(t0r, t2r));
+            VF8_STORE(yi + out0 + q, VF8_ADD(t0i, t2i));
+            VF8_STORE(yr + out1 + q, VF8_SUB(VF8_MUL(b1r, vw1r), VF8_MUL(b1i, vw1i)));
+            VF8_STORE(yi + out1 + q, VF8_ADD(VF8_MUL(b1r, vw1i), VF8_MUL(b1i, vw1r)));
+            VF8_STORE(yr + out2 + q, VF8_SUB(VF8_MUL(b2r, vw2r), VF8_MUL(b2i, vw2i)));
+            VF8_STORE(yi + out2 + q, VF8_ADD(VF8_MUL(b2r, vw2i), VF8_MUL(b2i, vw2r)));
+            VF8_STORE(yr + out3 + q, VF8_SUB(VF8_MUL(b3r, vw3r), VF8_MUL(b3i, vw3i)));
+            VF8_STORE(yi + out3 + q, VF8_ADD(VF8_MUL(b3r, vw3i), VF8_MUL(b3i, vw3r)));
+        }
+        for (; q < s; ++q)
+        {
+            float a0r = xr[in0 + q];
+            float a0i = xi[in0 + q];
+            float a1r = xr[in1 + q];
+            float a1i = xi[in1 + q];
+            float a2r = xr[in2 + q];
+            float a2i = xi[in2 + q];
+            float a3r = xr[in3 + q];
+            float a3i = xi[in3 + q];
+
+            float t0r = a0r + a2r;
+            float t0i = a0i + a2i;
+            float t1r = a0r - a2r;
+            float t1i = a0i - a2i;
+            float t2r = a1r + a3r;
+            float t2i = a1i + a3i;
+            float t3r = a1i - a3i;
+            float t3i = a3r - a1r;
+
+            float b1r = t1r + t3r;
+            float b1i = t1i + t3i;
+            float b2r = t0r - t2r;
+            float b2i = t0i - t2i;
+            float b3r = t1r - t3r;
+            float b3i = t1i - t3i;
+
+            yr[out0 + q] = t0r + t2r;
+            yi[out0 + q] = t0i + t2i;
+            yr[out1 + q] = b1r * w1r - b1i * w1i;
+            yi[out1 + q] = b1r * w1i + b1i * w1r;
+            yr[out2 + q] = b2r * w2r - b2i * w2i;
+            yi[out2 + q] = b2r * w2i + b2i * w2r;
+            yr[out3 + q] = b3r * w3r - b3i * w3i;
+            yi[out3 + q] = b3r * w3i + b3i * w3r;
+        }
+    }
+}
+#endif
+
+
+/* Radix-3 Stockham pass */
+static void
+native_pass3(unsigned s, unsigned m, const float* xr, const float* xi,
+             float* yr, float* yi, const float* twr, const float* twi)
+{
+#ifdef FFT_X86
+    if (s >= VF8_WIDTH && FFT_HAS_AVX())
+    {
+        native_pass3_avx(s, m, xr, xi, yr, yi, twr, twi);
+        return;
+    }
+#endif
+    const float c1 = -0.5;                              // cos(2pi/3)
+    const float s1 = 0.86602540378443864676;            // sin(2pi/3)
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const float w1r = twr[2 * p];
+        const float w1i = twi[2 * p];
+        const float w2r = twr[2 * p + 1];
+        const float w2i = twi[2 * p + 1];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned out0 = s * 3 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        unsigned q = 0;
+#ifdef VF_WIDTH
+        const vfloat vc1 = VF_SET1(c1);
+        const vfloat vs1 = VF_SET1(s1);
+        const vfloat vw1r = VF_SET1(w1r);
+        const vfloat vw1i = VF_SET1(w1i);
+        const vfloat vw2r = VF_SET1(w2r);
+        const vfloat vw2i = VF_SET1(w2i);
+        for (; q + VF_WIDTH <= s; q += VF_WIDTH)
+        {
+            vfloat a0r = VF_LOAD(xr + in0 + q);
+            vfloat a0i = VF_LOAD(xi + in0 + q);
+            vfloat a1r = VF_LOAD(xr + in1 + q);
+            vfloat a1i = VF_LOAD(xi + in1 + q);
+            vfloat a2r = VF_LOAD(xr + in2 + q);
+            vfloat a2i = VF_LOAD(xi + in2 + q);
+
+            vfloat t1r = VF_ADD(a1r, a2r);
+            vfloat t1i = VF_ADD(a1i, a2i);
+            vfloat t2r = VF_ADD(a0r, VF_MUL(vc1, t1r));
+            vfloat t2i = VF_ADD(a0i, VF_MUL(vc1, t1i));
+            vfloat t3r = VF_MUL(vs1, VF_SUB(a1r, a2r));
+            vfloat t3i = VF_MUL(vs1, VF_SUB(a1i, a2i));
+
+            vfloat b1r = VF_ADD(t2r, t3i);      // t2 - i * t3
+            vfloat b1i = VF_SUB(t2i, t3r);
+            vfloat b2r = VF_SUB(t2r, t3i);      // t2 + i * t3
+            vfloat b2i = VF_ADD(t2i, t3r);
+
+            VF_STORE(yr + out0 + q, VF_ADD(a0r, t1r));
+            VF_STORE(yi + out0 + q, VF_ADD(a0i, t1i));
+            VF_STORE(yr + out1 + q, VF_SUB(VF_MUL(b1r, vw1r), VF_MUL(b1i, vw1i)));
+            VF_STORE(yi + out1 + q, VF_ADD(VF_MUL(b1r, vw1i), VF_MUL(b1i, vw1r)));
+            VF_STORE(yr + out2 + q, VF_SUB(VF_MUL(b2r, vw2r), VF_MUL(b2i, vw2i)));
+            VF_STORE(yi + out2 + q, VF_ADD(VF_MUL(b2r, vw2i), VF_MUL(b2i, vw2r)));
+        }
+#endif
+        for (; q < s; ++q)
+        {
+            float a0r = xr[in0 + q];
+            float a0i = xi[in0 + q];
+            float a1r = xr[in1 + q];
+            float a1i = xi[in1 + q];
+            float a2r = xr[in2 + q];
+            float a2i = xi[in2 + q];
+
+            float t1r = a1r + a2r;
+            float t1i = a1i + a2i;
+            float t2r = a0r + c1 * t1r;
+            float t2i = a0i + c1 * t1i;
+            float t3r = s1 * (a1r - a2r);
+            float t3i = s1 * (a1i - a2i);
+
+            float b1r = t2r + t3i;
+            float b1i = t2i - t3r;
+            float b2r = t2r - t3i;
+            float b2i = t2i + t3r;
+
+            yr[out0 + q] = a0r + t1r;
+            yi[out0 + q] = a0i + t1i;
+            yr[out1 + q] = b1r * w1r - b1i * w1i;
+            yi[out1 + q] = b1r * w1i + b1i * w1r;
+            yr[out2 + q] = b2r * w2r - b2i * w2i;
+            yi[out2 + q] = b2r * w2i + b2i * w2r;
+        }
+    }
+}
+
+
+#ifdef FFT_X86
+/* Radix-3 Stockham pass with AVX */
+__attribute__((target("avx,fma"))) static void
+native_pass3_avx(unsigned s, unsigned m, const float* xr, const float* xi,
+                 float* yr, float* yi, const float* twr, const float* twi)
+{
+    const float c1 = -0.5;                              // cos(2pi/3)
+    const float s1 = 0.86602540378443864676;            // sin(2pi/3)
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const float w1r = twr[2 * p];
+        const float w1i = twi[2 * p];
+        const float w2r = twr[2 * p + 1];
+        const float w2i = twi[2 * p + 1];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned out0 = s * 3 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        unsigned q = 0;
+        const vfloat8 vc1 = VF8_SET1(c1);
+        const vfloat8 vs1 = VF8_SET1(s1);
+        const vfloat8 vw1r = VF8_SET1(w1r);
+        const vfloat8 vw1i = VF8_SET1(w1i);
+        const vfloat8 vw2r = VF8_SET1(w2r);
+        const vfloat8 vw2i = VF8_SET1(w2i);
+        for (; q + VF8_WIDTH <= s; q += VF8_WIDTH)
+        {
+            vfloat8 a0r = VF8_LOAD(xr + in0 + q);
+            vfloat8 a0i = VF8_LOAD(xi + in0 + q);
+            vfloat8 a1r = VF8_LOAD(xr + in1 + q);
+            vfloat8 a1i = VF8_LOAD(xi + in1 + q);
+            vfloat8 a2r = VF8_LOAD(xr + in2 + q);
+            vfloat8 a2i = VF8_LOAD(xi + in2 + q);
+
+            vfloat8 t1r = VF8_ADD(a1r, a2r);
+            vfloat8 t1i = VF8_ADD(a1i, a2i);
+            vfloat8 t2r = VF8_ADD(a0r, VF8_MUL(vc1, t1r));
+            vfloat8 t2i = VF8_ADD(a0i, VF8_MUL(vc1, t1i));
+            vfloat8 t3r = VF8_MUL(vs1, VF8_SUB(a1r, a2r));
+            vfloat8 t3i = VF8_MUL(vs1, VF8_SUB(a1i, a2i));
+
+            vfloat8 b1r = VF8_ADD(t2r, t3i);      // t2 - i * t3
+            vfloat8 b1i = VF8_SUB(t2i, t3r);
+            vfloat8 b2r = VF8_SUB(t2r, t3i);      // t2 + i * t3
+            vfloat8 b2i = VF8_ADD(t2i, t3r);
+
+            VF8_STORE(yr + out0 + q, VF8_ADD(a0r, t1r));
+            VF8_STORE(yi + out0 + q, VF8_ADD(a0i, t1i));
+            VF8_STORE(yr + out1 + q, VF8_SUB(VF8_MUL(b1r, vw1r), VF8_MUL(b1i, vw1i)));
+            VF8_STORE(yi + out1 + q, VF8_ADD(VF8_MUL(b1r, vw1i), VF8_MUL(b1i, vw1r)));
+            VF8_STORE(yr + out2 + q, VF8_SUB(VF8_MUL(b2r, vw2r), VF8_MUL(b2i, vw2i)));
+            VF8_STORE(yi + out2 + q, VF8_ADD(VF8_MUL(b2r, vw2i), VF8_MUL(b2i, vw2r)));
+        }
+        for (; q < s; ++q)
+        {
+            float a0r = xr[in0 + q];
+            float a0i = xi[in0 + q];
+            float a1r = xr[in1 + q];
+            float a1i = xi[in1 + q];
+            float a2r = xr[in2 + q];
+            float a2i = xi[in2 + q];
+
+            float t1r = a1r + a2r;
+            float t1i = a1i + a2i;
+            float t2r = a0r + c1 * t1r;
+            float t2i = a0i + c1 * t1i;
+            float t3r = s1 * (a1r - a2r);
+            float t3i = s1 * (a1i - a2i);
+
+            float b1r = t2r + t3i;
+            float b1i = t2i - t3r;
+            float b2r = t2r - t3i;
+            float b2i = t2i + t3r;
+
+            yr[out0 + q] = a0r + t1r;
+            yi[out0 + q] = a0i + t1i;
+            yr[out1 + q] = b1r * w1r - b1i * w1i;
+            yi[out1 + q] = b1r * w1i + b1i * w1r;
+            yr[out2 + q] = b2r * w2r - b2i * w2i;
+            yi[out2 + q] = b2r * w2i + b2i * w2r;
+        }
+    }
+}
+#endif
+
+
+/* Radix-5 Stockham pass */
+static void
+native_pass5(unsigned s, unsigned m, const float* xr, const float* xi,
+             float* yr, float* yi, const float* twr, const float* twi)
+{
+#ifdef FFT_X86
+    if (s >= VF8_WIDTH && FFT_HAS_AVX())
+    {
+        native_pass5_avx(s, m, xr, xi, yr, yi, twr, twi);
+        return;
+    }
+#endif
+    const float c1 = 0.30901699437494742410;            // cos(2pi/5)
+    const float c2 = -0.80901699437494742410;           // cos(4pi/5)
+    const float s1 = 0.95105651629515357212;            // sin(2pi/5)
+    const float s2 = 0.58778525229247312917;            // sin(4pi/5)
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const float* wr = twr + 4 * p;
+        const float* wi = twi + 4 * p;
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned in3 = s * (p + 3 * m);
+        const unsigned in4 = s * (p + 4 * m);
+        const unsigned out0 = s * 5 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        const unsigned out3 = out2 + s;
+        const unsigned out4 = out3 + s;
+        unsigned q = 0;
+#ifdef VF_WIDTH
+        const vfloat vc1 = VF_SET1(c1);
+        const vfloat vc2 = VF_SET1(c2);
+        const vfloat vs1 = VF_SET1(s1);
+        const vfloat vs2 = VF_SET1(s2);
+        const vfloat vw1r = VF_SET1(wr[0]);
+        const vfloat vw1i = VF_SET1(wi[0]);
+        const vfloat vw2r = VF_SET1(wr[1]);
+        const vfloat vw2i = VF_SET1(wi[1]);
+        const vfloat vw3r = VF_SET1(wr[2]);
+        const vfloat vw3i = VF_SET1(wi[2]);
+        const vfloat vw4r = VF_SET1(wr[3]);
+        const vfloat vw4i = VF_SET1(wi[3]);
+        for (; q + VF_WIDTH <= s; q += VF_WIDTH)
+        {
+            vfloat a0r = VF_LOAD(xr + in0 + q);
+            vfloat a0i = VF_LOAD(xi + in0 + q);
+            vfloat a1r = VF_LOAD(xr + in1 + q);
+            vfloat a1i = VF_LOAD(xi + in1 + q);
+            vfloat a2r = VF_LOAD(xr + in2 + q);
+            vfloat a2i = VF_LOAD(xi + in2 + q);
+            vfloat a3r = VF_LOAD(xr + in3 + q);
+            vfloat a3i = VF_LOAD(xi + in3 + q);
+            vfloat a4r = VF_LOAD(xr + in4 + q);
+            vfloat a4i = VF_LOAD(xi + in4 + q);
+
+            vfloat t1r = VF_ADD(a1r, a4r);
+            vfloat t1i = VF_ADD(a1i, a4i);
+            vfloat t2r = VF_ADD(a2r, a3r);
+            vfloat t2i = VF_ADD(a2i, a3i);
+            vfloat d1r = VF_SUB(a1r, a4r);
+            vfloat d1i = VF_SUB(a1i, a4i);
+            vfloat d2r = VF_SUB(a2r, a3r);
+            vfloat d2i = VF_SUB(a2i, a3i);
+
+            vfloat e1r = VF_ADD(a0r, VF_ADD(VF_MUL(vc1, t1r), VF_MUL(vc2, t2r)));
+            vfloat e1i = VF_ADD(a0i, VF_ADD(VF_MUL(vc1, t1i), VF_MUL(vc2, t2i)));
+            vfloat e2r = VF_ADD(a0r, VF_ADD(VF_MUL(vc2, t1r), VF_MUL(vc1, t2r)));
+            vfloat e2i = VF_ADD(a0i, VF_ADD(VF_MUL(vc2, t1i), VF_MUL(vc1, t2i)));
+            vfloat o1r = VF_ADD(VF_MUL(vs1, d1r), VF_MUL(vs2, d2r));
+            vfloat o1i = VF_ADD(VF_MUL(vs1, d1i), VF_MUL(vs2, d2i));
+            vfloat o2r = VF_SUB(VF_MUL(vs2, d1r), VF_MUL(vs1, d2r));
+            vfloat o2i = VF_SUB(VF_MUL(vs2, d1i), VF_MUL(vs1, d2i));
+
+            vfloat b1r = VF_ADD(e1r, o1i);      // e1 - i * o1
+            vfloat b1i = VF_SUB(e1i, o1r);
+            vfloat b4r = VF_SUB(e1r, o1i);      // e1 + i * o1
+            vfloat b4i = VF_ADD(e1i, o1r);
+            vfloat b2r = VF_ADD(e2r, o2i);      // e2 - i * o2
+            vfloat b2i = VF_SUB(e2i, o2r);
+            vfloat b3r = VF_SUB(e2r, o2i);      // e2 + i * o2
+            vfloat b3i = VF_ADD(e2i, o2r);
+
+            VF_STORE(yr + out0 + q, VF_ADD(a0r, VF_ADD(t1r, t2r)));
+            VF_STORE(yi + out0 + q, VF_ADD(a0i, VF_ADD(t1i, t2i)));
+            VF_STORE(yr + out1 + q, VF_SUB(VF_MUL(b1r, vw1r), VF_MUL(b1i, vw1i)));
+            VF_STORE(yi + out1 + q, VF_ADD(VF_MUL(b1r, vw1i), VF_MUL(b1i, vw1r)));
+            VF_STORE(yr + out2 + q, VF_SUB(VF_MUL(b2r, vw2r), VF_MUL(b2i, vw2i)));
+            VF_STORE(yi + out2 + q, VF_ADD(VF_MUL(b2r, vw2i), VF_MUL(b2i, vw2r)));
+            VF_STORE(yr + out3 + q, VF_SUB(VF_MUL(b3r, vw3r), VF_MUL(b3i, vw3i)));
+            VF_STORE(yi + out3 + q, VF_ADD(VF_MUL(b3r, vw3i), VF_MUL(b3i, vw3r)));
+            VF_STORE(yr + out4 + q, VF_SUB(VF_MUL(b4r, vw4r), VF_MUL(b4i, vw4i)));
+            VF_STORE(yi + out4 + q, VF_ADD(VF_MUL(b4r, vw4i), VF_MUL(b4i, vw4r)));
+        }
+#endif
+        for (; q < s; ++q)
+        {
+            float a0r = xr[in0 + q];
+            float a0i = xi[in0 + q];
+            float a1r = xr[in1 + q];
+            float a1i = xi[in1 + q];
+            float a2r = xr[in2 + q];
+            float a2i = xi[in2 + q];
+            float a3r = xr[in3 + q];
+            float a3i = xi[in3 + q];
+            float a4r = xr[in4 + q];
+            float a4i = xi[in4 + q];
+
+            float t1r = a1r + a4r;
+            float t1i = a1i + a4i;
+            float t2r = a2r + a3r;
+            float t2i = a2i + a3i;
+            float d1r = a1r - a4r;
+            float d1i = a1i - a4i;
+            float d2r = a2r - a3r;
+            float d2i = a2i - a3i;
+
+            float e1r = a0r + c1 * t1r + c2 * t2r;
+            float e1i = a0i + c1 * t1i + c2 * t2i;
+            float e2r = a0r + c2 * t1r + c1 * t2r;
+            float e2i = a0i + c2 * t1i + c1 * t2i;
+            float o1r = s1 * d1r + s2 * d2r;
+            float o1i = s1 * d1i + s2 * d2i;
+            float o2r = s2 * d1r - s1 * d2r;
+            float o2i = s2 * d1i - s1 * d2i;
+
+            float b1r = e1r + o1i;
+            float b1i = e1i - o1r;
+            float b4r = e1r - o1i;
+            float b4i = e1i + o1r;
+            float b2r = e2r + o2i;
+            float b2i = e2i - o2r;
+            float b3r = e2r - o2i;
+            float b3i = e2i + o2r;
+
+            yr[out0 + q] = a0r + t1r + t2r;
+            yi[out0 + q] = a0i + t1i + t2i;
+            yr[out1 + q] = b1r * wr[0] - b1i * wi[0];
+            yi[out1 + q] = b1r * wi[0] + b1i * wr[0];
+            yr[out2 + q] = b2r * wr[1] - b2i * wi[1];
+            yi[out2 + q] = b2r * wi[1] + b2i * wr[1];
+            yr[out3 + q] = b3r * wr[2] - b3i * wi[2];
+            yi[out3 + q] = b3r * wi[2] + b3i * wr[2];
+            yr[out4 + q] = b4r * wr[3] - b4i * wi[3];
+            yi[out4 + q] = b4r * wi[3] + b4i * wr[3];
+        }
+    }
+}
+
+
+#ifdef FFT_X86
+/* Radix-5 Stockham pass with AVX */
+__attribute__((target("avx,fma"))) static void
+native_pass5_avx(unsigned s, unsigned m, const float* xr, const float* xi,
+                 float* yr, float* yi, const float* twr, const float* twi)
+{
+    const float c1 = 0.30901699437494742410;            // cos(2pi/5)
+    const float c2 = -0.80901699437494742410;           // cos(4pi/5)
+    const float s1 = 0.95105651629515357212;            // sin(2pi/5)
+    const float s2 = 0.58778525229247312917;            // sin(4pi/5)
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const float* wr = twr + 4 * p;
+        const float* wi = twi + 4 * p;
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned in3 = s * (p + 3 * m);
+        const unsigned in4 = s * (p + 4 * m);
+        const unsigned out0 = s * 5 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        const unsigned out3 = out2 + s;
+        const unsigned out4 = out3 + s;
+        unsigned q = 0;
+        const vfloat8 vc1 = VF8_SET1(c1);
+        const vfloat8 vc2 = VF8_SET1(c2);
+        const vfloat8 vs1 = VF8_SET1(s1);
+        const vfloat8 vs2 = VF8_SET1(s2);
+        const vfloat8 vw1r = VF8_SET1(wr[0]);
+        const vfloat8 vw1i = VF8_SET1(wi[0]);
+        const vfloat8 vw2r = VF8_SET1(wr[1]);
+        const vfloat8 vw2i = VF8_SET1(wi[1]);
+        const vfloat8 vw3r = VF8_SET1(wr[2]);
+        const vfloat8 vw3i = VF8_SET1(wi[2]);
+        const vfloat8 vw4r = VF8_SET1(wr[3]);
+        const vfloat8 vw4i = VF8_SET1(wi[3]);
+        for (; q + VF8_WIDTH <= s; q += VF8_WIDTH)
+        {
+            vfloat8 a0r = VF8_LOAD(xr + in0 + q);
+            vfloat8 a0i = VF8_LOAD(xi + in0 + q);
+            vfloat8 a1r = VF8_LOAD(xr + in1 + q);
+            vfloat8 a1i = VF8_LOAD(xi + in1 + q);
+            vfloat8 a2r = VF8_LOAD(xr + in2 + q);
+            vfloat8 a2i = VF8_LOAD(xi + in2 + q);
+            vfloat8 a3r = VF8_LOAD(xr + in3 + q);
+            vfloat8 a3i = VF8_LOAD(xi + in3 + q);
+            vfloat8 a4r = VF8_LOAD(xr + in4 + q);
+            vfloat8 a4i = VF8_LOAD(xi + in4 + q);
+
+            vfloat8 t1r = VF8_ADD(a1r, a4r);
+            vfloat8 t1i = VF8_ADD(a1i, a4i);
+            vfloat8 t2r = VF8_ADD(a2r, a3r);
+            vfloat8 t2i = VF8_ADD(a2i, a3i);
+            vfloat8 d1r = VF8_SUB(a1r, a4r);
+            vfloat8 d1i = VF8_SUB(a1i, a4i);
+            vfloat8 d2r = VF8_SUB(a2r, a3r);
+            vfloat8 d2i = VF8_SUB(a2i, a3i);
+
+            vfloat8 e1r = VF8_ADD(a0r, VF8_ADD(VF8_MUL(vc1, t1r), VF8_MUL(vc2, t2r)));
+            vfloat8 e1i = VF8_ADD(a0i, VF8_ADD(VF8_MUL(vc1, t1i), VF8_MUL(vc2, t2i)));
+            vfloat8 e2r = VF8_ADD(a0r, VF8_ADD(VF8_MUL(vc2, t1r), VF8_MUL(vc1, t2r)));
+            vfloat8 e2i = VF8_ADD(a0i, VF8_ADD(VF8_MUL(vc2, t1i), VF8_MUL(vc1, t2i)));
+            vfloat8 o1r = VF8_ADD(VF8_MUL(vs1, d1r), VF8_MUL(vs2, d2r));
+            vfloat8 o1i = VF8_ADD(VF8_MUL(vs1, d1i), VF8_MUL(vs2, d2i));
+            vfloat8 o2r = VF8_SUB(VF8_MUL(vs2, d1r), VF8_MUL(vs1, d2r));
+            vfloat8 o2i = VF8_SUB(VF8_MUL(vs2, d1i), VF8_MUL(vs1, d2i));
+
+            vfloat8 b1r = VF8_ADD(e1r, o1i);      // e1 - i * o1
+            vfloat8 b1i = VF8_SUB(e1i, o1r);
+            vfloat8 b4r = VF8_SUB(e1r, o1i);      // e1 + i * o1
+            vfloat8 b4i = VF8_ADD(e1i, o1r);
+            vfloat8 b2r = VF8_ADD(e2r, o2i);      // e2 - i * o2
+            vfloat8 b2i = VF8_SUB(e2i, o2r);
+            vfloat8 b3r = VF8_SUB(e2r, o2i);      // e2 + i * o2
+            vfloat8 b3i = VF8_ADD(e2i, o2r);
+
+            VF8_STORE(yr + out0 + q, VF8_ADD(a0r, VF8_ADD(t1r, t2r)));
+            VF8_STORE(yi + out0 + q, VF8_ADD(a0i, VF8_ADD(t1i, t2i)));
+            VF8_STORE(yr + out1 + q, VF8_SUB(VF8_MUL(b1r, vw1r), VF8_MUL(b1i, vw1i)));
+            VF8_STORE(yi + out1 + q, VF8_ADD(VF8_MUL(b1r, vw1i), VF8_MUL(b1i, vw1r)));
+            VF8_STORE(yr + out2 + q, VF8_SUB(VF8_MUL(b2r, vw2r), VF8_MUL(b2i, vw2i)));
+            VF8_STORE(yi + out2 + q, VF8_ADD(VF8_MUL(b2r, vw2i), VF8_MUL(b2i, vw2r)));
+            VF8_STORE(yr + out3 + q, VF8_SUB(VF8_MUL(b3r, vw3r), VF8_MUL(b3i, vw3i)));
+            VF8_STORE(yi + out3 + q, VF8_ADD(VF8_MUL(b3r, vw3i), VF8_MUL(b3i, vw3r)));
+            VF8_STORE(yr + out4 + q, VF8_SUB(VF8_MUL(b4r, vw4r), VF8_MUL(b4i, vw4i)));
+            VF8_STORE(yi + out4 + q, VF8_ADD(VF8_MUL(b4r, vw4i), VF8_MUL(b4i, vw4r)));
+        }
+        for (; q < s; ++q)
+        {
+            float a0r = xr[in0 + q];
+            float a0i = xi[in0 + q];
+            float a1r = xr[in1 + q];
+            float a1i = xi[in1 + q];
+            float a2r = xr[in2 + q];
+            float a2i = xi[in2 + q];
+            float a3r = xr[in3 + q];
+            float a3i = xi[in3 + q];
+            float a4r = xr[in4 + q];
+            float a4i = xi[in4 + q];
+
+            float t1r = a1r + a4r;
+            float t1i = a1i + a4i;
+            float t2r = a2r + a3r;
+            float t2i = a2i + a3i;
+            float d1r = a1r - a4r;
+            float d1i = a1i - a4i;
+            float d2r = a2r - a3r;
+            float d2i = a2i - a3i;
+
+            float e1r = a0r + c1 * t1r + c2 * t2r;
+            float e1i = a0i + c1 * t1i + c2 * t2i;
+            float e2r = a0r + c2 * t1r + c1 * t2r;
+            float e2i = a0i + c2 * t1i + c1 * t2i;
+            float o1r = s1 * d1r + s2 * d2r;
+            float o1i = s1 * d1i + s2 * d2i;
+            float o2r = s2 * d1r - s1 * d2r;
+            float o2i = s2 * d1i - s1 * d2i;
+
+            float b1r = e1r + o1i;
+            float b1i = e1i - o1r;
+            float b4r = e1r - o1i;
+            float b4i = e1i + o1r;
+            float b2r = e2r + o2i;
+            float b2i = e2i - o2r;
+            float b3r = e2r - o2i;
+            float b3i = e2i + o2r;
+
+            yr[out0 + q] = a0r + t1r + t2r;
+            yi[out0 + q] = a0i + t1i + t2i;
+            yr[out1 + q] = b1r * wr[0] - b1i * wi[0];
+            yi[out1 + q] = b1r * wi[0] + b1i * wr[0];
+            yr[out2 + q] = b2r * wr[1] - b2i * wi[1];
+            yi[out2 + q] = b2r * wi[1] + b2i * wr[1];
+            yr[out3 + q] = b3r * wr[2] - b3i * wi[2];
+            yi[out3 + q] = b3r * wi[2] + b3i * wr[2];
+            yr[out4 + q] = b4r * wr[3] - b4i * wi[3];
+            yi[out4 + q] = b4r * wi[3] + b4i * wr[3];
+        }
+    }
+}
+#endif
+
+
+/* In-place forward complex FFT of length plan->n in split format. The inverse
+ is computed by swapping the real and imaginary pointers. With several
+ channels, the samples of each channel are interleaved, i.e. sample i of
+ channel c is at i * channels + c, and every pass runs across all of them */
+static void
+native_cfft(const FFT_PLAN* plan, float* re, float* im, float* work_re, float* work_im, unsigned channels)
+{
+    float* xr = re;
+    float* xi = im;
+    float* yr = work_re;
+    float* yi = work_im;
+    const float* twr = plan->twiddle_r;
+    const float* twi = plan->twiddle_i;
+    unsigned s = channels;
+    unsigned n_stage = plan->n;
+
+    for (unsigned stage = 0; stage < plan->n_stages; ++stage)
+    {
+        unsigned radix = plan->radix[stage];
+        unsigned m = n_stage / radix;
+        switch (radix)
+        {
+            case 4:
+                native_pass4(s, m, xr, xi, yr, yi, twr, twi);
+                break;
+            case 3:
+                native_pass3(s, m, xr, xi, yr, yi, twr, twi);
+                break;
+            case 5:
+                native_pass5(s, m, xr, xi, yr, yi, twr, twi);
+                break;
+            default:
+                native_pass2(s, m, xr, xi, yr, yi, twr, twi);
+                break;
+        }
+        twr += (radix - 1) * m;
+        twi += (radix - 1) * m;
+
+        // Ping-pong buffers
+        float* temp = xr;
+        xr = yr;
+        yr = temp;
+        temp = xi;
+        xi = yi;
+        yi = temp;
+        s *= radix;
+        n_stage = m;
+    }
+
+    if (xr != re)
+    {
+        CopyBuffer(re, xr, plan->n * channels);
+        CopyBuffer(im, xi, plan->n * channels);
+    }
+}
+
+
+/* Forward real FFT via a half-length complex FFT. in is zero padded from
+ in_length up to the FFT length. The output is packed, with the nyquist bin
+ stored in im[0] */
+static void
+native_rfft(const FFT_PLAN* plan, float* buffer, const float* in, unsigned in_length, float* re, float* im)
+{
+    const unsigned n = plan->n;
+    float* zr = buffer;
+    float* zi = zr + n;
+    unsigned pairs = in_length / 2;
+    unsigned i;
+
+    // Even samples to the real part and odd samples to the imaginary part
+    for (i = 0; i < pairs; ++i)
+    {
+        zr[i] = in[2 * i];
+        zi[i] = in[2 * i + 1];
+    }
+    if (in_length % 2)
+    {
+        zr[i] = in[2 * i];
+        zi[i] = 0.0;
+        ++i;
+    }
+    for (; i < n; ++i)
+    {
+        zr[i] = 0.0;
+        zi[i] = 0.0;
+    }
+
+    native_cfft(plan, zr, zi, zi + n, zi + 2 * n, 1);
+
+    // Separate the even and odd spectra and combine
+    re[0] = zr[0] + zi[0];
+    im[0] = zr[0] - zi[0];
+    unsigned k = 1;
+#ifdef VF_WIDTH
+    const vfloat half = VF_SET1(0.5);
+    for (; k + VF_WIDTH <= n; k += VF_WIDTH)
+    {
+        vfloat ar = VF_LOAD(zr + k);
+        vfloat ai = VF_LOAD(zi + k);
+        vfloat br = VF_REVERSE(VF_LOAD(zr + n - k - (VF_WIDTH - 1)));
+        vfloat bi = VF_REVERSE(VF_LOAD(zi + n - k - (VF_WIDTH - 1)));
+        vfloat er = VF_MUL(half, VF_ADD(ar, br));
+        vfloat ei = VF_MUL(half, VF_SUB(ai, bi));
+        vfloat odr = VF_MUL(half, VF_ADD(ai, bi));
+        vfloat odi = VF_MUL(half, VF_SUB(br, ar));
+        vfloat c = VF_LOAD(plan->rtwiddle_r + k);
+        vfloat s = VF_LOAD(plan->rtwiddle_i + k);
+        VF_STORE(re + k, VF_ADD(er, VF_ADD(VF_MUL(c, odr), VF_MUL(s, odi))));
+        VF_STORE(im + k, VF_ADD(ei, VF_SUB(VF_MUL(c, odi), VF_MUL(s, odr))));
+    }
+#endif
+    for (; k < n; ++k)
+    {
+        float ar = zr[k];
+        float ai = zi[k];
+        float br = zr[n - k];
+        float bi = zi[n - k];
+        float er = 0.5 * (ar + br);
+        float ei = 0.5 * (ai - bi);
+        float odr = 0.5 * (ai + bi);
+        float odi = 0.5 * (br - ar);
+        float c = plan->rtwiddle_r[k];
+        float s = plan->rtwiddle_i[k];
+        re[k] = er + c * odr + s * odi;
+        im[k] = ei + c * odi - s * odr;
+    }
+}
+
+
+/* Inverse real FFT from a packed spectrum. im[0] is ignored and the nyquist bin
+ is passed separately. The output is multiplied by scale */
+static void
+native_irfft(const FFT_PLAN* plan, float* buffer, const float* re,
+             const float* im, float nyquist, float* out, float scale)
+{
+    const unsigned n = plan->n;
+    float* zr = buffer;
+    float* zi = zr + n;
+
+    // Recombine into the spectrum of the half-length complex signal
+    zr[0] = re[0] + nyquist;
+    zi[0] = re[0] - nyquist;
+    unsigned k = 1;
+#ifdef VF_WIDTH
+    for (; k + VF_WIDTH <= n; k += VF_WIDTH)
+    {
+        vfloat ar = VF_LOAD(re + k);
+        vfloat ai = VF_LOAD(im + k);
+        vfloat br = VF_REVERSE(VF_LOAD(re + n - k - (VF_WIDTH - 1)));
+        vfloat bi = VF_REVERSE(VF_LOAD(im + n - k - (VF_WIDTH - 1)));
+        vfloat dr = VF_SUB(ar, br);
+        vfloat di = VF_ADD(ai, bi);
+        vfloat c = VF_LOAD(plan->rtwiddle_r + k);
+        vfloat s = VF_LOAD(plan->rtwiddle_i + k);
+        VF_STORE(zr + k, VF_SUB(VF_ADD(ar, br), VF_ADD(VF_MUL(dr, s), VF_MUL(di, c))));
+        VF_STORE(zi + k, VF_ADD(VF_SUB(ai, bi), VF_SUB(VF_MUL(dr, c), VF_MUL(di, s))));
+    }
+#endif
+    for (; k < n; ++k)
+    {
+        float ar = re[k];
+        float ai = im[k];
+        float br = re[n - k];
+        float bi = im[n - k];
+        float dr = ar - br;
+        float di = ai + bi;
+        float c = plan->rtwiddle_r[k];
+        float s = plan->rtwiddle_i[k];
+        zr[k] = (ar + br) - (dr * s + di * c);
+        zi[k] = (ai - bi) + (dr * c - di * s);
+    }
+
+    // Inverse transform by swapping real and imaginary parts
+    native_cfft(plan, zi, zr, zi + 2 * n, zi + n, 1);
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        out[2 * i] = zr[i] * scale;
+        out[2 * i + 1] = zi[i] * scale;
+    }
+}
+
+
+/* Complex FFT of length 2 * plan->n. The even and odd samples are transformed
+ together as two interleaved channels, then combined with one radix-2 pass.
+ buffer holds 4 * plan->n values */
+static void
+native_c2c(const FFT_PLAN* plan, float* buffer, const float* in_re,
+           const float* in_im, float* out_re, float* out_im)
+{
+    const unsigned n = plan->n;
+    float* zr = buffer;
+    float* zi = zr + 2 * n;
+
+    CopyBuffer(zr, in_re, 2 * n);
+    CopyBuffer(zi, in_im, 2 * n);
+    native_cfft(plan, zr, zi, out_re, out_im, 2);
+
+    // X[k] = E[k] + w^k * O[k], X[k + n] = E[k] - w^k * O[k]
+    for (unsigned k = 0; k < n; ++k)
+    {
+        float er = zr[2 * k];
+        float ei = zi[2 * k];
+        float odr = zr[2 * k + 1];
+        float odi = zi[2 * k + 1];
+        float c = plan->rtwiddle_r[k];
+        float s = plan->rtwiddle_i[k];
+        float tr = odr * c + odi * s;
+        float ti = odi * c - odr * s;
+        out_re[k] = er + tr;
+        out_im[k] = ei + ti;
+        out_re[k + n] = er - tr;
+        out_im[k + n] = ei - ti;
+    }
+}
+
+
+/* Forward real FFT of several channels at once. Channel c is read from
+ in + c * in_stride. The channels are interleaved sample by sample, so every
+ pass runs across all of them with one set of twiddles, and the packed spectra
+ are written interleaved too: bin k of channel c is at k * channels + c, with
+ the nyquist bin in im[c]. buffer holds 2 * length * channels values */
+static void
+native_rfft_batch(const FFT_PLAN* plan, float* buffer, const float* in,
+                  unsigned in_stride, unsigned in_length, unsigned channels,
+                  float* re, float* im)
+{
+    const unsigned n = plan->n;
+    const unsigned total = n * channels;
+    float* zr = buffer;
+    float* zi = zr + total;
+    unsigned pairs = in_length / 2;
+
+    ClearBuffer(zr, 2 * total);
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        const float* x = in + c * in_stride;
+        unsigned i;
+        for (i = 0; i < pairs; ++i)
+        {
+            zr[i * channels + c] = x[2 * i];
+            zi[i * channels + c] = x[2 * i + 1];
+        }
+        if (in_length % 2)
+        {
+            zr[i * channels + c] = x[2 * i];
+        }
+    }
+
+    native_cfft(plan, zr, zi, zi + total, zi + 2 * total, channels);
+
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        re[c] = zr[c] + zi[c];
+        im[c] = zr[c] - zi[c];
+    }
+    for (unsigned k = 1; k < n; ++k)
+    {
+        const float c = plan->rtwiddle_r[k];
+        const float s = plan->rtwiddle_i[k];
+        const unsigned a = k * channels;
+        const unsigned b = (n - k) * channels;
+        unsigned ch = 0;
+#ifdef VF_WIDTH
+        const vfloat half = VF_SET1(0.5);
+        const vfloat vc = VF_SET1(c);
+        const vfloat vs = VF_SET1(s);
+        for (; ch + VF_WIDTH <= channels; ch += VF_WIDTH)
+        {
+            vfloat ar = VF_LOAD(zr + a + ch);
+            vfloat ai = VF_LOAD(zi + a + ch);
+            vfloat br = VF_LOAD(zr + b + ch);
+            vfloat bi = VF_LOAD(zi + b + ch);
+            vfloat er = VF_MUL(half, VF_ADD(ar, br));
+            vfloat ei = VF_MUL(half, VF_SUB(ai, bi));
+            vfloat odr = VF_MUL(half, VF_ADD(ai, bi));
+            vfloat odi = VF_MUL(half, VF_SUB(br, ar));
+            VF_STORE(re + a + ch, VF_ADD(er, VF_ADD(VF_MUL(vc, odr), VF_MUL(vs, odi))));
+            VF_STORE(im + a + ch, VF_ADD(ei, VF_SUB(VF_MUL(vc, odi), VF_MUL(vs, odr))));
+        }
+#endif
+        for (; ch < channels; ++ch)
+        {
+            float ar = zr[a + ch];
+            float ai = zi[a + ch];
+            float br = zr[b + ch];
+            float bi = zi[b + ch];
+            float er = 0.5 * (ar + br);
+            float ei = 0.5 * (ai - bi);
+            float odr = 0.5 * (ai + bi);
+            float odi = 0.5 * (br - ar);
+            re[a + ch] = er + c * odr + s * odi;
+            im[a + ch] = ei + c * odi - s * odr;
+        }
+    }
+}
+
+
+/* Inverse of native_rfft_batch. Takes interleaved packed spectra and writes
+ channel c, multiplied by scale, to out + c * out_stride */
+static void
+native_irfft_batch(const FFT_PLAN* plan, float* buffer, const float* re,
+                   const float* im, unsigned channels, float* out,
+                   unsigned out_stride, float scale)
+{
+    const unsigned n = plan->n;
+    const unsigned total = n * channels;
+    float* zr = buffer;
+    float* zi = zr + total;
+
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        zr[c] = re[c] + im[c];
+        zi[c] = re[c] - im[c];
+    }
+    for (unsigned k = 1; k < n; ++k)
+    {
+        const float c = plan->rtwiddle_r[k];
+        const float s = plan->rtwiddle_i[k];
+        const unsigned a = k * channels;
+        const unsigned b = (n - k) * channels;
+        unsigned ch = 0;
+#ifdef VF_WIDTH
+        const vfloat vc = VF_SET1(c);
+        const vfloat vs = VF_SET1(s);
+        for (; ch + VF_WIDTH <= channels; ch += VF_WIDTH)
+        {
+            vfloat ar = VF_LOAD(re + a + ch);
+            vfloat ai = VF_LOAD(im + a + ch);
+            vfloat br = VF_LOAD(re + b + ch);
+            vfloat bi = VF_LOAD(im + b + ch);
+            vfloat dr = VF_SUB(ar, br);
+            vfloat di = VF_ADD(ai, bi);
+            VF_STORE(zr + a + ch, VF_SUB(VF_ADD(ar, br), VF_ADD(VF_MUL(dr, vs), VF_MUL(di, vc))));
+            VF_STORE(zi + a + ch, VF_ADD(VF_SUB(ai, bi), VF_SUB(VF_MUL(dr, vc), VF_MUL(di, vs))));
+        }
+#endif
+        for (; ch < channels; ++ch)
+        {
+            float ar = re[a + ch];
+            float ai = im[a + ch];
+            float br = re[b + ch];
+            float bi = im[b + ch];
+            float dr = ar - br;
+            float di = ai + bi;
+            zr[a + ch] = (ar + br) - (dr * s + di * c);
+            zi[a + ch] = (ai - bi) + (dr * c - di * s);
+        }
+    }
+
+    // Inverse transform by swapping real and imaginary parts
+    native_cfft(plan, zi, zr, zi + 2 * total, zi + total, channels);
+
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        float* y = out + c * out_stride;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            y[2 * i] = zr[i * channels + c] * scale;
+            y[2 * i + 1] = zi[i * channels + c] * scale;
+        }
+    }
+}
+
+
+/* Multiply interleaved packed spectra by one packed kernel spectrum. DC and
+ nyquist are real, so they are multiplied separately */
+static void
+native_batch_multiply(float* re, float* im, const float* kernel_re,
+                      const float* kernel_im, unsigned n, unsigned channels)
+{
+#ifdef FFT_X86
+    if (channels >= VF8_WIDTH && FFT_HAS_AVX())
+    {
+        native_batch_multiply_avx(re, im, kernel_re, kernel_im, n, channels);
+        return;
+    }
+#endif
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        re[c] *= kernel_re[0];
+        im[c] *= kernel_im[0];
+    }
+    for (unsigned k = 1; k < n; ++k)
+    {
+        const float hr = kernel_re[k];
+        const float hi = kernel_im[k];
+        float* xr = re + k * channels;
+        float* xi = im + k * channels;
+        unsigned ch = 0;
+#ifdef VF_WIDTH
+        const vfloat vhr = VF_SET1(hr);
+        const vfloat vhi = VF_SET1(hi);
+        for (; ch + VF_WIDTH <= channels; ch += VF_WIDTH)
+        {
+            vfloat ar = VF_LOAD(xr + ch);
+            vfloat ai = VF_LOAD(xi + ch);
+            VF_STORE(xr + ch, VF_SUB(VF_MUL(ar, vhr), VF_MUL(ai, vhi)));
+            VF_STORE(xi + ch, VF_ADD(VF_MUL(ar, vhi), VF_MUL(ai, vhr)));
+        }
+#endif
+        for (; ch < channels; ++ch)
+        {
+            float ar = xr[ch];
+            float ai = xi[ch];
+            xr[ch] = ar * hr - ai * hi;
+            xi[ch] = ar * hi + ai * hr;
+        }
+    }
+}
+
+
+#ifdef FFT_X86
+/* Batch spectrum multiply with AVX, a vector of channels at a time */
+__attribute__((target("avx,fma"))) static void
+native_batch_multiply_avx(float* re, float* im, const float* kernel_re,
+                          const float* kernel_im, unsigned n, unsigned channels)
+{
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        re[c] *= kernel_re[0];
+        im[c] *= kernel_im[0];
+    }
+    for (unsigned k = 1; k < n; ++k)
+    {
+        const float hr = kernel_re[k];
+        const float hi = kernel_im[k];
+        float* xr = re + k * channels;
+        float* xi = im + k * channels;
+        unsigned ch = 0;
+        const vfloat8 vhr = VF8_SET1(hr);
+        const vfloat8 vhi = VF8_SET1(hi);
+        for (; ch + VF8_WIDTH <= channels; ch += VF8_WIDTH)
+        {
+            vfloat8 ar = VF8_LOAD(xr + ch);
+            vfloat8 ai = VF8_LOAD(xi + ch);
+            VF8_STORE(xr + ch, VF8_SUB(VF8_MUL(ar, vhr), VF8_MUL(ai, vhi)));
+            VF8_STORE(xi + ch, VF8_ADD(VF8_MUL(ar, vhi), VF8_MUL(ai, vhr)));
+        }
+        for (; ch < channels; ++ch)
+        {
+            float ar = xr[ch];
+            float ai = xi[ch];
+            xr[ch] = ar * hr - ai * hi;
+            xi[ch] = ar * hi + ai * hr;
+        }
+    }
+}
+
+
+/* Complex multiply-accumulate of whole vectors of bins with AVX. Returns the
+ number of bins done, leaving the rest to the caller */
+__attribute__((target("avx,fma"))) static unsigned
+spectrum_mac_avx(float* acc_re, float* acc_im, const float* a_re, const float* a_im,
+                 const float* b_re, const float* b_im, unsigned bins)
+{
+    unsigned k = 0;
+    for (; k + VF8_WIDTH <= bins; k += VF8_WIDTH)
+    {
+        vfloat8 ar = VF8_LOAD(a_re + k);
+        vfloat8 ai = VF8_LOAD(a_im + k);
+        vfloat8 br = VF8_LOAD(b_re + k);
+        vfloat8 bi = VF8_LOAD(b_im + k);
+        VF8_STORE(acc_re + k, VF8_ADD(VF8_LOAD(acc_re + k),
+                                      VF8_SUB(VF8_MUL(ar, br), VF8_MUL(ai, bi))));
+        VF8_STORE(acc_im + k, VF8_ADD(VF8_LOAD(acc_im + k),
+                                      VF8_ADD(VF8_MUL(ar, bi), VF8_MUL(ai, br))));
+    }
+    return k;
+}
+
+
+/* In-place complex multiply of whole vectors of bins from start to end with
+ AVX. Returns the first bin not done */
+__attribute__((target("avx,fma"))) static unsigned
+spectrum_multiply_avx(float* re, float* im, const float* k_re, const float* k_im,
+                      unsigned start, unsigned end)
+{
+    unsigned k = start;
+    for (; k + VF8_WIDTH <= end; k += VF8_WIDTH)
+    {
+        vfloat8 ar = VF8_LOAD(re + k);
+        vfloat8 ai = VF8_LOAD(im + k);
+        vfloat8 br = VF8_LOAD(k_re + k);
+        vfloat8 bi = VF8_LOAD(k_im + k);
+        VF8_STORE(re + k, VF8_SUB(VF8_MUL(ar, br), VF8_MUL(ai, bi)));
+        VF8_STORE(im + k, VF8_ADD(VF8_MUL(ar, bi), VF8_MUL(ai, br)));
+    }
+    return k;
+}
+#endif
+
+
+static Error_t
+native_plan_initD(FFT_PLAN_D* plan, unsigned length)
+{
+    unsigned n = length / 2;
+    int stages = ((length % 2) == 0) ? native_factor(n, plan->radix) : -1;
+    if (stages < 0)
+    {
+        return VALUE_ERROR;
+    }
+
+    // Count twiddles needed by all passes
+    unsigned stride = 1;
+    unsigned n_twiddles = 0;
+    for (int stage = 0; stage < stages; ++stage)
+    {
+        n_twiddles += (plan->radix[stage] - 1) * (n / (stride * plan->radix[stage]));
+        stride *= plan->radix[stage];
+    }
+
+    plan->n = n;
+    plan->n_stages = stages;
+    plan->twiddle_r = (double*)malloc((2 * n_twiddles + 1) * sizeof(double));
+    plan->rtwiddle_r = (double*)malloc(2 * n * sizeof(double));
+    if (!plan->twiddle_r || !plan->rtwiddle_r)
+    {
+        free(plan->twiddle_r);
+        free(plan->rtwiddle_r);
+        return NULL_PTR_ERROR;
+    }
+    plan->twiddle_i = plan->twiddle_r + n_twiddles;
+    plan->rtwiddle_i = plan->rtwiddle_r + n;
+
+    // Butterfly twiddles, w^(k*p) for each butterfly p in each pass
+    double* twr = plan->twiddle_r;
+    double* twi = plan->twiddle_i;
+    unsigned n_stage = n;
+    for (int stage = 0; stage < stages; ++stage)
+    {
+        unsigned radix = plan->radix[stage];
+        unsigned m = n_stage / radix;
+        for (unsigned p = 0; p < m; ++p)
+        {
+            for (unsigned k = 1; k < radix; ++k)
+            {
+                double phase = -2.0 * M_PI * (double)(k * p) / n_stage;
+                *twr++ = cos(phase);
+                *twi++ = sin(phase);
+            }
+        }
+        n_stage = m;
+    }
+
+    // Twiddles for splitting the half-length complex transform
+    for (unsigned k = 0; k < n; ++k)
+    {
+        double phase = 2.0 * M_PI * (double)k / length;
+        plan->rtwiddle_r[k] = cos(phase);
+        plan->rtwiddle_i[k] = sin(phase);
+    }
+    return NOERR;
+}
+
+
+static void
+native_plan_freeD(FFT_PLAN_D* plan)
+{
+    free(plan->twiddle_r);
+    free(plan->rtwiddle_r);
+    plan->twiddle_r = NULL;
+    plan->rtwiddle_r = NULL;
+}
+
+
+static void
+native_pass2D(unsigned s, unsigned m, const double* xr, const double* xi,
+             double* yr, double* yi, const double* twr, const double* twi)
+{
+#ifdef FFT_X86
+    if (s >= VD4_WIDTH && FFT_HAS_AVX())
+    {
+        native_pass2_avxD(s, m, xr, xi, yr, yi, twr, twi);
+        return;
+    }
+#endif
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const double wr = twr[p];
+        const double wi = twi[p];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned out0 = s * 2 * p;
+        const unsigned out1 = out0 + s;
+        unsigned q = 0;
+#ifdef VD_WIDTH
+        const vdouble vwr = VD_SET1(wr);
+        const vdouble vwi = VD_SET1(wi);
+        for (; q + VD_WIDTH <= s; q += VD_WIDTH)
+        {
+            vdouble a0r = VD_LOAD(xr + in0 + q);
+            vdouble a0i = VD_LOAD(xi + in0 + q);
+            vdouble a1r = VD_LOAD(xr + in1 + q);
+            vdouble a1i = VD_LOAD(xi + in1 + q);
+            vdouble dr = VD_SUB(a0r, a1r);
+            vdouble di = VD_SUB(a0i, a1i);
+            VD_STORE(yr + out0 + q, VD_ADD(a0r, a1r));
+            VD_STORE(yi + out0 + q, VD_ADD(a0i, a1i));
+            VD_STORE(yr + out1 + q, VD_SUB(VD_MUL(dr, vwr), VD_MUL(di, vwi)));
+            VD_STORE(yi + out1 + q, VD_ADD(VD_MUL(dr, vwi), VD_MUL(di, vwr)));
         }
-    } else {
-        for (j = 0; j < l; j += 2) {
-            j1 = j + l;
-            x0r = a[j] - a[j1];
-            x0i = a[j + 1] - a[j1 + 1];
-            a[j] += a[j1];
-            a[j + 1] += a[j1 + 1];
-            a[j1] = x0r;
-            a[j1 + 1] = x0i;
+#endif
+        for (; q < s; ++q)
+        {
+            double a0r = xr[in0 + q];
+            double a0i = xi[in0 + q];
+            double a1r = xr[in1 + q];
+            double a1i = xi[in1 + q];
+            double dr = a0r - a1r;
+            double di = a0i - a1i;
+            yr[out0 + q] = a0r + a1r;
+            yi[out0 + q] = a0i + a1i;
+            yr[out1 + q] = dr * wr - di * wi;
+            yi[out1 + q] = dr * wi + di * wr;
+        }
+    }
+}
+
+
+#ifdef FFT_X86
+/* Radix-2 Stockham pass with AVX */
+__attribute__((target("avx,fma"))) static void
+native_pass2_avxD(unsigned s, unsigned m, const double* xr, const double* xi,
+                 double* yr, double* yi, const double* twr, const double* twi)
+{
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const double wr = twr[p];
+        const double wi = twi[p];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned out0 = s * 2 * p;
+        const unsigned out1 = out0 + s;
+        unsigned q = 0;
+        const vdouble4 vwr = VD4_SET1(wr);
+        const vdouble4 vwi = VD4_SET1(wi);
+        for (; q + VD4_WIDTH <= s; q += VD4_WIDTH)
+        {
+            vdouble4 a0r = VD4_LOAD(xr + in0 + q);
+            vdouble4 a0i = VD4_LOAD(xi + in0 + q);
+            vdouble4 a1r = VD4_LOAD(xr + in1 + q);
+            vdouble4 a1i = VD4_LOAD(xi + in1 + q);
+            vdouble4 dr = VD4_SUB(a0r, a1r);
+            vdouble4 di = VD4_SUB(a0i, a1i);
+            VD4_STORE(yr + out0 + q, VD4_ADD(a0r, a1r));
+            VD4_STORE(yi + out0 + q, VD4_ADD(a0i, a1i));
+            VD4_STORE(yr + out1 + q, VD4_SUB(VD4_MUL(dr, vwr), VD4_MUL(di, vwi)));
+            VD4_STORE(yi + out1 + q, VD4_ADD(VD4_MUL(dr, vwi), VD4_MUL(di, vwr)));
+        }
+        for (; q < s; ++q)
+        {
+            double a0r = xr[in0 + q];
+            double a0i = xi[in0 + q];
+            double a1r = xr[in1 + q];
+            double a1i = xi[in1 + q];
+            double dr = a0r - a1r;
+            double di = a0i - a1i;
+            yr[out0 + q] = a0r + a1r;
+            yi[out0 + q] = a0i + a1i;
+            yr[out1 + q] = dr * wr - di * wi;
+            yi[out1 + q] = dr * wi + di * wr;
         }
     }
 }
+#endif
 
 
 static void
-cftbsub(int n, double *a, double *w)
+native_pass4D(unsigned s, unsigned m, const double* xr, const double* xi,
+             double* yr, double* yi, const double* twr, const double* twi)
 {
-    void cft1st(int n, double *a, double *w);
-    void cftmdl(int n, int l, double *a, double *w);
-    int j, j1, j2, j3, l;
-    double x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+#ifdef FFT_X86
+    if (s >= VD4_WIDTH && FFT_HAS_AVX())
+    {
+        native_pass4_avxD(s, m, xr, xi, yr, yi, twr, twi);
+        return;
+    }
+#endif
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const double w1r = twr[3 * p];
+        const double w1i = twi[3 * p];
+        const double w2r = twr[3 * p + 1];
+        const double w2i = twi[3 * p + 1];
+        const double w3r = twr[3 * p + 2];
+        const double w3i = twi[3 * p + 2];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned in3 = s * (p + 3 * m);
+        const unsigned out0 = s * 4 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        const unsigned out3 = out2 + s;
+        unsigned q = 0;
+#ifdef VD_WIDTH
+        const vdouble vw1r = VD_SET1(w1r);
+        const vdouble vw1i = VD_SET1(w1i);
+        const vdouble vw2r = VD_SET1(w2r);
+        const vdouble vw2i = VD_SET1(w2i);
+        const vdouble vw3r = VD_SET1(w3r);
+        const vdouble vw3i = VD_SET1(w3i);
+        for (; q + VD_WIDTH <= s; q += VD_WIDTH)
+        {
+            vdouble a0r = VD_LOAD(xr + in0 + q);
+            vdouble a0i = VD_LOAD(xi + in0 + q);
+            vdouble a1r = VD_LOAD(xr + in1 + q);
+            vdouble a1i = VD_LOAD(xi + in1 + q);
+            vdouble a2r = VD_LOAD(xr + in2 + q);
+            vdouble a2i = VD_LOAD(xi + in2 + q);
+            vdouble a3r = VD_LOAD(xr + in3 + q);
+            vdouble a3i = VD_LOAD(xi + in3 + q);
+
+            vdouble t0r = VD_ADD(a0r, a2r);
+            vdouble t0i = VD_ADD(a0i, a2i);
+            vdouble t1r = VD_SUB(a0r, a2r);
+            vdouble t1i = VD_SUB(a0i, a2i);
+            vdouble t2r = VD_ADD(a1r, a3r);
+            vdouble t2i = VD_ADD(a1i, a3i);
+            vdouble t3r = VD_SUB(a1i, a3i);      // -i * (a1 - a3)
+            vdouble t3i = VD_SUB(a3r, a1r);
+
+            vdouble b1r = VD_ADD(t1r, t3r);
+            vdouble b1i = VD_ADD(t1i, t3i);
+            vdouble b2r = VD_SUB(t0r, t2r);
+            vdouble b2i = VD_SUB(t0i, t2i);
+            vdouble b3r = VD_SUB(t1r, t3r);
+            vdouble b3i = VD_SUB(t1i, t3i);
+
+            VD_STORE(yr + out0 + q, VD_ADD(t0r, t2r));
+            VD_STORE(yi + out0 + q, VD_ADD(t0i, t2i));
+            VD_STORE(yr + out1 + q, VD_SUB(VD_MUL(b1r, vw1r), VD_MUL(b1i, vw1i)));
+            VD_STORE(yi + out1 + q, VD_ADD(VD_MUL(b1r, vw1i), VD_MUL(b1i, vw1r)));
+            VD_STORE(yr + out2 + q, VD_SUB(VD_MUL(b2r, vw2r), VD_MUL(b2i, vw2i)));
+            VD_STORE(yi + out2 + q, VD_ADD(VD_MUL(b2r, vw2i), VD_MUL(b2i, vw2r)));
+            VD_STORE(yr + out3 + q, VD_SUB(VD_MUL(b3r, vw3r), VD_MUL(b3i, vw3i)));
+            VD_STORE(yi + out3 + q, VD_ADD(VD_MUL(b3r, vw3i), VD_MUL(b3i, vw3r)));
+        }
+#endif
+        for (; q < s; ++q)
+        {
+            double a0r = xr[in0 + q];
+            double a0i = xi[in0 + q];
+            double a1r = xr[in1 + q];
+            double a1i = xi[in1 + q];
+            double a2r = xr[in2 + q];
+            double a2i = xi[in2 + q];
+            double a3r = xr[in3 + q];
+            double a3i = xi[in3 + q];
+
+            double t0r = a0r + a2r;
+            double t0i = a0i + a2i;
+            double t1r = a0r - a2r;
+            double t1i = a0i - a2i;
+            double t2r = a1r + a3r;
+            double t2i = a1i + a3i;
+            double t3r = a1i - a3i;
+            double t3i = a3r - a1r;
+
+            double b1r = t1r + t3r;
+            double b1i = t1i + t3i;
+            double b2r = t0r - t2r;
+            double b2i = t0i - t2i;
+            double b3r = t1r - t3r;
+            double b3i = t1i - t3i;
+
+            yr[out0 + q] = t0r + t2r;
+            yi[out0 + q] = t0i + t2i;
+            yr[out1 + q] = b1r * w1r - b1i * w1i;
+            yi[out1 + q] = b1r * w1i + b1i * w1r;
+            yr[out2 + q] = b2r * w2r - b2i * w2i;
+            yi[out2 + q] = b2r * w2i + b2i * w2r;
+            yr[out3 + q] = b3r * w3r - b3i * w3i;
+            yi[out3 + q] = b3r * w3i + b3i * w3r;
+        }
+    }
+}
 
-    l = 2;
-    if (n > 8) {
-        cft1st(n, a, w);
-        l = 8;
-        while ((l << 2) < n) {
-            cftmdl(n, l, a, w);
-            l <<= 2;
+
+#ifdef FFT_X86
+/* Radix-4 Stockham pass with AVX */
+__attribute__((target("avx,fma"))) static void
+native_pass4_avxD(unsigned s, unsigned m, const double* xr, const double* xi,
+                 double* yr, double* yi, const double* twr, const double* twi)
+{
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const double w1r = twr[3 * p];
+        const double w1i = twi[3 * p];
+        const double w2r = twr[3 * p + 1];
+        const double w2i = twi[3 * p + 1];
+        const double w3r = twr[3 * p + 2];
+        const double w3i = twi[3 * p + 2];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned in3 = s * (p + 3 * m);
+        const unsigned out0 = s * 4 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        const unsigned out3 = out2 + s;
+        unsigned q = 0;
+        const vdouble4 vw1r = VD4_SET1(w1r);
+        const vdouble4 vw1i = VD4_SET1(w1i);
+        const vdouble4 vw2r = VD4_SET1(w2r);
+        const vdouble4 vw2i = VD4_SET1(w2i);
+        const vdouble4 vw3r = VD4_SET1(w3r);
+        const vdouble4 vw3i = VD4_SET1(w3i);
+        for (; q + VD4_WIDTH <= s; q += VD4_WIDTH)
+        {
+            vdouble4 a0r = VD4_LOAD(xr + in0 + q);
+            vdouble4 a0i = VD4_LOAD(xi + in0 + q);
+            vdouble4 a1r = VD4_LOAD(xr + in1 + q);
+            vdouble4 a1i = VD4_LOAD(xi + in1 + q);
+            vdouble4 a2r = VD4_LOAD(xr + in2 + q);
+            vdouble4 a2i = VD4_LOAD(xi + in2 + q);
+            vdouble4 a3r = VD4_LOAD(xr + in3 + q);
+            vdouble4 a3i = VD4_LOAD(xi + in3 + q);
+
+            vdouble4 t0r = VD4_ADD(a0r, a2r);
+            vdouble4 t0i = VD4_ADD(a0i, a2i);
+            vdouble4 t1r = VD4_SUB(a0r, a2r);
+            vdouble4 t1i = VD4_SUB(a0i, a2i);
+            vdouble4 t2r = VD4_ADD(a1r, a3r);
+            vdouble4 t2i = VD4_ADD(a1i, a3i);
+            vdouble4 t3r = VD4_SUB(a1i, a3i);      // -i * (a1 - a3)
+            vdouble4 t3i = VD4_SUB(a3r, a1r);
+
+            vdouble4 b1r = VD4_ADD(t1r, t3r);
+            vdouble4 b1i = VD4_ADD(t1i, t3i);
+            vdouble4 b2r = VD4_SUB(t0r, t2r);
+            vdouble4 b2i = VD4_SUB(t0i, t2i);
+            vdouble4 b3r = VD4_SUB(t1r, t3r);
+            vdouble4 b3i = VD4_SUB(t1i, t3i);
+
+            VD4_STORE(yr + out0 + q, VD4_ADD(t0r, t2r));
+            VD4_STORE(yi + out0 + q, VD4_ADD(t0i, t2i));
+            VD4_STORE(yr + out1 + q, VD4_SUB(VD4_MUL(b1r, vw1r), VD4_MUL(b1i, vw1i)));
+            VD4_STORE(yi + out1 + q, VD4_ADD(VD4_MUL(b1r, vw1i), VD4_MUL(b1i, vw1r)));
+            VD4_STORE(yr + out2 + q, VD4_SUB(VD4_MUL(b2r, vw2r), VD4_MUL(b2i, vw2i)));
+            VD4_STORE(yi + out2 + q, VD4_ADD(VD4_MUL(b2r, vw2i), VD4_MUL(b2i, vw2r)));
+            VD4_STORE(yr + out3 + q, VD4_SUB(VD4_MUL(b3r, vw3r), VD4_MUL(b3i, vw3i)));
+            VD4_STORE(yi + out3 + q, VD4_ADD(VD4_MUL(b3r, vw3i), VD4_MUL(b3i, vw3r)));
+        }
+        for (; q < s; ++q)
+        {
+            double a0r = xr[in0 + q];
+            double a0i = xi[in0 + q];
+            double a1r = xr[in1 + q];
+            double a1i = xi[in1 + q];
+            double a2r = xr[in2 + q];
+            double a2i = xi[in2 + q];
+            double a3r = xr[in3 + q];
+            double a3i = xi[in3 + q];
+
+            double t0r = a0r + a2r;
+            double t0i = a0i + a2i;
+            double t1r = a0r - a2r;
+            double t1i = a0i - a2i;
+            double t2r = a1r + a3r;
+            double t2i = a1i + a3i;
+            double t3r = a1i - a3i;
+            double t3i = a3r - a1r;
+
+            double b1r = t1r + t3r;
+            double b1i = t1i + t3i;
+            double b2r = t0r - t2r;
+            double b2i = t0i - t2i;
+            double b3r = t1r - t3r;
+            double b3i = t1i - t3i;
+
+            yr[out0 + q] = t0r + t2r;
+            yi[out0 + q] = t0i + t2i;
+            yr[out1 + q] = b1r * w1r - b1i * w1i;
+            yi[out1 + q] = b1r * w1i + b1i * w1r;
+            yr[out2 + q] = b2r * w2r - b2i * w2i;
+            yi[out2 + q] = b2r * w2i + b2i * w2r;
+            yr[out3 + q] = b3r * w3r - b3i * w3i;
+            yi[out3 + q] = b3r * w3i + b3i * w3r;
         }
     }
-    if ((l << 2) == n) {
-        for (j = 0; j < l; j += 2) {
-            j1 = j + l;
-            j2 = j1 + l;
-            j3 = j2 + l;
-            x0r = a[j] + a[j1];
-            x0i = -a[j + 1] - a[j1 + 1];
-            x1r = a[j] - a[j1];
-            x1i = -a[j + 1] + a[j1 + 1];
-            x2r = a[j2] + a[j3];
-            x2i = a[j2 + 1] + a[j3 + 1];
-            x3r = a[j2] - a[j3];
-            x3i = a[j2 + 1] - a[j3 + 1];
-            a[j] = x0r + x2r;
-            a[j + 1] = x0i - x2i;
-            a[j2] = x0r - x2r;
-            a[j2 + 1] = x0i + x2i;
-            a[j1] = x1r - x3i;
-            a[j1 + 1] = x1i - x3r;
-            a[j3] = x1r + x3i;
-            a[j3 + 1] = x1i + x3r;
+}
+#endif
+
+
+static void
+native_pass3D(unsigned s, unsigned m, const double* xr, const double* xi,
+             double* yr, double* yi, const double* twr, const double* twi)
+{
+#ifdef FFT_X86
+    if (s >= VD4_WIDTH && FFT_HAS_AVX())
+    {
+        native_pass3_avxD(s, m, xr, xi, yr, yi, twr, twi);
+        return;
+    }
+#endif
+    const double c1 = -0.5;                              // cos(2pi/3)
+    const double s1 = 0.86602540378443864676;            // sin(2pi/3)
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const double w1r = twr[2 * p];
+        const double w1i = twi[2 * p];
+        const double w2r = twr[2 * p + 1];
+        const double w2i = twi[2 * p + 1];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned out0 = s * 3 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        unsigned q = 0;
+#ifdef VD_WIDTH
+        const vdouble vc1 = VD_SET1(c1);
+        const vdouble vs1 = VD_SET1(s1);
+        const vdouble vw1r = VD_SET1(w1r);
+        const vdouble vw1i = VD_SET1(w1i);
+        const vdouble vw2r = VD_SET1(w2r);
+        const vdouble vw2i = VD_SET1(w2i);
+        for (; q + VD_WIDTH <= s; q += VD_WIDTH)
+        {
+            vdouble a0r = VD_LOAD(xr + in0 + q);
+            vdouble a0i = VD_LOAD(xi + in0 + q);
+            vdouble a1r = VD_LOAD(xr + in1 + q);
+            vdouble a1i = VD_LOAD(xi + in1 + q);
+            vdouble a2r = VD_LOAD(xr + in2 + q);
+            vdouble a2i = VD_LOAD(xi + in2 + q);
+
+            vdouble t1r = VD_ADD(a1r, a2r);
+            vdouble t1i = VD_ADD(a1i, a2i);
+            vdouble t2r = VD_ADD(a0r, VD_MUL(vc1, t1r));
+            vdouble t2i = VD_ADD(a0i, VD_MUL(vc1, t1i));
+            vdouble t3r = VD_MUL(vs1, VD_SUB(a1r, a2r));
+            vdouble t3i = VD_MUL(vs1, VD_SUB(a1i, a2i));
+
+            vdouble b1r = VD_ADD(t2r, t3i);      // t2 - i * t3
+            vdouble b1i = VD_SUB(t2i, t3r);
+            vdouble b2r = VD_SUB(t2r, t3i);      // t2 + i * t3
+            vdouble b2i = VD_ADD(t2i, t3r);
+
+            VD_STORE(yr + out0 + q, VD_ADD(a0r, t1r));
+            VD_STORE(yi + out0 + q, VD_ADD(a0i, t1i));
+            VD_STORE(yr + out1 + q, VD_SUB(VD_MUL(b1r, vw1r), VD_MUL(b1i, vw1i)));
+            VD_STORE(yi + out1 + q, VD_ADD(VD_MUL(b1r, vw1i), VD_MUL(b1i, vw1r)));
+            VD_STORE(yr + out2 + q, VD_SUB(VD_MUL(b2r, vw2r), VD_MUL(b2i, vw2i)));
+            VD_STORE(yi + out2 + q, VD_ADD(VD_MUL(b2r, vw2i), VD_MUL(b2i, vw2r)));
         }
-    } else {
-        for (j = 0; j < l; j += 2) {
-            j1 = j + l;
-            x0r = a[j] - a[j1];
-            x0i = -a[j + 1] + a[j1 + 1];
-            a[j] += a[j1];
-            a[j + 1] = -a[j + 1] - a[j1 + 1];
-            a[j1] = x0r;
-            a[j1 + 1] = x0i;
+#endif
+        for (; q < s; ++q)
+        {
+            double a0r = xr[in0 + q];
+            double a0i = xi[in0 + q];
+            double a1r = xr[in1 + q];
+            double a1i = xi[in1 + q];
+            double a2r = xr[in2 + q];
+            double a2i = xi[in2 + q];
+
+            double t1r = a1r + a2r;
+            double t1i = a1i + a2i;
+            double t2r = a0r + c1 * t1r;
+            double t2i = a0i + c1 * t1i;
+            double t3r = s1 * (a1r - a2r);
+            double t3i = s1 * (a1i - a2i);
+
+            double b1r = t2r + t3i;
+            double b1i = t2i - t3r;
+            double b2r = t2r - t3i;
+            double b2i = t2i + t3r;
+
+            yr[out0 + q] = a0r + t1r;
+            yi[out0 + q] = a0i + t1i;
+            yr[out1 + q] = b1r * w1r - b1i * w1i;
+            yi[out1 + q] = b1r * w1i + b1i * w1r;
+            yr[out2 + q] = b2r * w2r - b2i * w2i;
+            yi[out2 + q] = b2r * w2i + b2i * w2r;
         }
     }
 }
 
 
+#ifdef FFT_X86
+/* Radix-3 Stockham pass with AVX */
+__attribute__((target("avx,fma"))) static void
+native_pass3_avxD(unsigned s, unsigned m, const double* xr, const double* xi,
+                 double* yr, double* yi, const double* twr, const double* twi)
+{
+    const double c1 = -0.5;                              // cos(2pi/3)
+    const double s1 = 0.86602540378443864676;            // sin(2pi/3)
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const double w1r = twr[2 * p];
+        const double w1i = twi[2 * p];
+        const double w2r = twr[2 * p + 1];
+        const double w2i = twi[2 * p + 1];
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned out0 = s * 3 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        unsigned q = 0;
+        const vdouble4 vc1 = VD4_SET1(c1);
+        const vdouble4 vs1 = VD4_SET1(s1);
+        const vdouble4 vw1r = VD4_SET1(w1r);
+        const vdouble4 vw1i = VD4_SET1(w1i);
+        const vdouble4 vw2r = VD4_SET1(w2r);
+        const vdouble4 vw2i = VD4_SET1(w2i);
+        for (; q + VD4_WIDTH <= s; q += VD4_WIDTH)
+        {
+            vdouble4 a0r = VD4_LOAD(xr + in0 + q);
+            vdouble4 a0i = VD4_LOAD(xi + in0 + q);
+            vdouble4 a1r = VD4_LOAD(xr + in1 + q);
+            vdouble4 a1i = VD4_LOAD(xi + in1 + q);
+            vdouble4 a2r = VD4_LOAD(xr + in2 + q);
+            vdouble4 a2i = VD4_LOAD(xi + in2 + q);
+
+            vdouble4 t1r = VD4_ADD(a1r, a2r);
+            vdouble4 t1i = VD4_ADD(a1i, a2i);
+            vdouble4 t2r = VD4_ADD(a0r, VD4_MUL(vc1, t1r));
+            vdouble4 t2i = VD4_ADD(a0i, VD4_MUL(vc1, t1i));
+            vdouble4 t3r = VD4_MUL(vs1, VD4_SUB(a1r, a2r));
+            vdouble4 t3i = VD4_MUL(vs1, VD4_SUB(a1i, a2i));
+
+            vdouble4 b1r = VD4_ADD(t2r, t3i);      // t2 - i * t3
+            vdouble4 b1i = VD4_SUB(t2i, t3r);
+            vdouble4 b2r = VD4_SUB(t2r, t3i);      // t2 + i * t3
+            vdouble4 b2i = VD4_ADD(t2i, t3r);
+
+            VD4_STORE(yr + out0 + q, VD4_ADD(a0r, t1r));
+            VD4_STORE(yi + out0 + q, VD4_ADD(a0i, t1i));
+            VD4_STORE(yr + out1 + q, VD4_SUB(VD4_MUL(b1r, vw1r), VD4_MUL(b1i, vw1i)));
+            VD4_STORE(yi + out1 + q, VD4_ADD(VD4_MUL(b1r, vw1i), VD4_MUL(b1i, vw1r)));
+            VD4_STORE(yr + out2 + q, VD4_SUB(VD4_MUL(b2r, vw2r), VD4_MUL(b2i, vw2i)));
+            VD4_STORE(yi + out2 + q, VD4_ADD(VD4_MUL(b2r, vw2i), VD4_MUL(b2i, vw2r)));
+        }
+        for (; q < s; ++q)
+        {
+            double a0r = xr[in0 + q];
+            double a0i = xi[in0 + q];
+            double a1r = xr[in1 + q];
+            double a1i = xi[in1 + q];
+            double a2r = xr[in2 + q];
+            double a2i = xi[in2 + q];
+
+            double t1r = a1r + a2r;
+            double t1i = a1i + a2i;
+            double t2r = a0r + c1 * t1r;
+            double t2i = a0i + c1 * t1i;
+            double t3r = s1 * (a1r - a2r);
+            double t3i = s1 * (a1i - a2i);
+
+            double b1r = t2r + t3i;
+            double b1i = t2i - t3r;
+            double b2r = t2r - t3i;
+            double b2i = t2i + t3r;
+
+            yr[out0 + q] = a0r + t1r;
+            yi[out0 + q] = a0i + t1i;
+            yr[out1 + q] = b1r * w1r - b1i * w1i;
+            yi[out1 + q] = b1r * w1i + b1i * w1r;
+            yr[out2 + q] = b2r * w2r - b2i * w2i;
+            yi[out2 + q] = b2r * w2i + b2i * w2r;
+        }
+    }
+}
+#endif
+
+
 static void
-cft1st(int n, double *a, double *w)
+native_pass5D(unsigned s, unsigned m, const double* xr, const double* xi,
+             double* yr, double* yi, const double* twr, const double* twi)
 {
-    int j, k1, k2;
-    double wk1r, wk1i, wk2r, wk2i, wk3r, wk3i;
-    double x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+#ifdef FFT_X86
+    if (s >= VD4_WIDTH && FFT_HAS_AVX())
+    {
+        native_pass5_avxD(s, m, xr, xi, yr, yi, twr, twi);
+        return;
+    }
+#endif
+    const double c1 = 0.30901699437494742410;            // cos(2pi/5)
+    const double c2 = -0.80901699437494742410;           // cos(4pi/5)
+    const double s1 = 0.95105651629515357212;            // sin(2pi/5)
+    const double s2 = 0.58778525229247312917;            // sin(4pi/5)
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const double* wr = twr + 4 * p;
+        const double* wi = twi + 4 * p;
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned in3 = s * (p + 3 * m);
+        const unsigned in4 = s * (p + 4 * m);
+        const unsigned out0 = s * 5 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        const unsigned out3 = out2 + s;
+        const unsigned out4 = out3 + s;
+        unsigned q = 0;
+#ifdef VD_WIDTH
+        const vdouble vc1 = VD_SET1(c1);
+        const vdouble vc2 = VD_SET1(c2);
+        const vdouble vs1 = VD_SET1(s1);
+        const vdouble vs2 = VD_SET1(s2);
+        const vdouble vw1r = VD_SET1(wr[0]);
+        const vdouble vw1i = VD_SET1(wi[0]);
+        const vdouble vw2r = VD_SET1(wr[1]);
+        const vdouble vw2i = VD_SET1(wi[1]);
+        const vdouble vw3r = VD_SET1(wr[2]);
+        const vdouble vw3i = VD_SET1(wi[2]);
+        const vdouble vw4r = VD_SET1(wr[3]);
+        const vdouble vw4i = VD_SET1(wi[3]);
+        for (; q + VD_WIDTH <= s; q += VD_WIDTH)
+        {
+            vdouble a0r = VD_LOAD(xr + in0 + q);
+            vdouble a0i = VD_LOAD(xi + in0 + q);
+            vdouble a1r = VD_LOAD(xr + in1 + q);
+            vdouble a1i = VD_LOAD(xi + in1 + q);
+            vdouble a2r = VD_LOAD(xr + in2 + q);
+            vdouble a2i = VD_LOAD(xi + in2 + q);
+            vdouble a3r = VD_LOAD(xr + in3 + q);
+            vdouble a3i = VD_LOAD(xi + in3 + q);
+            vdouble a4r = VD_LOAD(xr + in4 + q);
+            vdouble a4i = VD_LOAD(xi + in4 + q);
+
+            vdouble t1r = VD_ADD(a1r, a4r);
+            vdouble t1i = VD_ADD(a1i, a4i);
+            vdouble t2r = VD_ADD(a2r, a3r);
+            vdouble t2i = VD_ADD(a2i, a3i);
+            vdouble d1r = VD_SUB(a1r, a4r);
+            vdouble d1i = VD_SUB(a1i, a4i);
+            vdouble d2r = VD_SUB(a2r, a3r);
+            vdouble d2i = VD_SUB(a2i, a3i);
+
+            vdouble e1r = VD_ADD(a0r, VD_ADD(VD_MUL(vc1, t1r), VD_MUL(vc2, t2r)));
+            vdouble e1i = VD_ADD(a0i, VD_ADD(VD_MUL(vc1, t1i), VD_MUL(vc2, t2i)));
+            vdouble e2r = VD_ADD(a0r, VD_ADD(VD_MUL(vc2, t1r), VD_MUL(vc1, t2r)));
+            vdouble e2i = VD_ADD(a0i, VD_ADD(VD_MUL(vc2, t1i), VD_MUL(vc1, t2i)));
+            vdouble o1r = VD_ADD(VD_MUL(vs1, d1r), VD_MUL(vs2, d2r));
+            vdouble o1i = VD_ADD(VD_MUL(vs1, d1i), VD_MUL(vs2, d2i));
+            vdouble o2r = VD_SUB(VD_MUL(vs2, d1r), VD_MUL(vs1, d2r));
+            vdouble o2i = VD_SUB(VD_MUL(vs2, d1i), VD_MUL(vs1, d2i));
+
+            vdouble b1r = VD_ADD(e1r, o1i);      // e1 - i * o1
+            vdouble b1i = VD_SUB(e1i, o1r);
+            vdouble b4r = VD_SUB(e1r, o1i);      // e1 + i * o1
+            vdouble b4i = VD_ADD(e1i, o1r);
+            vdouble b2r = VD_ADD(e2r, o2i);      // e2 - i * o2
+            vdouble b2i = VD_SUB(e2i, o2r);
+            vdouble b3r = VD_SUB(e2r, o2i);      // e2 + i * o2
+            vdouble b3i = VD_ADD(e2i, o2r);
+
+            VD_STORE(yr + out0 + q, VD_ADD(a0r, VD_ADD(t1r, t2r)));
+            VD_STORE(yi + out0 + q, VD_ADD(a0i, VD_ADD(t1i, t2i)));
+            VD_STORE(yr + out1 + q, VD_SUB(VD_MUL(b1r, vw1r), VD_MUL(b1i, vw1i)));
+            VD_STORE(yi + out1 + q, VD_ADD(VD_MUL(b1r, vw1i), VD_MUL(b1i, vw1r)));
+            VD_STORE(yr + out2 + q, VD_SUB(VD_MUL(b2r, vw2r), VD_MUL(b2i, vw2i)));
+            VD_STORE(yi + out2 + q, VD_ADD(VD_MUL(b2r, vw2i), VD_MUL(b2i, vw2r)));
+            VD_STORE(yr + out3 + q, VD_SUB(VD_MUL(b3r, vw3r), VD_MUL(b3i, vw3i)));
+            VD_STORE(yi + out3 + q, VD_ADD(VD_MUL(b3r, vw3i), VD_MUL(b3i, vw3r)));
+            VD_STORE(yr + out4 + q, VD_SUB(VD_MUL(b4r, vw4r), VD_MUL(b4i, vw4i)));
+            VD_STORE(yi + out4 + q, VD_ADD(VD_MUL(b4r, vw4i), VD_MUL(b4i, vw4r)));
+        }
+#endif
+        for (; q < s; ++q)
+        {
+            double a0r = xr[in0 + q];
+            double a0i = xi[in0 + q];
+            double a1r = xr[in1 + q];
+            double a1i = xi[in1 + q];
+            double a2r = xr[in2 + q];
+            double a2i = xi[in2 + q];
+            double a3r = xr[in3 + q];
+            double a3i = xi[in3 + q];
+            double a4r = xr[in4 + q];
+            double a4i = xi[in4 + q];
+
+            double t1r = a1r + a4r;
+            double t1i = a1i + a4i;
+            double t2r = a2r + a3r;
+            double t2i = a2i + a3i;
+            double d1r = a1r - a4r;
+            double d1i = a1i - a4i;
+            double d2r = a2r - a3r;
+            double d2i = a2i - a3i;
+
+            double e1r = a0r + c1 * t1r + c2 * t2r;
+            double e1i = a0i + c1 * t1i + c2 * t2i;
+            double e2r = a0r + c2 * t1r + c1 * t2r;
+            double e2i = a0i + c2 * t1i + c1 * t2i;
+            double o1r = s1 * d1r + s2 * d2r;
+            double o1i = s1 * d1i + s2 * d2i;
+            double o2r = s2 * d1r - s1 * d2r;
+            double o2i = s2 * d1i - s1 * d2i;
+
+            double b1r = e1r + o1i;
+            double b1i = e1i - o1r;
+            double b4r = e1r - o1i;
+            double b4i = e1i + o1r;
+            double b2r = e2r + o2i;
+            double b2i = e2i - o2r;
+            double b3r = e2r - o2i;
+            double b3i = e2i + o2r;
+
+            yr[out0 + q] = a0r + t1r + t2r;
+            yi[out0 + q] = a0i + t1i + t2i;
+            yr[out1 + q] = b1r * wr[0] - b1i * wi[0];
+            yi[out1 + q] = b1r * wi[0] + b1i * wr[0];
+            yr[out2 + q] = b2r * wr[1] - b2i * wi[1];
+            yi[out2 + q] = b2r * wi[1] + b2i * wr[1];
+            yr[out3 + q] = b3r * wr[2] - b3i * wi[2];
+            yi[out3 + q] = b3r * wi[2] + b3i * wr[2];
+            yr[out4 + q] = b4r * wr[3] - b4i * wi[3];
+            yi[out4 + q] = b4r * wi[3] + b4i * wr[3];
+        }
+    }
+}
 
-    x0r = a[0] + a[2];
-    x0i = a[1] + a[3];
-    x1r = a[0] - a[2];
-    x1i = a[1] - a[3];
-    x2r = a[4] + a[6];
-    x2i = a[5] + a[7];
-    x3r = a[4] - a[6];
-    x3i = a[5] - a[7];
-    a[0] = x0r + x2r;
-    a[1] = x0i + x2i;
-    a[4] = x0r - x2r;
-    a[5] = x0i - x2i;
-    a[2] = x1r - x3i;
-    a[3] = x1i + x3r;
-    a[6] = x1r + x3i;
-    a[7] = x1i - x3r;
-    wk1r = w[2];
-    x0r = a[8] + a[10];
-    x0i = a[9] + a[11];
-    x1r = a[8] - a[10];
-    x1i = a[9] - a[11];
-    x2r = a[12] + a[14];
-    x2i = a[13] + a[15];
-    x3r = a[12] - a[14];
-    x3i = a[13] - a[15];
-    a[8] = x0r + x2r;
-    a[9] = x0i + x2i;
-    a[12] = x2i - x0i;
-    a[13] = x0r - x2r;
-    x0r = x1r - x3i;
-    x0i = x1i + x3r;
-    a[10] = wk1r * (x0r - x0i);
-    a[11] = wk1r * (x0r + x0i);
-    x0r = x3i + x1r;
-    x0i = x3r - x1i;
-    a[14] = wk1r * (x0i - x0r);
-    a[15] = wk1r * (x0i + x0r);
-    k1 = 0;
-    for (j = 16; j < n; j += 16) {
-        k1 += 2;
-        k2 = 2 * k1;
-        wk2r = w[k1];
-        wk2i = w[k1 + 1];
-        wk1r = w[k2];
-        wk1i = w[k2 + 1];
-        wk3r = wk1r - 2 * wk2i * wk1i;
-        wk3i = 2 * wk2i * wk1r - wk1i;
-        x0r = a[j] + a[j + 2];
-        x0i = a[j + 1] + a[j + 3];
-        x1r = a[j] - a[j + 2];
-        x1i = a[j + 1] - a[j + 3];
-        x2r = a[j + 4] + a[j + 6];
-        x2i = a[j + 5] + a[j + 7];
-        x3r = a[j + 4] - a[j + 6];
-        x3i = a[j + 5] - a[j + 7];
-        a[j] = x0r + x2r;
-        a[j + 1] = x0i + x2i;
-        x0r -= x2r;
-        x0i -= x2i;
-        a[j + 4] = wk2r * x0r - wk2i * x0i;
-        a[j + 5] = wk2r * x0i + wk2i * x0r;
-        x0r = x1r - x3i;
-        x0i = x1i + x3r;
-        a[j + 2] = wk1r * x0r - wk1i * x0i;
-        a[j + 3] = wk1r * x0i + wk1i * x0r;
-        x0r = x1r + x3i;
-        x0i = x1i - x3r;
-        a[j + 6] = wk3r * x0r - wk3i * x0i;
-        a[j + 7] = wk3r * x0i + wk3i * x0r;
-        wk1r = w[k2 + 2];
-        wk1i = w[k2 + 3];
-        wk3r = wk1r - 2 * wk2r * wk1i;
-        wk3i = 2 * wk2r * wk1r - wk1i;
-        x0r = a[j + 8] + a[j + 10];
-        x0i = a[j + 9] + a[j + 11];
-        x1r = a[j + 8] - a[j + 10];
-        x1i = a[j + 9] - a[j + 11];
-        x2r = a[j + 12] + a[j + 14];
-        x2i = a[j + 13] + a[j + 15];
-        x3r = a[j + 12] - a[j + 14];
-        x3i = a[j + 13] - a[j + 15];
-        a[j + 8] = x0r + x2r;
-        a[j + 9] = x0i + x2i;
-        x0r -= x2r;
-        x0i -= x2i;
-        a[j + 12] = -wk2i * x0r - wk2r * x0i;
-        a[j + 13] = -wk2i * x0i + wk2r * x0r;
-        x0r = x1r - x3i;
-        x0i = x1i + x3r;
-        a[j + 10] = wk1r * x0r - wk1i * x0i;
-        a[j + 11] = wk1r * x0i + wk1i * x0r;
-        x0r = x1r + x3i;
-        x0i = x1i - x3r;
-        a[j + 14] = wk3r * x0r - wk3i * x0i;
-        a[j + 15] = wk3r * x0i + wk3i * x0r;
+
+#ifdef FFT_X86
+/* Radix-5 Stockham pass with AVX */
+__attribute__((target("avx,fma"))) static void
+native_pass5_avxD(unsigned s, unsigned m, const double* xr, const double* xi,
+                 double* yr, double* yi, const double* twr, const double* twi)
+{
+    const double c1 = 0.30901699437494742410;            // cos(2pi/5)
+    const double c2 = -0.80901699437494742410;           // cos(4pi/5)
+    const double s1 = 0.95105651629515357212;            // sin(2pi/5)
+    const double s2 = 0.58778525229247312917;            // sin(4pi/5)
+    for (unsigned p = 0; p < m; ++p)
+    {
+        const double* wr = twr + 4 * p;
+        const double* wi = twi + 4 * p;
+        const unsigned in0 = s * p;
+        const unsigned in1 = s * (p + m);
+        const unsigned in2 = s * (p + 2 * m);
+        const unsigned in3 = s * (p + 3 * m);
+        const unsigned in4 = s * (p + 4 * m);
+        const unsigned out0 = s * 5 * p;
+        const unsigned out1 = out0 + s;
+        const unsigned out2 = out1 + s;
+        const unsigned out3 = out2 + s;
+        const unsigned out4 = out3 + s;
+        unsigned q = 0;
+        const vdouble4 vc1 = VD4_SET1(c1);
+        const vdouble4 vc2 = VD4_SET1(c2);
+        const vdouble4 vs1 = VD4_SET1(s1);
+        const vdouble4 vs2 = VD4_SET1(s2);
+        const vdouble4 vw1r = VD4_SET1(wr[0]);
+        const vdouble4 vw1i = VD4_SET1(wi[0]);
+        const vdouble4 vw2r = VD4_SET1(wr[1]);
+        const vdouble4 vw2i = VD4_SET1(wi[1]);
+        const vdouble4 vw3r = VD4_SET1(wr[2]);
+        const vdouble4 vw3i = VD4_SET1(wi[2]);
+        const vdouble4 vw4r = VD4_SET1(wr[3]);
+        const vdouble4 vw4i = VD4_SET1(wi[3]);
+        for (; q + VD4_WIDTH <= s; q += VD4_WIDTH)
+        {
+            vdouble4 a0r = VD4_LOAD(xr + in0 + q);
+            vdouble4 a0i = VD4_LOAD(xi + in0 + q);
+            vdouble4 a1r = VD4_LOAD(xr + in1 + q);
+            vdouble4 a1i = VD4_LOAD(xi + in1 + q);
+            vdouble4 a2r = VD4_LOAD(xr + in2 + q);
+            vdouble4 a2i = VD4_LOAD(xi + in2 + q);
+            vdouble4 a3r = VD4_LOAD(xr + in3 + q);
+            vdouble4 a3i = VD4_LOAD(xi + in3 + q);
+            vdouble4 a4r = VD4_LOAD(xr + in4 + q);
+            vdouble4 a4i = VD4_LOAD(xi + in4 + q);
+
+            vdouble4 t1r = VD4_ADD(a1r, a4r);
+            vdouble4 t1i = VD4_ADD(a1i, a4i);
+            vdouble4 t2r = VD4_ADD(a2r, a3r);
+            vdouble4 t2i = VD4_ADD(a2i, a3i);
+            vdouble4 d1r = VD4_SUB(a1r, a4r);
+            vdouble4 d1i = VD4_SUB(a1i, a4i);
+            vdouble4 d2r = VD4_SUB(a2r, a3r);
+            vdouble4 d2i = VD4_SUB(a2i, a3i);
+
+            vdouble4 e1r = VD4_ADD(a0r, VD4_ADD(VD4_MUL(vc1, t1r), VD4_MUL(vc2, t2r)));
+            vdouble4 e1i = VD4_ADD(a0i, VD4_ADD(VD4_MUL(vc1, t1i), VD4_MUL(vc2, t2i)));
+            vdouble4 e2r = VD4_ADD(a0r, VD4_ADD(VD4_MUL(vc2, t1r), VD4_MUL(vc1, t2r)));
+            vdouble4 e2i = VD4_ADD(a0i, VD4_ADD(VD4_MUL(vc2, t1i), VD4_MUL(vc1, t2i)));
+            vdouble4 o1r = VD4_ADD(VD4_MUL(vs1, d1r), VD4_MUL(vs2, d2r));
+            vdouble4 o1i = VD4_ADD(VD4_MUL(vs1, d1i), VD4_MUL(vs2, d2i));
+            vdouble4 o2r = VD4_SUB(VD4_MUL(vs2, d1r), VD4_MUL(vs1, d2r));
+            vdouble4 o2i = VD4_SUB(VD4_MUL(vs2, d1i), VD4_MUL(vs1, d2i));
+
+            vdouble4 b1r = VD4_ADD(e1r, o1i);      // e1 - i * o1
+            vdouble4 b1i = VD4_SUB(e1i, o1r);
+            vdouble4 b4r = VD4_SUB(e1r, o1i);      // e1 + i * o1
+            vdouble4 b4i = VD4_ADD(e1i, o1r);
+            vdouble4 b2r = VD4_ADD(e2r, o2i);      // e2 - i * o2
+            vdouble4 b2i = VD4_SUB(e2i, o2r);
+            vdouble4 b3r = VD4_SUB(e2r, o2i);      // e2 + i * o2
+            vdouble4 b3i = VD4_ADD(e2i, o2r);
+
+            VD4_STORE(yr + out0 + q, VD4_ADD(a0r, VD4_ADD(t1r, t2r)));
+            VD4_STORE(yi + out0 + q, VD4_ADD(a0i, VD4_ADD(t1i, t2i)));
+            VD4_STORE(yr + out1 + q, VD4_SUB(VD4_MUL(b1r, vw1r), VD4_MUL(b1i, vw1i)));
+            VD4_STORE(yi + out1 + q, VD4_ADD(VD4_MUL(b1r, vw1i), VD4_MUL(b1i, vw1r)));
+            VD4_STORE(yr + out2 + q, VD4_SUB(VD4_MUL(b2r, vw2r), VD4_MUL(b2i, vw2i)));
+            VD4_STORE(yi + out2 + q, VD4_ADD(VD4_MUL(b2r, vw2i), VD4_MUL(b2i, vw2r)));
+            VD4_STORE(yr + out3 + q, VD4_SUB(VD4_MUL(b3r, vw3r), VD4_MUL(b3i, vw3i)));
+            VD4_STORE(yi + out3 + q, VD4_ADD(VD4_MUL(b3r, vw3i), VD4_MUL(b3i, vw3r)));
+            VD4_STORE(yr + out4 + q, VD4_SUB(VD4_MUL(b4r, vw4r), VD4_MUL(b4i, vw4i)));
+            VD4_STORE(yi + out4 + q, VD4_ADD(VD4_MUL(b4r, vw4i), VD4_MUL(b4i, vw4r)));
+        }
+        for (; q < s; ++q)
+        {
+            double a0r = xr[in0 + q];
+            double a0i = xi[in0 + q];
+            double a1r = xr[in1 + q];
+            double a1i = xi[in1 + q];
+            double a2r = xr[in2 + q];
+            double a2i = xi[in2 + q];
+            double a3r = xr[in3 + q];
+            double a3i = xi[in3 + q];
+            double a4r = xr[in4 + q];
+            double a4i = xi[in4 + q];
+
+            double t1r = a1r + a4r;
+            double t1i = a1i + a4i;
+            double t2r = a2r + a3r;
+            double t2i = a2i + a3i;
+            double d1r = a1r - a4r;
+            double d1i = a1i - a4i;
+            double d2r = a2r - a3r;
+            double d2i = a2i - a3i;
+
+            double e1r = a0r + c1 * t1r + c2 * t2r;
+            double e1i = a0i + c1 * t1i + c2 * t2i;
+            double e2r = a0r + c2 * t1r + c1 * t2r;
+            double e2i = a0i + c2 * t1i + c1 * t2i;
+            double o1r = s1 * d1r + s2 * d2r;
+            double o1i = s1 * d1i + s2 * d2i;
+            double o2r = s2 * d1r - s1 * d2r;
+            double o2i = s2 * d1i - s1 * d2i;
+
+            double b1r = e1r + o1i;
+            double b1i = e1i - o1r;
+            double b4r = e1r - o1i;
+            double b4i = e1i + o1r;
+            double b2r = e2r + o2i;
+            double b2i = e2i - o2r;
+            double b3r = e2r - o2i;
+            double b3i = e2i + o2r;
+
+            yr[out0 + q] = a0r + t1r + t2r;
+            yi[out0 + q] = a0i + t1i + t2i;
+            yr[out1 + q] = b1r * wr[0] - b1i * wi[0];
+            yi[out1 + q] = b1r * wi[0] + b1i * wr[0];
+            yr[out2 + q] = b2r * wr[1] - b2i * wi[1];
+            yi[out2 + q] = b2r * wi[1] + b2i * wr[1];
+            yr[out3 + q] = b3r * wr[2] - b3i * wi[2];
+            yi[out3 + q] = b3r * wi[2] + b3i * wr[2];
+            yr[out4 + q] = b4r * wr[3] - b4i * wi[3];
+            yi[out4 + q] = b4r * wi[3] + b4i * wr[3];
+        }
+    }
+}
+#endif
+
+
+static void
+native_cfftD(const FFT_PLAN_D* plan, double* re, double* im, double* work_re, double* work_im, unsigned channels)
+{
+    double* xr = re;
+    double* xi = im;
+    double* yr = work_re;
+    double* yi = work_im;
+    const double* twr = plan->twiddle_r;
+    const double* twi = plan->twiddle_i;
+    unsigned s = channels;
+    unsigned n_stage = plan->n;
+
+    for (unsigned stage = 0; stage < plan->n_stages; ++stage)
+    {
+        unsigned radix = plan->radix[stage];
+        unsigned m = n_stage / radix;
+        switch (radix)
+        {
+            case 4:
+                native_pass4D(s, m, xr, xi, yr, yi, twr, twi);
+                break;
+            case 3:
+                native_pass3D(s, m, xr, xi, yr, yi, twr, twi);
+                break;
+            case 5:
+                native_pass5D(s, m, xr, xi, yr, yi, twr, twi);
+                break;
+            default:
+                native_pass2D(s, m, xr, xi, yr, yi, twr, twi);
+                break;
+        }
+        twr += (radix - 1) * m;
+        twi += (radix - 1) * m;
+
+        // Ping-pong buffers
+        double* temp = xr;
+        xr = yr;
+        yr = temp;
+        temp = xi;
+        xi = yi;
+        yi = temp;
+        s *= radix;
+        n_stage = m;
+    }
+
+    if (xr != re)
+    {
+        CopyBufferD(re, xr, plan->n * channels);
+        CopyBufferD(im, xi, plan->n * channels);
+    }
+}
+
+
+static void
+native_rfftD(const FFT_PLAN_D* plan, double* buffer, const double* in, unsigned in_length, double* re, double* im)
+{
+    const unsigned n = plan->n;
+    double* zr = buffer;
+    double* zi = zr + n;
+    unsigned pairs = in_length / 2;
+    unsigned i;
+
+    // Even samples to the real part and odd samples to the imaginary part
+    for (i = 0; i < pairs; ++i)
+    {
+        zr[i] = in[2 * i];
+        zi[i] = in[2 * i + 1];
+    }
+    if (in_length % 2)
+    {
+        zr[i] = in[2 * i];
+        zi[i] = 0.0;
+        ++i;
+    }
+    for (; i < n; ++i)
+    {
+        zr[i] = 0.0;
+        zi[i] = 0.0;
+    }
+
+    native_cfftD(plan, zr, zi, zi + n, zi + 2 * n, 1);
+
+    // Separate the even and odd spectra and combine
+    re[0] = zr[0] + zi[0];
+    im[0] = zr[0] - zi[0];
+    unsigned k = 1;
+#ifdef VD_WIDTH
+    const vdouble half = VD_SET1(0.5);
+    for (; k + VD_WIDTH <= n; k += VD_WIDTH)
+    {
+        vdouble ar = VD_LOAD(zr + k);
+        vdouble ai = VD_LOAD(zi + k);
+        vdouble br = VD_REVERSE(VD_LOAD(zr + n - k - (VD_WIDTH - 1)));
+        vdouble bi = VD_REVERSE(VD_LOAD(zi + n - k - (VD_WIDTH - 1)));
+        vdouble er = VD_MUL(half, VD_ADD(ar, br));
+        vdouble ei = VD_MUL(half, VD_SUB(ai, bi));
+        vdouble odr = VD_MUL(half, VD_ADD(ai, bi));
+        vdouble odi = VD_MUL(half, VD_SUB(br, ar));
+        vdouble c = VD_LOAD(plan->rtwiddle_r + k);
+        vdouble s = VD_LOAD(plan->rtwiddle_i + k);
+        VD_STORE(re + k, VD_ADD(er, VD_ADD(VD_MUL(c, odr), VD_MUL(s, odi))));
+        VD_STORE(im + k, VD_ADD(ei, VD_SUB(VD_MUL(c, odi), VD_MUL(s, odr))));
+    }
+#endif
+    for (; k < n; ++k)
+    {
+        double ar = zr[k];
+        double ai = zi[k];
+        double br = zr[n - k];
+        double bi = zi[n - k];
+        double er = 0.5 * (ar + br);
+        double ei = 0.5 * (ai - bi);
+        double odr = 0.5 * (ai + bi);
+        double odi = 0.5 * (br - ar);
+        double c = plan->rtwiddle_r[k];
+        double s = plan->rtwiddle_i[k];
+        re[k] = er + c * odr + s * odi;
+        im[k] = ei + c * odi - s * odr;
     }
 }
 
 
 static void
-cftmdl(int n, int l, double *a, double *w)
+native_irfftD(const FFT_PLAN_D* plan, double* buffer, const double* re,
+              const double* im, double nyquist, double* out, double scale)
 {
-    int j, j1, j2, j3, k, k1, k2, m, m2;
-    double wk1r, wk1i, wk2r, wk2i, wk3r, wk3i;
-    double x0r, x0i, x1r, x1i, x2r, x2i, x3r, x3i;
+    const unsigned n = plan->n;
+    double* zr = buffer;
+    double* zi = zr + n;
+
+    // Recombine into the spectrum of the half-length complex signal
+    zr[0] = re[0] + nyquist;
+    zi[0] = re[0] - nyquist;
+    unsigned k = 1;
+#ifdef VD_WIDTH
+    for (; k + VD_WIDTH <= n; k += VD_WIDTH)
+    {
+        vdouble ar = VD_LOAD(re + k);
+        vdouble ai = VD_LOAD(im + k);
+        vdouble br = VD_REVERSE(VD_LOAD(re + n - k - (VD_WIDTH - 1)));
+        vdouble bi = VD_REVERSE(VD_LOAD(im + n - k - (VD_WIDTH - 1)));
+        vdouble dr = VD_SUB(ar, br);
+        vdouble di = VD_ADD(ai, bi);
+        vdouble c = VD_LOAD(plan->rtwiddle_r + k);
+        vdouble s = VD_LOAD(plan->rtwiddle_i + k);
+        VD_STORE(zr + k, VD_SUB(VD_ADD(ar, br), VD_ADD(VD_MUL(dr, s), VD_MUL(di, c))));
+        VD_STORE(zi + k, VD_ADD(VD_SUB(ai, bi), VD_SUB(VD_MUL(dr, c), VD_MUL(di, s))));
+    }
+#endif
+    for (; k < n; ++k)
+    {
+        double ar = re[k];
+        double ai = im[k];
+        double br = re[n - k];
+        double bi = im[n - k];
+        double dr = ar - br;
+        double di = ai + bi;
+        double c = plan->rtwiddle_r[k];
+        double s = plan->rtwiddle_i[k];
+        zr[k] = (ar + br) - (dr * s + di * c);
+        zi[k] = (ai - bi) + (dr * c - di * s);
+    }
 
-    m = l << 2;
-    for (j = 0; j < l; j += 2) {
-        j1 = j + l;
-        j2 = j1 + l;
-        j3 = j2 + l;
-        x0r = a[j] + a[j1];
-        x0i = a[j + 1] + a[j1 + 1];
-        x1r = a[j] - a[j1];
-        x1i = a[j + 1] - a[j1 + 1];
-        x2r = a[j2] + a[j3];
-        x2i = a[j2 + 1] + a[j3 + 1];
-        x3r = a[j2] - a[j3];
-        x3i = a[j2 + 1] - a[j3 + 1];
-        a[j] = x0r + x2r;
-        a[j + 1] = x0i + x2i;
-        a[j2] = x0r - x2r;
-        a[j2 + 1] = x0i - x2i;
-        a[j1] = x1r - x3i;
-        a[j1 + 1] = x1i + x3r;
-        a[j3] = x1r + x3i;
-        a[j3 + 1] = x1i - x3r;
+    // Inverse transform by swapping real and imaginary parts
+    native_cfftD(plan, zi, zr, zi + 2 * n, zi + n, 1);
+
+    for (unsigned i = 0; i < n; ++i)
+    {
+        out[2 * i] = zr[i] * scale;
+        out[2 * i + 1] = zi[i] * scale;
     }
-    wk1r = w[2];
-    for (j = m; j < l + m; j += 2) {
-        j1 = j + l;
-        j2 = j1 + l;
-        j3 = j2 + l;
-        x0r = a[j] + a[j1];
-        x0i = a[j + 1] + a[j1 + 1];
-        x1r = a[j] - a[j1];
-        x1i = a[j + 1] - a[j1 + 1];
-        x2r = a[j2] + a[j3];
-        x2i = a[j2 + 1] + a[j3 + 1];
-        x3r = a[j2] - a[j3];
-        x3i = a[j2 + 1] - a[j3 + 1];
-        a[j] = x0r + x2r;
-        a[j + 1] = x0i + x2i;
-        a[j2] = x2i - x0i;
-        a[j2 + 1] = x0r - x2r;
-        x0r = x1r - x3i;
-        x0i = x1i + x3r;
-        a[j1] = wk1r * (x0r - x0i);
-        a[j1 + 1] = wk1r * (x0r + x0i);
-        x0r = x3i + x1r;
-        x0i = x3r - x1i;
-        a[j3] = wk1r * (x0i - x0r);
-        a[j3 + 1] = wk1r * (x0i + x0r);
+}
+
+
+static void
+native_c2cD(const FFT_PLAN_D* plan, double* buffer, const double* in_re,
+           const double* in_im, double* out_re, double* out_im)
+{
+    const unsigned n = plan->n;
+    double* zr = buffer;
+    double* zi = zr + 2 * n;
+
+    CopyBufferD(zr, in_re, 2 * n);
+    CopyBufferD(zi, in_im, 2 * n);
+    native_cfftD(plan, zr, zi, out_re, out_im, 2);
+
+    // X[k] = E[k] + w^k * O[k], X[k + n] = E[k] - w^k * O[k]
+    for (unsigned k = 0; k < n; ++k)
+    {
+        double er = zr[2 * k];
+        double ei = zi[2 * k];
+        double odr = zr[2 * k + 1];
+        double odi = zi[2 * k + 1];
+        double c = plan->rtwiddle_r[k];
+        double s = plan->rtwiddle_i[k];
+        double tr = odr * c + odi * s;
+        double ti = odi * c - odr * s;
+        out_re[k] = er + tr;
+        out_im[k] = ei + ti;
+        out_re[k + n] = er - tr;
+        out_im[k + n] = ei - ti;
     }
-    k1 = 0;
-    m2 = 2 * m;
-    for (k = m2; k < n; k += m2) {
-        k1 += 2;
-        k2 = 2 * k1;
-        wk2r = w[k1];
-        wk2i = w[k1 + 1];
-        wk1r = w[k2];
-        wk1i = w[k2 + 1];
-        wk3r = wk1r - 2 * wk2i * wk1i;
-        wk3i = 2 * wk2i * wk1r - wk1i;
-        for (j = k; j < l + k; j += 2) {
-            j1 = j + l;
-            j2 = j1 + l;
-            j3 = j2 + l;
-            x0r = a[j] + a[j1];
-            x0i = a[j + 1] + a[j1 + 1];
-            x1r = a[j] - a[j1];
-            x1i = a[j + 1] - a[j1 + 1];
-            x2r = a[j2] + a[j3];
-            x2i = a[j2 + 1] + a[j3 + 1];
-            x3r = a[j2] - a[j3];
-            x3i = a[j2 + 1] - a[j3 + 1];
-            a[j] = x0r + x2r;
-            a[j + 1] = x0i + x2i;
-            x0r -= x2r;
-            x0i -= x2i;
-            a[j2] = wk2r * x0r - wk2i * x0i;
-            a[j2 + 1] = wk2r * x0i + wk2i * x0r;
-            x0r = x1r - x3i;
-            x0i = x1i + x3r;
-            a[j1] = wk1r * x0r - wk1i * x0i;
-            a[j1 + 1] = wk1r * x0i + wk1i * x0r;
-            x0r = x1r + x3i;
-            x0i = x1i - x3r;
-            a[j3] = wk3r * x0r - wk3i * x0i;
-            a[j3 + 1] = wk3r * x0i + wk3i * x0r;
+}
+
+
+static void
+native_rfft_batchD(const FFT_PLAN_D* plan, double* buffer, const double* in,
+                  unsigned in_stride, unsigned in_length, unsigned channels,
+                  double* re, double* im)
+{
+    const unsigned n = plan->n;
+    const unsigned total = n * channels;
+    double* zr = buffer;
+    double* zi = zr + total;
+    unsigned pairs = in_length / 2;
+
+    ClearBufferD(zr, 2 * total);
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        const double* x = in + c * in_stride;
+        unsigned i;
+        for (i = 0; i < pairs; ++i)
+        {
+            zr[i * channels + c] = x[2 * i];
+            zi[i * channels + c] = x[2 * i + 1];
         }
-        wk1r = w[k2 + 2];
-        wk1i = w[k2 + 3];
-        wk3r = wk1r - 2 * wk2r * wk1i;
-        wk3i = 2 * wk2r * wk1r - wk1i;
-        for (j = k + m; j < l + (k + m); j += 2) {
-            j1 = j + l;
-            j2 = j1 + l;
-            j3 = j2 + l;
-            x0r = a[j] + a[j1];
-            x0i = a[j + 1] + a[j1 + 1];
-            x1r = a[j] - a[j1];
-            x1i = a[j + 1] - a[j1 + 1];
-            x2r = a[j2] + a[j3];
-            x2i = a[j2 + 1] + a[j3 + 1];
-            x3r = a[j2] - a[j3];
-            x3i = a[j2 + 1] - a[j3 + 1];
-            a[j] = x0r + x2r;
-            a[j + 1] = x0i + x2i;
-            x0r -= x2r;
-            x0i -= x2i;
-            a[j2] = -wk2i * x0r - wk2r * x0i;
-            a[j2 + 1] = -wk2i * x0i + wk2r * x0r;
-            x0r = x1r - x3i;
-            x0i = x1i + x3r;
-            a[j1] = wk1r * x0r - wk1i * x0i;
-            a[j1 + 1] = wk1r * x0i + wk1i * x0r;
-            x0r = x1r + x3i;
-            x0i = x1i - x3r;
-            a[j3] = wk3r * x0r - wk3i * x0i;
-            a[j3 + 1] = wk3r * x0i + wk3i * x0r;
+        if (in_length % 2)
+        {
+            zr[i * channels + c] = x[2 * i];
+        }
+    }
+
+    native_cfftD(plan, zr, zi, zi + total, zi + 2 * total, channels);
+
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        re[c] = zr[c] + zi[c];
+        im[c] = zr[c] - zi[c];
+    }
+    for (unsigned k = 1; k < n; ++k)
+    {
+        const double c = plan->rtwiddle_r[k];
+        const double s = plan->rtwiddle_i[k];
+        const unsigned a = k * channels;
+        const unsigned b = (n - k) * channels;
+        unsigned ch = 0;
+#ifdef VD_WIDTH
+        const vdouble half = VD_SET1(0.5);
+        const vdouble vc = VD_SET1(c);
+        const vdouble vs = VD_SET1(s);
+        for (; ch + VD_WIDTH <= channels; ch += VD_WIDTH)
+        {
+            vdouble ar = VD_LOAD(zr + a + ch);
+            vdouble ai = VD_LOAD(zi + a + ch);
+            vdouble br = VD_LOAD(zr + b + ch);
+            vdouble bi = VD_LOAD(zi + b + ch);
+            vdouble er = VD_MUL(half, VD_ADD(ar, br));
+            vdouble ei = VD_MUL(half, VD_SUB(ai, bi));
+            vdouble odr = VD_MUL(half, VD_ADD(ai, bi));
+            vdouble odi = VD_MUL(half, VD_SUB(br, ar));
+            VD_STORE(re + a + ch, VD_ADD(er, VD_ADD(VD_MUL(vc, odr), VD_MUL(vs, odi))));
+            VD_STORE(im + a + ch, VD_ADD(ei, VD_SUB(VD_MUL(vc, odi), VD_MUL(vs, odr))));
+        }
+#endif
+        for (; ch < channels; ++ch)
+        {
+            double ar = zr[a + ch];
+            double ai = zi[a + ch];
+            double br = zr[b + ch];
+            double bi = zi[b + ch];
+            double er = 0.5 * (ar + br);
+            double ei = 0.5 * (ai - bi);
+            double odr = 0.5 * (ai + bi);
+            double odi = 0.5 * (br - ar);
+            re[a + ch] = er + c * odr + s * odi;
+            im[a + ch] = ei + c * odi - s * odr;
         }
     }
 }
 
 
 static void
-rftfsub(int n, double *a, int nc, double *c)
+native_irfft_batchD(const FFT_PLAN_D* plan, double* buffer, const double* re,
+                   const double* im, unsigned channels, double* out,
+                   unsigned out_stride, double scale)
 {
-    int j, k, kk, ks, m;
-    double wkr, wki, xr, xi, yr, yi;
+    const unsigned n = plan->n;
+    const unsigned total = n * channels;
+    double* zr = buffer;
+    double* zi = zr + total;
 
-    m = n >> 1;
-    ks = 2 * nc / m;
-    kk = 0;
-    for (j = 2; j < m; j += 2) {
-        k = n - j;
-        kk += ks;
-        wkr = 0.5 - c[nc - kk];
-        wki = c[kk];
-        xr = a[j] - a[k];
-        xi = a[j + 1] + a[k + 1];
-        yr = wkr * xr - wki * xi;
-        yi = wkr * xi + wki * xr;
-        a[j] -= yr;
-        a[j + 1] -= yi;
-        a[k] += yr;
-        a[k + 1] -= yi;
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        zr[c] = re[c] + im[c];
+        zi[c] = re[c] - im[c];
+    }
+    for (unsigned k = 1; k < n; ++k)
+    {
+        const double c = plan->rtwiddle_r[k];
+        const double s = plan->rtwiddle_i[k];
+        const unsigned a = k * channels;
+        const unsigned b = (n - k) * channels;
+        unsigned ch = 0;
+#ifdef VD_WIDTH
+        const vdouble vc = VD_SET1(c);
+        const vdouble vs = VD_SET1(s);
+        for (; ch + VD_WIDTH <= channels; ch += VD_WIDTH)
+        {
+            vdouble ar = VD_LOAD(re + a + ch);
+            vdouble ai = VD_LOAD(im + a + ch);
+            vdouble br = VD_LOAD(re + b + ch);
+            vdouble bi = VD_LOAD(im + b + ch);
+            vdouble dr = VD_SUB(ar, br);
+            vdouble di = VD_ADD(ai, bi);
+            VD_STORE(zr + a + ch, VD_SUB(VD_ADD(ar, br), VD_ADD(VD_MUL(dr, vs), VD_MUL(di, vc))));
+            VD_STORE(zi + a + ch, VD_ADD(VD_SUB(ai, bi), VD_SUB(VD_MUL(dr, vc), VD_MUL(di, vs))));
+        }
+#endif
+        for (; ch < channels; ++ch)
+        {
+            double ar = re[a + ch];
+            double ai = im[a + ch];
+            double br = re[b + ch];
+            double bi = im[b + ch];
+            double dr = ar - br;
+            double di = ai + bi;
+            zr[a + ch] = (ar + br) - (dr * s + di * c);
+            zi[a + ch] = (ai - bi) + (dr * c - di * s);
+        }
+    }
+
+    // Inverse transform by swapping real and imaginary parts
+    native_cfftD(plan, zi, zr, zi + 2 * total, zi + total, channels);
+
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        double* y = out + c * out_stride;
+        for (unsigned i = 0; i < n; ++i)
+        {
+            y[2 * i] = zr[i * channels + c] * scale;
+            y[2 * i + 1] = zi[i * channels + c] * scale;
+        }
     }
 }
 
 
 static void
-rftbsub(int n, double *a, int nc, double *c)
+native_batch_multiplyD(double* re, double* im, const double* kernel_re,
+                      const double* kernel_im, unsigned n, unsigned channels)
 {
-    int j, k, kk, ks, m;
-    double wkr, wki, xr, xi, yr, yi;
+#ifdef FFT_X86
+    if (channels >= VD4_WIDTH && FFT_HAS_AVX())
+    {
+        native_batch_multiply_avxD(re, im, kernel_re, kernel_im, n, channels);
+        return;
+    }
+#endif
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        re[c] *= kernel_re[0];
+        im[c] *= kernel_im[0];
+    }
+    for (unsigned k = 1; k < n; ++k)
+    {
+        const double hr = kernel_re[k];
+        const double hi = kernel_im[k];
+        double* xr = re + k * channels;
+        double* xi = im + k * channels;
+        unsigned ch = 0;
+#ifdef VD_WIDTH
+        const vdouble vhr = VD_SET1(hr);
+        const vdouble vhi = VD_SET1(hi);
+        for (; ch + VD_WIDTH <= channels; ch += VD_WIDTH)
+        {
+            vdouble ar = VD_LOAD(xr + ch);
+            vdouble ai = VD_LOAD(xi + ch);
+            VD_STORE(xr + ch, VD_SUB(VD_MUL(ar, vhr), VD_MUL(ai, vhi)));
+            VD_STORE(xi + ch, VD_ADD(VD_MUL(ar, vhi), VD_MUL(ai, vhr)));
+        }
+#endif
+        for (; ch < channels; ++ch)
+        {
+            double ar = xr[ch];
+            double ai = xi[ch];
+            xr[ch] = ar * hr - ai * hi;
+            xi[ch] = ar * hi + ai * hr;
+        }
+    }
+}
 
-    a[1] = -a[1];
-    m = n >> 1;
-    ks = 2 * nc / m;
-    kk = 0;
-    for (j = 2; j < m; j += 2) {
-        k = n - j;
-        kk += ks;
-        wkr = 0.5 - c[nc - kk];
-        wki = c[kk];
-        xr = a[j] - a[k];
-        xi = a[j + 1] + a[k + 1];
-        yr = wkr * xr + wki * xi;
-        yi = wkr * xi - wki * xr;
-        a[j] -= yr;
-        a[j + 1] = yi - a[j + 1];
-        a[k] += yr;
-        a[k + 1] = yi - a[k + 1];
+
+#ifdef FFT_X86
+/* Batch spectrum multiply with AVX, a vector of channels at a time */
+__attribute__((target("avx,fma"))) static void
+native_batch_multiply_avxD(double* re, double* im, const double* kernel_re,
+                          const double* kernel_im, unsigned n, unsigned channels)
+{
+    for (unsigned c = 0; c < channels; ++c)
+    {
+        re[c] *= kernel_re[0];
+        im[c] *= kernel_im[0];
     }
-    a[m + 1] = -a[m + 1];
+    for (unsigned k = 1; k < n; ++k)
+    {
+        const double hr = kernel_re[k];
+        const double hi = kernel_im[k];
+        double* xr = re + k * channels;
+        double* xi = im + k * channels;
+        unsigned ch = 0;
+        const vdouble4 vhr = VD4_SET1(hr);
+        const vdouble4 vhi = VD4_SET1(hi);
+        for (; ch + VD4_WIDTH <= channels; ch += VD4_WIDTH)
+        {
+            vdouble4 ar = VD4_LOAD(xr + ch);
+            vdouble4 ai = VD4_LOAD(xi + ch);
+            VD4_STORE(xr + ch, VD4_SUB(VD4_MUL(ar, vhr), VD4_MUL(ai, vhi)));
+            VD4_STORE(xi + ch, VD4_ADD(VD4_MUL(ar, vhi), VD4_MUL(ai, vhr)));
+        }
+        for (; ch < channels; ++ch)
+        {
+            double ar = xr[ch];
+            double ai = xi[ch];
+            xr[ch] = ar * hr - ai * hi;
+            xi[ch] = ar * hi + ai * hr;
+        }
+    }
+}
+
+
+__attribute__((target("avx,fma"))) static unsigned
+spectrum_mac_avxD(double* acc_re, double* acc_im, const double* a_re, const double* a_im,
+                  const double* b_re, const double* b_im, unsigned bins)
+{
+    unsigned k = 0;
+    for (; k + VD4_WIDTH <= bins; k += VD4_WIDTH)
+    {
+        vdouble4 ar = VD4_LOAD(a_re + k);
+        vdouble4 ai = VD4_LOAD(a_im + k);
+        vdouble4 br = VD4_LOAD(b_re + k);
+        vdouble4 bi = VD4_LOAD(b_im + k);
+        VD4_STORE(acc_re + k, VD4_ADD(VD4_LOAD(acc_re + k),
+                                      VD4_SUB(VD4_MUL(ar, br), VD4_MUL(ai, bi))));
+        VD4_STORE(acc_im + k, VD4_ADD(VD4_LOAD(acc_im + k),
+                                      VD4_ADD(VD4_MUL(ar, bi), VD4_MUL(ai, br))));
+    }
+    return k;
 }
 
-#endif
\ No newline at end of file
+
+__attribute__((target("avx,fma"))) static unsigned
+spectrum_multiply_avxD(double* re, double* im, const double* k_re, const double* k_im,
+                       unsigned start, unsigned end)
+{
+    unsigned k = start;
+    for (; k + VD4_WIDTH <= end; k += VD4_WIDTH)
+    {
+        vdouble4 ar = VD4_LOAD(re + k);
+        vdouble4 ai = VD4_LOAD(im + k);
+        vdouble4 br = VD4_LOAD(k_re + k);
+        vdouble4 bi = VD4_LOAD(k_im + k);
+        VD4_STORE(re + k, VD4_SUB(VD4_MUL(ar, br), VD4_MUL(ai, bi)));
+        VD4_STORE(im + k, VD4_ADD(VD4_MUL(ar, bi), VD4_MUL(ai, br)));
+    }
+    return k;
+}
+#endif
+
+#endif
@@ -0,0 +1,1042 @@
+/*
+ * FIRDesign.c
+ * Hamilton Kibbe
+ * Copyright 2015 Hamilton Kibbe
+ */
+
+#include "FIRDesign.h"
+#include "FFT.h"
+#include "Dsp.h"
+#include "Utilities.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/* Minimum-phase conversion uses an FFT this many times the kernel length, to
+ keep the cepstrum from aliasing */
+#define MIN_PHASE_OVERSAMPLE (16)
+
+/* Floor on the magnitude response before taking its log, relative to the
+ peak (-200 dB) */
+#define MIN_PHASE_FLOOR (1e-10)
+
+/* The exchange stops when the extremal errors agree to this fraction */
+#define EQUIRIPPLE_TOLERANCE (1e-6)
+
+
+/* Static Function Prototypes */
+static int
+spec_valid(const FIRDesignSpec* spec);
+
+static int
+spec_equal(const FIRDesignSpec* a, const FIRDesignSpec* b);
+
+static unsigned
+spec_bands(const FIRDesignSpec* spec, double* bands, double* gains);
+
+static double
+kaiser_beta(double attenuation);
+
+static Error_t
+design(double* kernel, const FIRDesignSpec* spec, unsigned length);
+
+static void
+windowed_lowpass(double* kernel, unsigned length, double cutoff, const double* window);
+
+static void
+frequency_sample(double* kernel, unsigned length, const double* amplitude);
+
+static Error_t
+equiripple(double* kernel, unsigned length, const double* bands, const double* gains,
+           const double* weights, unsigned n_bands);
+
+static unsigned
+find_extrema(const double* error, const unsigned* band_index, unsigned grid_length,
+             double floor, unsigned* found);
+
+static double
+barycentric_weight(const double* x, unsigned k, unsigned n);
+
+static double
+barycentric_eval(const double* x, const double* weights, const double* y, unsigned n,
+                 double point);
+
+static Error_t
+minimum_phase(double* dest, const double* kernel, unsigned length);
+
+
+/* Cached kernel *******************************************************/
+typedef struct
+{
+    FIRDesignSpec   spec;
+    float*          kernel;
+    unsigned        length;
+    unsigned long   last_used;
+} CacheEntry;
+
+typedef struct
+{
+    FIRDesignSpec   spec;
+    double*         kernel;
+    unsigned        length;
+    unsigned long   last_used;
+} CacheEntryD;
+
+
+/* FIRDesignCache ******************************************************/
+struct FIRDesignCache
+{
+    CacheEntry*     entries;
+    unsigned        capacity;
+    unsigned        count;
+    unsigned long   clock;
+};
+
+struct FIRDesignCacheD
+{
+    CacheEntryD*    entries;
+    unsigned        capacity;
+    unsigned        count;
+    unsigned long   clock;
+};
+
+
+/* FIRDesignLength *****************************************************/
+unsigned
+FIRDesignLength(const FIRDesignSpec* spec)
+{
+    if (!spec || !spec_valid(spec))
+    {
+        return 0;
+    }
+
+    const int odd_only = (spec->type == HIGHPASS) || (spec->type == NOTCH);
+    unsigned length = spec->length;
+    if (length == 0)
+    {
+        // Kaiser's estimates of the taps needed for a transition width and
+        // attenuation. Equiripple designs spread the error evenly, so they
+        // get by with fewer
+        double estimate;
+        if (spec->method == FIR_KAISER)
+        {
+            estimate = (spec->attenuation - 7.95) / (14.36 * spec->transition);
+        }
+        else
+        {
+            estimate = (spec->attenuation - 13.0) / (14.6 * spec->transition);
+        }
+        length = (estimate > 2.0) ? (unsigned)ceil(estimate) + 1 : 3;
+        if (odd_only && (length % 2 == 0))
+        {
+            ++length;
+        }
+    }
+    else if (odd_only && (length % 2 == 0))
+    {
+        // An even linear-phase kernel has a zero at nyquist
+        return 0;
+    }
+    return length;
+}
+
+
+/* FIRDesign ***********************************************************/
+Error_t
+FIRDesign(float* kernel, const FIRDesignSpec* spec)
+{
+    const unsigned length = FIRDesignLength(spec);
+    if (length == 0)
+    {
+        return VALUE_ERROR;
+    }
+
+    double* temp = (double*)malloc(length * sizeof(double));
+    if (!temp)
+    {
+        return NULL_PTR_ERROR;
+    }
+    Error_t err = design(temp, spec, length);
+    DoubleToFloat(kernel, temp, length);
+    free(temp);
+    return err;
+}
+
+Error_t
+FIRDesignD(double* kernel, const FIRDesignSpec* spec)
+{
+    const unsigned length = FIRDesignLength(spec);
+    if (length == 0)
+    {
+        return VALUE_ERROR;
+    }
+    return design(kernel, spec, length);
+}
+
+
+/* FIRDesignFrequencySampling ******************************************/
+Error_t
+FIRDesignFrequencySampling(float*       kernel,
+                           unsigned     length,
+                           const float* gains,
+                           unsigned     n_gains,
+                           Window_t     window)
+{
+    if (n_gains < 2 || length == 0)
+    {
+        return VALUE_ERROR;
+    }
+
+    double* temp = (double*)malloc((length + n_gains) * sizeof(double));
+    if (!temp)
+    {
+        return NULL_PTR_ERROR;
+    }
+    FloatToDouble(temp + length, gains, n_gains);
+    Error_t err = FIRDesignFrequencySamplingD(temp, length, temp + length, n_gains, window);
+    DoubleToFloat(kernel, temp, length);
+    free(temp);
+    return err;
+}
+
+Error_t
+FIRDesignFrequencySamplingD(double*         kernel,
+                            unsigned        length,
+                            const double*   gains,
+                            unsigned        n_gains,
+                            Window_t        window)
+{
+    if (n_gains < 2 || length == 0)
+    {
+        return VALUE_ERROR;
+    }
+
+    // Interpolate the gains onto the DFT bins from DC to nyquist
+    const unsigned n_bins = length / 2 + 1;
+    double* amplitude = (double*)malloc(n_bins * sizeof(double));
+    WindowFunctionD* taper = WindowFunctionInitD(length, window);
+    if (!amplitude || !taper)
+    {
+        free(amplitude);
+        if (taper)
+        {
+            WindowFunctionFreeD(taper);
+        }
+        return NULL_PTR_ERROR;
+    }
+
+    for (unsigned k = 0; k < n_bins; ++k)
+    {
+        const double position = (2.0 * k / length) * (n_gains - 1);
+        unsigned index = (unsigned)position;
+        if (index >= n_gains - 1)
+        {
+            index = n_gains - 2;
+        }
+        const double frac = position - index;
+        amplitude[k] = gains[index] + frac * (gains[index + 1] - gains[index]);
+    }
+
+    frequency_sample(kernel, length, amplitude);
+    WindowFunctionProcessD(taper, kernel, kernel, length);
+
+    WindowFunctionFreeD(taper);
+    free(amplitude);
+    return NOERR;
+}
+
+
+/* FIRDesignEquiripple *************************************************/
+Error_t
+FIRDesignEquiripple(float*          kernel,
+                    unsigned        length,
+                    const float*    bands,
+                    const float*    gains,
+                    const float*    weights,
+                    unsigned        n_bands)
+{
+    double* temp = (double*)malloc((length + 4 * n_bands) * sizeof(double));
+    if (!temp)
+    {
+        return NULL_PTR_ERROR;
+    }
+    double* band_temp = temp + length;
+    double* gain_temp = band_temp + 2 * n_bands;
+    double* weight_temp = gain_temp + n_bands;
+    FloatToDouble(band_temp, bands, 2 * n_bands);
+    FloatToDouble(gain_temp, gains, n_bands);
+    FloatToDouble(weight_temp, weights, n_bands);
+
+    Error_t err = FIRDesignEquirippleD(temp, length, band_temp, gain_temp, weight_temp, n_bands);
+    DoubleToFloat(kernel, temp, length);
+    free(temp);
+    return err;
+}
+
+Error_t
+FIRDesignEquirippleD(double*        kernel,
+                     unsigned       length,
+                     const double*  bands,
+                     const double*  gains,
+                     const double*  weights,
+                     unsigned       n_bands)
+{
+    if (length < 3 || n_bands == 0)
+    {
+        return VALUE_ERROR;
+    }
+    for (unsigned i = 0; i < 2 * n_bands; ++i)
+    {
+        if ((bands[i] < 0.0) || (bands[i] > 0.5) || ((i > 0) && (bands[i] < bands[i - 1])))
+        {
+            return VALUE_ERROR;
+        }
+    }
+    for (unsigned i = 0; i < n_bands; ++i)
+    {
+        if (weights[i] <= 0.0)
+        {
+            return VALUE_ERROR;
+        }
+    }
+    return equiripple(kernel, length, bands, gains, weights, n_bands);
+}
+
+
+/* FIRDesignMinimumPhase ***********************************************/
+Error_t
+FIRDesignMinimumPhase(float* dest, const float* kernel, unsigned length)
+{
+    double* temp = (double*)malloc(length * sizeof(double));
+    if (!temp)
+    {
+        return NULL_PTR_ERROR;
+    }
+    FloatToDouble(temp, kernel, length);
+    Error_t err = minimum_phase(temp, temp, length);
+    DoubleToFloat(dest, temp, length);
+    free(temp);
+    return err;
+}
+
+Error_t
+FIRDesignMinimumPhaseD(double* dest, const double* kernel, unsigned length)
+{
+    return minimum_phase(dest, kernel, length);
+}
+
+
+/* FIRDesignCacheInit **************************************************/
+FIRDesignCache*
+FIRDesignCacheInit(unsigned capacity)
+{
+    if (capacity == 0)
+    {
+        return NULL;
+    }
+
+    FIRDesignCache* cache = (FIRDesignCache*)malloc(sizeof(FIRDesignCache));
+    CacheEntry* entries = (CacheEntry*)malloc(capacity * sizeof(CacheEntry));
+    if (cache && entries)
+    {
+        cache->entries = entries;
+        cache->capacity = capacity;
+        cache->count = 0;
+        cache->clock = 0;
+        return cache;
+    }
+    else
+    {
+        if (cache)
+        {
+            free(cache);
+        }
+        if (entries)
+        {
+            free(entries);
+        }
+        return NULL;
+    }
+}
+
+FIRDesignCacheD*
+FIRDesignCacheInitD(unsigned capacity)
+{
+    if (capacity == 0)
+    {
+        return NULL;
+    }
+
+    FIRDesignCacheD* cache = (FIRDesignCacheD*)malloc(sizeof(FIRDesignCacheD));
+    CacheEntryD* entries = (CacheEntryD*)malloc(capacity * sizeof(CacheEntryD));
+    if (cache && entries)
+    {
+        cache->entries = entries;
+        cache->capacity = capacity;
+        cache->count = 0;
+        cache->clock = 0;
+        return cache;
+    }
+    else
+    {
+        if (cache)
+        {
+            free(cache);
+        }
+        if (entries)
+        {
+            free(entries);
+        }
+        return NULL;
+    }
+}
+
+
+/* FIRDesignCacheFree **************************************************/
+Error_t
+FIRDesignCacheFree(FIRDesignCache* cache)
+{
+    if (cache)
+    {
+        for (unsigned i = 0; i < cache->count; ++i)
+        {
+            free(cache->entries[i].kernel);
+        }
+        free(cache->entries);
+        free(cache);
+    }
+    return NOERR;
+}
+
+Error_t
+FIRDesignCacheFreeD(FIRDesignCacheD* cache)
+{
+    if (cache)
+    {
+        for (unsigned i = 0; i < cache->count; ++i)
+        {
+            free(cache->entries[i].kernel);
+        }
+        free(cache->entries);
+        free(cache);
+    }
+    return NOERR;
+}
+
+
+/* FIRDesignCacheGet ***************************************************/
+const float*
+FIRDesignCacheGet(FIRDesignCache* cache, const FIRDesignSpec* spec, unsigned* length)
+{
+    ++cache->clock;
+    for (unsigned i = 0; i < cache->count; ++i)
+    {
+        if (spec_equal(&cache->entries[i].spec, spec))
+        {
+            cache->entries[i].last_used = cache->clock;
+            *length = cache->entries[i].length;
+            return cache->entries[i].kernel;
+        }
+    }
+
+    const unsigned n = FIRDesignLength(spec);
+    float* kernel = n ? (float*)malloc(n * sizeof(float)) : NULL;
+    if (!kernel || (FIRDesign(kernel, spec) != NOERR))
+    {
+        free(kernel);
+        return NULL;
+    }
+
+    // Take a free slot, or the least recently used one
+    unsigned slot = cache->count;
+    if (cache->count < cache->capacity)
+    {
+        ++cache->count;
+    }
+    else
+    {
+        slot = 0;
+        for (unsigned i = 1; i < cache->count; ++i)
+        {
+            if (cache->entries[i].last_used < cache->entries[slot].last_used)
+            {
+                slot = i;
+            }
+        }
+        free(cache->entries[slot].kernel);
+    }
+
+    cache->entries[slot].spec = *spec;
+    cache->entries[slot].kernel = kernel;
+    cache->entries[slot].length = n;
+    cache->entries[slot].last_used = cache->clock;
+    *length = n;
+    return kernel;
+}
+
+const double*
+FIRDesignCacheGetD(FIRDesignCacheD* cache, const FIRDesignSpec* spec, unsigned* length)
+{
+    ++cache->clock;
+    for (unsigned i = 0; i < cache->count; ++i)
+    {
+        if (spec_equal(&cache->entries[i].spec, spec))
+        {
+            cache->entries[i].last_used = cache->clock;
+            *length = cache->entries[i].length;
+            return cache->entries[i].kernel;
+        }
+    }
+
+    const unsigned n = FIRDesignLength(spec);
+    double* kernel = n ? (double*)malloc(n * sizeof(double)) : NULL;
+    if (!kernel || (FIRDesignD(kernel, spec) != NOERR))
+    {
+        free(kernel);
+        return NULL;
+    }
+
+    // Take a free slot, or the least recently used one
+    unsigned slot = cache->count;
+    if (cache->count < cache->capacity)
+    {
+        ++cache->count;
+    }
+    else
+    {
+        slot = 0;
+        for (unsigned i = 1; i < cache->count; ++i)
+        {
+            if (cache->entries[i].last_used < cache->entries[slot].last_used)
+            {
+                slot = i;
+            }
+        }
+        free(cache->entries[slot].kernel);
+    }
+
+    cache->entries[slot].spec = *spec;
+    cache->entries[slot].kernel = kernel;
+    cache->entries[slot].length = n;
+    cache->entries[slot].last_used = cache->clock;
+    *length = n;
+    return kernel;
+}
+
+
+/* STATIC FUNCTION DEFINITIONS *****************************************/
+
+/* Check that the band edges and transitions of a spec fit between DC and
+ nyquist */
+static int
+spec_valid(const FIRDesignSpec* spec)
+{
+    if (spec->method >= N_FIR_DESIGN_METHODS)
+    {
+        return 0;
+    }
+
+    const int two_edges = (spec->type == BANDPASS) || (spec->type == NOTCH);
+    if (!two_edges && (spec->type != LOWPASS) && (spec->type != HIGHPASS))
+    {
+        return 0;
+    }
+
+    const double high = two_edges ? spec->cutoff_high : spec->cutoff;
+    if ((spec->cutoff <= 0.0) || (high >= 0.5) || (high < spec->cutoff))
+    {
+        return 0;
+    }
+
+    if (spec->method == FIR_WINDOWED_SINC)
+    {
+        return (spec->window < N_WINDOWTYPES) && (spec->length > 0);
+    }
+
+    const double half = spec->transition / 2.0;
+    if ((spec->transition <= 0.0) || (spec->cutoff - half <= 0.0) || (high + half >= 0.5) ||
+        (two_edges && (spec->cutoff + half >= high - half)))
+    {
+        return 0;
+    }
+    return (spec->length > 0) || (spec->attenuation > 0.0);
+}
+
+
+/* Compare specs field by field, since the struct may have padding */
+static int
+spec_equal(const FIRDesignSpec* a, const FIRDesignSpec* b)
+{
+    return ((a->method == b->method) &&
+            (a->type == b->type) &&
+            (a->cutoff == b->cutoff) &&
+            (a->cutoff_high == b->cutoff_high) &&
+            (a->transition == b->transition) &&
+            (a->attenuation == b->attenuation) &&
+            (a->window == b->window) &&
+            (a->length == b->length) &&
+            ((a->minimum_phase != 0) == (b->minimum_phase != 0)));
+}
+
+
+/* Turn a spec into equiripple bands with a transition band around each edge */
+static unsigned
+spec_bands(const FIRDesignSpec* spec, double* bands, double* gains)
+{
+    const double half = spec->transition / 2.0;
+    const double pass = ((spec->type == LOWPASS) || (spec->type == NOTCH)) ? 1.0 : 0.0;
+    bands[0] = 0.0;
+    bands[1] = spec->cutoff - half;
+    bands[2] = spec->cutoff + half;
+    gains[0] = pass;
+    gains[1] = 1.0 - pass;
+    if ((spec->type == LOWPASS) || (spec->type == HIGHPASS))
+    {
+        bands[3] = 0.5;
+        return 2;
+    }
+    bands[3] = spec->cutoff_high - half;
+    bands[4] = spec->cutoff_high + half;
+    bands[5] = 0.5;
+    gains[2] = pass;
+    return 3;
+}
+
+
+/* Kaiser window shape for a stopband attenuation in dB */
+static double
+kaiser_beta(double attenuation)
+{
+    if (attenuation > 50.0)
+    {
+        return 0.1102 * (attenuation - 8.7);
+    }
+    else if (attenuation >= 21.0)
+    {
+        return 0.5842 * pow(attenuation - 21.0, 0.4) + 0.07886 * (attenuation - 21.0);
+    }
+    return 0.0;
+}
+
+
+/* Design a kernel of a given length from a valid spec */
+static Error_t
+design(double* kernel, const FIRDesignSpec* spec, unsigned length)
+{
+    Error_t err = NOERR;
+    if (spec->method == FIR_EQUIRIPPLE)
+    {
+        double bands[6];
+        double gains[3];
+        const double weights[3] = {1.0, 1.0, 1.0};
+        const unsigned n_bands = spec_bands(spec, bands, gains);
+        err = equiripple(kernel, length, bands, gains, weights, n_bands);
+    }
+    else
+    {
+        double* window = (double*)malloc(2 * length * sizeof(double));
+        if (!window)
+        {
+            return NULL_PTR_ERROR;
+        }
+        double* temp = window + length;
+
+        if (spec->method == FIR_KAISER)
+        {
+            kaiserD(length, kaiser_beta(spec->attenuation) / M_PI, window);
+        }
+        else
+        {
+            WindowFunctionD* taper = WindowFunctionInitD(length, spec->window);
+            if (!taper)
+            {
+                free(window);
+                return NULL_PTR_ERROR;
+            }
+            FillBufferD(window, length, 1.0);
+            WindowFunctionProcessD(taper, window, window, length);
+            WindowFunctionFreeD(taper);
+        }
+
+        // Highpass and bandstop kernels are a delta minus a lowpass or
+        // bandpass kernel
+        const double edge = (spec->type == HIGHPASS) ? spec->cutoff : spec->cutoff_high;
+        windowed_lowpass(kernel, length, (spec->type == LOWPASS) ? spec->cutoff : edge, window);
+        if ((spec->type == BANDPASS) || (spec->type == NOTCH))
+        {
+            windowed_lowpass(temp, length, spec->cutoff, window);
+            VectorVectorSubD(kernel, temp, kernel, length);
+        }
+        if ((spec->type == HIGHPASS) || (spec->type == NOTCH))
+        {
+            VectorNegateD(kernel, kernel, length);
+            kernel[(length - 1) / 2] += 1.0;
+        }
+        free(window);
+    }
+
+    if ((err == NOERR) && spec->minimum_phase)
+    {
+        err = minimum_phase(kernel, kernel, length);
+    }
+    return err;
+}
+
+
+/* Windowed sinc lowpass with unity gain at DC */
+static void
+windowed_lowpass(double* kernel, unsigned length, double cutoff, const double* window)
+{
+    const double center = (length - 1) / 2.0;
+    double sum = 0.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        const double x = i - center;
+        kernel[i] = (x == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+        kernel[i] *= window[i];
+        sum += kernel[i];
+    }
+    VectorScalarMultiplyD(kernel, kernel, 1.0 / sum, length);
+}
+
+
+/* Linear-phase kernel from its amplitude at the DFT bins from DC to nyquist */
+static void
+frequency_sample(double* kernel, unsigned length, const double* amplitude)
+{
+    const double center = (length - 1) / 2.0;
+    const unsigned last = (length - 1) / 2;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        double sum = amplitude[0];
+        for (unsigned k = 1; k <= last; ++k)
+        {
+            sum += 2.0 * amplitude[k] * cos(2.0 * M_PI * k * (i - center) / length);
+        }
+        kernel[i] = sum / length;
+    }
+}
+
+
+/* Parks-McClellan design by the Remez exchange. The amplitude response of a
+ symmetric kernel is a cosine polynomial. Even lengths have a cos(pi * f)
+ factor, which is divided out of the desired response and moved into the
+ weights. The polynomial is interpolated through the extremal frequencies in
+ barycentric form */
+static Error_t
+equiripple(double* kernel, unsigned length, const double* bands, const double* gains,
+           const double* weights, unsigned n_bands)
+{
+    const int odd = length % 2;
+    const unsigned r = odd ? (length + 1) / 2 : length / 2;
+    const double step = 0.5 / (FIR_DESIGN_GRID_DENSITY * r);
+
+    // Even lengths can't do anything at nyquist, so stop the grid short of it
+    const double top = odd ? 0.5 : 0.5 - step;
+
+    // Size the grid
+    unsigned grid_length = 0;
+    for (unsigned b = 0; b < n_bands; ++b)
+    {
+        const double high = (bands[2 * b + 1] > top) ? top : bands[2 * b + 1];
+        if (high >= bands[2 * b])
+        {
+            grid_length += (unsigned)ceil((high - bands[2 * b]) / step) + 1;
+        }
+    }
+    if (grid_length < r + 1)
+    {
+        return VALUE_ERROR;
+    }
+
+    double* grid = (double*)malloc((5 * grid_length + 6 * (r + 1)) * sizeof(double));
+    unsigned* band_index = (unsigned*)malloc((2 * grid_length + r + 1) * sizeof(unsigned));
+    if (!grid || !band_index)
+    {
+        free(grid);
+        free(band_index);
+        return NULL_PTR_ERROR;
+    }
+    double* x = grid + grid_length;
+    double* desired = x + grid_length;
+    double* weight = desired + grid_length;
+    double* error = weight + grid_length;
+    double* ext_x = error + grid_length;
+    double* ext_weight = ext_x + (r + 1);
+    double* ext_y = ext_weight + (r + 1);
+    double* amplitude = ext_y + (r + 1);
+    unsigned* ext = band_index + grid_length;
+    unsigned* found = ext + (r + 1);
+
+    // Fill the grid
+    unsigned g = 0;
+    for (unsigned b = 0; b < n_bands; ++b)
+    {
+        const double low = bands[2 * b];
+        const double high = (bands[2 * b + 1] > top) ? top : bands[2 * b + 1];
+        if (high < low)
+        {
+            continue;
+        }
+        const unsigned points = (unsigned)ceil((high - low) / step) + 1;
+        for (unsigned i = 0; i < points; ++i)
+        {
+            const double f = (points > 1) ? low + (high - low) * i / (points - 1) : low;
+            const double c = odd ? 1.0 : cos(M_PI * f);
+            grid[g] = f;
+            x[g] = cos(2.0 * M_PI * f);
+            desired[g] = gains[b] / c;
+            weight[g] = weights[b] * c;
+            band_index[g] = b;
+            ++g;
+        }
+    }
+
+    // Start with evenly spaced extremals
+    for (unsigned i = 0; i <= r; ++i)
+    {
+        ext[i] = (unsigned)(((unsigned long)i * (grid_length - 1)) / r);
+    }
+
+    Error_t err = ERROR;
+    for (unsigned iteration = 0; iteration < FIR_DESIGN_MAX_ITERATIONS; ++iteration)
+    {
+        // Find the deviation that makes the error alternate at the extremals
+        for (unsigned i = 0; i <= r; ++i)
+        {
+            ext_x[i] = x[ext[i]];
+        }
+        double num = 0.0;
+        double den = 0.0;
+        for (unsigned i = 0; i <= r; ++i)
+        {
+            const double w = barycentric_weight(ext_x, i, r + 1);
+            const double sign = (i % 2) ? -1.0 : 1.0;
+            num += w * desired[ext[i]];
+            den += sign * w / weight[ext[i]];
+        }
+        const double deviation = num / den;
+
+        // Interpolate through the first r extremals
+        for (unsigned i = 0; i < r; ++i)
+        {
+            const double sign = (i % 2) ? -1.0 : 1.0;
+            ext_weight[i] = barycentric_weight(ext_x, i, r);
+            ext_y[i] = desired[ext[i]] - sign * deviation / weight[ext[i]];
+        }
+        for (unsigned k = 0; k < grid_length; ++k)
+        {
+            const double a = barycentric_eval(ext_x, ext_weight, ext_y, r, x[k]);
+            error[k] = weight[k] * (desired[k] - a);
+        }
+
+        // Take the alternating extrema of the error that are at least as
+        // large as the deviation. While the deviation is tiny, rounding can
+        // hide one, so fall back to all of them
+        unsigned count = find_extrema(error, band_index, grid_length,
+                                      fabs(deviation) * (1.0 - EQUIRIPPLE_TOLERANCE), found);
+        if (count < r + 1)
+        {
+            count = find_extrema(error, band_index, grid_length, 0.0, found);
+        }
+        if (count < r + 1)
+        {
+            // Lost alternation. Keep the last solution
+            break;
+        }
+
+        // Drop the smaller end until there are r + 1 extremals
+        unsigned first = 0;
+        while (count > r + 1)
+        {
+            if (fabs(error[found[first]]) < fabs(error[found[first + count - 1]]))
+            {
+                ++first;
+            }
+            --count;
+        }
+
+        // Done when the extremals stop moving, or their errors are equal
+        double high = 0.0;
+        double low = INFINITY;
+        int moved = 0;
+        for (unsigned i = 0; i <= r; ++i)
+        {
+            const double e = fabs(error[found[first + i]]);
+            high = (e > high) ? e : high;
+            low = (e < low) ? e : low;
+            moved = moved || (ext[i] != found[first + i]);
+            ext[i] = found[first + i];
+        }
+        if (!moved || ((high - low) <= EQUIRIPPLE_TOLERANCE * high))
+        {
+            err = NOERR;
+            break;
+        }
+    }
+
+    // Sample the amplitude response at the DFT bins and transform it
+    for (unsigned k = 0; k <= length / 2; ++k)
+    {
+        const double f = (double)k / length;
+        const double c = odd ? 1.0 : cos(M_PI * f);
+        amplitude[k] = c * barycentric_eval(ext_x, ext_weight, ext_y, r, cos(2.0 * M_PI * f));
+    }
+    frequency_sample(kernel, length, amplitude);
+
+    free(band_index);
+    free(grid);
+    return err;
+}
+
+
+/* Find the local extrema of the error with magnitude of at least floor,
+ keeping the larger of neighbours with the same sign. Band edges only have one
+ neighbour. Returns the number found */
+static unsigned
+find_extrema(const double* error, const unsigned* band_index, unsigned grid_length,
+             double floor, unsigned* found)
+{
+    unsigned count = 0;
+    for (unsigned k = 0; k < grid_length; ++k)
+    {
+        const double e = error[k];
+        const int has_prev = (k > 0) && (band_index[k - 1] == band_index[k]);
+        const int has_next = (k + 1 < grid_length) && (band_index[k + 1] == band_index[k]);
+        int extremum;
+        if (e > 0.0)
+        {
+            extremum = (!has_prev || e > error[k - 1]) && (!has_next || e >= error[k + 1]);
+        }
+        else
+        {
+            extremum = (!has_prev || e < error[k - 1]) && (!has_next || e <= error[k + 1]);
+        }
+        if (!extremum || fabs(e) < floor)
+        {
+            continue;
+        }
+
+        if ((count > 0) && ((error[found[count - 1]] > 0.0) == (e > 0.0)))
+        {
+            if (fabs(e) > fabs(error[found[count - 1]]))
+            {
+                found[count - 1] = k;
+            }
+        }
+        else
+        {
+            found[count++] = k;
+        }
+    }
+    return count;
+}
+
+/* Barycentric weight of point k among n points. The product is taken in
+ interleaved passes and scaled by 2 so that it doesn't underflow */
+static double
+barycentric_weight(const double* x, unsigned k, unsigned n)
+{
+    const unsigned stride = (n - 1) / 15 + 1;
+    double product = 1.0;
+    for (unsigned start = 0; start < stride; ++start)
+    {
+        for (unsigned j = start; j < n; j += stride)
+        {
+            if (j != k)
+            {
+                product *= 2.0 * (x[k] - x[j]);
+            }
+        }
+    }
+    return 1.0 / product;
+}
+
+
+/* Evaluate the polynomial through (x, y) at point */
+static double
+barycentric_eval(const double* x, const double* weights, const double* y, unsigned n,
+                 double point)
+{
+    double num = 0.0;
+    double den = 0.0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        const double diff = point - x[i];
+        if (fabs(diff) < 1e-14)
+        {
+            return y[i];
+        }
+        const double w = weights[i] / diff;
+        num += w * y[i];
+        den += w;
+    }
+    return num / den;
+}
+
+
+/* Homomorphic minimum-phase conversion. The real cepstrum of the magnitude
+ response is folded onto positive quefrencies, which gives the log spectrum of
+ the minimum-phase kernel with the same magnitude */
+static Error_t
+minimum_phase(double* dest, const double* kernel, unsigned length)
+{
+    const unsigned fft_length = FFTNextGoodLength(MIN_PHASE_OVERSAMPLE * length < 64 ?
+                                                  64 : MIN_PHASE_OVERSAMPLE * length);
+    FFTConfigD* fft = FFTInitD(fft_length);
+    double* real = (double*)malloc(2 * fft_length * sizeof(double));
+    if (!fft || !real)
+    {
+        if (fft)
+        {
+            FFTFreeD(fft);
+        }
+        free(real);
+        return NULL_PTR_ERROR;
+    }
+    double* imag = real + fft_length;
+
+    // Log magnitude response
+    CopyBufferD(real, kernel, length);
+    ClearBufferD(real + length, fft_length - length);
+    ClearBufferD(imag, fft_length);
+    FFT_C2CD(fft, real, imag, real, imag);
+
+    double peak = 0.0;
+    for (unsigned k = 0; k < fft_length; ++k)
+    {
+        real[k] = sqrt(real[k] * real[k] + imag[k] * imag[k]);
+        peak = (real[k] > peak) ? real[k] : peak;
+    }
+    const double floor = (peak > 0.0) ? peak * MIN_PHASE_FLOOR : MIN_PHASE_FLOOR;
+    for (unsigned k = 0; k < fft_length; ++k)
+    {
+        real[k] = log((real[k] > floor) ? real[k] : floor);
+    }
+    ClearBufferD(imag, fft_length);
+
+    // Fold the cepstrum
+    IFFT_C2CD(fft, real, imag, real, imag);
+    for (unsigned n = 1; n < fft_length / 2; ++n)
+    {
+        real[n] *= 2.0;
+    }
+    ClearBufferD(real + fft_length / 2 + 1, fft_length / 2 - 1);
+    ClearBufferD(imag, fft_length);
+
+    // Back to the complex log spectrum, then to the kernel
+    FFT_C2CD(fft, real, imag, real, imag);
+    for (unsigned k = 0; k < fft_length; ++k)
+    {
+        const double magnitude = exp(real[k]);
+        const double phase = imag[k];
+        real[k] = magnitude * cos(phase);
+        imag[k] = magnitude * sin(phase);
+    }
+    IFFT_C2CD(fft, real, imag, real, imag);
+    CopyBufferD(dest, real, length);
+
+    FFTFreeD(fft);
+    free(real);
+    return NOERR;
+}
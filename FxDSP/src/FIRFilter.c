@@ -12,6 +12,96 @@
 #include <stdlib.h>
 
 
+/* Kernel update states. The back buffer belongs to FIRFilterUpdateKernel while
+ IDLE or WRITING, and to FIRFilterProcess once PENDING has been taken */
+#define KERNEL_IDLE     (0)
+#define KERNEL_WRITING  (1)
+#define KERNEL_PENDING  (2)
+#define KERNEL_FADING   (3)
+
+#define KERNEL_STATE_LOAD(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define KERNEL_STATE_STORE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+
+/* Static Function Prototypes */
+static void
+direct_block(FIRFilter* filter, float* out, const float* in, unsigned n_samples,
+             float* buffer);
+
+static void
+direct_blockD(FIRFilterD* filter, double* out, const double* in, unsigned n_samples,
+              double* buffer);
+
+static void
+fft_block(FIRFilter* filter, float* out, const float* in, unsigned n_samples);
+
+static void
+overlap_add(FIRFilter* filter, float* buffer, float* overlap, unsigned n_samples);
+
+static void
+fft_blockD(FIRFilterD* filter, double* out, const double* in, unsigned n_samples);
+
+static void
+overlap_addD(FIRFilterD* filter, double* buffer, double* overlap, unsigned n_samples);
+
+static void
+fft_kernel(FIRFilter* filter, const float* kernel, FFTSplitComplex spectrum);
+
+static void
+fft_kernelD(FIRFilterD* filter, const double* kernel, FFTSplitComplexD spectrum);
+
+static int
+kernel_state_swap(int* state, int from, int to);
+
+static void
+kernel_swap_start(FIRFilter* filter);
+
+static void
+kernel_swap_startD(FIRFilterD* filter);
+
+static void
+kernel_swap_finish(FIRFilter* filter);
+
+static void
+kernel_swap_finishD(FIRFilterD* filter);
+
+static void
+kernel_crossfade(FIRFilter* filter, float* out, const float* in, unsigned n_samples);
+
+static void
+kernel_crossfadeD(FIRFilterD* filter, double* out, const double* in, unsigned n_samples);
+
+static void
+partition_free(FIRFilter* filter);
+
+static void
+partition_freeD(FIRFilterD* filter);
+
+static Error_t
+partition_init(FIRFilter* filter, unsigned block_length);
+
+static Error_t
+partition_initD(FIRFilterD* filter, unsigned block_length);
+
+static void
+partition_kernel(FIRFilter* filter, const float* kernel, float* partitions);
+
+static void
+partition_kernelD(FIRFilterD* filter, const double* kernel, double* partitions);
+
+static void
+partition_apply(FIRFilter* filter, const float* partitions);
+
+static void
+partition_applyD(FIRFilterD* filter, const double* partitions);
+
+static void
+partition_block(FIRFilter* filter);
+
+static void
+partition_blockD(FIRFilterD* filter);
+
+
 /* FIRFilter ***********************************************************/
 struct FIRFilter
 {
@@ -24,6 +114,31 @@ struct FIRFilter
     FFTConfig*          fft_config;
     FFTSplitComplex     fft_kernel;
     unsigned            fft_length;
+    unsigned            max_block_size;
+    float*              work;
+    unsigned            block_length;
+    unsigned            partition_count;
+    unsigned            partition_index;
+    unsigned            block_fill;
+    float*              partitions;
+    float*              fdl;
+    float*              frame;
+    float*              accum;
+    float*              scratch;
+    float*              block_out;
+    float*              next_kernel;
+    float*              fade_overlap;
+    FFTSplitComplex     next_fft_kernel;
+    float*              next_partitions;
+    float*              spectrum_buffer;
+    float*              partition_buffer;
+    FFTConfig*          update_config;
+    float*              update_scratch;
+    unsigned            crossfade_length;
+    unsigned            fade_position;
+    int                 kernel_state;
+    Symmetry_t          symmetry;
+    Symmetry_t          next_symmetry;
 };
 
 struct FIRFilterD
@@ -37,6 +152,31 @@ struct FIRFilterD
     FFTConfigD*         fft_config;
     FFTSplitComplexD    fft_kernel;
     unsigned            fft_length;
+    unsigned            max_block_size;
+    double*             work;
+    unsigned            block_length;
+    unsigned            partition_count;
+    unsigned            partition_index;
+    unsigned            block_fill;
+    double*             partitions;
+    double*             fdl;
+    double*             frame;
+    double*             accum;
+    double*             scratch;
+    double*             block_out;
+    double*             next_kernel;
+    double*             fade_overlap;
+    FFTSplitComplexD    next_fft_kernel;
+    double*             next_partitions;
+    double*             spectrum_buffer;
+    double*             partition_buffer;
+    FFTConfigD*         update_config;
+    double*             update_scratch;
+    unsigned            crossfade_length;
+    unsigned            fade_position;
+    int                 kernel_state;
+    Symmetry_t          symmetry;
+    Symmetry_t          next_symmetry;
 };
 
 /* FIRFilterInit *******************************************************/
@@ -56,11 +196,15 @@ FIRFilterInit(const float*       filter_kernel,
     FIRFilter* filter = (FIRFilter*)malloc(sizeof(FIRFilter));
     float* kernel = (float*)malloc(kernel_length * sizeof(float));
     float* overlap = (float*)malloc(overlap_length * sizeof(float));
-    if (filter && kernel && overlap)
+    float* next_kernel = (float*)malloc(kernel_length * sizeof(float));
+    float* fade_overlap = (float*)malloc(overlap_length * sizeof(float));
+    if (filter && kernel && overlap && next_kernel && fade_overlap)
     {
         // Initialize Buffers
         CopyBuffer(kernel, filter_kernel, kernel_length);
         ClearBuffer(overlap, overlap_length);
+        CopyBuffer(next_kernel, filter_kernel, kernel_length);
+        ClearBuffer(fade_overlap, overlap_length);
 
         // Set up the struct
         filter->kernel = kernel;
@@ -71,6 +215,32 @@ FIRFilterInit(const float*       filter_kernel,
         filter->fft_config = NULL;
         filter->fft_kernel.realp = NULL;
         filter->fft_kernel.imagp = NULL;
+        filter->spectrum_buffer = NULL;
+        filter->max_block_size = 0;
+        filter->work = NULL;
+        filter->block_length = 0;
+        filter->partition_count = 0;
+        filter->partition_index = 0;
+        filter->block_fill = 0;
+        filter->partitions = NULL;
+        filter->partition_buffer = NULL;
+        filter->fdl = NULL;
+        filter->frame = NULL;
+        filter->accum = NULL;
+        filter->scratch = NULL;
+        filter->block_out = NULL;
+        filter->next_kernel = next_kernel;
+        filter->fade_overlap = fade_overlap;
+        filter->next_fft_kernel.realp = NULL;
+        filter->next_fft_kernel.imagp = NULL;
+        filter->next_partitions = NULL;
+        filter->update_config = NULL;
+        filter->update_scratch = NULL;
+        filter->crossfade_length = 0;
+        filter->fade_position = 0;
+        filter->kernel_state = KERNEL_IDLE;
+        filter->symmetry = KernelSymmetry(kernel, kernel_length);
+        filter->next_symmetry = filter->symmetry;
 
         if (((convolution_mode == BEST) &&
              (kernel_length < USE_FFT_CONVOLUTION_LENGTH)) ||
@@ -79,6 +249,11 @@ FIRFilterInit(const float*       filter_kernel,
             filter->conv_mode = DIRECT;
         }
 
+        else if (convolution_mode == PARTITIONED)
+        {
+            filter->conv_mode = PARTITIONED;
+        }
+
         else
         {
             filter->conv_mode = FFT;
@@ -92,6 +267,8 @@ FIRFilterInit(const float*       filter_kernel,
         free(filter);
         free(kernel);
         free(overlap);
+        free(next_kernel);
+        free(fade_overlap);
         return NULL;
     }
 }
@@ -113,11 +290,15 @@ FIRFilterInitD(const double*        filter_kernel,
     FIRFilterD* filter = (FIRFilterD*)malloc(sizeof(FIRFilterD));
     double* kernel = (double*)malloc(kernel_length * sizeof(double));
     double* overlap = (double*)malloc(overlap_length * sizeof(double));
-    if (filter && kernel && overlap)
+    double* next_kernel = (double*)malloc(kernel_length * sizeof(double));
+    double* fade_overlap = (double*)malloc(overlap_length * sizeof(double));
+    if (filter && kernel && overlap && next_kernel && fade_overlap)
     {
         // Initialize Buffers
         CopyBufferD(kernel, filter_kernel, kernel_length);
         ClearBufferD(overlap, overlap_length);
+        CopyBufferD(next_kernel, filter_kernel, kernel_length);
+        ClearBufferD(fade_overlap, overlap_length);
 
         // Set up the struct
         filter->kernel = kernel;
@@ -128,6 +309,32 @@ FIRFilterInitD(const double*        filter_kernel,
         filter->fft_config = NULL;
         filter->fft_kernel.realp = NULL;
         filter->fft_kernel.imagp = NULL;
+        filter->spectrum_buffer = NULL;
+        filter->max_block_size = 0;
+        filter->work = NULL;
+        filter->block_length = 0;
+        filter->partition_count = 0;
+        filter->partition_index = 0;
+        filter->block_fill = 0;
+        filter->partitions = NULL;
+        filter->partition_buffer = NULL;
+        filter->fdl = NULL;
+        filter->frame = NULL;
+        filter->accum = NULL;
+        filter->scratch = NULL;
+        filter->block_out = NULL;
+        filter->next_kernel = next_kernel;
+        filter->fade_overlap = fade_overlap;
+        filter->next_fft_kernel.realp = NULL;
+        filter->next_fft_kernel.imagp = NULL;
+        filter->next_partitions = NULL;
+        filter->update_config = NULL;
+        filter->update_scratch = NULL;
+        filter->crossfade_length = 0;
+        filter->fade_position = 0;
+        filter->kernel_state = KERNEL_IDLE;
+        filter->symmetry = KernelSymmetryD(kernel, kernel_length);
+        filter->next_symmetry = filter->symmetry;
 
         if (((convolution_mode == BEST) &&
              (kernel_length < USE_FFT_CONVOLUTION_LENGTH)) ||
@@ -136,6 +343,11 @@ FIRFilterInitD(const double*        filter_kernel,
             filter->conv_mode = DIRECT;
         }
 
+        else if (convolution_mode == PARTITIONED)
+        {
+            filter->conv_mode = PARTITIONED;
+        }
+
         else
         {
             filter->conv_mode = FFT;
@@ -149,6 +361,8 @@ FIRFilterInitD(const double*        filter_kernel,
         free(filter);
         free(kernel);
         free(overlap);
+        free(next_kernel);
+        free(fade_overlap);
         return NULL;
     }
 }
@@ -169,17 +383,45 @@ FIRFilterFree(FIRFilter * filter)
             free(filter->overlap);
             filter->overlap = NULL;
         }
+        if (filter->next_kernel)
+        {
+            free(filter->next_kernel);
+            filter->next_kernel = NULL;
+        }
+        if (filter->fade_overlap)
+        {
+            free(filter->fade_overlap);
+            filter->fade_overlap = NULL;
+        }
 
         if (filter->fft_config)
         {
-            //FFTFree(filter->fft_config);
+            FFTFree(filter->fft_config);
             filter->fft_config = NULL;
         }
 
-        if (filter->fft_kernel.realp)
+        if (filter->update_config)
         {
-            free(filter->fft_kernel.realp);
-            filter->fft_kernel.realp = NULL;
+            FFTFree(filter->update_config);
+            filter->update_config = NULL;
+        }
+
+        if (filter->spectrum_buffer)
+        {
+            free(filter->spectrum_buffer);
+            filter->spectrum_buffer = NULL;
+        }
+
+        if (filter->partition_buffer)
+        {
+            free(filter->partition_buffer);
+            filter->partition_buffer = NULL;
+        }
+
+        if (filter->work)
+        {
+            free(filter->work);
+            filter->work = NULL;
         }
         free(filter);
         filter = NULL;
@@ -202,6 +444,16 @@ FIRFilterFreeD(FIRFilterD * filter)
             free(filter->overlap);
             filter->overlap = NULL;
         }
+        if (filter->next_kernel)
+        {
+            free(filter->next_kernel);
+            filter->next_kernel = NULL;
+        }
+        if (filter->fade_overlap)
+        {
+            free(filter->fade_overlap);
+            filter->fade_overlap = NULL;
+        }
 
         if (filter->fft_config)
         {
@@ -209,10 +461,28 @@ FIRFilterFreeD(FIRFilterD * filter)
             filter->fft_config = NULL;
         }
 
-        if (filter->fft_kernel.realp)
+        if (filter->update_config)
         {
-            free(filter->fft_kernel.realp);
-            filter->fft_kernel.realp = NULL;
+            FFTFreeD(filter->update_config);
+            filter->update_config = NULL;
+        }
+
+        if (filter->spectrum_buffer)
+        {
+            free(filter->spectrum_buffer);
+            filter->spectrum_buffer = NULL;
+        }
+
+        if (filter->partition_buffer)
+        {
+            free(filter->partition_buffer);
+            filter->partition_buffer = NULL;
+        }
+
+        if (filter->work)
+        {
+            free(filter->work);
+            filter->work = NULL;
         }
 
         free(filter);
@@ -226,22 +496,258 @@ FIRFilterFreeD(FIRFilterD * filter)
 Error_t
 FIRFilterFlush(FIRFilter* filter)
 {
-    // The only stateful part of this is the overlap buffer, so this just
-    //zeros it out
+    // The only stateful part of the direct and FFT modes is the overlap
+    // buffer, so this just zeros it out
     ClearBuffer(filter->overlap, filter->overlap_length);
+
+    // A kernel that is being faded in takes over straight away
+    if (KERNEL_STATE_LOAD(&filter->kernel_state) == KERNEL_FADING)
+    {
+        kernel_swap_finish(filter);
+    }
+
+    // Partitioned mode also holds the input history and the pending block
+    if (filter->partitions)
+    {
+        ClearBuffer(filter->fdl, filter->partition_count * filter->fft_length);
+        ClearBuffer(filter->frame, filter->fft_length);
+        ClearBuffer(filter->block_out, filter->block_length);
+        filter->partition_index = 0;
+        filter->block_fill = 0;
+    }
     return NOERR;
 }
 
 Error_t
 FIRFilterFlushD(FIRFilterD* filter)
 {
-    // The only stateful part of this is the overlap buffer, so this just
-    //zeros it out
+    // The only stateful part of the direct and FFT modes is the overlap
+    // buffer, so this just zeros it out
     ClearBufferD(filter->overlap, filter->overlap_length);
+
+    // A kernel that is being faded in takes over straight away
+    if (KERNEL_STATE_LOAD(&filter->kernel_state) == KERNEL_FADING)
+    {
+        kernel_swap_finishD(filter);
+    }
+
+    // Partitioned mode also holds the input history and the pending block
+    if (filter->partitions)
+    {
+        ClearBufferD(filter->fdl, filter->partition_count * filter->fft_length);
+        ClearBufferD(filter->frame, filter->fft_length);
+        ClearBufferD(filter->block_out, filter->block_length);
+        filter->partition_index = 0;
+        filter->block_fill = 0;
+    }
     return NOERR;
 }
 
 
+/* FIRFilterSetCrossfade ***********************************************/
+Error_t
+FIRFilterSetCrossfade(FIRFilter*  filter, unsigned n_samples)
+{
+    if (filter)
+    {
+        filter->crossfade_length = n_samples;
+        return NOERR;
+    }
+    return ERROR;
+}
+
+Error_t
+FIRFilterSetCrossfadeD(FIRFilterD* filter, unsigned n_samples)
+{
+    if (filter)
+    {
+        filter->crossfade_length = n_samples;
+        return NOERR;
+    }
+    return ERROR;
+}
+
+
+/* FIRFilterPrepare ****************************************************/
+Error_t
+FIRFilterPrepare(FIRFilter* filter, unsigned max_block_size)
+{
+    if (!filter)
+    {
+        return ERROR;
+    }
+
+    if (max_block_size == 0)
+    {
+        return VALUE_ERROR;
+    }
+
+    // Partitioned mode needs no extra scratch, just the partitions
+    if (filter->conv_mode == PARTITIONED)
+    {
+        partition_free(filter);
+        return (partition_init(filter, max_block_size) == NOERR) ? NOERR : NULL_PTR_ERROR;
+    }
+
+    // Direct mode needs room for the full result of a block, FFT mode needs
+    // room for an FFT that long
+    unsigned work_length = max_block_size + filter->kernel_length - 1;
+    unsigned fft_length = 0;
+    FFTConfig* fft_config = NULL;
+    FFTConfig* update_config = NULL;
+    float* spectrum = NULL;
+    if (filter->conv_mode == FFT)
+    {
+        fft_length = FFTNextGoodLength(work_length);
+        work_length = fft_length;
+        fft_config = FFTInit(fft_length);
+        update_config = FFTInit(fft_length);
+
+        // Kernel spectrum, the spectrum of the next kernel and scratch space
+        // to calculate it in
+        spectrum = (float*)malloc(3 * fft_length * sizeof(float));
+    }
+    float* work = (float*)malloc(work_length * sizeof(float));
+
+    if (work && ((filter->conv_mode != FFT) || (fft_config && update_config && spectrum)))
+    {
+        // Release anything from an earlier call
+        if (filter->fft_config)
+        {
+            FFTFree(filter->fft_config);
+        }
+        if (filter->update_config)
+        {
+            FFTFree(filter->update_config);
+        }
+        free(filter->spectrum_buffer);
+        free(filter->work);
+
+        filter->max_block_size = max_block_size;
+        filter->work = work;
+        filter->fft_config = fft_config;
+        filter->update_config = update_config;
+        filter->fft_length = fft_length;
+        filter->spectrum_buffer = spectrum;
+        filter->fft_kernel.realp = spectrum;
+        filter->fft_kernel.imagp = spectrum ? spectrum + fft_length / 2 : NULL;
+        filter->next_fft_kernel.realp = spectrum ? spectrum + fft_length : NULL;
+        filter->next_fft_kernel.imagp = spectrum ? spectrum + 3 * fft_length / 2 : NULL;
+        filter->update_scratch = spectrum ? spectrum + 2 * fft_length : NULL;
+        if (fft_config)
+        {
+            fft_kernel(filter, filter->kernel, filter->fft_kernel);
+            fft_kernel(filter, filter->next_kernel, filter->next_fft_kernel);
+        }
+        return NOERR;
+    }
+
+    else
+    {
+        if (fft_config)
+        {
+            FFTFree(fft_config);
+        }
+        if (update_config)
+        {
+            FFTFree(update_config);
+        }
+        free(spectrum);
+        free(work);
+        return NULL_PTR_ERROR;
+    }
+}
+
+Error_t
+FIRFilterPrepareD(FIRFilterD* filter, unsigned max_block_size)
+{
+    if (!filter)
+    {
+        return ERROR;
+    }
+
+    if (max_block_size == 0)
+    {
+        return VALUE_ERROR;
+    }
+
+    // Partitioned mode needs no extra scratch, just the partitions
+    if (filter->conv_mode == PARTITIONED)
+    {
+        partition_freeD(filter);
+        return (partition_initD(filter, max_block_size) == NOERR) ? NOERR : NULL_PTR_ERROR;
+    }
+
+    // Direct mode needs room for the full result of a block, FFT mode needs
+    // room for an FFT that long
+    unsigned work_length = max_block_size + filter->kernel_length - 1;
+    unsigned fft_length = 0;
+    FFTConfigD* fft_config = NULL;
+    FFTConfigD* update_config = NULL;
+    double* spectrum = NULL;
+    if (filter->conv_mode == FFT)
+    {
+        fft_length = FFTNextGoodLength(work_length);
+        work_length = fft_length;
+        fft_config = FFTInitD(fft_length);
+        update_config = FFTInitD(fft_length);
+
+        // Kernel spectrum, the spectrum of the next kernel and scratch space
+        // to calculate it in
+        spectrum = (double*)malloc(3 * fft_length * sizeof(double));
+    }
+    double* work = (double*)malloc(work_length * sizeof(double));
+
+    if (work && ((filter->conv_mode != FFT) || (fft_config && update_config && spectrum)))
+    {
+        // Release anything from an earlier call
+        if (filter->fft_config)
+        {
+            FFTFreeD(filter->fft_config);
+        }
+        if (filter->update_config)
+        {
+            FFTFreeD(filter->update_config);
+        }
+        free(filter->spectrum_buffer);
+        free(filter->work);
+
+        filter->max_block_size = max_block_size;
+        filter->work = work;
+        filter->fft_config = fft_config;
+        filter->update_config = update_config;
+        filter->fft_length = fft_length;
+        filter->spectrum_buffer = spectrum;
+        filter->fft_kernel.realp = spectrum;
+        filter->fft_kernel.imagp = spectrum ? spectrum + fft_length / 2 : NULL;
+        filter->next_fft_kernel.realp = spectrum ? spectrum + fft_length : NULL;
+        filter->next_fft_kernel.imagp = spectrum ? spectrum + 3 * fft_length / 2 : NULL;
+        filter->update_scratch = spectrum ? spectrum + 2 * fft_length : NULL;
+        if (fft_config)
+        {
+            fft_kernelD(filter, filter->kernel, filter->fft_kernel);
+            fft_kernelD(filter, filter->next_kernel, filter->next_fft_kernel);
+        }
+        return NOERR;
+    }
+
+    else
+    {
+        if (fft_config)
+        {
+            FFTFreeD(fft_config);
+        }
+        if (update_config)
+        {
+            FFTFreeD(update_config);
+        }
+        free(spectrum);
+        free(work);
+        return NULL_PTR_ERROR;
+    }
+}
+
+
 /* FIRFilterProcess ****************************************************/
 Error_t
 FIRFilterProcess(FIRFilter*     filter,
@@ -255,58 +761,92 @@ FIRFilterProcess(FIRFilter*     filter,
         // Do direct convolution
         if (filter->conv_mode == DIRECT)
         {
-            unsigned resultLength = n_samples + (filter->kernel_length - 1);
-            // Temporary buffer to store full result of filtering..
-            float buffer[resultLength];
+            // A prepared filter works through the input in chunks, using its
+            // own buffer. Otherwise the result goes on the stack
+            if (filter->work)
+            {
+                unsigned done = 0;
+                while (done < n_samples)
+                {
+                    unsigned count = n_samples - done;
+                    if (count > filter->max_block_size)
+                    {
+                        count = filter->max_block_size;
+                    }
+                    direct_block(filter, outBuffer + done, inBuffer + done, count,
+                                 filter->work);
+                    done += count;
+                }
+            }
+            else
+            {
+                float buffer[n_samples + (filter->kernel_length - 1)];
+                direct_block(filter, outBuffer, inBuffer, n_samples, buffer);
+            }
+        }
 
-            Convolve((float*)inBuffer, n_samples,
-                            filter->kernel, filter->kernel_length, buffer);
+        // Partitioned convolution runs one block behind the input
+        else if (filter->conv_mode == PARTITIONED)
+        {
+            // The first block sets the partition size, as in FFT mode
+            if (filter->partitions == NULL)
+            {
+                if (partition_init(filter, n_samples) != NOERR)
+                {
+                    return ERROR;
+                }
+            }
 
-            // Add in the overlap from the last block
-            VectorVectorAdd(buffer, filter->overlap, buffer, filter->overlap_length);
-            CopyBuffer(filter->overlap, buffer + n_samples, filter->overlap_length);
-            CopyBuffer(outBuffer, buffer, n_samples);
+            const unsigned block_length = filter->block_length;
+            float* block_in = filter->frame + (filter->fft_length - block_length);
+            unsigned done = 0;
+            while (done < n_samples)
+            {
+                unsigned count = block_length - filter->block_fill;
+                if (count > n_samples - done)
+                {
+                    count = n_samples - done;
+                }
+
+                // Queue the input and read out the last block's output
+                CopyBuffer(block_in + filter->block_fill, inBuffer + done, count);
+                CopyBuffer(outBuffer + done, filter->block_out + filter->block_fill, count);
+                filter->block_fill += count;
+                done += count;
+
+                if (filter->block_fill == block_length)
+                {
+                    partition_block(filter);
+                    filter->block_fill = 0;
+                }
+            }
         }
 
         // Otherwise do FFT Convolution
         else
         {
-            // Configure the FFT on the first run, that way we can figure out how
-            // long the input blocks are going to be. This makes the filter more
-            // complicated internally in order to make the convolution transparent.
-            // Calculate length of FFT
-            if(filter->fft_config == 0)
+            // Prepare the FFT on the first run if FIRFilterPrepare hasn't
+            // been called, so the filter can still be used without it
+            if (filter->fft_config == NULL)
             {
-                // Calculate FFT Length
-                filter->fft_length = next_pow2(n_samples + filter->kernel_length - 1);
-                filter->fft_config = FFTInit(filter->fft_length);
-
-                // fft kernel buffers
-                float padded_kernel[filter->fft_length];
-
-                // Allocate memory for filter kernel
-                filter->fft_kernel.realp = (float*) malloc(filter->fft_length * sizeof(float));
-                filter->fft_kernel.imagp = filter->fft_kernel.realp +(filter->fft_length / 2);
-
-                // Write zero padded kernel to buffer
-                CopyBuffer(padded_kernel, filter->kernel, filter->kernel_length);
-                ClearBuffer((padded_kernel + filter->kernel_length), (filter->fft_length - filter->kernel_length));
-
-                // Calculate FFT of filter kernel
-                FFT_IR_R2C(filter->fft_config, padded_kernel, filter->fft_kernel);
+                Error_t error = FIRFilterPrepare(filter, n_samples);
+                if (error != NOERR)
+                {
+                    return error;
+                }
             }
 
-            // Buffer for transformed input
-            float buffer[filter->fft_length];
-
-            // Convolve
-            FFTFilterConvolve(filter->fft_config, (float*)inBuffer, n_samples, filter->fft_kernel, buffer);
-
-            // Add in the overlap from the last block
-            VectorVectorAdd(buffer, filter->overlap, buffer, filter->overlap_length);
-            CopyBuffer(filter->overlap, buffer + n_samples, filter->overlap_length);
-            CopyBuffer(outBuffer, buffer, n_samples);
-
+            unsigned done = 0;
+            while (done < n_samples)
+            {
+                unsigned count = n_samples - done;
+                if (count > filter->max_block_size)
+                {
+                    count = filter->max_block_size;
+                }
+                fft_block(filter, outBuffer + done, inBuffer + done, count);
+                done += count;
+            }
         }
         return NOERR;
     }
@@ -331,58 +871,92 @@ FIRFilterProcessD(FIRFilterD*   filter,
         // Do direct convolution
         if (filter->conv_mode == DIRECT)
         {
-            unsigned resultLength = n_samples + (filter->kernel_length - 1);
+            // A prepared filter works through the input in chunks, using its
+            // own buffer. Otherwise the result goes on the stack
+            if (filter->work)
+            {
+                unsigned done = 0;
+                while (done < n_samples)
+                {
+                    unsigned count = n_samples - done;
+                    if (count > filter->max_block_size)
+                    {
+                        count = filter->max_block_size;
+                    }
+                    direct_blockD(filter, outBuffer + done, inBuffer + done, count,
+                                  filter->work);
+                    done += count;
+                }
+            }
+            else
+            {
+                double buffer[n_samples + (filter->kernel_length - 1)];
+                direct_blockD(filter, outBuffer, inBuffer, n_samples, buffer);
+            }
+        }
 
-            // Temporary buffer to store full result of filtering..
-            double buffer[resultLength];
+        // Partitioned convolution runs one block behind the input
+        else if (filter->conv_mode == PARTITIONED)
+        {
+            // The first block sets the partition size, as in FFT mode
+            if (filter->partitions == NULL)
+            {
+                if (partition_initD(filter, n_samples) != NOERR)
+                {
+                    return ERROR;
+                }
+            }
 
-            ConvolveD((double*)inBuffer, n_samples,
-                     filter->kernel, filter->kernel_length, buffer);
-            // Add in the overlap from the last block
-            VectorVectorAddD(buffer, filter->overlap, buffer, filter->overlap_length);
-            CopyBufferD(filter->overlap, buffer + n_samples, filter->overlap_length);
-            CopyBufferD(outBuffer, buffer, n_samples);
+            const unsigned block_length = filter->block_length;
+            double* block_in = filter->frame + (filter->fft_length - block_length);
+            unsigned done = 0;
+            while (done < n_samples)
+            {
+                unsigned count = block_length - filter->block_fill;
+                if (count > n_samples - done)
+                {
+                    count = n_samples - done;
+                }
+
+                // Queue the input and read out the last block's output
+                CopyBufferD(block_in + filter->block_fill, inBuffer + done, count);
+                CopyBufferD(outBuffer + done, filter->block_out + filter->block_fill, count);
+                filter->block_fill += count;
+                done += count;
+
+                if (filter->block_fill == block_length)
+                {
+                    partition_blockD(filter);
+                    filter->block_fill = 0;
+                }
+            }
         }
 
         // Otherwise do FFT Convolution
         else
         {
-            // Configure the FFT on the first run, that way we can figure out how
-            // long the input blocks are going to be. This makes the filter more
-            // complicated internally in order to make the convolution transparent.
-            // Calculate length of FFT
-            if(filter->fft_config == 0)
+            // Prepare the FFT on the first run if FIRFilterPrepare hasn't
+            // been called, so the filter can still be used without it
+            if (filter->fft_config == NULL)
             {
-                // Calculate FFT Length
-                filter->fft_length = next_pow2(n_samples + filter->kernel_length - 1); //2 * next_pow2(n_samples + filter->kernel_length - 1);
-                filter->fft_config = FFTInitD(filter->fft_length);
-
-                // fft kernel buffers
-                double padded_kernel[filter->fft_length];
-
-                // Allocate memory for filter kernel
-                filter->fft_kernel.realp = (double*) malloc(filter->fft_length * sizeof(double));
-                filter->fft_kernel.imagp = filter->fft_kernel.realp +(filter->fft_length / 2);
-
-                // Write zero padded kernel to buffer
-                CopyBufferD(padded_kernel, filter->kernel, filter->kernel_length);
-                ClearBufferD((padded_kernel + filter->kernel_length), (filter->fft_length - filter->kernel_length));
-
-                // Calculate FFT of filter kernel
-                FFT_IR_R2CD(filter->fft_config, padded_kernel, filter->fft_kernel);
+                Error_t error = FIRFilterPrepareD(filter, n_samples);
+                if (error != NOERR)
+                {
+                    return error;
+                }
             }
 
-            // Buffer for transformed input
-            double buffer[filter->fft_length];
-
-            // Convolve
-            FFTFilterConvolveD(filter->fft_config, (double*)inBuffer, n_samples, filter->fft_kernel, buffer);
-
-            // Add in the overlap from the last block
-            VectorVectorAddD(buffer, filter->overlap, buffer, filter->overlap_length);
-            CopyBufferD(filter->overlap, buffer + n_samples, filter->overlap_length);
-            CopyBufferD(outBuffer, buffer, n_samples);
-
+            unsigned done = 0;
+            while (done < n_samples)
+            {
+                unsigned count = n_samples - done;
+                if (count > filter->max_block_size)
+                {
+                    count = filter->max_block_size;
+                }
+                fft_blockD(filter, outBuffer + done, inBuffer + done, count);
+                done += count;
+            }
         }
         return NOERR;
     }
@@ -397,15 +971,670 @@ FIRFilterProcessD(FIRFilterD*   filter,
 Error_t
 FIRFilterUpdateKernel(FIRFilter*  filter, const float* filter_kernel)
 {
-    // Copy the new kernel into the filter
-    CopyBuffer(filter->kernel, filter_kernel, filter->kernel_length);
+    // The back buffer can't be written while the last kernel is fading in.
+    // A kernel that hasn't been picked up yet is simply replaced
+    if (!kernel_state_swap(&filter->kernel_state, KERNEL_IDLE, KERNEL_WRITING) &&
+        !kernel_state_swap(&filter->kernel_state, KERNEL_PENDING, KERNEL_WRITING))
+    {
+        return ERROR;
+    }
+
+    // Copy the new kernel into the back buffer and transform it there, so the
+    // audio thread never has to
+    CopyBuffer(filter->next_kernel, filter_kernel, filter->kernel_length);
+    filter->next_symmetry = KernelSymmetry(filter->next_kernel, filter->kernel_length);
+    if (filter->update_config)
+    {
+        if (filter->conv_mode == FFT)
+        {
+            fft_kernel(filter, filter->next_kernel, filter->next_fft_kernel);
+        }
+        else
+        {
+            partition_kernel(filter, filter->next_kernel, filter->next_partitions);
+        }
+    }
+
+    // Hand it over to FIRFilterProcess
+    KERNEL_STATE_STORE(&filter->kernel_state, KERNEL_PENDING);
     return NOERR;
 }
 
 Error_t
-FIRFilterUpdateKernelD(FIRFilterD*  filter, const double* filter_kernel)
+FIRFilterUpdateKernelD(FIRFilterD* filter, const double* filter_kernel)
 {
-    // Copy the new kernel into the filter
-    CopyBufferD(filter->kernel, filter_kernel, filter->kernel_length);
+    // The back buffer can't be written while the last kernel is fading in.
+    // A kernel that hasn't been picked up yet is simply replaced
+    if (!kernel_state_swap(&filter->kernel_state, KERNEL_IDLE, KERNEL_WRITING) &&
+        !kernel_state_swap(&filter->kernel_state, KERNEL_PENDING, KERNEL_WRITING))
+    {
+        return ERROR;
+    }
+
+    // Copy the new kernel into the back buffer and transform it there, so the
+    // audio thread never has to
+    CopyBufferD(filter->next_kernel, filter_kernel, filter->kernel_length);
+    filter->next_symmetry = KernelSymmetryD(filter->next_kernel, filter->kernel_length);
+    if (filter->update_config)
+    {
+        if (filter->conv_mode == FFT)
+        {
+            fft_kernelD(filter, filter->next_kernel, filter->next_fft_kernel);
+        }
+        else
+        {
+            partition_kernelD(filter, filter->next_kernel, filter->next_partitions);
+        }
+    }
+
+    // Hand it over to FIRFilterProcess
+    KERNEL_STATE_STORE(&filter->kernel_state, KERNEL_PENDING);
     return NOERR;
 }
+
+
+/* Set up partitioned convolution for blocks of block_length samples. Each
+ kernel partition is block_length long and zero padded to an FFT of at least
+ twice that, so the newest block of the overlap-save output is never wrapped */
+static Error_t
+partition_init(FIRFilter* filter, unsigned block_length)
+{
+    const unsigned fft_length = FFTNextGoodLength(2 * block_length);
+    const unsigned count = (filter->kernel_length + block_length - 1) / block_length;
+
+    // Kernel spectra for the current and next kernels and the delay line,
+    // then the frame, accumulator, scratch and output buffers all share one
+    // allocation
+    const unsigned total = (3 * count + 4) * fft_length + block_length;
+    FFTConfig* fft_config = FFTInit(fft_length);
+    FFTConfig* update_config = FFTInit(fft_length);
+    float* buffer = (float*)malloc(total * sizeof(float));
+
+    if (fft_config && update_config && buffer)
+    {
+        ClearBuffer(buffer, total);
+        filter->fft_config = fft_config;
+        filter->fft_length = fft_length;
+        filter->block_length = block_length;
+        filter->partition_count = count;
+        filter->partition_index = 0;
+        filter->block_fill = 0;
+        filter->update_config = update_config;
+        filter->partition_buffer = buffer;
+        filter->partitions = buffer;
+        filter->next_partitions = filter->partitions + count * fft_length;
+        filter->fdl = filter->next_partitions + count * fft_length;
+        filter->frame = filter->fdl + count * fft_length;
+        filter->accum = filter->frame + fft_length;
+        filter->scratch = filter->accum + fft_length;
+        filter->update_scratch = filter->scratch + fft_length;
+        filter->block_out = filter->update_scratch + fft_length;
+        partition_kernel(filter, filter->kernel, filter->partitions);
+        partition_kernel(filter, filter->next_kernel, filter->next_partitions);
+        return NOERR;
+    }
+
+    else
+    {
+        if (fft_config)
+        {
+            FFTFree(fft_config);
+        }
+        if (update_config)
+        {
+            FFTFree(update_config);
+        }
+        free(buffer);
+        return ERROR;
+    }
+}
+
+/* Calculate the spectrum of each kernel partition */
+static void
+partition_kernel(FIRFilter* filter, const float* kernel, float* partitions)
+{
+    const unsigned fft_length = filter->fft_length;
+    const unsigned block_length = filter->block_length;
+    FFTSplitComplex spectrum;
+
+    for (unsigned i = 0; i < filter->partition_count; ++i)
+    {
+        unsigned offset = i * block_length;
+        unsigned length = filter->kernel_length - offset;
+        if (length > block_length)
+        {
+            length = block_length;
+        }
+
+        ClearBuffer(filter->update_scratch, fft_length);
+        CopyBuffer(filter->update_scratch, kernel + offset, length);
+        spectrum.realp = partitions + i * fft_length;
+        spectrum.imagp = spectrum.realp + fft_length / 2;
+        FFT_IR_R2C(filter->update_config, filter->update_scratch, spectrum);
+    }
+}
+
+/* Filter one full block of input, using uniformly partitioned overlap-save */
+static void
+partition_block(FIRFilter* filter)
+{
+    const unsigned fft_length = filter->fft_length;
+    const unsigned block_length = filter->block_length;
+    FFTSplitComplex input;
+
+    // Pick up a new kernel at the block boundary
+    kernel_swap_start(filter);
+
+    // Transform the newest frame into the frequency-domain delay line
+    input.realp = filter->fdl + filter->partition_index * fft_length;
+    input.imagp = input.realp + fft_length / 2;
+    FFT_IR_R2C(filter->fft_config, filter->frame, input);
+
+    // Only the end of the circular convolution is free of wrap-around
+    partition_apply(filter, filter->partitions);
+    CopyBuffer(filter->block_out, filter->scratch + (fft_length - block_length),
+               block_length);
+
+    // The delay line doesn't depend on the kernel, so a new kernel can be
+    // faded in with the full input history behind it
+    if (KERNEL_STATE_LOAD(&filter->kernel_state) == KERNEL_FADING)
+    {
+        partition_apply(filter, filter->next_partitions);
+        kernel_crossfade(filter, filter->block_out,
+                         filter->scratch + (fft_length - block_length), block_length);
+    }
+
+    // Slide the frame along to make room for the next block
+    memmove(filter->frame, filter->frame + block_length,
+            (fft_length - block_length) * sizeof(float));
+    filter->partition_index = (filter->partition_index + 1) % filter->partition_count;
+}
+
+/* Set up partitioned convolution for blocks of block_length samples. Each
+ kernel partition is block_length long and zero padded to an FFT of at least
+ twice that, so the newest block of the overlap-save output is never wrapped */
+static Error_t
+partition_initD(FIRFilterD* filter, unsigned block_length)
+{
+    const unsigned fft_length = FFTNextGoodLength(2 * block_length);
+    const unsigned count = (filter->kernel_length + block_length - 1) / block_length;
+
+    // Kernel spectra for the current and next kernels and the delay line,
+    // then the frame, accumulator, scratch and output buffers all share one
+    // allocation
+    const unsigned total = (3 * count + 4) * fft_length + block_length;
+    FFTConfigD* fft_config = FFTInitD(fft_length);
+    FFTConfigD* update_config = FFTInitD(fft_length);
+    double* buffer = (double*)malloc(total * sizeof(double));
+
+    if (fft_config && update_config && buffer)
+    {
+        ClearBufferD(buffer, total);
+        filter->fft_config = fft_config;
+        filter->fft_length = fft_length;
+        filter->block_length = block_length;
+        filter->partition_count = count;
+        filter->partition_index = 0;
+        filter->block_fill = 0;
+        filter->update_config = update_config;
+        filter->partition_buffer = buffer;
+        filter->partitions = buffer;
+        filter->next_partitions = filter->partitions + count * fft_length;
+        filter->fdl = filter->next_partitions + count * fft_length;
+        filter->frame = filter->fdl + count * fft_length;
+        filter->accum = filter->frame + fft_length;
+        filter->scratch = filter->accum + fft_length;
+        filter->update_scratch = filter->scratch + fft_length;
+        filter->block_out = filter->update_scratch + fft_length;
+        partition_kernelD(filter, filter->kernel, filter->partitions);
+        partition_kernelD(filter, filter->next_kernel, filter->next_partitions);
+        return NOERR;
+    }
+
+    else
+    {
+        if (fft_config)
+        {
+            FFTFreeD(fft_config);
+        }
+        if (update_config)
+        {
+            FFTFreeD(update_config);
+        }
+        free(buffer);
+        return ERROR;
+    }
+}
+
+/* Calculate the spectrum of each kernel partition */
+static void
+partition_kernelD(FIRFilterD* filter, const double* kernel, double* partitions)
+{
+    const unsigned fft_length = filter->fft_length;
+    const unsigned block_length = filter->block_length;
+    FFTSplitComplexD spectrum;
+
+    for (unsigned i = 0; i < filter->partition_count; ++i)
+    {
+        unsigned offset = i * block_length;
+        unsigned length = filter->kernel_length - offset;
+        if (length > block_length)
+        {
+            length = block_length;
+        }
+
+        ClearBufferD(filter->update_scratch, fft_length);
+        CopyBufferD(filter->update_scratch, kernel + offset, length);
+        spectrum.realp = partitions + i * fft_length;
+        spectrum.imagp = spectrum.realp + fft_length / 2;
+        FFT_IR_R2CD(filter->update_config, filter->update_scratch, spectrum);
+    }
+}
+
+/* Filter one full block of input, using uniformly partitioned overlap-save */
+static void
+partition_blockD(FIRFilterD* filter)
+{
+    const unsigned fft_length = filter->fft_length;
+    const unsigned block_length = filter->block_length;
+    FFTSplitComplexD input;
+
+    // Pick up a new kernel at the block boundary
+    kernel_swap_startD(filter);
+
+    // Transform the newest frame into the frequency-domain delay line
+    input.realp = filter->fdl + filter->partition_index * fft_length;
+    input.imagp = input.realp + fft_length / 2;
+    FFT_IR_R2CD(filter->fft_config, filter->frame, input);
+
+    // Only the end of the circular convolution is free of wrap-around
+    partition_applyD(filter, filter->partitions);
+    CopyBufferD(filter->block_out, filter->scratch + (fft_length - block_length),
+                block_length);
+
+    // The delay line doesn't depend on the kernel, so a new kernel can be
+    // faded in with the full input history behind it
+    if (KERNEL_STATE_LOAD(&filter->kernel_state) == KERNEL_FADING)
+    {
+        partition_applyD(filter, filter->next_partitions);
+        kernel_crossfadeD(filter, filter->block_out,
+                          filter->scratch + (fft_length - block_length), block_length);
+    }
+
+    // Slide the frame along to make room for the next block
+    memmove(filter->frame, filter->frame + block_length,
+            (fft_length - block_length) * sizeof(double));
+    filter->partition_index = (filter->partition_index + 1) % filter->partition_count;
+}
+
+/* Convolve one block directly, using buffer for the full result */
+static void
+direct_block(FIRFilter* filter, float* out, const float* in, unsigned n_samples,
+             float* buffer)
+{
+    kernel_swap_start(filter);
+
+    ConvolveSymmetric((float*)in, n_samples, filter->kernel, filter->kernel_length,
+                      filter->symmetry, buffer);
+    overlap_add(filter, buffer, filter->overlap, n_samples);
+    CopyBuffer(out, buffer, n_samples);
+
+    // While a new kernel fades in, run it alongside the old one
+    if (KERNEL_STATE_LOAD(&filter->kernel_state) == KERNEL_FADING)
+    {
+        ConvolveSymmetric((float*)in, n_samples, filter->next_kernel, filter->kernel_length,
+                          filter->next_symmetry, buffer);
+        overlap_add(filter, buffer, filter->fade_overlap, n_samples);
+        kernel_crossfade(filter, out, buffer, n_samples);
+    }
+}
+
+/* Convolve one block directly, using buffer for the full result */
+static void
+direct_blockD(FIRFilterD* filter, double* out, const double* in, unsigned n_samples,
+              double* buffer)
+{
+    kernel_swap_startD(filter);
+
+    ConvolveSymmetricD((double*)in, n_samples, filter->kernel, filter->kernel_length,
+                       filter->symmetry, buffer);
+    overlap_addD(filter, buffer, filter->overlap, n_samples);
+    CopyBufferD(out, buffer, n_samples);
+
+    // While a new kernel fades in, run it alongside the old one
+    if (KERNEL_STATE_LOAD(&filter->kernel_state) == KERNEL_FADING)
+    {
+        ConvolveSymmetricD((double*)in, n_samples, filter->next_kernel, filter->kernel_length,
+                           filter->next_symmetry, buffer);
+        overlap_addD(filter, buffer, filter->fade_overlap, n_samples);
+        kernel_crossfadeD(filter, out, buffer, n_samples);
+    }
+}
+
+/* Convolve one block of at most max_block_size samples using the FFT */
+static void
+fft_block(FIRFilter* filter, float* out, const float* in, unsigned n_samples)
+{
+    kernel_swap_start(filter);
+
+    FFTFilterConvolve(filter->fft_config, (float*)in, n_samples, filter->fft_kernel, filter->work);
+    overlap_add(filter, filter->work, filter->overlap, n_samples);
+    CopyBuffer(out, filter->work, n_samples);
+
+    // While a new kernel fades in, run it alongside the old one
+    if (KERNEL_STATE_LOAD(&filter->kernel_state) == KERNEL_FADING)
+    {
+        FFTFilterConvolve(filter->fft_config, (float*)in, n_samples, filter->next_fft_kernel,
+                          filter->work);
+        overlap_add(filter, filter->work, filter->fade_overlap, n_samples);
+        kernel_crossfade(filter, out, filter->work, n_samples);
+    }
+}
+
+/* Convolve one block of at most max_block_size samples using the FFT */
+static void
+fft_blockD(FIRFilterD* filter, double* out, const double* in, unsigned n_samples)
+{
+    kernel_swap_startD(filter);
+
+    FFTFilterConvolveD(filter->fft_config, (double*)in, n_samples, filter->fft_kernel, filter->work);
+    overlap_addD(filter, filter->work, filter->overlap, n_samples);
+    CopyBufferD(out, filter->work, n_samples);
+
+    // While a new kernel fades in, run it alongside the old one
+    if (KERNEL_STATE_LOAD(&filter->kernel_state) == KERNEL_FADING)
+    {
+        FFTFilterConvolveD(filter->fft_config, (double*)in, n_samples, filter->next_fft_kernel,
+                           filter->work);
+        overlap_addD(filter, filter->work, filter->fade_overlap, n_samples);
+        kernel_crossfadeD(filter, out, filter->work, n_samples);
+    }
+}
+
+/* Calculate the FFT of the zero padded kernel */
+static void
+fft_kernel(FIRFilter* filter, const float* kernel, FFTSplitComplex spectrum)
+{
+    CopyBuffer(filter->update_scratch, kernel, filter->kernel_length);
+    ClearBuffer(filter->update_scratch + filter->kernel_length,
+                filter->fft_length - filter->kernel_length);
+    FFT_IR_R2C(filter->update_config, filter->update_scratch, spectrum);
+}
+
+/* Calculate the FFT of the zero padded kernel */
+static void
+fft_kernelD(FIRFilterD* filter, const double* kernel, FFTSplitComplexD spectrum)
+{
+    CopyBufferD(filter->update_scratch, kernel, filter->kernel_length);
+    ClearBufferD(filter->update_scratch + filter->kernel_length,
+                 filter->fft_length - filter->kernel_length);
+    FFT_IR_R2CD(filter->update_config, filter->update_scratch, spectrum);
+}
+
+/* Release partitioned convolution buffers */
+static void
+partition_free(FIRFilter* filter)
+{
+    if (filter->fft_config)
+    {
+        FFTFree(filter->fft_config);
+        filter->fft_config = NULL;
+    }
+
+    if (filter->update_config)
+    {
+        FFTFree(filter->update_config);
+        filter->update_config = NULL;
+    }
+
+    if (filter->partition_buffer)
+    {
+        free(filter->partition_buffer);
+        filter->partition_buffer = NULL;
+        filter->partitions = NULL;
+    }
+}
+
+/* Release partitioned convolution buffers */
+static void
+partition_freeD(FIRFilterD* filter)
+{
+    if (filter->fft_config)
+    {
+        FFTFreeD(filter->fft_config);
+        filter->fft_config = NULL;
+    }
+
+    if (filter->update_config)
+    {
+        FFTFreeD(filter->update_config);
+        filter->update_config = NULL;
+    }
+
+    if (filter->partition_buffer)
+    {
+        free(filter->partition_buffer);
+        filter->partition_buffer = NULL;
+        filter->partitions = NULL;
+    }
+}
+
+/* Add the overlap from the last block to a full convolution result, and keep
+ the end of it for the next block */
+static void
+overlap_add(FIRFilter* filter, float* buffer, float* overlap, unsigned n_samples)
+{
+    VectorVectorAdd(buffer, overlap, buffer, filter->overlap_length);
+    CopyBuffer(overlap, buffer + n_samples, filter->overlap_length);
+}
+
+/* Add the overlap from the last block to a full convolution result, and keep
+ the end of it for the next block */
+static void
+overlap_addD(FIRFilterD* filter, double* buffer, double* overlap, unsigned n_samples)
+{
+    VectorVectorAddD(buffer, overlap, buffer, filter->overlap_length);
+    CopyBufferD(overlap, buffer + n_samples, filter->overlap_length);
+}
+
+/* Take over a kernel published by FIRFilterUpdateKernel, if there is one */
+static void
+kernel_swap_start(FIRFilter* filter)
+{
+    if (kernel_state_swap(&filter->kernel_state, KERNEL_PENDING, KERNEL_FADING))
+    {
+        if (filter->crossfade_length == 0)
+        {
+            kernel_swap_finish(filter);
+        }
+        else
+        {
+            // The new kernel starts from the old one's overlap, so the two
+            // outputs only differ by the change in the kernel
+            CopyBuffer(filter->fade_overlap, filter->overlap, filter->overlap_length);
+            filter->fade_position = 0;
+        }
+    }
+}
+
+/* Take over a kernel published by FIRFilterUpdateKernel, if there is one */
+static void
+kernel_swap_startD(FIRFilterD* filter)
+{
+    if (kernel_state_swap(&filter->kernel_state, KERNEL_PENDING, KERNEL_FADING))
+    {
+        if (filter->crossfade_length == 0)
+        {
+            kernel_swap_finishD(filter);
+        }
+        else
+        {
+            // The new kernel starts from the old one's overlap, so the two
+            // outputs only differ by the change in the kernel
+            CopyBufferD(filter->fade_overlap, filter->overlap, filter->overlap_length);
+            filter->fade_position = 0;
+        }
+    }
+}
+
+/* Make the next kernel the current one. The old one's buffers become the
+ back buffer for the next update */
+static void
+kernel_swap_finish(FIRFilter* filter)
+{
+    float* kernel = filter->kernel;
+    filter->kernel = filter->next_kernel;
+    filter->next_kernel = kernel;
+    filter->symmetry = filter->next_symmetry;
+
+    FFTSplitComplex spectrum = filter->fft_kernel;
+    filter->fft_kernel = filter->next_fft_kernel;
+    filter->next_fft_kernel = spectrum;
+
+    float* partitions = filter->partitions;
+    filter->partitions = filter->next_partitions;
+    filter->next_partitions = partitions;
+    KERNEL_STATE_STORE(&filter->kernel_state, KERNEL_IDLE);
+}
+
+/* Make the next kernel the current one. The old one's buffers become the
+ back buffer for the next update */
+static void
+kernel_swap_finishD(FIRFilterD* filter)
+{
+    double* kernel = filter->kernel;
+    filter->kernel = filter->next_kernel;
+    filter->next_kernel = kernel;
+    filter->symmetry = filter->next_symmetry;
+
+    FFTSplitComplexD spectrum = filter->fft_kernel;
+    filter->fft_kernel = filter->next_fft_kernel;
+    filter->next_fft_kernel = spectrum;
+
+    double* partitions = filter->partitions;
+    filter->partitions = filter->next_partitions;
+    filter->next_partitions = partitions;
+    KERNEL_STATE_STORE(&filter->kernel_state, KERNEL_IDLE);
+}
+
+/* Fade out from the old kernel's output, already in out, to the new one's */
+static void
+kernel_crossfade(FIRFilter* filter, float* out, const float* in, unsigned n_samples)
+{
+    const unsigned length = filter->crossfade_length;
+    for (unsigned i = 0; i < n_samples; ++i)
+    {
+        if (filter->fade_position < length)
+        {
+            float gain = (float)filter->fade_position / length;
+            out[i] += gain * (in[i] - out[i]);
+            ++filter->fade_position;
+        }
+        else
+        {
+            out[i] = in[i];
+        }
+    }
+
+    if (filter->fade_position >= length)
+    {
+        float* overlap = filter->overlap;
+        filter->overlap = filter->fade_overlap;
+        filter->fade_overlap = overlap;
+        kernel_swap_finish(filter);
+    }
+}
+
+/* Fade out from the old kernel's output, already in out, to the new one's */
+static void
+kernel_crossfadeD(FIRFilterD* filter, double* out, const double* in, unsigned n_samples)
+{
+    const unsigned length = filter->crossfade_length;
+    for (unsigned i = 0; i < n_samples; ++i)
+    {
+        if (filter->fade_position < length)
+        {
+            double gain = (double)filter->fade_position / length;
+            out[i] += gain * (in[i] - out[i]);
+            ++filter->fade_position;
+        }
+        else
+        {
+            out[i] = in[i];
+        }
+    }
+
+    if (filter->fade_position >= length)
+    {
+        double* overlap = filter->overlap;
+        filter->overlap = filter->fade_overlap;
+        filter->fade_overlap = overlap;
+        kernel_swap_finishD(filter);
+    }
+}
+
+/* Apply a set of kernel partitions to the delay line, newest input first,
+ and inverse transform the result into scratch. Each partition is applied to
+ the input from as many blocks ago, so only one inverse transform is needed */
+static void
+partition_apply(FIRFilter* filter, const float* partitions)
+{
+    const unsigned fft_length = filter->fft_length;
+    const unsigned count = filter->partition_count;
+    unsigned index = filter->partition_index;
+    FFTSplitComplex input;
+    FFTSplitComplex kernel;
+    FFTSplitComplex accum;
+
+    accum.realp = filter->accum;
+    accum.imagp = filter->accum + fft_length / 2;
+
+    ClearBuffer(filter->accum, fft_length);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        input.realp = filter->fdl + index * fft_length;
+        input.imagp = input.realp + fft_length / 2;
+        kernel.realp = (float*)partitions + i * fft_length;
+        kernel.imagp = kernel.realp + fft_length / 2;
+        FFTSpectrumMultiplyAccumulate(filter->fft_config, accum, input, kernel);
+        index = (index == 0 ? count : index) - 1;
+    }
+    IFFT_IR_C2R(filter->fft_config, accum, filter->scratch);
+}
+
+/* Apply a set of kernel partitions to the delay line, newest input first,
+ and inverse transform the result into scratch. Each partition is applied to
+ the input from as many blocks ago, so only one inverse transform is needed */
+static void
+partition_applyD(FIRFilterD* filter, const double* partitions)
+{
+    const unsigned fft_length = filter->fft_length;
+    const unsigned count = filter->partition_count;
+    unsigned index = filter->partition_index;
+    FFTSplitComplexD input;
+    FFTSplitComplexD kernel;
+    FFTSplitComplexD accum;
+
+    accum.realp = filter->accum;
+    accum.imagp = filter->accum + fft_length / 2;
+
+    ClearBufferD(filter->accum, fft_length);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        input.realp = filter->fdl + index * fft_length;
+        input.imagp = input.realp + fft_length / 2;
+        kernel.realp = (double*)partitions + i * fft_length;
+        kernel.imagp = kernel.realp + fft_length / 2;
+        FFTSpectrumMultiplyAccumulateD(filter->fft_config, accum, input, kernel);
+        index = (index == 0 ? count : index) - 1;
+    }
+    IFFT_IR_C2RD(filter->fft_config, accum, filter->scratch);
+}
+
+/* Atomically move a kernel update from one state to another */
+static int
+kernel_state_swap(int* state, int from, int to)
+{
+    return __atomic_compare_exchange_n(state, &from, to, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
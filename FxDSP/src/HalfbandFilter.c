@@ -0,0 +1,489 @@
+/*
+ * HalfbandFilter.c
+ * Hamilton Kibbe
+ * Copyright 2015 Hamilton Kibbe
+ */
+
+#include "HalfbandFilter.h"
+#include "Dsp.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+
+/* Static Function Prototypes */
+static void
+transition_parameters(double transition, double* k, double* q);
+
+static double
+design_coefficient(unsigned index, double k, double q, unsigned order);
+
+static double
+stage_transition(unsigned stage);
+
+static inline float
+allpass_chain(const float* coefficients, float* state, unsigned n_sections, float x);
+
+static inline double
+allpass_chainD(const double* coefficients, double* state, unsigned n_sections, double x);
+
+
+/* HalfbandFilter ******************************************************/
+struct HalfbandFilter
+{
+    unsigned    n_a;            // Sections in the first branch
+    unsigned    n_b;            // Sections in the second branch
+    float*      coefficients;   // First branch, then the second
+    float*      state;          // n_a + 1 then n_b + 1 samples, see allpass_chain
+    float       pending;        // Odd input sample left from the last block
+    int         has_pending;
+};
+
+struct HalfbandFilterD
+{
+    unsigned    n_a;
+    unsigned    n_b;
+    double*     coefficients;
+    double*     state;
+    double      pending;
+    int         has_pending;
+};
+
+
+/* HalfbandFilterOrder *************************************************/
+unsigned
+HalfbandFilterOrder(double attenuation, double transition)
+{
+    double k;
+    double q;
+    transition_parameters(transition, &k, &q);
+
+    // Order of the equivalent elliptic filter, which must be odd
+    const double ripple = pow(10.0, -attenuation / 10.0);
+    const double a = ripple / (1.0 - ripple);
+    unsigned order = (unsigned)ceil(log(a * a / 16.0) / log(q));
+    order += (order % 2 == 0) ? 1 : 0;
+    order = (order < 3) ? 3 : order;
+    return (order - 1) / 2;
+}
+
+
+/* HalfbandFilterDesign ************************************************/
+Error_t
+HalfbandFilterDesign(double* coefficients, unsigned n_coefficients, double transition)
+{
+    if (n_coefficients == 0 || transition <= 0.0 || transition >= 0.5)
+    {
+        return VALUE_ERROR;
+    }
+
+    double k;
+    double q;
+    transition_parameters(transition, &k, &q);
+    for (unsigned i = 0; i < n_coefficients; ++i)
+    {
+        coefficients[i] = design_coefficient(i, k, q, 2 * n_coefficients + 1);
+    }
+    return NOERR;
+}
+
+
+/* HalfbandFilterInit **************************************************/
+HalfbandFilter*
+HalfbandFilterInit(const double* coefficients, unsigned n_coefficients)
+{
+    // Allocate memory for the filter
+    HalfbandFilter* filter = (HalfbandFilter*)malloc(sizeof(HalfbandFilter));
+
+    // Allocate memory for the coefficients and branch state
+    float* coeffs = (float*)malloc(n_coefficients * sizeof(float));
+    float* state = (float*)malloc((n_coefficients + 2) * sizeof(float));
+
+    if (filter && coeffs && state && n_coefficients > 0)
+    {
+        // Deinterleave the branches
+        const unsigned n_a = (n_coefficients + 1) / 2;
+        for (unsigned i = 0; i < n_coefficients; ++i)
+        {
+            coeffs[(i % 2) ? n_a + i / 2 : i / 2] = (float)coefficients[i];
+        }
+
+        filter->n_a = n_a;
+        filter->n_b = n_coefficients - n_a;
+        filter->coefficients = coeffs;
+        filter->state = state;
+        HalfbandFilterFlush(filter);
+        return filter;
+    }
+    else
+    {
+        if (state)
+        {
+            free(state);
+        }
+        if (coeffs)
+        {
+            free(coeffs);
+        }
+        if (filter)
+        {
+            free(filter);
+        }
+        return NULL;
+    }
+}
+
+HalfbandFilterD*
+HalfbandFilterInitD(const double* coefficients, unsigned n_coefficients)
+{
+    // Allocate memory for the filter
+    HalfbandFilterD* filter = (HalfbandFilterD*)malloc(sizeof(HalfbandFilterD));
+
+    // Allocate memory for the coefficients and branch state
+    double* coeffs = (double*)malloc(n_coefficients * sizeof(double));
+    double* state = (double*)malloc((n_coefficients + 2) * sizeof(double));
+
+    if (filter && coeffs && state && n_coefficients > 0)
+    {
+        // Deinterleave the branches
+        const unsigned n_a = (n_coefficients + 1) / 2;
+        for (unsigned i = 0; i < n_coefficients; ++i)
+        {
+            coeffs[(i % 2) ? n_a + i / 2 : i / 2] = coefficients[i];
+        }
+
+        filter->n_a = n_a;
+        filter->n_b = n_coefficients - n_a;
+        filter->coefficients = coeffs;
+        filter->state = state;
+        HalfbandFilterFlushD(filter);
+        return filter;
+    }
+    else
+    {
+        if (state)
+        {
+            free(state);
+        }
+        if (coeffs)
+        {
+            free(coeffs);
+        }
+        if (filter)
+        {
+            free(filter);
+        }
+        return NULL;
+    }
+}
+
+
+/* HalfbandFilterInitStage *********************************************/
+HalfbandFilter*
+HalfbandFilterInitStage(unsigned stage)
+{
+    const double transition = stage_transition(stage);
+    const unsigned n_coefficients = HalfbandFilterOrder(HALFBAND_ATTENUATION, transition);
+    double coefficients[n_coefficients];
+    HalfbandFilterDesign(coefficients, n_coefficients, transition);
+    return HalfbandFilterInit(coefficients, n_coefficients);
+}
+
+HalfbandFilterD*
+HalfbandFilterInitStageD(unsigned stage)
+{
+    const double transition = stage_transition(stage);
+    const unsigned n_coefficients = HalfbandFilterOrder(HALFBAND_ATTENUATION, transition);
+    double coefficients[n_coefficients];
+    HalfbandFilterDesign(coefficients, n_coefficients, transition);
+    return HalfbandFilterInitD(coefficients, n_coefficients);
+}
+
+
+/* HalfbandFilterFree **************************************************/
+Error_t
+HalfbandFilterFree(HalfbandFilter* filter)
+{
+    if (filter)
+    {
+        if (filter->coefficients)
+        {
+            free(filter->coefficients);
+        }
+        if (filter->state)
+        {
+            free(filter->state);
+        }
+        free(filter);
+    }
+    return NOERR;
+}
+
+Error_t
+HalfbandFilterFreeD(HalfbandFilterD* filter)
+{
+    if (filter)
+    {
+        if (filter->coefficients)
+        {
+            free(filter->coefficients);
+        }
+        if (filter->state)
+        {
+            free(filter->state);
+        }
+        free(filter);
+    }
+    return NOERR;
+}
+
+
+/* HalfbandFilterFlush *************************************************/
+Error_t
+HalfbandFilterFlush(HalfbandFilter* filter)
+{
+    ClearBuffer(filter->state, filter->n_a + filter->n_b + 2);
+    filter->pending = 0.0;
+    filter->has_pending = 0;
+    return NOERR;
+}
+
+Error_t
+HalfbandFilterFlushD(HalfbandFilterD* filter)
+{
+    ClearBufferD(filter->state, filter->n_a + filter->n_b + 2);
+    filter->pending = 0.0;
+    filter->has_pending = 0;
+    return NOERR;
+}
+
+
+/* HalfbandFilterUpsample **********************************************/
+Error_t
+HalfbandFilterUpsample(HalfbandFilter*  filter,
+                       float*           outBuffer,
+                       const float*     inBuffer,
+                       unsigned         n_samples)
+{
+    if (filter && outBuffer && inBuffer)
+    {
+        const float* coeff_b = filter->coefficients + filter->n_a;
+        float* state_b = filter->state + filter->n_a + 1;
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            // Read before writing, as the output may run into the input
+            const float x = inBuffer[i];
+            outBuffer[2 * i] = allpass_chain(filter->coefficients, filter->state,
+                                             filter->n_a, x);
+            outBuffer[2 * i + 1] = allpass_chain(coeff_b, state_b, filter->n_b, x);
+        }
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+Error_t
+HalfbandFilterUpsampleD(HalfbandFilterD*    filter,
+                        double*             outBuffer,
+                        const double*       inBuffer,
+                        unsigned            n_samples)
+{
+    if (filter && outBuffer && inBuffer)
+    {
+        const double* coeff_b = filter->coefficients + filter->n_a;
+        double* state_b = filter->state + filter->n_a + 1;
+        for (unsigned i = 0; i < n_samples; ++i)
+        {
+            // Read before writing, as the output may run into the input
+            const double x = inBuffer[i];
+            outBuffer[2 * i] = allpass_chainD(filter->coefficients, filter->state,
+                                              filter->n_a, x);
+            outBuffer[2 * i + 1] = allpass_chainD(coeff_b, state_b, filter->n_b, x);
+        }
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+
+/* HalfbandFilterDownsample ********************************************/
+Error_t
+HalfbandFilterDownsample(HalfbandFilter*    filter,
+                         float*             outBuffer,
+                         unsigned*          n_out,
+                         const float*       inBuffer,
+                         unsigned           n_samples)
+{
+    if (filter && outBuffer && n_out && inBuffer)
+    {
+        const float* coeff_b = filter->coefficients + filter->n_a;
+        float* state_b = filter->state + filter->n_a + 1;
+        unsigned written = 0;
+        unsigned i = 0;
+
+        // The first sample of each pair goes to the second branch
+        if (filter->has_pending && n_samples > 0)
+        {
+            const float a = allpass_chain(filter->coefficients, filter->state,
+                                          filter->n_a, inBuffer[0]);
+            const float b = allpass_chain(coeff_b, state_b, filter->n_b, filter->pending);
+            outBuffer[written++] = 0.5 * (a + b);
+            filter->has_pending = 0;
+            i = 1;
+        }
+        for (; i + 1 < n_samples; i += 2)
+        {
+            const float b = allpass_chain(coeff_b, state_b, filter->n_b, inBuffer[i]);
+            const float a = allpass_chain(filter->coefficients, filter->state,
+                                          filter->n_a, inBuffer[i + 1]);
+            outBuffer[written++] = 0.5 * (a + b);
+        }
+        if (i < n_samples)
+        {
+            filter->pending = inBuffer[i];
+            filter->has_pending = 1;
+        }
+
+        *n_out = written;
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+Error_t
+HalfbandFilterDownsampleD(HalfbandFilterD*  filter,
+                          double*           outBuffer,
+                          unsigned*         n_out,
+                          const double*     inBuffer,
+                          unsigned          n_samples)
+{
+    if (filter && outBuffer && n_out && inBuffer)
+    {
+        const double* coeff_b = filter->coefficients + filter->n_a;
+        double* state_b = filter->state + filter->n_a + 1;
+        unsigned written = 0;
+        unsigned i = 0;
+
+        // The first sample of each pair goes to the second branch
+        if (filter->has_pending && n_samples > 0)
+        {
+            const double a = allpass_chainD(filter->coefficients, filter->state,
+                                            filter->n_a, inBuffer[0]);
+            const double b = allpass_chainD(coeff_b, state_b, filter->n_b, filter->pending);
+            outBuffer[written++] = 0.5 * (a + b);
+            filter->has_pending = 0;
+            i = 1;
+        }
+        for (; i + 1 < n_samples; i += 2)
+        {
+            const double b = allpass_chainD(coeff_b, state_b, filter->n_b, inBuffer[i]);
+            const double a = allpass_chainD(filter->coefficients, filter->state,
+                                            filter->n_a, inBuffer[i + 1]);
+            outBuffer[written++] = 0.5 * (a + b);
+        }
+        if (i < n_samples)
+        {
+            filter->pending = inBuffer[i];
+            filter->has_pending = 1;
+        }
+
+        *n_out = written;
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+
+/* STATIC FUNCTION DEFINITIONS */
+
+/* Modulus and nome of the elliptic filter with the given transition width */
+static void
+transition_parameters(double transition, double* k, double* q)
+{
+    const double t = tan((1.0 - 2.0 * transition) * M_PI / 4.0);
+    *k = t * t;
+    const double kk = pow(1.0 - *k * *k, 0.25);
+    const double e = 0.5 * (1.0 - kk) / (1.0 + kk);
+    const double e4 = e * e * e * e;
+    *q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+}
+
+/* Allpass coefficient from the pole positions of the elliptic filter, found
+ with the series for the Jacobi elliptic functions */
+static double
+design_coefficient(unsigned index, double k, double q, unsigned order)
+{
+    const double c = index + 1.0;
+
+    double num = 0.0;
+    double term = 1.0;
+    for (unsigned i = 0; fabs(term) > 1e-100; ++i)
+    {
+        term = pow(q, i * (i + 1.0)) * sin((2.0 * i + 1.0) * c * M_PI / order);
+        num += (i % 2) ? -term : term;
+    }
+
+    double den = 0.5;
+    term = 1.0;
+    for (unsigned i = 1; fabs(term) > 1e-100; ++i)
+    {
+        term = pow(q, (double)i * i) * cos(2.0 * i * c * M_PI / order);
+        den += (i % 2) ? -term : term;
+    }
+
+    const double w = num * pow(q, 0.25) / den;
+    const double w2 = w * w;
+    const double x = sqrt((1.0 - w2 * k) * (1.0 - w2 / k)) / (1.0 + w2);
+    return (1.0 - x) / (1.0 + x);
+}
+
+/* Transition width for a stage of a 2x cascade. The passband is fixed by the
+ base rate, and the stopband only has to start at its first image */
+static double
+stage_transition(unsigned stage)
+{
+    const double passband = 0.5 * HALFBAND_PASSBAND / (1 << stage);
+    return 0.5 - passband;
+}
+
+/* Run a sample through a chain of first-order allpass sections,
+ y = c * (x - y1) + x1. The input of each section is the output of the one
+ before, so state[k] is the last input of section k, and state[k + 1] its
+ last output */
+static inline float
+allpass_chain(const float* coefficients, float* state, unsigned n_sections, float x)
+{
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const float y = coefficients[k] * (x - state[k + 1]) + state[k];
+        state[k] = x;
+        x = y;
+    }
+    state[n_sections] = x;
+    return x;
+}
+
+static inline double
+allpass_chainD(const double* coefficients, double* state, unsigned n_sections, double x)
+{
+    for (unsigned k = 0; k < n_sections; ++k)
+    {
+        const double y = coefficients[k] * (x - state[k + 1]) + state[k];
+        state[k] = x;
+        x = y;
+    }
+    state[n_sections] = x;
+    return x;
+}
@@ -0,0 +1,368 @@
+/*
+ * MultichannelFIRFilter.c
+ * Hamilton Kibbe
+ * Copyright 2015 Hamilton Kibbe
+ */
+
+#include "MultichannelFIRFilter.h"
+#include "FFT.h"
+#include "Dsp.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+
+/* Static Function Prototypes */
+static void
+multichannel_block(MultichannelFIRFilter* filter, float* out, const float* in,
+                   unsigned n_samples, unsigned stride);
+
+static void
+multichannel_blockD(MultichannelFIRFilterD* filter, double* out, const double* in,
+                    unsigned n_samples, unsigned stride);
+
+
+/* MultichannelFIRFilter ***********************************************/
+struct MultichannelFIRFilter
+{
+    unsigned            kernel_length;
+    unsigned            overlap_length;
+    unsigned            n_channels;
+    unsigned            max_block_size;
+    unsigned            fft_length;
+    FFTConfig*          fft_config;
+    FFTSplitComplex     fft_kernel;
+    FFTSplitComplex     spectra;
+    float*              overlap;
+    float*              work;
+};
+
+struct MultichannelFIRFilterD
+{
+    unsigned            kernel_length;
+    unsigned            overlap_length;
+    unsigned            n_channels;
+    unsigned            max_block_size;
+    unsigned            fft_length;
+    FFTConfigD*         fft_config;
+    FFTSplitComplexD    fft_kernel;
+    FFTSplitComplexD    spectra;
+    double*             overlap;
+    double*             work;
+};
+
+
+/* MultichannelFIRFilterInit *******************************************/
+MultichannelFIRFilter*
+MultichannelFIRFilterInit(const float*  filter_kernel,
+                          unsigned      length,
+                          unsigned      n_channels,
+                          unsigned      max_block_size)
+{
+    if (length == 0 || n_channels == 0 || max_block_size == 0)
+    {
+        return NULL;
+    }
+
+    const unsigned overlap_length = length - 1;
+    const unsigned fft_length = FFTNextGoodLength(max_block_size + length - 1);
+
+    // The kernel spectrum and every channel's spectrum share one buffer, as
+    // do the overlap and time-domain buffers
+    MultichannelFIRFilter* filter = (MultichannelFIRFilter*)malloc(sizeof(MultichannelFIRFilter));
+    FFTConfig* fft_config = FFTInit(fft_length);
+    float* spectra = (float*)malloc((n_channels + 1) * fft_length * sizeof(float));
+    float* buffers = (float*)malloc((n_channels * overlap_length + fft_length) * sizeof(float));
+
+    if (filter && fft_config && spectra && buffers)
+    {
+        const unsigned half = fft_length / 2;
+        filter->kernel_length = length;
+        filter->overlap_length = overlap_length;
+        filter->n_channels = n_channels;
+        filter->max_block_size = max_block_size;
+        filter->fft_length = fft_length;
+        filter->fft_config = fft_config;
+        filter->fft_kernel.realp = spectra;
+        filter->fft_kernel.imagp = spectra + half;
+        filter->spectra.realp = spectra + fft_length;
+        filter->spectra.imagp = filter->spectra.realp + n_channels * half;
+        filter->overlap = buffers;
+        filter->work = buffers + n_channels * overlap_length;
+
+        // Transform the zero padded kernel
+        CopyBuffer(filter->work, filter_kernel, length);
+        ClearBuffer(filter->work + length, fft_length - length);
+        FFT_IR_R2C(fft_config, filter->work, filter->fft_kernel);
+
+        ClearBuffer(filter->overlap, n_channels * overlap_length);
+        return filter;
+    }
+
+    else
+    {
+        if (fft_config)
+        {
+            FFTFree(fft_config);
+        }
+        free(filter);
+        free(spectra);
+        free(buffers);
+        return NULL;
+    }
+}
+
+
+MultichannelFIRFilterD*
+MultichannelFIRFilterInitD(const double*    filter_kernel,
+                           unsigned         length,
+                           unsigned         n_channels,
+                           unsigned         max_block_size)
+{
+    if (length == 0 || n_channels == 0 || max_block_size == 0)
+    {
+        return NULL;
+    }
+
+    const unsigned overlap_length = length - 1;
+    const unsigned fft_length = FFTNextGoodLength(max_block_size + length - 1);
+
+    // The kernel spectrum and every channel's spectrum share one buffer, as
+    // do the overlap and time-domain buffers
+    MultichannelFIRFilterD* filter = (MultichannelFIRFilterD*)malloc(sizeof(MultichannelFIRFilterD));
+    FFTConfigD* fft_config = FFTInitD(fft_length);
+    double* spectra = (double*)malloc((n_channels + 1) * fft_length * sizeof(double));
+    double* buffers = (double*)malloc((n_channels * overlap_length + fft_length) * sizeof(double));
+
+    if (filter && fft_config && spectra && buffers)
+    {
+        const unsigned half = fft_length / 2;
+        filter->kernel_length = length;
+        filter->overlap_length = overlap_length;
+        filter->n_channels = n_channels;
+        filter->max_block_size = max_block_size;
+        filter->fft_length = fft_length;
+        filter->fft_config = fft_config;
+        filter->fft_kernel.realp = spectra;
+        filter->fft_kernel.imagp = spectra + half;
+        filter->spectra.realp = spectra + fft_length;
+        filter->spectra.imagp = filter->spectra.realp + n_channels * half;
+        filter->overlap = buffers;
+        filter->work = buffers + n_channels * overlap_length;
+
+        // Transform the zero padded kernel
+        CopyBufferD(filter->work, filter_kernel, length);
+        ClearBufferD(filter->work + length, fft_length - length);
+        FFT_IR_R2CD(fft_config, filter->work, filter->fft_kernel);
+
+        ClearBufferD(filter->overlap, n_channels * overlap_length);
+        return filter;
+    }
+
+    else
+    {
+        if (fft_config)
+        {
+            FFTFreeD(fft_config);
+        }
+        free(filter);
+        free(spectra);
+        free(buffers);
+        return NULL;
+    }
+}
+
+
+/* MultichannelFIRFilterFree *******************************************/
+Error_t
+MultichannelFIRFilterFree(MultichannelFIRFilter* filter)
+{
+    if (filter)
+    {
+        if (filter->fft_config)
+        {
+            FFTFree(filter->fft_config);
+            filter->fft_config = NULL;
+        }
+        free(filter->fft_kernel.realp);
+        free(filter->overlap);
+        free(filter);
+    }
+    return NOERR;
+}
+
+
+Error_t
+MultichannelFIRFilterFreeD(MultichannelFIRFilterD* filter)
+{
+    if (filter)
+    {
+        if (filter->fft_config)
+        {
+            FFTFreeD(filter->fft_config);
+            filter->fft_config = NULL;
+        }
+        free(filter->fft_kernel.realp);
+        free(filter->overlap);
+        free(filter);
+    }
+    return NOERR;
+}
+
+
+/* MultichannelFIRFilterFlush ******************************************/
+Error_t
+MultichannelFIRFilterFlush(MultichannelFIRFilter* filter)
+{
+    ClearBuffer(filter->overlap, filter->n_channels * filter->overlap_length);
+    return NOERR;
+}
+
+
+Error_t
+MultichannelFIRFilterFlushD(MultichannelFIRFilterD* filter)
+{
+    ClearBufferD(filter->overlap, filter->n_channels * filter->overlap_length);
+    return NOERR;
+}
+
+
+/* MultichannelFIRFilterProcess ****************************************/
+Error_t
+MultichannelFIRFilterProcess(MultichannelFIRFilter* filter,
+                             float*                 outBuffer,
+                             const float*           inBuffer,
+                             unsigned               n_samples)
+{
+    if (filter)
+    {
+        unsigned done = 0;
+        while (done < n_samples)
+        {
+            unsigned count = n_samples - done;
+            if (count > filter->max_block_size)
+            {
+                count = filter->max_block_size;
+            }
+            multichannel_block(filter, outBuffer + done, inBuffer + done, count,
+                               n_samples);
+            done += count;
+        }
+        return NOERR;
+    }
+
+    else
+    {
+        return ERROR;
+    }
+}
+
+
+Error_t
+MultichannelFIRFilterProcessD(MultichannelFIRFilterD*   filter,
+                              double*                   outBuffer,
+                              const double*             inBuffer,
+                              unsigned                  n_samples)
+{
+    if (filter)
+    {
+        unsigned done = 0;
+        while (done < n_samples)
+        {
+            unsigned count = n_samples - done;
+            if (count > filter->max_block_size)
+            {
+                count = filter->max_block_size;
+            }
+            multichannel_blockD(filter, outBuffer + done, inBuffer + done, count,
+                                n_samples);
+            done += count;
+        }
+        return NOERR;
+    }
+
+    else
+    {
+        return ERROR;
+    }
+}
+
+
+/* Filter one block of every channel, reading and writing the channels with
+ the given stride */
+static void
+multichannel_block(MultichannelFIRFilter* filter, float* out, const float* in,
+                   unsigned n_samples, unsigned stride)
+{
+    const unsigned fft_length = filter->fft_length;
+    const unsigned half = fft_length / 2;
+    const unsigned overlap_length = filter->overlap_length;
+    FFTSplitComplex spectrum;
+
+    // Transform every channel of input
+    for (unsigned ch = 0; ch < filter->n_channels; ++ch)
+    {
+        float* padded = filter->work;
+        CopyBuffer(padded, in + ch * stride, n_samples);
+        ClearBuffer(padded + n_samples, fft_length - n_samples);
+        spectrum.realp = filter->spectra.realp + ch * half;
+        spectrum.imagp = filter->spectra.imagp + ch * half;
+        FFT_IR_R2C(filter->fft_config, padded, spectrum);
+    }
+
+    // Apply the kernel to all the channels at once
+    FFTSpectrumMultiplyBatch(filter->fft_config, filter->spectra, filter->fft_kernel,
+                             filter->n_channels);
+
+    // Transform back and add in the overlap from the last block
+    for (unsigned ch = 0; ch < filter->n_channels; ++ch)
+    {
+        float* result = filter->work;
+        float* overlap = filter->overlap + ch * overlap_length;
+        spectrum.realp = filter->spectra.realp + ch * half;
+        spectrum.imagp = filter->spectra.imagp + ch * half;
+        IFFT_IR_C2R(filter->fft_config, spectrum, result);
+        VectorVectorAdd(result, overlap, result, overlap_length);
+        CopyBuffer(overlap, result + n_samples, overlap_length);
+        CopyBuffer(out + ch * stride, result, n_samples);
+    }
+}
+
+/* Filter one block of every channel, reading and writing the channels with
+ the given stride */
+static void
+multichannel_blockD(MultichannelFIRFilterD* filter, double* out, const double* in,
+                    unsigned n_samples, unsigned stride)
+{
+    const unsigned fft_length = filter->fft_length;
+    const unsigned half = fft_length / 2;
+    const unsigned overlap_length = filter->overlap_length;
+    FFTSplitComplexD spectrum;
+
+    // Transform every channel of input
+    for (unsigned ch = 0; ch < filter->n_channels; ++ch)
+    {
+        double* padded = filter->work;
+        CopyBufferD(padded, in + ch * stride, n_samples);
+        ClearBufferD(padded + n_samples, fft_length - n_samples);
+        spectrum.realp = filter->spectra.realp + ch * half;
+        spectrum.imagp = filter->spectra.imagp + ch * half;
+        FFT_IR_R2CD(filter->fft_config, padded, spectrum);
+    }
+
+    // Apply the kernel to all the channels at once
+    FFTSpectrumMultiplyBatchD(filter->fft_config, filter->spectra, filter->fft_kernel,
+                              filter->n_channels);
+
+    // Transform back and add in the overlap from the last block
+    for (unsigned ch = 0; ch < filter->n_channels; ++ch)
+    {
+        double* result = filter->work;
+        double* overlap = filter->overlap + ch * overlap_length;
+        spectrum.realp = filter->spectra.realp + ch * half;
+        spectrum.imagp = filter->spectra.imagp + ch * half;
+        IFFT_IR_C2RD(filter->fft_config, spectrum, result);
+        VectorVectorAddD(result, overlap, result, overlap_length);
+        CopyBufferD(overlap, result + n_samples, overlap_length);
+        CopyBufferD(out + ch * stride, result, n_samples);
+    }
+}
@@ -6,11 +6,19 @@
 //
 
 #include "OnePole.h"
+#include "Dsp.h"
 #include <math.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 
+/* Static Function Prototypes */
+static void
+onepole_block_design(OnePole* filter);
+
+static void
+onepole_block_designD(OnePoleD* filter);
+
 
 /* OnePoleFilter ********************************************************/
 struct OnePole
@@ -21,6 +29,8 @@ struct OnePole
     float cutoff;
     float sampleRate;
     Filter_t type;
+    IIRMode_t mode;
+    float block[IIR_BLOCK_COEFFS];
 
 };
 
@@ -32,6 +42,8 @@ struct OnePoleD
     double cutoff;
     double sampleRate;
     Filter_t type;
+    IIRMode_t mode;
+    double block[IIR_BLOCK_COEFFS];
 };
 
 /* OnePoleFilterInit ***************************************************/
@@ -46,6 +58,7 @@ OnePoleInit(float cutoff, float sampleRate, Filter_t type)
         filter->y1 = 0;
         filter->type = type;
         filter->sampleRate = sampleRate;
+        filter->mode = IIR_SERIAL;
         OnePoleSetCutoff(filter, cutoff);
     }
 
@@ -63,6 +76,7 @@ OnePoleInitD(double cutoff, double sampleRate, Filter_t type)
         filter->y1 = 0;
         filter->type = type;
         filter->sampleRate = sampleRate;
+        filter->mode = IIR_SERIAL;
         OnePoleSetCutoffD(filter, cutoff);
     }
 
@@ -81,6 +95,7 @@ OnePoleRawInit(float beta, float alpha)
     filter->y1 = 0.0;
     filter->type = LOWPASS;
     filter->sampleRate = 0;
+    filter->mode = IIR_SERIAL;
   }
   return filter;
 }
@@ -96,6 +111,7 @@ OnePoleRawInitD(double beta, double alpha)
     filter->y1 = 0;
     filter->type = LOWPASS;
     filter->sampleRate = 0;
+    filter->mode = IIR_SERIAL;
   }
   return filter;
 }
@@ -156,6 +172,7 @@ OnePoleSetCutoff(OnePole* filter, float cutoff)
         filter->b1 = -expf(-2.0 * M_PI * (0.5 - (filter->cutoff / filter->sampleRate)));
         filter->a0 = 1.0 + filter->b1;
     }
+    onepole_block_design(filter);
     return NOERR;
 }
 
@@ -174,6 +191,7 @@ OnePoleSetCutoffD(OnePoleD* filter, double cutoff)
         filter->b1 = -exp(-2.0 * M_PI * (0.5 - (filter->cutoff / filter->sampleRate)));
         filter->a0 = 1.0 + filter->b1;
     }
+    onepole_block_designD(filter);
     return NOERR;
 }
 
@@ -200,6 +218,7 @@ OnePoleSetCoefficients(OnePole* filter, float* beta, float* alpha)
 {
   filter->b1 = *beta;
   filter->a0 = *alpha;
+  onepole_block_design(filter);
   return NOERR;
 }
 
@@ -208,9 +227,34 @@ OnePoleSetCoefficientsD(OnePoleD* filter, double* beta, double* alpha)
 {
   filter->b1 = *beta;
   filter->a0 = *alpha;
+  onepole_block_designD(filter);
   return NOERR;
 }
 
+Error_t
+OnePoleSetMode(OnePole* filter, IIRMode_t mode)
+{
+    if (mode != IIR_SERIAL && mode != IIR_BLOCK)
+    {
+        return VALUE_ERROR;
+    }
+    filter->mode = mode;
+    onepole_block_design(filter);
+    return NOERR;
+}
+
+Error_t
+OnePoleSetModeD(OnePoleD* filter, IIRMode_t mode)
+{
+    if (mode != IIR_SERIAL && mode != IIR_BLOCK)
+    {
+        return VALUE_ERROR;
+    }
+    filter->mode = mode;
+    onepole_block_designD(filter);
+    return NOERR;
+}
+
 
 
 
@@ -267,6 +311,14 @@ OnePoleProcess(OnePole*     filter,
                  const float*   inBuffer,
                  unsigned       n_samples)
 {
+    if (filter->mode == IIR_BLOCK && n_samples > 0)
+    {
+        // The biquad state w0 is the feedback term b1 * y1
+        float state[2] = {filter->b1 * filter->y1, 0.0};
+        IIRBlockFilter(outBuffer, inBuffer, n_samples, filter->block, state);
+        filter->y1 = outBuffer[n_samples - 1];
+        return NOERR;
+    }
     for (unsigned i = 0; i < n_samples; ++i)
     {
         outBuffer[i] = filter->y1 = inBuffer[i] * filter->a0 + filter->y1 * filter->b1;
@@ -280,6 +332,14 @@ OnePoleProcessD(OnePoleD*   filter,
                  const double*  inBuffer,
                  unsigned       n_samples)
 {
+    if (filter->mode == IIR_BLOCK && n_samples > 0)
+    {
+        // The biquad state w0 is the feedback term b1 * y1
+        double state[2] = {filter->b1 * filter->y1, 0.0};
+        IIRBlockFilterD(outBuffer, inBuffer, n_samples, filter->block, state);
+        filter->y1 = outBuffer[n_samples - 1];
+        return NOERR;
+    }
     for (unsigned i = 0; i < n_samples; ++i)
     {
         outBuffer[i] = filter->y1 = inBuffer[i] * filter->a0 + filter->y1 * filter->b1;
@@ -332,4 +392,31 @@ double
 OnePoleBetaD(OnePoleD* filter)
 {
     return filter->b1;
-}
\ No newline at end of file
+}
+
+
+/* STATIC FUNCTION DEFINITIONS */
+
+/* Write the block state-space form of the filter, as a biquad with b = [a0, 0, 0]
+ and a = [-b1, 0]. Skipped in serial mode, so cutoff sweeps stay cheap */
+static void
+onepole_block_design(OnePole* filter)
+{
+    if (filter->mode == IIR_BLOCK)
+    {
+        const float b[3] = {filter->a0, 0.0, 0.0};
+        const float a[2] = {-filter->b1, 0.0};
+        IIRBlockDesign(filter->block, b, a);
+    }
+}
+
+static void
+onepole_block_designD(OnePoleD* filter)
+{
+    if (filter->mode == IIR_BLOCK)
+    {
+        const double b[3] = {filter->a0, 0.0, 0.0};
+        const double a[2] = {-filter->b1, 0.0};
+        IIRBlockDesignD(filter->block, b, a);
+    }
+}
@@ -0,0 +1,281 @@
+/*
+ * Oversampler.c
+ * Hamilton Kibbe
+ * Copyright 2015 Hamilton Kibbe
+ */
+
+#include "Oversampler.h"
+#include "Decimator.h"
+#include "Upsampler.h"
+#include <stddef.h>
+#include <stdlib.h>
+
+
+/* Oversampler *********************************************************/
+struct Oversampler
+{
+    unsigned            factor;
+    Upsampler*          upsampler;
+    Decimator*          decimator;
+    OversamplerCallback process;
+    void*               context;
+    float*              upsampled;  // One sub-block at the oversampled rate
+    float*              processed;  // The processor's output for it
+};
+
+struct OversamplerD
+{
+    unsigned                factor;
+    UpsamplerD*             upsampler;
+    DecimatorD*             decimator;
+    OversamplerCallbackD    process;
+    void*                   context;
+    double*                 upsampled;
+    double*                 processed;
+};
+
+
+/* OversamplerInit *****************************************************/
+Oversampler*
+OversamplerInit(ResampleFactor_t    factor,
+                ResampleMode_t      mode,
+                OversamplerCallback process,
+                void*               context)
+{
+    if (!process || ResampleFactorValue(factor) == 0)
+    {
+        return NULL;
+    }
+
+    // Allocate memory for the oversampler
+    Oversampler* oversampler = (Oversampler*)malloc(sizeof(Oversampler));
+
+    // Allocate the resamplers and the buffers between them
+    Upsampler* upsampler = UpsamplerInitMode(factor, mode);
+    Decimator* decimator = DecimatorInitMode(factor, mode);
+    float* upsampled = (float*)malloc(OVERSAMPLER_BLOCK * sizeof(float));
+    float* processed = (float*)malloc(OVERSAMPLER_BLOCK * sizeof(float));
+
+    if (oversampler && upsampler && decimator && upsampled && processed)
+    {
+        oversampler->factor = ResampleFactorValue(factor);
+        oversampler->upsampler = upsampler;
+        oversampler->decimator = decimator;
+        oversampler->process = process;
+        oversampler->context = context;
+        oversampler->upsampled = upsampled;
+        oversampler->processed = processed;
+        return oversampler;
+    }
+    else
+    {
+        if (processed)
+        {
+            free(processed);
+        }
+        if (upsampled)
+        {
+            free(upsampled);
+        }
+        if (decimator)
+        {
+            DecimatorFree(decimator);
+        }
+        if (upsampler)
+        {
+            UpsamplerFree(upsampler);
+        }
+        if (oversampler)
+        {
+            free(oversampler);
+        }
+        return NULL;
+    }
+}
+
+OversamplerD*
+OversamplerInitD(ResampleFactor_t       factor,
+                 ResampleMode_t         mode,
+                 OversamplerCallbackD   process,
+                 void*                  context)
+{
+    if (!process || ResampleFactorValue(factor) == 0)
+    {
+        return NULL;
+    }
+
+    // Allocate memory for the oversampler
+    OversamplerD* oversampler = (OversamplerD*)malloc(sizeof(OversamplerD));
+
+    // Allocate the resamplers and the buffers between them
+    UpsamplerD* upsampler = UpsamplerInitModeD(factor, mode);
+    DecimatorD* decimator = DecimatorInitModeD(factor, mode);
+    double* upsampled = (double*)malloc(OVERSAMPLER_BLOCK * sizeof(double));
+    double* processed = (double*)malloc(OVERSAMPLER_BLOCK * sizeof(double));
+
+    if (oversampler && upsampler && decimator && upsampled && processed)
+    {
+        oversampler->factor = ResampleFactorValue(factor);
+        oversampler->upsampler = upsampler;
+        oversampler->decimator = decimator;
+        oversampler->process = process;
+        oversampler->context = context;
+        oversampler->upsampled = upsampled;
+        oversampler->processed = processed;
+        return oversampler;
+    }
+    else
+    {
+        if (processed)
+        {
+            free(processed);
+        }
+        if (upsampled)
+        {
+            free(upsampled);
+        }
+        if (decimator)
+        {
+            DecimatorFreeD(decimator);
+        }
+        if (upsampler)
+        {
+            UpsamplerFreeD(upsampler);
+        }
+        if (oversampler)
+        {
+            free(oversampler);
+        }
+        return NULL;
+    }
+}
+
+
+/* OversamplerFree *****************************************************/
+Error_t
+OversamplerFree(Oversampler* oversampler)
+{
+    if (oversampler)
+    {
+        UpsamplerFree(oversampler->upsampler);
+        DecimatorFree(oversampler->decimator);
+        if (oversampler->upsampled)
+        {
+            free(oversampler->upsampled);
+        }
+        if (oversampler->processed)
+        {
+            free(oversampler->processed);
+        }
+        free(oversampler);
+    }
+    return NOERR;
+}
+
+Error_t
+OversamplerFreeD(OversamplerD* oversampler)
+{
+    if (oversampler)
+    {
+        UpsamplerFreeD(oversampler->upsampler);
+        DecimatorFreeD(oversampler->decimator);
+        if (oversampler->upsampled)
+        {
+            free(oversampler->upsampled);
+        }
+        if (oversampler->processed)
+        {
+            free(oversampler->processed);
+        }
+        free(oversampler);
+    }
+    return NOERR;
+}
+
+
+/* OversamplerFlush ****************************************************/
+Error_t
+OversamplerFlush(Oversampler* oversampler)
+{
+    UpsamplerFlush(oversampler->upsampler);
+    DecimatorFlush(oversampler->decimator);
+    return NOERR;
+}
+
+Error_t
+OversamplerFlushD(OversamplerD* oversampler)
+{
+    UpsamplerFlushD(oversampler->upsampler);
+    DecimatorFlushD(oversampler->decimator);
+    return NOERR;
+}
+
+
+/* OversamplerProcess **************************************************/
+Error_t
+OversamplerProcess(Oversampler*     oversampler,
+                   float*           outBuffer,
+                   const float*     inBuffer,
+                   unsigned         n_samples)
+{
+    if (oversampler && outBuffer && inBuffer)
+    {
+        // Each sub-block is oversampled, processed and decimated before the
+        // next is read, so outBuffer can overwrite input already used
+        const unsigned factor = oversampler->factor;
+        const unsigned block = OVERSAMPLER_BLOCK / factor;
+        for (unsigned i = 0; i < n_samples; i += block)
+        {
+            const unsigned n = (n_samples - i < block) ? n_samples - i : block;
+            UpsamplerProcess(oversampler->upsampler, oversampler->upsampled,
+                             inBuffer + i, n);
+            Error_t err = oversampler->process(oversampler->context, oversampler->processed,
+                                               oversampler->upsampled, n * factor);
+            if (err != NOERR)
+            {
+                return err;
+            }
+            DecimatorProcess(oversampler->decimator, outBuffer + i,
+                             oversampler->processed, n * factor);
+        }
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+Error_t
+OversamplerProcessD(OversamplerD*   oversampler,
+                    double*         outBuffer,
+                    const double*   inBuffer,
+                    unsigned        n_samples)
+{
+    if (oversampler && outBuffer && inBuffer)
+    {
+        // Each sub-block is oversampled, processed and decimated before the
+        // next is read, so outBuffer can overwrite input already used
+        const unsigned factor = oversampler->factor;
+        const unsigned block = OVERSAMPLER_BLOCK / factor;
+        for (unsigned i = 0; i < n_samples; i += block)
+        {
+            const unsigned n = (n_samples - i < block) ? n_samples - i : block;
+            UpsamplerProcessD(oversampler->upsampler, oversampler->upsampled,
+                              inBuffer + i, n);
+            Error_t err = oversampler->process(oversampler->context, oversampler->processed,
+                                               oversampler->upsampled, n * factor);
+            if (err != NOERR)
+            {
+                return err;
+            }
+            DecimatorProcessD(oversampler->decimator, outBuffer + i,
+                              oversampler->processed, n * factor);
+        }
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
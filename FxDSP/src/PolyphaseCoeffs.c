@@ -7,6 +7,16 @@
 //
 
 #include "PolyphaseCoeffs.h"
+#include "FIRDesign.h"
+#include <stddef.h>
+
+
+/* Static Function Prototypes */
+static const unsigned*
+stage_factors(ResampleFactor_t factor, unsigned* n_stages);
+
+static int
+stage_spec(FIRDesignSpec* spec, ResampleFactor_t factor, unsigned stage);
 
 
 /******************************************************************************
@@ -389,7 +399,7 @@ static const float polyphase8xfilter3[64] =
     -0.00552647396504433920, 0.01183152935877091100, -0.02388014901113717800, 0.07071205074526545900,
     0.08545741447609654700, -0.02118099310325147900, 0.00813695469487032970, -0.00200465909461610940,
     -0.00151921945966949170, 0.00355693608056953160, -0.00455482533831069740, 0.00476518663684880220,
-    -0.00438038015325593890, 0.00357492186862908880 -0.00251606896499480740, 0.00136193071021434250,
+    -0.00438038015325593890, 0.00357492186862908880, -0.00251606896499480740, 0.00136193071021434250,
     -0.00025460237565429417, -0.00068788009050978823, 0.00137873756292502610, -0.00176750548092106620,
     0.00184225028480482200, -0.00162869371539639560, 0.00118633130281230620, -0.00060183978921851905,
     -0.00001987860045449669, 0.00056676217416478942, -0.00093289737900114494, 0.00103478202101450390,
@@ -549,7 +559,7 @@ static const double polyphase8xfilter3D[64] =
     -0.00552647396504433920, 0.01183152935877091100, -0.02388014901113717800, 0.07071205074526545900,
     0.08545741447609654700, -0.02118099310325147900, 0.00813695469487032970, -0.00200465909461610940,
     -0.00151921945966949170, 0.00355693608056953160, -0.00455482533831069740, 0.00476518663684880220,
-    -0.00438038015325593890, 0.00357492186862908880 -0.00251606896499480740, 0.00136193071021434250,
+    -0.00438038015325593890, 0.00357492186862908880, -0.00251606896499480740, 0.00136193071021434250,
     -0.00025460237565429417, -0.00068788009050978823, 0.00137873756292502610, -0.00176750548092106620,
     0.00184225028480482200, -0.00162869371539639560, 0.00118633130281230620, -0.00060183978921851905,
     -0.00001987860045449669, 0.00056676217416478942, -0.00093289737900114494, 0.00103478202101450390,
@@ -662,33 +672,6 @@ static const double* polyphase8xD[8] =
     polyphase8xfilter7D
 };
 
-/******************************************************************************
- * 16x Polyphase Coefficients
- *****************************************************************************/
-
-/*
- float* polyphase16x[16] =
- {
- polyphase16xfilter0,
- polyphase16xfilter1,
- polyphase16xfilter2,
- polyphase16xfilter3,
- polyphase16xfilter4,
- polyphase16xfilter5,
- polyphase16xfilter6,
- polyphase16xfilter7,
- polyphase16xfilter8,
- polyphase16xfilter9,
- polyphase16xfilter10,
- polyphase16xfilter11,
- polyphase16xfilter12,
- polyphase16xfilter13,
- polyphase16xfilter14,
- polyphase16xfilter15
- };
- 
- */
-
 
 /******************************************************************************
  * Polyphase Coefficient matrix
@@ -698,8 +681,10 @@ const float** PolyphaseCoeffs[N_FACTORS] =
 {
     polyphase2x,
     polyphase4x,
-    polyphase8x
-    /*polyphase16x*/
+    polyphase8x,
+    NULL,
+    NULL,
+    NULL
 };
 
 const double** PolyphaseCoeffsD[N_FACTORS] =
@@ -707,4 +692,204 @@ const double** PolyphaseCoeffsD[N_FACTORS] =
     polyphase2xD,
     polyphase4xD,
     polyphase8xD,
+    NULL,
+    NULL,
+    NULL
 };
+
+/******************************************************************************
+ * Stage factors, from the base rate up
+ *****************************************************************************/
+
+static const unsigned stages2x[1] = {2};
+static const unsigned stages3x[1] = {3};
+static const unsigned stages4x[2] = {2, 2};
+static const unsigned stages6x[2] = {3, 2};
+static const unsigned stages8x[3] = {2, 2, 2};
+static const unsigned stages16x[4] = {2, 2, 2, 2};
+
+
+/* ResampleFactorValue *************************************************/
+unsigned
+ResampleFactorValue(ResampleFactor_t factor)
+{
+    unsigned n_stages = 0;
+    const unsigned* factors = stage_factors(factor, &n_stages);
+    unsigned value = (factors) ? 1 : 0;
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        value *= factors[s];
+    }
+    return value;
+}
+
+
+/* ResampleStageCount **************************************************/
+unsigned
+ResampleStageCount(ResampleFactor_t factor)
+{
+    unsigned n_stages = 0;
+    stage_factors(factor, &n_stages);
+    return n_stages;
+}
+
+
+/* ResampleStageFactor *************************************************/
+unsigned
+ResampleStageFactor(ResampleFactor_t factor, unsigned stage)
+{
+    unsigned n_stages = 0;
+    const unsigned* factors = stage_factors(factor, &n_stages);
+    return (stage < n_stages) ? factors[stage] : 0;
+}
+
+
+/* PolyphaseStageTaps **************************************************/
+unsigned
+PolyphaseStageTaps(ResampleFactor_t factor, unsigned stage)
+{
+    FIRDesignSpec spec;
+    if (stage_spec(&spec, factor, stage))
+    {
+        return spec.length / ResampleStageFactor(factor, stage);
+    }
+    return 0;
+}
+
+
+/* PolyphaseStageDesign ************************************************/
+Error_t
+PolyphaseStageDesign(float*             kernel,
+                     ResampleFactor_t   factor,
+                     unsigned           stage,
+                     int                minimum_phase)
+{
+    FIRDesignSpec spec;
+    if (stage_spec(&spec, factor, stage))
+    {
+        spec.minimum_phase = minimum_phase;
+        return FIRDesign(kernel, &spec);
+    }
+    return VALUE_ERROR;
+}
+
+Error_t
+PolyphaseStageDesignD(double*           kernel,
+                      ResampleFactor_t  factor,
+                      unsigned          stage,
+                      int               minimum_phase)
+{
+    FIRDesignSpec spec;
+    if (stage_spec(&spec, factor, stage))
+    {
+        spec.minimum_phase = minimum_phase;
+        return FIRDesignD(kernel, &spec);
+    }
+    return VALUE_ERROR;
+}
+
+
+/* PolyphaseTableKernel ************************************************/
+Error_t
+PolyphaseTableKernel(float* kernel, ResampleFactor_t factor)
+{
+    if (factor >= N_FACTORS || !PolyphaseCoeffs[factor])
+    {
+        return VALUE_ERROR;
+    }
+    const unsigned n_filters = ResampleFactorValue(factor);
+    for (unsigned p = 0; p < n_filters; ++p)
+    {
+        for (unsigned k = 0; k < POLYPHASE_TAPS; ++k)
+        {
+            kernel[k * n_filters + p] = PolyphaseCoeffs[factor][p][k];
+        }
+    }
+    return NOERR;
+}
+
+Error_t
+PolyphaseTableKernelD(double* kernel, ResampleFactor_t factor)
+{
+    if (factor >= N_FACTORS || !PolyphaseCoeffsD[factor])
+    {
+        return VALUE_ERROR;
+    }
+    const unsigned n_filters = ResampleFactorValue(factor);
+    for (unsigned p = 0; p < n_filters; ++p)
+    {
+        for (unsigned k = 0; k < POLYPHASE_TAPS; ++k)
+        {
+            kernel[k * n_filters + p] = PolyphaseCoeffsD[factor][p][k];
+        }
+    }
+    return NOERR;
+}
+
+/* STATIC FUNCTION DEFINITIONS */
+
+/* Factors of each stage, or NULL if the factor isn't valid */
+static const unsigned*
+stage_factors(ResampleFactor_t factor, unsigned* n_stages)
+{
+    switch(factor)
+    {
+        case X2:
+            *n_stages = 1;
+            return stages2x;
+        case X3:
+            *n_stages = 1;
+            return stages3x;
+        case X4:
+            *n_stages = 2;
+            return stages4x;
+        case X6:
+            *n_stages = 2;
+            return stages6x;
+        case X8:
+            *n_stages = 3;
+            return stages8x;
+        case X16:
+            *n_stages = 4;
+            return stages16x;
+        default:
+            *n_stages = 0;
+            return NULL;
+    }
+}
+
+/* Design spec for a stage, at its higher rate. A stage with factor L whose
+ input is R times the base rate passes RESAMPLE_PASSBAND of the base rate, and
+ stops from R - RESAMPLE_PASSBAND, where the first image starts. The length
+ is rounded up to fill every polyphase component */
+static int
+stage_spec(FIRDesignSpec* spec, ResampleFactor_t factor, unsigned stage)
+{
+    unsigned n_stages = 0;
+    const unsigned* factors = stage_factors(factor, &n_stages);
+    if (stage >= n_stages)
+    {
+        return 0;
+    }
+
+    double rate = 1.0;
+    for (unsigned s = 0; s < stage; ++s)
+    {
+        rate *= factors[s];
+    }
+    const unsigned stage_factor = factors[stage];
+
+    spec->method = FIR_KAISER;
+    spec->type = LOWPASS;
+    spec->cutoff = 0.5 / stage_factor;
+    spec->cutoff_high = 0.0;
+    spec->transition = (rate - 2.0 * RESAMPLE_PASSBAND) / (stage_factor * rate);
+    spec->attenuation = RESAMPLE_ATTENUATION;
+    spec->window = BOXCAR;
+    spec->length = 0;
+    spec->minimum_phase = 0;
+
+    const unsigned length = FIRDesignLength(spec);
+    spec->length = stage_factor * ((length + stage_factor - 1) / stage_factor);
+    return 1;
+}
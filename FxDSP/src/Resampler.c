@@ -0,0 +1,544 @@
+/*
+ * Resampler.c
+ * Hamilton Kibbe
+ * Copyright 2015 Hamilton Kibbe
+ */
+
+#include "Resampler.h"
+#include "FIRDesign.h"
+#include "Dsp.h"
+#include <limits.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Quality presets. The passband is a fraction of the lower sample rate, and
+ the stopband starts at its nyquist frequency */
+typedef struct _ResamplerPreset
+{
+    double      passband;
+    double      attenuation;
+    unsigned    n_phases;
+} ResamplerPreset;
+
+static const ResamplerPreset presets[N_RESAMPLER_QUALITIES] =
+{
+    {0.40, 60.0, 64},
+    {0.43, 90.0, 256},
+    {0.45, 120.0, 1024}
+};
+
+
+/* Output times are kept in 32.32 fixed point, in input samples, so that
+ stepping is exact and the input a run of outputs needs can be predicted */
+#define FRAC_BITS (32)
+#define FRAC_ONE ((uint64_t)1 << FRAC_BITS)
+#define FRAC_MASK (FRAC_ONE - 1)
+
+
+/* Static Function Prototypes */
+static unsigned
+taps_per_phase(const ResamplerPreset* preset, double ratio);
+
+static Error_t
+design_table(double* table, const ResamplerPreset* preset, double ratio, unsigned n_taps);
+
+static unsigned
+resample(Resampler* resampler, float* outBuffer, unsigned max_out,
+         const float* inBuffer, unsigned n_samples);
+
+static unsigned
+resampleD(ResamplerD* resampler, double* outBuffer, unsigned max_out,
+          const double* inBuffer, unsigned n_samples);
+
+
+/* Resampler **********************************************************/
+struct Resampler
+{
+    uint64_t    step;       // Input samples per output sample
+    uint64_t    time;       // Position of the next output in buffer
+    unsigned    n_taps;     // Taps in each polyphase component
+    unsigned    n_phases;   // Number of polyphase components
+    float*      table;      // n_phases + 1 components, time reversed
+    float*      buffer;     // n_taps samples of history, then the input. One
+                            // more than a component reads, for capped outputs
+                            // that are due before the next input sample
+};
+
+struct ResamplerD
+{
+    uint64_t    step;
+    uint64_t    time;
+    unsigned    n_taps;
+    unsigned    n_phases;
+    double*     table;
+    double*     buffer;
+};
+
+
+/* ResamplerInit *******************************************************/
+Resampler*
+ResamplerInit(double input_rate, double output_rate, ResamplerQuality_t quality)
+{
+    if (input_rate <= 0.0 || output_rate <= 0.0 || quality >= N_RESAMPLER_QUALITIES)
+    {
+        return NULL;
+    }
+
+    const ResamplerPreset* preset = &presets[quality];
+    const double ratio = output_rate / input_rate;
+    const unsigned n_taps = taps_per_phase(preset, ratio);
+    const unsigned table_length = (preset->n_phases + 1) * n_taps;
+
+    // Allocate memory for the resampler
+    Resampler* resampler = (Resampler*)malloc(sizeof(Resampler));
+
+    // Allocate memory for the component table and working buffer
+    float* table = (float*)malloc(table_length * sizeof(float));
+    float* buffer = (float*)malloc((n_taps + RESAMPLER_BLOCK_SIZE) * sizeof(float));
+    double* design = (double*)malloc(table_length * sizeof(double));
+
+    if (resampler && table && buffer && design
+        && design_table(design, preset, ratio, n_taps) == NOERR)
+    {
+        DoubleToFloat(table, design, table_length);
+        free(design);
+
+        resampler->step = (uint64_t)llround(FRAC_ONE / ratio);
+        resampler->n_taps = n_taps;
+        resampler->n_phases = preset->n_phases;
+        resampler->table = table;
+        resampler->buffer = buffer;
+        ResamplerFlush(resampler);
+        return resampler;
+    }
+    else
+    {
+        if (design)
+        {
+            free(design);
+        }
+        if (buffer)
+        {
+            free(buffer);
+        }
+        if (table)
+        {
+            free(table);
+        }
+        if (resampler)
+        {
+            free(resampler);
+        }
+        return NULL;
+    }
+}
+
+ResamplerD*
+ResamplerInitD(double input_rate, double output_rate, ResamplerQuality_t quality)
+{
+    if (input_rate <= 0.0 || output_rate <= 0.0 || quality >= N_RESAMPLER_QUALITIES)
+    {
+        return NULL;
+    }
+
+    const ResamplerPreset* preset = &presets[quality];
+    const double ratio = output_rate / input_rate;
+    const unsigned n_taps = taps_per_phase(preset, ratio);
+    const unsigned table_length = (preset->n_phases + 1) * n_taps;
+
+    // Allocate memory for the resampler
+    ResamplerD* resampler = (ResamplerD*)malloc(sizeof(ResamplerD));
+
+    // Allocate memory for the component table and working buffer
+    double* table = (double*)malloc(table_length * sizeof(double));
+    double* buffer = (double*)malloc((n_taps + RESAMPLER_BLOCK_SIZE) * sizeof(double));
+
+    if (resampler && table && buffer
+        && design_table(table, preset, ratio, n_taps) == NOERR)
+    {
+        resampler->step = (uint64_t)llround(FRAC_ONE / ratio);
+        resampler->n_taps = n_taps;
+        resampler->n_phases = preset->n_phases;
+        resampler->table = table;
+        resampler->buffer = buffer;
+        ResamplerFlushD(resampler);
+        return resampler;
+    }
+    else
+    {
+        if (buffer)
+        {
+            free(buffer);
+        }
+        if (table)
+        {
+            free(table);
+        }
+        if (resampler)
+        {
+            free(resampler);
+        }
+        return NULL;
+    }
+}
+
+
+/* ResamplerFree *******************************************************/
+Error_t
+ResamplerFree(Resampler* resampler)
+{
+    if (resampler)
+    {
+        if (resampler->table)
+        {
+            free(resampler->table);
+        }
+        if (resampler->buffer)
+        {
+            free(resampler->buffer);
+        }
+        free(resampler);
+    }
+    return NOERR;
+}
+
+Error_t
+ResamplerFreeD(ResamplerD* resampler)
+{
+    if (resampler)
+    {
+        if (resampler->table)
+        {
+            free(resampler->table);
+        }
+        if (resampler->buffer)
+        {
+            free(resampler->buffer);
+        }
+        free(resampler);
+    }
+    return NOERR;
+}
+
+
+/* ResamplerFlush ******************************************************/
+Error_t
+ResamplerFlush(Resampler* resampler)
+{
+    ClearBuffer(resampler->buffer, resampler->n_taps);
+    resampler->time = (uint64_t)resampler->n_taps << FRAC_BITS;
+    return NOERR;
+}
+
+Error_t
+ResamplerFlushD(ResamplerD* resampler)
+{
+    ClearBufferD(resampler->buffer, resampler->n_taps);
+    resampler->time = (uint64_t)resampler->n_taps << FRAC_BITS;
+    return NOERR;
+}
+
+
+/* ResamplerMaxOutput **************************************************/
+unsigned
+ResamplerMaxOutput(const Resampler* resampler, unsigned n_samples)
+{
+    return (unsigned)ceil((double)n_samples * FRAC_ONE / resampler->step) + 1;
+}
+
+unsigned
+ResamplerMaxOutputD(const ResamplerD* resampler, unsigned n_samples)
+{
+    return (unsigned)ceil((double)n_samples * FRAC_ONE / resampler->step) + 1;
+}
+
+
+/* ResamplerLatency ****************************************************/
+double
+ResamplerLatency(const Resampler* resampler)
+{
+    return resampler->n_taps / 2.0;
+}
+
+double
+ResamplerLatencyD(const ResamplerD* resampler)
+{
+    return resampler->n_taps / 2.0;
+}
+
+
+/* ResamplerSetRatio ***************************************************/
+Error_t
+ResamplerSetRatio(Resampler* resampler, double ratio)
+{
+    if (ratio > 0.0 && ratio < FRAC_ONE)
+    {
+        resampler->step = (uint64_t)llround(FRAC_ONE / ratio);
+        return NOERR;
+    }
+    return VALUE_ERROR;
+}
+
+Error_t
+ResamplerSetRatioD(ResamplerD* resampler, double ratio)
+{
+    if (ratio > 0.0 && ratio < FRAC_ONE)
+    {
+        resampler->step = (uint64_t)llround(FRAC_ONE / ratio);
+        return NOERR;
+    }
+    return VALUE_ERROR;
+}
+
+
+/* ResamplerInputNeeded ************************************************/
+unsigned
+ResamplerInputNeeded(const Resampler* resampler, unsigned n_out)
+{
+    if (n_out == 0)
+    {
+        return 0;
+    }
+
+    // The last output reads up to the input sample at its integer position
+    const uint64_t last = resampler->time + (uint64_t)(n_out - 1) * resampler->step;
+    const uint64_t index = last >> FRAC_BITS;
+    return (index >= resampler->n_taps) ? (unsigned)(index - resampler->n_taps + 1) : 0;
+}
+
+unsigned
+ResamplerInputNeededD(const ResamplerD* resampler, unsigned n_out)
+{
+    if (n_out == 0)
+    {
+        return 0;
+    }
+
+    const uint64_t last = resampler->time + (uint64_t)(n_out - 1) * resampler->step;
+    const uint64_t index = last >> FRAC_BITS;
+    return (index >= resampler->n_taps) ? (unsigned)(index - resampler->n_taps + 1) : 0;
+}
+
+
+/* ResamplerProcess ****************************************************/
+Error_t
+ResamplerProcess(Resampler*     resampler,
+                 float*         outBuffer,
+                 unsigned*      n_out,
+                 const float*   inBuffer,
+                 unsigned       n_samples)
+{
+    if (resampler && outBuffer && n_out)
+    {
+        *n_out = resample(resampler, outBuffer, UINT_MAX, inBuffer, n_samples);
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+Error_t
+ResamplerProcessD(ResamplerD*   resampler,
+                  double*       outBuffer,
+                  unsigned*     n_out,
+                  const double* inBuffer,
+                  unsigned      n_samples)
+{
+    if (resampler && outBuffer && n_out)
+    {
+        *n_out = resampleD(resampler, outBuffer, UINT_MAX, inBuffer, n_samples);
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+
+/* ResamplerProcessOutput **********************************************/
+Error_t
+ResamplerProcessOutput(Resampler*   resampler,
+                       float*       outBuffer,
+                       unsigned     n_out,
+                       const float* inBuffer)
+{
+    if (resampler && outBuffer)
+    {
+        const unsigned n_samples = ResamplerInputNeeded(resampler, n_out);
+        resample(resampler, outBuffer, n_out, inBuffer, n_samples);
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+Error_t
+ResamplerProcessOutputD(ResamplerD*     resampler,
+                        double*         outBuffer,
+                        unsigned        n_out,
+                        const double*   inBuffer)
+{
+    if (resampler && outBuffer)
+    {
+        const unsigned n_samples = ResamplerInputNeededD(resampler, n_out);
+        resampleD(resampler, outBuffer, n_out, inBuffer, n_samples);
+        return NOERR;
+    }
+    else
+    {
+        return NULL_PTR_ERROR;
+    }
+}
+
+
+/* STATIC FUNCTION DEFINITIONS */
+
+/* Number of taps each component needs to meet the preset's transition width
+ and attenuation. Downsampling narrows the transition, so needs more */
+static unsigned
+taps_per_phase(const ResamplerPreset* preset, double ratio)
+{
+    const double scale = (ratio < 1.0) ? ratio : 1.0;
+    const double transition = (0.5 - preset->passband) * scale;
+    return (unsigned)ceil((preset->attenuation - 7.95) / (14.36 * transition));
+}
+
+/* Design the prototype at n_phases times the input rate with a Kaiser window,
+ then split it into time-reversed components scaled by n_phases. The prototype
+ starts with a zero tap, so the extra component at the end is exactly the
+ first one a sample later, and interpolation past the last component needs no
+ wrap */
+static Error_t
+design_table(double* table, const ResamplerPreset* preset, double ratio, unsigned n_taps)
+{
+    const unsigned n_phases = preset->n_phases;
+    const unsigned length = n_taps * n_phases;
+    const double scale = (ratio < 1.0) ? ratio : 1.0;
+    FIRDesignSpec spec =
+    {
+        FIR_KAISER, LOWPASS,
+        scale * (preset->passband + 0.5) / (2.0 * n_phases), 0.0,
+        scale * (0.5 - preset->passband) / n_phases,
+        preset->attenuation, BOXCAR, length - 1, 0
+    };
+
+    double* prototype = (double*)malloc((length + n_phases) * sizeof(double));
+    if (!prototype)
+    {
+        return NULL_PTR_ERROR;
+    }
+
+    Error_t err = FIRDesignD(prototype + 1, &spec);
+    if (err == NOERR)
+    {
+        prototype[0] = 0.0;
+        ClearBufferD(prototype + length, n_phases);
+        for (unsigned p = 0; p <= n_phases; ++p)
+        {
+            double* component = table + p * n_taps;
+            for (unsigned k = 0; k < n_taps; ++k)
+            {
+                component[n_taps - 1 - k] = n_phases * prototype[k * n_phases + p];
+            }
+        }
+    }
+    free(prototype);
+    return err;
+}
+
+/* Write the outputs due by the end of the input, up to max_out of them. The
+ input is copied in after the history in chunks, and each output is
+ interpolated between the two components either side of its fractional
+ position. Returns the number of outputs written */
+static unsigned
+resample(Resampler* resampler, float* outBuffer, unsigned max_out,
+         const float* inBuffer, unsigned n_samples)
+{
+    const unsigned n_taps = resampler->n_taps;
+    const unsigned n_phases = resampler->n_phases;
+    float* buffer = resampler->buffer;
+    uint64_t time = resampler->time;
+    unsigned written = 0;
+
+    // Runs at least once, as capped outputs may be due before any new input
+    do
+    {
+        const unsigned n_block = (n_samples < RESAMPLER_BLOCK_SIZE)
+                               ? n_samples : RESAMPLER_BLOCK_SIZE;
+        const uint64_t end = (uint64_t)(n_taps + n_block) << FRAC_BITS;
+        CopyBuffer(buffer + n_taps, inBuffer, n_block);
+
+        for (; time < end && written < max_out; time += resampler->step)
+        {
+            const unsigned index = (unsigned)(time >> FRAC_BITS);
+            const uint64_t position = (time & FRAC_MASK) * n_phases;
+            const unsigned phase = (unsigned)(position >> FRAC_BITS);
+            const float frac = (position & FRAC_MASK) * (1.0 / FRAC_ONE);
+
+            const float* component = resampler->table + phase * n_taps;
+            outBuffer[written++] = VectorInterpolatedDotProduct(buffer + index + 1 - n_taps,
+                                                                component,
+                                                                component + n_taps,
+                                                                frac, n_taps);
+        }
+
+        // Keep the last n_taps input samples
+        memmove(buffer, buffer + n_block, n_taps * sizeof(float));
+        time -= (uint64_t)n_block << FRAC_BITS;
+        inBuffer += n_block;
+        n_samples -= n_block;
+    } while (n_samples > 0);
+
+    resampler->time = time;
+    return written;
+}
+
+static unsigned
+resampleD(ResamplerD* resampler, double* outBuffer, unsigned max_out,
+          const double* inBuffer, unsigned n_samples)
+{
+    const unsigned n_taps = resampler->n_taps;
+    const unsigned n_phases = resampler->n_phases;
+    double* buffer = resampler->buffer;
+    uint64_t time = resampler->time;
+    unsigned written = 0;
+
+    do
+    {
+        const unsigned n_block = (n_samples < RESAMPLER_BLOCK_SIZE)
+                               ? n_samples : RESAMPLER_BLOCK_SIZE;
+        const uint64_t end = (uint64_t)(n_taps + n_block) << FRAC_BITS;
+        CopyBufferD(buffer + n_taps, inBuffer, n_block);
+
+        for (; time < end && written < max_out; time += resampler->step)
+        {
+            const unsigned index = (unsigned)(time >> FRAC_BITS);
+            const uint64_t position = (time & FRAC_MASK) * n_phases;
+            const unsigned phase = (unsigned)(position >> FRAC_BITS);
+            const double frac = (position & FRAC_MASK) * (1.0 / FRAC_ONE);
+
+            const double* component = resampler->table + phase * n_taps;
+            outBuffer[written++] = VectorInterpolatedDotProductD(buffer + index + 1 - n_taps,
+                                                                 component,
+                                                                 component + n_taps,
+                                                                 frac, n_taps);
+        }
+
+        memmove(buffer, buffer + n_block, n_taps * sizeof(double));
+        time -= (uint64_t)n_block << FRAC_BITS;
+        inBuffer += n_block;
+        n_samples -= n_block;
+    } while (n_samples > 0);
+
+    resampler->time = time;
+    return written;
+}
@@ -5,23 +5,99 @@
  */
 
 #include "Upsampler.h"
-#include "FIRFilter.h"
 #include "Dsp.h"
+#include "HalfbandFilter.h"
 #include <math.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+
+/* Input samples run through a cascade at a time */
+#define CASCADE_BLOCK (256)
+
+
+/* One polyphase FIR stage of a cascade */
+typedef struct _UpsamplerStage
+{
+    unsigned    factor;
+    unsigned    n_taps;     // Taps in each polyphase component
+    float*      kernel;     // Polyphase components, scaled by factor
+    float*      history;    // Last n_taps - 1 input samples, and room for as
+                            // many more
+} UpsamplerStage;
+
+typedef struct _UpsamplerStageD
+{
+    unsigned    factor;
+    unsigned    n_taps;
+    double*     kernel;
+    double*     history;
+} UpsamplerStageD;
+
+
+/* Static Function Prototypes */
+static int
+valid_mode(ResampleFactor_t factor, ResampleMode_t mode);
+
+static int
+tabulated(ResampleFactor_t factor, ResampleMode_t mode);
+
+static unsigned
+stage_count(ResampleFactor_t factor, ResampleMode_t mode);
+
+static unsigned
+scratch_length(ResampleFactor_t factor, ResampleMode_t mode);
+
+static UpsamplerStage*
+init_fir_stages(ResampleFactor_t factor, ResampleMode_t mode);
+
+static UpsamplerStageD*
+init_fir_stagesD(ResampleFactor_t factor, ResampleMode_t mode);
+
+static HalfbandFilter**
+init_iir_stages(unsigned n_stages);
+
+static HalfbandFilterD**
+init_iir_stagesD(unsigned n_stages);
+
+static void
+free_fir_stages(UpsamplerStage* stages, unsigned n_stages);
+
+static void
+free_fir_stagesD(UpsamplerStageD* stages, unsigned n_stages);
+
+static void
+free_iir_stages(HalfbandFilter** stages, unsigned n_stages);
+
+static void
+free_iir_stagesD(HalfbandFilterD** stages, unsigned n_stages);
+
+static unsigned
+fir_upsample(UpsamplerStage* stage, float* outBuffer, const float* inBuffer, unsigned n_samples);
+
+static unsigned
+fir_upsampleD(UpsamplerStageD* stage, double* outBuffer, const double* inBuffer, unsigned n_samples);
+
 
 /* Upsampler **********************************************************/
 struct Upsampler
 {
-    unsigned factor;
-    FIRFilter** polyphase;
+    unsigned            factor;
+    unsigned            n_stages;
+    UpsamplerStage*     fir;        // NULL in RESAMPLE_IIR mode
+    HalfbandFilter**    iir;        // NULL in the FIR modes
+    unsigned            n_scratch;  // Length of each scratch buffer
+    float*              scratch;    // Two buffers between stages
 };
 
 struct UpsamplerD
 {
-    unsigned factor;
-    FIRFilterD** polyphase;
+    unsigned            factor;
+    unsigned            n_stages;
+    UpsamplerStageD*    fir;
+    HalfbandFilterD**   iir;
+    unsigned            n_scratch;
+    double*             scratch;
 };
 
 
@@ -29,54 +105,59 @@ struct UpsamplerD
 Upsampler*
 UpsamplerInit(ResampleFactor_t factor)
 {
-    unsigned n_filters = 1;
-    switch(factor)
+    return UpsamplerInitMode(factor, RESAMPLE_FIR);
+}
+
+UpsamplerD*
+UpsamplerInitD(ResampleFactor_t factor)
+{
+    return UpsamplerInitModeD(factor, RESAMPLE_FIR);
+}
+
+
+/* UpsamplerInitMode ***************************************************/
+Upsampler*
+UpsamplerInitMode(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    if (!valid_mode(factor, mode))
     {
-        case X2:
-            n_filters = 2;
-            break;
-        case X4:
-            n_filters = 4;
-            break;
-        case X8:
-            n_filters = 8;
-            break;
-        /*
-        case X16:
-            n_filters = 16;
-            break;
-        */
-        default:
-            return NULL;
+        return NULL;
     }
+    const unsigned n_stages = stage_count(factor, mode);
+    const unsigned n_scratch = scratch_length(factor, mode);
 
     // Allocate memory for the upsampler
     Upsampler* upsampler = (Upsampler*)malloc(sizeof(Upsampler));
 
-    // Allocate memory for the polyphase array
-    FIRFilter** polyphase = (FIRFilter**)malloc(n_filters * sizeof(FIRFilter*));
+    // Allocate the stages, and the buffers between them
+    UpsamplerStage* fir = (mode != RESAMPLE_IIR) ? init_fir_stages(factor, mode) : NULL;
+    HalfbandFilter** iir = (mode == RESAMPLE_IIR) ? init_iir_stages(n_stages) : NULL;
+    float* scratch = (n_scratch) ? (float*)malloc(2 * n_scratch * sizeof(float)) : NULL;
 
-    if (upsampler && polyphase)
+    if (upsampler && (fir || iir) && (scratch || !n_scratch))
     {
-        upsampler->polyphase = polyphase;
-
-        // Create polyphase filters
-        unsigned idx;
-        for(idx = 0; idx < n_filters; ++idx)
-        {
-            upsampler->polyphase[idx] = FIRFilterInit(PolyphaseCoeffs[factor][idx], 64, DIRECT);
-        }
-
-        // Add factor
-        upsampler->factor = n_filters;
-
+        upsampler->factor = ResampleFactorValue(factor);
+        upsampler->n_stages = n_stages;
+        upsampler->fir = fir;
+        upsampler->iir = iir;
+        upsampler->n_scratch = n_scratch;
+        upsampler->scratch = scratch;
+        UpsamplerFlush(upsampler);
         return upsampler;
     }
     else
     {
-        if (polyphase)
+        if (scratch)
         {
-            free(polyphase);
+            free(scratch);
+        }
+        if (iir)
+        {
+            free_iir_stages(iir, n_stages);
+        }
+        if (fir)
+        {
+            free_fir_stages(fir, n_stages);
         }
         if (upsampler)
         {
@@ -87,56 +168,47 @@ UpsamplerInit(ResampleFactor_t factor)
 }
 
 UpsamplerD*
-UpsamplerInitD(ResampleFactor_t factor)
+UpsamplerInitModeD(ResampleFactor_t factor, ResampleMode_t mode)
 {
-    unsigned n_filters = 1;
-    switch(factor)
+    if (!valid_mode(factor, mode))
     {
-        case X2:
-            n_filters = 2;
-            break;
-        case X4:
-            n_filters = 4;
-            break;
-        case X8:
-            n_filters = 8;
-            break;
-        /*
-        case X16:
-            n_filters = 16;
-            break;
-        */
-        default:
-            return NULL;
+        return NULL;
     }
+    const unsigned n_stages = stage_count(factor, mode);
+    const unsigned n_scratch = scratch_length(factor, mode);
 
     // Allocate memory for the upsampler
     UpsamplerD* upsampler = (UpsamplerD*)malloc(sizeof(UpsamplerD));
 
-    // Allocate memory for the polyphase array
-    FIRFilterD** polyphase = (FIRFilterD**)malloc(n_filters * sizeof(FIRFilterD*));
+    // Allocate the stages, and the buffers between them
+    UpsamplerStageD* fir = (mode != RESAMPLE_IIR) ? init_fir_stagesD(factor, mode) : NULL;
+    HalfbandFilterD** iir = (mode == RESAMPLE_IIR) ? init_iir_stagesD(n_stages) : NULL;
+    double* scratch = (n_scratch) ? (double*)malloc(2 * n_scratch * sizeof(double)) : NULL;
 
-    if (upsampler && polyphase)
+    if (upsampler && (fir || iir) && (scratch || !n_scratch))
     {
-        upsampler->polyphase = polyphase;
-
-        // Create polyphase filters
-        unsigned idx;
-        for(idx = 0; idx < n_filters; ++idx)
-        {
-            upsampler->polyphase[idx] = FIRFilterInitD(PolyphaseCoeffsD[factor][idx], 64, DIRECT);
-        }
-
-        // Add factor
-        upsampler->factor = n_filters;
-
+        upsampler->factor = ResampleFactorValue(factor);
+        upsampler->n_stages = n_stages;
+        upsampler->fir = fir;
+        upsampler->iir = iir;
+        upsampler->n_scratch = n_scratch;
+        upsampler->scratch = scratch;
+        UpsamplerFlushD(upsampler);
         return upsampler;
     }
     else
     {
-        if (polyphase)
+        if (scratch)
+        {
+            free(scratch);
+        }
+        if (iir)
+        {
+            free_iir_stagesD(iir, n_stages);
+        }
+        if (fir)
         {
-            free(polyphase);
+            free_fir_stagesD(fir, n_stages);
         }
         if (upsampler)
         {
@@ -146,19 +218,24 @@ UpsamplerInitD(ResampleFactor_t factor)
     }
 }
 
+
 /* UpsamplerFree *******************************************************/
 Error_t
 UpsamplerFree(Upsampler* upsampler)
 {
     if (upsampler)
     {
-        if (upsampler->polyphase)
+        if (upsampler->fir)
         {
-            for (unsigned i = 0; i < upsampler->factor; ++i)
-            {
-                FIRFilterFree(upsampler->polyphase[i]);
-            }
-            free(upsampler->polyphase);
+            free_fir_stages(upsampler->fir, upsampler->n_stages);
+        }
+        if (upsampler->iir)
+        {
+            free_iir_stages(upsampler->iir, upsampler->n_stages);
+        }
+        if (upsampler->scratch)
+        {
+            free(upsampler->scratch);
         }
         free(upsampler);
     }
@@ -170,28 +247,37 @@ UpsamplerFreeD(UpsamplerD* upsampler)
 {
     if (upsampler)
     {
-        if (upsampler->polyphase)
+        if (upsampler->fir)
         {
-            for (unsigned i = 0; i < upsampler->factor; ++i)
-            {
-                FIRFilterFreeD(upsampler->polyphase[i]);
-            }
-            free(upsampler->polyphase);
+            free_fir_stagesD(upsampler->fir, upsampler->n_stages);
+        }
+        if (upsampler->iir)
+        {
+            free_iir_stagesD(upsampler->iir, upsampler->n_stages);
+        }
+        if (upsampler->scratch)
+        {
+            free(upsampler->scratch);
         }
         free(upsampler);
     }
     return NOERR;
 }
 
-
 /* UpsamplerFlush ****************************************************/
 Error_t
 UpsamplerFlush(Upsampler* upsampler)
 {
-    unsigned idx;
-    for (idx = 0; idx < upsampler->factor; ++idx)
+    for (unsigned s = 0; s < upsampler->n_stages; ++s)
     {
-        FIRFilterFlush(upsampler->polyphase[idx]);
+        if (upsampler->fir)
+        {
+            ClearBuffer(upsampler->fir[s].history, upsampler->fir[s].n_taps - 1);
+        }
+        else
+        {
+            HalfbandFilterFlush(upsampler->iir[s]);
+        }
     }
     return NOERR;
 }
@@ -199,10 +285,16 @@ UpsamplerFlush(Upsampler* upsampler)
 Error_t
 UpsamplerFlushD(UpsamplerD* upsampler)
 {
-    unsigned idx;
-    for (idx = 0; idx < upsampler->factor; ++idx)
+    for (unsigned s = 0; s < upsampler->n_stages; ++s)
     {
-        FIRFilterFlushD(upsampler->polyphase[idx]);
+        if (upsampler->fir)
+        {
+            ClearBufferD(upsampler->fir[s].history, upsampler->fir[s].n_taps - 1);
+        }
+        else
+        {
+            HalfbandFilterFlushD(upsampler->iir[s]);
+        }
     }
     return NOERR;
 }
@@ -210,22 +302,37 @@ UpsamplerFlushD(UpsamplerD* upsampler)
 
 /* UpsamplerProcess ****************************************************/
 Error_t
-UpsamplerProcess(Upsampler      *upsampler,
-                 float          *outBuffer,
-                 const float    *inBuffer,
+UpsamplerProcess(Upsampler*     upsampler,
+                 float*         outBuffer,
+                 const float*   inBuffer,
                  unsigned       n_samples)
 {
-    float tempbuf[n_samples];
-    if (upsampler && outBuffer)
+    if (upsampler && outBuffer && inBuffer)
     {
-        for (unsigned filt = 0; filt < upsampler->factor; ++filt)
+        // A cascade runs a block at a time through the scratch buffers, with
+        // the last stage writing the output. A single stage needn't split
+        const unsigned last = upsampler->n_stages - 1;
+        const unsigned block = (last > 0) ? CASCADE_BLOCK : n_samples;
+        for (unsigned i = 0; i < n_samples; i += block)
         {
-            FIRFilterProcess(upsampler->polyphase[filt], tempbuf, inBuffer, n_samples);
-            CopyBufferStride(outBuffer+filt, upsampler->factor, tempbuf, 1, n_samples);
+            const float* src = inBuffer + i;
+            unsigned n = (n_samples - i < block) ? n_samples - i : block;
+            for (unsigned s = 0; s <= last; ++s)
+            {
+                float* dest = (s == last) ? outBuffer + i * upsampler->factor :
+                              upsampler->scratch + (s % 2) * upsampler->n_scratch;
+                if (upsampler->fir)
+                {
+                    n = fir_upsample(upsampler->fir + s, dest, src, n);
+                }
+                else
+                {
+                    HalfbandFilterUpsample(upsampler->iir[s], dest, src, n);
+                    n *= 2;
+                }
+                src = dest;
+            }
         }
-
-        VectorScalarMultiply(outBuffer, (const float*)outBuffer,
-                             upsampler->factor, n_samples * upsampler->factor);
         return NOERR;
     }
     else
@@ -236,21 +343,36 @@ UpsamplerProcess(Upsampler      *upsampler,
 
 Error_t
 UpsamplerProcessD(UpsamplerD*   upsampler,
-                 double*        outBuffer,
-                 const double*  inBuffer,
-                 unsigned       n_samples)
+                  double*       outBuffer,
+                  const double* inBuffer,
+                  unsigned      n_samples)
 {
-    double tempbuf[n_samples];
-    if (upsampler && outBuffer)
+    if (upsampler && outBuffer && inBuffer)
     {
-        for (unsigned filt = 0; filt < upsampler->factor; ++ filt)
+        // A cascade runs a block at a time through the scratch buffers, with
+        // the last stage writing the output. A single stage needn't split
+        const unsigned last = upsampler->n_stages - 1;
+        const unsigned block = (last > 0) ? CASCADE_BLOCK : n_samples;
+        for (unsigned i = 0; i < n_samples; i += block)
         {
-            FIRFilterProcessD(upsampler->polyphase[filt], tempbuf, inBuffer, n_samples);
-            CopyBufferStrideD(outBuffer+filt, upsampler->factor, tempbuf, 1, n_samples);
+            const double* src = inBuffer + i;
+            unsigned n = (n_samples - i < block) ? n_samples - i : block;
+            for (unsigned s = 0; s <= last; ++s)
+            {
+                double* dest = (s == last) ? outBuffer + i * upsampler->factor :
+                               upsampler->scratch + (s % 2) * upsampler->n_scratch;
+                if (upsampler->fir)
+                {
+                    n = fir_upsampleD(upsampler->fir + s, dest, src, n);
+                }
+                else
+                {
+                    HalfbandFilterUpsampleD(upsampler->iir[s], dest, src, n);
+                    n *= 2;
+                }
+                src = dest;
+            }
         }
-
-        VectorScalarMultiplyD(outBuffer, (const double*)outBuffer,
-                             upsampler->factor, n_samples * upsampler->factor);
         return NOERR;
     }
     else
@@ -258,3 +380,291 @@ UpsamplerProcessD(UpsamplerD*   upsampler,
         return NULL_PTR_ERROR;
     }
 }
+
+
+/* STATIC FUNCTION DEFINITIONS */
+
+/* The half-band IIR filters only resample by 2 */
+static int
+valid_mode(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    const unsigned n_stages = ResampleStageCount(factor);
+    if (n_stages == 0 || mode >= N_RESAMPLE_MODES)
+    {
+        return 0;
+    }
+    for (unsigned s = 0; mode == RESAMPLE_IIR && s < n_stages; ++s)
+    {
+        if (ResampleStageFactor(factor, s) != 2)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* RESAMPLE_FIR runs the tabulated filter where there is one */
+static int
+tabulated(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    return mode == RESAMPLE_FIR && PolyphaseCoeffs[factor] != NULL;
+}
+
+/* A tabulated filter is a single stage, the rest follow the cascade */
+static unsigned
+stage_count(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    return tabulated(factor, mode) ? 1 : ResampleStageCount(factor);
+}
+
+/* Longest output of a stage before the last, for one block */
+static unsigned
+scratch_length(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    const unsigned n_stages = stage_count(factor, mode);
+    const unsigned last = ResampleStageFactor(factor, n_stages - 1);
+    return (n_stages > 1) ? CASCADE_BLOCK * (ResampleFactorValue(factor) / last) : 0;
+}
+
+/* Set up the FIR stages, from the base rate up. Each prototype, tabulated or
+ designed, is split into its polyphase components, with the gain of the factor
+ that makes up for the inserted zeros folded in */
+static UpsamplerStage*
+init_fir_stages(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    const int table = tabulated(factor, mode);
+    const int minimum_phase = (mode == RESAMPLE_FIR_MINIMUM_PHASE);
+    const unsigned n_stages = stage_count(factor, mode);
+    UpsamplerStage* stages = (UpsamplerStage*)calloc(n_stages, sizeof(UpsamplerStage));
+    if (!stages)
+    {
+        return NULL;
+    }
+
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        UpsamplerStage* stage = stages + s;
+        stage->factor = (table) ? ResampleFactorValue(factor) : ResampleStageFactor(factor, s);
+        stage->n_taps = (table) ? POLYPHASE_TAPS : PolyphaseStageTaps(factor, s);
+        stage->kernel = (float*)malloc(stage->factor * stage->n_taps * sizeof(float));
+        stage->history = (float*)malloc(2 * (stage->n_taps - 1) * sizeof(float));
+        float* prototype = (float*)malloc(stage->factor * stage->n_taps * sizeof(float));
+        const Error_t err = (!prototype) ? NULL_PTR_ERROR : (table) ?
+            PolyphaseTableKernel(prototype, factor) :
+            PolyphaseStageDesign(prototype, factor, s, minimum_phase);
+        if (!stage->kernel || !stage->history || err != NOERR)
+        {
+            if (prototype)
+            {
+                free(prototype);
+            }
+            free_fir_stages(stages, n_stages);
+            return NULL;
+        }
+
+        for (unsigned p = 0; p < stage->factor; ++p)
+        {
+            for (unsigned k = 0; k < stage->n_taps; ++k)
+            {
+                stage->kernel[p * stage->n_taps + k] = stage->factor
+                                                     * prototype[k * stage->factor + p];
+            }
+        }
+        free(prototype);
+    }
+    return stages;
+}
+
+static UpsamplerStageD*
+init_fir_stagesD(ResampleFactor_t factor, ResampleMode_t mode)
+{
+    const int table = tabulated(factor, mode);
+    const int minimum_phase = (mode == RESAMPLE_FIR_MINIMUM_PHASE);
+    const unsigned n_stages = stage_count(factor, mode);
+    UpsamplerStageD* stages = (UpsamplerStageD*)calloc(n_stages, sizeof(UpsamplerStageD));
+    if (!stages)
+    {
+        return NULL;
+    }
+
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        UpsamplerStageD* stage = stages + s;
+        stage->factor = (table) ? ResampleFactorValue(factor) : ResampleStageFactor(factor, s);
+        stage->n_taps = (table) ? POLYPHASE_TAPS : PolyphaseStageTaps(factor, s);
+        stage->kernel = (double*)malloc(stage->factor * stage->n_taps * sizeof(double));
+        stage->history = (double*)malloc(2 * (stage->n_taps - 1) * sizeof(double));
+        double* prototype = (double*)malloc(stage->factor * stage->n_taps * sizeof(double));
+        const Error_t err = (!prototype) ? NULL_PTR_ERROR : (table) ?
+            PolyphaseTableKernelD(prototype, factor) :
+            PolyphaseStageDesignD(prototype, factor, s, minimum_phase);
+        if (!stage->kernel || !stage->history || err != NOERR)
+        {
+            if (prototype)
+            {
+                free(prototype);
+            }
+            free_fir_stagesD(stages, n_stages);
+            return NULL;
+        }
+
+        for (unsigned p = 0; p < stage->factor; ++p)
+        {
+            for (unsigned k = 0; k < stage->n_taps; ++k)
+            {
+                stage->kernel[p * stage->n_taps + k] = stage->factor
+                                                     * prototype[k * stage->factor + p];
+            }
+        }
+        free(prototype);
+    }
+    return stages;
+}
+
+/* Create the 2x stages of a cascade, from the base rate up */
+static HalfbandFilter**
+init_iir_stages(unsigned n_stages)
+{
+    HalfbandFilter** stages = (HalfbandFilter**)calloc(n_stages, sizeof(HalfbandFilter*));
+    if (stages)
+    {
+        for (unsigned s = 0; s < n_stages; ++s)
+        {
+            stages[s] = HalfbandFilterInitStage(s);
+            if (!stages[s])
+            {
+                free_iir_stages(stages, n_stages);
+                return NULL;
+            }
+        }
+    }
+    return stages;
+}
+
+static HalfbandFilterD**
+init_iir_stagesD(unsigned n_stages)
+{
+    HalfbandFilterD** stages = (HalfbandFilterD**)calloc(n_stages, sizeof(HalfbandFilterD*));
+    if (stages)
+    {
+        for (unsigned s = 0; s < n_stages; ++s)
+        {
+            stages[s] = HalfbandFilterInitStageD(s);
+            if (!stages[s])
+            {
+                free_iir_stagesD(stages, n_stages);
+                return NULL;
+            }
+        }
+    }
+    return stages;
+}
+
+static void
+free_fir_stages(UpsamplerStage* stages, unsigned n_stages)
+{
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        if (stages[s].kernel)
+        {
+            free(stages[s].kernel);
+        }
+        if (stages[s].history)
+        {
+            free(stages[s].history);
+        }
+    }
+    free(stages);
+}
+
+static void
+free_fir_stagesD(UpsamplerStageD* stages, unsigned n_stages)
+{
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        if (stages[s].kernel)
+        {
+            free(stages[s].kernel);
+        }
+        if (stages[s].history)
+        {
+            free(stages[s].history);
+        }
+    }
+    free(stages);
+}
+
+static void
+free_iir_stages(HalfbandFilter** stages, unsigned n_stages)
+{
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        HalfbandFilterFree(stages[s]);
+    }
+    free(stages);
+}
+
+static void
+free_iir_stagesD(HalfbandFilterD** stages, unsigned n_stages)
+{
+    for (unsigned s = 0; s < n_stages; ++s)
+    {
+        HalfbandFilterFreeD(stages[s]);
+    }
+    free(stages);
+}
+
+/* Run one FIR stage, returning the number of samples written. The polyphase
+ components share one input history and the outputs are written interleaved
+ in a single pass */
+static unsigned
+fir_upsample(UpsamplerStage* stage, float* outBuffer, const float* inBuffer, unsigned n_samples)
+{
+    const unsigned n_history = stage->n_taps - 1;
+    float* history = stage->history;
+
+    // The first outputs need the history. Run them from the history followed
+    // by a copy of the start of the input
+    const unsigned n_head = (n_samples < n_history) ? n_samples : n_history;
+    CopyBuffer(history + n_history, inBuffer, n_head);
+    ConvolvePolyphase(history, n_head, stage->kernel, stage->n_taps, stage->factor, outBuffer);
+
+    // The rest come straight from the input. Keep the last n_history samples
+    if (n_samples > n_history)
+    {
+        ConvolvePolyphase(inBuffer, n_samples - n_history, stage->kernel, stage->n_taps,
+                          stage->factor, outBuffer + n_history * stage->factor);
+        CopyBuffer(history, inBuffer + n_samples - n_history, n_history);
+    }
+    else
+    {
+        memmove(history, history + n_samples, n_history * sizeof(float));
+    }
+    return n_samples * stage->factor;
+}
+
+static unsigned
+fir_upsampleD(UpsamplerStageD* stage, double* outBuffer, const double* inBuffer, unsigned n_samples)
+{
+    const unsigned n_history = stage->n_taps - 1;
+    double* history = stage->history;
+
+    // The first outputs need the history. Run them from the history followed
+    // by a copy of the start of the input
+    const unsigned n_head = (n_samples < n_history) ? n_samples : n_history;
+    CopyBufferD(history + n_history, inBuffer, n_head);
+    ConvolvePolyphaseD(history, n_head, stage->kernel, stage->n_taps, stage->factor, outBuffer);
+
+    // The rest come straight from the input. Keep the last n_history samples
+    if (n_samples > n_history)
+    {
+        ConvolvePolyphaseD(inBuffer, n_samples - n_history, stage->kernel, stage->n_taps,
+                           stage->factor, outBuffer + n_history * stage->factor);
+        CopyBufferD(history, inBuffer + n_samples - n_history, n_history);
+    }
+    else
+    {
+        memmove(history, history + n_samples, n_history * sizeof(double));
+    }
+    return n_samples * stage->factor;
+}
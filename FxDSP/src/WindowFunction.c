@@ -810,6 +810,7 @@ WindowFunctionInit(unsigned n, Window_t type)
             break;
         case POISSON:
             poisson(window->length, 8.69, window->window);
+            break;
             
         default:
             boxcar(window->length, window->window);
@@ -877,6 +878,7 @@ WindowFunctionInitD(unsigned n, Window_t type)
             break;
         case POISSON:
             poissonD(window->length, 8.69, window->window);
+            break;
             
         default:
             boxcarD(window->length, window->window);
@@ -0,0 +1,192 @@
+//
+//  TestAsyncResampler.cpp
+//  FxDSP
+//
+//  Copyright (c) 2015 Hamilton Kibbe. All rights reserved.
+//
+
+#include "AsyncResampler.h"
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <gtest/gtest.h>
+
+
+// Bridge a 1 kHz tone between two clocks for a number of seconds. The input
+// clock runs ppm fast. Returns the largest step between output samples once
+// the output has started, which is bounded by the tone's slope if nothing was
+// dropped or repeated
+template <typename T, typename R>
+static double
+bridge(R* resampler,
+       Error_t (*write)(R*, const T*, unsigned),
+       Error_t (*read)(R*, T*, unsigned),
+       double in_rate, double out_rate, double ppm,
+       unsigned write_block, unsigned read_block, double seconds)
+{
+    const double in_clock = in_rate * (1.0 + ppm * 1e-6);
+    T in[1024];
+    T out[1024];
+    unsigned long written = 0;
+    double write_time = 0.0;
+    double read_time = 0.0;
+    double last = 0.0;
+    double jump = 0.0;
+    while (read_time < seconds)
+    {
+        if (write_time <= read_time)
+        {
+            for (unsigned i = 0; i < write_block; ++i)
+            {
+                in[i] = sin(2.0 * M_PI * 1000.0 / in_clock * (written + i));
+            }
+            EXPECT_EQ(NOERR, write(resampler, in, write_block));
+            written += write_block;
+            write_time += write_block / in_clock;
+        }
+        else
+        {
+            EXPECT_EQ(NOERR, read(resampler, out, read_block));
+            for (unsigned i = 0; i < read_block; ++i)
+            {
+                if (read_time > 1.0)
+                {
+                    jump = fmax(jump, fabs(out[i] - last));
+                }
+                last = out[i];
+            }
+            read_time += read_block / out_rate;
+        }
+    }
+    return jump;
+}
+
+
+TEST(AsyncResamplerSingle, TestAsyncResampler)
+{
+    // The input clock is 500 ppm fast, so an extra block arrives every 11
+    // seconds. The servo absorbs them without over or underrunning
+    AsyncResampler* rs = AsyncResamplerInit(48000, 48000, 256, RESAMPLER_LOW);
+    const double jump = bridge(rs, AsyncResamplerWrite, AsyncResamplerRead,
+                               48000, 48000, 500.0, 256, 256, 30.0);
+    ASSERT_LT(jump, 1.01 * 2.0 * M_PI * 1000.0 / 48000);
+    ASSERT_NEAR(1.0 / (1.0 + 500e-6), AsyncResamplerRatio(rs), 0.001);
+    AsyncResamplerFree(rs);
+
+    /* Test invalid argument handling */
+    ASSERT_EQ((void*)NULL, (void*)AsyncResamplerInit(48000, 48000, 0, RESAMPLER_LOW));
+}
+
+TEST(AsyncResamplerSingle, TestAsyncResamplerStartup)
+{
+    float in[64];
+    float out[64];
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        in[i] = 1.0;
+    }
+
+    // Silent until the queue fills, then the queue can overflow
+    AsyncResampler* rs = AsyncResamplerInit(48000, 48000, 64, RESAMPLER_LOW);
+    ASSERT_EQ(NOERR, AsyncResamplerRead(rs, out, 64));
+    ASSERT_EQ(0.0, out[63]);
+    Error_t err = NOERR;
+    for (unsigned i = 0; i < 16 && err == NOERR; ++i)
+    {
+        err = AsyncResamplerWrite(rs, in, 64);
+    }
+    ASSERT_EQ(VALUE_ERROR, err);
+
+    // Reading more than is written runs it dry
+    for (unsigned i = 0; i < 16 && err != NOERR; ++i)
+    {
+        err = AsyncResamplerRead(rs, out, 64);
+    }
+    for (unsigned i = 0; i < 16 && err == NOERR; ++i)
+    {
+        err = AsyncResamplerRead(rs, out, 64);
+    }
+    ASSERT_EQ(VALUE_ERROR, err);
+    ASSERT_EQ(0.0, out[63]);
+    AsyncResamplerFree(rs);
+}
+
+// Writes a 1 kHz tone from its own thread, staying at most three blocks ahead
+// of the reader so the queue neither overflows nor runs dry
+typedef struct
+{
+    AsyncResampler* resampler;
+    unsigned        blocks;
+    unsigned        written;
+    unsigned        read;
+} Producer;
+
+static void*
+produce(void* arg)
+{
+    Producer* producer = (Producer*)arg;
+    struct timespec pause = {0, 20000};
+    float in[256];
+    for (unsigned b = 0; b < producer->blocks; ++b)
+    {
+        while (b - __atomic_load_n(&producer->read, __ATOMIC_ACQUIRE) >= 3)
+        {
+            nanosleep(&pause, NULL);
+        }
+        for (unsigned i = 0; i < 256; ++i)
+        {
+            in[i] = sin(2.0 * M_PI * 1000.0 / 48000.0 * (b * 256 + i));
+        }
+        EXPECT_EQ(NOERR, AsyncResamplerWrite(producer->resampler, in, 256));
+        __atomic_store_n(&producer->written, b + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+TEST(AsyncResamplerSingle, TestAsyncResamplerThreaded)
+{
+    // Write and read from different threads. Nothing may be dropped or
+    // repeated on the way through the queue
+    AsyncResampler* rs = AsyncResamplerInit(48000, 48000, 256, RESAMPLER_LOW);
+    Producer producer = {rs, 600, 0, 0};
+    struct timespec pause = {0, 20000};
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, produce, &producer));
+
+    float out[256];
+    double last = 0.0;
+    double jump = 0.0;
+    for (unsigned r = 0; r + 3 <= producer.blocks; ++r)
+    {
+        while (__atomic_load_n(&producer.written, __ATOMIC_ACQUIRE) - r < 3)
+        {
+            nanosleep(&pause, NULL);
+        }
+        EXPECT_EQ(NOERR, AsyncResamplerRead(rs, out, 256));
+        for (unsigned i = 0; i < 256; ++i)
+        {
+            if (r > 4)
+            {
+                jump = fmax(jump, fabs(out[i] - last));
+            }
+            last = out[i];
+        }
+        __atomic_store_n(&producer.read, r + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&producer.read, producer.blocks, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+    AsyncResamplerFree(rs);
+    ASSERT_LT(jump, 1.01 * 2.0 * M_PI * 1000.0 / 48000);
+}
+
+
+TEST(AsyncResamplerDouble, TestAsyncResampler)
+{
+    // Mismatched block sizes and a slow input clock
+    AsyncResamplerD* rs = AsyncResamplerInitD(44100, 48000, 512, RESAMPLER_MEDIUM);
+    const double jump = bridge(rs, AsyncResamplerWriteD, AsyncResamplerReadD,
+                               44100, 48000, -200.0, 441, 512, 20.0);
+    ASSERT_LT(jump, 1.01 * 2.0 * M_PI * 1000.0 / 48000);
+    ASSERT_NEAR(48000.0 / 44100.0 / (1.0 - 200e-6), AsyncResamplerRatioD(rs), 0.001);
+    AsyncResamplerFreeD(rs);
+}
@@ -0,0 +1,139 @@
+//
+//  TestBiquadCascade.cpp
+//  FxDSP
+//
+//  Copyright (c) 2015 Hamilton Kibbe. All rights reserved.
+//
+
+#include "BiquadCascade.h"
+#include "BiquadFilter.h"
+#include <math.h>
+#include <string.h>
+#include <gtest/gtest.h>
+
+
+// A stable section with poles at radius r and angle theta, different for
+// every channel and section
+template <typename T>
+static void
+section_coeffs(T* b, T* a, unsigned channel, unsigned section)
+{
+    const T r = 0.5 + 0.04 * ((channel + 3 * section) % 11);
+    const T theta = 0.1 + 0.13 * ((2 * channel + section) % 17);
+    a[0] = -2.0 * r * cos(theta);
+    a[1] = r * r;
+    b[0] = 0.3 + 0.05 * section;
+    b[1] = 0.2 - 0.03 * channel;
+    b[2] = 0.1;
+}
+
+
+TEST(BiquadCascadeSingle, TestAgainstBiquadFilter)
+{
+    // 13 channels leave part of the second group empty
+    const unsigned channels = 13;
+    const unsigned sections = 3;
+    const unsigned length = 500;
+    float input[channels * length];
+    float expected[channels * length];
+    float block[channels * 262];
+    float b[3];
+    float a[2];
+
+    for (unsigned i = 0; i < channels * length; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+
+    // Filter each channel with a chain of BiquadFilters
+    BiquadCascade* cascade = BiquadCascadeInit(sections, channels);
+    ASSERT_TRUE(cascade != NULL);
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        memcpy(expected + ch * length, input + ch * length, length * sizeof(float));
+        for (unsigned s = 0; s < sections; ++s)
+        {
+            section_coeffs<float>(b, a, ch, s);
+            ASSERT_EQ(NOERR, BiquadCascadeUpdateKernel(cascade, ch, s, b, a));
+            BiquadFilter* filter = BiquadFilterInit(b, a);
+            BiquadFilterProcess(filter, expected + ch * length, expected + ch * length, length);
+            BiquadFilterFree(filter);
+        }
+    }
+
+    // Odd blocks, and blocks longer than the cascade runs at a time, in place
+    const unsigned blocks[4] = {1, 37, 200, 262};
+    unsigned pos = 0;
+    for (unsigned k = 0; k < 4; ++k)
+    {
+        const unsigned count = blocks[k];
+        for (unsigned ch = 0; ch < channels; ++ch)
+        {
+            memcpy(block + ch * count, input + ch * length + pos, count * sizeof(float));
+        }
+        ASSERT_EQ(NOERR, BiquadCascadeProcess(cascade, block, block, count));
+        for (unsigned ch = 0; ch < channels; ++ch)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                ASSERT_NEAR(expected[ch * length + pos + i], block[ch * count + i], 1e-5);
+            }
+        }
+        pos += count;
+    }
+    BiquadCascadeFree(cascade);
+
+    /* Test invalid argument handling */
+    cascade = BiquadCascadeInit(0, channels);
+    ASSERT_EQ((void*)NULL, (void*)cascade);
+}
+
+
+TEST(BiquadCascadeDouble, TestAgainstBiquadFilter)
+{
+    const unsigned channels = 6;
+    const unsigned sections = 4;
+    const unsigned length = 300;
+    double input[channels * length];
+    double expected[channels * length];
+    double output[channels * length];
+    double b[3];
+    double a[2];
+
+    for (unsigned i = 0; i < channels * length; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+
+    BiquadCascadeD* cascade = BiquadCascadeInitD(sections, channels);
+    ASSERT_TRUE(cascade != NULL);
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        memcpy(expected + ch * length, input + ch * length, length * sizeof(double));
+        for (unsigned s = 0; s < sections; ++s)
+        {
+            section_coeffs<double>(b, a, ch, s);
+            ASSERT_EQ(NOERR, BiquadCascadeUpdateKernelD(cascade, ch, s, b, a));
+            BiquadFilterD* filter = BiquadFilterInitD(b, a);
+            BiquadFilterProcessD(filter, expected + ch * length, expected + ch * length, length);
+            BiquadFilterFreeD(filter);
+        }
+    }
+
+    // Flushing clears the state left by the first pass
+    BiquadCascadeProcessD(cascade, output, input, length);
+    BiquadCascadeFlushD(cascade);
+    BiquadCascadeProcessD(cascade, output, input, length);
+    BiquadCascadeFreeD(cascade);
+
+    for (unsigned i = 0; i < channels * length; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 1e-12);
+    }
+
+    /* Test invalid argument handling */
+    cascade = BiquadCascadeInitD(sections, channels);
+    ASSERT_EQ(VALUE_ERROR, BiquadCascadeUpdateKernelD(cascade, channels, 0, b, a));
+    ASSERT_EQ(VALUE_ERROR, BiquadCascadeUpdateKernelD(cascade, 0, sections, b, a));
+    BiquadCascadeFreeD(cascade);
+}
@@ -80,6 +80,44 @@ TEST(BiquadFilterSingle, TestOverlaps)
 
 }
 
+
+TEST(BiquadFilterSingle, TestBlockMode)
+{
+    // A resonant lowpass at 1kHz, filtered in odd blocks in place after a
+    // switch of modes mid-stream, matches the serial recursion
+    const float bl[3] = {0.0047, 0.0094, 0.0047};
+    const float al[2] = {-1.9157, 0.9345};
+    float in[1000];
+    float expected[1000];
+    float out[1000];
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        in[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    BiquadFilter *filter = BiquadFilterInit(bl, al);
+    BiquadFilterProcess(filter, expected, in, 1000);
+    BiquadFilterFlush(filter);
+
+    CopyBuffer(out, in, 1000);
+    BiquadFilterProcess(filter, out, out, 5);
+    ASSERT_EQ(NOERR, BiquadFilterSetMode(filter, IIR_BLOCK));
+    const unsigned blocks[5] = {1, 37, 200, 3, 754};
+    unsigned pos = 5;
+    for (unsigned k = 0; k < 5; ++k)
+    {
+        BiquadFilterProcess(filter, out + pos, out + pos, blocks[k]);
+        pos += blocks[k];
+    }
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-5);
+    }
+
+    /* Test invalid argument handling */
+    ASSERT_EQ(VALUE_ERROR, BiquadFilterSetMode(filter, (IIRMode_t)10000));
+    BiquadFilterFree(filter);
+}
+
 TEST(BiquadFilterDouble, TestResultsAgainstMatlab)
 {
     // Set up
@@ -146,4 +184,38 @@ TEST(BiquadFilterDouble, TestOverlaps)
         ASSERT_NEAR(output[i], MatlabOutputD[i], 0.00001);
     }
     
-}
\ No newline at end of file
+}
+
+
+TEST(BiquadFilterDouble, TestBlockMode)
+{
+    // The block form picks up where the serial recursion leaves off, and the
+    // other way round
+    const double bl[3] = {0.0047, 0.0094, 0.0047};
+    const double al[2] = {-1.9157, 0.9345};
+    double in[1000];
+    double expected[1000];
+    double out[1000];
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        in[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    BiquadFilterD *filter = BiquadFilterInitD(bl, al);
+    BiquadFilterProcessD(filter, expected, in, 1000);
+    BiquadFilterFlushD(filter);
+
+    BiquadFilterProcessD(filter, out, in, 101);
+    ASSERT_EQ(NOERR, BiquadFilterSetModeD(filter, IIR_BLOCK));
+    BiquadFilterProcessD(filter, out + 101, in + 101, 400);
+    ASSERT_EQ(NOERR, BiquadFilterSetModeD(filter, IIR_SERIAL));
+    out[501] = BiquadFilterTickD(filter, in[501]);
+    BiquadFilterProcessD(filter, out + 502, in + 502, 498);
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-12);
+    }
+
+    /* Test invalid argument handling */
+    ASSERT_EQ(VALUE_ERROR, BiquadFilterSetModeD(filter, N_IIR_MODES));
+    BiquadFilterFreeD(filter);
+}
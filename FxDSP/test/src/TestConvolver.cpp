@@ -0,0 +1,442 @@
+//
+//  TestConvolver.cpp
+//  FxDSP
+//
+//  Copyright (c) 2015 Hamilton Kibbe. All rights reserved.
+//
+
+#include "Convolver.h"
+#include "Dsp.h"
+#include "FIRFilter.h"
+#include <math.h>
+#include <time.h>
+#include <gtest/gtest.h>
+
+
+// The worker is held back by a hook that waits while the gate is closed, so
+// the tests decide exactly when it falls behind
+static int worker_gate = 1;
+
+static void
+hold_worker(void*, unsigned)
+{
+    struct timespec pause = {0, 50000};
+    while (!__atomic_load_n(&worker_gate, __ATOMIC_ACQUIRE))
+    {
+        nanosleep(&pause, NULL);
+    }
+}
+
+static void
+set_worker_gate(int open)
+{
+    __atomic_store_n(&worker_gate, open, __ATOMIC_RELEASE);
+}
+
+
+TEST(ConvolverSingle, TestAgainstDirect)
+{
+    float kernel[3000];
+    float input[8192];
+    float expected[8192];
+    float output[8192];
+    
+    for (unsigned i = 0; i < 3000; ++i)
+    {
+        kernel[i] = 0.1 * exp(-0.002 * i) * sin(0.3 * i);
+    }
+    for (unsigned i = 0; i < 8192; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    
+    FIRFilter* direct = FIRFilterInit(kernel, 3000, DIRECT);
+    FIRFilterProcess(direct, expected, input, 8192);
+    FIRFilterFree(direct);
+    
+    // Process in blocks that line up with the partitions
+    Convolver* convolver = ConvolverInit(kernel, 3000, 32);
+    ASSERT_TRUE(convolver != NULL);
+    for (unsigned pos = 0; pos < 8192; pos += 32)
+    {
+        ConvolverProcess(convolver, output + pos, input + pos, 32);
+    }
+    
+    // No latency
+    for (unsigned i = 0; i < 8192; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.0001);
+    }
+    
+    // Process again in blocks that don't
+    ConvolverFlush(convolver);
+    for (unsigned pos = 0; pos < 8192; pos += 45)
+    {
+        unsigned count = (8192 - pos < 45) ? 8192 - pos : 45;
+        ConvolverProcess(convolver, output + pos, input + pos, count);
+    }
+    ConvolverFree(convolver);
+    
+    for (unsigned i = 0; i < 8192; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.0001);
+    }
+}
+
+TEST(ConvolverSingle, TestShortKernel)
+{
+    float kernel[20];
+    float input[256];
+    float expected[256];
+    float output[256];
+    
+    for (unsigned i = 0; i < 20; ++i)
+    {
+        kernel[i] = 1.0 / (i + 1);
+    }
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        input[i] = sin(0.05 * i);
+    }
+    
+    FIRFilter* direct = FIRFilterInit(kernel, 20, DIRECT);
+    FIRFilterProcess(direct, expected, input, 256);
+    FIRFilterFree(direct);
+    
+    // A kernel shorter than the block only needs the direct-form head
+    Convolver* convolver = ConvolverInit(kernel, 20, 64);
+    ConvolverProcess(convolver, output, input, 256);
+    ConvolverFree(convolver);
+    
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.0001);
+    }
+}
+
+TEST(ConvolverSingle, TestThreadedAgainstDirect)
+{
+    float kernel[6000];
+    float input[16384];
+    float expected[16384];
+    float output[16384];
+    struct timespec pause = {0, 667000};
+    
+    for (unsigned i = 0; i < 6000; ++i)
+    {
+        kernel[i] = 0.1 * exp(-0.001 * i) * sin(0.3 * i);
+    }
+    for (unsigned i = 0; i < 16384; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    
+    FIRFilter* direct = FIRFilterInit(kernel, 6000, DIRECT);
+    FIRFilterProcess(direct, expected, input, 16384);
+    FIRFilterFree(direct);
+    
+    // Late segments run on the worker. Leave it time to run between blocks,
+    // as a host running in real time at 48kHz would, so it keeps up and the
+    // output has to match
+    Convolver* convolver = ConvolverInitThreaded(kernel, 6000, 32);
+    ASSERT_TRUE(convolver != NULL);
+    for (unsigned pos = 0; pos < 16384; pos += 32)
+    {
+        ConvolverProcess(convolver, output + pos, input + pos, 32);
+        nanosleep(&pause, NULL);
+    }
+    for (unsigned i = 0; i < 16384; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.0001);
+    }
+    
+    // Flush with jobs in flight, then run again
+    ConvolverFlush(convolver);
+    for (unsigned pos = 0; pos < 16384; pos += 45)
+    {
+        unsigned count = (16384 - pos < 45) ? 16384 - pos : 45;
+        ConvolverProcess(convolver, output + pos, input + pos, count);
+        nanosleep(&pause, NULL);
+    }
+    ConvolverFree(convolver);
+    
+    for (unsigned i = 0; i < 16384; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.0001);
+    }
+}
+
+
+TEST(ConvolverSingle, TestThreadedLateWorker)
+{
+    static float kernel[20000];
+    static float input[81920];
+    static float expected[81920];
+    static float output[81920];
+    struct timespec pause = {0, 667000};
+    
+    for (unsigned i = 0; i < 20000; ++i)
+    {
+        kernel[i] = 0.1 * exp(-0.0003 * i) * sin(0.3 * i);
+    }
+    
+    // With the worker held for the whole run, the output is the part of the
+    // kernel computed on the audio thread and then silence. Processing must
+    // carry on without it
+    Convolver* convolver = ConvolverInitThreaded(kernel, 20000, 32);
+    ASSERT_TRUE(convolver != NULL);
+    ConvolverSetWorkerHook(convolver, hold_worker, NULL);
+    set_worker_gate(0);
+    ClearBuffer(input, 81920);
+    input[0] = 1.0;
+    for (unsigned pos = 0; pos < 81920; pos += 32)
+    {
+        ConvolverProcess(convolver, output + pos, input + pos, 32);
+    }
+    
+    unsigned computed = 0;
+    while (computed < 20000 && fabs(output[computed] - kernel[computed]) < 0.0001)
+    {
+        ++computed;
+    }
+    ASSERT_GT(computed, 32u);
+    ASSERT_LT(computed, 20000u);
+    for (unsigned i = computed; i < 81920; ++i)
+    {
+        ASSERT_NEAR(0.0, output[i], 0.0001);
+    }
+    
+    // Hold the worker again part way through a run, pacing the blocks in real
+    // time at 48kHz. Once it is back the output must match within a kernel
+    // length and a partition
+    for (unsigned i = 0; i < 81920; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    FIRFilter* direct = FIRFilterInit(kernel, 20000, DIRECT);
+    FIRFilterProcess(direct, expected, input, 81920);
+    FIRFilterFree(direct);
+    
+    set_worker_gate(1);
+    ConvolverFlush(convolver);
+    for (unsigned pos = 0; pos < 81920; pos += 32)
+    {
+        set_worker_gate(pos < 8192 || pos >= 16384);
+        ConvolverProcess(convolver, output + pos, input + pos, 32);
+        nanosleep(&pause, NULL);
+    }
+    ConvolverFree(convolver);
+    
+    for (unsigned i = 0; i < 81920; ++i)
+    {
+        ASSERT_TRUE(isfinite(output[i]));
+    }
+    for (unsigned i = 16384 + 20000 + 2 * CONVOLVER_MAX_PARTITION_LENGTH; i < 81920; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.0001);
+    }
+}
+
+
+TEST(ConvolverDouble, TestAgainstDirect)
+{
+    double kernel[3000];
+    double input[8192];
+    double expected[8192];
+    double output[8192];
+    
+    for (unsigned i = 0; i < 3000; ++i)
+    {
+        kernel[i] = 0.1 * exp(-0.002 * i) * sin(0.3 * i);
+    }
+    for (unsigned i = 0; i < 8192; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    
+    FIRFilterD* direct = FIRFilterInitD(kernel, 3000, DIRECT);
+    FIRFilterProcessD(direct, expected, input, 8192);
+    FIRFilterFreeD(direct);
+    
+    // Process in blocks that line up with the partitions
+    ConvolverD* convolver = ConvolverInitD(kernel, 3000, 32);
+    ASSERT_TRUE(convolver != NULL);
+    for (unsigned pos = 0; pos < 8192; pos += 32)
+    {
+        ConvolverProcessD(convolver, output + pos, input + pos, 32);
+    }
+    
+    // No latency
+    for (unsigned i = 0; i < 8192; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.000001);
+    }
+    
+    // Process again in blocks that don't
+    ConvolverFlushD(convolver);
+    for (unsigned pos = 0; pos < 8192; pos += 45)
+    {
+        unsigned count = (8192 - pos < 45) ? 8192 - pos : 45;
+        ConvolverProcessD(convolver, output + pos, input + pos, count);
+    }
+    ConvolverFreeD(convolver);
+    
+    for (unsigned i = 0; i < 8192; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.000001);
+    }
+}
+
+TEST(ConvolverDouble, TestShortKernel)
+{
+    double kernel[20];
+    double input[256];
+    double expected[256];
+    double output[256];
+    
+    for (unsigned i = 0; i < 20; ++i)
+    {
+        kernel[i] = 1.0 / (i + 1);
+    }
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        input[i] = sin(0.05 * i);
+    }
+    
+    FIRFilterD* direct = FIRFilterInitD(kernel, 20, DIRECT);
+    FIRFilterProcessD(direct, expected, input, 256);
+    FIRFilterFreeD(direct);
+    
+    // A kernel shorter than the block only needs the direct-form head
+    ConvolverD* convolver = ConvolverInitD(kernel, 20, 64);
+    ConvolverProcessD(convolver, output, input, 256);
+    ConvolverFreeD(convolver);
+    
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.000001);
+    }
+}
+
+TEST(ConvolverDouble, TestThreadedAgainstDirect)
+{
+    double kernel[6000];
+    double input[16384];
+    double expected[16384];
+    double output[16384];
+    struct timespec pause = {0, 667000};
+    
+    for (unsigned i = 0; i < 6000; ++i)
+    {
+        kernel[i] = 0.1 * exp(-0.001 * i) * sin(0.3 * i);
+    }
+    for (unsigned i = 0; i < 16384; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    
+    FIRFilterD* direct = FIRFilterInitD(kernel, 6000, DIRECT);
+    FIRFilterProcessD(direct, expected, input, 16384);
+    FIRFilterFreeD(direct);
+    
+    // Late segments run on the worker. Leave it time to run between blocks,
+    // as a host running in real time at 48kHz would, so it keeps up and the
+    // output has to match
+    ConvolverD* convolver = ConvolverInitThreadedD(kernel, 6000, 32);
+    ASSERT_TRUE(convolver != NULL);
+    for (unsigned pos = 0; pos < 16384; pos += 32)
+    {
+        ConvolverProcessD(convolver, output + pos, input + pos, 32);
+        nanosleep(&pause, NULL);
+    }
+    for (unsigned i = 0; i < 16384; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.000001);
+    }
+    
+    // Flush with jobs in flight, then run again
+    ConvolverFlushD(convolver);
+    for (unsigned pos = 0; pos < 16384; pos += 45)
+    {
+        unsigned count = (16384 - pos < 45) ? 16384 - pos : 45;
+        ConvolverProcessD(convolver, output + pos, input + pos, count);
+        nanosleep(&pause, NULL);
+    }
+    ConvolverFreeD(convolver);
+    
+    for (unsigned i = 0; i < 16384; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.000001);
+    }
+}
+
+
+TEST(ConvolverDouble, TestThreadedLateWorker)
+{
+    static double kernel[20000];
+    static double input[81920];
+    static double expected[81920];
+    static double output[81920];
+    struct timespec pause = {0, 667000};
+    
+    for (unsigned i = 0; i < 20000; ++i)
+    {
+        kernel[i] = 0.1 * exp(-0.0003 * i) * sin(0.3 * i);
+    }
+    
+    // With the worker held for the whole run, the output is the part of the
+    // kernel computed on the audio thread and then silence. Processing must
+    // carry on without it
+    ConvolverD* convolver = ConvolverInitThreadedD(kernel, 20000, 32);
+    ASSERT_TRUE(convolver != NULL);
+    ConvolverSetWorkerHookD(convolver, hold_worker, NULL);
+    set_worker_gate(0);
+    ClearBufferD(input, 81920);
+    input[0] = 1.0;
+    for (unsigned pos = 0; pos < 81920; pos += 32)
+    {
+        ConvolverProcessD(convolver, output + pos, input + pos, 32);
+    }
+    
+    unsigned computed = 0;
+    while (computed < 20000 && fabs(output[computed] - kernel[computed]) < 0.000001)
+    {
+        ++computed;
+    }
+    ASSERT_GT(computed, 32u);
+    ASSERT_LT(computed, 20000u);
+    for (unsigned i = computed; i < 81920; ++i)
+    {
+        ASSERT_NEAR(0.0, output[i], 0.000001);
+    }
+    
+    // Hold the worker again part way through a run, pacing the blocks in real
+    // time at 48kHz. Once it is back the output must match within a kernel
+    // length and a partition
+    for (unsigned i = 0; i < 81920; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    FIRFilterD* direct = FIRFilterInitD(kernel, 20000, DIRECT);
+    FIRFilterProcessD(direct, expected, input, 81920);
+    FIRFilterFreeD(direct);
+    
+    set_worker_gate(1);
+    ConvolverFlushD(convolver);
+    for (unsigned pos = 0; pos < 81920; pos += 32)
+    {
+        set_worker_gate(pos < 8192 || pos >= 16384);
+        ConvolverProcessD(convolver, output + pos, input + pos, 32);
+        nanosleep(&pause, NULL);
+    }
+    ConvolverFreeD(convolver);
+    
+    for (unsigned i = 0; i < 81920; ++i)
+    {
+        ASSERT_TRUE(isfinite(output[i]));
+    }
+    for (unsigned i = 16384 + 20000 + 2 * CONVOLVER_MAX_PARTITION_LENGTH; i < 81920; ++i)
+    {
+        ASSERT_NEAR(expected[i], output[i], 0.0001);
+    }
+}
@@ -174,6 +174,49 @@ TEST(DSPSingle, TestVectorSum)
     ASSERT_FLOAT_EQ(10.0, VectorSum(in, 5));
 }
 
+TEST(DSPSingle, TestVectorDotProduct)
+{
+    // Lengths that exercise the unrolled, single vector and scalar loops
+    float in1[100];
+    float in2[100];
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        in1[i] = i * 0.01;
+        in2[i] = (i % 2) ? -1.0 : 2.0;
+    }
+    for (unsigned length = 0; length <= 100; length += 7)
+    {
+        float expected = 0.0;
+        for (unsigned i = 0; i < length; ++i)
+        {
+            expected += in1[i] * in2[i];
+        }
+        ASSERT_NEAR(expected, VectorDotProduct(in1, in2, length), 1e-5);
+    }
+}
+
+TEST(DSPSingle, TestVectorInterpolatedDotProduct)
+{
+    float in[100];
+    float kernel0[100];
+    float kernel1[100];
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        in[i] = i * 0.01;
+        kernel0[i] = (i % 2) ? -1.0 : 2.0;
+        kernel1[i] = (i % 3) ? 0.5 : -3.0;
+    }
+    for (unsigned length = 0; length <= 100; length += 7)
+    {
+        float expected = 0.0;
+        for (unsigned i = 0; i < length; ++i)
+        {
+            expected += in[i] * (kernel0[i] + 0.3 * (kernel1[i] - kernel0[i]));
+        }
+        ASSERT_NEAR(expected, VectorInterpolatedDotProduct(in, kernel0, kernel1, 0.3, length), 1e-5);
+    }
+}
+
 TEST(DSPSingle, TestVectorVectorAdd)
 {
     float out[10];
@@ -262,6 +305,186 @@ TEST(DSPSingle, TestConvolve)
     }
 }
 
+TEST(DSPSingle, TestConvolveLong)
+{
+    // Lengths either side of the vector and block sizes
+    const unsigned lengths[4][2] = {{100, 64}, {7, 3}, {13, 40}, {257, 33}};
+    float in1[257];
+    float in2[64];
+    float out[320];
+
+    for (unsigned t = 0; t < 4; ++t)
+    {
+        const unsigned n1 = lengths[t][0];
+        const unsigned n2 = lengths[t][1];
+        for (unsigned i = 0; i < n1; ++i)
+        {
+            in1[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+        }
+        for (unsigned i = 0; i < n2; ++i)
+        {
+            in2[i] = ((i * 104729) % 97) / 97.0 - 0.5;
+        }
+
+        Convolve(in1, n1, in2, n2, out);
+        for (unsigned i = 0; i < n1 + n2 - 1; ++i)
+        {
+            double expected = 0.0;
+            for (unsigned k = 0; k < n1; ++k)
+            {
+                if (i >= k && i - k < n2)
+                {
+                    expected += (double)in1[k] * in2[i - k];
+                }
+            }
+            ASSERT_NEAR(expected, out[i], 0.0001);
+        }
+    }
+}
+
+TEST(DSPSingle, TestConvolveLargeInput)
+{
+    // An input far bigger than the stack, and a kernel too long for its edges
+    // to be padded in a chunk
+    const unsigned lengths[2][2] = {{1 << 22, 31}, {20000, 1201}};
+    float* in1 = (float*)malloc((1 << 22) * sizeof(float));
+    float* out = (float*)malloc(((1 << 22) + 30) * sizeof(float));
+    float in2[1201];
+    for (unsigned i = 0; i < (1 << 22); ++i)
+    {
+        in1[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+
+    for (unsigned t = 0; t < 2; ++t)
+    {
+        const unsigned n1 = lengths[t][0];
+        const unsigned n2 = lengths[t][1];
+        for (unsigned i = 0; i < n2 / 2; ++i)
+        {
+            in2[i] = ((i * 104729) % 97) / 97.0 - 0.5;
+            in2[n2 - 1 - i] = in2[i];
+        }
+        in2[n2 / 2] = 0.75;
+
+        for (unsigned s = 0; s < 2; ++s)
+        {
+            if (s == 0)
+            {
+                Convolve(in1, n1, in2, n2, out);
+            }
+            else
+            {
+                ConvolveSymmetric(in1, n1, in2, n2, SYMMETRIC, out);
+            }
+
+            // Both edges and a stretch of the middle
+            const unsigned starts[3] = {0, n1 / 2, n1 - n2};
+            for (unsigned c = 0; c < 3; ++c)
+            {
+                for (unsigned i = starts[c]; i < starts[c] + 2 * n2 - 1; ++i)
+                {
+                    double expected = 0.0;
+                    for (unsigned k = 0; k < n2; ++k)
+                    {
+                        if (i >= k && i - k < n1)
+                        {
+                            expected += (double)in2[k] * in1[i - k];
+                        }
+                    }
+                    ASSERT_NEAR(expected, out[i], 0.001);
+                }
+            }
+        }
+    }
+    free(in1);
+    free(out);
+}
+
+TEST(DSPSingle, TestConvolveSymmetric)
+{
+    // Odd and even lengths, either side of the vector and block sizes
+    const unsigned lengths[4][2] = {{100, 63}, {7, 4}, {13, 40}, {257, 33}};
+    float in1[257];
+    float in2[64];
+    float out[320];
+    float expected[320];
+
+    for (unsigned t = 0; t < 4; ++t)
+    {
+        const unsigned n1 = lengths[t][0];
+        const unsigned n2 = lengths[t][1];
+        for (unsigned i = 0; i < n1; ++i)
+        {
+            in1[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+        }
+
+        for (unsigned s = SYMMETRIC; s <= ANTISYMMETRIC; ++s)
+        {
+            const float sign = (s == SYMMETRIC) ? 1.0 : -1.0;
+            for (unsigned i = 0; i < n2 / 2; ++i)
+            {
+                in2[i] = ((i * 104729) % 97) / 97.0 - 0.5;
+                in2[n2 - 1 - i] = sign * in2[i];
+            }
+            if (n2 % 2)
+            {
+                in2[n2 / 2] = (s == SYMMETRIC) ? 0.75 : 0.0;
+            }
+            ASSERT_EQ((Symmetry_t)s, KernelSymmetry(in2, n2));
+
+            Convolve(in1, n1, in2, n2, expected);
+            ConvolveSymmetric(in1, n1, in2, n2, (Symmetry_t)s, out);
+            for (unsigned i = 0; i < n1 + n2 - 1; ++i)
+            {
+                ASSERT_NEAR(expected[i], out[i], 0.0001);
+            }
+        }
+
+        // Break the symmetry
+        in2[0] += 0.25;
+        ASSERT_EQ(ASYMMETRIC, KernelSymmetry(in2, n2));
+    }
+}
+
+TEST(DSPSingle, TestConvolvePolyphase)
+{
+    // Kernel counts that use pairs, a leftover kernel and every loop
+    const unsigned counts[4] = {1, 2, 3, 8};
+    const unsigned lengths[3] = {5, 40, 131};
+    float src[131 + 15];
+    float kernels[8 * 16];
+    float out[8 * 131];
+    for (unsigned i = 0; i < 131 + 15; ++i)
+    {
+        src[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    for (unsigned i = 0; i < 8 * 16; ++i)
+    {
+        kernels[i] = ((i * 104729) % 97) / 97.0 - 0.5;
+    }
+
+    for (unsigned c = 0; c < 4; ++c)
+    {
+        for (unsigned l = 0; l < 3; ++l)
+        {
+            const unsigned n = counts[c];
+            ConvolvePolyphase(src, lengths[l], kernels, 16, n, out);
+            for (unsigned i = 0; i < lengths[l]; ++i)
+            {
+                for (unsigned p = 0; p < n; ++p)
+                {
+                    double expected = 0.0;
+                    for (unsigned j = 0; j < 16; ++j)
+                    {
+                        expected += (double)kernels[p * 16 + j] * src[i + 15 - j];
+                    }
+                    ASSERT_NEAR(expected, out[i * n + p], 0.0001);
+                }
+            }
+        }
+    }
+}
+
 TEST(DSPSingle, TestDBConversion)
 {
     float out[5];
@@ -495,6 +718,49 @@ TEST(DSPDouble, TestVectorSum)
 }
 
 
+TEST(DSPDouble, TestVectorDotProduct)
+{
+    double in1[100];
+    double in2[100];
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        in1[i] = i * 0.01;
+        in2[i] = (i % 2) ? -1.0 : 2.0;
+    }
+    for (unsigned length = 0; length <= 100; length += 7)
+    {
+        double expected = 0.0;
+        for (unsigned i = 0; i < length; ++i)
+        {
+            expected += in1[i] * in2[i];
+        }
+        ASSERT_NEAR(expected, VectorDotProductD(in1, in2, length), 1e-12);
+    }
+}
+
+TEST(DSPDouble, TestVectorInterpolatedDotProduct)
+{
+    double in[100];
+    double kernel0[100];
+    double kernel1[100];
+    for (unsigned i = 0; i < 100; ++i)
+    {
+        in[i] = i * 0.01;
+        kernel0[i] = (i % 2) ? -1.0 : 2.0;
+        kernel1[i] = (i % 3) ? 0.5 : -3.0;
+    }
+    for (unsigned length = 0; length <= 100; length += 7)
+    {
+        double expected = 0.0;
+        for (unsigned i = 0; i < length; ++i)
+        {
+            expected += in[i] * (kernel0[i] + 0.3 * (kernel1[i] - kernel0[i]));
+        }
+        ASSERT_NEAR(expected, VectorInterpolatedDotProductD(in, kernel0, kernel1, 0.3, length), 1e-12);
+    }
+}
+
+
 TEST(DSPDouble, TestVectorVectorAdd)
 {
     double out[10];
@@ -581,6 +847,186 @@ TEST(DSPDouble, TestConvolve)
     }
 }
 
+TEST(DSPDouble, TestConvolveLong)
+{
+    // Lengths either side of the vector and block sizes
+    const unsigned lengths[4][2] = {{100, 64}, {7, 3}, {13, 40}, {257, 33}};
+    double in1[257];
+    double in2[64];
+    double out[320];
+
+    for (unsigned t = 0; t < 4; ++t)
+    {
+        const unsigned n1 = lengths[t][0];
+        const unsigned n2 = lengths[t][1];
+        for (unsigned i = 0; i < n1; ++i)
+        {
+            in1[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+        }
+        for (unsigned i = 0; i < n2; ++i)
+        {
+            in2[i] = ((i * 104729) % 97) / 97.0 - 0.5;
+        }
+
+        ConvolveD(in1, n1, in2, n2, out);
+        for (unsigned i = 0; i < n1 + n2 - 1; ++i)
+        {
+            double expected = 0.0;
+            for (unsigned k = 0; k < n1; ++k)
+            {
+                if (i >= k && i - k < n2)
+                {
+                    expected += (double)in1[k] * in2[i - k];
+                }
+            }
+            ASSERT_NEAR(expected, out[i], 0.0000001);
+        }
+    }
+}
+
+TEST(DSPDouble, TestConvolveLargeInput)
+{
+    // An input far bigger than the stack, and a kernel too long for its edges
+    // to be padded in a chunk
+    const unsigned lengths[2][2] = {{1 << 22, 31}, {20000, 1201}};
+    double* in1 = (double*)malloc((1 << 22) * sizeof(double));
+    double* out = (double*)malloc(((1 << 22) + 30) * sizeof(double));
+    double in2[1201];
+    for (unsigned i = 0; i < (1 << 22); ++i)
+    {
+        in1[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+
+    for (unsigned t = 0; t < 2; ++t)
+    {
+        const unsigned n1 = lengths[t][0];
+        const unsigned n2 = lengths[t][1];
+        for (unsigned i = 0; i < n2 / 2; ++i)
+        {
+            in2[i] = ((i * 104729) % 97) / 97.0 - 0.5;
+            in2[n2 - 1 - i] = in2[i];
+        }
+        in2[n2 / 2] = 0.75;
+
+        for (unsigned s = 0; s < 2; ++s)
+        {
+            if (s == 0)
+            {
+                ConvolveD(in1, n1, in2, n2, out);
+            }
+            else
+            {
+                ConvolveSymmetricD(in1, n1, in2, n2, SYMMETRIC, out);
+            }
+
+            // Both edges and a stretch of the middle
+            const unsigned starts[3] = {0, n1 / 2, n1 - n2};
+            for (unsigned c = 0; c < 3; ++c)
+            {
+                for (unsigned i = starts[c]; i < starts[c] + 2 * n2 - 1; ++i)
+                {
+                    double expected = 0.0;
+                    for (unsigned k = 0; k < n2; ++k)
+                    {
+                        if (i >= k && i - k < n1)
+                        {
+                            expected += (double)in2[k] * in1[i - k];
+                        }
+                    }
+                    ASSERT_NEAR(expected, out[i], 0.0000001);
+                }
+            }
+        }
+    }
+    free(in1);
+    free(out);
+}
+
+TEST(DSPDouble, TestConvolveSymmetric)
+{
+    // Odd and even lengths, either side of the vector and block sizes
+    const unsigned lengths[4][2] = {{100, 63}, {7, 4}, {13, 40}, {257, 33}};
+    double in1[257];
+    double in2[64];
+    double out[320];
+    double expected[320];
+
+    for (unsigned t = 0; t < 4; ++t)
+    {
+        const unsigned n1 = lengths[t][0];
+        const unsigned n2 = lengths[t][1];
+        for (unsigned i = 0; i < n1; ++i)
+        {
+            in1[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+        }
+
+        for (unsigned s = SYMMETRIC; s <= ANTISYMMETRIC; ++s)
+        {
+            const double sign = (s == SYMMETRIC) ? 1.0 : -1.0;
+            for (unsigned i = 0; i < n2 / 2; ++i)
+            {
+                in2[i] = ((i * 104729) % 97) / 97.0 - 0.5;
+                in2[n2 - 1 - i] = sign * in2[i];
+            }
+            if (n2 % 2)
+            {
+                in2[n2 / 2] = (s == SYMMETRIC) ? 0.75 : 0.0;
+            }
+            ASSERT_EQ((Symmetry_t)s, KernelSymmetryD(in2, n2));
+
+            ConvolveD(in1, n1, in2, n2, expected);
+            ConvolveSymmetricD(in1, n1, in2, n2, (Symmetry_t)s, out);
+            for (unsigned i = 0; i < n1 + n2 - 1; ++i)
+            {
+                ASSERT_NEAR(expected[i], out[i], 0.0000001);
+            }
+        }
+
+        // Break the symmetry
+        in2[0] += 0.25;
+        ASSERT_EQ(ASYMMETRIC, KernelSymmetryD(in2, n2));
+    }
+}
+
+TEST(DSPDouble, TestConvolvePolyphase)
+{
+    // Kernel counts that use pairs, a leftover kernel and every loop
+    const unsigned counts[4] = {1, 2, 3, 8};
+    const unsigned lengths[3] = {5, 40, 131};
+    double src[131 + 15];
+    double kernels[8 * 16];
+    double out[8 * 131];
+    for (unsigned i = 0; i < 131 + 15; ++i)
+    {
+        src[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    for (unsigned i = 0; i < 8 * 16; ++i)
+    {
+        kernels[i] = ((i * 104729) % 97) / 97.0 - 0.5;
+    }
+
+    for (unsigned c = 0; c < 4; ++c)
+    {
+        for (unsigned l = 0; l < 3; ++l)
+        {
+            const unsigned n = counts[c];
+            ConvolvePolyphaseD(src, lengths[l], kernels, 16, n, out);
+            for (unsigned i = 0; i < lengths[l]; ++i)
+            {
+                for (unsigned p = 0; p < n; ++p)
+                {
+                    double expected = 0.0;
+                    for (unsigned j = 0; j < 16; ++j)
+                    {
+                        expected += (double)kernels[p * 16 + j] * src[i + 15 - j];
+                    }
+                    ASSERT_NEAR(expected, out[i * n + p], 1e-12);
+                }
+            }
+        }
+    }
+}
+
 TEST(DSPDouble, TestDBConversion)
 {
     double out[5];
@@ -104,6 +104,145 @@ TEST(DecimatorSingle, TestDecimatorFlush)
 
 
 
+TEST(DecimatorSingle, TestDecimatorBlockSize)
+{
+    // Odd block sizes carry the phase across calls, so the output matches
+    // filtering with the prototype and keeping every 4th sample
+    float in[1000];
+    float expected[250];
+    float out[250];
+    float kernel[256];
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        in[i] = sinf(i * M_PI / 80.0) + 0.5 * sinf(i * 0.9);
+    }
+    for (unsigned p = 0; p < 4; ++p)
+    {
+        for (unsigned k = 0; k < 64; ++k)
+        {
+            kernel[k * 4 + p] = PolyphaseCoeffs[X4][p][k];
+        }
+    }
+    for (unsigned m = 0; m < 250; ++m)
+    {
+        expected[m] = 0.0;
+        for (unsigned j = 0; j < 256 && j <= m * 4; ++j)
+        {
+            expected[m] += kernel[j] * in[m * 4 - j];
+        }
+    }
+
+    Decimator* ds = DecimatorInit(X4);
+    const unsigned blocks[5] = {1, 37, 255, 3, 704};
+    unsigned read = 0;
+    float* write = out;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        DecimatorProcess(ds, write, in + read, blocks[b]);
+        write += (read + blocks[b] + 3) / 4 - (read + 3) / 4;
+        read += blocks[b];
+    }
+    DecimatorFree(ds);
+
+    for (unsigned i = 0; i < 250; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-5);
+    }
+}
+
+TEST(DecimatorSingle, TestDecimatorCascadeBlockSize)
+{
+    // Odd block sizes carry the phase across calls, so the output matches
+    // two 2x stages, each filtering with its prototype and keeping every 2nd
+    // sample
+    float in[1000];
+    float middle[500];
+    float expected[250];
+    float out[250];
+    float kernel0[256];
+    float kernel1[256];
+    const unsigned n_kernel0 = 2 * PolyphaseStageTaps(X4, 0);
+    const unsigned n_kernel1 = 2 * PolyphaseStageTaps(X4, 1);
+    ASSERT_EQ(NOERR, PolyphaseStageDesign(kernel0, X4, 0, 0));
+    ASSERT_EQ(NOERR, PolyphaseStageDesign(kernel1, X4, 1, 0));
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        in[i] = sinf(i * M_PI / 80.0) + 0.5 * sinf(i * 0.9);
+    }
+    for (unsigned m = 0; m < 500; ++m)
+    {
+        middle[m] = 0.0;
+        for (unsigned j = 0; j < n_kernel1 && j <= m * 2; ++j)
+        {
+            middle[m] += kernel1[j] * in[m * 2 - j];
+        }
+    }
+    for (unsigned m = 0; m < 250; ++m)
+    {
+        expected[m] = 0.0;
+        for (unsigned j = 0; j < n_kernel0 && j <= m * 2; ++j)
+        {
+            expected[m] += kernel0[j] * middle[m * 2 - j];
+        }
+    }
+
+    Decimator* ds = DecimatorInitMode(X4, RESAMPLE_FIR_CASCADE);
+    const unsigned blocks[5] = {1, 37, 255, 3, 704};
+    unsigned read = 0;
+    float* write = out;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        DecimatorProcess(ds, write, in + read, blocks[b]);
+        write += (read + blocks[b] + 3) / 4 - (read + 3) / 4;
+        read += blocks[b];
+    }
+    DecimatorFree(ds);
+
+    for (unsigned i = 0; i < 250; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-5);
+    }
+}
+
+
+TEST(DecimatorSingle, TestDecimatorIIRBlockSize)
+{
+    // Odd blocks, and blocks longer than the cascade runs at a time, give the
+    // same output as one long block
+    float in[1000];
+    float expected[125];
+    float out[125];
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        in[i] = sinf(i * M_PI / 80.0) + 0.5 * sinf(i * 0.9);
+    }
+
+    Decimator* ds = DecimatorInitMode(X8, RESAMPLE_IIR);
+    DecimatorProcess(ds, expected, in, 1000);
+    DecimatorFlush(ds);
+
+    const unsigned blocks[5] = {1, 37, 255, 3, 704};
+    unsigned read = 0;
+    float* write = out;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        DecimatorProcess(ds, write, in + read, blocks[b]);
+        write += (read + blocks[b]) / 8 - read / 8;
+        read += blocks[b];
+    }
+    DecimatorFree(ds);
+
+    for (unsigned i = 0; i < 125; ++i)
+    {
+        ASSERT_FLOAT_EQ(expected[i], out[i]);
+    }
+
+    /* Test invalid argument handling */
+    ds = DecimatorInitMode(X2, (ResampleMode_t)10000);
+    ASSERT_EQ((void*)ds, (void*)NULL);
+}
+
+
 TEST(DecimatorDouble, TestDecimator)
 {
     double in[800];
@@ -193,4 +332,109 @@ TEST(DecimatorDouble, TestDecimatorFlush)
     }
 }
 
+TEST(DecimatorDouble, TestDecimatorIIR)
+{
+    // A tone in the passband comes through at unity gain, and one that would
+    // alias onto it is rejected
+    double in[4000];
+    double out[1000];
+    for (unsigned i = 0; i < 4000; ++i)
+    {
+        in[i] = sin(i * M_PI / 40.0);
+    }
+
+    DecimatorD* ds = DecimatorInitModeD(X4, RESAMPLE_IIR);
+    DecimatorProcessD(ds, out, in, 4000);
+
+    // 25 whole periods
+    double power = 0.0;
+    for (unsigned i = 500; i < 1000; ++i)
+    {
+        power += out[i] * out[i];
+    }
+    ASSERT_NEAR(1.0, sqrt(power / 250.0), 1e-3);
+
+    for (unsigned i = 0; i < 4000; ++i)
+    {
+        in[i] = sin(i * M_PI * 0.45);
+    }
+    DecimatorFlushD(ds);
+    DecimatorProcessD(ds, out, in, 4000);
+    DecimatorFreeD(ds);
+
+    for (unsigned i = 500; i < 1000; ++i)
+    {
+        ASSERT_NEAR(0.0, out[i], 1e-4);
+    }
+}
+
+TEST(DecimatorDouble, TestDecimatorFactors)
+{
+    // Every factor passes a tone at unity gain
+    const ResampleFactor_t factors[3] = {X3, X6, X16};
+    double in[4800];
+    double out[300];
 
+    for (unsigned f = 0; f < 3; ++f)
+    {
+        const unsigned factor = ResampleFactorValue(factors[f]);
+        for (unsigned i = 0; i < 300 * factor; ++i)
+        {
+            in[i] = sin(i * M_PI / (20.0 * factor));
+        }
+        DecimatorD* ds = DecimatorInitD(factors[f]);
+        ASSERT_NE((void*)NULL, (void*)ds);
+        DecimatorProcessD(ds, out, in, 300 * factor);
+        DecimatorFreeD(ds);
+
+        // 5 whole periods, after the filters settle
+        double power = 0.0;
+        for (unsigned i = 50; i < 250; ++i)
+        {
+            power += out[i] * out[i];
+        }
+        ASSERT_NEAR(1.0, sqrt(power / 100.0), 1e-3);
+    }
+
+    /* The half-band cascade only supports powers of 2 */
+    DecimatorD* ds = DecimatorInitModeD(X3, RESAMPLE_IIR);
+    ASSERT_EQ((void*)ds, (void*)NULL);
+}
+
+TEST(DecimatorDouble, TestDecimatorMinimumPhase)
+{
+    // The minimum-phase filters pass a tone at unity gain, with a fraction of
+    // the delay of the linear-phase ones
+    double in[2400];
+    double out[300];
+    for (unsigned i = 0; i < 2400; ++i)
+    {
+        in[i] = (i == 0) ? 1.0 : 0.0;
+    }
+
+    DecimatorD* ds = DecimatorInitModeD(X8, RESAMPLE_FIR_MINIMUM_PHASE);
+    ASSERT_NE((void*)NULL, (void*)ds);
+    DecimatorProcessD(ds, out, in, 2400);
+    unsigned peak = 0;
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        peak = (fabs(out[i]) > fabs(out[peak])) ? i : peak;
+    }
+    ASSERT_GT(4, peak);
+
+    for (unsigned i = 0; i < 2400; ++i)
+    {
+        in[i] = sin(i * M_PI / 160.0);
+    }
+    DecimatorFlushD(ds);
+    DecimatorProcessD(ds, out, in, 2400);
+    DecimatorFreeD(ds);
+
+    // 5 whole periods
+    double power = 0.0;
+    for (unsigned i = 50; i < 250; ++i)
+    {
+        power += out[i] * out[i];
+    }
+    ASSERT_NEAR(1.0, sqrt(power / 100.0), 1e-3);
+}
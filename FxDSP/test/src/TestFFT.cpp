@@ -11,6 +11,7 @@
 #include "Dsp.h"
 #include <gtest/gtest.h>
 #include <cmath>
+#include <pthread.h>
 
 #define EPSILON (0.00001)
 
@@ -141,6 +142,285 @@ TEST(FFTSingle, TestFFTFilterConvolution)
 }
 
 
+TEST(FFTSingle, TestLongFFTConvolution)
+{
+    float in[300];
+    float in2[200];
+    float expected[499];
+    float output[512];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sinf(0.1 * i);
+    }
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        in2[i] = 1.0 / (i + 1.0);
+    }
+    Convolve(in, 300, in2, 200, expected);
+
+    FFTConfig* fft = FFTInit(512);
+    ASSERT_TRUE(fft);
+    if (fft)
+    {
+        FFTConvolve(fft, in, 300, in2, 200, output);
+        FFTFree(fft);
+        for (unsigned i = 0; i < 499; ++i)
+        {
+            ASSERT_NEAR(expected[i], output[i], 0.0001);
+        }
+    }
+}
+
+
+TEST(FFTSingle, TestSharedConfigs)
+{
+    float real[32];
+    float imag[32];
+    FFTConfig* first = FFTInit(64);
+    FFTConfig* second = FFTInit(64);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+
+    // Freeing one config must leave the shared tables intact for the other
+    FFTFree(first);
+    FFT_R2C(second, matlabInputVector, real, imag);
+    FFTFree(second);
+    for (unsigned i = 0; i < 32; ++i)
+    {
+        ASSERT_NEAR(matlabReal[i], real[i], 0.0001);
+        ASSERT_NEAR(matlabImag[i], imag[i], 0.0001);
+    }
+}
+
+
+// Create and free configs that share a plan, then check the shared plan
+static void*
+init_free_configs(void*)
+{
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        FFTConfig* fft = FFTInit(64);
+        FFTFree(fft);
+    }
+    return NULL;
+}
+
+
+TEST(FFTSingle, TestConcurrentInit)
+{
+    float real[32];
+    float imag[32];
+    FFTConfig* fft = FFTInit(64);
+    ASSERT_TRUE(fft);
+
+    pthread_t threads[4];
+    for (unsigned t = 0; t < 4; ++t)
+    {
+        ASSERT_EQ(0, pthread_create(&threads[t], NULL, init_free_configs, NULL));
+    }
+    for (unsigned t = 0; t < 4; ++t)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    FFT_R2C(fft, matlabInputVector, real, imag);
+    FFTFree(fft);
+    for (unsigned i = 0; i < 32; ++i)
+    {
+        ASSERT_NEAR(matlabReal[i], real[i], 0.0001);
+        ASSERT_NEAR(matlabImag[i], imag[i], 0.0001);
+    }
+}
+
+
+TEST(FFTSingle, TestInitWithEffort)
+{
+    float real[32];
+    float imag[32];
+    FFTConfig* fft = FFTInitWithEffort(64, FFT_PLAN_ESTIMATE);
+    ASSERT_TRUE(fft);
+    FFT_R2C(fft, matlabInputVector, real, imag);
+    FFTFree(fft);
+    for (unsigned i = 0; i < 32; ++i)
+    {
+        ASSERT_NEAR(matlabReal[i], real[i], 0.0001);
+        ASSERT_NEAR(matlabImag[i], imag[i], 0.0001);
+    }
+    ASSERT_EQ(NULL_PTR_ERROR, FFTImportWisdomFromFile(NULL));
+    ASSERT_EQ(NULL_PTR_ERROR, FFTImportWisdomFromString(NULL));
+    ASSERT_EQ(NULL_PTR_ERROR, FFTExportWisdomToFile(NULL));
+}
+
+TEST(FFTSingle, TestMixedRadixFFTConvolution)
+{
+    float in[300];
+    float in2[200];
+    float expected[499];
+    float output[512];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sinf(0.1 * i);
+    }
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        in2[i] = 1.0 / (i + 1.0);
+    }
+    Convolve(in, 300, in2, 200, expected);
+
+    unsigned length = FFTNextGoodLength(499);
+    ASSERT_GE(length, 499);
+    ASSERT_LE(length, 512);
+    FFTConfig* fft = FFTInit(length);
+    ASSERT_TRUE(fft);
+    if (fft)
+    {
+        FFTConvolve(fft, in, 300, in2, 200, output);
+        FFTFree(fft);
+        for (unsigned i = 0; i < 499; ++i)
+        {
+            ASSERT_NEAR(expected[i], output[i], 0.0001);
+        }
+    }
+}
+
+
+TEST(FFTSingle, TestNextGoodLength)
+{
+    // 480 with a mixed radix backend, 512 with a power of two only backend
+    unsigned length = FFTNextGoodLength(470);
+    ASSERT_TRUE(length == 480 || length == 512);
+    ASSERT_EQ(1024, FFTNextGoodLength(1024));
+
+    FFTConfig* fft = FFTInit(length);
+    ASSERT_TRUE(fft);
+    FFTFree(fft);
+}
+
+TEST(FFTSingle, TestBatchFFT)
+{
+    // 11 channels covers a full batch group and a partial one
+    const unsigned channels = 11;
+    float in[channels * 64];
+    float real[channels * 32];
+    float imag[channels * 32];
+    float out[channels * 64];
+    float expected_real[32];
+    float expected_imag[32];
+    float expected_out[64];
+    for (unsigned i = 0; i < channels * 64; ++i)
+    {
+        in[i] = sinf(0.05 * i * (1 + i / 64));
+    }
+
+    FFTConfig* fft = FFTInit(64);
+    ASSERT_TRUE(fft);
+    ASSERT_EQ(NOERR, FFTPrepareBatch(fft));
+    ASSERT_EQ(NOERR, FFT_R2C_Batch(fft, in, real, imag, channels));
+    ASSERT_EQ(NOERR, IFFT_C2R_Batch(fft, real, imag, out, channels));
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        FFT_R2C(fft, in + ch * 64, expected_real, expected_imag);
+        IFFT_C2R(fft, expected_real, expected_imag, expected_out);
+        for (unsigned i = 0; i < 32; ++i)
+        {
+            ASSERT_NEAR(expected_real[i], real[ch * 32 + i], 0.0001);
+            ASSERT_NEAR(expected_imag[i], imag[ch * 32 + i], 0.0001);
+        }
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            ASSERT_NEAR(expected_out[i], out[ch * 64 + i], 0.0001);
+        }
+    }
+    FFTFree(fft);
+}
+
+
+TEST(FFTSingle, TestBatchFFTConvolution)
+{
+    const unsigned channels = 11;
+    float in[channels * 40];
+    float kernel[64] = {0};
+    float kernel_buffer[64];
+    float out[channels * 64];
+    float out2[channels * 64];
+    float expected[79];
+    for (unsigned i = 0; i < channels * 40; ++i)
+    {
+        in[i] = sinf(0.1 * i);
+    }
+    for (unsigned i = 0; i < 24; ++i)
+    {
+        kernel[i] = 1.0 / (i + 1.0);
+    }
+
+    FFTConfig* fft = FFTInit(64);
+    ASSERT_TRUE(fft);
+    ASSERT_EQ(NOERR, FFTPrepareBatch(fft));
+    FFTSplitComplex fft_kernel = {kernel_buffer, kernel_buffer + 32};
+    FFT_IR_R2C(fft, kernel, fft_kernel);
+    ASSERT_EQ(NOERR, FFTFilterConvolveBatch(fft, in, 40, fft_kernel, out, channels));
+
+    // Pair every channel with the same kernel
+    float kernels[channels * 24];
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        CopyBuffer(kernels + ch * 24, kernel, 24);
+    }
+    ASSERT_EQ(NOERR, FFTConvolveBatch(fft, in, 40, kernels, 24, out2, channels));
+    FFTFree(fft);
+
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        Convolve(in + ch * 40, 40, kernel, 24, expected);
+        for (unsigned i = 0; i < 63; ++i)
+        {
+            ASSERT_NEAR(expected[i], out[ch * 64 + i], 0.0001);
+            ASSERT_NEAR(expected[i], out2[ch * 64 + i], 0.0001);
+        }
+    }
+}
+
+TEST(FFTSingle, TestComplexFFT)
+{
+    float in_real[64];
+    float in_imag[64];
+    float out_real[64];
+    float out_imag[64];
+    float inverse_real[64];
+    float inverse_imag[64];
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        in_real[i] = sinf(0.3 * i);
+        in_imag[i] = cosf(0.7 * i) / (i + 1.0);
+    }
+
+    FFTConfig* fft = FFTInit(64);
+    ASSERT_TRUE(fft);
+    ASSERT_EQ(NOERR, FFT_C2C(fft, in_real, in_imag, out_real, out_imag));
+    ASSERT_EQ(NOERR, IFFT_C2C(fft, out_real, out_imag, inverse_real, inverse_imag));
+    FFTFree(fft);
+
+    // Compare against the DFT
+    for (unsigned k = 0; k < 64; ++k)
+    {
+        double re = 0.0;
+        double im = 0.0;
+        for (unsigned n = 0; n < 64; ++n)
+        {
+            double phase = -2.0 * M_PI * k * n / 64.0;
+            re += in_real[n] * cos(phase) - in_imag[n] * sin(phase);
+            im += in_real[n] * sin(phase) + in_imag[n] * cos(phase);
+        }
+        ASSERT_NEAR(re, out_real[k], 0.0001);
+        ASSERT_NEAR(im, out_imag[k], 0.0001);
+    }
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        ASSERT_NEAR(in_real[i], inverse_real[i], EPSILON);
+        ASSERT_NEAR(in_imag[i], inverse_imag[i], EPSILON);
+    }
+}
+
 #pragma mark - Double Precision Tests
 
 TEST(FFTDouble, TestFFT)
@@ -265,3 +545,230 @@ TEST(FFTDouble, TestFFTFilterConvolution)
 }
 
 
+TEST(FFTDouble, TestLongFFTConvolution)
+{
+    double in[300];
+    double in2[200];
+    double expected[499];
+    double output[512];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sin(0.1 * i);
+    }
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        in2[i] = 1.0 / (i + 1.0);
+    }
+    ConvolveD(in, 300, in2, 200, expected);
+
+    FFTConfigD* fft = FFTInitD(512);
+    ASSERT_TRUE(fft);
+    if (fft)
+    {
+        FFTConvolveD(fft, in, 300, in2, 200, output);
+        FFTFreeD(fft);
+        for (unsigned i = 0; i < 499; ++i)
+        {
+            ASSERT_NEAR(expected[i], output[i], EPSILON);
+        }
+    }
+}
+
+
+TEST(FFTDouble, TestSharedConfigs)
+{
+    double real[32];
+    double imag[32];
+    FFTConfigD* first = FFTInitD(64);
+    FFTConfigD* second = FFTInitD(64);
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+
+    FFTFreeD(first);
+    FFT_R2CD(second, matlabInputVectorD, real, imag);
+    FFTFreeD(second);
+    for (unsigned i = 0; i < 32; ++i)
+    {
+        ASSERT_NEAR(matlabRealD[i], real[i], 0.0001);
+        ASSERT_NEAR(matlabImagD[i], imag[i], 0.0001);
+    }
+}
+
+
+TEST(FFTDouble, TestInitWithEffort)
+{
+    double real[32];
+    double imag[32];
+    FFTConfigD* fft = FFTInitWithEffortD(64, FFT_PLAN_ESTIMATE);
+    ASSERT_TRUE(fft);
+    FFT_R2CD(fft, matlabInputVectorD, real, imag);
+    FFTFreeD(fft);
+    for (unsigned i = 0; i < 32; ++i)
+    {
+        ASSERT_NEAR(matlabRealD[i], real[i], 0.0001);
+        ASSERT_NEAR(matlabImagD[i], imag[i], 0.0001);
+    }
+    ASSERT_EQ(NULL_PTR_ERROR, FFTImportWisdomFromFileD(NULL));
+    ASSERT_EQ(NULL_PTR_ERROR, FFTImportWisdomFromStringD(NULL));
+    ASSERT_EQ(NULL_PTR_ERROR, FFTExportWisdomToFileD(NULL));
+}
+
+
+TEST(FFTDouble, TestMixedRadixFFTConvolution)
+{
+    double in[300];
+    double in2[200];
+    double expected[499];
+    double output[512];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sin(0.1 * i);
+    }
+    for (unsigned i = 0; i < 200; ++i)
+    {
+        in2[i] = 1.0 / (i + 1.0);
+    }
+    ConvolveD(in, 300, in2, 200, expected);
+
+    unsigned length = FFTNextGoodLength(499);
+    ASSERT_GE(length, 499);
+    ASSERT_LE(length, 512);
+    FFTConfigD* fft = FFTInitD(length);
+    ASSERT_TRUE(fft);
+    if (fft)
+    {
+        FFTConvolveD(fft, in, 300, in2, 200, output);
+        FFTFreeD(fft);
+        for (unsigned i = 0; i < 499; ++i)
+        {
+            ASSERT_NEAR(expected[i], output[i], 0.0001);
+        }
+    }
+}
+
+
+TEST(FFTDouble, TestBatchFFT)
+{
+    // 11 channels covers a full batch group and a partial one
+    const unsigned channels = 11;
+    double in[channels * 64];
+    double real[channels * 32];
+    double imag[channels * 32];
+    double out[channels * 64];
+    double expected_real[32];
+    double expected_imag[32];
+    double expected_out[64];
+    for (unsigned i = 0; i < channels * 64; ++i)
+    {
+        in[i] = sin(0.05 * i * (1 + i / 64));
+    }
+
+    FFTConfigD* fft = FFTInitD(64);
+    ASSERT_TRUE(fft);
+    ASSERT_EQ(NOERR, FFTPrepareBatchD(fft));
+    ASSERT_EQ(NOERR, FFT_R2C_BatchD(fft, in, real, imag, channels));
+    ASSERT_EQ(NOERR, IFFT_C2R_BatchD(fft, real, imag, out, channels));
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        FFT_R2CD(fft, in + ch * 64, expected_real, expected_imag);
+        IFFT_C2RD(fft, expected_real, expected_imag, expected_out);
+        for (unsigned i = 0; i < 32; ++i)
+        {
+            ASSERT_NEAR(expected_real[i], real[ch * 32 + i], 0.0001);
+            ASSERT_NEAR(expected_imag[i], imag[ch * 32 + i], 0.0001);
+        }
+        for (unsigned i = 0; i < 64; ++i)
+        {
+            ASSERT_NEAR(expected_out[i], out[ch * 64 + i], 0.0001);
+        }
+    }
+    FFTFreeD(fft);
+}
+
+
+TEST(FFTDouble, TestBatchFFTConvolution)
+{
+    const unsigned channels = 11;
+    double in[channels * 40];
+    double kernel[64] = {0};
+    double kernel_buffer[64];
+    double out[channels * 64];
+    double out2[channels * 64];
+    double expected[79];
+    for (unsigned i = 0; i < channels * 40; ++i)
+    {
+        in[i] = sin(0.1 * i);
+    }
+    for (unsigned i = 0; i < 24; ++i)
+    {
+        kernel[i] = 1.0 / (i + 1.0);
+    }
+
+    FFTConfigD* fft = FFTInitD(64);
+    ASSERT_TRUE(fft);
+    ASSERT_EQ(NOERR, FFTPrepareBatchD(fft));
+    FFTSplitComplexD fft_kernel = {kernel_buffer, kernel_buffer + 32};
+    FFT_IR_R2CD(fft, kernel, fft_kernel);
+    ASSERT_EQ(NOERR, FFTFilterConvolveBatchD(fft, in, 40, fft_kernel, out, channels));
+
+    // Pair every channel with the same kernel
+    double kernels[channels * 24];
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        CopyBufferD(kernels + ch * 24, kernel, 24);
+    }
+    ASSERT_EQ(NOERR, FFTConvolveBatchD(fft, in, 40, kernels, 24, out2, channels));
+    FFTFreeD(fft);
+
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        ConvolveD(in + ch * 40, 40, kernel, 24, expected);
+        for (unsigned i = 0; i < 63; ++i)
+        {
+            ASSERT_NEAR(expected[i], out[ch * 64 + i], 0.0001);
+            ASSERT_NEAR(expected[i], out2[ch * 64 + i], 0.0001);
+        }
+    }
+}
+
+
+TEST(FFTDouble, TestComplexFFT)
+{
+    double in_real[64];
+    double in_imag[64];
+    double out_real[64];
+    double out_imag[64];
+    double inverse_real[64];
+    double inverse_imag[64];
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        in_real[i] = sin(0.3 * i);
+        in_imag[i] = cos(0.7 * i) / (i + 1.0);
+    }
+
+    FFTConfigD* fft = FFTInitD(64);
+    ASSERT_TRUE(fft);
+    ASSERT_EQ(NOERR, FFT_C2CD(fft, in_real, in_imag, out_real, out_imag));
+    ASSERT_EQ(NOERR, IFFT_C2CD(fft, out_real, out_imag, inverse_real, inverse_imag));
+    FFTFreeD(fft);
+
+    // Compare against the DFT
+    for (unsigned k = 0; k < 64; ++k)
+    {
+        double re = 0.0;
+        double im = 0.0;
+        for (unsigned n = 0; n < 64; ++n)
+        {
+            double phase = -2.0 * M_PI * k * n / 64.0;
+            re += in_real[n] * cos(phase) - in_imag[n] * sin(phase);
+            im += in_real[n] * sin(phase) + in_imag[n] * cos(phase);
+        }
+        ASSERT_NEAR(re, out_real[k], 0.0001);
+        ASSERT_NEAR(im, out_imag[k], 0.0001);
+    }
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        ASSERT_NEAR(in_real[i], inverse_real[i], EPSILON);
+        ASSERT_NEAR(in_imag[i], inverse_imag[i], EPSILON);
+    }
+}
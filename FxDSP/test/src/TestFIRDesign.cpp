@@ -0,0 +1,222 @@
+//
+//  TestFIRDesign.cpp
+//  FxDSP
+//
+//  Copyright (c) 2015 Hamilton Kibbe. All rights reserved.
+//
+
+#include "FIRDesign.h"
+#include "Dsp.h"
+#include <math.h>
+#include <gtest/gtest.h>
+
+
+// Magnitude response of a kernel at a normalized frequency
+template <typename T>
+static double
+magnitude(const T* kernel, unsigned length, double freq)
+{
+    double re = 0.0;
+    double im = 0.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        re += kernel[i] * cos(2.0 * M_PI * freq * i);
+        im -= kernel[i] * sin(2.0 * M_PI * freq * i);
+    }
+    return sqrt(re * re + im * im);
+}
+
+// Largest deviation from gain over [low, high]
+template <typename T>
+static double
+band_error(const T* kernel, unsigned length, double low, double high, double gain)
+{
+    double worst = 0.0;
+    for (unsigned i = 0; i <= 500; ++i)
+    {
+        const double f = low + (high - low) * i / 500.0;
+        const double e = fabs(magnitude(kernel, length, f) - gain);
+        worst = (e > worst) ? e : worst;
+    }
+    return worst;
+}
+
+
+TEST(FIRDesignSingle, TestWindowedSinc)
+{
+    FIRDesignSpec spec = {FIR_WINDOWED_SINC, LOWPASS, 0.2, 0.0, 0.0, 0.0, BLACKMAN, 101, 0};
+    float kernel[101];
+    ASSERT_EQ(101, FIRDesignLength(&spec));
+    ASSERT_EQ(NOERR, FIRDesign(kernel, &spec));
+    ASSERT_EQ(SYMMETRIC, KernelSymmetry(kernel, 101));
+    ASSERT_NEAR(1.0, magnitude(kernel, 101, 0.0), 0.0001);
+    ASSERT_LT(band_error(kernel, 101, 0.25, 0.5, 0.0), 0.0003);
+
+    // Highpass kernels must be odd
+    spec.type = HIGHPASS;
+    spec.length = 100;
+    ASSERT_EQ(0, FIRDesignLength(&spec));
+    ASSERT_EQ(VALUE_ERROR, FIRDesign(kernel, &spec));
+
+    spec.length = 101;
+    ASSERT_EQ(NOERR, FIRDesign(kernel, &spec));
+    ASSERT_NEAR(0.0, magnitude(kernel, 101, 0.0), 0.0001);
+    ASSERT_LT(band_error(kernel, 101, 0.25, 0.5, 1.0), 0.001);
+}
+
+TEST(FIRDesignSingle, TestKaiser)
+{
+    // 60 dB is a ripple of 0.001. Kaiser's length estimate is close, but not
+    // exact
+    FIRDesignSpec spec = {FIR_KAISER, BANDPASS, 0.1, 0.3, 0.05, 60.0, BOXCAR, 0, 0};
+    const unsigned length = FIRDesignLength(&spec);
+    float kernel[length];
+    ASSERT_GT(length, 60);
+    ASSERT_LT(length, 90);
+    ASSERT_EQ(NOERR, FIRDesign(kernel, &spec));
+    ASSERT_LT(band_error(kernel, length, 0.0, 0.075, 0.0), 0.0015);
+    ASSERT_LT(band_error(kernel, length, 0.125, 0.275, 1.0), 0.0015);
+    ASSERT_LT(band_error(kernel, length, 0.325, 0.5, 0.0), 0.0015);
+}
+
+TEST(FIRDesignSingle, TestEquiripple)
+{
+    FIRDesignSpec spec = {FIR_EQUIRIPPLE, LOWPASS, 0.2, 0.0, 0.05, 60.0, BOXCAR, 81, 0};
+    float kernel[81];
+    ASSERT_EQ(NOERR, FIRDesign(kernel, &spec));
+    ASSERT_EQ(SYMMETRIC, KernelSymmetry(kernel, 81));
+
+    // Same ripple in both bands
+    const double pass = band_error(kernel, 81, 0.0, 0.175, 1.0);
+    const double stop = band_error(kernel, 81, 0.225, 0.5, 0.0);
+    ASSERT_LT(pass, 0.001);
+    ASSERT_NEAR(pass, stop, 0.05 * pass);
+}
+
+TEST(FIRDesignSingle, TestFrequencySampling)
+{
+    // The response passes through the gains at the DFT bins
+    const float gains[5] = {1.0, 1.0, 0.5, 0.0, 0.0};
+    float kernel[33];
+    ASSERT_EQ(NOERR, FIRDesignFrequencySampling(kernel, 33, gains, 5, BOXCAR));
+    for (unsigned k = 0; k <= 16; ++k)
+    {
+        const double position = (2.0 * k / 33) * 4;
+        const unsigned index = (unsigned)position;
+        const double expected = gains[index] + (position - index) * (gains[index + 1] - gains[index]);
+        ASSERT_NEAR(expected, magnitude(kernel, 33, k / 33.0), 0.0001);
+    }
+}
+
+TEST(FIRDesignSingle, TestMinimumPhase)
+{
+    FIRDesignSpec spec = {FIR_KAISER, LOWPASS, 0.2, 0.0, 0.05, 60.0, BOXCAR, 0, 0};
+    const unsigned length = FIRDesignLength(&spec);
+    float linear[length];
+    float minimum[length];
+    ASSERT_EQ(NOERR, FIRDesign(linear, &spec));
+    ASSERT_EQ(NOERR, FIRDesignMinimumPhase(minimum, linear, length));
+
+    // Same passband, most of the energy up front
+    for (unsigned i = 0; i <= 20; ++i)
+    {
+        const double f = 0.17 * i / 20.0;
+        ASSERT_NEAR(magnitude(linear, length, f), magnitude(minimum, length, f), 0.002);
+    }
+    double early = 0.0;
+    double total = 0.0;
+    for (unsigned i = 0; i < length; ++i)
+    {
+        total += minimum[i] * minimum[i];
+        early += (i < length / 4) ? minimum[i] * minimum[i] : 0.0;
+    }
+    ASSERT_GT(early / total, 0.9);
+}
+
+TEST(FIRDesignSingle, TestCache)
+{
+    FIRDesignCache* cache = FIRDesignCacheInit(2);
+    FIRDesignSpec a = {FIR_KAISER, LOWPASS, 0.2, 0.0, 0.05, 60.0, BOXCAR, 0, 0};
+    FIRDesignSpec b = a;
+    FIRDesignSpec c = a;
+    b.cutoff = 0.1;
+    c.cutoff = 0.3;
+    unsigned length = 0;
+
+    const float* kernel_a = FIRDesignCacheGet(cache, &a, &length);
+    ASSERT_TRUE(kernel_a != NULL);
+    ASSERT_EQ(FIRDesignLength(&a), length);
+    ASSERT_EQ(kernel_a, FIRDesignCacheGet(cache, &a, &length));
+
+    // Using a after b makes b the least recently used, so c replaces it
+    ASSERT_TRUE(FIRDesignCacheGet(cache, &b, &length) != NULL);
+    ASSERT_EQ(kernel_a, FIRDesignCacheGet(cache, &a, &length));
+    const float* kernel_c = FIRDesignCacheGet(cache, &c, &length);
+    ASSERT_EQ(kernel_a, FIRDesignCacheGet(cache, &a, &length));
+    ASSERT_EQ(kernel_c, FIRDesignCacheGet(cache, &c, &length));
+
+    // Invalid specs aren't cached
+    c.cutoff = 0.6;
+    ASSERT_TRUE(FIRDesignCacheGet(cache, &c, &length) == NULL);
+    FIRDesignCacheFree(cache);
+}
+
+
+TEST(FIRDesignDouble, TestEquiripple)
+{
+    // 100 dB needs a few hundred taps
+    FIRDesignSpec spec = {FIR_EQUIRIPPLE, NOTCH, 0.1, 0.3, 0.04, 100.0, BOXCAR, 0, 0};
+    const unsigned length = FIRDesignLength(&spec);
+    double kernel[length];
+    ASSERT_EQ(1, length % 2);
+    ASSERT_EQ(NOERR, FIRDesignD(kernel, &spec));
+    ASSERT_LT(band_error(kernel, length, 0.0, 0.08, 1.0), 0.0001);
+    ASSERT_LT(band_error(kernel, length, 0.12, 0.28, 0.0), 0.0001);
+    ASSERT_LT(band_error(kernel, length, 0.32, 0.5, 1.0), 0.0001);
+
+    // Arbitrary bands and weights. The stopband error is a tenth of the
+    // passband error
+    const double bands[4] = {0.0, 0.1, 0.15, 0.5};
+    const double gains[2] = {1.0, 0.0};
+    const double weights[2] = {1.0, 10.0};
+    double custom[64];
+    ASSERT_EQ(NOERR, FIRDesignEquirippleD(custom, 64, bands, gains, weights, 2));
+    const double pass = band_error(custom, 64, 0.0, 0.1, 1.0);
+    const double stop = band_error(custom, 64, 0.15, 0.5, 0.0);
+    ASSERT_NEAR(pass, 10.0 * stop, 0.05 * pass);
+}
+
+TEST(FIRDesignDouble, TestMinimumPhase)
+{
+    FIRDesignSpec spec = {FIR_EQUIRIPPLE, LOWPASS, 0.2, 0.0, 0.05, 60.0, BOXCAR, 0, 1};
+    const unsigned length = FIRDesignLength(&spec);
+    double kernel[length];
+    ASSERT_EQ(NOERR, FIRDesignD(kernel, &spec));
+    ASSERT_EQ(ASYMMETRIC, KernelSymmetryD(kernel, length));
+    ASSERT_LT(band_error(kernel, length, 0.0, 0.175, 1.0), 0.002);
+
+    // The peak moves to the start
+    unsigned peak = 0;
+    for (unsigned i = 1; i < length; ++i)
+    {
+        peak = (fabs(kernel[i]) > fabs(kernel[peak])) ? i : peak;
+    }
+    ASSERT_LT(peak, length / 8);
+}
+
+TEST(FIRDesignDouble, TestCache)
+{
+    FIRDesignCacheD* cache = FIRDesignCacheInitD(4);
+    FIRDesignSpec spec = {FIR_WINDOWED_SINC, LOWPASS, 0.25, 0.0, 0.0, 0.0, HANN, 31, 0};
+    double expected[31];
+    unsigned length = 0;
+    FIRDesignD(expected, &spec);
+    const double* kernel = FIRDesignCacheGetD(cache, &spec, &length);
+    ASSERT_EQ(31, length);
+    for (unsigned i = 0; i < length; ++i)
+    {
+        ASSERT_DOUBLE_EQ(expected[i], kernel[i]);
+    }
+    ASSERT_EQ(kernel, FIRDesignCacheGetD(cache, &spec, &length));
+    FIRDesignCacheFreeD(cache);
+}
@@ -145,6 +145,193 @@ TEST(FIRFilterSingle, TestUpdateKernel)
 
 
 
+TEST(FIRFilterSingle, TestPartitionedAgainstMatlab)
+{
+    float output[100];
+    
+    // Set up
+    FIRFilter *theFilter = FIRFilterInit(MatlabFilter, 22, PARTITIONED);
+    
+    // Process in blocks of 10, which is also the latency
+    for (unsigned block = 0; block < 10; ++block)
+    {
+        FIRFilterProcess(theFilter, output + (block * 10), MatlabSignal + (block * 10), 10);
+    }
+    
+    // Tear down
+    FIRFilterFree(theFilter);
+    
+    // Check results
+    for (unsigned i = 0; i < 10; ++i)
+    {
+        ASSERT_NEAR(0, output[i], EPSILON);
+    }
+    for (unsigned i = 10; i < 100; ++i)
+    {
+        ASSERT_NEAR(MatlabLowpassOutput[i - 10], output[i], EPSILON);
+    }
+}
+
+
+TEST(FIRFilterSingle, TestPreparedAgainstMatlab)
+{
+    const ConvolutionMode_t modes[2] = {DIRECT, FFT};
+    const unsigned blocks[5] = {7, 16, 3, 40, 34};
+    
+    for (unsigned m = 0; m < 2; ++m)
+    {
+        float output[100];
+        
+        // Set up
+        FIRFilter *theFilter = FIRFilterInit(MatlabFilter, 22, modes[m]);
+        ASSERT_EQ(NOERR, FIRFilterPrepare(theFilter, 16));
+        
+        // Process. Calls longer than the prepared size are split up
+        unsigned pos = 0;
+        for (unsigned i = 0; i < 5; ++i)
+        {
+            FIRFilterProcess(theFilter, output + pos, MatlabSignal + pos, blocks[i]);
+            pos += blocks[i];
+        }
+        
+        // Tear down
+        FIRFilterFree(theFilter);
+        
+        // Check results
+        for (unsigned i = 0; i < 100; ++i)
+        {
+            ASSERT_NEAR(MatlabLowpassOutput[i], output[i], EPSILON);
+        }
+    }
+}
+
+TEST(FIRFilterSingle, TestCrossfadeUpdateKernel)
+{
+    const ConvolutionMode_t modes[3] = {DIRECT, FFT, PARTITIONED};
+    float input[640];
+    float kernel[22];
+    float expected_old[640];
+    float expected_new[640];
+    float output[640];
+    
+    for (unsigned i = 0; i < 640; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    for (unsigned i = 0; i < 22; ++i)
+    {
+        kernel[i] = (i % 2) ? -MatlabFilter[i] : MatlabFilter[i];
+    }
+    
+    FIRFilter *reference = FIRFilterInit(MatlabFilter, 22, DIRECT);
+    FIRFilterProcess(reference, expected_old, input, 640);
+    FIRFilterFree(reference);
+    reference = FIRFilterInit(kernel, 22, DIRECT);
+    FIRFilterProcess(reference, expected_new, input, 640);
+    FIRFilterFree(reference);
+    
+    for (unsigned m = 0; m < 3; ++m)
+    {
+        // Set up
+        FIRFilter *theFilter = FIRFilterInit(MatlabFilter, 22, modes[m]);
+        FIRFilterPrepare(theFilter, 16);
+        FIRFilterSetCrossfade(theFilter, 64);
+        
+        // Process. The new kernel is picked up by the next block, and can't be
+        // replaced again until it has faded in
+        FIRFilterProcess(theFilter, output, input, 48);
+        ASSERT_EQ(NOERR, FIRFilterUpdateKernel(theFilter, kernel));
+        FIRFilterProcess(theFilter, output + 48, input + 48, 16);
+        ASSERT_EQ(ERROR, FIRFilterUpdateKernel(theFilter, kernel));
+        for (unsigned pos = 64; pos < 320; pos += 16)
+        {
+            FIRFilterProcess(theFilter, output + pos, input + pos, 16);
+        }
+        
+        // Once it has faded in, the old kernel's buffers take the next one
+        ASSERT_EQ(NOERR, FIRFilterUpdateKernel(theFilter, MatlabFilter));
+        for (unsigned pos = 320; pos < 640; pos += 16)
+        {
+            FIRFilterProcess(theFilter, output + pos, input + pos, 16);
+        }
+        
+        // Tear down
+        FIRFilterFree(theFilter);
+        
+        // Check results. Partitioned mode lags by a block but fades with the
+        // full input history, the others fade exactly once the old kernel's
+        // tail has passed
+        unsigned latency = (modes[m] == PARTITIONED) ? 16 : 0;
+        unsigned settle = (modes[m] == PARTITIONED) ? 0 : 21;
+        unsigned start = 48 + latency;
+        for (unsigned i = latency; i < 320; ++i)
+        {
+            float old_out = expected_old[i - latency];
+            float new_out = expected_new[i - latency];
+            if (i < start)
+            {
+                ASSERT_NEAR(old_out, output[i], 0.0001);
+            }
+            else if (i >= start + settle)
+            {
+                float gain = (i < start + 64) ? (i - start) / 64.0 : 1.0;
+                ASSERT_NEAR(old_out + gain * (new_out - old_out), output[i], 0.0001);
+            }
+        }
+        for (unsigned i = 320 + latency + 64 + settle; i < 640; ++i)
+        {
+            ASSERT_NEAR(expected_old[i - latency], output[i], 0.0001);
+        }
+    }
+}
+
+TEST(FIRFilterSingle, TestPartitionedLongKernel)
+{
+    float kernel[1000];
+    float input[4096];
+    float expected[4096];
+    float output[4096];
+    
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        kernel[i] = exp(-0.005 * i) * sin(0.3 * i);
+    }
+    for (unsigned i = 0; i < 4096; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    
+    // Set up
+    FIRFilter *direct = FIRFilterInit(kernel, 1000, DIRECT);
+    FIRFilter *partitioned = FIRFilterInit(kernel, 1000, PARTITIONED);
+    
+    // Process. The first call sets 64 sample partitions, later calls need
+    // not line up with them
+    FIRFilterProcess(direct, expected, input, 4096);
+    FIRFilterProcess(partitioned, output, input, 64);
+    for (unsigned pos = 64; pos < 4096; pos += 37)
+    {
+        unsigned count = (4096 - pos < 37) ? 4096 - pos : 37;
+        FIRFilterProcess(partitioned, output + pos, input + pos, count);
+    }
+    
+    // Tear down
+    FIRFilterFree(direct);
+    FIRFilterFree(partitioned);
+    
+    // Check results
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        ASSERT_NEAR(0, output[i], EPSILON);
+    }
+    for (unsigned i = 64; i < 4096; ++i)
+    {
+        ASSERT_NEAR(expected[i - 64], output[i], 0.0005);
+    }
+}
+
+
+
 TEST(FIRFilterDouble, TestDirectAgainstMatlab)
 {
     double output[100];
@@ -271,4 +458,190 @@ TEST(FIRFilterDouble, TestUpdateKernel)
     
     // Tear down
     FIRFilterFreeD(theFilter);
+}
+
+
+TEST(FIRFilterDouble, TestPartitionedAgainstMatlab)
+{
+    double output[100];
+    
+    // Set up
+    FIRFilterD *theFilter = FIRFilterInitD(MatlabFilterD, 22, PARTITIONED);
+    
+    // Process in blocks of 10, which is also the latency
+    for (unsigned block = 0; block < 10; ++block)
+    {
+        FIRFilterProcessD(theFilter, output + (block * 10), MatlabSignalD + (block * 10), 10);
+    }
+    
+    // Tear down
+    FIRFilterFreeD(theFilter);
+    
+    // Check results
+    for (unsigned i = 0; i < 10; ++i)
+    {
+        ASSERT_NEAR(0, output[i], EPSILON);
+    }
+    for (unsigned i = 10; i < 100; ++i)
+    {
+        ASSERT_NEAR(MatlabLowpassOutputD[i - 10], output[i], EPSILON);
+    }
+}
+
+
+TEST(FIRFilterDouble, TestPreparedAgainstMatlab)
+{
+    const ConvolutionMode_t modes[2] = {DIRECT, FFT};
+    const unsigned blocks[5] = {7, 16, 3, 40, 34};
+    
+    for (unsigned m = 0; m < 2; ++m)
+    {
+        double output[100];
+        
+        // Set up
+        FIRFilterD *theFilter = FIRFilterInitD(MatlabFilterD, 22, modes[m]);
+        ASSERT_EQ(NOERR, FIRFilterPrepareD(theFilter, 16));
+        
+        // Process. Calls longer than the prepared size are split up
+        unsigned pos = 0;
+        for (unsigned i = 0; i < 5; ++i)
+        {
+            FIRFilterProcessD(theFilter, output + pos, MatlabSignalD + pos, blocks[i]);
+            pos += blocks[i];
+        }
+        
+        // Tear down
+        FIRFilterFreeD(theFilter);
+        
+        // Check results
+        for (unsigned i = 0; i < 100; ++i)
+        {
+            ASSERT_NEAR(MatlabLowpassOutputD[i], output[i], EPSILON);
+        }
+    }
+}
+
+TEST(FIRFilterDouble, TestCrossfadeUpdateKernel)
+{
+    const ConvolutionMode_t modes[3] = {DIRECT, FFT, PARTITIONED};
+    double input[640];
+    double kernel[22];
+    double expected_old[640];
+    double expected_new[640];
+    double output[640];
+    
+    for (unsigned i = 0; i < 640; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    for (unsigned i = 0; i < 22; ++i)
+    {
+        kernel[i] = (i % 2) ? -MatlabFilterD[i] : MatlabFilterD[i];
+    }
+    
+    FIRFilterD *reference = FIRFilterInitD(MatlabFilterD, 22, DIRECT);
+    FIRFilterProcessD(reference, expected_old, input, 640);
+    FIRFilterFreeD(reference);
+    reference = FIRFilterInitD(kernel, 22, DIRECT);
+    FIRFilterProcessD(reference, expected_new, input, 640);
+    FIRFilterFreeD(reference);
+    
+    for (unsigned m = 0; m < 3; ++m)
+    {
+        // Set up
+        FIRFilterD *theFilter = FIRFilterInitD(MatlabFilterD, 22, modes[m]);
+        FIRFilterPrepareD(theFilter, 16);
+        FIRFilterSetCrossfadeD(theFilter, 64);
+        
+        // Process. The new kernel is picked up by the next block, and can't be
+        // replaced again until it has faded in
+        FIRFilterProcessD(theFilter, output, input, 48);
+        ASSERT_EQ(NOERR, FIRFilterUpdateKernelD(theFilter, kernel));
+        FIRFilterProcessD(theFilter, output + 48, input + 48, 16);
+        ASSERT_EQ(ERROR, FIRFilterUpdateKernelD(theFilter, kernel));
+        for (unsigned pos = 64; pos < 320; pos += 16)
+        {
+            FIRFilterProcessD(theFilter, output + pos, input + pos, 16);
+        }
+        
+        // Once it has faded in, the old kernel's buffers take the next one
+        ASSERT_EQ(NOERR, FIRFilterUpdateKernelD(theFilter, MatlabFilterD));
+        for (unsigned pos = 320; pos < 640; pos += 16)
+        {
+            FIRFilterProcessD(theFilter, output + pos, input + pos, 16);
+        }
+        
+        // Tear down
+        FIRFilterFreeD(theFilter);
+        
+        // Check results. Partitioned mode lags by a block but fades with the
+        // full input history, the others fade exactly once the old kernel's
+        // tail has passed
+        unsigned latency = (modes[m] == PARTITIONED) ? 16 : 0;
+        unsigned settle = (modes[m] == PARTITIONED) ? 0 : 21;
+        unsigned start = 48 + latency;
+        for (unsigned i = latency; i < 320; ++i)
+        {
+            double old_out = expected_old[i - latency];
+            double new_out = expected_new[i - latency];
+            if (i < start)
+            {
+                ASSERT_NEAR(old_out, output[i], EPSILON);
+            }
+            else if (i >= start + settle)
+            {
+                double gain = (i < start + 64) ? (i - start) / 64.0 : 1.0;
+                ASSERT_NEAR(old_out + gain * (new_out - old_out), output[i], EPSILON);
+            }
+        }
+        for (unsigned i = 320 + latency + 64 + settle; i < 640; ++i)
+        {
+            ASSERT_NEAR(expected_old[i - latency], output[i], 0.0001);
+        }
+    }
+}
+
+TEST(FIRFilterDouble, TestPartitionedLongKernel)
+{
+    double kernel[1000];
+    double input[4096];
+    double expected[4096];
+    double output[4096];
+    
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        kernel[i] = exp(-0.005 * i) * sin(0.3 * i);
+    }
+    for (unsigned i = 0; i < 4096; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    
+    // Set up
+    FIRFilterD *direct = FIRFilterInitD(kernel, 1000, DIRECT);
+    FIRFilterD *partitioned = FIRFilterInitD(kernel, 1000, PARTITIONED);
+    
+    // Process. The first call sets 64 sample partitions, later calls need
+    // not line up with them
+    FIRFilterProcessD(direct, expected, input, 4096);
+    FIRFilterProcessD(partitioned, output, input, 64);
+    for (unsigned pos = 64; pos < 4096; pos += 37)
+    {
+        unsigned count = (4096 - pos < 37) ? 4096 - pos : 37;
+        FIRFilterProcessD(partitioned, output + pos, input + pos, count);
+    }
+    
+    // Tear down
+    FIRFilterFreeD(direct);
+    FIRFilterFreeD(partitioned);
+    
+    // Check results
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        ASSERT_NEAR(0, output[i], EPSILON);
+    }
+    for (unsigned i = 64; i < 4096; ++i)
+    {
+        ASSERT_NEAR(expected[i - 64], output[i], EPSILON);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+//
+//  TestHalfbandFilter.cpp
+//  FxDSP
+//
+//  Copyright (c) 2015 Hamilton Kibbe. All rights reserved.
+//
+
+#include "HalfbandFilter.h"
+#include <math.h>
+#include <gtest/gtest.h>
+
+
+// Level of a tone in the second half of a buffer, in dB, measured through a
+// Hann window so the other tones don't leak into it
+template <typename T>
+static double
+tone_level(const T* buffer, unsigned length, double freq)
+{
+    const unsigned start = length / 2;
+    const unsigned n = length - start;
+    double re = 0.0;
+    double im = 0.0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        const double w = 1.0 - cos(2.0 * M_PI * i / n);
+        re += w * buffer[start + i] * cos(2.0 * M_PI * freq * (start + i));
+        im += w * buffer[start + i] * sin(2.0 * M_PI * freq * (start + i));
+    }
+    return 20.0 * log10(2.0 * sqrt(re * re + im * im) / n);
+}
+
+
+TEST(HalfbandFilterSingle, TestHalfbandFilterOrder)
+{
+    ASSERT_EQ(8, HalfbandFilterOrder(100.0, 0.05));
+    ASSERT_EQ(6, HalfbandFilterOrder(100.0, 0.1));
+    ASSERT_EQ(4, HalfbandFilterOrder(100.0, 0.2));
+    ASSERT_EQ(3, HalfbandFilterOrder(100.0, 0.3));
+
+    double coefficients[8];
+    ASSERT_EQ(VALUE_ERROR, HalfbandFilterDesign(coefficients, 8, 0.5));
+    ASSERT_EQ(NOERR, HalfbandFilterDesign(coefficients, 8, 0.05));
+    for (unsigned i = 0; i < 8; ++i)
+    {
+        // Stable sections, in increasing order
+        ASSERT_GT(coefficients[i], 0.0);
+        ASSERT_LT(coefficients[i], 1.0);
+        if (i > 0)
+        {
+            ASSERT_GT(coefficients[i], coefficients[i - 1]);
+        }
+    }
+}
+
+TEST(HalfbandFilterSingle, TestHalfbandFilterUpsample)
+{
+    // A tone at the edge of the passband comes through, and its image is
+    // rejected
+    float in[2048];
+    float out[4096];
+    for (unsigned i = 0; i < 2048; ++i)
+    {
+        in[i] = sinf(2.0 * M_PI * 0.44 * i);
+    }
+
+    HalfbandFilter* hb = HalfbandFilterInitStage(0);
+    ASSERT_EQ(NOERR, HalfbandFilterUpsample(hb, out, in, 2048));
+    HalfbandFilterFree(hb);
+
+    ASSERT_NEAR(0.0, tone_level(out, 4096, 0.22), 0.01);
+    ASSERT_LT(tone_level(out, 4096, 0.28), -95.0);
+
+    // The impulse response peaks within a few samples
+    float impulse[32] = {1.0};
+    hb = HalfbandFilterInitStage(0);
+    HalfbandFilterUpsample(hb, out, impulse, 32);
+    HalfbandFilterFree(hb);
+    unsigned peak = 0;
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        peak = (fabsf(out[i]) > fabsf(out[peak])) ? i : peak;
+    }
+    ASSERT_LT(peak, 8);
+}
+
+TEST(HalfbandFilterDouble, TestHalfbandFilterDownsample)
+{
+    // A tone in the upper half of the band is rejected
+    double in[4096];
+    double out[2048];
+    unsigned n_out = 0;
+    for (unsigned i = 0; i < 4096; ++i)
+    {
+        in[i] = sin(2.0 * M_PI * 0.3 * i) + sin(2.0 * M_PI * 0.1 * i);
+    }
+
+    HalfbandFilterD* hb = HalfbandFilterInitStageD(0);
+    ASSERT_EQ(NOERR, HalfbandFilterDownsampleD(hb, out, &n_out, in, 4096));
+    HalfbandFilterFreeD(hb);
+
+    ASSERT_EQ(2048, n_out);
+    ASSERT_NEAR(0.0, tone_level(out, 2048, 0.2), 0.01);
+    ASSERT_LT(tone_level(out, 2048, 0.4), -100.0);
+}
+
+TEST(HalfbandFilterDouble, TestHalfbandFilterBlockSize)
+{
+    // Odd blocks give the same output as one long block
+    double in[300];
+    double expected[150];
+    double out[150];
+    unsigned n_out = 0;
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sin(i * M_PI / 20.0) + 0.5 * sin(i * 2.3);
+    }
+
+    HalfbandFilterD* hb = HalfbandFilterInitStageD(1);
+    HalfbandFilterDownsampleD(hb, expected, &n_out, in, 300);
+    HalfbandFilterFlushD(hb);
+
+    const unsigned blocks[5] = {1, 40, 7, 101, 151};
+    unsigned read = 0;
+    unsigned written = 0;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        HalfbandFilterDownsampleD(hb, out + written, &n_out, in + read, blocks[b]);
+        read += blocks[b];
+        written += n_out;
+    }
+    HalfbandFilterFreeD(hb);
+
+    ASSERT_EQ(150, written);
+    for (unsigned i = 0; i < 150; ++i)
+    {
+        ASSERT_DOUBLE_EQ(expected[i], out[i]);
+    }
+}
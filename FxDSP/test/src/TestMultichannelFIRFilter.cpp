@@ -0,0 +1,112 @@
+//
+//  TestMultichannelFIRFilter.cpp
+//  FxDSP
+//
+//  Copyright (c) 2015 Hamilton Kibbe. All rights reserved.
+//
+
+#include "MultichannelFIRFilter.h"
+#include "FIRFilter.h"
+#include <math.h>
+#include <string.h>
+#include <gtest/gtest.h>
+
+
+TEST(MultichannelFIRFilterSingle, TestAgainstSingleChannel)
+{
+    const unsigned channels = 5;
+    const unsigned length = 2048;
+    float kernel[300];
+    float input[channels * length];
+    float expected[channels * length];
+    float in_block[channels * 700];
+    float out_block[channels * 700];
+    
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        kernel[i] = 0.1 * exp(-0.01 * i) * sin(0.3 * i);
+    }
+    for (unsigned i = 0; i < channels * length; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    
+    // Filter each channel on its own
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        FIRFilter* single = FIRFilterInit(kernel, 300, DIRECT);
+        FIRFilterProcess(single, expected + ch * length, input + ch * length, length);
+        FIRFilterFree(single);
+    }
+    
+    // Calls longer than the block size are split up
+    MultichannelFIRFilter* filter = MultichannelFIRFilterInit(kernel, 300, channels, 512);
+    ASSERT_TRUE(filter != NULL);
+    for (unsigned pos = 0; pos < length; pos += 700)
+    {
+        unsigned count = (length - pos < 700) ? length - pos : 700;
+        for (unsigned ch = 0; ch < channels; ++ch)
+        {
+            memcpy(in_block + ch * count, input + ch * length + pos, count * sizeof(float));
+        }
+        MultichannelFIRFilterProcess(filter, out_block, in_block, count);
+        for (unsigned ch = 0; ch < channels; ++ch)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                ASSERT_NEAR(expected[ch * length + pos + i], out_block[ch * count + i], 0.0001);
+            }
+        }
+    }
+    MultichannelFIRFilterFree(filter);
+}
+
+
+TEST(MultichannelFIRFilterDouble, TestAgainstSingleChannel)
+{
+    const unsigned channels = 5;
+    const unsigned length = 2048;
+    double kernel[300];
+    double input[channels * length];
+    double expected[channels * length];
+    double in_block[channels * 700];
+    double out_block[channels * 700];
+    
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        kernel[i] = 0.1 * exp(-0.01 * i) * sin(0.3 * i);
+    }
+    for (unsigned i = 0; i < channels * length; ++i)
+    {
+        input[i] = ((i * 7919) % 201) / 100.0 - 1.0;
+    }
+    
+    // Filter each channel on its own
+    for (unsigned ch = 0; ch < channels; ++ch)
+    {
+        FIRFilterD* single = FIRFilterInitD(kernel, 300, DIRECT);
+        FIRFilterProcessD(single, expected + ch * length, input + ch * length, length);
+        FIRFilterFreeD(single);
+    }
+    
+    // Calls longer than the block size are split up
+    MultichannelFIRFilterD* filter = MultichannelFIRFilterInitD(kernel, 300, channels, 512);
+    ASSERT_TRUE(filter != NULL);
+    for (unsigned pos = 0; pos < length; pos += 700)
+    {
+        unsigned count = (length - pos < 700) ? length - pos : 700;
+        for (unsigned ch = 0; ch < channels; ++ch)
+        {
+            memcpy(in_block + ch * count, input + ch * length + pos, count * sizeof(double));
+        }
+        MultichannelFIRFilterProcessD(filter, out_block, in_block, count);
+        for (unsigned ch = 0; ch < channels; ++ch)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                ASSERT_NEAR(expected[ch * length + pos + i], out_block[ch * count + i], 0.000001);
+            }
+        }
+    }
+    MultichannelFIRFilterFreeD(filter);
+}
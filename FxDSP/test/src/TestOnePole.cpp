@@ -168,6 +168,33 @@ TEST(OnePoleSingle, TestLowpassTick)
     }
 }
 
+TEST(OnePoleSingle, TestBlockMode)
+{
+    // Set up
+    float output[50];
+    ClearBuffer(output, 50);
+
+    OnePole *filter = OnePoleInit(25, 100, LOWPASS);
+    ASSERT_EQ(NOERR, OnePoleSetMode(filter, IIR_BLOCK));
+
+    // Process in blocks that don't line up with the block length
+    OnePoleProcess(filter, output, MatlabSignal, 3);
+    OnePoleProcess(filter, output + 3, MatlabSignal + 3, 20);
+    OnePoleProcess(filter, output + 23, MatlabSignal + 23, 27);
+
+    // Test invalid argument handling
+    ASSERT_EQ(VALUE_ERROR, OnePoleSetMode(filter, N_IIR_MODES));
+
+    // Clean up
+    OnePoleFree(filter);
+
+    // Check results
+    for (unsigned i = 0; i < 50; ++i)
+    {
+        ASSERT_NEAR(output[i], MatlabLPOutput[i], 1e-6);
+    }
+}
+
 TEST(OnePoleSingle, TestHighpassAgainstMatlab)
 {
     // Set up
@@ -409,6 +436,30 @@ TEST(OnePoleDouble, TestLowpassTick)
     }
 }
 
+TEST(OnePoleDouble, TestBlockMode)
+{
+    // Set up
+    double output[50];
+    ClearBufferD(output, 50);
+
+    OnePoleD *filter = OnePoleInitD(25, 100, HIGHPASS);
+    ASSERT_EQ(NOERR, OnePoleSetModeD(filter, IIR_BLOCK));
+
+    // Process in blocks that don't line up with the block length
+    OnePoleProcessD(filter, output, MatlabSignalD, 3);
+    OnePoleProcessD(filter, output + 3, MatlabSignalD + 3, 20);
+    OnePoleProcessD(filter, output + 23, MatlabSignalD + 23, 27);
+
+    // Clean up
+    OnePoleFreeD(filter);
+
+    // Check results
+    for (unsigned i = 0; i < 50; ++i)
+    {
+        ASSERT_FLOAT_EQ(output[i], MatlabHPOutputD[i]);
+    }
+}
+
 TEST(OnePoleDouble, TestHighpassAgainstMatlab)
 {
     // Set up
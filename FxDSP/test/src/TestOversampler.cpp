@@ -0,0 +1,189 @@
+//
+//  TestOversampler.cpp
+//  FxDSP
+//
+//  Copyright (c) 2015 Hamilton Kibbe. All rights reserved.
+//
+
+#include "Oversampler.h"
+#include "Decimator.h"
+#include "DiodeSaturator.h"
+#include "Dsp.h"
+#include "Upsampler.h"
+#include <math.h>
+#include <gtest/gtest.h>
+
+
+// Clip to the threshold pointed to by context
+template <typename T>
+static Error_t
+clip(void* context, T* outBuffer, const T* inBuffer, unsigned n_samples)
+{
+    const T threshold = *(T*)context;
+    for (unsigned i = 0; i < n_samples; ++i)
+    {
+        outBuffer[i] = (inBuffer[i] > threshold) ? threshold :
+                       ((inBuffer[i] < -threshold) ? -threshold : inBuffer[i]);
+    }
+    return NOERR;
+}
+
+// Library processors are wrapped in a thunk rather than cast
+static Error_t
+saturate(void* context, float* outBuffer, const float* inBuffer, unsigned n_samples)
+{
+    return DiodeSaturatorProcess((DiodeSaturator*)context, outBuffer, inBuffer, n_samples);
+}
+
+static Error_t
+saturateD(void* context, double* outBuffer, const double* inBuffer, unsigned n_samples)
+{
+    return DiodeSaturatorProcessD((DiodeSaturatorD*)context, outBuffer, inBuffer, n_samples);
+}
+
+template <typename T>
+static Error_t
+fail(void* context, T* outBuffer, const T* inBuffer, unsigned n_samples)
+{
+    return VALUE_ERROR;
+}
+
+
+TEST(OversamplerSingle, TestOversampler)
+{
+    // Streaming sub-blocks gives the same output as running the whole buffer
+    // through each stage in turn, even in place and with odd call sizes
+    float in[3000];
+    float upsampled[12000];
+    float expected[3000];
+    float out[3000];
+    float threshold = 0.5;
+    for (unsigned i = 0; i < 3000; ++i)
+    {
+        in[i] = sinf(i * M_PI / 40.0);
+    }
+
+    Upsampler* us = UpsamplerInit(X4);
+    Decimator* ds = DecimatorInit(X4);
+    UpsamplerProcess(us, upsampled, in, 3000);
+    clip<float>(&threshold, upsampled, upsampled, 12000);
+    DecimatorProcess(ds, expected, upsampled, 12000);
+    UpsamplerFree(us);
+    DecimatorFree(ds);
+
+    Oversampler* os = OversamplerInit(X4, RESAMPLE_FIR, clip<float>, &threshold);
+    ASSERT_NE((void*)NULL, (void*)os);
+    CopyBuffer(out, in, 3000);
+    const unsigned blocks[4] = {1, 700, 13, 2286};
+    unsigned read = 0;
+    for (unsigned b = 0; b < 4; ++b)
+    {
+        ASSERT_EQ(NOERR, OversamplerProcess(os, out + read, out + read, blocks[b]));
+        read += blocks[b];
+    }
+    OversamplerFree(os);
+
+    for (unsigned i = 0; i < 3000; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-6);
+    }
+
+    /* Test invalid argument handling */
+    os = OversamplerInit(X4, RESAMPLE_FIR, NULL, NULL);
+    ASSERT_EQ((void*)NULL, (void*)os);
+    os = OversamplerInit((ResampleFactor_t)10000, RESAMPLE_FIR, clip<float>, &threshold);
+    ASSERT_EQ((void*)NULL, (void*)os);
+}
+
+TEST(OversamplerSingle, TestOversamplerProcessor)
+{
+    // A library processor runs through a thunk as if called on the
+    // upsampled buffer directly
+    float in[1000];
+    float upsampled[2000];
+    float expected[1000];
+    float out[1000];
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        in[i] = sinf(i * M_PI / 25.0);
+    }
+
+    DiodeSaturator* sat = DiodeSaturatorInit(FORWARD_BIAS, 0.8);
+    Upsampler* us = UpsamplerInit(X2);
+    Decimator* ds = DecimatorInit(X2);
+    UpsamplerProcess(us, upsampled, in, 1000);
+    DiodeSaturatorProcess(sat, upsampled, upsampled, 2000);
+    DecimatorProcess(ds, expected, upsampled, 2000);
+    UpsamplerFree(us);
+    DecimatorFree(ds);
+
+    Oversampler* os = OversamplerInit(X2, RESAMPLE_FIR, saturate, sat);
+    ASSERT_EQ(NOERR, OversamplerProcess(os, out, in, 1000));
+    OversamplerFree(os);
+    DiodeSaturatorFree(sat);
+
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-6);
+    }
+}
+
+TEST(OversamplerDouble, TestOversamplerProcessor)
+{
+    double in[1000];
+    double upsampled[2000];
+    double expected[1000];
+    double out[1000];
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        in[i] = sin(i * M_PI / 25.0);
+    }
+
+    DiodeSaturatorD* sat = DiodeSaturatorInitD(FORWARD_BIAS, 0.8);
+    UpsamplerD* us = UpsamplerInitD(X2);
+    DecimatorD* ds = DecimatorInitD(X2);
+    UpsamplerProcessD(us, upsampled, in, 1000);
+    DiodeSaturatorProcessD(sat, upsampled, upsampled, 2000);
+    DecimatorProcessD(ds, expected, upsampled, 2000);
+    UpsamplerFreeD(us);
+    DecimatorFreeD(ds);
+
+    OversamplerD* os = OversamplerInitD(X2, RESAMPLE_FIR, saturateD, sat);
+    ASSERT_EQ(NOERR, OversamplerProcessD(os, out, in, 1000));
+    OversamplerFreeD(os);
+    DiodeSaturatorFreeD(sat);
+
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-12);
+    }
+}
+
+TEST(OversamplerDouble, TestOversamplerIIR)
+{
+    // A clean tone comes through at unity gain
+    double in[2000];
+    double out[2000];
+    double threshold = 2.0;
+    for (unsigned i = 0; i < 2000; ++i)
+    {
+        in[i] = sin(i * M_PI / 20.0);
+    }
+
+    OversamplerD* os = OversamplerInitD(X8, RESAMPLE_IIR, clip<double>, &threshold);
+    ASSERT_EQ(NOERR, OversamplerProcessD(os, out, in, 2000));
+
+    // 25 whole periods
+    double power = 0.0;
+    for (unsigned i = 1000; i < 2000; ++i)
+    {
+        power += out[i] * out[i];
+    }
+    ASSERT_NEAR(1.0, sqrt(power / 500.0), 1e-3);
+    OversamplerFreeD(os);
+
+    // Processor errors are passed on
+    os = OversamplerInitD(X2, RESAMPLE_IIR, fail<double>, NULL);
+    ASSERT_EQ(VALUE_ERROR, OversamplerProcessD(os, out, in, 2000));
+    OversamplerFreeD(os);
+}
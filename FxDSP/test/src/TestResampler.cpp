@@ -0,0 +1,212 @@
+//
+//  TestResampler.cpp
+//  FxDSP
+//
+//  Copyright (c) 2015 Hamilton Kibbe. All rights reserved.
+//
+
+#include "Resampler.h"
+#include <math.h>
+#include <gtest/gtest.h>
+
+
+// Largest difference between a resampled tone and the ideal one, skipping
+// the start-up transient
+template <typename T>
+static double
+tone_error(const T* out, unsigned n_out, double in_rate, double out_rate,
+           double freq, double latency)
+{
+    const bool passed = (freq < 0.5 * in_rate) && (freq < 0.5 * out_rate);
+    double error = 0.0;
+    for (unsigned m = 500; m < n_out - 500; ++m)
+    {
+        const double t = m * in_rate / out_rate - latency;
+        const double ideal = passed ? sin(2.0 * M_PI * freq / in_rate * t) : 0.0;
+        error = fmax(error, fabs(out[m] - ideal));
+    }
+    return 20.0 * log10(error);
+}
+
+
+TEST(ResamplerSingle, TestResampler)
+{
+    float in[8000];
+    float out[9000];
+    for (unsigned i = 0; i < 8000; ++i)
+    {
+        in[i] = sin(2.0 * M_PI * 5000.0 / 44100.0 * i);
+    }
+
+    Resampler* rs = ResamplerInit(44100, 48000, RESAMPLER_MEDIUM);
+    ASSERT_GE(ResamplerMaxOutput(rs, 8000), 8708);
+    unsigned n_out = 0;
+    ASSERT_EQ(NOERR, ResamplerProcess(rs, out, &n_out, in, 8000));
+
+    // One output per 44100 / 48000 input samples
+    ASSERT_NEAR(8000 * 48000.0 / 44100.0, n_out, 1.0);
+    ASSERT_LT(tone_error(out, n_out, 44100, 48000, 5000, ResamplerLatency(rs)), -85.0);
+    ResamplerFree(rs);
+
+    /* Test invalid argument handling */
+    ASSERT_EQ((void*)NULL, (void*)ResamplerInit(0, 48000, RESAMPLER_LOW));
+    ASSERT_EQ((void*)NULL, (void*)ResamplerInit(44100, 48000, N_RESAMPLER_QUALITIES));
+}
+
+TEST(ResamplerSingle, TestResamplerBlockSize)
+{
+    // Any mix of block sizes gives the same output as one long block
+    float in[3000];
+    float expected[3300];
+    float out[3300];
+    for (unsigned i = 0; i < 3000; ++i)
+    {
+        in[i] = sinf(i * 0.05) + 0.3 * sinf(i * 1.1);
+    }
+
+    Resampler* rs = ResamplerInit(48000, 44100, RESAMPLER_LOW);
+    unsigned n_expected = 0;
+    ResamplerProcess(rs, expected, &n_expected, in, 3000);
+    ResamplerFlush(rs);
+
+    const unsigned blocks[6] = {1, 64, 1500, 3, 700, 732};
+    unsigned read = 0;
+    unsigned written = 0;
+    for (unsigned b = 0; b < 6; ++b)
+    {
+        unsigned n_out = 0;
+        ASSERT_LE(ResamplerMaxOutput(rs, blocks[b]), 3300 - written);
+        ResamplerProcess(rs, out + written, &n_out, in + read, blocks[b]);
+        ASSERT_LE(n_out, ResamplerMaxOutput(rs, blocks[b]));
+        read += blocks[b];
+        written += n_out;
+    }
+    ResamplerFree(rs);
+
+    ASSERT_EQ(n_expected, written);
+    for (unsigned i = 0; i < written; ++i)
+    {
+        ASSERT_FLOAT_EQ(expected[i], out[i]);
+    }
+}
+
+
+TEST(ResamplerSingle, TestResamplerSetRatio)
+{
+    // Changing the ratio every block bends the pitch without a discontinuity
+    float in[4000];
+    float out[100];
+    for (unsigned i = 0; i < 4000; ++i)
+    {
+        in[i] = sin(2.0 * M_PI * 1000.0 / 48000.0 * i);
+    }
+
+    Resampler* rs = ResamplerInit(48000, 48000, RESAMPLER_MEDIUM);
+    unsigned read = 0;
+    float last = 0.0;
+    for (unsigned b = 0; b < 30; ++b)
+    {
+        ASSERT_EQ(NOERR, ResamplerSetRatio(rs, 1.0 + 0.01 * sin(b * 0.5)));
+        const unsigned n_in = ResamplerInputNeeded(rs, 100);
+        ASSERT_EQ(NOERR, ResamplerProcessOutput(rs, out, 100, in + read));
+        read += n_in;
+        for (unsigned i = 0; i < 100; ++i)
+        {
+            if (b > 0)
+            {
+                ASSERT_LT(fabs(out[i] - last), 1.02 * 2.0 * M_PI * 1000.0 / 48000.0);
+            }
+            last = out[i];
+        }
+    }
+    ASSERT_NEAR(3000, read, 30);
+    ASSERT_EQ(VALUE_ERROR, ResamplerSetRatio(rs, 0.0));
+    ResamplerFree(rs);
+}
+
+
+TEST(ResamplerDouble, TestResampler)
+{
+    // Passband tones come through, and tones above the output nyquist are
+    // removed, to the preset's attenuation
+    const double freqs[3] = {1000.0, 20000.0, 26000.0};
+    double in[8000];
+    double out[4100];
+    ResamplerD* rs = ResamplerInitD(96000, 48000, RESAMPLER_HIGH);
+    for (unsigned f = 0; f < 3; ++f)
+    {
+        for (unsigned i = 0; i < 8000; ++i)
+        {
+            in[i] = sin(2.0 * M_PI * freqs[f] / 96000.0 * i);
+        }
+
+        unsigned n_out = 0;
+        ResamplerFlushD(rs);
+        ResamplerProcessD(rs, out, &n_out, in, 8000);
+        ASSERT_NEAR(4000, n_out, 1.0);
+        ASSERT_LT(tone_error(out, n_out, 96000, 48000, freqs[f], ResamplerLatencyD(rs)), -115.0);
+    }
+    ResamplerFreeD(rs);
+}
+
+TEST(ResamplerDouble, TestResamplerFlush)
+{
+    double in[1000];
+    double out1[1100];
+    double out2[1100];
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        in[i] = sin(i * 0.01);
+    }
+
+    ResamplerD* rs = ResamplerInitD(44100, 48000, RESAMPLER_LOW);
+    unsigned n1 = 0;
+    unsigned n2 = 0;
+    ResamplerProcessD(rs, out1, &n1, in, 1000);
+    ResamplerFlushD(rs);
+    ResamplerProcessD(rs, out2, &n2, in, 1000);
+    ResamplerFreeD(rs);
+
+    ASSERT_EQ(n1, n2);
+    for (unsigned i = 0; i < n1; ++i)
+    {
+        ASSERT_DOUBLE_EQ(out1[i], out2[i]);
+    }
+}
+
+TEST(ResamplerDouble, TestResamplerProcessOutput)
+{
+    // Pulling fixed blocks gives the same samples as pushing the input
+    double in[2000];
+    double expected[2400];
+    double out[2400];
+    for (unsigned i = 0; i < 2000; ++i)
+    {
+        in[i] = sin(i * 0.02);
+    }
+
+    ResamplerD* rs = ResamplerInitD(44100, 48000, RESAMPLER_LOW);
+    unsigned n_expected = 0;
+    ResamplerProcessD(rs, expected, &n_expected, in, 2000);
+    ResamplerFlushD(rs);
+
+    // Upsampling, so some blocks are due before any more input
+    const unsigned blocks[5] = {1, 1, 500, 7, 1000};
+    unsigned read = 0;
+    unsigned written = 0;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        const unsigned n_in = ResamplerInputNeededD(rs, blocks[b]);
+        ResamplerProcessOutputD(rs, out + written, blocks[b], in + read);
+        read += n_in;
+        written += blocks[b];
+    }
+    ResamplerFreeD(rs);
+
+    ASSERT_LE(read, 2000);
+    ASSERT_LE(written, n_expected);
+    for (unsigned i = 0; i < written; ++i)
+    {
+        ASSERT_DOUBLE_EQ(expected[i], out[i]);
+    }
+}
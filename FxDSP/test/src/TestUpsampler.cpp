@@ -100,6 +100,214 @@ TEST(UpsamplerSingle, TestUpsamplerFlush)
 }
 
 
+TEST(UpsamplerSingle, TestUpsamplerBlockSize)
+{
+    // Short and odd blocks give the same output as filtering the zero-stuffed
+    // input with the prototype, scaled by the factor
+    float in[300];
+    float expected[1200];
+    float out[1200];
+    float kernel[256];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sin(i * M_PI / 20.0) + 0.5 * sin(i * 2.3);
+    }
+    for (unsigned p = 0; p < 4; ++p)
+    {
+        for (unsigned k = 0; k < 64; ++k)
+        {
+            kernel[k * 4 + p] = 4.0 * PolyphaseCoeffs[X4][p][k];
+        }
+    }
+    for (unsigned m = 0; m < 1200; ++m)
+    {
+        expected[m] = 0.0;
+        for (unsigned j = m % 4; j < 256 && j <= m; j += 4)
+        {
+            expected[m] += kernel[j] * in[(m - j) / 4];
+        }
+    }
+
+    Upsampler* us = UpsamplerInit(X4);
+    const unsigned blocks[5] = {1, 40, 7, 100, 152};
+    unsigned read = 0;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        UpsamplerProcess(us, out + 4 * read, in + read, blocks[b]);
+        read += blocks[b];
+    }
+    UpsamplerFree(us);
+
+    for (unsigned i = 0; i < 1200; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-5);
+    }
+}
+
+TEST(UpsamplerSingle, TestUpsamplerCascadeBlockSize)
+{
+    // Short and odd blocks, and blocks longer than the cascade runs at a time,
+    // give the same output as two 2x stages, each filtering the zero-stuffed
+    // input with its prototype scaled by 2
+    float in[600];
+    float middle[1200];
+    float expected[2400];
+    float out[2400];
+    float kernel0[256];
+    float kernel1[256];
+    ASSERT_EQ(2, ResampleStageCount(X4));
+    const unsigned n_kernel0 = 2 * PolyphaseStageTaps(X4, 0);
+    const unsigned n_kernel1 = 2 * PolyphaseStageTaps(X4, 1);
+    ASSERT_EQ(NOERR, PolyphaseStageDesign(kernel0, X4, 0, 0));
+    ASSERT_EQ(NOERR, PolyphaseStageDesign(kernel1, X4, 1, 0));
+    for (unsigned i = 0; i < 600; ++i)
+    {
+        in[i] = sin(i * M_PI / 20.0) + 0.5 * sin(i * 2.3);
+    }
+    for (unsigned m = 0; m < 1200; ++m)
+    {
+        middle[m] = 0.0;
+        for (unsigned j = m % 2; j < n_kernel0 && j <= m; j += 2)
+        {
+            middle[m] += 2.0 * kernel0[j] * in[(m - j) / 2];
+        }
+    }
+    for (unsigned m = 0; m < 2400; ++m)
+    {
+        expected[m] = 0.0;
+        for (unsigned j = m % 2; j < n_kernel1 && j <= m; j += 2)
+        {
+            expected[m] += 2.0 * kernel1[j] * middle[(m - j) / 2];
+        }
+    }
+
+    Upsampler* us = UpsamplerInitMode(X4, RESAMPLE_FIR_CASCADE);
+    const unsigned blocks[5] = {1, 40, 7, 300, 252};
+    unsigned read = 0;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        UpsamplerProcess(us, out + 4 * read, in + read, blocks[b]);
+        read += blocks[b];
+    }
+    UpsamplerFree(us);
+
+    for (unsigned i = 0; i < 2400; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-5);
+    }
+}
+
+TEST(UpsamplerSingle, TestUpsamplerIIR)
+{
+    // The half-band cascade passes a tone at unity gain, and blocks of any
+    // size give the same output
+    float in[300];
+    float expected[2400];
+    float out[2400];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sinf(i * M_PI / 10.0);
+    }
+
+    Upsampler* us = UpsamplerInitMode(X8, RESAMPLE_IIR);
+    UpsamplerProcess(us, expected, in, 300);
+    UpsamplerFlush(us);
+
+    const unsigned blocks[5] = {1, 40, 7, 100, 152};
+    unsigned read = 0;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        UpsamplerProcess(us, out + 8 * read, in + read, blocks[b]);
+        read += blocks[b];
+    }
+    UpsamplerFree(us);
+
+    float peak = 0.0;
+    for (unsigned i = 0; i < 2400; ++i)
+    {
+        ASSERT_FLOAT_EQ(expected[i], out[i]);
+        peak = (i >= 1200 && fabsf(out[i]) > peak) ? fabsf(out[i]) : peak;
+    }
+    ASSERT_NEAR(1.0, peak, 1e-3);
+
+    /* Test invalid argument handling */
+    us = UpsamplerInitMode(X2, (ResampleMode_t)10000);
+    ASSERT_EQ((void*)us, (void*)NULL);
+}
+
+TEST(UpsamplerSingle, TestUpsamplerFactors)
+{
+    // Every factor passes a tone at unity gain
+    const ResampleFactor_t factors[3] = {X3, X6, X16};
+    float in[300];
+    float out[4800];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sinf(i * M_PI / 20.0);
+    }
+
+    for (unsigned f = 0; f < 3; ++f)
+    {
+        const unsigned factor = ResampleFactorValue(factors[f]);
+        Upsampler* us = UpsamplerInit(factors[f]);
+        ASSERT_NE((void*)NULL, (void*)us);
+        UpsamplerProcess(us, out, in, 300);
+        UpsamplerFree(us);
+
+        // 5 whole periods, after the filters settle
+        float power = 0.0;
+        for (unsigned i = 50 * factor; i < 250 * factor; ++i)
+        {
+            power += out[i] * out[i];
+        }
+        ASSERT_NEAR(1.0, sqrtf(2.0 * power / (200 * factor)), 1e-3);
+    }
+    ASSERT_EQ(16, ResampleFactorValue(X16));
+    ASSERT_EQ(4, ResampleStageCount(X16));
+
+    /* The half-band cascade only supports powers of 2 */
+    Upsampler* us = UpsamplerInitMode(X6, RESAMPLE_IIR);
+    ASSERT_EQ((void*)us, (void*)NULL);
+}
+
+TEST(UpsamplerSingle, TestUpsamplerMinimumPhase)
+{
+    // The minimum-phase filters pass a tone at unity gain, with a fraction of
+    // the delay of the linear-phase ones
+    float in[300];
+    float out[1200];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = (i == 0) ? 1.0 : 0.0;
+    }
+
+    Upsampler* us = UpsamplerInitMode(X4, RESAMPLE_FIR_MINIMUM_PHASE);
+    ASSERT_NE((void*)NULL, (void*)us);
+    UpsamplerProcess(us, out, in, 300);
+    unsigned peak = 0;
+    for (unsigned i = 0; i < 1200; ++i)
+    {
+        peak = (fabsf(out[i]) > fabsf(out[peak])) ? i : peak;
+    }
+    ASSERT_GT(16, peak);
+
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sinf(i * M_PI / 20.0);
+    }
+    UpsamplerFlush(us);
+    UpsamplerProcess(us, out, in, 300);
+    UpsamplerFree(us);
+
+    // 5 whole periods
+    float power = 0.0;
+    for (unsigned i = 200; i < 1000; ++i)
+    {
+        power += out[i] * out[i];
+    }
+    ASSERT_NEAR(1.0, sqrtf(power / 400.0), 1e-3);
+}
+
 TEST(UpsamplerDouble, TestUpsampler)
 {
     double in[200];
@@ -187,4 +395,132 @@ TEST(UpsamplerDouble, TestUpsamplerFlush)
     {
         ASSERT_DOUBLE_EQ(out1[i], out2[i]);
     }
-}
\ No newline at end of file
+}
+
+TEST(UpsamplerDouble, TestUpsamplerBlockSize)
+{
+    // Short and odd blocks give the same output as filtering the zero-stuffed
+    // input with the prototype, scaled by the factor
+    double in[300];
+    double expected[1200];
+    double out[1200];
+    double kernel[256];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sin(i * M_PI / 20.0) + 0.5 * sin(i * 2.3);
+    }
+    for (unsigned p = 0; p < 4; ++p)
+    {
+        for (unsigned k = 0; k < 64; ++k)
+        {
+            kernel[k * 4 + p] = 4.0 * PolyphaseCoeffsD[X4][p][k];
+        }
+    }
+    for (unsigned m = 0; m < 1200; ++m)
+    {
+        expected[m] = 0.0;
+        for (unsigned j = m % 4; j < 256 && j <= m; j += 4)
+        {
+            expected[m] += kernel[j] * in[(m - j) / 4];
+        }
+    }
+
+    UpsamplerD* us = UpsamplerInitD(X4);
+    const unsigned blocks[5] = {1, 40, 7, 100, 152};
+    unsigned read = 0;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        UpsamplerProcessD(us, out + 4 * read, in + read, blocks[b]);
+        read += blocks[b];
+    }
+    UpsamplerFreeD(us);
+
+    for (unsigned i = 0; i < 1200; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-12);
+    }
+}
+
+TEST(UpsamplerDouble, TestUpsamplerCascadeBlockSize)
+{
+    // Short and odd blocks, and blocks longer than the cascade runs at a time,
+    // give the same output as two 2x stages, each filtering the zero-stuffed
+    // input with its prototype scaled by 2
+    double in[600];
+    double middle[1200];
+    double expected[2400];
+    double out[2400];
+    double kernel0[256];
+    double kernel1[256];
+    ASSERT_EQ(2, ResampleStageCount(X4));
+    const unsigned n_kernel0 = 2 * PolyphaseStageTaps(X4, 0);
+    const unsigned n_kernel1 = 2 * PolyphaseStageTaps(X4, 1);
+    ASSERT_EQ(NOERR, PolyphaseStageDesignD(kernel0, X4, 0, 0));
+    ASSERT_EQ(NOERR, PolyphaseStageDesignD(kernel1, X4, 1, 0));
+    for (unsigned i = 0; i < 600; ++i)
+    {
+        in[i] = sin(i * M_PI / 20.0) + 0.5 * sin(i * 2.3);
+    }
+    for (unsigned m = 0; m < 1200; ++m)
+    {
+        middle[m] = 0.0;
+        for (unsigned j = m % 2; j < n_kernel0 && j <= m; j += 2)
+        {
+            middle[m] += 2.0 * kernel0[j] * in[(m - j) / 2];
+        }
+    }
+    for (unsigned m = 0; m < 2400; ++m)
+    {
+        expected[m] = 0.0;
+        for (unsigned j = m % 2; j < n_kernel1 && j <= m; j += 2)
+        {
+            expected[m] += 2.0 * kernel1[j] * middle[(m - j) / 2];
+        }
+    }
+
+    UpsamplerD* us = UpsamplerInitModeD(X4, RESAMPLE_FIR_CASCADE);
+    const unsigned blocks[5] = {1, 40, 7, 300, 252};
+    unsigned read = 0;
+    for (unsigned b = 0; b < 5; ++b)
+    {
+        UpsamplerProcessD(us, out + 4 * read, in + read, blocks[b]);
+        read += blocks[b];
+    }
+    UpsamplerFreeD(us);
+
+    for (unsigned i = 0; i < 2400; ++i)
+    {
+        ASSERT_NEAR(expected[i], out[i], 1e-12);
+    }
+}
+
+TEST(UpsamplerDouble, TestUpsamplerIIR)
+{
+    // Each output of the half-band cascade is close to the ideal
+    // interpolation, delayed by a few samples
+    double in[300];
+    double out[1200];
+    for (unsigned i = 0; i < 300; ++i)
+    {
+        in[i] = sin(i * M_PI / 20.0);
+    }
+
+    UpsamplerD* us = UpsamplerInitModeD(X4, RESAMPLE_IIR);
+    UpsamplerProcessD(us, out, in, 300);
+    UpsamplerFreeD(us);
+
+    // Find the delay from the first upward zero crossing after settling
+    unsigned crossing = 600;
+    while (!(out[crossing] <= 0.0 && out[crossing + 1] > 0.0))
+    {
+        ++crossing;
+    }
+    const double delay = crossing - out[crossing] / (out[crossing + 1] - out[crossing])
+                       - 640.0;
+    ASSERT_GT(delay, 0.0);
+    ASSERT_LT(delay, 32.0);
+    for (unsigned i = 600; i < 1200; ++i)
+    {
+        ASSERT_NEAR(sin((i - delay) * M_PI / 80.0), out[i], 0.01);
+    }
+}